@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# Throughput of the server with event-backend epoll and io_uring, with 1k and 10k connections.
+# usage: ./event_backend_bench.sh [kvmain] [port] [pipeline] [seconds]
+# results: event-backend/<backend>-c=<n>.txt, the server runs on 127.0.0.1
+
+KVMAIN="${1:-../../bin/kvmain}"
+PORT="${2:-9527}"
+PIPELINE="${3:-16}"
+SECONDS_PER_RUN="${4:-10}"
+BENCHMARK=../bin/benchmark_connections
+OUTPUT_DIR=event-backend
+
+test -d $OUTPUT_DIR || mkdir -p $OUTPUT_DIR
+# both the server and the client hold one fd for every connection
+ulimit -n 65536
+for backend in epoll io_uring; do
+  CONF=$OUTPUT_DIR/$backend.conf
+  echo -e "ip 127.0.0.1\nport ${PORT}\nappendonly 0\nevent-backend ${backend}" > $CONF
+  for nc in 1000 10000; do
+    "${KVMAIN}" $CONF > $OUTPUT_DIR/$backend-c="${nc}".log 2>&1 &
+    SERVER_PID=$!
+    sleep 1
+    "${BENCHMARK}" "${PORT}" $nc "${PIPELINE}" "${SECONDS_PER_RUN}" > $OUTPUT_DIR/$backend-c="${nc}".txt
+    kill -INT $SERVER_PID
+    wait $SERVER_PID
+    echo "Done benchmarking event-backend=${backend} with ${nc} connections"
+    cat $OUTPUT_DIR/$backend-c="${nc}".txt
+  done
+done
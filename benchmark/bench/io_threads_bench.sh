@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# Throughput of the server with different numbers of io threads.
+# usage: ./io_threads_bench.sh [kvmain] [port] [n_clients] [pipeline]
+# results: io-threads/t=<n>/test.csv, the server runs on 127.0.0.1
+
+KVMAIN="${1:-../../bin/kvmain}"
+PORT="${2:-9527}"
+N_CLIENTS="${3:-200}"
+PIPELINE="${4:-16}"
+TEST_COMMANDS=set,get,incr,lpush,hset
+N_REQUESTS=2000000
+OUTPUT_DIR=io-threads
+
+for nt in 1 2 4 8 16; do
+  test -d $OUTPUT_DIR/t="${nt}" || mkdir -p $OUTPUT_DIR/t="${nt}"
+  CONF=$OUTPUT_DIR/t="${nt}"/litekv.conf
+  echo -e "ip 127.0.0.1\nport ${PORT}\nappendonly 0\nio-threads ${nt}" > $CONF
+  "${KVMAIN}" $CONF > $OUTPUT_DIR/t="${nt}"/server.log 2>&1 &
+  SERVER_PID=$!
+  sleep 1
+  # the clients need several threads to keep the server busy
+  redis-benchmark -h 127.0.0.1 -p "${PORT}" -c $N_CLIENTS -n $N_REQUESTS -P $PIPELINE \
+    -t $TEST_COMMANDS --threads 8 -r 100000 --csv > $OUTPUT_DIR/t="${nt}"/test.csv
+  kill -INT $SERVER_PID
+  wait $SERVER_PID
+  echo "Done benchmarking io_threads=${nt}"
+  cat $OUTPUT_DIR/t="${nt}"/test.csv
+done
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../src/net/utils.h"
+
+using namespace std;
+
+/*
+ * Throughput of a running server with many connections, such as to compare event-backend epoll
+ * and io_uring. Every connection sends a batch of pipelined commands, waits for all replies and
+ * sends the next batch.
+ * usage: benchmark_connections [port] [connections] [pipeline] [seconds]
+ */
+
+struct Connection {
+  int fd = -1;
+  size_t n_replies = 0;  /* replies of the current batch received so far */
+};
+
+static double ElapsedSince(const chrono::high_resolution_clock::time_point &begin) {
+  chrono::duration<double> duration = chrono::high_resolution_clock::now() - begin;
+  return duration.count();
+}
+
+static string Command(const vector<string> &argv) {
+  string ans = "*" + to_string(argv.size()) + "\r\n";
+  for (const auto &arg : argv) {
+    ans += "$" + to_string(arg.size()) + "\r\n" + arg + "\r\n";
+  }
+  return ans;
+}
+
+/* commands whose replies are one line each, so that replies are counted by lines */
+static string Batch(size_t pipeline) {
+  string batch;
+  for (size_t i = 0; i < pipeline; ++i) {
+    string key = "key:" + to_string(i);
+    batch += i % 2 == 0 ? Command({"SET", key, "value:" + to_string(i)}) : Command({"INCR", "counter:" + to_string(i)});
+  }
+  return batch;
+}
+
+static int Connect(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd == -1) {
+    return -1;
+  }
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  SetFdNonBlock(fd);
+  return fd;
+}
+
+static bool SendBatch(const Connection &conn, const string &batch) {
+  return write(conn.fd, batch.data(), batch.size()) == (ssize_t)batch.size();
+}
+
+int main(int argc, char **argv) {
+  int port = argc > 1 ? atoi(argv[1]) : 9527;
+  size_t n_conns = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000;
+  size_t pipeline = argc > 3 ? strtoul(argv[3], nullptr, 10) : 16;
+  double seconds = argc > 4 ? atof(argv[4]) : 5;
+  if (n_conns == 0 || pipeline == 0) {
+    cerr << "usage: " << argv[0] << " [port] [connections] [pipeline] [seconds]\n";
+    return 1;
+  }
+
+  /* one fd for every connection */
+  struct rlimit limit{};
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < n_conns + 64) {
+    limit.rlim_cur = min<rlim_t>(limit.rlim_max, n_conns + 64);
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  string batch = Batch(pipeline);
+  int epfd = epoll_create1(0);
+  vector<Connection> conns(n_conns);
+  for (size_t i = 0; i < n_conns; ++i) {
+    conns[i].fd = Connect(port);
+    if (conns[i].fd == -1) {
+      cerr << "Can not connect to port " << port << " after " << i << " connections: " << strerror(errno) << endl;
+      return 1;
+    }
+    struct epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = i;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, conns[i].fd, &ev);
+  }
+
+  cout << n_conns << " connections, " << pipeline << " pipelined commands per batch, " << seconds << " s" << endl;
+  for (auto &conn : conns) {
+    SendBatch(conn, batch);
+  }
+  vector<struct epoll_event> events(1024);
+  vector<char> buf(64 * 1024);
+  size_t n_replies = 0;
+  auto begin = chrono::high_resolution_clock::now();
+  while (ElapsedSince(begin) < seconds) {
+    int ready = epoll_wait(epfd, events.data(), (int)events.size(), 100);
+    for (int i = 0; i < ready; ++i) {
+      Connection &conn = conns[events[i].data.u64];
+      ssize_t n;
+      while ((n = read(conn.fd, buf.data(), buf.size())) > 0) {
+        for (ssize_t j = 0; j < n; ++j) {
+          conn.n_replies += buf[j] == '\n';
+        }
+      }
+      if (n == 0) {
+        cerr << "Connection closed by the server" << endl;
+        return 1;
+      }
+      if (conn.n_replies >= pipeline) {
+        n_replies += pipeline;
+        conn.n_replies -= pipeline;
+        SendBatch(conn, batch);
+      }
+    }
+  }
+  double elapsed = ElapsedSince(begin);
+  cout << "Requests: " << n_replies << ", elapsed: " << elapsed << " s, "
+       << (size_t)(n_replies / elapsed) << " requests per second" << endl;
+  for (auto &conn : conns) {
+    close(conn.fd);
+  }
+  close(epfd);
+  return 0;
+}
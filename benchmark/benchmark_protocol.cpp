@@ -0,0 +1,123 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "../src/net/protocol.h"
+#include "../src/net/respscan.h"
+
+using namespace std;
+
+/* number of pipelined commands of every batch, can be overridden by command line arguments */
+const static vector<size_t> kDefaultSizes = {1000, 100000};
+const static size_t kRounds = 20;
+/* bytes of every read when the batch comes in pieces, as from a socket */
+const static size_t kReadSize = 16 * 1024;
+
+static double ElapsedSince(const chrono::high_resolution_clock::time_point &begin) {
+  chrono::duration<double> duration = chrono::high_resolution_clock::now() - begin;
+  return duration.count();
+}
+
+static string Command(const vector<string> &argv) {
+  string ans = "*" + to_string(argv.size()) + "\r\n";
+  for (const auto &arg : argv) {
+    ans += "$" + to_string(arg.size()) + "\r\n" + arg + "\r\n";
+  }
+  return ans;
+}
+
+/* small commands as sent by a pipelining client: set, get and incr on short keys */
+static string PipelinedBatch(size_t n) {
+  string batch;
+  for (size_t i = 0; i < n; ++i) {
+    string key = "key:" + to_string(i);
+    switch (i % 3) {
+      case 0: batch += Command({"SET", key, "value:" + to_string(i)}); break;
+      case 1: batch += Command({"GET", key}); break;
+      default: batch += Command({"INCR", "counter:" + to_string(i % 100)}); break;
+    }
+  }
+  return batch;
+}
+
+/* parse the batch from a buffer holding it entirely, or fed piece by piece */
+static void RunParse(const string &batch, size_t n, size_t read_size, const string &label) {
+  double elapsed = 0;
+  size_t parsed = 0;
+  for (size_t round = 0; round < kRounds; ++round) {
+    Buffer buffer(read_size == 0 ? batch.size() : read_size);
+    if (read_size == 0) {
+      buffer.Append(batch);
+    }
+    ParseState state;
+    CommandCache cache;
+    bool err = false;
+    auto begin = chrono::high_resolution_clock::now();
+    if (read_size == 0) {
+      while (TryParseFromBuffer(buffer, state, cache, err)) {
+        ++parsed;
+      }
+    } else {
+      for (size_t off = 0; off < batch.size(); off += read_size) {
+        buffer.Append(batch.data() + off, min(read_size, batch.size() - off));
+        while (TryParseFromBuffer(buffer, state, cache, err)) {
+          ++parsed;
+        }
+      }
+    }
+    elapsed += ElapsedSince(begin);
+  }
+  if (parsed != n * kRounds) {
+    cout << label << ": parsed " << parsed << " commands of " << n * kRounds << endl;
+    return;
+  }
+  cout << label << ", elapsed: " << elapsed << " s, " << (batch.size() * kRounds / elapsed / 1e6)
+       << " MB/s, " << (parsed / elapsed) << " commands/s" << endl;
+}
+
+/* search \r\n at the end of a long bulk, as in a value arriving in many reads */
+static void RunScan(size_t len, const string &label) {
+  string data(len, 'v');
+  data += "\r\n";
+  size_t found = 0;
+  auto begin = chrono::high_resolution_clock::now();
+  for (size_t round = 0; round < kRounds; ++round) {
+    found += RespFindCRLF(data.data(), data.data() + data.size()) - data.data();
+  }
+  double elapsed = ElapsedSince(begin);
+  if (found != len * kRounds) {
+    cout << label << ": wrong position " << found / kRounds << endl;
+    return;
+  }
+  cout << label << ", elapsed: " << elapsed << " s, " << (data.size() * kRounds / elapsed / 1e6)
+       << " MB/s" << endl;
+}
+
+int main(int argc, char **argv) {
+  vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(strtoull(argv[i], nullptr, 10));
+  }
+  if (sizes.empty()) {
+    sizes = kDefaultSizes;
+  }
+  for (size_t n : sizes) {
+    string batch = PipelinedBatch(n);
+    cout << "==== " << n << " pipelined commands, " << batch.size() << " bytes ====" << endl;
+    for (const char *kernel : {"scalar", "sse2", "avx2"}) {
+      if (RespUseKernel(kernel)) {
+        RunParse(batch, n, 0, string("Parse whole batch with ") + kernel + " kernels");
+        RunParse(batch, n, kReadSize, string("Parse batch in reads of ") + to_string(kReadSize) +
+                                          " bytes with " + kernel + " kernels");
+      }
+    }
+  }
+  cout << "==== CRLF search over a bulk of 1MB ====" << endl;
+  for (const char *kernel : {"scalar", "sse2", "avx2"}) {
+    if (RespUseKernel(kernel)) {
+      RunScan(1 << 20, string("Search with ") + kernel + " kernels");
+    }
+  }
+  return 0;
+}
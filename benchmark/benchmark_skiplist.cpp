@@ -0,0 +1,86 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include "../src/skiplist.h"
+
+using namespace std;
+
+/* number of nodes of every round, can be overridden by command line arguments */
+const static vector<size_t> kDefaultSizes = {1000000, 5000000, 10000000};
+
+static double ElapsedSince(const chrono::high_resolution_clock::time_point &begin) {
+  chrono::duration<double> duration = chrono::high_resolution_clock::now() - begin;
+  return duration.count();
+}
+
+static void RunRound(size_t n) {
+  mt19937_64 engine(n);
+  vector<int64_t> scores(n);
+  for (size_t i = 0; i < n; ++i) {
+    scores[i] = (int64_t)engine();
+  }
+  vector<DynamicString> members;
+  members.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    members.emplace_back(to_string(i));
+  }
+
+  Skiplist sklist;
+  auto begin = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < n; ++i) {
+    sklist.Insert(scores[i], members[i]);
+  }
+  double elapsed = ElapsedSince(begin);
+  cout << "Insert " << n << " nodes, elapsed: " << elapsed << " s, "
+       << (n / elapsed) << " ops/s" << endl;
+
+  /* look up in random order */
+  vector<size_t> order(n);
+  for (size_t i = 0; i < n; ++i) {
+    order[i] = engine() % n;
+  }
+  size_t found = 0;
+  begin = chrono::high_resolution_clock::now();
+  for (size_t i : order) {
+    found += sklist.Contains(scores[i], members[i]);
+  }
+  elapsed = ElapsedSince(begin);
+  cout << "Find " << n << " nodes (" << found << " found), elapsed: " << elapsed << " s, "
+       << (n / elapsed) << " ops/s" << endl;
+
+  long rank_sum = 0;
+  begin = chrono::high_resolution_clock::now();
+  for (size_t i : order) {
+    rank_sum += sklist.Rank(scores[i], members[i]);
+  }
+  elapsed = ElapsedSince(begin);
+  cout << "Rank " << n << " nodes (checksum " << rank_sum << "), elapsed: " << elapsed << " s, "
+       << (n / elapsed) << " ops/s" << endl;
+
+  int64_t score_sum = 0;
+  begin = chrono::high_resolution_clock::now();
+  for (size_t i : order) {
+    score_sum += sklist[i].score;
+  }
+  elapsed = ElapsedSince(begin);
+  cout << "Index " << n << " nodes (checksum " << score_sum << "), elapsed: " << elapsed << " s, "
+       << (n / elapsed) << " ops/s" << endl;
+}
+
+int main(int argc, char **argv) {
+  vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(strtoull(argv[i], nullptr, 10));
+  }
+  if (sizes.empty()) {
+    sizes = kDefaultSizes;
+  }
+  for (size_t n : sizes) {
+    cout << "==== " << n << " nodes ====" << endl;
+    RunRound(n);
+  }
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <cstdlib>
+#include "../src/vecdist.h"
+#include "../src/vectorset.h"
+
+using namespace std;
+
+/* number of vectors of every round, can be overridden by command line arguments */
+const static vector<size_t> kDefaultSizes = {10000, 100000};
+const static uint32_t kDim = 128;
+const static size_t kQueries = 1000;
+const static size_t kTopK = 10;
+
+static double ElapsedSince(const chrono::high_resolution_clock::time_point &begin) {
+  chrono::duration<double> duration = chrono::high_resolution_clock::now() - begin;
+  return duration.count();
+}
+
+static vector<float> RandomVectors(mt19937_64 &engine, size_t n) {
+  normal_distribution<float> dist;
+  vector<float> vecs(n * kDim);
+  for (auto &v : vecs) {
+    v = dist(engine);
+  }
+  return vecs;
+}
+
+/* search every query and report throughput and recall@k against the exact results */
+static void RunQueries(const VectorSet &vset, const vector<float> &queries,
+                       const vector<unordered_set<string>> &truth, size_t ef, const string &label) {
+  size_t hits = 0;
+  auto begin = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < kQueries; ++i) {
+    auto matches = ef == 0 ? vset.SearchExact(&queries[i * kDim], kTopK)
+                           : vset.Search(&queries[i * kDim], kTopK, ef);
+    for (const auto &match : matches) {
+      hits += truth[i].count(match.first);
+    }
+  }
+  double elapsed = ElapsedSince(begin);
+  cout << label << ", recall@" << kTopK << ": " << (double)hits / (kQueries * kTopK)
+       << ", elapsed: " << elapsed << " s, " << (kQueries / elapsed) << " queries/s" << endl;
+}
+
+static void RunRound(size_t n, bool quantized) {
+  mt19937_64 engine(n);
+  vector<float> vecs = RandomVectors(engine, n);
+  vector<float> queries = RandomVectors(engine, kQueries);
+
+  VectorSet vset(kDim, kVecMetricL2, quantized);
+  auto begin = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < n; ++i) {
+    vset.Add(to_string(i), &vecs[i * kDim]);
+  }
+  double elapsed = ElapsedSince(begin);
+  cout << "Add " << n << " vectors, elapsed: " << elapsed << " s, " << (n / elapsed) << " ops/s"
+       << endl;
+
+  vector<unordered_set<string>> truth(kQueries);
+  for (size_t i = 0; i < kQueries; ++i) {
+    for (const auto &match : vset.SearchExact(&queries[i * kDim], kTopK)) {
+      truth[i].insert(match.first);
+    }
+  }
+  for (const char *kernel : {"scalar", "sse", "avx2"}) {
+    if (VecUseKernel(kernel)) {
+      RunQueries(vset, queries, truth, 0, string("Exact search with ") + kernel + " kernels");
+    }
+  }
+  for (size_t ef : {10, 50, 100, 200}) {
+    RunQueries(vset, queries, truth, ef, "Graph search with ef " + to_string(ef));
+  }
+}
+
+int main(int argc, char **argv) {
+  vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(strtoull(argv[i], nullptr, 10));
+  }
+  if (sizes.empty()) {
+    sizes = kDefaultSizes;
+  }
+  for (size_t n : sizes) {
+    for (bool quantized : {false, true}) {
+      cout << "==== " << n << " vectors of " << kDim << " dimensions"
+           << (quantized ? ", int8 quantized" : "") << " ====" << endl;
+      RunRound(n, quantized);
+    }
+  }
+  return 0;
+}
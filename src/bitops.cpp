@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cstring>
+#include "bitops.h"
+
+/* let the compiler emit popcnt/avx2 versions of the kernels and pick one at load time */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__)
+#define LKV_TARGET_CLONES(...) __attribute__((target_clones(__VA_ARGS__)))
+#else
+#define LKV_TARGET_CLONES(...)
+#endif
+
+/* 32 bytes processed at once, one ymm register with avx2, two xmm registers otherwise */
+typedef uint64_t Block __attribute__((vector_size(32)));
+typedef uint8_t ByteBlock __attribute__((vector_size(32)));
+
+static constexpr size_t kBlockBytes = sizeof(Block);
+
+/* mask of bits [from, 7] of a byte, counted from the most significant bit */
+static inline unsigned char MaskFrom(unsigned int from) { return (unsigned char)(0xFF >> from); }
+
+/* mask of bits [0, to] of a byte, counted from the most significant bit */
+static inline unsigned char MaskTo(unsigned int to) { return (unsigned char)(0xFF << (7 - to)); }
+
+LKV_TARGET_CLONES("popcnt", "default")
+size_t BitCount(const unsigned char *p, size_t len) {
+  size_t count = 0;
+  uint64_t w[4];
+  for (; len >= kBlockBytes; p += kBlockBytes, len -= kBlockBytes) {
+    memcpy(w, p, kBlockBytes);
+    count += __builtin_popcountll(w[0]) + __builtin_popcountll(w[1]) +
+             __builtin_popcountll(w[2]) + __builtin_popcountll(w[3]);
+  }
+  for (; len >= sizeof(uint64_t); p += sizeof(uint64_t), len -= sizeof(uint64_t)) {
+    memcpy(w, p, sizeof(uint64_t));
+    count += __builtin_popcountll(w[0]);
+  }
+  for (; len > 0; ++p, --len) {
+    count += __builtin_popcount(*p);
+  }
+  return count;
+}
+
+size_t BitCountRange(const unsigned char *p, uint64_t start, uint64_t end) {
+  uint64_t first = start >> 3, last = end >> 3;
+  if (first == last) {
+    return __builtin_popcount(p[first] & MaskFrom(start & 7) & MaskTo(end & 7));
+  }
+  return __builtin_popcount(p[first] & MaskFrom(start & 7)) +
+         BitCount(p + first + 1, last - first - 1) + __builtin_popcount(p[last] & MaskTo(end & 7));
+}
+
+/* index of the first byte not equal to skip, len if all of them are */
+LKV_TARGET_CLONES("avx2", "default")
+static size_t SkipBytes(const unsigned char *p, size_t len, unsigned char skip) {
+  Block s, w;
+  memset(&s, skip, kBlockBytes);
+  size_t i = 0;
+  for (; i + kBlockBytes <= len; i += kBlockBytes) {
+    memcpy(&w, p + i, kBlockBytes);
+    w ^= s;
+    if ((w[0] | w[1] | w[2] | w[3]) != 0) {
+      break;
+    }
+  }
+  for (; i < len && p[i] == skip; ++i) {
+  }
+  return i;
+}
+
+/* offset of the first bit equals to bit inside byte c limited by mask, -1 if not found */
+static inline int BitPosInByte(unsigned char c, unsigned char mask, int bit) {
+  unsigned int v = (bit ? c : (unsigned char)~c) & mask;
+  return v == 0 ? -1 : __builtin_clz(v) - 24;
+}
+
+int64_t BitPos(const unsigned char *p, size_t len, int bit) {
+  size_t i = SkipBytes(p, len, bit ? 0x00 : 0xFF);
+  if (i == len) {
+    return -1;
+  }
+  return (int64_t)(i << 3) + BitPosInByte(p[i], 0xFF, bit);
+}
+
+int64_t BitPosRange(const unsigned char *p, uint64_t start, uint64_t end, int bit) {
+  uint64_t first = start >> 3, last = end >> 3;
+  if (first == last) {
+    int pos = BitPosInByte(p[first], MaskFrom(start & 7) & MaskTo(end & 7), bit);
+    return pos < 0 ? -1 : (int64_t)(first << 3) + pos;
+  }
+  int pos = BitPosInByte(p[first], MaskFrom(start & 7), bit);
+  if (pos >= 0) {
+    return (int64_t)(first << 3) + pos;
+  }
+  int64_t mid = BitPos(p + first + 1, last - first - 1, bit);
+  if (mid >= 0) {
+    return (int64_t)((first + 1) << 3) + mid;
+  }
+  pos = BitPosInByte(p[last], MaskTo(end & 7), bit);
+  return pos < 0 ? -1 : (int64_t)(last << 3) + pos;
+}
+
+#define BITOP_KERNEL(name, expr)                                               \
+  LKV_TARGET_CLONES("avx2", "default")                                         \
+  static void name(unsigned char *dst, const unsigned char *src, size_t len) { \
+    Block d, s;                                                                \
+    size_t i = 0;                                                              \
+    for (; i + kBlockBytes <= len; i += kBlockBytes) {                         \
+      memcpy(&d, dst + i, kBlockBytes);                                        \
+      memcpy(&s, src + i, kBlockBytes);                                        \
+      d = expr(d, s);                                                          \
+      memcpy(dst + i, &d, kBlockBytes);                                        \
+    }                                                                          \
+    for (; i < len; ++i) {                                                     \
+      dst[i] = (unsigned char)expr(dst[i], src[i]);                            \
+    }                                                                          \
+  }
+
+#define AND_EXPR(a, b) ((a) & (b))
+#define OR_EXPR(a, b) ((a) | (b))
+#define XOR_EXPR(a, b) ((a) ^ (b))
+#define NOT_EXPR(a, b) (~(b))
+
+BITOP_KERNEL(BitAndInto, AND_EXPR)
+BITOP_KERNEL(BitOrInto, OR_EXPR)
+BITOP_KERNEL(BitXorInto, XOR_EXPR)
+BITOP_KERNEL(BitNotInto, NOT_EXPR)
+
+#undef BITOP_KERNEL
+#undef AND_EXPR
+#undef OR_EXPR
+#undef XOR_EXPR
+#undef NOT_EXPR
+
+void BitOp(int op, unsigned char *dst, size_t len, const std::vector<BitmapView> &srcs) {
+  if (srcs.empty()) {
+    memset(dst, 0, len);
+    return;
+  }
+  if (op == BITOP_NOT) {
+    /* bytes past the end of source are zero, so they become 0xFF */
+    memset(dst, 0xFF, len);
+    BitNotInto(dst, srcs[0].first, std::min(len, srcs[0].second));
+    return;
+  }
+  size_t n0 = std::min(len, srcs[0].second);
+  memcpy(dst, srcs[0].first, n0);
+  memset(dst + n0, 0, len - n0);
+  for (size_t i = 1; i < srcs.size(); ++i) {
+    size_t n = std::min(len, srcs[i].second);
+    if (op == BITOP_AND) {
+      BitAndInto(dst, srcs[i].first, n);
+      /* and with the zero padding of a shorter source */
+      memset(dst + n, 0, len - n);
+    } else if (op == BITOP_OR) {
+      BitOrInto(dst, srcs[i].first, n);
+    } else if (op == BITOP_XOR) {
+      BitXorInto(dst, srcs[i].first, n);
+    }
+  }
+}
+
+LKV_TARGET_CLONES("avx2", "default")
+void ByteMax(unsigned char *dst, const unsigned char *src, size_t len) {
+  ByteBlock d, s;
+  size_t i = 0;
+  for (; i + kBlockBytes <= len; i += kBlockBytes) {
+    memcpy(&d, dst + i, kBlockBytes);
+    memcpy(&s, src + i, kBlockBytes);
+    d = d > s ? d : s;
+    memcpy(dst + i, &d, kBlockBytes);
+  }
+  for (; i < len; ++i) {
+    dst[i] = std::max(dst[i], src[i]);
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef __BITOPS_H__
+#define __BITOPS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/* bitmap kernels working on raw bytes, bit 0 is the most significant bit of byte 0 */
+
+static constexpr int BITOP_AND = 0;
+static constexpr int BITOP_OR = 1;
+static constexpr int BITOP_XOR = 2;
+static constexpr int BITOP_NOT = 3;
+
+typedef std::pair<const unsigned char *, size_t> BitmapView;
+
+/* number of set bits in p[0, len) */
+size_t BitCount(const unsigned char *p, size_t len);
+
+/* number of set bits in bit range [start, end] of p, both are valid bit offsets */
+size_t BitCountRange(const unsigned char *p, uint64_t start, uint64_t end);
+
+/* offset of the first bit equals to bit in p[0, len), -1 if not found */
+int64_t BitPos(const unsigned char *p, size_t len, int bit);
+
+/* offset of the first bit equals to bit in bit range [start, end] of p, -1 if not found */
+int64_t BitPosRange(const unsigned char *p, uint64_t start, uint64_t end, int bit);
+
+/**
+ * @brief Perform BITOP_* on srcs and put the result into dst[0, len),
+ * sources shorter than len are taken as zero padded, BITOP_NOT takes the first source only
+ */
+void BitOp(int op, unsigned char *dst, size_t len, const std::vector<BitmapView> &srcs);
+
+/* dst[i] = max(dst[i], src[i]) for i in [0, len) */
+void ByteMax(unsigned char *dst, const unsigned char *src, size_t len);
+
+#endif  // __BITOPS_H__
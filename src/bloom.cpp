@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "bloom.h"
+
+static constexpr uint64_t kBloomHashSeed = 0xc70f6907ULL;
+/* error rate of each new layer is tightened by this ratio */
+static constexpr double kBloomTighteningRatio = 0.5;
+/* probes crowded into one block raise the false positive rate, make up for it with more bits */
+static constexpr double kBloomBlockedBitsFactor = 1.2;
+static constexpr uint32_t kBloomMaxHashes = 32;
+/* error rate, expansion, nonscaling and number of layers */
+static constexpr size_t kBloomHeaderBytes = 8 + 4 + 1 + 4;
+/* capacity, count, number of blocks and number of hashes */
+static constexpr size_t kBloomLayerHeaderBytes = 8 + 8 + 8 + 4;
+
+static inline double BitsPerItem(double error_rate) {
+  return -std::log(error_rate) / (M_LN2 * M_LN2) * kBloomBlockedBitsFactor;
+}
+
+static inline uint64_t NumBlocks(double error_rate, uint64_t capacity) {
+  double bits = std::ceil(capacity * BitsPerItem(error_rate));
+  return std::max<uint64_t>(1, (uint64_t)std::ceil(bits / (kBloomBlockBytes * 8)));
+}
+
+/* murmur3 finalizer, derives the in-block probes from the item hash */
+static inline uint64_t Mix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+BloomFilter::BloomFilter(double error_rate, uint64_t capacity, uint32_t expansion,
+                         bool nonscaling)
+    : error_rate_(error_rate), expansion_(expansion), nonscaling_(nonscaling) {
+  AddLayer(error_rate, capacity);
+}
+
+uint64_t BloomFilter::LayerBytes(double error_rate, uint64_t capacity) {
+  double bits = std::ceil(capacity * BitsPerItem(error_rate));
+  if (bits / 8 > kBloomMaxLayerBytes) {
+    return UINT64_MAX;
+  }
+  return NumBlocks(error_rate, capacity) * kBloomBlockBytes;
+}
+
+bool BloomFilter::AllocateBits(Layer &layer) {
+  void *ptr = nullptr;
+  size_t bytes = layer.n_blocks * kBloomBlockBytes;
+  if (posix_memalign(&ptr, kBloomBlockBytes, bytes) != 0) {
+    return false;
+  }
+  memset(ptr, 0, bytes);
+  layer.bits.reset((uint64_t *)ptr);
+  return true;
+}
+
+bool BloomFilter::AddLayer(double error_rate, uint64_t capacity) {
+  if (LayerBytes(error_rate, capacity) > kBloomMaxLayerBytes) {
+    return false;
+  }
+  Layer layer;
+  layer.capacity = capacity;
+  layer.count = 0;
+  layer.n_blocks = NumBlocks(error_rate, capacity);
+  double bits_per_item = (double)layer.n_blocks * kBloomBlockBytes * 8 / capacity;
+  layer.n_hashes = (uint32_t)std::round(bits_per_item * M_LN2 / kBloomBlockedBitsFactor);
+  layer.n_hashes = std::min(std::max(layer.n_hashes, 1u), kBloomMaxHashes);
+  if (!AllocateBits(layer)) {
+    return false;
+  }
+  layers_.emplace_back(std::move(layer));
+  return true;
+}
+
+/* block of layer where all probes of hash fall into, and the two hashes for probing inside */
+static inline size_t ProbeBlock(uint64_t n_blocks, uint64_t hash, uint32_t &h1, uint32_t &h2) {
+  uint64_t mixed = Mix64(hash);
+  h1 = (uint32_t)mixed;
+  h2 = (uint32_t)(mixed >> 32) | 1;
+  /* the high bits of hash pick the block without division */
+  return (size_t)(((unsigned __int128)hash * n_blocks) >> 64) * kBloomBlockWords;
+}
+
+static inline uint32_t ProbeBit(uint32_t h1, uint32_t h2, uint32_t i) {
+  return (h1 + i * h2) & (kBloomBlockBytes * 8 - 1);
+}
+
+bool BloomFilter::Contains(const Layer &layer, uint64_t hash) {
+  uint32_t h1, h2;
+  const uint64_t *words = layer.bits.get() + ProbeBlock(layer.n_blocks, hash, h1, h2);
+  for (uint32_t i = 0; i < layer.n_hashes; ++i) {
+    uint32_t bit = ProbeBit(h1, h2, i);
+    if ((words[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void BloomFilter::Insert(Layer &layer, uint64_t hash) {
+  uint32_t h1, h2;
+  uint64_t *words = layer.bits.get() + ProbeBlock(layer.n_blocks, hash, h1, h2);
+  for (uint32_t i = 0; i < layer.n_hashes; ++i) {
+    uint32_t bit = ProbeBit(h1, h2, i);
+    words[bit >> 6] |= 1ULL << (bit & 63);
+  }
+  ++layer.count;
+}
+
+int BloomFilter::Add(const std::string &item) {
+  uint64_t hash = MurmurHash64A(item.data(), item.size(), kBloomHashSeed);
+  for (const auto &layer : layers_) {
+    if (Contains(layer, hash)) {
+      return kBloomExists;
+    }
+  }
+  if (layers_.back().count >= layers_.back().capacity) {
+    if (nonscaling_) {
+      return kBloomFull;
+    }
+    double error_rate = error_rate_ * std::pow(kBloomTighteningRatio, layers_.size());
+    if (!AddLayer(error_rate, layers_.back().capacity * expansion_)) {
+      return kBloomFull;
+    }
+  }
+  Insert(layers_.back(), hash);
+  return kBloomAdded;
+}
+
+bool BloomFilter::Exists(const std::string &item) const {
+  uint64_t hash = MurmurHash64A(item.data(), item.size(), kBloomHashSeed);
+  for (const auto &layer : layers_) {
+    if (Contains(layer, hash)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t BloomFilter::Count() const {
+  uint64_t count = 0;
+  for (const auto &layer : layers_) {
+    count += layer.count;
+  }
+  return count;
+}
+
+size_t BloomFilter::DumpSize() const {
+  size_t size = kBloomHeaderBytes;
+  for (const auto &layer : layers_) {
+    size += kBloomLayerHeaderBytes + layer.n_blocks * kBloomBlockBytes;
+  }
+  return size;
+}
+
+void BloomFilter::DumpInto(char *p) const {
+  uint32_t n_layers = layers_.size();
+  memcpy(p, &error_rate_, 8);
+  memcpy(p + 8, &expansion_, 4);
+  p[12] = nonscaling_ ? 1 : 0;
+  memcpy(p + 13, &n_layers, 4);
+  p += kBloomHeaderBytes;
+  for (const auto &layer : layers_) {
+    memcpy(p, &layer.capacity, 8);
+    memcpy(p + 8, &layer.count, 8);
+    memcpy(p + 16, &layer.n_blocks, 8);
+    memcpy(p + 24, &layer.n_hashes, 4);
+    p += kBloomLayerHeaderBytes;
+    memcpy(p, layer.bits.get(), layer.n_blocks * kBloomBlockBytes);
+    p += layer.n_blocks * kBloomBlockBytes;
+  }
+}
+
+std::string BloomFilter::Dump() const {
+  std::string data(DumpSize(), '\0');
+  DumpInto(&data[0]);
+  return data;
+}
+
+bool BloomFilter::Load(const char *data, size_t len) {
+  if (len < kBloomHeaderBytes) {
+    return false;
+  }
+  double error_rate;
+  uint32_t expansion, n_layers;
+  memcpy(&error_rate, data, 8);
+  memcpy(&expansion, data + 8, 4);
+  memcpy(&n_layers, data + 13, 4);
+  if (!(error_rate > 0 && error_rate < 1) || expansion == 0 || n_layers == 0) {
+    return false;
+  }
+  bool nonscaling = data[12] != 0;
+  data += kBloomHeaderBytes;
+  len -= kBloomHeaderBytes;
+  std::vector<Layer> layers;
+  for (uint32_t i = 0; i < n_layers; ++i) {
+    if (len < kBloomLayerHeaderBytes) {
+      return false;
+    }
+    Layer layer;
+    memcpy(&layer.capacity, data, 8);
+    memcpy(&layer.count, data + 8, 8);
+    memcpy(&layer.n_blocks, data + 16, 8);
+    memcpy(&layer.n_hashes, data + 24, 4);
+    data += kBloomLayerHeaderBytes;
+    len -= kBloomLayerHeaderBytes;
+    if (layer.capacity == 0 || layer.n_blocks == 0 ||
+        layer.n_blocks > kBloomMaxLayerBytes / kBloomBlockBytes || layer.n_hashes == 0 ||
+        layer.n_hashes > kBloomMaxHashes || len < layer.n_blocks * kBloomBlockBytes ||
+        !AllocateBits(layer)) {
+      return false;
+    }
+    /* raw bits are copied as they are */
+    memcpy(layer.bits.get(), data, layer.n_blocks * kBloomBlockBytes);
+    data += layer.n_blocks * kBloomBlockBytes;
+    len -= layer.n_blocks * kBloomBlockBytes;
+    layers.emplace_back(std::move(layer));
+  }
+  if (len != 0) {
+    return false;
+  }
+  error_rate_ = error_rate;
+  expansion_ = expansion;
+  nonscaling_ = nonscaling;
+  layers_.swap(layers);
+  return true;
+}
+
+size_t BloomFilter::Serialize(std::vector<char> &buf) const {
+  size_t size = DumpSize();
+  unsigned char enc_buf[10] = {0};
+  uint8_t enc_size = EncodeVarUnsignedInt64(size, enc_buf);
+  buf.insert(buf.end(), enc_buf, enc_buf + enc_size);
+  /* bits are written into buf directly, without a temporary dump */
+  size_t offset = buf.size();
+  buf.resize(offset + size);
+  DumpInto(buf.data() + offset);
+  return buf.size();
+}
@@ -0,0 +1,87 @@
+#ifndef __BLOOM_H__
+#define __BLOOM_H__
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include "serializable.h"
+#include "encoding.h"
+
+static constexpr double kBloomDefaultErrorRate = 0.01;
+static constexpr uint64_t kBloomDefaultCapacity = 100;
+static constexpr uint32_t kBloomDefaultExpansion = 2;
+/* upper limit of bytes of one layer */
+static constexpr uint64_t kBloomMaxLayerBytes = 512ULL << 20;
+/* bits are grouped into blocks of one cache line */
+static constexpr size_t kBloomBlockBytes = 64;
+static constexpr size_t kBloomBlockWords = kBloomBlockBytes / sizeof(uint64_t);
+
+static constexpr int kBloomAdded = 1;
+static constexpr int kBloomExists = 0;
+static constexpr int kBloomFull = -1;
+
+/**
+ * @brief Scalable blocked bloom filter. All probes of one item fall into one 64-byte block, so
+ * a lookup touches one cache line of each layer. When the last layer reaches its capacity, a new
+ * layer expansion times larger with half of the error rate is added, unless it is non-scaling.
+ */
+class BloomFilter : public Serializable {
+public:
+  BloomFilter() = default;
+
+  BloomFilter(double error_rate, uint64_t capacity, uint32_t expansion, bool nonscaling);
+
+  /* bytes needed by the first layer, for checking the arguments before reserving */
+  static uint64_t LayerBytes(double error_rate, uint64_t capacity);
+
+  /* kBloomAdded, kBloomExists or kBloomFull */
+  int Add(const std::string &item);
+
+  bool Exists(const std::string &item) const;
+
+  /* number of items added */
+  uint64_t Count() const;
+
+  inline size_t NumLayers() const { return layers_.size(); }
+
+  /* parameters and layers with their raw bits */
+  std::string Dump() const;
+
+  /* restore from the output of Dump, bits are copied as they are, return false if malformed */
+  bool Load(const char *data, size_t len);
+
+  size_t Serialize(std::vector<char> &buf) const override;
+
+private:
+  struct Layer {
+    uint64_t capacity;
+    uint64_t count;
+    uint64_t n_blocks;
+    uint32_t n_hashes;
+    /* n_blocks * kBloomBlockWords words aligned to cache line */
+    std::unique_ptr<uint64_t, decltype(&free)> bits{nullptr, &free};
+  };
+
+  /* allocate zeroed bits for layer, false if out of memory */
+  static bool AllocateBits(Layer &layer);
+
+  bool AddLayer(double error_rate, uint64_t capacity);
+
+  static bool Contains(const Layer &layer, uint64_t hash);
+
+  static void Insert(Layer &layer, uint64_t hash);
+
+  size_t DumpSize() const;
+
+  void DumpInto(char *p) const;
+
+private:
+  double error_rate_ = kBloomDefaultErrorRate;
+  uint32_t expansion_ = kBloomDefaultExpansion;
+  bool nonscaling_ = false;
+  std::vector<Layer> layers_;
+};
+
+#endif  // __BLOOM_H__
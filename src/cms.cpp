@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include "cms.h"
+
+static constexpr uint64_t kCMSHashSeed = 0x9747b28cULL;
+/* width, depth and total count */
+static constexpr size_t kCMSHeaderBytes = 4 + 4 + 8;
+
+static inline uint32_t SaturatedAdd(uint32_t a, uint64_t b) {
+  uint64_t sum = a + b;
+  return sum > UINT32_MAX ? UINT32_MAX : (uint32_t)sum;
+}
+
+CountMinSketch::CountMinSketch(uint32_t width, uint32_t depth)
+    : width_(width), depth_(depth), counters_((size_t)width * depth, 0) {}
+
+void CountMinSketch::HashItems(const std::vector<std::string> &items, std::vector<uint64_t> &h1,
+                               std::vector<uint64_t> &h2) const {
+  h1.resize(items.size());
+  h2.resize(items.size());
+  for (size_t i = 0; i < items.size(); ++i) {
+    uint64_t hash = MurmurHash64A(items[i].data(), items[i].size(), kCMSHashSeed);
+    h1[i] = hash & UINT32_MAX;
+    h2[i] = hash >> 32;
+  }
+}
+
+std::vector<uint32_t> CountMinSketch::IncrBy(const std::vector<std::string> &items,
+                                             const std::vector<uint32_t> &increments) {
+  std::vector<uint64_t> h1, h2;
+  HashItems(items, h1, h2);
+  std::vector<uint32_t> counts(items.size(), UINT32_MAX);
+  /* one row at a time, so that a row stays in cache for the whole batch,
+   * an item appearing twice in the batch still sees the count right after its own increment */
+  for (uint32_t row = 0; row < depth_; ++row) {
+    uint32_t *counters = counters_.data() + (size_t)row * width_;
+    for (size_t i = 0; i < items.size(); ++i) {
+      uint32_t &counter = counters[(h1[i] + row * h2[i]) % width_];
+      counter = SaturatedAdd(counter, increments[i]);
+      counts[i] = std::min(counts[i], counter);
+    }
+  }
+  for (uint32_t increment : increments) {
+    total_ += increment;
+  }
+  return counts;
+}
+
+std::vector<uint32_t> CountMinSketch::Query(const std::vector<std::string> &items) const {
+  std::vector<uint64_t> h1, h2;
+  HashItems(items, h1, h2);
+  std::vector<uint32_t> counts(items.size(), UINT32_MAX);
+  for (uint32_t row = 0; row < depth_; ++row) {
+    const uint32_t *counters = counters_.data() + (size_t)row * width_;
+    for (size_t i = 0; i < items.size(); ++i) {
+      counts[i] = std::min(counts[i], counters[(h1[i] + row * h2[i]) % width_]);
+    }
+  }
+  return counts;
+}
+
+void CountMinSketch::MergeFrom(const CountMinSketch &other, uint32_t weight) {
+  const uint32_t *src = other.counters_.data();
+  uint32_t *dst = counters_.data();
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    dst[i] = SaturatedAdd(dst[i], (uint64_t)src[i] * weight);
+  }
+  total_ += other.total_ * weight;
+}
+
+std::string CountMinSketch::Dump() const {
+  std::string data(kCMSHeaderBytes + counters_.size() * sizeof(uint32_t), '\0');
+  char *p = &data[0];
+  memcpy(p, &width_, 4);
+  memcpy(p + 4, &depth_, 4);
+  memcpy(p + 8, &total_, 8);
+  if (!counters_.empty()) {
+    memcpy(p + kCMSHeaderBytes, counters_.data(), counters_.size() * sizeof(uint32_t));
+  }
+  return data;
+}
+
+bool CountMinSketch::Load(const char *data, size_t len) {
+  if (len < kCMSHeaderBytes) {
+    return false;
+  }
+  uint32_t width, depth;
+  memcpy(&width, data, 4);
+  memcpy(&depth, data + 4, 4);
+  uint64_t n = (uint64_t)width * depth;
+  if (width == 0 || depth == 0 || n > kCMSMaxCounters ||
+      len != kCMSHeaderBytes + n * sizeof(uint32_t)) {
+    return false;
+  }
+  width_ = width;
+  depth_ = depth;
+  memcpy(&total_, data + 8, 8);
+  counters_.resize(n);
+  memcpy(counters_.data(), data + kCMSHeaderBytes, n * sizeof(uint32_t));
+  return true;
+}
+
+size_t CountMinSketch::Serialize(std::vector<char> &buf) const {
+  std::string data = Dump();
+  unsigned char enc_buf[10] = {0};
+  uint8_t enc_size = EncodeVarUnsignedInt64(data.size(), enc_buf);
+  buf.insert(buf.end(), enc_buf, enc_buf + enc_size);
+  buf.insert(buf.end(), data.begin(), data.end());
+  return buf.size();
+}
@@ -0,0 +1,66 @@
+#ifndef __CMS_H__
+#define __CMS_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "serializable.h"
+#include "encoding.h"
+
+/* upper limit of width * depth, which takes 512MB */
+static constexpr uint64_t kCMSMaxCounters = 1ULL << 27;
+
+/**
+ * @brief Count-Min Sketch with depth rows of width counters, all counters are kept in one flat
+ * array row by row. The estimated count of an item is never less than the real one.
+ */
+class CountMinSketch : public Serializable {
+public:
+  CountMinSketch() = default;
+
+  CountMinSketch(uint32_t width, uint32_t depth);
+
+  inline uint32_t Width() const { return width_; }
+
+  inline uint32_t Depth() const { return depth_; }
+
+  /* sum of all increments */
+  inline uint64_t Total() const { return total_; }
+
+  /**
+   * @brief Increase items by increments, items[i] is increased by increments[i].
+   * The whole batch is hashed first and then counters are updated row by row.
+   *
+   * @return estimated counts of items after increment
+   */
+  std::vector<uint32_t> IncrBy(const std::vector<std::string> &items,
+                               const std::vector<uint32_t> &increments);
+
+  /* estimated counts of items */
+  std::vector<uint32_t> Query(const std::vector<std::string> &items) const;
+
+  /* counters += weight * counters of other, dimensions must be the same */
+  void MergeFrom(const CountMinSketch &other, uint32_t weight);
+
+  /* width, depth, total count and then all counters */
+  std::string Dump() const;
+
+  /* restore from the output of Dump, return false if data is malformed */
+  bool Load(const char *data, size_t len);
+
+  size_t Serialize(std::vector<char> &buf) const override;
+
+private:
+  /* column of item in every row is h1 + row * h2 */
+  void HashItems(const std::vector<std::string> &items, std::vector<uint64_t> &h1,
+                 std::vector<uint64_t> &h2) const;
+
+private:
+  uint32_t width_ = 0;
+  uint32_t depth_ = 0;
+  uint64_t total_ = 0;
+  /* depth_ * width_ saturated counters */
+  std::vector<uint32_t> counters_;
+};
+
+#endif  // __CMS_H__
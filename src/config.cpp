@@ -172,9 +172,69 @@ void Config::Init(std::unordered_map<std::string, std::string> &configs) {
       }
       keepalive_cnt_ = cnt;
       DISPLAY_CONFIG(key, keepalive_cnt_);
+    } else if (key == "io-threads") {
+      int n = CONFIG_DEFAULT_IO_THREADS;
+      if (!CanConvertToInt32(value, n)) {
+        DISPLAY_INVALID_WARN(key, CONFIG_DEFAULT_IO_THREADS);
+      }
+      if (n < 1 || n > CONFIG_MAX_IO_THREADS) {
+        std::cerr << "[SERVER CONFIG WARN] io-threads must be in [1, " << CONFIG_MAX_IO_THREADS
+                  << "]. Value of " << n << " will be treated as default value "
+                  << CONFIG_DEFAULT_IO_THREADS << '\n';
+        n = CONFIG_DEFAULT_IO_THREADS;
+      }
+      io_threads_ = n;
+      DISPLAY_CONFIG(key, io_threads_);
+    } else if (key == "reactors") {
+      int n = CONFIG_DEFAULT_REACTORS;
+      if (!CanConvertToInt32(value, n)) {
+        DISPLAY_INVALID_WARN(key, CONFIG_DEFAULT_REACTORS);
+      }
+      if (n < 1 || n > CONFIG_MAX_REACTORS) {
+        std::cerr << "[SERVER CONFIG WARN] reactors must be in [1, " << CONFIG_MAX_REACTORS
+                  << "]. Value of " << n << " will be treated as default value "
+                  << CONFIG_DEFAULT_REACTORS << '\n';
+        n = CONFIG_DEFAULT_REACTORS;
+      }
+      reactors_ = n;
+      DISPLAY_CONFIG(key, reactors_);
+    } else if (key == "zerocopy-threshold") {
+      if (!CanConvertToUInt64(value, zerocopy_threshold_)) {
+        DISPLAY_INVALID_WARN(key, CONFIG_DEFAULT_ZEROCOPY_THRESHOLD);
+        zerocopy_threshold_ = CONFIG_DEFAULT_ZEROCOPY_THRESHOLD;
+      }
+      DISPLAY_CONFIG(key, zerocopy_threshold_);
+    } else if (key == "event-backend") {
+      if (value == "io_uring") {
+        uring_enabled_ = true;
+      } else if (value == "epoll") {
+        uring_enabled_ = false;
+      } else {
+        std::cerr << "[SERVER CONFIG WARN] event-backend must be epoll or io_uring. Value of " << value
+                  << " will be treated as epoll\n";
+        uring_enabled_ = false;
+      }
+      DISPLAY_CONFIG(key, value);
+    } else if (key == "io-uring-sqpoll") {
+      int b = 0;
+      if (!CanConvertToInt32(value, b)) {
+        DISPLAY_INVALID_WARN(key, CONFIG_DEFAULT_URING_SQPOLL);
+      }
+      uring_sqpoll_ = b != 0;
+      DISPLAY_CONFIG(key, uring_sqpoll_);
     } else {
       std::cout << "[SERVER CONFIG WARN] Config item [" << key
                 << "] not recognized, skip..\n";
     }
   }
+  if (reactors_ > 1 && io_threads_ > 1) {
+    /* every reactor thread does its own io */
+    std::cerr << "[SERVER CONFIG WARN] io-threads is ignored with more than one reactor\n";
+    io_threads_ = 1;
+  }
+  if (uring_enabled_ && io_threads_ > 1) {
+    /* io threads read and write sockets by themselves */
+    std::cerr << "[SERVER CONFIG WARN] event-backend io_uring is ignored with io-threads larger than 1\n";
+    uring_enabled_ = false;
+  }
 }
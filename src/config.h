@@ -23,6 +23,17 @@
 #define CONFIG_DEFAULT_KEEPALIVE_INTERVAL 100 /* unit: second */
 #define CONFIG_DEFAULT_KEEPALIVE_CNT 3
 
+#define CONFIG_DEFAULT_IO_THREADS 1 /* only the main thread */
+#define CONFIG_MAX_IO_THREADS 128
+
+#define CONFIG_DEFAULT_REACTORS 1 /* one event loop owning the whole keyspace */
+#define CONFIG_MAX_REACTORS 128
+
+#define CONFIG_DEFAULT_ZEROCOPY_THRESHOLD 0 /* never use MSG_ZEROCOPY */
+
+#define CONFIG_DEFAULT_URING_ENABLED false /* event loops wait with epoll */
+#define CONFIG_DEFAULT_URING_SQPOLL false
+
 class Config {
 public:
   explicit Config(std::string filename);
@@ -53,6 +64,16 @@ public:
 
   inline int KeepAliveCnt() const { return keepalive_cnt_; }
 
+  inline int NumIOThreads() const { return io_threads_; }
+
+  inline int NumReactors() const { return reactors_; }
+
+  inline size_t ZeroCopyThreshold() const { return zerocopy_threshold_; }
+
+  inline bool UringEnabled() const { return uring_enabled_; }
+
+  inline bool UringSqPoll() const { return uring_sqpoll_; }
+
 private:
   void Init(std::unordered_map<std::string, std::string>& configs);
 
@@ -74,6 +95,15 @@ private:
 
   int keepalive_interval_ = CONFIG_DEFAULT_KEEPALIVE_INTERVAL;
   int keepalive_cnt_ = CONFIG_DEFAULT_KEEPALIVE_CNT;
+
+  int io_threads_ = CONFIG_DEFAULT_IO_THREADS;
+
+  int reactors_ = CONFIG_DEFAULT_REACTORS;
+
+  size_t zerocopy_threshold_ = CONFIG_DEFAULT_ZEROCOPY_THRESHOLD;
+
+  bool uring_enabled_ = CONFIG_DEFAULT_URING_ENABLED;
+  bool uring_sqpoll_ = CONFIG_DEFAULT_URING_SQPOLL;
 };
 
 #endif // __CONFIG_H__
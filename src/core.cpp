@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cmath>
 #include <sstream>
 #include <random>
 #include <algorithm>
@@ -65,11 +66,35 @@ static double RandDoubleValue(double from, double to) {
 #define UpdateLastVisitTime(key) \
   bucket.content[key]->lv_time = GetCurrentMs()
 
+/**
+ * A string pinned by replies which are still sending it must not be changed, so the key gets a new
+ * value object to change in place and the pinned one is freed with its last pin. The new object
+ * holds a copy of the string if keep_content, or nothing if the caller overwrites it anyway.
+ */
+static void UnpinForWrite(ValueObjectPtr &value, bool keep_content) {
+  if (value->pins == 0) {
+    return;
+  }
+  auto unpinned = std::make_shared<ValueObject>(OBJECT_INT, nullptr);
+  if (keep_content && value->type == OBJECT_STRING) {
+    unpinned->type = OBJECT_STRING;
+    unpinned->ptr = new DynamicString(*reinterpret_cast<DynamicString *>(value->ptr));
+  }
+  unpinned->lv_time = value->lv_time;
+  value = unpinned;
+}
+
+/* delete fields of hash at key which are past their expiration */
+#define ReclaimExpiredFields(key) \
+  RetrievePtr(key, HashDict)->ExpireKeys(GetCurrentMs())
+
 std::vector<DynamicString> KVContainer::Overview() const {
   /* make statistic */
   LockGuard lck(mtx_);
-  size_t n_int = 0, n_str = 0, n_list = 0, n_dict = 0, n_set = 0;
-  size_t n_list_elem = 0, n_dict_entry = 0, n_set_mem = 0;
+  size_t n_int = 0, n_str = 0, n_list = 0, n_dict = 0, n_set = 0, n_zset = 0, n_hll = 0;
+  size_t n_cms = 0, n_topk = 0, n_bloom = 0, n_stream = 0, n_stream_entry = 0;
+  size_t n_ts = 0, n_ts_sample = 0, n_vset = 0, n_vset_elem = 0;
+  size_t n_list_elem = 0, n_dict_entry = 0, n_set_mem = 0, n_zset_mem = 0;
   for (const auto &bucket : bucket_) {
     for (const auto &item : bucket.content) {
       if (item.second->type == OBJECT_INT) {
@@ -87,6 +112,26 @@ std::vector<DynamicString> KVContainer::Overview() const {
       } else if (item.second->type == OBJECT_SET) {
         ++n_set;
         n_set_mem += ((HashSet*)(item.second->ptr))->Count();
+      } else if (item.second->type == OBJECT_ZSET) {
+        ++n_zset;
+        n_zset_mem += ((ZSet*)(item.second->ptr))->Count();
+      } else if (item.second->type == OBJECT_HLL) {
+        ++n_hll;
+      } else if (item.second->type == OBJECT_CMS) {
+        ++n_cms;
+      } else if (item.second->type == OBJECT_TOPK) {
+        ++n_topk;
+      } else if (item.second->type == OBJECT_BLOOM) {
+        ++n_bloom;
+      } else if (item.second->type == OBJECT_STREAM) {
+        ++n_stream;
+        n_stream_entry += ((Stream *)(item.second->ptr))->Length();
+      } else if (item.second->type == OBJECT_TS) {
+        ++n_ts;
+        n_ts_sample += ((TimeSeries *)(item.second->ptr))->Length();
+      } else if (item.second->type == OBJECT_VSET) {
+        ++n_vset;
+        n_vset_elem += ((VectorSet *)(item.second->ptr))->Count();
       }
     }
   }
@@ -95,7 +140,15 @@ std::vector<DynamicString> KVContainer::Overview() const {
      << "\tNumber of string: " << n_str
      << "\tNumber of list: " << n_list << ", total elements: " << n_list_elem
      << "\tNumber of hash: " << n_dict << ", total entries: " << n_dict_entry
-     << "\tNumber of set: " << n_set << ", total entries: " << n_set_mem;
+     << "\tNumber of set: " << n_set << ", total entries: " << n_set_mem
+     << "\tNumber of zset: " << n_zset << ", total entries: " << n_zset_mem
+     << "\tNumber of hyperloglog: " << n_hll
+     << "\tNumber of count-min sketch: " << n_cms
+     << "\tNumber of top-k: " << n_topk
+     << "\tNumber of bloom filter: " << n_bloom
+     << "\tNumber of stream: " << n_stream << ", total entries: " << n_stream_entry
+     << "\tNumber of time series: " << n_ts << ", total samples: " << n_ts_sample
+     << "\tNumber of vector set: " << n_vset << ", total elements: " << n_vset_elem;
   std::vector<DynamicString> overview;
   overview.emplace_back("Number of int:");
   overview.emplace_back(std::to_string(n_int));
@@ -113,6 +166,30 @@ std::vector<DynamicString> KVContainer::Overview() const {
   overview.emplace_back(std::to_string(n_set));
   overview.emplace_back("Number of elements in set:");
   overview.emplace_back(std::to_string(n_set_mem));
+  overview.emplace_back("Number of zset:");
+  overview.emplace_back(std::to_string(n_zset));
+  overview.emplace_back("Number of elements in zset:");
+  overview.emplace_back(std::to_string(n_zset_mem));
+  overview.emplace_back("Number of hyperloglog:");
+  overview.emplace_back(std::to_string(n_hll));
+  overview.emplace_back("Number of count-min sketch:");
+  overview.emplace_back(std::to_string(n_cms));
+  overview.emplace_back("Number of top-k:");
+  overview.emplace_back(std::to_string(n_topk));
+  overview.emplace_back("Number of bloom filter:");
+  overview.emplace_back(std::to_string(n_bloom));
+  overview.emplace_back("Number of stream:");
+  overview.emplace_back(std::to_string(n_stream));
+  overview.emplace_back("Number of stream entries:");
+  overview.emplace_back(std::to_string(n_stream_entry));
+  overview.emplace_back("Number of time series:");
+  overview.emplace_back(std::to_string(n_ts));
+  overview.emplace_back("Number of time series samples:");
+  overview.emplace_back(std::to_string(n_ts_sample));
+  overview.emplace_back("Number of vector set:");
+  overview.emplace_back(std::to_string(n_vset));
+  overview.emplace_back("Number of elements in vector set:");
+  overview.emplace_back(std::to_string(n_vset_elem));
   return overview;
 }
 
@@ -265,6 +342,31 @@ std::vector<std::string> KVContainer::RecoverCommandFromValue(const std::string
     std::vector<std::string> ret = {"sadd", key};
     ret.insert(ret.end(), entries_str.begin(), entries_str.end());
     return ret;
+  } else if (k_type == OBJECT_ZSET) {
+    /* zadd */
+    ZSet *p_zset = RetrievePtr(k, ZSet);
+    std::vector<std::string> ret = {"zadd", key};
+    ret.reserve(p_zset->Count() * 2 + 2);
+    for (const auto &item : p_zset->RangeByRank(0, p_zset->Count())) {
+      ret.emplace_back(std::to_string(item.second));
+      ret.emplace_back(item.first.ToStdString());
+    }
+    return ret;
+  } else if (k_type == OBJECT_HLL) {
+    /* pfrestore with the dumped registers */
+    return {"pfrestore", key, RetrievePtr(k, HyperLogLog)->Dump()};
+  } else if (k_type == OBJECT_CMS) {
+    return {"cms.restore", key, RetrievePtr(k, CountMinSketch)->Dump()};
+  } else if (k_type == OBJECT_TOPK) {
+    return {"topk.restore", key, RetrievePtr(k, TopK)->Dump()};
+  } else if (k_type == OBJECT_BLOOM) {
+    return {"bf.restore", key, RetrievePtr(k, BloomFilter)->Dump()};
+  } else if (k_type == OBJECT_STREAM) {
+    return {"xrestore", key, RetrievePtr(k, Stream)->Dump()};
+  } else if (k_type == OBJECT_TS) {
+    return {"ts.restore", key, RetrievePtr(k, TimeSeries)->Dump()};
+  } else if (k_type == OBJECT_VSET) {
+    return {"vrestore", key, RetrievePtr(k, VectorSet)->Dump()};
   }
   errcode = kFailCode;
   return {};
@@ -283,6 +385,7 @@ bool KVContainer::SetInt(const Key &key, int64_t intval) {
     bucket.content[key] = iptr;
     keys_pool_.emplace_back(bucket.content.find(key)->first);
   } else {
+    UnpinForWrite(bucket.content[key], false);
     // check existing key is type int
     if (bucket.content[key]->type != OBJECT_INT) {
       // delete old value and replace it with new intval
@@ -358,7 +461,7 @@ int64_t KVContainer::DecrIntBy(const Key &key, int64_t decrement, int &errcode)
   }
 }
 
-bool KVContainer::SetString(const Key &key, const std::string &value) {
+bool KVContainer::SetString(const Key &key, const StringView &value) {
   // get bucket
   GetBucketAndLock(key);
   if (KeyNotFoundInBucket(key)) {
@@ -370,17 +473,18 @@ bool KVContainer::SetString(const Key &key, const std::string &value) {
     bucket.content[key] = sptr;
     keys_pool_.emplace_back(bucket.content.find(key)->first);
   } else {
+    UnpinForWrite(bucket.content[key], false);
     // check existing key is type string
     auto type = bucket.content[key]->type;
     if (type == OBJECT_STRING) {
       /* override existing string object */
-      RetrievePtr(key, DynamicString)->Reset(value);
-    } else if (type == OBJECT_LIST || type == OBJECT_HASH || type == OBJECT_SET) {
+      RetrievePtr(key, DynamicString)->Reset(value.data(), value.size());
+    } else if (type != OBJECT_INT) {
       bucket.content[key]->FreePtr();
     }
-    if (type == OBJECT_INT || type == OBJECT_LIST || type == OBJECT_HASH || type == OBJECT_SET) {
+    if (type != OBJECT_STRING) {
       /* construct a new dynamic string object */
-      DynamicString *dsptr = new(std::nothrow) DynamicString(value);
+      DynamicString *dsptr = new(std::nothrow) DynamicString(value.data(), value.size());
       if (dsptr == nullptr) {
         return false;
       }
@@ -405,7 +509,7 @@ size_t KVContainer::StrLen(const Key &key, int &errcode) {
     errcode = kOkCode;
     return RetrievePtr(key, DynamicString)->Length();
   }
-  errcode == kWrongTypeCode;
+  errcode = kWrongTypeCode;
   return 0;
 }
 
@@ -419,8 +523,8 @@ ValueObjectPtr KVContainer::Get(const Key &key, int &errcode) {
   return bucket.content[key];
 }
 
-ValueObjectPtr KVContainer::Get(const std::string &key, int &errcode) {
-  return Get(Key(key), errcode);
+ValueObjectPtr KVContainer::Get(const StringView &key, int &errcode) {
+  return Get(Key::Borrow(key), errcode);
 }
 
 bool KVContainer::Delete(const Key &key) {
@@ -447,7 +551,7 @@ int KVContainer::Delete(const std::vector<std::string> &keys) {
   return n;
 }
 
-size_t KVContainer::Append(const Key &key, const std::string &val, int &errcode) {
+size_t KVContainer::Append(const Key &key, const StringView &val, int &errcode) {
   GetBucketAndLock(key);
   // IfKeyNotFoundThenReturn(key, false);
   /* append to a non-existing will this key as string type */
@@ -463,13 +567,14 @@ size_t KVContainer::Append(const Key &key, const std::string &val, int &errcode)
   } else {
     /* key exists */
     if (bucket.content[key]->type == OBJECT_STRING) {
-      ((DynamicString *) bucket.content[key]->ptr)->Append(val);
+      UnpinForWrite(bucket.content[key], true);
+      ((DynamicString *) bucket.content[key]->ptr)->Append(val.data(), val.size());
     } else if (bucket.content[key]->type == OBJECT_INT) {
       /* append operation will make int turn to string */
       int64_t num = bucket.content[key]->ToInt64();
       DynamicString *dsptr = new(std::nothrow) DynamicString(std::to_string(num));
       if (dsptr == nullptr) return 0;
-      dsptr->Append(val);
+      dsptr->Append(val.data(), val.size());
       /* change value object */
       bucket.content[key]->ptr = dsptr;
       bucket.content[key]->type = OBJECT_STRING;
@@ -483,20 +588,229 @@ size_t KVContainer::Append(const Key &key, const std::string &val, int &errcode)
   return RetrievePtr(key, DynamicString)->Length();
 }
 
+const DynamicString *KVContainer::LookupStringForRead(const Key &key, DynamicString &tmp,
+                                                     int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, nullptr);
+  IfKeyNeitherTypeThenReturn(key, OBJECT_INT, OBJECT_STRING, nullptr);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  if (bucket.content[key]->type == OBJECT_INT) {
+    tmp.Reset(std::to_string(bucket.content[key]->ToInt64()));
+    return &tmp;
+  }
+  return RetrievePtr(key, DynamicString);
+}
+
+DynamicString *KVContainer::LookupStringForWrite(const Key &key, int &errcode) {
+  GetBucketAndLock(key);
+  errcode = kFailCode;
+  if (KeyNotFoundInBucket(key)) {
+    ValueObjectPtr sptr = ConstructStrObjPtr("");
+    if (!sptr) {
+      return nullptr;
+    }
+    bucket.content[key] = sptr;
+    keys_pool_.emplace_back(bucket.content.find(key)->first);
+  } else {
+    IfKeyNeitherTypeThenReturn(key, OBJECT_INT, OBJECT_STRING, nullptr);
+    UnpinForWrite(bucket.content[key], true);
+    if (bucket.content[key]->type == OBJECT_INT) {
+      /* modification in place makes int turn to string */
+      int64_t num = bucket.content[key]->ToInt64();
+      DynamicString *dsptr = new(std::nothrow) DynamicString(std::to_string(num));
+      if (dsptr == nullptr) {
+        return nullptr;
+      }
+      bucket.content[key]->ptr = dsptr;
+      bucket.content[key]->type = OBJECT_STRING;
+    }
+    UpdateLastVisitTime(key);
+  }
+  errcode = kOkCode;
+  return RetrievePtr(key, DynamicString);
+}
+
+/* turn [start, end] with negative index into range inside [0, total), return false if empty */
+static bool NormalizeRange(int64_t &start, int64_t &end, int64_t total) {
+  if (start < 0) {
+    start = std::max<int64_t>(start + total, 0);
+  }
+  if (end < 0) {
+    end = std::max<int64_t>(end + total, 0);
+  }
+  if (end >= total) {
+    end = total - 1;
+  }
+  return total > 0 && start <= end;
+}
+
+std::string KVContainer::GetRange(const Key &key, int64_t start, int64_t end, int &errcode) {
+  DynamicString tmp;
+  const DynamicString *str = LookupStringForRead(key, tmp, errcode);
+  if (str == nullptr || !NormalizeRange(start, end, str->Length())) {
+    return "";
+  }
+  return std::string(str->Data() + start, end - start + 1);
+}
+
+size_t KVContainer::SetRange(const Key &key, uint32_t offset, const std::string &value,
+                             int &errcode) {
+  if (value.empty()) {
+    /* nothing to write, do not create key */
+    return StrLen(key, errcode);
+  }
+  DynamicString *str = LookupStringForWrite(key, errcode);
+  if (str == nullptr) {
+    return 0;
+  }
+  str->SetRange(offset, value.data(), value.size());
+  if (str->Length() < offset + value.size()) {
+    errcode = kFailCode;
+  }
+  return str->Length();
+}
+
+int KVContainer::SetBit(const Key &key, uint64_t offset, int bit, int &errcode) {
+  DynamicString *str = LookupStringForWrite(key, errcode);
+  if (str == nullptr) {
+    return 0;
+  }
+  uint32_t byte = offset >> 3;
+  if (byte >= str->Length()) {
+    str->Resize(byte + 1);
+    if (byte >= str->Length()) {
+      errcode = kFailCode;
+      return 0;
+    }
+  }
+  unsigned char mask = 1 << (7 - (offset & 7));
+  char &c = str->MutableData()[byte];
+  int original = (c & mask) != 0;
+  c = bit ? (c | mask) : (c & ~mask);
+  return original;
+}
+
+int KVContainer::GetBit(const Key &key, uint64_t offset, int &errcode) {
+  DynamicString tmp;
+  const DynamicString *str = LookupStringForRead(key, tmp, errcode);
+  if (str == nullptr || (offset >> 3) >= str->Length()) {
+    return 0;
+  }
+  return (str->Data()[offset >> 3] >> (7 - (offset & 7))) & 1;
+}
+
+size_t KVContainer::BitCount(const Key &key, int64_t start, int64_t end, bool bit_unit,
+                             int &errcode) {
+  DynamicString tmp;
+  const DynamicString *str = LookupStringForRead(key, tmp, errcode);
+  if (str == nullptr) {
+    return 0;
+  }
+  int64_t total = bit_unit ? (int64_t)str->Length() * 8 : str->Length();
+  if (!NormalizeRange(start, end, total)) {
+    return 0;
+  }
+  const unsigned char *p = (const unsigned char *)str->Data();
+  if (bit_unit) {
+    return BitCountRange(p, start, end);
+  }
+  return ::BitCount(p + start, end - start + 1);
+}
+
+int64_t KVContainer::BitPos(const Key &key, int bit, int64_t start, int64_t end, bool end_given,
+                            bool bit_unit, int &errcode) {
+  DynamicString tmp;
+  const DynamicString *str = LookupStringForRead(key, tmp, errcode);
+  if (str == nullptr) {
+    /* missing key is taken as an infinite string of zeros */
+    return bit ? -1 : 0;
+  }
+  int64_t total = bit_unit ? (int64_t)str->Length() * 8 : str->Length();
+  if (!NormalizeRange(start, end, total)) {
+    return -1;
+  }
+  const unsigned char *p = (const unsigned char *)str->Data();
+  int64_t pos;
+  if (bit_unit) {
+    pos = BitPosRange(p, start, end, bit);
+  } else {
+    pos = ::BitPos(p + start, end - start + 1, bit);
+    pos = pos < 0 ? -1 : pos + start * 8;
+  }
+  if (pos < 0 && bit == 0 && !end_given) {
+    /* the string is taken as zero padded on the right */
+    return (bit_unit ? end + 1 : (end + 1) * 8);
+  }
+  return pos;
+}
+
+size_t KVContainer::BitOp(int op, const Key &dst, const std::vector<std::string> &keys,
+                          int &errcode) {
+  static const char kEmpty[1] = {0};
+  /* int values are formatted into tmps, which must not be relocated */
+  std::vector<DynamicString> tmps(keys.size());
+  std::vector<BitmapView> srcs;
+  size_t len = 0;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const DynamicString *str = LookupStringForRead(Key(keys[i]), tmps[i], errcode);
+    if (errcode == kWrongTypeCode) {
+      return 0;
+    }
+    if (str == nullptr) {
+      srcs.emplace_back((const unsigned char *)kEmpty, 0);
+    } else {
+      srcs.emplace_back((const unsigned char *)str->Data(), str->Length());
+      len = std::max<size_t>(len, str->Length());
+    }
+  }
+  errcode = kOkCode;
+  if (len == 0) {
+    Delete(dst);
+    return 0;
+  }
+  /* dst may be one of the sources, so build the result aside first */
+  DynamicString *result = new (std::nothrow) DynamicString;
+  if (result == nullptr) {
+    errcode = kFailCode;
+    return 0;
+  }
+  result->Resize(len);
+  if (result->Length() != len) {
+    delete result;
+    errcode = kFailCode;
+    return 0;
+  }
+  ::BitOp(op, (unsigned char *)result->MutableData(), len, srcs);
+  GetBucketAndLock(dst);
+  if (KeyNotFoundInBucket(dst)) {
+    bucket.content[dst] = std::make_shared<ValueObject>(OBJECT_STRING, (void *)result);
+    keys_pool_.emplace_back(bucket.content.find(dst)->first);
+  } else {
+    /* overwrite dst no matter what type it holds */
+    UnpinForWrite(bucket.content[dst], false);
+    bucket.content[dst]->FreePtr();
+    bucket.content[dst]->type = OBJECT_STRING;
+    bucket.content[dst]->ptr = result;
+    UpdateLastVisitTime(dst);
+  }
+  return len;
+}
+
 bool KVContainer::LeftPush(const Key &key, const std::string &val, int &errcode) {
   return ListPushAux(key, val, true, errcode);
 }
 
-size_t KVContainer::LeftPush(const std::string &key, const std::vector<std::string> &values, int &errcode) {
-  return ListPushAux(Key(key), values, true, errcode);
+size_t KVContainer::LeftPush(const StringView &key, const std::vector<std::string> &values, int &errcode) {
+  return ListPushAux(Key::Borrow(key), values, true, errcode);
 }
 
 bool KVContainer::RightPush(const Key &key, const std::string &val, int &errcode) {
   return ListPushAux(key, val, false, errcode);
 }
 
-size_t KVContainer::RightPush(const std::string &key, const std::vector<std::string> &values, int &errcode) {
-  return ListPushAux(Key(key), values, false, errcode);
+size_t KVContainer::RightPush(const StringView &key, const std::vector<std::string> &values, int &errcode) {
+  return ListPushAux(Key::Borrow(key), values, false, errcode);
 }
 
 #define ListPushAuxCommon(key)                                \
@@ -575,7 +889,7 @@ DynamicString KVContainer::ListPopAux(const Key &key, bool leftpop, int &errcode
   }                                                                            \
   errcode = kOkCode;                                                           \
   /* handle negative index out of range */                                     \
-  if (begin < 0 && end > 0) {                                                  \
+  if (begin < 0 && end >= 0) {                                                 \
     begin = 0;                                                                 \
   } else if ((begin > 0 && end < 0) || (begin < 0 && end < 0)) {               \
     return {};                                                                 \
@@ -587,6 +901,19 @@ std::vector<DynamicString> KVContainer::ListRange(const Key &key, int begin, int
   return RetrievePtr(key, DList)->RangeAsDynaStringVector(begin, end);
 }
 
+size_t KVContainer::ListRange(const Key &key, int begin, int end,
+                              const std::function<void(size_t)> &size,
+                              const std::function<void(const DynamicString &)> &emit,
+                              int &errcode) {
+  ListRangeCommonOperation;
+  size_t n = list->RangeLength(begin, end);
+  if (n > 0) {
+    size(n);
+    list->ForEachInRange(begin, end, emit);
+  }
+  return n;
+}
+
 std::vector<std::string> KVContainer::ListRangeAsStdString(const Key &key, int begin, int end, int &errcode) {
   ListRangeCommonOperation;
   return RetrievePtr(key, DList)->RangeAsStdStringVector(begin, end);
@@ -608,19 +935,11 @@ DynamicString KVContainer::ListItemAtIndex(const Key &key, int index, int &errco
   IfKeyNotFoundThenReturn(key, DynamicString());
   IfKeyNotTypeThenReturn(key, OBJECT_LIST, DynamicString());
   DList *list = (DList *)(bucket.content[key]->ptr);
-  /* support negative index */
-  int list_len = (int) list->Length();
-  if (index < 0) {
-    index = index + list_len;
-  }
-  if (index < 0) {
-    errcode = kFailCode;
-    return DynamicString();
-  }
   try {
+    /* negative index is resolved from the tail */
     UpdateLastVisitTime(key);
     errcode = kOkCode;
-    return DynamicString(list->operator[](index));
+    return DynamicString(list->At(index));
   } catch (const std::out_of_range &ex) {
     errcode = kFailCode;
   }
@@ -632,17 +951,9 @@ bool KVContainer::ListSetItemAtIndex(const Key &key, int index, const std::strin
   IfKeyNotFoundThenReturn(key, false);
   IfKeyNotTypeThenReturn(key, OBJECT_LIST, false);
   DList *list = RetrievePtr(key, DList);
-  /* support negative index */
-  int list_len = (int) list->Length();
-  if (index < 0) {
-    index = index + list_len;
-  }
-  if (index < 0) {
-    errcode = kFailCode;
-    return false;
-  }
   try {
-    list->operator[](index).Reset(val);
+    /* negative index is resolved from the tail */
+    list->At(index).Reset(val);
     UpdateLastVisitTime(key);
     errcode = kOkCode;
     return true;
@@ -654,6 +965,54 @@ bool KVContainer::ListSetItemAtIndex(const Key &key, int index, const std::strin
   return false;
 }
 
+long KVContainer::ListInsert(const Key &key, bool before, const std::string &pivot,
+                             const std::string &val, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, 0);
+  IfKeyNotTypeThenReturn(key, OBJECT_LIST, 0);
+  DList *list = RetrievePtr(key, DList);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  long idx = list->Find(pivot);
+  if (idx < 0) {
+    return -1;
+  }
+  list->Insert(before ? idx : idx + 1, val);
+  return (long)list->Length();
+}
+
+size_t KVContainer::ListRemove(const Key &key, long count, const std::string &val, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, 0);
+  IfKeyNotTypeThenReturn(key, OBJECT_LIST, 0);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, DList)->Remove(val, count);
+}
+
+bool KVContainer::ListTrim(const Key &key, int begin, int end, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, false);
+  IfKeyNotTypeThenReturn(key, OBJECT_LIST, false);
+  DList *list = RetrievePtr(key, DList);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  int list_len = (int)list->Length();
+  /* supported negative index here */
+  if (begin < 0) {
+    begin = std::max(begin + list_len, 0);
+  }
+  if (end < 0) {
+    end = end + list_len;
+  }
+  if (end < 0 || begin > end || begin >= list_len) {
+    list->Clear();
+  } else {
+    list->Trim(begin, end);
+  }
+  return true;
+}
+
 bool KVContainer::HashUpdateKV(const Key &key, const HEntryKey &field, const HEntryVal &value, int &errcode) {
   GetBucketAndLock(key);
   errcode = kFailCode;
@@ -668,6 +1027,7 @@ bool KVContainer::HashUpdateKV(const Key &key, const HEntryKey &field, const HEn
     keys_pool_.emplace_back(bucket.content.find(key)->first);
   } else { /* found key */
     IfKeyNotTypeThenReturn(key, OBJECT_HASH, false);
+    ReclaimExpiredFields(key);
     /* found hash and then update */
     auto ret = RetrievePtr(key, HashDict)->Update(field, value);
     UpdateLastVisitTime(key);
@@ -698,6 +1058,7 @@ int KVContainer::HashUpdateKV(const Key &key, const std::vector<std::string> &fi
     keys_pool_.emplace_back(bucket.content.find(key)->first);
   } else { /* found existing key */
     IfKeyNotTypeThenReturn(key, OBJECT_HASH, 0);
+    ReclaimExpiredFields(key);
   }
   HashDict *p_dict = RetrievePtr(key, HashDict);
   for (size_t i = 0; i < fields.size(); ++i) {
@@ -714,6 +1075,7 @@ HEntryVal KVContainer::HashGetValue(const Key &key, const HEntryKey &field, int
   GetBucketAndLock(key);
   IfKeyNotFoundThenReturn(key, HEntryVal());
   IfKeyNotTypeThenReturn(key, OBJECT_HASH, HEntryVal());
+  ReclaimExpiredFields(key);
   UpdateLastVisitTime(key);
   errcode = kOkCode;
   try {
@@ -728,6 +1090,7 @@ std::vector<HEntryVal> KVContainer::HashGetValue(const Key &key, const std::vect
   GetBucketAndLock(key);
   IfKeyNotFoundThenReturn(key, {});
   IfKeyNotTypeThenReturn(key, OBJECT_HASH, {});
+  ReclaimExpiredFields(key);
   std::vector<HEntryVal> values;
   HashDict *p_dict = RetrievePtr(key, HashDict);
   for (const auto &field : fields) {
@@ -747,6 +1110,7 @@ int KVContainer::HashDelField(const Key &key, const HEntryKey &field, int &errco
   GetBucketAndLock(key);
   IfKeyNotFoundThenReturn(key, false);
   IfKeyNotTypeThenReturn(key, OBJECT_HASH, false);
+  ReclaimExpiredFields(key);
   UpdateLastVisitTime(key);
   errcode = kOkCode;
   return RetrievePtr(key, HashDict)->Erase(field);
@@ -767,7 +1131,17 @@ int KVContainer::HashDelField(const Key &key, const HEntryKey &field, int &errco
   return n_erased;
 
 int KVContainer::HashDelField(const Key &key, const std::vector<std::string> &fields, int &errcode) {
-  HashTypeEraseAux(key, fields, HashDict, OBJECT_HASH, errcode)
+  HashDict *p_dict = LookupHash(key, false, errcode);
+  if (p_dict == nullptr) {
+    return 0;
+  }
+  int n_erased = 0;
+  for (const auto &field : fields) {
+    if (p_dict->Erase(field) == ERASED) {
+      ++n_erased;
+    }
+  }
+  return n_erased;
 }
 
 #define HashTypeCheckExistAux(key, item, ptr_type, obj_type, errcode) \
@@ -779,13 +1153,15 @@ int KVContainer::HashDelField(const Key &key, const std::vector<std::string> &fi
   return RetrievePtr(key, ptr_type)->CheckExists(item);
 
 bool KVContainer::HashExistField(const Key &key, const HEntryKey &field, int &errcode) {
-  HashTypeCheckExistAux(key, field, HashDict, OBJECT_HASH, errcode)
+  HashDict *p_dict = LookupHash(key, false, errcode);
+  return p_dict != nullptr && p_dict->CheckExists(field);
 }
 
 std::vector<DynamicString> KVContainer::HashGetAllEntries(const Key &key, int &errcode) {
   GetBucketAndLock(key);
   IfKeyNotFoundThenReturn(key, {});
   IfKeyNotTypeThenReturn(key, OBJECT_HASH, {});
+  ReclaimExpiredFields(key);
   std::vector<HTEntry *> entries = RetrievePtr(key, HashDict)->AllEntries();
   std::vector<DynamicString> entries_str;
   entries_str.reserve(entries.size() * 2);
@@ -798,6 +1174,27 @@ std::vector<DynamicString> KVContainer::HashGetAllEntries(const Key &key, int &e
   return entries_str;
 }
 
+size_t KVContainer::HashGetAllEntries(const Key &key, const std::function<void(size_t)> &size,
+                                      const std::function<void(const HEntryKey &, const HEntryVal &)> &emit,
+                                      int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, 0);
+  IfKeyNotTypeThenReturn(key, OBJECT_HASH, 0);
+  ReclaimExpiredFields(key);
+  HashDict *dict = RetrievePtr(key, HashDict);
+  size_t n = dict->Count();
+  if (n > 0) {
+    size(n);
+    dict->ForEachEntry([&emit](HTEntry *entry) {
+      emit(*entry->key, *entry->value);
+      return true;
+    });
+  }
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return n;
+}
+
 #define HashTypeGetAllKeysAux(key, ptr_type, obj_type, errcode) \
   GetBucketAndLock(key);                                        \
   IfKeyNotFoundThenReturn(key, {});                             \
@@ -807,13 +1204,15 @@ std::vector<DynamicString> KVContainer::HashGetAllEntries(const Key &key, int &e
   return RetrievePtr(key, ptr_type)->AllKeys();
 
 std::vector<HEntryKey> KVContainer::HashGetAllFields(const Key &key, int &errcode) {
-  HashTypeGetAllKeysAux(key, HashDict, OBJECT_HASH, errcode)
+  HashDict *p_dict = LookupHash(key, false, errcode);
+  return p_dict != nullptr ? p_dict->AllKeys() : std::vector<HEntryKey>();
 }
 
 std::vector<HEntryVal> KVContainer::HashGetAllValues(const Key &key, int &errcode) {
   GetBucketAndLock(key);
   IfKeyNotFoundThenReturn(key, {});
   IfKeyNotTypeThenReturn(key, OBJECT_HASH, {});
+  ReclaimExpiredFields(key);
   UpdateLastVisitTime(key);
   errcode = kOkCode;
   return RetrievePtr(key, HashDict)->AllValues();
@@ -828,7 +1227,194 @@ std::vector<HEntryVal> KVContainer::HashGetAllValues(const Key &key, int &errcod
   return RetrievePtr(key, ptr_type)->Count();
 
 size_t KVContainer::HashLen(const Key &key, int &errcode) {
-  HashTypeGetCountAux(key, HashDict, OBJECT_HASH, errcode)
+  HashDict *p_dict = LookupHash(key, false, errcode);
+  return p_dict != nullptr ? p_dict->Count() : 0;
+}
+
+HashDict *KVContainer::LookupHash(const Key &key, bool create, int &errcode) {
+  GetBucketAndLock(key);
+  auto it = bucket.content.find(key);
+  if (it == bucket.content.end()) {
+    if (!create) {
+      errcode = kKeyNotFoundCode;
+      return nullptr;
+    }
+    auto obj = ConstructHashObjPtr();
+    if (!obj) {
+      errcode = kFailCode;
+      return nullptr;
+    }
+    it = bucket.content.emplace(key, obj).first;
+    keys_pool_.emplace_back(it->first);
+  } else if (it->second->type != OBJECT_HASH) {
+    errcode = kWrongTypeCode;
+    return nullptr;
+  }
+  errcode = kOkCode;
+  it->second->lv_time = GetCurrentMs();
+  HashDict *p_dict = (HashDict *)(it->second->ptr);
+  p_dict->ExpireKeys(it->second->lv_time);
+  return p_dict;
+}
+
+int64_t KVContainer::HashIncrBy(const Key &key, const HEntryKey &field, int64_t increment,
+                                int &errcode) {
+  HashDict *p_dict = LookupHash(key, true, errcode);
+  if (p_dict == nullptr) {
+    return 0;
+  }
+  HEntryVal *value = p_dict->Find(field);
+  int64_t current = 0;
+  if (value != nullptr && !CanConvertToInt64(value->ToStdString(), current)) {
+    errcode = kFailCode;
+    return 0;
+  }
+  if ((increment > 0 && current > INT64_MAX - increment) ||
+      (increment < 0 && current < INT64_MIN - increment)) {
+    errcode = kOverflowCode;
+    return 0;
+  }
+  current += increment;
+  std::string result = std::to_string(current);
+  if (value != nullptr) {
+    value->Reset(result.data(), result.size());
+  } else {
+    p_dict->Update(field, HEntryVal(result));
+  }
+  return current;
+}
+
+std::string KVContainer::HashIncrByFloat(const Key &key, const HEntryKey &field,
+                                         long double increment, int &errcode) {
+  HashDict *p_dict = LookupHash(key, true, errcode);
+  if (p_dict == nullptr) {
+    return "";
+  }
+  HEntryVal *value = p_dict->Find(field);
+  long double current = 0;
+  if (value != nullptr) {
+    std::string str = value->ToStdString();
+    char *end = nullptr;
+    current = std::strtold(str.c_str(), &end);
+    if (str.empty() || end != str.c_str() + str.size() || !std::isfinite(current)) {
+      errcode = kFailCode;
+      return "";
+    }
+  }
+  current += increment;
+  if (!std::isfinite(current)) {
+    errcode = kFailCode;
+    return "";
+  }
+  /* 17 significant digits of long double print short decimals such as 10.6 exactly */
+  char buf[64];
+  int len = snprintf(buf, sizeof(buf), "%.17Lg", current);
+  if (value != nullptr) {
+    value->Reset(buf, len);
+  } else {
+    p_dict->Update(field, HEntryVal(buf, len));
+  }
+  return std::string(buf, len);
+}
+
+bool KVContainer::HashSetNX(const Key &key, const HEntryKey &field, const HEntryVal &value,
+                            int &errcode) {
+  HashDict *p_dict = LookupHash(key, true, errcode);
+  if (p_dict == nullptr || p_dict->Find(field) != nullptr) {
+    return false;
+  }
+  p_dict->Update(field, value);
+  return true;
+}
+
+std::vector<int> KVContainer::HashFieldExpireAt(const Key &key,
+                                                const std::vector<std::string> &fields,
+                                                uint64_t when, int &errcode) {
+  HashDict *p_dict = LookupHash(key, false, errcode);
+  if (p_dict == nullptr) {
+    return std::vector<int>(errcode == kKeyNotFoundCode ? fields.size() : 0, -2);
+  }
+  bool expired = when <= GetCurrentMs();
+  std::vector<int> results;
+  results.reserve(fields.size());
+  for (const auto &field : fields) {
+    HEntryKey hfield(field);
+    if (p_dict->Find(hfield) == nullptr) {
+      results.push_back(-2);
+    } else if (expired) {
+      p_dict->Erase(hfield);
+      results.push_back(2);
+    } else {
+      p_dict->SetExpire(hfield, when);
+      results.push_back(1);
+    }
+  }
+  if (p_dict->NumExpires() != 0) {
+    std::string std_key = key.ToStdString();
+    if (hash_expire_keys_.insert(std_key).second) {
+      hash_expire_queue_.emplace_back(std::move(std_key));
+    }
+  }
+  return results;
+}
+
+std::vector<int64_t> KVContainer::HashFieldExpireTime(const Key &key,
+                                                      const std::vector<std::string> &fields,
+                                                      int &errcode) {
+  HashDict *p_dict = LookupHash(key, false, errcode);
+  if (p_dict == nullptr) {
+    return std::vector<int64_t>(errcode == kKeyNotFoundCode ? fields.size() : 0, -2);
+  }
+  std::vector<int64_t> results;
+  results.reserve(fields.size());
+  for (const auto &field : fields) {
+    HEntryKey hfield(field);
+    results.push_back(p_dict->Find(hfield) == nullptr ? -2 : p_dict->ExpireTime(hfield));
+  }
+  return results;
+}
+
+std::vector<int> KVContainer::HashFieldPersist(const Key &key,
+                                               const std::vector<std::string> &fields,
+                                               int &errcode) {
+  HashDict *p_dict = LookupHash(key, false, errcode);
+  if (p_dict == nullptr) {
+    return std::vector<int>(errcode == kKeyNotFoundCode ? fields.size() : 0, -2);
+  }
+  std::vector<int> results;
+  results.reserve(fields.size());
+  for (const auto &field : fields) {
+    HEntryKey hfield(field);
+    if (p_dict->Find(hfield) == nullptr) {
+      results.push_back(-2);
+    } else {
+      results.push_back(p_dict->Persist(hfield) ? 1 : -1);
+    }
+  }
+  return results;
+}
+
+size_t KVContainer::HashActiveExpire(size_t n_keys) {
+  uint64_t now = GetCurrentMs();
+  size_t n_deleted = 0;
+  for (size_t i = 0; i < n_keys && !hash_expire_queue_.empty(); ++i) {
+    std::string std_key = std::move(hash_expire_queue_.front());
+    hash_expire_queue_.pop_front();
+    Key key(std_key);
+    GetBucketAndLock(key);
+    auto it = bucket.content.find(key);
+    /* the key may have been deleted or overwritten since its fields got expirations */
+    if (it != bucket.content.end() && it->second->type == OBJECT_HASH) {
+      HashDict *p_dict = (HashDict *)(it->second->ptr);
+      n_deleted += p_dict->ExpireKeys(now);
+      if (p_dict->NumExpires() != 0) {
+        hash_expire_queue_.emplace_back(std::move(std_key));
+        continue;
+      }
+    }
+    hash_expire_keys_.erase(std_key);
+  }
+  return n_deleted;
 }
 
 /******************** HashSet operation ********************/
@@ -914,36 +1500,1022 @@ size_t KVContainer::SetGetMemberCount(const Key &key, int &errcode) {
   HashTypeGetCountAux(key, HashSet, OBJECT_SET, errcode)
 }
 
-#undef HashTypeEraseAux
-#undef HashTypeCheckExistAux
-#undef HashTypeGetAllKeysAux
-#undef HashTypeGetCountAux
+std::vector<HEntryKey> KVContainer::SetRandomMembers(const Key &key, long count, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_SET, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  bool unique = count > 0;
+  size_t n = unique ? count : -(size_t)count;
+  std::vector<HEntryKey> members;
+  for (HSEntry *entry : RetrievePtr(key, HashSet)->RandomEntries(n, unique, sRandEngine)) {
+    members.emplace_back(*entry->key);
+  }
+  return members;
+}
 
-void KVContainer::Snapshot(std::vector<char> &buf) {
-  /**
-   * entry binary structure
-   * +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-   * | 0xFF | TYPE | EXPIRE FLAG | EXPIRE TIMESTAMP (OPTIONAL) |   KEY   |   VALUE   |   0XFE  |
-   * +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-   * |  1B  |  1B  |     1B     |             8B               |   VAL   |    VAL    |    1B   |
-   * +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-   */
-  size_t entry_cnt = NumItems();  // FIXME: O(n)
-  unsigned char len_buf[8];
-  EncodeFixed64BitInteger(entry_cnt, len_buf);
-  buf.insert(buf.end(), len_buf, len_buf + 8);
-  std::vector<char> entry_buf;
-  entry_buf.reserve(64);
+std::vector<HEntryKey> KVContainer::SetPopMembers(const Key &key, size_t count, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_SET, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  HashSet *p_set = RetrievePtr(key, HashSet);
+  std::vector<HEntryKey> members;
+  /* copy members out before erasing, erasing frees the entries */
+  for (HSEntry *entry : p_set->RandomEntries(count, true, sRandEngine)) {
+    members.emplace_back(*entry->key);
+  }
+  for (const auto &member : members) {
+    p_set->Erase(member);
+  }
+  return members;
+}
 
-  for (const Bucket &bucket : bucket_) {
-    for (const auto& item : bucket.content) { // auto = std::pair<Key, ValueObjectPtr>
-      const Key &key = item.first;
-      std::string std_str_key = key.ToStdString();
-      const ValueObjectPtr &value = item.second;
+HashSet *KVContainer::LookupSet(const Key &key, int &errcode) {
+  GetBucketAndLock(key);
+  errcode = kOkCode;
+  auto it = bucket.content.find(key);
+  if (it == bucket.content.end()) {
+    return nullptr;
+  }
+  if (it->second->type != OBJECT_SET) {
+    errcode = kWrongTypeCode;
+    return nullptr;
+  }
+  it->second->lv_time = GetCurrentMs();
+  return (HashSet *)(it->second->ptr);
+}
+
+bool KVContainer::SetAlgebra(int op, const std::vector<std::string> &keys,
+                             const std::function<bool(const HEntryKey &)> &emit, int &errcode) {
+  /* check all types before emitting anything */
+  std::vector<HashSet *> sets;
+  sets.reserve(keys.size());
+  for (const auto &key : keys) {
+    sets.emplace_back(LookupSet(Key(key), errcode));
+    if (errcode != kOkCode) {
+      return false;
+    }
+  }
+  errcode = kOkCode;
+  if (sets.empty() || (op == SET_OP_DIFF && sets[0] == nullptr)) {
+    return true;
+  }
+  if (op == SET_OP_INTER) {
+    if (std::find(sets.begin(), sets.end(), nullptr) != sets.end()) {
+      return true; /* intersection with an empty set */
+    }
+    /* iterate the smallest set and probe the others */
+    std::sort(sets.begin(), sets.end(),
+              [](HashSet *a, HashSet *b) { return a->Count() < b->Count(); });
+    return sets[0]->ForEachEntry([&](HSEntry *entry) {
+      for (size_t i = 1; i < sets.size(); ++i) {
+        if (!sets[i]->CheckExists(*entry->key)) {
+          return true;
+        }
+      }
+      return emit(*entry->key);
+    });
+  } else if (op == SET_OP_UNION) {
+    /* a member is emitted by the first set containing it */
+    for (size_t i = 0; i < sets.size(); ++i) {
+      if (sets[i] == nullptr) {
+        continue;
+      }
+      bool go_on = sets[i]->ForEachEntry([&](HSEntry *entry) {
+        for (size_t j = 0; j < i; ++j) {
+          if (sets[j] != nullptr && sets[j]->CheckExists(*entry->key)) {
+            return true;
+          }
+        }
+        return emit(*entry->key);
+      });
+      if (!go_on) {
+        return false;
+      }
+    }
+    return true;
+  }
+  /* members of the first set which are in none of the others */
+  return sets[0]->ForEachEntry([&](HSEntry *entry) {
+    for (size_t i = 1; i < sets.size(); ++i) {
+      if (sets[i] != nullptr && sets[i]->CheckExists(*entry->key)) {
+        return true;
+      }
+    }
+    return emit(*entry->key);
+  });
+}
+
+size_t KVContainer::SetAlgebraStore(int op, const Key &dst, const std::vector<std::string> &keys,
+                                    int &errcode) {
+  /* dst may be one of the sources, so build the result aside first */
+  HashSet *result = new (std::nothrow) HashSet;
+  if (result == nullptr) {
+    errcode = kFailCode;
+    return 0;
+  }
+  SetAlgebra(op, keys, [result](const HEntryKey &member) {
+    result->Insert(member);
+    return true;
+  }, errcode);
+  size_t count = result->Count();
+  if (errcode != kOkCode || count == 0) {
+    delete result;
+    if (errcode == kOkCode) {
+      Delete(dst);
+    }
+    return 0;
+  }
+  GetBucketAndLock(dst);
+  if (KeyNotFoundInBucket(dst)) {
+    bucket.content[dst] = std::make_shared<ValueObject>(OBJECT_SET, (void *)result);
+    keys_pool_.emplace_back(bucket.content.find(dst)->first);
+  } else {
+    /* overwrite dst no matter what type it holds */
+    UnpinForWrite(bucket.content[dst], false);
+    bucket.content[dst]->FreePtr();
+    bucket.content[dst]->type = OBJECT_SET;
+    bucket.content[dst]->ptr = result;
+    UpdateLastVisitTime(dst);
+  }
+  return count;
+}
+
+/******************** ZSet operation ********************/
+
+int KVContainer::ZSetAdd(const Key &key, const std::vector<std::pair<int64_t, std::string>> &items,
+                         bool nx, bool xx, bool ch, int &errcode) {
+  GetBucketAndLock(key);
+  errcode = kFailCode;
+  if (KeyNotFoundInBucket(key)) {
+    if (xx) { /* nothing to update */
+      errcode = kOkCode;
+      return 0;
+    }
+    auto obj = ConstructZSetObjPtr();
+    if (!obj) {
+      return 0;
+    }
+    bucket.content[key] = obj;
+    keys_pool_.emplace_back(bucket.content.find(key)->first);
+  } else {
+    IfKeyNotTypeThenReturn(key, OBJECT_ZSET, 0);
+  }
+  int n_added = 0, n_updated = 0;
+  ZSet *p_zset = RetrievePtr(key, ZSet);
+  for (const auto &item : items) {
+    HEntryKey member(item.second);
+    int64_t old_score;
+    bool exists = p_zset->Score(member, old_score);
+    if ((nx && exists) || (xx && !exists)) {
+      continue;
+    }
+    int ret = p_zset->Add(member, item.first);
+    if (ret == NEW_ADDED) {
+      ++n_added;
+    } else if (ret == UPDATED) {
+      ++n_updated;
+    }
+  }
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return ch ? n_added + n_updated : n_added;
+}
+
+int64_t KVContainer::ZSetIncrBy(const Key &key, const std::string &member, int64_t increment,
+                                int &errcode) {
+  GetBucketAndLock(key);
+  errcode = kFailCode;
+  if (KeyNotFoundInBucket(key)) {
+    auto obj = ConstructZSetObjPtr();
+    if (!obj) {
+      return 0;
+    }
+    bucket.content[key] = obj;
+    keys_pool_.emplace_back(bucket.content.find(key)->first);
+  } else {
+    IfKeyNotTypeThenReturn(key, OBJECT_ZSET, 0);
+  }
+  UpdateLastVisitTime(key);
+  ZSet *p_zset = RetrievePtr(key, ZSet);
+  HEntryKey m(member);
+  int64_t score = 0;
+  p_zset->Score(m, score);
+  /* check overflow */
+  if ((increment > 0 && score > INT64_MAX - increment) ||
+      (increment < 0 && score < INT64_MIN - increment)) {
+    errcode = kOverflowCode;
+    return 0;
+  }
+  score += increment;
+  p_zset->Add(m, score);
+  errcode = kOkCode;
+  return score;
+}
+
+bool KVContainer::ZSetScore(const Key &key, const std::string &member, int64_t &score,
+                            int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, false);
+  IfKeyNotTypeThenReturn(key, OBJECT_ZSET, false);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, ZSet)->Score(HEntryKey(member), score);
+}
+
+int KVContainer::ZSetRemove(const Key &key, const std::vector<std::string> &members,
+                            int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, 0);
+  IfKeyNotTypeThenReturn(key, OBJECT_ZSET, 0);
+  int n_removed = 0;
+  for (const auto &member : members) {
+    if (RetrievePtr(key, ZSet)->Remove(HEntryKey(member))) {
+      ++n_removed;
+    }
+  }
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return n_removed;
+}
+
+size_t KVContainer::ZSetCard(const Key &key, int &errcode) {
+  HashTypeGetCountAux(key, ZSet, OBJECT_ZSET, errcode)
+}
+
+long KVContainer::ZSetRank(const Key &key, const std::string &member, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, -1);
+  IfKeyNotTypeThenReturn(key, OBJECT_ZSET, -1);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, ZSet)->Rank(HEntryKey(member));
+}
+
+std::vector<ZSetItem> KVContainer::ZSetRange(const Key &key, long begin, long end, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_ZSET, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  ZSet *p_zset = RetrievePtr(key, ZSet);
+  long count = (long)p_zset->Count();
+  /* supported negative index here */
+  if (begin < 0) {
+    begin = std::max(begin + count, 0l);
+  }
+  if (end < 0) {
+    end += count;
+  }
+  if (end < 0 || begin > end || begin >= count) {
+    return {};
+  }
+  return p_zset->RangeByRank(begin, end);
+}
+
+std::vector<ZSetItem> KVContainer::ZSetRangeByScore(const Key &key, const ZScoreRange &range,
+                                                    size_t offset, long count, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_ZSET, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, ZSet)->RangeByScore(range, offset, count);
+}
+
+std::vector<ZSetItem> KVContainer::ZSetPopMin(const Key &key, size_t count, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_ZSET, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, ZSet)->PopMin(count);
+}
+
+/******************** HyperLogLog operation ********************/
+
+void *KVContainer::LookupValue(const Key &key, unsigned char type, int &errcode) {
+  GetBucketAndLock(key);
+  errcode = kOkCode;
+  auto it = bucket.content.find(key);
+  if (it == bucket.content.end()) {
+    return nullptr;
+  }
+  if (it->second->type != type) {
+    errcode = kWrongTypeCode;
+    return nullptr;
+  }
+  it->second->lv_time = GetCurrentMs();
+  return it->second->ptr;
+}
+
+void KVContainer::ReplaceValue(const Key &key, unsigned char type, void *ptr) {
+  GetBucketAndLock(key);
+  if (KeyNotFoundInBucket(key)) {
+    bucket.content[key] = std::make_shared<ValueObject>(type, ptr);
+    keys_pool_.emplace_back(bucket.content.find(key)->first);
+  } else {
+    /* overwrite key no matter what type it holds */
+    UnpinForWrite(bucket.content[key], false);
+    bucket.content[key]->FreePtr();
+    bucket.content[key]->type = type;
+    bucket.content[key]->ptr = ptr;
+    UpdateLastVisitTime(key);
+  }
+}
+
+int KVContainer::HLLAdd(const Key &key, const std::vector<std::string> &elems, int &errcode) {
+  GetBucketAndLock(key);
+  int updated = 0;
+  if (KeyNotFoundInBucket(key)) {
+    auto hptr = ConstructHLLObjPtr();
+    if (!hptr) {
+      errcode = kFailCode;
+      return 0;
+    }
+    bucket.content[key] = hptr;
+    keys_pool_.emplace_back(bucket.content.find(key)->first);
+    updated = 1;
+  } else {
+    IfKeyNotTypeThenReturn(key, OBJECT_HLL, 0);
+    UpdateLastVisitTime(key);
+  }
+  HyperLogLog *p_hll = RetrievePtr(key, HyperLogLog);
+  for (const auto &elem : elems) {
+    if (p_hll->Add(elem)) {
+      updated = 1;
+    }
+  }
+  errcode = kOkCode;
+  return updated;
+}
+
+uint64_t KVContainer::HLLCount(const std::vector<std::string> &keys, int &errcode) {
+  std::vector<HyperLogLog *> hlls;
+  hlls.reserve(keys.size());
+  for (const auto &key : keys) {
+    auto p_hll = (HyperLogLog *)LookupValue(Key(key), OBJECT_HLL, errcode);
+    if (errcode != kOkCode) {
+      return 0;
+    }
+    if (p_hll != nullptr) {
+      hlls.emplace_back(p_hll);
+    }
+  }
+  errcode = kOkCode;
+  if (hlls.empty()) {
+    return 0;
+  }
+  if (hlls.size() == 1) {
+    /* cached cardinality can be used */
+    return hlls[0]->Count();
+  }
+  /* union of registers, maximum is taken register by register */
+  std::vector<uint8_t> regs(kHLLRegisters, 0);
+  for (HyperLogLog *p_hll : hlls) {
+    p_hll->MergeInto(regs.data());
+  }
+  return HyperLogLog::Estimate(regs.data());
+}
+
+bool KVContainer::HLLMerge(const Key &dst, const std::vector<std::string> &keys, int &errcode) {
+  std::vector<HyperLogLog *> hlls;
+  hlls.reserve(keys.size() + 1);
+  for (const auto &key : keys) {
+    auto p_hll = (HyperLogLog *)LookupValue(Key(key), OBJECT_HLL, errcode);
+    if (errcode != kOkCode) {
+      return false;
+    }
+    if (p_hll != nullptr) {
+      hlls.emplace_back(p_hll);
+    }
+  }
+  auto p_dst = (HyperLogLog *)LookupValue(dst, OBJECT_HLL, errcode);
+  if (errcode != kOkCode) {
+    return false;
+  }
+  std::vector<uint8_t> regs(kHLLRegisters, 0);
+  for (HyperLogLog *p_hll : hlls) {
+    p_hll->MergeInto(regs.data());
+  }
+  if (p_dst == nullptr) {
+    auto hptr = ConstructHLLObjPtr();
+    if (!hptr) {
+      errcode = kFailCode;
+      return false;
+    }
+    GetBucketAndLock(dst);
+    bucket.content[dst] = hptr;
+    keys_pool_.emplace_back(bucket.content.find(dst)->first);
+    p_dst = (HyperLogLog *)hptr->ptr;
+  } else {
+    /* registers of dst itself are kept */
+    p_dst->MergeInto(regs.data());
+  }
+  p_dst->LoadRegisters(regs.data());
+  errcode = kOkCode;
+  return true;
+}
+
+bool KVContainer::HLLRestore(const Key &key, const std::string &data, int &errcode) {
+  HyperLogLog *result = new (std::nothrow) HyperLogLog;
+  if (result == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  if (!result->Load(data.data(), data.size())) {
+    delete result;
+    errcode = kFailCode;
+    return false;
+  }
+  ReplaceValue(key, OBJECT_HLL, result);
+  errcode = kOkCode;
+  return true;
+}
+
+/******************** Count-Min Sketch operation ********************/
+
+bool KVContainer::CMSInit(const Key &key, uint32_t width, uint32_t depth, int &errcode) {
+  GetBucketAndLock(key);
+  if (KeyFoundInBucket(key)) {
+    errcode = kFailCode;
+    return false;
+  }
+  CountMinSketch *p_cms = new (std::nothrow) CountMinSketch(width, depth);
+  if (p_cms == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  bucket.content[key] = std::make_shared<ValueObject>(OBJECT_CMS, (void *)p_cms);
+  keys_pool_.emplace_back(bucket.content.find(key)->first);
+  errcode = kOkCode;
+  return true;
+}
+
+std::vector<uint32_t> KVContainer::CMSIncrBy(const Key &key, const std::vector<std::string> &items,
+                                             const std::vector<uint32_t> &increments,
+                                             int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_CMS, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, CountMinSketch)->IncrBy(items, increments);
+}
+
+std::vector<uint32_t> KVContainer::CMSQuery(const Key &key, const std::vector<std::string> &items,
+                                            int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_CMS, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, CountMinSketch)->Query(items);
+}
+
+bool KVContainer::CMSMerge(const Key &dst, const std::vector<std::string> &keys,
+                           const std::vector<uint32_t> &weights, int &errcode) {
+  /* all sketches including dst must exist and have the same dimensions */
+  auto p_dst = (CountMinSketch *)LookupValue(dst, OBJECT_CMS, errcode);
+  if (errcode == kOkCode && p_dst == nullptr) {
+    errcode = kKeyNotFoundCode;
+  }
+  if (errcode != kOkCode) {
+    return false;
+  }
+  std::vector<CountMinSketch *> srcs;
+  srcs.reserve(keys.size());
+  for (const auto &key : keys) {
+    auto p_cms = (CountMinSketch *)LookupValue(Key(key), OBJECT_CMS, errcode);
+    if (errcode == kOkCode && p_cms == nullptr) {
+      errcode = kKeyNotFoundCode;
+    }
+    if (errcode != kOkCode) {
+      return false;
+    }
+    if (p_cms->Width() != p_dst->Width() || p_cms->Depth() != p_dst->Depth()) {
+      errcode = kFailCode;
+      return false;
+    }
+    srcs.emplace_back(p_cms);
+  }
+  /* dst may be one of the sources, so build the result aside first */
+  CountMinSketch *result = new (std::nothrow) CountMinSketch(p_dst->Width(), p_dst->Depth());
+  if (result == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  for (size_t i = 0; i < srcs.size(); ++i) {
+    result->MergeFrom(*srcs[i], weights[i]);
+  }
+  ReplaceValue(dst, OBJECT_CMS, result);
+  errcode = kOkCode;
+  return true;
+}
+
+bool KVContainer::CMSRestore(const Key &key, const std::string &data, int &errcode) {
+  CountMinSketch *result = new (std::nothrow) CountMinSketch;
+  if (result == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  if (!result->Load(data.data(), data.size())) {
+    delete result;
+    errcode = kFailCode;
+    return false;
+  }
+  ReplaceValue(key, OBJECT_CMS, result);
+  errcode = kOkCode;
+  return true;
+}
+
+/******************** Top-K operation ********************/
+
+bool KVContainer::TopKReserve(const Key &key, uint32_t k, uint32_t width, uint32_t depth,
+                              double decay, int &errcode) {
+  GetBucketAndLock(key);
+  if (KeyFoundInBucket(key)) {
+    errcode = kFailCode;
+    return false;
+  }
+  TopK *p_topk = new (std::nothrow) TopK(k, width, depth, decay);
+  if (p_topk == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  bucket.content[key] = std::make_shared<ValueObject>(OBJECT_TOPK, (void *)p_topk);
+  keys_pool_.emplace_back(bucket.content.find(key)->first);
+  errcode = kOkCode;
+  return true;
+}
+
+std::vector<std::pair<bool, std::string>> KVContainer::TopKAdd(
+    const Key &key, const std::vector<std::string> &items, const std::vector<uint32_t> &increments,
+    int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_TOPK, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  TopK *p_topk = RetrievePtr(key, TopK);
+  std::vector<std::pair<bool, std::string>> expelled(items.size());
+  for (size_t i = 0; i < items.size(); ++i) {
+    expelled[i].first = p_topk->Add(items[i], increments[i], expelled[i].second);
+  }
+  return expelled;
+}
+
+std::vector<bool> KVContainer::TopKQuery(const Key &key, const std::vector<std::string> &items,
+                                         int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_TOPK, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  TopK *p_topk = RetrievePtr(key, TopK);
+  std::vector<bool> found;
+  found.reserve(items.size());
+  for (const auto &item : items) {
+    found.push_back(p_topk->Query(item));
+  }
+  return found;
+}
+
+std::vector<TopKItem> KVContainer::TopKList(const Key &key, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_TOPK, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, TopK)->List();
+}
+
+bool KVContainer::TopKRestore(const Key &key, const std::string &data, int &errcode) {
+  TopK *result = new (std::nothrow) TopK;
+  if (result == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  if (!result->Load(data.data(), data.size())) {
+    delete result;
+    errcode = kFailCode;
+    return false;
+  }
+  ReplaceValue(key, OBJECT_TOPK, result);
+  errcode = kOkCode;
+  return true;
+}
+
+/******************** Bloom Filter operation ********************/
+
+bool KVContainer::BFReserve(const Key &key, double error_rate, uint64_t capacity,
+                            uint32_t expansion, bool nonscaling, int &errcode) {
+  GetBucketAndLock(key);
+  if (KeyFoundInBucket(key)) {
+    errcode = kFailCode;
+    return false;
+  }
+  BloomFilter *p_bf = new (std::nothrow) BloomFilter(error_rate, capacity, expansion, nonscaling);
+  if (p_bf == nullptr || p_bf->NumLayers() == 0) {
+    delete p_bf;
+    errcode = kFailCode;
+    return false;
+  }
+  bucket.content[key] = std::make_shared<ValueObject>(OBJECT_BLOOM, (void *)p_bf);
+  keys_pool_.emplace_back(bucket.content.find(key)->first);
+  errcode = kOkCode;
+  return true;
+}
+
+std::vector<int> KVContainer::BFAdd(const Key &key, const std::vector<std::string> &items,
+                                    int &errcode) {
+  GetBucketAndLock(key);
+  if (KeyNotFoundInBucket(key)) {
+    /* created with default parameters */
+    BloomFilter *p_bf = new (std::nothrow) BloomFilter(
+        kBloomDefaultErrorRate, kBloomDefaultCapacity, kBloomDefaultExpansion, false);
+    if (p_bf == nullptr || p_bf->NumLayers() == 0) {
+      delete p_bf;
+      errcode = kFailCode;
+      return {};
+    }
+    bucket.content[key] = std::make_shared<ValueObject>(OBJECT_BLOOM, (void *)p_bf);
+    keys_pool_.emplace_back(bucket.content.find(key)->first);
+  }
+  IfKeyNotTypeThenReturn(key, OBJECT_BLOOM, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  BloomFilter *p_bf = RetrievePtr(key, BloomFilter);
+  std::vector<int> results;
+  results.reserve(items.size());
+  for (const auto &item : items) {
+    results.push_back(p_bf->Add(item));
+  }
+  return results;
+}
+
+std::vector<int> KVContainer::BFExists(const Key &key, const std::vector<std::string> &items,
+                                       int &errcode) {
+  GetBucketAndLock(key);
+  errcode = kOkCode;
+  if (KeyNotFoundInBucket(key)) {
+    return std::vector<int>(items.size(), 0);
+  }
+  IfKeyNotTypeThenReturn(key, OBJECT_BLOOM, {});
+  UpdateLastVisitTime(key);
+  BloomFilter *p_bf = RetrievePtr(key, BloomFilter);
+  std::vector<int> results;
+  results.reserve(items.size());
+  for (const auto &item : items) {
+    results.push_back(p_bf->Exists(item) ? 1 : 0);
+  }
+  return results;
+}
+
+bool KVContainer::BFRestore(const Key &key, const char *data, size_t len, int &errcode) {
+  BloomFilter *result = new (std::nothrow) BloomFilter;
+  if (result == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  if (!result->Load(data, len)) {
+    delete result;
+    errcode = kFailCode;
+    return false;
+  }
+  ReplaceValue(key, OBJECT_BLOOM, result);
+  errcode = kOkCode;
+  return true;
+}
+
+/******************** Stream operation ********************/
+
+bool KVContainer::StreamAdd(const Key &key, const StreamIDSpec &spec,
+                            const std::vector<std::string> &fields, bool nomkstream, StreamID &id,
+                            int &errcode) {
+  GetBucketAndLock(key);
+  if (KeyNotFoundInBucket(key)) {
+    if (nomkstream) {
+      errcode = kKeyNotFoundCode;
+      return false;
+    }
+    Stream *p_stream = new (std::nothrow) Stream;
+    if (p_stream == nullptr) {
+      errcode = kFailCode;
+      return false;
+    }
+    /* the key is created only if the entry is added */
+    if (!p_stream->Add(spec, GetCurrentMs(), fields, id)) {
+      delete p_stream;
+      errcode = kFailCode;
+      return false;
+    }
+    bucket.content[key] = std::make_shared<ValueObject>(OBJECT_STREAM, (void *)p_stream);
+    keys_pool_.emplace_back(bucket.content.find(key)->first);
+    errcode = kOkCode;
+    return true;
+  }
+  IfKeyNotTypeThenReturn(key, OBJECT_STREAM, false);
+  UpdateLastVisitTime(key);
+  if (!RetrievePtr(key, Stream)->Add(spec, GetCurrentMs(), fields, id)) {
+    errcode = kFailCode;
+    return false;
+  }
+  errcode = kOkCode;
+  return true;
+}
+
+std::vector<StreamEntry> KVContainer::StreamRange(const Key &key, const StreamID &start,
+                                                  const StreamID &end, size_t count,
+                                                  bool reversed, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_STREAM, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, Stream)->Range(start, end, count, reversed);
+}
+
+uint64_t KVContainer::StreamLength(const Key &key, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, 0);
+  IfKeyNotTypeThenReturn(key, OBJECT_STREAM, 0);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, Stream)->Length();
+}
+
+StreamID KVContainer::StreamLastID(const Key &key, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, StreamID::Min());
+  IfKeyNotTypeThenReturn(key, OBJECT_STREAM, StreamID::Min());
+  errcode = kOkCode;
+  return RetrievePtr(key, Stream)->LastID();
+}
+
+uint64_t KVContainer::StreamTrimByLength(const Key &key, uint64_t maxlen, bool approx,
+                                         int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, 0);
+  IfKeyNotTypeThenReturn(key, OBJECT_STREAM, 0);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, Stream)->TrimByLength(maxlen, approx);
+}
+
+uint64_t KVContainer::StreamTrimByMinID(const Key &key, const StreamID &minid, bool approx,
+                                        int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, 0);
+  IfKeyNotTypeThenReturn(key, OBJECT_STREAM, 0);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, Stream)->TrimByMinID(minid, approx);
+}
+
+bool KVContainer::StreamRestore(const Key &key, const char *data, size_t len, int &errcode) {
+  Stream *result = new (std::nothrow) Stream;
+  if (result == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  if (!result->Load(data, len)) {
+    delete result;
+    errcode = kFailCode;
+    return false;
+  }
+  ReplaceValue(key, OBJECT_STREAM, result);
+  errcode = kOkCode;
+  return true;
+}
+
+/******************** Time series operation ********************/
+
+bool KVContainer::TSCreate(const Key &key, uint64_t retention_ms, int &errcode) {
+  GetBucketAndLock(key);
+  if (KeyFoundInBucket(key)) {
+    errcode = kFailCode;
+    return false;
+  }
+  TimeSeries *p_ts = new (std::nothrow) TimeSeries(retention_ms);
+  if (p_ts == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  bucket.content[key] = std::make_shared<ValueObject>(OBJECT_TS, (void *)p_ts);
+  keys_pool_.emplace_back(bucket.content.find(key)->first);
+  errcode = kOkCode;
+  return true;
+}
+
+bool KVContainer::TSAdd(const Key &key, int64_t timestamp, double value, uint64_t retention_ms,
+                        int &errcode) {
+  GetBucketAndLock(key);
+  if (KeyNotFoundInBucket(key)) {
+    TimeSeries *p_ts = new (std::nothrow) TimeSeries(retention_ms);
+    if (p_ts == nullptr) {
+      errcode = kFailCode;
+      return false;
+    }
+    p_ts->Add(timestamp, value);
+    bucket.content[key] = std::make_shared<ValueObject>(OBJECT_TS, (void *)p_ts);
+    keys_pool_.emplace_back(bucket.content.find(key)->first);
+    errcode = kOkCode;
+    return true;
+  }
+  IfKeyNotTypeThenReturn(key, OBJECT_TS, false);
+  UpdateLastVisitTime(key);
+  if (!RetrievePtr(key, TimeSeries)->Add(timestamp, value)) {
+    errcode = kFailCode;
+    return false;
+  }
+  errcode = kOkCode;
+  return true;
+}
+
+bool KVContainer::TSGet(const Key &key, TSSample &sample, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, false);
+  IfKeyNotTypeThenReturn(key, OBJECT_TS, false);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, TimeSeries)->LastSample(sample);
+}
+
+std::vector<TSSample> KVContainer::TSRange(const Key &key, int64_t from, int64_t to, size_t count,
+                                           int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_TS, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, TimeSeries)->Range(from, to, count);
+}
+
+std::vector<TSSample> KVContainer::TSAggregate(const Key &key, int64_t from, int64_t to,
+                                               int aggregation, uint64_t bucket_ms, size_t count,
+                                               int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_TS, {});
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, TimeSeries)->Aggregate(from, to, aggregation, bucket_ms, count);
+}
+
+bool KVContainer::TSRestore(const Key &key, const char *data, size_t len, int &errcode) {
+  TimeSeries *result = new (std::nothrow) TimeSeries;
+  if (result == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  if (!result->Load(data, len)) {
+    delete result;
+    errcode = kFailCode;
+    return false;
+  }
+  ReplaceValue(key, OBJECT_TS, result);
+  errcode = kOkCode;
+  return true;
+}
+
+/******************** Vector set operation ********************/
+
+bool KVContainer::VAdd(const Key &key, const std::string &element, const std::vector<float> &vec,
+                       int metric, bool quantized, int &errcode) {
+  GetBucketAndLock(key);
+  if (KeyNotFoundInBucket(key)) {
+    if (vec.empty() || vec.size() > kVecMaxDim) {
+      errcode = kFailCode;
+      return false;
+    }
+    VectorSet *p_vset = new (std::nothrow) VectorSet(vec.size(), metric, quantized);
+    if (p_vset == nullptr) {
+      errcode = kFailCode;
+      return false;
+    }
+    p_vset->Add(element, vec.data());
+    bucket.content[key] = std::make_shared<ValueObject>(OBJECT_VSET, (void *)p_vset);
+    keys_pool_.emplace_back(bucket.content.find(key)->first);
+    errcode = kOkCode;
+    return true;
+  }
+  IfKeyNotTypeThenReturn(key, OBJECT_VSET, false);
+  UpdateLastVisitTime(key);
+  VectorSet *p_vset = RetrievePtr(key, VectorSet);
+  if (vec.size() != p_vset->Dim()) {
+    errcode = kFailCode;
+    return false;
+  }
+  errcode = kOkCode;
+  return p_vset->Add(element, vec.data());
+}
+
+bool KVContainer::VRem(const Key &key, const std::string &element, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, false);
+  IfKeyNotTypeThenReturn(key, OBJECT_VSET, false);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, VectorSet)->Remove(element);
+}
+
+std::vector<VecMatch> KVContainer::VSim(const Key &key, const std::vector<float> &query, size_t k,
+                                        size_t ef, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, {});
+  IfKeyNotTypeThenReturn(key, OBJECT_VSET, {});
+  UpdateLastVisitTime(key);
+  VectorSet *p_vset = RetrievePtr(key, VectorSet);
+  if (query.size() != p_vset->Dim()) {
+    errcode = kFailCode;
+    return {};
+  }
+  errcode = kOkCode;
+  return p_vset->Search(query.data(), k, ef);
+}
+
+uint64_t KVContainer::VCard(const Key &key, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, 0);
+  IfKeyNotTypeThenReturn(key, OBJECT_VSET, 0);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, VectorSet)->Count();
+}
+
+uint32_t KVContainer::VDim(const Key &key, int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, 0);
+  IfKeyNotTypeThenReturn(key, OBJECT_VSET, 0);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, VectorSet)->Dim();
+}
+
+bool KVContainer::VEmb(const Key &key, const std::string &element, std::vector<float> &vec,
+                       int &errcode) {
+  GetBucketAndLock(key);
+  IfKeyNotFoundThenReturn(key, false);
+  IfKeyNotTypeThenReturn(key, OBJECT_VSET, false);
+  UpdateLastVisitTime(key);
+  errcode = kOkCode;
+  return RetrievePtr(key, VectorSet)->Get(element, vec);
+}
+
+bool KVContainer::VRestore(const Key &key, const char *data, size_t len, int &errcode) {
+  VectorSet *result = new (std::nothrow) VectorSet;
+  if (result == nullptr) {
+    errcode = kFailCode;
+    return false;
+  }
+  if (!result->Load(data, len)) {
+    delete result;
+    errcode = kFailCode;
+    return false;
+  }
+  ReplaceValue(key, OBJECT_VSET, result);
+  errcode = kOkCode;
+  return true;
+}
+
+#undef HashTypeEraseAux
+#undef HashTypeCheckExistAux
+#undef HashTypeGetAllKeysAux
+#undef HashTypeGetCountAux
+
+void KVContainer::Snapshot(std::vector<char> &buf) {
+  /**
+   * entry binary structure
+   * +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   * | 0xFF | TYPE | EXPIRE FLAG | EXPIRE TIMESTAMP (OPTIONAL) |   KEY   |   VALUE   |   0XFE  |
+   * +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   * |  1B  |  1B  |     1B     |             8B               |   VAL   |    VAL    |    1B   |
+   * +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   */
+  size_t entry_cnt = NumItems();  // FIXME: O(n)
+  unsigned char len_buf[8];
+  EncodeFixed64BitInteger(entry_cnt, len_buf);
+  buf.insert(buf.end(), len_buf, len_buf + 8);
+  std::vector<char> entry_buf;
+  entry_buf.reserve(64);
+
+  for (const Bucket &bucket : bucket_) {
+    for (const auto& item : bucket.content) { // auto = std::pair<Key, ValueObjectPtr>
+      const Key &key = item.first;
+      std::string std_str_key = key.ToStdString();
+      const ValueObjectPtr &value = item.second;
       /* every entry has a start flag: 0xFF */
       entry_buf.emplace_back(LKVDB_ITEM_START_FLAG);
-      /* put type */
-      entry_buf.emplace_back(char(value->type));
+      /* put type, hash with expirations of fields is tagged as another type for older readers */
+      if (value->type == OBJECT_HASH && ((HashDict *)value->ptr)->NumExpires() != 0) {
+        entry_buf.emplace_back(char(LKVBD_TYPE_HASH_TTL));
+      } else {
+        entry_buf.emplace_back(char(value->type));
+      }
       /* check if this entry has expiry */
       if (sExpiresMap.count(std_str_key)) {
         entry_buf.emplace_back(char(1));
@@ -2,26 +2,37 @@
 #define __CORE_H__
 
 #include <iostream>
+#include <array>
+#include <deque>
 #include <unordered_map>
+#include <unordered_set>
 #include <queue>
 #include <vector>
 #include <fstream>
+#include <functional>
 #include <mutex>
 
 #include "str.h"
 #include "hashdict.h"
+#include "bitops.h"
 #include "dlist.h"
 #include "hashset.h"
+#include "zset.h"
 #include "valueobject.h"
 #include "lkvdb.h"
 
 static constexpr int EVICTION_POLICY_RANDOM = 0;
 static constexpr int EVICTION_POLICY_LRU = 1;
 
+static constexpr int SET_OP_INTER = 0;
+static constexpr int SET_OP_UNION = 1;
+static constexpr int SET_OP_DIFF = 2;
+
 static constexpr int kBucketSize = 512;
 static constexpr int kNumEvictCandidates = 16;
 
-static std::unordered_map<std::string, TimeEvent *> sExpiresMap;
+/* every reactor thread has its own keys and time events */
+static thread_local std::unordered_map<std::string, TimeEvent *> sExpiresMap;
 
 using HashMap = std::unordered_map<Key, ValueObjectPtr, KeyHasher, KeyEqual>;
 using LockGuard = std::unique_lock<std::mutex>;
@@ -61,21 +72,21 @@ public:
 
   int QueryObjectType(const Key &key);
 
-  int QueryObjectType(const std::string &key) {
-    return QueryObjectType(Key(key));
+  int QueryObjectType(const StringView &key) {
+    return QueryObjectType(Key::Borrow(key));
   }
 
   bool KeyExists(const Key &key);
 
   int KeyExists(const std::vector<std::string> &keys);
 
-  bool KeyExists(const std::string &key) {
-    return KeyExists(Key(key));
+  bool KeyExists(const StringView &key) {
+    return KeyExists(Key::Borrow(key));
   }
 
   size_t NumItems() const;
 
-  std::vector<std::string> RecoverCommandFromValue(const std::string& key, int &errcode);
+  std::vector<std::string> RecoverCommandFromValue(const std::string &key, int &errcode);
 
   /**
    * @brief set integer
@@ -83,52 +94,52 @@ public:
    */
   bool SetInt(const Key &key, int64_t intval);
 
-  bool SetInt(const std::string &key, int64_t intval) {
-    return SetInt(Key(key), intval);
+  bool SetInt(const StringView &key, int64_t intval) {
+    return SetInt(Key::Borrow(key), intval);
   }
 
   int64_t IncrIntBy(const Key& key, int64_t increment, int& errcode);
 
-  int64_t IncrIntBy(const std::string& key, int64_t increment, int& errcode) {
-    return IncrIntBy(Key(key), increment, errcode);
+  int64_t IncrIntBy(const StringView &key, int64_t increment, int& errcode) {
+    return IncrIntBy(Key::Borrow(key), increment, errcode);
   }
 
   int64_t IncrInt(const Key& key, int& errcode) {
     return IncrIntBy(key, 1, errcode);
   }
 
-  int64_t IncrInt(const std::string& key, int& errcode) {
-    return IncrInt(Key(key), errcode);
+  int64_t IncrInt(const StringView &key, int& errcode) {
+    return IncrInt(Key::Borrow(key), errcode);
   }
 
   int64_t DecrIntBy(const Key& key, int64_t decrement, int& errcode);
 
-  int64_t DecrIntBy(const std::string& key, int64_t increment, int& errcode) {
-    return DecrIntBy(Key(key), increment, errcode);
+  int64_t DecrIntBy(const StringView &key, int64_t increment, int& errcode) {
+    return DecrIntBy(Key::Borrow(key), increment, errcode);
   }
 
   int64_t DecrInt(const Key& key, int& errcode) {
     return DecrIntBy(key, 1, errcode);
   }
 
-  int64_t DecrInt(const std::string& key, int& errcode) {
-    return DecrInt(Key(key), errcode);
+  int64_t DecrInt(const StringView &key, int& errcode) {
+    return DecrInt(Key::Borrow(key), errcode);
   }
 
   /**
    * @brief set string
    * 
    */
-  bool SetString(const Key &key, const std::string &value);
+  bool SetString(const Key &key, const StringView &value);
 
-  bool SetString(const std::string &key, const std::string &value) {
-    return SetString(Key(key), value);
+  bool SetString(const StringView &key, const StringView &value) {
+    return SetString(Key::Borrow(key), value);
   }
 
   size_t StrLen(const Key &key, int &errcode);
 
-  size_t StrLen(const std::string &key, int &errcode) {
-    return StrLen(Key(key), errcode);
+  size_t StrLen(const StringView &key, int &errcode) {
+    return StrLen(Key::Borrow(key), errcode);
   }
 
   /**
@@ -137,20 +148,75 @@ public:
    */
   ValueObjectPtr Get(const Key &key, int &errcode);
 
-  ValueObjectPtr Get(const std::string &key, int &errcode);
+  ValueObjectPtr Get(const StringView &key, int &errcode);
 
   bool Delete(const Key &key);
 
-  bool Delete(const std::string &key) {
-    return Delete(Key(key));
+  bool Delete(const StringView &key) {
+    return Delete(Key::Borrow(key));
   }
 
   int Delete(const std::vector<std::string> &keys);
 
-  size_t Append(const Key &key, const std::string &val, int &errcode);
+  size_t Append(const Key &key, const StringView &val, int &errcode);
+
+  size_t Append(const StringView &key, const StringView &val, int &errcode) {
+    return Append(Key::Borrow(key), val, errcode);
+  }
+
+  /* substring in [start, end] of the string at key, negative index counts from the end */
+  std::string GetRange(const Key &key, int64_t start, int64_t end, int &errcode);
+
+  std::string GetRange(const StringView &key, int64_t start, int64_t end, int &errcode) {
+    return GetRange(Key::Borrow(key), start, end, errcode);
+  }
+
+  /* overwrite the string at key from offset, return the length after modification */
+  size_t SetRange(const Key &key, uint32_t offset, const std::string &value, int &errcode);
+
+  size_t SetRange(const StringView &key, uint32_t offset, const std::string &value, int &errcode) {
+    return SetRange(Key::Borrow(key), offset, value, errcode);
+  }
+
+  /* set or clear the bit at offset of the string at key, return the original bit */
+  int SetBit(const Key &key, uint64_t offset, int bit, int &errcode);
+
+  int SetBit(const StringView &key, uint64_t offset, int bit, int &errcode) {
+    return SetBit(Key::Borrow(key), offset, bit, errcode);
+  }
+
+  int GetBit(const Key &key, uint64_t offset, int &errcode);
+
+  int GetBit(const StringView &key, uint64_t offset, int &errcode) {
+    return GetBit(Key::Borrow(key), offset, errcode);
+  }
+
+  /* number of set bits in [start, end] of the string at key,
+   * start and end are byte index, or bit index if bit_unit is true */
+  size_t BitCount(const Key &key, int64_t start, int64_t end, bool bit_unit, int &errcode);
+
+  size_t BitCount(const StringView &key, int64_t start, int64_t end, bool bit_unit,
+                  int &errcode) {
+    return BitCount(Key::Borrow(key), start, end, bit_unit, errcode);
+  }
+
+  /* position of the first bit equals to bit in [start, end] of the string at key, -1 if not found,
+   * looking for a clear bit without end_given returns the bit right after the string */
+  int64_t BitPos(const Key &key, int bit, int64_t start, int64_t end, bool end_given,
+                 bool bit_unit, int &errcode);
 
-  size_t Append(const std::string &key, const std::string &val, int &errcode) {
-    return Append(Key(key), val, errcode);
+  int64_t BitPos(const StringView &key, int bit, int64_t start, int64_t end, bool end_given,
+                 bool bit_unit, int &errcode) {
+    return BitPos(Key::Borrow(key), bit, start, end, end_given, bit_unit, errcode);
+  }
+
+  /* store the result of BITOP_* on strings at keys into dst, an empty result deletes dst,
+   * return the length of dst */
+  size_t BitOp(int op, const Key &dst, const std::vector<std::string> &keys, int &errcode);
+
+  size_t BitOp(int op, const StringView &dst, const std::vector<std::string> &keys,
+               int &errcode) {
+    return BitOp(op, Key::Borrow(dst), keys, errcode);
   }
 
   /******************** List operation ********************/
@@ -163,10 +229,10 @@ public:
    */
   bool LeftPush(const Key &key, const std::string &val, int &errcode);
 
-  size_t LeftPush(const std::string &key, const std::vector<std::string> &values, int &errcode);
+  size_t LeftPush(const StringView &key, const std::vector<std::string> &values, int &errcode);
 
-  bool LeftPush(const std::string &key, const std::string &val, int &errcode) {
-    return LeftPush(Key(key), val, errcode);
+  bool LeftPush(const StringView &key, const std::string &val, int &errcode) {
+    return LeftPush(Key::Borrow(key), val, errcode);
   }
 
   /**
@@ -177,10 +243,10 @@ public:
    */
   bool RightPush(const Key &key, const std::string &val, int &errcode);
 
-  size_t RightPush(const std::string &key, const std::vector<std::string> &values, int &errcode);
+  size_t RightPush(const StringView &key, const std::vector<std::string> &values, int &errcode);
 
-  bool RightPush(const std::string &key, const std::string &val, int &errcode) {
-    return RightPush(Key(key), val, errcode);
+  bool RightPush(const StringView &key, const std::string &val, int &errcode) {
+    return RightPush(Key::Borrow(key), val, errcode);
   }
 
   /**
@@ -189,8 +255,8 @@ public:
    */
   DynamicString LeftPop(const Key &key, int &errcode);
 
-  DynamicString LeftPop(const std::string &key, int &errcode) {
-    return LeftPop(Key(key), errcode);
+  DynamicString LeftPop(const StringView &key, int &errcode) {
+    return LeftPop(Key::Borrow(key), errcode);
   }
 
   /**
@@ -199,8 +265,8 @@ public:
    */
   DynamicString RightPop(const Key &key, int &errcode);
 
-  DynamicString RightPop(const std::string &key, int &errcode) {
-    return RightPop(Key(key), errcode);
+  DynamicString RightPop(const StringView &key, int &errcode) {
+    return RightPop(Key::Borrow(key), errcode);
   }
 
   /**
@@ -209,14 +275,25 @@ public:
    */
   std::vector<DynamicString> ListRange(const Key &key, int begin, int end, int &errcode);
 
-  std::vector<DynamicString> ListRange(const std::string &key, int begin, int end, int &errcode) {
-    return ListRange(Key(key), begin, end, errcode);
+  std::vector<DynamicString> ListRange(const StringView &key, int begin, int end, int &errcode) {
+    return ListRange(Key::Borrow(key), begin, end, errcode);
+  }
+
+  /* pass the number of items in range to size, then every item to emit, without copying them out,
+   * the callbacks are not called for an empty range, return the number of items */
+  size_t ListRange(const Key &key, int begin, int end, const std::function<void(size_t)> &size,
+                   const std::function<void(const DynamicString &)> &emit, int &errcode);
+
+  size_t ListRange(const StringView &key, int begin, int end,
+                   const std::function<void(size_t)> &size,
+                   const std::function<void(const DynamicString &)> &emit, int &errcode) {
+    return ListRange(Key::Borrow(key), begin, end, size, emit, errcode);
   }
 
   std::vector<std::string> ListRangeAsStdString(const Key &key, int begin, int end, int &errcode);
 
-  std::vector<std::string> ListRangeAsStdString(const std::string &key, int begin, int end, int &errcode) {
-    return ListRangeAsStdString(Key(key), begin, end, errcode);
+  std::vector<std::string> ListRangeAsStdString(const StringView &key, int begin, int end, int &errcode) {
+    return ListRangeAsStdString(Key::Borrow(key), begin, end, errcode);
   }
 
   /**
@@ -226,8 +303,8 @@ public:
    */
   size_t ListLen(const Key &key, int &errcode);
 
-  size_t ListLen(const std::string &key, int &errcode) {
-    return ListLen(Key(key), errcode);
+  size_t ListLen(const StringView &key, int &errcode) {
+    return ListLen(Key::Borrow(key), errcode);
   }
 
   /**
@@ -236,22 +313,56 @@ public:
    */
   DynamicString ListItemAtIndex(const Key &key, int index, int &errcode);
 
-  DynamicString ListItemAtIndex(const std::string &key, int index, int &errcode) {
-    return ListItemAtIndex(Key(key), index, errcode);
+  DynamicString ListItemAtIndex(const StringView &key, int index, int &errcode) {
+    return ListItemAtIndex(Key::Borrow(key), index, errcode);
   }
 
   bool ListSetItemAtIndex(const Key &key, int index, const std::string &val, int &errcode);
 
-  bool ListSetItemAtIndex(const std::string &key, int index, const std::string &val, int &errcode) {
-    return ListSetItemAtIndex(Key(key), index, val, errcode);
+  bool ListSetItemAtIndex(const StringView &key, int index, const std::string &val, int &errcode) {
+    return ListSetItemAtIndex(Key::Borrow(key), index, val, errcode);
+  }
+
+  /**
+   * @brief insert val before or after the first occurrence of pivot in a list
+   *
+   * @return list length after insertion, -1 if pivot is not found
+   */
+  long ListInsert(const Key &key, bool before, const std::string &pivot, const std::string &val, int &errcode);
+
+  long ListInsert(const StringView &key, bool before, const std::string &pivot, const std::string &val,
+                  int &errcode) {
+    return ListInsert(Key::Borrow(key), before, pivot, val, errcode);
+  }
+
+  /**
+   * @brief remove the first count occurrences of val from a list, count < 0 removes
+   * from the tail and count = 0 removes all of them
+   *
+   * @return number of removed items
+   */
+  size_t ListRemove(const Key &key, long count, const std::string &val, int &errcode);
+
+  size_t ListRemove(const StringView &key, long count, const std::string &val, int &errcode) {
+    return ListRemove(Key::Borrow(key), count, val, errcode);
+  }
+
+  /**
+   * @brief trim a list so that it only contains items in range [begin, end]
+   *
+   */
+  bool ListTrim(const Key &key, int begin, int end, int &errcode);
+
+  bool ListTrim(const StringView &key, int begin, int end, int &errcode) {
+    return ListTrim(Key::Borrow(key), begin, end, errcode);
   }
 
   /******************** HashDict operation ********************/
 
   bool HashUpdateKV(const Key &key, const HEntryKey &field, const HEntryVal &value, int &errcode);
 
-  bool HashUpdateKV(const std::string &key, const std::string &field, const std::string &value, int &errcode) {
-    return HashUpdateKV(Key(key), HEntryKey(field), HEntryVal(value), errcode);
+  bool HashUpdateKV(const StringView &key, const std::string &field, const std::string &value, int &errcode) {
+    return HashUpdateKV(Key::Borrow(key), HEntryKey(field), HEntryVal(value), errcode);
   }
 
   int HashUpdateKV(const Key &key, const std::vector<std::string> &fields,
@@ -259,95 +370,599 @@ public:
 
   HEntryVal HashGetValue(const Key &key, const HEntryKey &field, int &errcode);
 
-  HEntryVal HashGetValue(const std::string &key, const std::string &field, int &errcode) {
-    return HashGetValue(Key(key), HEntryKey(field), errcode);
+  HEntryVal HashGetValue(const StringView &key, const std::string &field, int &errcode) {
+    return HashGetValue(Key::Borrow(key), HEntryKey(field), errcode);
   }
 
   std::vector<HEntryVal> HashGetValue(const Key& key, const std::vector<std::string>& fields, int &errcode);
 
   int HashDelField(const Key &key, const HEntryKey &field, int &errcode);
 
-  int HashDelField(const std::string &key, const std::string &field, int &errcode) {
-    return HashDelField(Key(key), HEntryKey(field), errcode);
+  int HashDelField(const StringView &key, const std::string &field, int &errcode) {
+    return HashDelField(Key::Borrow(key), HEntryKey(field), errcode);
   }
 
   int HashDelField(const Key &key, const std::vector<std::string> &fields, int &errcode);
 
   bool HashExistField(const Key &key, const HEntryKey &field, int &errcode);
 
-  bool HashExistField(const std::string &key, const std::string &field, int &errcode) {
-    return HashExistField(Key(key), HEntryKey(field), errcode);
+  bool HashExistField(const StringView &key, const std::string &field, int &errcode) {
+    return HashExistField(Key::Borrow(key), HEntryKey(field), errcode);
   }
 
   std::vector<DynamicString> HashGetAllEntries(const Key &key, int &errcode);
 
-  std::vector<DynamicString> HashGetAllEntries(const std::string &key, int &errcode) {
-    return HashGetAllEntries(Key(key), errcode);
+  std::vector<DynamicString> HashGetAllEntries(const StringView &key, int &errcode) {
+    return HashGetAllEntries(Key::Borrow(key), errcode);
+  }
+
+  /* pass the number of fields to size, then every field and its value to emit, without copying
+   * them out, the callbacks are not called for an empty hash, return the number of fields */
+  size_t HashGetAllEntries(const Key &key, const std::function<void(size_t)> &size,
+                           const std::function<void(const HEntryKey &, const HEntryVal &)> &emit,
+                           int &errcode);
+
+  size_t HashGetAllEntries(const StringView &key, const std::function<void(size_t)> &size,
+                           const std::function<void(const HEntryKey &, const HEntryVal &)> &emit,
+                           int &errcode) {
+    return HashGetAllEntries(Key::Borrow(key), size, emit, errcode);
   }
 
   std::vector<HEntryKey> HashGetAllFields(const Key &key, int &errcode);
 
-  std::vector<HEntryKey> HashGetAllFields(const std::string &key, int &errcode) {
-    return HashGetAllFields(Key(key), errcode);
+  std::vector<HEntryKey> HashGetAllFields(const StringView &key, int &errcode) {
+    return HashGetAllFields(Key::Borrow(key), errcode);
   }
 
   std::vector<HEntryVal> HashGetAllValues(const Key &key, int &errcode);
 
-  std::vector<HEntryVal> HashGetAllValues(const std::string &key, int &errcode) {
-    return HashGetAllValues(Key(key), errcode);
+  std::vector<HEntryVal> HashGetAllValues(const StringView &key, int &errcode) {
+    return HashGetAllValues(Key::Borrow(key), errcode);
   }
 
   size_t HashLen(const Key &key, int &errcode);
 
-  size_t HashLen(const std::string &key, int &errcode) {
-    return HashLen(Key(key), errcode);
+  size_t HashLen(const StringView &key, int &errcode) {
+    return HashLen(Key::Borrow(key), errcode);
+  }
+
+  /**
+   * @brief Increase the integer value of field by increment, the field is set to increment if it
+   * does not exist, its expiration is kept
+   *
+   * @return the value after increment; kFailCode if the value is not an integer, kOverflowCode if
+   * the result overflows
+   */
+  int64_t HashIncrBy(const Key &key, const HEntryKey &field, int64_t increment, int &errcode);
+
+  int64_t HashIncrBy(const StringView &key, const std::string &field, int64_t increment,
+                     int &errcode) {
+    return HashIncrBy(Key::Borrow(key), HEntryKey(field), increment, errcode);
+  }
+
+  /* same as HashIncrBy with float value, return the value formatted after increment, kFailCode
+   * if the value is not a number or the result is not finite */
+  std::string HashIncrByFloat(const Key &key, const HEntryKey &field, long double increment,
+                              int &errcode);
+
+  std::string HashIncrByFloat(const StringView &key, const std::string &field,
+                              long double increment, int &errcode) {
+    return HashIncrByFloat(Key::Borrow(key), HEntryKey(field), increment, errcode);
+  }
+
+  /* set field only if it does not exist, return false if it exists */
+  bool HashSetNX(const Key &key, const HEntryKey &field, const HEntryVal &value, int &errcode);
+
+  bool HashSetNX(const StringView &key, const std::string &field, const std::string &value,
+                 int &errcode) {
+    return HashSetNX(Key::Borrow(key), HEntryKey(field), HEntryVal(value), errcode);
+  }
+
+  /**
+   * @brief Set the expiration of fields in unix milliseconds
+   *
+   * @return for every field, -2 if it does not exist, 1 if expiration is set, 2 if it is deleted
+   * because when is not in the future
+   */
+  std::vector<int> HashFieldExpireAt(const Key &key, const std::vector<std::string> &fields,
+                                     uint64_t when, int &errcode);
+
+  std::vector<int> HashFieldExpireAt(const StringView &key, const std::vector<std::string> &fields,
+                                     uint64_t when, int &errcode) {
+    return HashFieldExpireAt(Key::Borrow(key), fields, when, errcode);
   }
 
+  /* expiration of every field in unix milliseconds, -1 if it has none, -2 if it does not exist */
+  std::vector<int64_t> HashFieldExpireTime(const Key &key, const std::vector<std::string> &fields,
+                                           int &errcode);
+
+  std::vector<int64_t> HashFieldExpireTime(const StringView &key,
+                                           const std::vector<std::string> &fields, int &errcode) {
+    return HashFieldExpireTime(Key::Borrow(key), fields, errcode);
+  }
+
+  /* remove the expiration of fields, for every field -2 if it does not exist, -1 if it has no
+   * expiration, 1 if expiration is removed */
+  std::vector<int> HashFieldPersist(const Key &key, const std::vector<std::string> &fields,
+                                    int &errcode);
+
+  std::vector<int> HashFieldPersist(const StringView &key, const std::vector<std::string> &fields,
+                                    int &errcode) {
+    return HashFieldPersist(Key::Borrow(key), fields, errcode);
+  }
+
+  /* delete expired fields of at most n_keys hashes with field expirations in turn,
+   * return the number of fields deleted */
+  size_t HashActiveExpire(size_t n_keys);
+
   /******************** HashSet operation ********************/
 
   bool SetAddItem(const Key &key, const HEntryKey &member, int &errcode);
 
-  bool SetAddItem(const std::string &key, const std::string &member, int &errcode) {
-    return SetAddItem(Key(key), HEntryKey(member), errcode);
+  bool SetAddItem(const StringView &key, const std::string &member, int &errcode) {
+    return SetAddItem(Key::Borrow(key), HEntryKey(member), errcode);
   }
 
   int SetAddItem(const Key &key, const std::vector<std::string> &members, int &errcode);
 
-  int SetAddItem(const std::string &key, const std::vector<std::string> &members, int &errcode) {
-    return SetAddItem(Key(key), members, errcode);
+  int SetAddItem(const StringView &key, const std::vector<std::string> &members, int &errcode) {
+    return SetAddItem(Key::Borrow(key), members, errcode);
   }
 
   bool SetIsMember(const Key &key, const HEntryKey &member, int &errcode);
 
-  bool SetIsMember(const std::string &key, const std::string &member, int &errcode) {
-    return SetIsMember(Key(key), HEntryKey(member), errcode);
+  bool SetIsMember(const StringView &key, const std::string &member, int &errcode) {
+    return SetIsMember(Key::Borrow(key), HEntryKey(member), errcode);
   }
 
   std::vector<int> SetMIsMember(const Key &key, const std::vector<std::string> &members,
                                 int &errcode);
 
-  std::vector<int> SetMIsMember(const std::string &key, const std::vector<std::string> &members,
+  std::vector<int> SetMIsMember(const StringView &key, const std::vector<std::string> &members,
                                 int &errcode) {
-    return SetMIsMember(Key(key), members, errcode);
+    return SetMIsMember(Key::Borrow(key), members, errcode);
   }
 
   int SetRemoveMembers(const Key &key, const std::vector<std::string> &members, int &errcode);
 
-  bool SetRemoveMembers(const std::string &key, const std::vector<std::string> &members,
+  bool SetRemoveMembers(const StringView &key, const std::vector<std::string> &members,
                         int &errcode) {
-    return SetRemoveMembers(Key(key), members, errcode);
+    return SetRemoveMembers(Key::Borrow(key), members, errcode);
   }
 
   std::vector<HEntryKey> SetGetMembers(const Key &key, int &errcode);
 
-  std::vector<HEntryKey> SetGetMembers(const std::string &key, int &errcode) {
-    return SetGetMembers(Key(key), errcode);
+  std::vector<HEntryKey> SetGetMembers(const StringView &key, int &errcode) {
+    return SetGetMembers(Key::Borrow(key), errcode);
   }
 
   size_t SetGetMemberCount(const Key &key, int &errcode);
 
-  size_t SetGetMemberCount(const std::string &key, int &errcode) {
-    return SetGetMemberCount(Key(key), errcode);
+  size_t SetGetMemberCount(const StringView &key, int &errcode) {
+    return SetGetMemberCount(Key::Borrow(key), errcode);
+  }
+
+  /* random members of set at key, count > 0 returns at most count distinct members,
+   * count < 0 returns -count members which may repeat */
+  std::vector<HEntryKey> SetRandomMembers(const Key &key, long count, int &errcode);
+
+  std::vector<HEntryKey> SetRandomMembers(const StringView &key, long count, int &errcode) {
+    return SetRandomMembers(Key::Borrow(key), count, errcode);
+  }
+
+  /* remove and return at most count random members of set at key */
+  std::vector<HEntryKey> SetPopMembers(const Key &key, size_t count, int &errcode);
+
+  std::vector<HEntryKey> SetPopMembers(const StringView &key, size_t count, int &errcode) {
+    return SetPopMembers(Key::Borrow(key), count, errcode);
+  }
+
+  /* apply set operation SET_OP_* on the sets at keys, non-existing keys are taken as empty sets,
+   * every member of the result is passed to emit, which returns false to stop early */
+  bool SetAlgebra(int op, const std::vector<std::string> &keys,
+                  const std::function<bool(const HEntryKey &)> &emit, int &errcode);
+
+  /* store the result of set operation into dst, an empty result deletes dst,
+   * return the number of members in dst */
+  size_t SetAlgebraStore(int op, const Key &dst, const std::vector<std::string> &keys,
+                         int &errcode);
+
+  size_t SetAlgebraStore(int op, const StringView &dst, const std::vector<std::string> &keys,
+                         int &errcode) {
+    return SetAlgebraStore(op, Key::Borrow(dst), keys, errcode);
+  }
+
+  /******************** ZSet operation ********************/
+
+  /* add or update (score, member) pairs, nx only adds new members and xx only updates
+   * existing ones, return the number of added members (or changed members if ch is set) */
+  int ZSetAdd(const Key &key, const std::vector<std::pair<int64_t, std::string>> &items, bool nx,
+              bool xx, bool ch, int &errcode);
+
+  int ZSetAdd(const StringView &key, const std::vector<std::pair<int64_t, std::string>> &items,
+              bool nx, bool xx, bool ch, int &errcode) {
+    return ZSetAdd(Key::Borrow(key), items, nx, xx, ch, errcode);
+  }
+
+  int64_t ZSetIncrBy(const Key &key, const std::string &member, int64_t increment, int &errcode);
+
+  int64_t ZSetIncrBy(const StringView &key, const std::string &member, int64_t increment,
+                     int &errcode) {
+    return ZSetIncrBy(Key::Borrow(key), member, increment, errcode);
+  }
+
+  bool ZSetScore(const Key &key, const std::string &member, int64_t &score, int &errcode);
+
+  bool ZSetScore(const StringView &key, const std::string &member, int64_t &score,
+                 int &errcode) {
+    return ZSetScore(Key::Borrow(key), member, score, errcode);
+  }
+
+  int ZSetRemove(const Key &key, const std::vector<std::string> &members, int &errcode);
+
+  int ZSetRemove(const StringView &key, const std::vector<std::string> &members, int &errcode) {
+    return ZSetRemove(Key::Borrow(key), members, errcode);
+  }
+
+  size_t ZSetCard(const Key &key, int &errcode);
+
+  size_t ZSetCard(const StringView &key, int &errcode) {
+    return ZSetCard(Key::Borrow(key), errcode);
+  }
+
+  /* 0-based rank of member, -1 if member not found */
+  long ZSetRank(const Key &key, const std::string &member, int &errcode);
+
+  long ZSetRank(const StringView &key, const std::string &member, int &errcode) {
+    return ZSetRank(Key::Borrow(key), member, errcode);
+  }
+
+  /* items with rank in [begin, end], negative index supported */
+  std::vector<ZSetItem> ZSetRange(const Key &key, long begin, long end, int &errcode);
+
+  std::vector<ZSetItem> ZSetRange(const StringView &key, long begin, long end, int &errcode) {
+    return ZSetRange(Key::Borrow(key), begin, end, errcode);
+  }
+
+  std::vector<ZSetItem> ZSetRangeByScore(const Key &key, const ZScoreRange &range, size_t offset,
+                                         long count, int &errcode);
+
+  std::vector<ZSetItem> ZSetRangeByScore(const StringView &key, const ZScoreRange &range,
+                                         size_t offset, long count, int &errcode) {
+    return ZSetRangeByScore(Key::Borrow(key), range, offset, count, errcode);
+  }
+
+  std::vector<ZSetItem> ZSetPopMin(const Key &key, size_t count, int &errcode);
+
+  std::vector<ZSetItem> ZSetPopMin(const StringView &key, size_t count, int &errcode) {
+    return ZSetPopMin(Key::Borrow(key), count, errcode);
+  }
+
+  /******************** HyperLogLog operation ********************/
+
+  /* add elements into hyperloglog at key, key is created if not exists,
+   * return 1 if key is created or any register is changed, otherwise 0 */
+  int HLLAdd(const Key &key, const std::vector<std::string> &elems, int &errcode);
+
+  int HLLAdd(const StringView &key, const std::vector<std::string> &elems, int &errcode) {
+    return HLLAdd(Key::Borrow(key), elems, errcode);
+  }
+
+  /* estimated cardinality of the union of hyperloglogs at keys, non-existing keys are skipped */
+  uint64_t HLLCount(const std::vector<std::string> &keys, int &errcode);
+
+  /* merge hyperloglogs at keys into dst, dst is created if not exists */
+  bool HLLMerge(const Key &dst, const std::vector<std::string> &keys, int &errcode);
+
+  bool HLLMerge(const StringView &dst, const std::vector<std::string> &keys, int &errcode) {
+    return HLLMerge(Key::Borrow(dst), keys, errcode);
+  }
+
+  /* overwrite key with hyperloglog restored from data given by HyperLogLog::Dump */
+  bool HLLRestore(const Key &key, const std::string &data, int &errcode);
+
+  bool HLLRestore(const StringView &key, const std::string &data, int &errcode) {
+    return HLLRestore(Key::Borrow(key), data, errcode);
+  }
+
+  /******************** Count-Min Sketch operation ********************/
+
+  /* create a count-min sketch at key, fail with kFailCode if key exists */
+  bool CMSInit(const Key &key, uint32_t width, uint32_t depth, int &errcode);
+
+  bool CMSInit(const StringView &key, uint32_t width, uint32_t depth, int &errcode) {
+    return CMSInit(Key::Borrow(key), width, depth, errcode);
+  }
+
+  /* increase items[i] by increments[i], return estimated counts after increment */
+  std::vector<uint32_t> CMSIncrBy(const Key &key, const std::vector<std::string> &items,
+                                  const std::vector<uint32_t> &increments, int &errcode);
+
+  std::vector<uint32_t> CMSIncrBy(const StringView &key, const std::vector<std::string> &items,
+                                  const std::vector<uint32_t> &increments, int &errcode) {
+    return CMSIncrBy(Key::Borrow(key), items, increments, errcode);
+  }
+
+  std::vector<uint32_t> CMSQuery(const Key &key, const std::vector<std::string> &items,
+                                 int &errcode);
+
+  std::vector<uint32_t> CMSQuery(const StringView &key, const std::vector<std::string> &items,
+                                 int &errcode) {
+    return CMSQuery(Key::Borrow(key), items, errcode);
+  }
+
+  /* dst = sum of weights[i] * keys[i], dst and all keys must exist,
+   * fail with kFailCode if their dimensions differ */
+  bool CMSMerge(const Key &dst, const std::vector<std::string> &keys,
+                const std::vector<uint32_t> &weights, int &errcode);
+
+  bool CMSMerge(const StringView &dst, const std::vector<std::string> &keys,
+                const std::vector<uint32_t> &weights, int &errcode) {
+    return CMSMerge(Key::Borrow(dst), keys, weights, errcode);
+  }
+
+  /* overwrite key with count-min sketch restored from data given by CountMinSketch::Dump */
+  bool CMSRestore(const Key &key, const std::string &data, int &errcode);
+
+  bool CMSRestore(const StringView &key, const std::string &data, int &errcode) {
+    return CMSRestore(Key::Borrow(key), data, errcode);
+  }
+
+  /******************** Top-K operation ********************/
+
+  /* create a top-k at key, fail with kFailCode if key exists */
+  bool TopKReserve(const Key &key, uint32_t k, uint32_t width, uint32_t depth, double decay,
+                   int &errcode);
+
+  bool TopKReserve(const StringView &key, uint32_t k, uint32_t width, uint32_t depth,
+                   double decay, int &errcode) {
+    return TopKReserve(Key::Borrow(key), k, width, depth, decay, errcode);
+  }
+
+  /* add items[i] with increments[i], return whether an item is expelled and which one */
+  std::vector<std::pair<bool, std::string>> TopKAdd(const Key &key,
+                                                    const std::vector<std::string> &items,
+                                                    const std::vector<uint32_t> &increments,
+                                                    int &errcode);
+
+  std::vector<std::pair<bool, std::string>> TopKAdd(const StringView &key,
+                                                    const std::vector<std::string> &items,
+                                                    const std::vector<uint32_t> &increments,
+                                                    int &errcode) {
+    return TopKAdd(Key::Borrow(key), items, increments, errcode);
+  }
+
+  std::vector<bool> TopKQuery(const Key &key, const std::vector<std::string> &items, int &errcode);
+
+  std::vector<bool> TopKQuery(const StringView &key, const std::vector<std::string> &items,
+                              int &errcode) {
+    return TopKQuery(Key::Borrow(key), items, errcode);
+  }
+
+  /* top k items sorted by count from high to low */
+  std::vector<TopKItem> TopKList(const Key &key, int &errcode);
+
+  std::vector<TopKItem> TopKList(const StringView &key, int &errcode) {
+    return TopKList(Key::Borrow(key), errcode);
+  }
+
+  /* overwrite key with top-k restored from data given by TopK::Dump */
+  bool TopKRestore(const Key &key, const std::string &data, int &errcode);
+
+  bool TopKRestore(const StringView &key, const std::string &data, int &errcode) {
+    return TopKRestore(Key::Borrow(key), data, errcode);
+  }
+
+  /******************** Bloom Filter operation ********************/
+
+  /* create a bloom filter at key, fail with kFailCode if key exists or it is too large */
+  bool BFReserve(const Key &key, double error_rate, uint64_t capacity, uint32_t expansion,
+                 bool nonscaling, int &errcode);
+
+  bool BFReserve(const StringView &key, double error_rate, uint64_t capacity, uint32_t expansion,
+                 bool nonscaling, int &errcode) {
+    return BFReserve(Key::Borrow(key), error_rate, capacity, expansion, nonscaling, errcode);
+  }
+
+  /* add items into bloom filter at key which is created with default parameters if not exists,
+   * return kBloomAdded, kBloomExists or kBloomFull for each item */
+  std::vector<int> BFAdd(const Key &key, const std::vector<std::string> &items, int &errcode);
+
+  std::vector<int> BFAdd(const StringView &key, const std::vector<std::string> &items,
+                         int &errcode) {
+    return BFAdd(Key::Borrow(key), items, errcode);
+  }
+
+  /* 1 if item may exist and 0 if it does not for each item, all 0 if key does not exist */
+  std::vector<int> BFExists(const Key &key, const std::vector<std::string> &items, int &errcode);
+
+  std::vector<int> BFExists(const StringView &key, const std::vector<std::string> &items,
+                            int &errcode) {
+    return BFExists(Key::Borrow(key), items, errcode);
+  }
+
+  /* overwrite key with bloom filter restored from data given by BloomFilter::Dump */
+  bool BFRestore(const Key &key, const char *data, size_t len, int &errcode);
+
+  bool BFRestore(const StringView &key, const std::string &data, int &errcode) {
+    return BFRestore(Key::Borrow(key), data.data(), data.size(), errcode);
+  }
+
+  /******************** Stream operation ********************/
+
+  /**
+   * @brief Append an entry into stream at key
+   *
+   * @param nomkstream do not create the stream if key does not exist, kKeyNotFoundCode is given
+   * @param id the id of the added entry
+   * @return false with kFailCode if id is not greater than the last id of stream
+   */
+  bool StreamAdd(const Key &key, const StreamIDSpec &spec, const std::vector<std::string> &fields,
+                 bool nomkstream, StreamID &id, int &errcode);
+
+  bool StreamAdd(const StringView &key, const StreamIDSpec &spec,
+                 const std::vector<std::string> &fields, bool nomkstream, StreamID &id,
+                 int &errcode) {
+    return StreamAdd(Key::Borrow(key), spec, fields, nomkstream, id, errcode);
+  }
+
+  /* entries with id in [start, end], from high to low if reversed, count 0 means no limit */
+  std::vector<StreamEntry> StreamRange(const Key &key, const StreamID &start, const StreamID &end,
+                                       size_t count, bool reversed, int &errcode);
+
+  std::vector<StreamEntry> StreamRange(const StringView &key, const StreamID &start,
+                                       const StreamID &end, size_t count, bool reversed,
+                                       int &errcode) {
+    return StreamRange(Key::Borrow(key), start, end, count, reversed, errcode);
+  }
+
+  uint64_t StreamLength(const Key &key, int &errcode);
+
+  uint64_t StreamLength(const StringView &key, int &errcode) {
+    return StreamLength(Key::Borrow(key), errcode);
+  }
+
+  /* id of the last entry ever added into stream at key */
+  StreamID StreamLastID(const Key &key, int &errcode);
+
+  StreamID StreamLastID(const StringView &key, int &errcode) {
+    return StreamLastID(Key::Borrow(key), errcode);
+  }
+
+  /* keep at most maxlen entries, return the number of entries removed */
+  uint64_t StreamTrimByLength(const Key &key, uint64_t maxlen, bool approx, int &errcode);
+
+  uint64_t StreamTrimByLength(const StringView &key, uint64_t maxlen, bool approx,
+                              int &errcode) {
+    return StreamTrimByLength(Key::Borrow(key), maxlen, approx, errcode);
+  }
+
+  /* remove entries with id less than minid, return the number of entries removed */
+  uint64_t StreamTrimByMinID(const Key &key, const StreamID &minid, bool approx, int &errcode);
+
+  uint64_t StreamTrimByMinID(const StringView &key, const StreamID &minid, bool approx,
+                             int &errcode) {
+    return StreamTrimByMinID(Key::Borrow(key), minid, approx, errcode);
+  }
+
+  /* overwrite key with stream restored from data given by Stream::Dump */
+  bool StreamRestore(const Key &key, const char *data, size_t len, int &errcode);
+
+  bool StreamRestore(const StringView &key, const std::string &data, int &errcode) {
+    return StreamRestore(Key::Borrow(key), data.data(), data.size(), errcode);
+  }
+
+  /******************** Time series operation ********************/
+
+  /* create an empty time series, return false with kFailCode if key already exists */
+  bool TSCreate(const Key &key, uint64_t retention_ms, int &errcode);
+
+  bool TSCreate(const StringView &key, uint64_t retention_ms, int &errcode) {
+    return TSCreate(Key::Borrow(key), retention_ms, errcode);
+  }
+
+  /**
+   * @brief Append a sample into time series at key
+   *
+   * @param retention_ms retention of the time series if it is created by this call
+   * @return false with kFailCode if timestamp is not greater than the last one
+   */
+  bool TSAdd(const Key &key, int64_t timestamp, double value, uint64_t retention_ms,
+             int &errcode);
+
+  bool TSAdd(const StringView &key, int64_t timestamp, double value, uint64_t retention_ms,
+             int &errcode) {
+    return TSAdd(Key::Borrow(key), timestamp, value, retention_ms, errcode);
+  }
+
+  /* last sample of time series, false if it has no sample */
+  bool TSGet(const Key &key, TSSample &sample, int &errcode);
+
+  bool TSGet(const StringView &key, TSSample &sample, int &errcode) {
+    return TSGet(Key::Borrow(key), sample, errcode);
+  }
+
+  /* samples with timestamp in [from, to], count 0 means no limit */
+  std::vector<TSSample> TSRange(const Key &key, int64_t from, int64_t to, size_t count,
+                                int &errcode);
+
+  std::vector<TSSample> TSRange(const StringView &key, int64_t from, int64_t to, size_t count,
+                                int &errcode) {
+    return TSRange(Key::Borrow(key), from, to, count, errcode);
+  }
+
+  /* samples with timestamp in [from, to] aggregated into buckets of bucket_ms */
+  std::vector<TSSample> TSAggregate(const Key &key, int64_t from, int64_t to, int aggregation,
+                                    uint64_t bucket_ms, size_t count, int &errcode);
+
+  std::vector<TSSample> TSAggregate(const StringView &key, int64_t from, int64_t to,
+                                    int aggregation, uint64_t bucket_ms, size_t count,
+                                    int &errcode) {
+    return TSAggregate(Key::Borrow(key), from, to, aggregation, bucket_ms, count, errcode);
+  }
+
+  /* overwrite key with time series restored from data given by TimeSeries::Dump */
+  bool TSRestore(const Key &key, const char *data, size_t len, int &errcode);
+
+  bool TSRestore(const StringView &key, const std::string &data, int &errcode) {
+    return TSRestore(Key::Borrow(key), data.data(), data.size(), errcode);
+  }
+
+  /******************** Vector set operation ********************/
+
+  /**
+   * @brief Add element with vector into vector set at key
+   *
+   * @param metric distance metric of the vector set if it is created by this call
+   * @param quantized whether vectors are quantized into int8 if it is created by this call
+   * @return true if element is added, false if it exists and its vector is updated;
+   * kFailCode if the dimension of vec does not match the vector set
+   */
+  bool VAdd(const Key &key, const std::string &element, const std::vector<float> &vec, int metric,
+            bool quantized, int &errcode);
+
+  bool VAdd(const StringView &key, const std::string &element, const std::vector<float> &vec,
+            int metric, bool quantized, int &errcode) {
+    return VAdd(Key::Borrow(key), element, vec, metric, quantized, errcode);
+  }
+
+  /* return false if element does not exist */
+  bool VRem(const Key &key, const std::string &element, int &errcode);
+
+  bool VRem(const StringView &key, const std::string &element, int &errcode) {
+    return VRem(Key::Borrow(key), element, errcode);
+  }
+
+  /* k nearest elements of query, kFailCode if the dimension of query does not match */
+  std::vector<VecMatch> VSim(const Key &key, const std::vector<float> &query, size_t k, size_t ef,
+                             int &errcode);
+
+  std::vector<VecMatch> VSim(const StringView &key, const std::vector<float> &query, size_t k,
+                             size_t ef, int &errcode) {
+    return VSim(Key::Borrow(key), query, k, ef, errcode);
+  }
+
+  uint64_t VCard(const Key &key, int &errcode);
+
+  uint64_t VCard(const StringView &key, int &errcode) { return VCard(Key::Borrow(key), errcode); }
+
+  uint32_t VDim(const Key &key, int &errcode);
+
+  uint32_t VDim(const StringView &key, int &errcode) { return VDim(Key::Borrow(key), errcode); }
+
+  /* vector of element as stored, false if element does not exist */
+  bool VEmb(const Key &key, const std::string &element, std::vector<float> &vec, int &errcode);
+
+  bool VEmb(const StringView &key, const std::string &element, std::vector<float> &vec,
+            int &errcode) {
+    return VEmb(Key::Borrow(key), element, vec, errcode);
+  }
+
+  /* overwrite key with vector set restored from data given by VectorSet::Dump */
+  bool VRestore(const Key &key, const char *data, size_t len, int &errcode);
+
+  bool VRestore(const StringView &key, const std::string &data, int &errcode) {
+    return VRestore(Key::Borrow(key), data.data(), data.size(), errcode);
   }
 
   /**
@@ -357,18 +972,43 @@ public:
    */
   void Snapshot(std::vector<char> &buf);
 
+  /* index of the bucket holding key */
+  static inline size_t BucketIndex(const char *key, size_t len) {
+    return Time33Hash(key, len) % kBucketSize;
+  }
+
 private:
   inline Bucket &GetBucket(const Key &key) {
     size_t bucket_idx = key.Hash() % kBucketSize;
     return bucket_[bucket_idx];
   }
 
+  /* string value at key for reading, an int value is formatted into tmp */
+  const DynamicString *LookupStringForRead(const Key &key, DynamicString &tmp, int &errcode);
+
+  /* string value at key for modification, an int value is turned into string,
+   * an empty string is created if key does not exist */
+  DynamicString *LookupStringForWrite(const Key &key, int &errcode);
+
   bool ListPushAux(const Key &key, const std::string &val, bool leftpush, int &errcode);
 
   size_t ListPushAux(const Key &key, const std::vector<std::string> &values, bool leftpush, int &errcode);
 
   DynamicString ListPopAux(const Key &key, bool leftpop, int &errcode);
 
+  /* set at key, nullptr if key does not exist or holds other type */
+  HashSet *LookupSet(const Key &key, int &errcode);
+
+  /* hash at key with its expired fields deleted, created if create is true,
+   * nullptr with kKeyNotFoundCode if key does not exist, or kWrongTypeCode if it holds other type */
+  HashDict *LookupHash(const Key &key, bool create, int &errcode);
+
+  /* value at key with type, nullptr if key does not exist or holds other type */
+  void *LookupValue(const Key &key, unsigned char type, int &errcode);
+
+  /* put ptr of type at key, the old value at key is freed no matter what type it holds */
+  void ReplaceValue(const Key &key, unsigned char type, void *ptr);
+
   std::vector<std::string> KeyEvictionRandom(size_t num);
 
   std::vector<std::string> KeyEvictionLru(size_t num);
@@ -379,6 +1019,9 @@ private:
   mutable std::mutex mtx_;
   std::array<Bucket, kBucketSize> bucket_;
   std::vector<Key> keys_pool_;
+  /* keys of hashes which have field expirations, visited in turn by HashActiveExpire */
+  std::deque<std::string> hash_expire_queue_;
+  std::unordered_set<std::string> hash_expire_keys_;
 };
 
 #endif  // __CORE_H__
@@ -1,7 +1,14 @@
 #include "dlist.h"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
 
 DList::DList() {
+  InitNodes();
+}
+
+void DList::InitNodes() {
   /* we create 2 nodes at initialization */
   Node *node1 = new Node;
   Node *node2 = new Node;
@@ -11,6 +18,7 @@ DList::DList() {
   end_.node = node2;
   head_ = node1;
   tail_ = node2;
+  n_nodes_ = 2;
 }
 
 DList::~DList() { /* free all nodes in heap */
@@ -24,6 +32,7 @@ void DList::PushLeft(const char *val, uint32_t len) {
       end_.ptr = begin_.ptr;
       end_.node = begin_.node;
     }
+    index_.push_back({0, begin_.node});
   } else {
     if (begin_.ptr == begin_.node->data) { /* already at the left edge of buffer */
       if (begin_.node->prev == nullptr) {
@@ -40,8 +49,10 @@ void DList::PushLeft(const char *val, uint32_t len) {
         begin_.ptr = begin_.node->prev->data + kBlockSize - 1;
         begin_.node = begin_.node->prev;
       }
+      index_.push_front({index_.front().first - 1, begin_.node});
     } else {
       begin_.ptr--;
+      index_.front().first--;
     }
   }
   begin_.ptr->Reset(val, len);
@@ -56,6 +67,7 @@ void DList::PushRight(const char *val, uint32_t len) {
       begin_.ptr = end_.ptr;
       begin_.node = end_.node;
     }
+    index_.push_back({0, end_.node});
   } else {
     if (end_.ptr == end_.node->data + kBlockSize - 1) { /* already at the right edge of buffer */
       if (end_.node->next == nullptr) {
@@ -71,6 +83,7 @@ void DList::PushRight(const char *val, uint32_t len) {
         end_.ptr = end_.node->next->data;
         end_.node = end_.node->next;
       }
+      index_.push_back({index_.back().first + index_.back().node->occupied, end_.node});
     } else {
       end_.ptr++;
     }
@@ -99,19 +112,22 @@ ElemType DList::PopLeft() {
     begin_.node->occupied--;
     begin_.ptr = nullptr;
     end_.ptr = nullptr;
+    index_.clear();
   } else {
     /* move left pointer and perform lazy deletion */
-    /* already at the right edge of buffer */
-    if (begin_.ptr == begin_.node->data + kBlockSize - 1) { 
+    /* last element of the begin node */
+    if (begin_.node->occupied == 1) {
       /* next node is not null */
       if (begin_.node->next != nullptr) {
         begin_.node->occupied--;
         begin_.node = begin_.node->next;
         begin_.ptr = begin_.node->data;
+        index_.pop_front();
       }
     } else {
       begin_.ptr++; /* still in the same node */
       begin_.node->occupied--;
+      index_.front().first++;
     }
   }
   --len_;
@@ -128,12 +144,14 @@ ElemType DList::PopRight() {
     end_.node->occupied--;
     begin_.ptr = nullptr;
     end_.ptr = nullptr;
+    index_.clear();
   } else {
     if (end_.ptr == end_.node->data) {
       if (end_.node->prev != nullptr) {
         end_.node->occupied--;
         end_.node = end_.node->prev;
         end_.ptr = end_.node->data + kBlockSize - 1;
+        index_.pop_back();
       }
     } else {
       end_.ptr--;
@@ -146,19 +164,20 @@ ElemType DList::PopRight() {
 
 ElemType& DList::operator[](size_t idx) {
   /* index range from [0, len_ - 1], only positive index supported */
-  if (idx >= len_ || idx < 0) {
+  if (idx >= len_) {
     throw std::out_of_range("index out of range");
   }
-  if (begin_.node->occupied > idx) { 
-    /* index value in the same node */
-    return *(begin_.ptr + idx);
-  } else {
-    /* go to the corresponding node in O(n) complexity */
-    auto package = NodeAtIndex(idx);
-    Node *tmp = std::get<0>(package);
-    int offset = std::get<2>(package);
-    return *(tmp->data + offset);
+  return *ElemAtIndex(idx);
+}
+
+ElemType& DList::At(long idx) {
+  if (idx < 0) {
+    idx += (long)len_;
+  }
+  if (idx < 0 || idx >= (long)len_) {
+    throw std::out_of_range("index out of range");
   }
+  return *ElemAtIndex(idx);
 }
 
 std::vector<std::string> DList::RangeAsStdStringVector() {
@@ -186,11 +205,13 @@ std::vector<std::string> DList::RangeAsStdStringVector() {
 
 #define RANGE_FUNC_HELPER(funcname, rettype, sentence)                         \
   std::vector<rettype> DList::funcname(int start, int finish) {                \
-    if (Empty() || start > finish) {                                           \
+    if (Empty() || start > finish || start >= (int)len_) {                     \
       return {};                                                               \
     }                                                                          \
+    start = std::max(start, 0);                                                \
     finish = std::min(finish, (int)(len_ - 1));                                \
     std::vector<rettype> values;                                               \
+    values.reserve(finish - start + 1);                                        \
     int distance = finish - start + 1;                                         \
     auto package = NodeAtIndex(start);                                         \
     Node *tmp = std::get<0>(package);                                          \
@@ -201,7 +222,8 @@ std::vector<std::string> DList::RangeAsStdStringVector() {
       elem = begin_.ptr + offset;                                              \
     }                                                                          \
     while (tmp && tmp->occupied > 0 && elem && distance > 0) {                 \
-      while (elem != tmp->data + kBlockSize && distance > 0) {                 \
+      ElemType *last = NodeFirst(tmp) + tmp->occupied;                         \
+      while (elem != last && distance > 0) {                                   \
         values.emplace_back(sentence);                                         \
         elem++;                                                                \
         distance--;                                                            \
@@ -220,6 +242,37 @@ RANGE_FUNC_HELPER(RangeAsDynaStringVector, ElemType, *elem)
 
 #undef RANGE_FUNC_HELPER
 
+size_t DList::RangeLength(int start, int finish) const {
+  if (Empty() || start > finish || start >= (int)len_) {
+    return 0;
+  }
+  return std::min(finish, (int)(len_ - 1)) - std::max(start, 0) + 1;
+}
+
+void DList::ForEachInRange(int start, int finish, const std::function<void(const ElemType &)> &fn) {
+  int distance = (int)RangeLength(start, finish);
+  if (distance == 0) {
+    return;
+  }
+  start = std::max(start, 0);
+  auto package = NodeAtIndex(start);
+  Node *tmp = std::get<0>(package);
+  int offset = std::get<2>(package);
+  ElemType *elem = NodeFirst(tmp) + offset;
+  while (tmp && tmp->occupied > 0 && elem && distance > 0) {
+    ElemType *last = NodeFirst(tmp) + tmp->occupied;
+    while (elem != last && distance > 0) {
+      fn(*elem);
+      elem++;
+      distance--;
+    }
+    tmp = tmp->next;
+    if (tmp) {
+      elem = tmp->data;
+    }
+  }
+}
+
 std::vector<ElemType> DList::RangeAsDynaStringVector() {
   if (Empty()) {
     return {};
@@ -322,12 +375,323 @@ std::tuple<Node*, int, int> DList::NodeAtIndex(size_t idx) {
     /* index does not need to jump cross nodes */
     return std::make_tuple(begin_.node, -1, idx);
   }
-  int diff = idx - begin_.node->occupied;
-  int n_cross = diff / kBlockSize;
-  int offset = diff % kBlockSize;
-  Node *tmp = begin_.node;
-  for (int i = 0; i <= n_cross; i++) {
+  /* index near the tail is resolved from the end node */
+  size_t ridx = len_ - 1 - idx;
+  if (end_.node->occupied > ridx) {
+    return std::make_tuple(end_.node, (int)index_.size() - 2, end_.node->occupied - 1 - ridx);
+  }
+  /* binary search the last node whose first element is not after idx */
+  int64_t pos = index_.front().first + (int64_t)idx;
+  auto it = std::upper_bound(index_.begin(), index_.end(), pos,
+                             [](int64_t p, const BlockPos &b) { return p < b.first; });
+  --it;
+  int n_cross = (int)(it - index_.begin()) - 1;
+  int offset = (int)(pos - it->first);
+  return std::make_tuple(it->node, n_cross, offset);
+}
+
+ElemType *DList::ElemAtIndex(size_t idx) {
+  if (begin_.node->occupied > idx) {
+    return begin_.ptr + idx;
+  }
+  size_t ridx = len_ - 1 - idx;
+  if (end_.node->occupied > ridx) {
+    return end_.ptr - ridx;
+  }
+  auto package = NodeAtIndex(idx);
+  return NodeFirst(std::get<0>(package)) + std::get<2>(package);
+}
+
+void DList::Insert(size_t idx, const char *val, uint32_t len) {
+  if (idx == 0) {
+    PushLeft(val, len);
+    return;
+  }
+  if (idx >= len_) {
+    PushRight(val, len);
+    return;
+  }
+  auto package = NodeAtIndex(idx);
+  Node *node = std::get<0>(package);
+  size_t pos = std::get<1>(package) + 1; /* position of node in index_ */
+  int offset = std::get<2>(package);
+  ElemType *first = NodeFirst(node);
+  if (first != node->data) {
+    /* free slots on the left of begin node, move preceding elements left */
+    std::move(first, first + offset, first - 1);
+    first[offset - 1].Reset(val, len);
+    --begin_.ptr;
+    index_.front().first--;
+  } else if (node->occupied < kBlockSize) {
+    /* free slots on the right, move following elements right */
+    std::move_backward(first + offset, first + node->occupied, first + node->occupied + 1);
+    first[offset].Reset(val, len);
+    if (node == end_.node) {
+      ++end_.ptr;
+    }
+    for (size_t i = pos + 1; i < index_.size(); ++i) {
+      index_[i].first++;
+    }
+  } else {
+    /* node is full, split it and try again */
+    SplitNode(node, pos);
+    Insert(idx, val, len);
+    return;
+  }
+  node->occupied++;
+  ++len_;
+}
+
+void DList::Insert(size_t idx, const std::string &val) {
+  Insert(idx, val.data(), val.size());
+}
+
+long DList::Find(const char *val, uint32_t len) const {
+  if (Empty()) {
+    return -1;
+  }
+  long idx = 0;
+  for (Node *node = begin_.node;; node = node->next) {
+    ElemType *first = NodeFirst(node);
+    for (int i = 0; i < node->occupied; ++i, ++idx) {
+      if (first[i].Length() == len && memcmp(first[i].Data(), val, len) == 0) {
+        return idx;
+      }
+    }
+    if (node == end_.node) {
+      break;
+    }
+  }
+  return -1;
+}
+
+long DList::Find(const std::string &val) const {
+  return Find(val.data(), val.size());
+}
+
+size_t DList::Remove(const char *val, uint32_t len, long count) {
+  if (Empty()) {
+    return 0;
+  }
+  auto equal = [val, len](const ElemType &e) {
+    return e.Length() == len && memcmp(e.Data(), val, len) == 0;
+  };
+  size_t limit = count == 0 ? len_ : (size_t)std::labs(count);
+  size_t from = 0;
+  if (count < 0) {
+    /* locate the first of the last |count| matched elements from the tail,
+     * then remove forwards from there */
+    size_t matched = 0;
+    size_t idx = len_;
+    bool found = false;
+    for (Node *node = end_.node; !found; node = node->prev) {
+      ElemType *first = NodeFirst(node);
+      for (int i = node->occupied - 1; i >= 0; --i) {
+        --idx;
+        if (equal(first[i]) && ++matched == limit) {
+          found = true;
+          break;
+        }
+      }
+      if (node == begin_.node) {
+        break;
+      }
+    }
+    from = found ? idx : 0;
+  }
+
+  /* compact every node in place, empty nodes are dropped afterwards */
+  auto package = NodeAtIndex(from);
+  Node *node = std::get<0>(package);
+  int offset = std::get<2>(package);
+  size_t removed = 0;
+  while (removed < limit) {
+    ElemType *first = NodeFirst(node);
+    int w = offset;
+    for (int r = offset; r < node->occupied; ++r) {
+      if (removed < limit && equal(first[r])) {
+        ++removed;
+        continue;
+      }
+      if (w != r) {
+        first[w] = std::move(first[r]);
+      }
+      ++w;
+    }
+    for (int i = w; i < node->occupied; ++i) {
+      first[i] = ElemType();
+    }
+    node->occupied = w;
+    if (node == end_.node) {
+      break;
+    }
+    node = node->next;
+    offset = 0;
+  }
+  if (removed > 0) {
+    len_ -= removed;
+    Reorganize();
+  }
+  return removed;
+}
+
+size_t DList::Remove(const std::string &val, long count) {
+  return Remove(val.data(), val.size(), count);
+}
+
+void DList::Trim(size_t start, size_t finish) {
+  if (Empty()) {
+    return;
+  }
+  if (start > finish || start >= len_) {
+    Clear();
+    return;
+  }
+  finish = std::min(finish, len_ - 1);
+  auto head_package = NodeAtIndex(start);
+  auto tail_package = NodeAtIndex(finish);
+  Node *fnode = std::get<0>(head_package);
+  int foff = std::get<2>(head_package);
+  Node *lnode = std::get<0>(tail_package);
+  int loff = std::get<2>(tail_package);
+  ElemType *ffirst = NodeFirst(fnode);
+  ElemType *lfirst = NodeFirst(lnode);
+
+  /* whole nodes out of range are released without touching their elements one by one */
+  Node *tmp = lnode->next;
+  while (tmp) {
+    Node *deleting = tmp;
     tmp = tmp->next;
+    delete deleting;
+    --n_nodes_;
+  }
+  lnode->next = nullptr;
+  tail_ = lnode;
+  tmp = fnode->prev;
+  while (tmp) {
+    Node *deleting = tmp;
+    tmp = tmp->prev;
+    delete deleting;
+    --n_nodes_;
+  }
+  fnode->prev = nullptr;
+  head_ = fnode;
+
+  /* partial elements in the edge nodes */
+  for (int i = loff + 1; i < lnode->occupied; ++i) {
+    lfirst[i] = ElemType();
   }
-  return std::make_tuple(tmp, n_cross, offset);
-}
\ No newline at end of file
+  lnode->occupied = loff + 1;
+  for (int i = 0; i < foff; ++i) {
+    ffirst[i] = ElemType();
+  }
+  fnode->occupied -= foff;
+  begin_.node = fnode;
+  begin_.ptr = ffirst + foff;
+  end_.node = lnode;
+  end_.ptr = lfirst + loff;
+  len_ = finish - start + 1;
+  Reorganize();
+}
+
+void DList::Clear() {
+  FreeNodes();
+  InitNodes();
+  begin_.ptr = nullptr;
+  end_.ptr = nullptr;
+  len_ = 0;
+  index_.clear();
+}
+
+void DList::UnlinkNode(Node *node) {
+  if (node->prev) {
+    node->prev->next = node->next;
+  } else {
+    head_ = node->next;
+  }
+  if (node->next) {
+    node->next->prev = node->prev;
+  } else {
+    tail_ = node->prev;
+  }
+  delete node;
+  --n_nodes_;
+}
+
+void DList::SplitNode(Node *node, size_t pos) {
+  /* move the upper half of node into a new node right after it */
+  Node *newnode = NewNode();
+  ++n_nodes_;
+  newnode->prev = node;
+  newnode->next = node->next;
+  if (node->next) {
+    node->next->prev = newnode;
+  } else {
+    tail_ = newnode;
+  }
+  node->next = newnode;
+  ElemType *first = NodeFirst(node);
+  uint16_t keep = node->occupied / 2;
+  uint16_t moved = node->occupied - keep;
+  std::move(first + keep, first + node->occupied, newnode->data);
+  node->occupied = keep;
+  newnode->occupied = moved;
+  if (node == end_.node) {
+    end_.node = newnode;
+    end_.ptr = newnode->data + moved - 1;
+  }
+  index_.insert(index_.begin() + pos + 1, {index_[pos].first + keep, newnode});
+}
+
+void DList::Reorganize() {
+  /* drop nodes emptied by removal, merge neighbours which fit into one node
+   * and rebuild the positional index */
+  index_.clear();
+  if (len_ == 0) {
+    end_.node = begin_.node;
+    begin_.ptr = nullptr;
+    end_.ptr = nullptr;
+    return;
+  }
+  Node *stop = end_.node->next;
+  Node *node = begin_.node;
+  while (node != stop) {
+    Node *next = node->next;
+    if (node->occupied == 0) {
+      if (node == begin_.node) {
+        begin_.node = next;
+        begin_.ptr = next->data;
+      }
+      if (node == end_.node) {
+        end_.node = node->prev;
+      }
+      UnlinkNode(node);
+    }
+    node = next;
+  }
+  node = begin_.node;
+  while (node != end_.node) {
+    Node *next = node->next;
+    ElemType *last = NodeFirst(node) + node->occupied;
+    if (node->data + kBlockSize - last >= next->occupied) {
+      std::move(next->data, next->data + next->occupied, last);
+      node->occupied += next->occupied;
+      next->occupied = 0;
+      if (next == end_.node) {
+        end_.node = node;
+      }
+      UnlinkNode(next);
+    } else {
+      node = next;
+    }
+  }
+  end_.ptr = NodeFirst(end_.node) + end_.node->occupied - 1;
+  int64_t first = 0;
+  for (node = begin_.node;; node = node->next) {
+    index_.push_back({first, node});
+    first += node->occupied;
+    if (node == end_.node) {
+      break;
+    }
+  }
+}
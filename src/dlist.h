@@ -2,6 +2,8 @@
 #define __DLIST_H__
 
 #include <vector>
+#include <deque>
+#include <functional>
 #include <string>
 #include "str.h"
 #include "serializable.h"
@@ -49,6 +51,13 @@ struct Iterator {
   }
 };
 
+/* positional index entry for a node holding elements */
+struct BlockPos {
+  /* global position of the first element in this node */
+  int64_t first;
+  Node *node;
+};
+
 class DList : public Serializable {
 public:
   DList();
@@ -75,6 +84,9 @@ public:
 
   ElemType& operator[](size_t idx);
 
+  /* negative index counts from the tail, -1 is the last element */
+  ElemType& At(long idx);
+
   std::vector<std::string> RangeAsStdStringVector();
 
   std::vector<std::string> RangeAsStdStringVector(int start, int finish);
@@ -83,11 +95,33 @@ public:
 
   std::vector<ElemType> RangeAsDynaStringVector(int start, int finish);
 
-  // TODO insert element at specific index
+  /* number of elements in range [start, finish] */
+  size_t RangeLength(int start, int finish) const;
+
+  /* call fn on every element in range [start, finish] without copying it */
+  void ForEachInRange(int start, int finish, const std::function<void(const ElemType &)> &fn);
+
+  /* insert element before index idx, idx >= Length() appends it to the tail */
+  void Insert(size_t idx, const char *val, uint32_t len);
+
+  void Insert(size_t idx, const std::string &val);
+
+  /* index of the first element equals to val, -1 if not found */
+  long Find(const char *val, uint32_t len) const;
+
+  long Find(const std::string &val) const;
+
+  /* remove elements equal to val, count > 0 from head, count < 0 from tail,
+   * count = 0 removes all of them, return the number of removed elements */
+  size_t Remove(const char *val, uint32_t len, long count);
 
-  // TODO delete element at specific index
+  size_t Remove(const std::string &val, long count);
 
-  // TODO remove elements in specified range
+  /* only keep elements in range [start, finish] */
+  void Trim(size_t start, size_t finish);
+
+  /* remove all elements */
+  void Clear();
 
   inline Node *Front() const { return head_; }
 
@@ -103,12 +137,27 @@ private:
   inline ElemType *HeadElem() const { return begin_.ptr; }
   inline ElemType *TailElem() const { return end_.ptr; }
 
+  void InitNodes();
+
   void FreeNodes();
 
   inline Node *NewNode() { return new Node; }
 
+  /* begin node may not start at data[0], other nodes always do */
+  inline ElemType *NodeFirst(Node *node) const {
+    return node == begin_.node ? begin_.ptr : node->data;
+  }
+
+  void UnlinkNode(Node *node);
+
+  void SplitNode(Node *node, size_t pos);
+
+  void Reorganize();
+
   std::tuple<Node*, int, int> NodeAtIndex(size_t idx);
 
+  ElemType *ElemAtIndex(size_t idx);
+
 private:
   Iterator begin_;
   Iterator end_;
@@ -116,6 +165,9 @@ private:
   Node *tail_;
   size_t len_ = 0;
   size_t n_nodes_ = 2;
+  /* one entry for every node from begin_.node to end_.node, ordered by position,
+   * used to locate the node of an index with binary search */
+  std::deque<BlockPos> index_;
 };
 
 #endif // __DLIST_H__
\ No newline at end of file
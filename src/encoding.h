@@ -19,6 +19,11 @@
  */
 size_t Time33Hash(const char* str, size_t len);
 
+/**
+ * @brief MurmurHash2 64-bit version by Austin Appleby, for sketches needing well mixed bits
+ */
+uint64_t MurmurHash64A(const void* key, size_t len, uint64_t seed);
+
 /**
  * @brief encode a uint64_t value into buf
  *
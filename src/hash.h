@@ -21,6 +21,7 @@ template <typename>
 class Rehashable;
 class HashDict;
 class HashSet;
+class ZSetDict;
 
 #define has_member(s, same_type)                                                       \
   template <typename T, typename R = void>                                             \
@@ -44,6 +45,7 @@ class HashStructBase {
   template <typename> friend class Rehashable;
   friend class HashDict;
   friend class HashSet;
+  friend class ZSetDict;
 
   static_assert(has_member_key<EntryType, HEntryKey*>::value,
                 "EntryType must have a `key` member of type HEntryKey*");
@@ -97,6 +99,19 @@ public:
 
   std::vector<EntryType *> AllEntries() const;
 
+  /* call fn on every entry until fn returns false, return false if stopped early */
+  template <typename Func>
+  bool ForEachEntry(Func &&fn) const {
+    for (size_t i = 0; i < slot_size_; ++i) {
+      for (EntryType *entry = table_[i]; entry != nullptr; entry = entry->next) {
+        if (!fn(entry)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
   inline double LoadFactor() const { return ((double)count_) / ((double)slot_size_); }
 
   inline unsigned long SlotCount() const { return slot_size_; }
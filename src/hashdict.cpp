@@ -75,6 +75,10 @@ HEntryVal &HashTable::At(const HEntryKey &key) {
 /***********　HashDict impl　************/
 
 int HashDict::Update(const HEntryKey &key, const HEntryVal &val) {
+  /* overwritten value does not inherit the expiration */
+  if (expires_) {
+    expires_->when.erase(key.ToStdString());
+  }
   if (CheckNeedRehash()) {
     PerformRehash();
   }
@@ -126,6 +130,76 @@ HEntryVal &HashDict::At(const HEntryKey &key) {
   throw std::out_of_range(key.ToStdString() + " not found in hashtable");
 }
 
+HEntryVal *HashDict::Find(const HEntryKey &key) {
+  HTEntry *entry = cur_ht_ != nullptr ? cur_ht_->FindEntry(key) : nullptr;
+  if (entry == nullptr && backup_ht_ != nullptr) {
+    entry = backup_ht_->FindEntry(key);
+  }
+  return entry != nullptr ? entry->value : nullptr;
+}
+
+int HashDict::Erase(const HEntryKey &key) {
+  if (expires_) {
+    expires_->when.erase(key.ToStdString());
+  }
+  return Rehashable<HashTable>::Erase(key);
+}
+
+bool HashDict::SetExpire(const HEntryKey &key, uint64_t when) {
+  if (Find(key) == nullptr) {
+    return false;
+  }
+  if (!expires_) {
+    expires_.reset(new Expires);
+  }
+  std::string field = key.ToStdString();
+  expires_->when[field] = when;
+  expires_->queue.emplace(when, std::move(field));
+  /* drop skipped items once they outnumber the live ones */
+  if (expires_->queue.size() > expires_->when.size() * 2 + 16) {
+    std::vector<ExpireItem> items;
+    items.reserve(expires_->when.size());
+    for (const auto &item : expires_->when) {
+      items.emplace_back(item.second, item.first);
+    }
+    expires_->queue = decltype(expires_->queue)(std::greater<ExpireItem>(), std::move(items));
+  }
+  return true;
+}
+
+bool HashDict::Persist(const HEntryKey &key) {
+  return expires_ && expires_->when.erase(key.ToStdString()) != 0;
+}
+
+int64_t HashDict::ExpireTime(const HEntryKey &key) const {
+  if (!expires_) {
+    return -1;
+  }
+  auto it = expires_->when.find(key.ToStdString());
+  return it != expires_->when.end() ? (int64_t)it->second : -1;
+}
+
+size_t HashDict::ExpireKeys(uint64_t now, size_t limit) {
+  size_t n_erased = 0;
+  while (expires_ && !expires_->queue.empty() && n_erased < limit) {
+    const ExpireItem &top = expires_->queue.top();
+    if (top.first > now) {
+      break;
+    }
+    auto it = expires_->when.find(top.second);
+    if (it != expires_->when.end() && it->second == top.first) {
+      expires_->when.erase(it);
+      Rehashable<HashTable>::Erase(HEntryKey(top.second));
+      ++n_erased;
+    }
+    expires_->queue.pop();
+  }
+  if (expires_ && expires_->when.empty()) {
+    expires_.reset();
+  }
+  return n_erased;
+}
+
 size_t HashDict::Serialize(std::vector<char> &buf) const {
   size_t len = Count();
   if (len == 0) {
@@ -145,5 +219,16 @@ size_t HashDict::Serialize(std::vector<char> &buf) const {
     entry->key->Serialize(buf);
     entry->value->Serialize(buf);
   }
+  if (NumExpires() != 0) {
+    /* number of expirations, then every key with its fixed 8 bytes expiration */
+    len_enc_size = EncodeVarUnsignedInt64(NumExpires(), len_enc_buf);
+    buf.insert(buf.end(), len_enc_buf, len_enc_buf + len_enc_size);
+    for (const auto &item : expires_->when) {
+      HEntryKey(item.first).Serialize(buf);
+      unsigned char when_buf[8];
+      EncodeFixed64BitInteger(item.second, when_buf);
+      buf.insert(buf.end(), when_buf, when_buf + 8);
+    }
+  }
   return buf.size();
 }
\ No newline at end of file
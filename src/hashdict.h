@@ -1,6 +1,10 @@
 #ifndef __HASHDICT_H__
 #define __HASHDICT_H__
 
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <unordered_map>
 #include <vector>
 #include "hash.h"
 #include "rehashable.h"
@@ -96,7 +100,56 @@ public:
    */
   HEntryVal &At(const std::string &key) { return At(HEntryKey(key)); }
 
+  /**
+   * Get value given specific key for updating in place, nullptr if not found
+   */
+  HEntryVal *Find(const HEntryKey &key);
+
+  /**
+   * Erase key and its expiration
+   */
+  int Erase(const HEntryKey &key);
+
+  int Erase(const std::string &key) { return Erase(HEntryKey(key)); }
+
+  /**
+   * Set the expiration of key in unix milliseconds, return false if key not found
+   */
+  bool SetExpire(const HEntryKey &key, uint64_t when);
+
+  /**
+   * Remove the expiration of key, return false if key has no expiration
+   */
+  bool Persist(const HEntryKey &key);
+
+  /**
+   * Expiration of key in unix milliseconds, -1 if key has no expiration
+   */
+  int64_t ExpireTime(const HEntryKey &key) const;
+
+  /**
+   * Erase at most limit keys expired by now, return the number of keys erased
+   */
+  size_t ExpireKeys(uint64_t now, size_t limit = SIZE_MAX);
+
+  inline size_t NumExpires() const { return expires_ ? expires_->when.size() : 0; }
+
+  /**
+   * Serialize key-value pairs, followed by expirations if any
+   */
   size_t Serialize(std::vector<char> &buf) const override;
+
+private:
+  typedef std::pair<uint64_t, std::string> ExpireItem;
+
+  /* allocated when the first expiration is set */
+  struct Expires {
+    std::unordered_map<std::string, uint64_t> when;
+    /* earliest expiration on top, items of keys since updated or erased are skipped when popped */
+    std::priority_queue<ExpireItem, std::vector<ExpireItem>, std::greater<ExpireItem>> queue;
+  };
+
+  std::unique_ptr<Expires> expires_;
 };
 
 #endif  // __HASHDICT_H__
\ No newline at end of file
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "bitops.h"
+#include "hyperloglog.h"
+
+/* register values are at most kHLLQ + 1 */
+static constexpr int kHLLQ = 64 - kHLLPrecision;
+static constexpr int kHLLHistoSize = 64;
+static constexpr double kHLLAlphaInf = 0.721347520444481703680;
+/* bytes of one sparse entry in dump, 14-bit index and 6-bit value */
+static constexpr size_t kSparseEntryBytes = 3;
+
+static inline uint32_t SparseIndex(uint32_t entry) { return entry >> kHLLBits; }
+
+static inline uint8_t SparseValue(uint32_t entry) { return entry & ((1 << kHLLBits) - 1); }
+
+static inline uint32_t SparseEntry(uint32_t idx, uint8_t val) { return idx << kHLLBits | val; }
+
+/* 4 registers are packed into 3 bytes, unpack them into regs */
+static void UnpackRegisters(const uint8_t *packed, uint8_t *regs) {
+  for (size_t i = 0; i < kHLLRegisters; i += 4, packed += 3) {
+    uint32_t w = packed[0] | (uint32_t)packed[1] << 8 | (uint32_t)packed[2] << 16;
+    regs[i] = w & 63;
+    regs[i + 1] = (w >> 6) & 63;
+    regs[i + 2] = (w >> 12) & 63;
+    regs[i + 3] = (w >> 18) & 63;
+  }
+}
+
+static void PackRegisters(const uint8_t *regs, uint8_t *packed) {
+  for (size_t i = 0; i < kHLLRegisters; i += 4, packed += 3) {
+    uint32_t w = regs[i] | regs[i + 1] << 6 | regs[i + 2] << 12 | (uint32_t)regs[i + 3] << 18;
+    packed[0] = w & 0xFF;
+    packed[1] = (w >> 8) & 0xFF;
+    packed[2] = (w >> 16) & 0xFF;
+  }
+}
+
+bool HyperLogLog::Add(const char *data, size_t len) {
+  uint64_t hash = MurmurHash64A(data, len, 0xadc83b19ULL);
+  uint32_t idx = hash & (kHLLRegisters - 1);
+  /* the sentinel bit makes the count of trailing zeros at most kHLLQ */
+  hash >>= kHLLPrecision;
+  hash |= 1ULL << kHLLQ;
+  uint8_t count = __builtin_ctzll(hash) + 1;
+  return SetIfLarger(idx, count);
+}
+
+bool HyperLogLog::SetIfLarger(uint32_t idx, uint8_t val) {
+  if (encoding_ == kHLLDense) {
+    if (DenseGet(idx) >= val) {
+      return false;
+    }
+    DenseSet(idx, val);
+    cache_valid_ = false;
+    return true;
+  }
+  auto it = std::lower_bound(sparse_.begin(), sparse_.end(), SparseEntry(idx, 0));
+  if (it != sparse_.end() && SparseIndex(*it) == idx) {
+    if (SparseValue(*it) >= val) {
+      return false;
+    }
+    *it = SparseEntry(idx, val);
+  } else {
+    sparse_.insert(it, SparseEntry(idx, val));
+    if (sparse_.size() > kHLLSparseMaxEntries) {
+      ToDense();
+    }
+  }
+  cache_valid_ = false;
+  return true;
+}
+
+uint8_t HyperLogLog::DenseGet(uint32_t idx) const {
+  size_t byte = idx * kHLLBits / 8;
+  unsigned int fb = idx * kHLLBits & 7;
+  return ((dense_[byte] >> fb) | (dense_[byte + 1] << (8 - fb))) & 63;
+}
+
+void HyperLogLog::DenseSet(uint32_t idx, uint8_t val) {
+  size_t byte = idx * kHLLBits / 8;
+  unsigned int fb = idx * kHLLBits & 7;
+  dense_[byte] &= ~(63 << fb);
+  dense_[byte] |= val << fb;
+  dense_[byte + 1] &= ~(63 >> (8 - fb));
+  dense_[byte + 1] |= val >> (8 - fb);
+}
+
+void HyperLogLog::ToDense() {
+  if (encoding_ == kHLLDense) {
+    return;
+  }
+  dense_.assign(kHLLDenseBytes + 1, 0);
+  encoding_ = kHLLDense;
+  for (uint32_t entry : sparse_) {
+    DenseSet(SparseIndex(entry), SparseValue(entry));
+  }
+  sparse_.clear();
+  sparse_.shrink_to_fit();
+}
+
+void HyperLogLog::Histogram(int *histo) const {
+  memset(histo, 0, sizeof(int) * kHLLHistoSize);
+  if (encoding_ == kHLLSparse) {
+    histo[0] = kHLLRegisters - sparse_.size();
+    for (uint32_t entry : sparse_) {
+      ++histo[SparseValue(entry)];
+    }
+    return;
+  }
+  /* 4 partial histograms, so that consecutive increments do not wait for each other */
+  int partial[4][kHLLHistoSize] = {{0}};
+  const uint8_t *p = dense_.data();
+  for (size_t i = 0; i < kHLLRegisters; i += 4, p += 3) {
+    uint32_t w = p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16;
+    ++partial[0][w & 63];
+    ++partial[1][(w >> 6) & 63];
+    ++partial[2][(w >> 12) & 63];
+    ++partial[3][(w >> 18) & 63];
+  }
+  for (int j = 0; j < kHLLHistoSize; ++j) {
+    histo[j] = partial[0][j] + partial[1][j] + partial[2][j] + partial[3][j];
+  }
+}
+
+static double HLLSigma(double x) {
+  if (x == 1.) {
+    return INFINITY;
+  }
+  double z_prime;
+  double y = 1;
+  double z = x;
+  do {
+    x *= x;
+    z_prime = z;
+    z += x * y;
+    y += y;
+  } while (z_prime != z);
+  return z;
+}
+
+static double HLLTau(double x) {
+  if (x == 0. || x == 1.) {
+    return 0.;
+  }
+  double z_prime;
+  double y = 1.0;
+  double z = 1 - x;
+  do {
+    x = sqrt(x);
+    z_prime = z;
+    y *= 0.5;
+    z -= pow(1 - x, 2) * y;
+  } while (z_prime != z);
+  return z / 3;
+}
+
+uint64_t HyperLogLog::EstimateFromHistogram(const int *histo) {
+  /* improved estimator from "New cardinality estimation algorithms for HyperLogLog sketches"
+   * by Otmar Ertl, no bias correction table is needed */
+  double m = kHLLRegisters;
+  double z = m * HLLTau((m - histo[kHLLQ + 1]) / m);
+  for (int j = kHLLQ; j >= 1; --j) {
+    z += histo[j];
+    z *= 0.5;
+  }
+  z += m * HLLSigma(histo[0] / m);
+  return (uint64_t)llroundl(kHLLAlphaInf * m * m / z);
+}
+
+uint64_t HyperLogLog::Count() const {
+  if (!cache_valid_) {
+    int histo[kHLLHistoSize];
+    Histogram(histo);
+    cached_count_ = EstimateFromHistogram(histo);
+    cache_valid_ = true;
+  }
+  return cached_count_;
+}
+
+uint64_t HyperLogLog::Estimate(const uint8_t *regs) {
+  int partial[4][kHLLHistoSize] = {{0}};
+  for (size_t i = 0; i < kHLLRegisters; i += 4) {
+    ++partial[0][regs[i]];
+    ++partial[1][regs[i + 1]];
+    ++partial[2][regs[i + 2]];
+    ++partial[3][regs[i + 3]];
+  }
+  int histo[kHLLHistoSize];
+  for (int j = 0; j < kHLLHistoSize; ++j) {
+    histo[j] = partial[0][j] + partial[1][j] + partial[2][j] + partial[3][j];
+  }
+  return EstimateFromHistogram(histo);
+}
+
+void HyperLogLog::MergeInto(uint8_t *regs) const {
+  if (encoding_ == kHLLSparse) {
+    for (uint32_t entry : sparse_) {
+      uint8_t &reg = regs[SparseIndex(entry)];
+      reg = std::max(reg, SparseValue(entry));
+    }
+    return;
+  }
+  uint8_t unpacked[kHLLRegisters];
+  UnpackRegisters(dense_.data(), unpacked);
+  ByteMax(regs, unpacked, kHLLRegisters);
+}
+
+void HyperLogLog::LoadRegisters(const uint8_t *regs) {
+  size_t nonzero = kHLLRegisters - std::count(regs, regs + kHLLRegisters, 0);
+  cache_valid_ = false;
+  if (nonzero <= kHLLSparseMaxEntries) {
+    encoding_ = kHLLSparse;
+    dense_.clear();
+    dense_.shrink_to_fit();
+    sparse_.clear();
+    sparse_.reserve(nonzero);
+    for (uint32_t i = 0; i < kHLLRegisters; ++i) {
+      if (regs[i] != 0) {
+        sparse_.emplace_back(SparseEntry(i, regs[i]));
+      }
+    }
+    return;
+  }
+  encoding_ = kHLLDense;
+  sparse_.clear();
+  sparse_.shrink_to_fit();
+  dense_.assign(kHLLDenseBytes + 1, 0);
+  PackRegisters(regs, dense_.data());
+}
+
+void HyperLogLog::Merge(const HyperLogLog &other) {
+  if (other.encoding_ == kHLLSparse) {
+    for (uint32_t entry : other.sparse_) {
+      SetIfLarger(SparseIndex(entry), SparseValue(entry));
+    }
+    return;
+  }
+  std::vector<uint8_t> regs(kHLLRegisters, 0);
+  MergeInto(regs.data());
+  other.MergeInto(regs.data());
+  LoadRegisters(regs.data());
+}
+
+std::string HyperLogLog::Dump() const {
+  std::string data(1, (char)encoding_);
+  if (encoding_ == kHLLDense) {
+    data.append((const char *)dense_.data(), kHLLDenseBytes);
+    return data;
+  }
+  data.reserve(1 + sparse_.size() * kSparseEntryBytes);
+  for (uint32_t entry : sparse_) {
+    data.push_back((char)(entry & 0xFF));
+    data.push_back((char)((entry >> 8) & 0xFF));
+    data.push_back((char)((entry >> 16) & 0xFF));
+  }
+  return data;
+}
+
+bool HyperLogLog::Load(const char *data, size_t len) {
+  if (len < 1) {
+    return false;
+  }
+  const uint8_t *p = (const uint8_t *)data + 1;
+  len -= 1;
+  if (data[0] == kHLLDense) {
+    if (len != kHLLDenseBytes) {
+      return false;
+    }
+    sparse_.clear();
+    dense_.assign(p, p + kHLLDenseBytes);
+    dense_.push_back(0);
+    encoding_ = kHLLDense;
+    cache_valid_ = false;
+    return true;
+  }
+  if (data[0] != kHLLSparse || len % kSparseEntryBytes != 0) {
+    return false;
+  }
+  std::vector<uint32_t> entries;
+  entries.reserve(len / kSparseEntryBytes);
+  for (size_t i = 0; i < len; i += kSparseEntryBytes) {
+    uint32_t entry = p[i] | (uint32_t)p[i + 1] << 8 | (uint32_t)p[i + 2] << 16;
+    /* indexes must be increasing and values must be valid non-zero counts */
+    if ((!entries.empty() && SparseIndex(entry) <= SparseIndex(entries.back())) ||
+        SparseIndex(entry) >= kHLLRegisters || SparseValue(entry) == 0 ||
+        SparseValue(entry) > kHLLQ + 1) {
+      return false;
+    }
+    entries.emplace_back(entry);
+  }
+  dense_.clear();
+  sparse_.swap(entries);
+  encoding_ = kHLLSparse;
+  cache_valid_ = false;
+  if (sparse_.size() > kHLLSparseMaxEntries) {
+    ToDense();
+  }
+  return true;
+}
+
+size_t HyperLogLog::Serialize(std::vector<char> &buf) const {
+  std::string data = Dump();
+  unsigned char enc_buf[10] = {0};
+  uint8_t enc_size = EncodeVarUnsignedInt64(data.size(), enc_buf);
+  /* length first, then the dumped registers */
+  buf.insert(buf.end(), enc_buf, enc_buf + enc_size);
+  buf.insert(buf.end(), data.begin(), data.end());
+  return buf.size();
+}
@@ -0,0 +1,91 @@
+#ifndef __HYPERLOGLOG_H__
+#define __HYPERLOGLOG_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "serializable.h"
+#include "encoding.h"
+
+/* number of bits of the hash used as register index */
+static constexpr int kHLLPrecision = 14;
+/* number of registers */
+static constexpr size_t kHLLRegisters = 1 << kHLLPrecision;
+/* bits per register in dense encoding */
+static constexpr int kHLLBits = 6;
+/* bytes of dense registers, about 12KB */
+static constexpr size_t kHLLDenseBytes = (kHLLRegisters * kHLLBits + 7) / 8;
+/* sparse encoding turns dense when it holds more non-zero registers than this */
+static constexpr size_t kHLLSparseMaxEntries = 1000;
+
+static constexpr uint8_t kHLLSparse = 0;
+static constexpr uint8_t kHLLDense = 1;
+
+/**
+ * @brief HyperLogLog cardinality estimator with 2^14 registers (0.81% standard error).
+ * It starts with sparse encoding which only keeps the non-zero registers,
+ * and turns into dense encoding with packed 6-bit registers when it grows large
+ */
+class HyperLogLog : public Serializable {
+public:
+  HyperLogLog() = default;
+
+  /**
+   * @brief Add an element
+   *
+   * @return true if any register is changed
+   */
+  bool Add(const char *data, size_t len);
+
+  bool Add(const std::string &elem) { return Add(elem.data(), elem.size()); }
+
+  /* estimated number of distinct elements added, cached until the next modification */
+  uint64_t Count() const;
+
+  /* raise registers to the ones of other */
+  void Merge(const HyperLogLog &other);
+
+  /* regs[i] = max(regs[i], register i), regs has kHLLRegisters bytes */
+  void MergeInto(uint8_t *regs) const;
+
+  /* replace registers with regs, regs has kHLLRegisters bytes */
+  void LoadRegisters(const uint8_t *regs);
+
+  /* estimate cardinality of the given registers */
+  static uint64_t Estimate(const uint8_t *regs);
+
+  inline bool IsSparse() const { return encoding_ == kHLLSparse; }
+
+  /* encoding byte followed by the registers in current encoding */
+  std::string Dump() const;
+
+  /* restore from the output of Dump, return false if data is malformed */
+  bool Load(const char *data, size_t len);
+
+  size_t Serialize(std::vector<char> &buf) const override;
+
+private:
+  /* set register idx to val if val is larger, return true if changed */
+  bool SetIfLarger(uint32_t idx, uint8_t val);
+
+  uint8_t DenseGet(uint32_t idx) const;
+
+  void DenseSet(uint32_t idx, uint8_t val);
+
+  void ToDense();
+
+  void Histogram(int *histo) const;
+
+  static uint64_t EstimateFromHistogram(const int *histo);
+
+private:
+  uint8_t encoding_ = kHLLSparse;
+  /* non-zero registers sorted by index, each entry is index << kHLLBits | value */
+  std::vector<uint32_t> sparse_;
+  /* packed 6-bit registers, one extra byte so that any register can be read by two bytes */
+  std::vector<uint8_t> dense_;
+  mutable uint64_t cached_count_ = 0;
+  mutable bool cache_valid_ = false;
+};
+
+#endif  // __HYPERLOGLOG_H__
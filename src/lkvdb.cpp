@@ -169,6 +169,19 @@ static HashSet& DecodeHashSet(char*& cursor, size_t& remain, HashSet& ans) {
   return ans;
 }
 
+static ZSet& DecodeZSet(char*& cursor, size_t& remain, ZSet& ans) {
+  size_t count = DecodeInteger(cursor, remain);
+  for (size_t i = 0; i < count; ++i) {
+    std::string member = DecodeStdString(cursor, remain);
+    if (member.empty()) {
+      break;
+    }
+    int64_t score = (int64_t)DecodeInteger(cursor, remain);
+    ans.Add(member, score);
+  }
+  return ans;
+}
+
 void LiteKVLoad(const std::string& src, KVContainer* holder, EventLoop* loop,
                 const std::function<void(size_t&, size_t&)>& callback) {
   if (!holder || !loop) return;
@@ -237,7 +250,10 @@ void LiteKVLoad(const std::string& src, KVContainer* holder, EventLoop* loop,
     int type = (int)(char)(*cursor);
     Advance(cursor, remain, 1);
     if (type != LKVBD_TYPE_INT && type != LKVBD_TYPE_STRING && type != LKVBD_TYPE_LIST &&
-        type != LKVBD_TYPE_HASH && type != LKVBD_TYPE_SET) {
+        type != LKVBD_TYPE_HASH && type != LKVBD_TYPE_SET && type != LKVBD_TYPE_ZSET &&
+        type != LKVBD_TYPE_HLL && type != LKVBD_TYPE_CMS && type != LKVBD_TYPE_TOPK &&
+        type != LKVBD_TYPE_BLOOM && type != LKVBD_TYPE_STREAM && type != LKVBD_TYPE_TS &&
+        type != LKVBD_TYPE_VSET && type != LKVBD_TYPE_HASH_TTL) {
       std::cerr << LKV_NOT_RECOGNIZED_MSG;
       return;
     }
@@ -302,6 +318,29 @@ void LiteKVLoad(const std::string& src, KVContainer* holder, EventLoop* loop,
           AddTimerEventToKey();
         }
       }
+    } else if (type == LKVBD_TYPE_HASH_TTL) {
+      HashDict hd;
+      DecodeHashDict(cursor, remain, hd);
+      /* expirations of fields follow the pairs */
+      size_t n_expires = DecodeInteger(cursor, remain);
+      std::vector<std::pair<std::string, uint64_t>> expires;
+      for (size_t i = 0; i < n_expires; ++i) {
+        std::string field = DecodeStdString(cursor, remain);
+        CHECK_REMAIN_BYTES(8);
+        expires.emplace_back(std::move(field), *(uint64_t*)(cursor));
+        Advance(cursor, remain, 8);
+      }
+      if ((expire_flag && exp_timestamp > current) || !expire_flag) {
+        for (auto& item : hd.AllEntries()) {
+          holder->HashUpdateKV(key, *(item->key), *(item->value), errcode);
+        }
+        for (auto& item : expires) {
+          holder->HashFieldExpireAt(key, {item.first}, item.second, errcode);
+        }
+        if (expire_flag) {
+          AddTimerEventToKey();
+        }
+      }
     } else if (type == LKVBD_TYPE_SET) {
       HashSet hs;
       DecodeHashSet(cursor, remain, hs);
@@ -313,6 +352,68 @@ void LiteKVLoad(const std::string& src, KVContainer* holder, EventLoop* loop,
           AddTimerEventToKey();
         }
       }
+    } else if (type == LKVBD_TYPE_ZSET) {
+      ZSet zs;
+      DecodeZSet(cursor, remain, zs);
+      if ((expire_flag && exp_timestamp > current) || !expire_flag) {
+        std::vector<std::pair<int64_t, std::string>> items;
+        items.reserve(zs.Count());
+        for (auto& item : zs.RangeByRank(0, zs.Count())) {
+          items.emplace_back(item.second, item.first.ToStdString());
+        }
+        holder->ZSetAdd(key, items, false, false, false, errcode);
+        if (expire_flag) {
+          AddTimerEventToKey();
+        }
+      }
+    } else if (type == LKVBD_TYPE_HLL || type == LKVBD_TYPE_CMS || type == LKVBD_TYPE_TOPK) {
+      /* sketches are stored as their dumped string */
+      std::string data = DecodeStdString(cursor, remain);
+      if ((expire_flag && exp_timestamp > current) || !expire_flag) {
+        bool restored;
+        if (type == LKVBD_TYPE_HLL) {
+          restored = holder->HLLRestore(key, data, errcode);
+        } else if (type == LKVBD_TYPE_CMS) {
+          restored = holder->CMSRestore(key, data, errcode);
+        } else {
+          restored = holder->TopKRestore(key, data, errcode);
+        }
+        if (!restored) {
+          std::cerr << LKV_NOT_RECOGNIZED_MSG;
+          return;
+        }
+        if (expire_flag) {
+          AddTimerEventToKey();
+        }
+      }
+    } else if (type == LKVBD_TYPE_BLOOM || type == LKVBD_TYPE_STREAM || type == LKVBD_TYPE_TS ||
+               type == LKVBD_TYPE_VSET) {
+      /* bits, segments, chunks and graphs are copied from the file content directly */
+      uint64_t data_len = DecodeInteger(cursor, remain);
+      if (remain < data_len) {
+        std::cerr << LKV_NOT_RECOGNIZED_MSG;
+        return;
+      }
+      if ((expire_flag && exp_timestamp > current) || !expire_flag) {
+        bool restored;
+        if (type == LKVBD_TYPE_BLOOM) {
+          restored = holder->BFRestore(key, cursor, data_len, errcode);
+        } else if (type == LKVBD_TYPE_STREAM) {
+          restored = holder->StreamRestore(key, cursor, data_len, errcode);
+        } else if (type == LKVBD_TYPE_TS) {
+          restored = holder->TSRestore(key, cursor, data_len, errcode);
+        } else {
+          restored = holder->VRestore(key, cursor, data_len, errcode);
+        }
+        if (!restored) {
+          std::cerr << LKV_NOT_RECOGNIZED_MSG;
+          return;
+        }
+        if (expire_flag) {
+          AddTimerEventToKey();
+        }
+      }
+      Advance(cursor, remain, data_len);
     } else {
       std::cerr << LKV_NOT_RECOGNIZED_MSG;
       return;
@@ -1,6 +1,7 @@
 #include <csignal>
 #include "config.h"
 #include "net/server.h"
+#include "net/reactor.h"
 #ifdef TCMALLOC_FOUND
 #include <gperftools/malloc_extension.h>
 #include <gperftools/heap-profiler.h>
@@ -39,14 +40,33 @@ int main(int argc, char **argv) {
   }
   Config configs(default_conf_filename);
 
+  if (configs.NumReactors() > 1) {
+    /* thread-per-core, every reactor restores and serves its own slice of keys */
+    if (configs.AppendonlyEnabled()) {
+      history = new AppendableFile(configs.GetDumpFilename(), configs.GetDumpCacheSize(), true,
+                                   configs.GetDumpFlushInterval());
+      if (configs.UringEnabled() && !history->UseUring()) {
+        std::cerr << "io_uring is not available for the appendable file, write it as before\n";
+      }
+    }
+    ReactorGroup reactors(&configs, history);
+    reactors.Run();
+    return 0;
+  }
+
   EventLoop loop;
   KVContainer container;
   Engine engine(&container, &configs);
+  /* reclaim expired hash fields which are never accessed again, a few hashes every 100ms */
+  loop.AddTimeEvent(100, [&container]() { container.HashActiveExpire(20); }, FIRE_FOREVER);
   std::string location = configs.GetDumpFilename();
   size_t cache_size = configs.GetDumpCacheSize();
   size_t flush_interval = configs.GetDumpFlushInterval();
   if (configs.AppendonlyEnabled()) {
     history = new AppendableFile(location, cache_size, true, flush_interval);
+    if (configs.UringEnabled() && !history->UseUring()) {
+      std::cerr << "io_uring is not available for the appendable file, write it as before\n";
+    }
     engine.RestoreFromAppendableFile(&loop, history);
     history->SetAutoFlush(true);
   }
@@ -8,8 +8,9 @@
 #include <sys/fcntl.h>
 #include <unistd.h>
 
-static std::ifstream ifs_app_status("/proc/self/status", std::ios::in);
-static std::ifstream ifs_meminfo_sys("/proc/meminfo", std::ios::in);
+/* every thread polling memory usage reads through its own streams */
+static thread_local std::ifstream ifs_app_status("/proc/self/status", std::ios::in);
+static thread_local std::ifstream ifs_meminfo_sys("/proc/meminfo", std::ios::in);
 
 static bool CatMemInfo(size_t &mem_total, size_t &mem_free, size_t &mem_avail) {
   /* unit: kB  */
@@ -45,12 +46,15 @@ static bool CatSelfMemInfo(size_t &vmsize, size_t& rss) {
   ss << ifs_app_status.rdbuf();
 
   std::string s = ss.str();
-  size_t pos = s.find("VmSize:");
+  size_t vmsize_pos = s.find("VmSize:");
+  size_t rss_pos = s.find("VmRSS:");
+  if (vmsize_pos == std::string::npos || rss_pos == std::string::npos) {
+    return false;
+  }
   /* vmsize */
-  vmsize = std::stol(s.substr(pos + 7, std::string::npos)); /* kB */
+  vmsize = std::stol(s.substr(vmsize_pos + 7, std::string::npos)); /* kB */
   /* VmRSS */
-  pos = s.find("VmRSS:");
-  rss = std::stol(s.substr(pos + 6, std::string::npos));  /* kB */
+  rss = std::stol(s.substr(rss_pos + 6, std::string::npos));  /* kB */
 //  ifs_app_status.close();
   return true;
 }
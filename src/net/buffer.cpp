@@ -1,6 +1,15 @@
 #include <algorithm>
 #include <fstream>
 #include "buffer.h"
+#include "respscan.h"
+
+/* the first delim in [begin, end), end if there is none */
+static const char *SearchDelim(const char *begin, const char *end, const char *delim, size_t delim_len) {
+  if (delim_len == 2 && delim[0] == '\r' && delim[1] == '\n') {
+    return RespFindCRLF(begin, end);
+  }
+  return std::search(begin, end, delim, delim + delim_len);
+}
 
 void Buffer::Append(const std::string &value) {
   Append(value.data(), value.size());
@@ -27,9 +36,9 @@ void Buffer::EnsureBytesForWrite(size_t n) {
     if (cur_free_space >= n) {
       MoveReadableToHead();
     } else {
-      /* need to alloc more space */
-      std::vector<char> new_place(p_writer_ + n + 2, 0);
+      /* need to alloc more space, grow by half at least so that appending is amortized */
       size_t r = ReadableBytes(); /* log original readable size to update p_writer_ after memcpy */
+      std::vector<char> new_place(std::max(r + n + 2, data_.size() + data_.size() / 2), 0);
       memcpy(new_place.data(), BeginRead(), r); /* discard prependable */
       data_.swap(new_place);  /* swap new and old space to save memory */
       p_reader_ = 0;
@@ -43,17 +52,21 @@ void Buffer::ReaderIdxForward(size_t len) {
   p_reader_ += len;
 }
 
+void Buffer::WriterIdxForward(size_t len) {
+  len = std::min(len, WritableBytes());
+  p_writer_ += len;
+}
+
 void Buffer::ReaderIdxBackward(size_t len) {
   len = std::min(len, PrependableBytes());
   p_reader_ -= len;
 }
 
 int Buffer::FindCRLFInReadable() {
-  auto it_start = data_.begin() + p_reader_;
-  auto it_end = data_.begin() + p_writer_;
-  auto it = std::search(it_start, it_end,
-                        CRLF, CRLF + 2);
-  return (it == it_end) ? -1 : (it - it_start); /* offset with respect to p_reader_ */
+  const char *begin = data_.data() + p_reader_;
+  const char *end = data_.data() + p_writer_;
+  const char *crlf = RespFindCRLF(begin, end);
+  return (crlf == end) ? -1 : (crlf - begin); /* offset with respect to p_reader_ */
 }
 
 std::string Buffer::ReadStdStringAndForward(size_t len) {
@@ -66,11 +79,10 @@ std::string Buffer::ReadStdStringAndForward(size_t len) {
 }
 
 std::string Buffer::ReadStdStringAndForwardTill(const char *delim) {
-  auto it_begin = data_.begin() + p_reader_;
-  auto it_end = data_.begin() + p_writer_;
+  const char *it_begin = data_.data() + p_reader_;
+  const char *it_end = data_.data() + p_writer_;
   size_t delim_len = strlen(delim);
-  auto it = std::search(it_begin, it_end,
-                        delim, delim + delim_len);
+  const char *it = SearchDelim(it_begin, it_end, delim, delim_len);
   if (it == it_end) {
     return "";
   }
@@ -118,11 +130,10 @@ DynamicString Buffer::ReadDynaString(size_t len) {
 }
 
 DynamicString Buffer::ReadAndForwardTill(const char *delim) {
-  auto it_begin = data_.begin() + p_reader_;
-  auto it_end = data_.begin() + p_writer_;
+  const char *it_begin = data_.data() + p_reader_;
+  const char *it_end = data_.data() + p_writer_;
   size_t delim_len = strlen(delim);
-  auto it = std::search(it_begin, it_end,
-                        delim, delim + delim_len);
+  const char *it = SearchDelim(it_begin, it_end, delim, delim_len);
   if (it == it_end) { /* can not find */
     return DynamicString();
   }
@@ -5,6 +5,7 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <utility>
 
 #include "../str.h"
 
@@ -40,10 +41,12 @@ public:
 
   inline char *BeginRead() { return data_.data() + p_reader_; }
 
+  inline const char *BeginRead() const { return data_.data() + p_reader_; }
+
   inline char *BeginWrite() { return data_.data() + p_writer_; }
 
   void MoveReadableToHead() {
-    memcpy(data_.data(), data_.data() + p_reader_, ReadableBytes());
+    memmove(data_.data(), data_.data() + p_reader_, ReadableBytes());
     size_t can_free = PrependableBytes();
     memset(data_.data() + p_writer_ - can_free, 0, can_free);
     /* update pointer */
@@ -51,6 +54,13 @@ public:
     p_writer_ = p_writer_ - can_free;
   }
 
+  /* exchange the bytes with other, nothing is copied */
+  void Swap(Buffer &other) {
+    data_.swap(other.data_);
+    std::swap(p_reader_, other.p_reader_);
+    std::swap(p_writer_, other.p_writer_);
+  }
+
   void Append(const std::string &value);
 
   void Append(const char *value, int len);
@@ -65,6 +75,11 @@ public:
   /* pointer to right */
   void ReaderIdxBackward(size_t len);
 
+  /* make room for n bytes at BeginWrite, which are taken by WriterIdxForward after written */
+  void EnsureBytesForWrite(size_t n);
+
+  void WriterIdxForward(size_t len);
+
   std::string ReadStdStringAndForward(size_t len);
 
   std::string ReadStdString(size_t len);
@@ -89,9 +104,6 @@ public:
 
   void ToFile(const std::string& file);
 
-private:
-  void EnsureBytesForWrite(size_t n);
-
 private:
   std::vector<char> data_;
   size_t p_reader_;
@@ -1,74 +1,271 @@
 #include <cassert>
+#include <cmath>
+#include <cstdio>
 #include <algorithm>
-#include <sstream>
 #include <chrono>
+#include <strings.h>
 
 #include "commands.h"
 #include "../core.h"
 #include "utils.h"
 
-std::unordered_map<std::string, CommandHandler> Engine::sOpCommandMap = {
+/* every command with its arity, key positions and flags, in lower case */
+static const CommandSpec kCommandTable[] = {
     /* generic command */
-    {"overview",  OverviewCommand},/* get database overview  */
-    {"total",     NumItemsCommand},/* get database number of items  */
-    {"ping",      PingCommand},   /* ping-pong test */
-    {"evict",     EvictCommand},   /* evict keys */
-    {"del",       DelCommand},    /* delete given keys */
-    {"exists",    ExistsCommand}, /* check if given keys exist */
-    {"type",      TypeCommand},   /* query object type */
-    {"expire",    ExpireCommand}, /* set the key expiration */
-    {"expireat",  ExpireAtCommand},/* set key expiration at unix-timestamp*/
-    {"ttl",       TTLCommand},    /* get the time to live of a key */
+    {"overview",      OverviewCommand,          1, 0, 0, 0,   CMD_READONLY},                    /* get database overview  */
+    {"total",         NumItemsCommand,          1, 0, 0, 0,   CMD_READONLY | CMD_FAST},         /* get database number of items  */
+    {"ping",          PingCommand,              1, 0, 0, 0,   CMD_FAST},                        /* ping-pong test */
+    {"evict",         EvictCommand,             2, 0, 0, 0,   CMD_WRITE},                       /* evict keys */
+    {"del",           DelCommand,               -2, 1, -1, 1, CMD_WRITE},                       /* delete given keys */
+    {"exists",        ExistsCommand,            -2, 1, -1, 1, CMD_READONLY | CMD_FAST},         /* check if given keys exist */
+    {"type",          TypeCommand,              2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* query object type */
+    {"expire",        ExpireCommand,            3, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* set the key expiration */
+    {"expireat",      ExpireAtCommand,          3, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* set key expiration at unix-timestamp*/
+    {"ttl",           TTLCommand,               2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the time to live of a key */
     /* int or string command */
-    {"set",       SetCommand},    /* set given key to string or int */
-    {"get",       GetCommand},    /* get value on given key */
+    {"set",           SetCommand,               3, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* set given key to string or int */
+    {"get",           GetCommand,               2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get value on given key */
     /* int command */
-    {"incr",      IncrCommand},   /* increase int value by 1 on given key */
-    {"decr",      DecrCommand},   /* decrease int value by 1 on given key */
-    {"incrby",    IncrByCommand}, /* increase int value by n on given key */
-    {"decrby",    DecrByCommand}, /* decrease int value by n on given key */
+    {"incr",          IncrCommand,              2, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* increase int value by 1 on given key */
+    {"decr",          DecrCommand,              2, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* decrease int value by 1 on given key */
+    {"incrby",        IncrByCommand,            3, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* increase int value by n on given key */
+    {"decrby",        DecrByCommand,            3, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* decrease int value by n on given key */
     /* string command */
-    {"strlen",    StrlenCommand}, /* get the len of string on given key */
-    {"append",    AppendCommand}, /* append value on given key */
-    {"getrange",  GetRangeCommand}, /* TODO not supported, get range value on given key */
-    {"setrange",  SetRangeCommand}, /* TODO not supported, set range value on given key */
+    {"strlen",        StrlenCommand,            2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the len of string on given key */
+    {"append",        AppendCommand,            3, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* append value on given key */
+    {"getrange",      GetRangeCommand,          4, 1, 1, 1,   CMD_READONLY},                    /* get range value on given key */
+    {"setrange",      SetRangeCommand,          4, 1, 1, 1,   CMD_WRITE},                       /* set range value on given key */
+    /* bitmap command */
+    {"setbit",        SetBitCommand,            4, 1, 1, 1,   CMD_WRITE},                       /* set or clear the bit at offset on given key */
+    {"getbit",        GetBitCommand,            3, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the bit at offset on given key */
+    {"bitcount",      BitCountCommand,          -2, 1, 1, 1,  CMD_READONLY},                    /* count set bits on given key */
+    {"bitpos",        BitPosCommand,            -3, 1, 1, 1,  CMD_READONLY},                    /* find the first bit set or clear on given key */
+    {"bitop",         BitOpCommand,             -4, 2, -1, 1, CMD_WRITE},                       /* perform bitwise operation between strings */
     /* list command */
-    {"llen",      LLenCommand},   /* get the length of list on given key */
-    {"lpop",      LPopCommand},   /* left pop one value from list on given key */
-    {"lpush",     LPushCommand},  /* left push values from list on given key */
-    {"rpop",      RPopCommand},   /* right pop one value from list on given key */
-    {"rpush",     RPushCommand},  /* right push values from list on given key */
-    {"lrange",    LRangeCommand}, /* get value in range of list on given key */
-    {"linsert",   LInsertCommand},/* TODO not supported, insert value into list on given key */
-    {"lrem",      LRemCommand},   /* TODO not supported, remove element from list on given key */
-    {"lsetindex", LSetCommand},   /* set element from list at index on given key  */
-    {"lindex",    LIndexCommand}, /* get element in list at index on given key */
+    {"llen",          LLenCommand,              2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the length of list on given key */
+    {"lpop",          LPopCommand,              2, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* left pop one value from list on given key */
+    {"lpush",         LPushCommand,             -3, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* left push values from list on given key */
+    {"rpop",          RPopCommand,              2, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* right pop one value from list on given key */
+    {"rpush",         RPushCommand,             -3, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* right push values from list on given key */
+    {"lrange",        LRangeCommand,            4, 1, 1, 1,   CMD_READONLY},                    /* get value in range of list on given key */
+    {"linsert",       LInsertCommand,           5, 1, 1, 1,   CMD_WRITE},                       /* insert value before or after pivot into list on given key */
+    {"lrem",          LRemCommand,              4, 1, 1, 1,   CMD_WRITE},                       /* remove elements equal to value from list on given key */
+    {"ltrim",         LTrimCommand,             4, 1, 1, 1,   CMD_WRITE},                       /* trim list on given key to the specified range */
+    {"lsetindex",     LSetCommand,              4, 1, 1, 1,   CMD_WRITE},                       /* set element from list at index on given key  */
+    {"lindex",        LIndexCommand,            3, 1, 1, 1,   CMD_READONLY},                    /* get element in list at index on given key */
+    {"lmove",         LMoveCommand,             5, 1, 2, 1,   CMD_WRITE},                       /* pop element from one list and push it into another list */
+    {"blpop",         BLPopCommand,             -3, 1, -2, 1, CMD_WRITE},                       /* left pop from the first non-empty list, block if all lists are empty */
+    {"brpop",         BRPopCommand,             -3, 1, -2, 1, CMD_WRITE},                       /* right pop from the first non-empty list, block if all lists are empty */
+    {"blmove",        BLMoveCommand,            6, 1, 2, 1,   CMD_WRITE},                       /* blocking version of lmove */
     /* hash operation */
-    {"hset",      HSetCommand},   /* set field in the hash on given key to value. */
-    {"hget",      HGetCommand},   /* return the value associated with field in the hash on given key */
-    {"hdel",      HDelCommand},   /* delete specified fields in the hash on given key */
-    {"hexists",   HExistsCommand},/* check specified field exists in the hash on given key */
-    {"hgetall",   HGetAllCommand},/* get all field-value pairs in the hash on given key */
-    {"hkeys",     HKeysCommand},  /* get all fields in the hash on given key */
-    {"hvals",     HValsCommand},  /* get all values in the hash on given key */
-    {"hlen",      HLenCommand},   /* get number of field-value pairs in the hash on given key */
+    {"hset",          HSetCommand,              -4, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* set field in the hash on given key to value. */
+    {"hget",          HGetCommand,              -3, 1, 1, 1,  CMD_READONLY | CMD_FAST},         /* return the value associated with field in the hash on given key */
+    {"hdel",          HDelCommand,              -3, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* delete specified fields in the hash on given key */
+    {"hexists",       HExistsCommand,           3, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* check specified field exists in the hash on given key */
+    {"hgetall",       HGetAllCommand,           2, 1, 1, 1,   CMD_READONLY},                    /* get all field-value pairs in the hash on given key */
+    {"hkeys",         HKeysCommand,             2, 1, 1, 1,   CMD_READONLY},                    /* get all fields in the hash on given key */
+    {"hvals",         HValsCommand,             2, 1, 1, 1,   CMD_READONLY},                    /* get all values in the hash on given key */
+    {"hlen",          HLenCommand,              2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get number of field-value pairs in the hash on given key */
+    {"hincrby",       HIncrByCommand,           4, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* increase the integer value of field in the hash */
+    {"hincrbyfloat",  HIncrByFloatCommand,      4, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* increase the float value of field in the hash */
+    {"hsetnx",        HSetNXCommand,            4, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* set field in the hash only if it does not exist */
+    {"hmget",         HMGetCommand,             -3, 1, 1, 1,  CMD_READONLY | CMD_FAST},         /* get values of fields in the hash */
+    {"hexpire",       HExpireCommand,           -3, 1, 1, 1,  CMD_WRITE},                       /* set expiration of fields in seconds */
+    {"hpexpire",      HPExpireCommand,          -3, 1, 1, 1,  CMD_WRITE},                       /* set expiration of fields in milliseconds */
+    {"hpexpireat",    HPExpireAtCommand,        -3, 1, 1, 1,  CMD_WRITE},                       /* set expiration of fields as unix milliseconds */
+    {"httl",          HTTLCommand,              -3, 1, 1, 1,  CMD_READONLY},                    /* get remaining time to live of fields in seconds */
+    {"hpttl",         HPTTLCommand,             -3, 1, 1, 1,  CMD_READONLY},                    /* get remaining time to live of fields in milliseconds */
+    {"hpersist",      HPersistCommand,          -3, 1, 1, 1,  CMD_WRITE},                       /* remove expiration of fields */
     /* set operation */
-    {"sadd",        SAddCommand},         /* add members into the set */
-    {"sismember",   SIsMemberCommand},    /* check a member is inside set */
-    {"smismember",  SMIsMemberCommand},   /* check multiple members are inside set */
-    {"smembers",    SMembersCommand},     /* get all members inside set */
-    {"srem",        SRemCommand},         /* remove the specified member inside set */
-    {"scard",       SCardCommand},        /* get the number of members inside set */
-    {"spop",        SPopCommand},         /* TODO not supported yet, pop a member from set */
+    {"sadd",          SAddCommand,              -3, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* add members into the set */
+    {"sismember",     SIsMemberCommand,         3, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* check a member is inside set */
+    {"smismember",    SMIsMemberCommand,        -3, 1, 1, 1,  CMD_READONLY | CMD_FAST},         /* check multiple members are inside set */
+    {"smembers",      SMembersCommand,          2, 1, 1, 1,   CMD_READONLY},                    /* get all members inside set */
+    {"srem",          SRemCommand,              -3, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* remove the specified member inside set */
+    {"scard",         SCardCommand,             2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the number of members inside set */
+    {"spop",          SPopCommand,              -2, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* remove and return random members from set */
+    {"srandmember",   SRandMemberCommand,       -2, 1, 1, 1,  CMD_READONLY},                    /* get random members from set */
+    {"sinter",        SInterCommand,            -2, 1, -1, 1, CMD_READONLY},                    /* get the intersection of sets */
+    {"sunion",        SUnionCommand,            -2, 1, -1, 1, CMD_READONLY},                    /* get the union of sets */
+    {"sdiff",         SDiffCommand,             -2, 1, -1, 1, CMD_READONLY},                    /* get the members of the first set which are not in the others */
+    {"sintercard",    SInterCardCommand,        -3, 0, 0, 0,  CMD_READONLY | CMD_MOVABLE_KEYS}, /* get the number of members in the intersection of sets */
+    {"sinterstore",   SInterStoreCommand,       -3, 1, -1, 1, CMD_WRITE},                       /* store the intersection of sets into destination */
+    {"sunionstore",   SUnionStoreCommand,       -3, 1, -1, 1, CMD_WRITE},                       /* store the union of sets into destination */
+    {"sdiffstore",    SDiffStoreCommand,        -3, 1, -1, 1, CMD_WRITE},                       /* store the difference of sets into destination */
+    /* sorted set operation */
+    {"zadd",          ZAddCommand,              -3, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* add members with scores into the sorted set */
+    {"zincrby",       ZIncrByCommand,           4, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* increase the score of member in the sorted set */
+    {"zscore",        ZScoreCommand,            3, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the score of member in the sorted set */
+    {"zrem",          ZRemCommand,              -3, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* remove members from the sorted set */
+    {"zcard",         ZCardCommand,             2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the number of members in the sorted set */
+    {"zrank",         ZRankCommand,             3, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the rank of member ordered by score */
+    {"zrange",        ZRangeCommand,            -4, 1, 1, 1,  CMD_READONLY},                    /* get members in range of rank */
+    {"zrangebyscore", ZRangeByScoreCommand,     -4, 1, 1, 1,  CMD_READONLY},                    /* get members in range of score */
+    {"zpopmin",       ZPopMinCommand,           -2, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* remove and return members with the lowest scores */
+    /* hyperloglog operation */
+    {"pfadd",         PfAddCommand,             -2, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* add elements into the hyperloglog */
+    {"pfcount",       PfCountCommand,           -2, 1, -1, 1, CMD_READONLY},                    /* get the estimated cardinality of the hyperloglogs */
+    {"pfmerge",       PfMergeCommand,           -2, 1, -1, 1, CMD_WRITE},                       /* merge hyperloglogs into destination */
+    {"pfrestore",     PfRestoreCommand,         3, 1, 1, 1,   CMD_WRITE},                       /* restore hyperloglog from dumped registers */
+    /* count-min sketch operation */
+    {"cms.initbydim", CMSInitByDimCommand,      4, 1, 1, 1,   CMD_WRITE},                       /* create a count-min sketch with width and depth */
+    {"cms.incrby",    CMSIncrByCommand,         -4, 1, 1, 1,  CMD_WRITE},                       /* increase the counts of items */
+    {"cms.query",     CMSQueryCommand,          -3, 1, 1, 1,  CMD_READONLY},                    /* get the estimated counts of items */
+    {"cms.merge",     CMSMergeCommand,          -4, 1, 1, 1,  CMD_WRITE | CMD_MOVABLE_KEYS},    /* merge sketches into destination */
+    {"cms.restore",   CMSRestoreCommand,        3, 1, 1, 1,   CMD_WRITE},                       /* restore count-min sketch from dumped counters */
+    /* top-k operation */
+    {"topk.reserve",  TopKReserveCommand,       -3, 1, 1, 1,  CMD_WRITE},                       /* create a top-k with k, width, depth and decay */
+    {"topk.add",      TopKAddCommand,           -3, 1, 1, 1,  CMD_WRITE},                       /* add items into top-k */
+    {"topk.incrby",   TopKIncrByCommand,        -4, 1, 1, 1,  CMD_WRITE},                       /* increase the counts of items in top-k */
+    {"topk.query",    TopKQueryCommand,         -3, 1, 1, 1,  CMD_READONLY},                    /* check whether items are in top-k */
+    {"topk.list",     TopKListCommand,          -2, 1, 1, 1,  CMD_READONLY},                    /* get all items in top-k */
+    {"topk.restore",  TopKRestoreCommand,       3, 1, 1, 1,   CMD_WRITE},                       /* restore top-k from dumped buckets */
+    /* bloom filter operations */
+    {"bf.reserve",    BFReserveCommand,         -4, 1, 1, 1,  CMD_WRITE},                       /* create a bloom filter with error rate and capacity */
+    {"bf.add",        BFAddCommand,             3, 1, 1, 1,   CMD_WRITE | CMD_FAST},            /* add an item into bloom filter */
+    {"bf.madd",       BFMAddCommand,            -3, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* add items into bloom filter */
+    {"bf.exists",     BFExistsCommand,          3, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* check whether an item may exist in bloom filter */
+    {"bf.mexists",    BFMExistsCommand,         -3, 1, 1, 1,  CMD_READONLY | CMD_FAST},         /* check whether items may exist in bloom filter */
+    {"bf.restore",    BFRestoreCommand,         3, 1, 1, 1,   CMD_WRITE},                       /* restore bloom filter from dumped bits */
+    /* stream operations */
+    {"xadd",          XAddCommand,              -3, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* append an entry into stream */
+    {"xrange",        XRangeCommand,            -4, 1, 1, 1,  CMD_READONLY},                    /* get entries in id range */
+    {"xrevrange",     XRevRangeCommand,         -4, 1, 1, 1,  CMD_READONLY},                    /* get entries in id range from high to low */
+    {"xlen",          XLenCommand,              2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the number of entries in stream */
+    {"xtrim",         XTrimCommand,             -4, 1, 1, 1,  CMD_WRITE},                       /* remove the oldest entries by length or min id */
+    {"xread",         XReadCommand,             -4, 0, 0, 0,  CMD_READONLY | CMD_MOVABLE_KEYS}, /* read entries after ids from streams, block if none */
+    {"xrestore",      XRestoreCommand,          3, 1, 1, 1,   CMD_WRITE},                       /* restore stream from dumped segments */
+    /* time series operations */
+    {"ts.create",     TSCreateCommand,          -2, 1, 1, 1,  CMD_WRITE},                       /* create a time series with retention */
+    {"ts.add",        TSAddCommand,             -4, 1, 1, 1,  CMD_WRITE | CMD_FAST},            /* append a sample into time series */
+    {"ts.madd",       TSMAddCommand,            -4, 1, -1, 3, CMD_WRITE},                       /* append samples into time series */
+    {"ts.get",        TSGetCommand,             2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the last sample of time series */
+    {"ts.range",      TSRangeCommand,           -4, 1, 1, 1,  CMD_READONLY},                    /* get samples in time range, aggregated or not */
+    {"ts.restore",    TSRestoreCommand,         3, 1, 1, 1,   CMD_WRITE},                       /* restore time series from dumped chunks */
+    /* vector set operations */
+    {"vadd",          VAddCommand,              -2, 1, 1, 1,  CMD_WRITE},                       /* add an element with its vector into vector set */
+    {"vrem",          VRemCommand,              3, 1, 1, 1,   CMD_WRITE},                       /* remove an element from vector set */
+    {"vsim",          VSimCommand,              -2, 1, 1, 1,  CMD_READONLY},                    /* get the elements most similar to a vector */
+    {"vcard",         VCardCommand,             2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the number of elements in vector set */
+    {"vdim",          VDimCommand,              2, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the dimension of vectors in vector set */
+    {"vemb",          VEmbCommand,              3, 1, 1, 1,   CMD_READONLY | CMD_FAST},         /* get the vector of an element */
+    {"vrestore",      VRestoreCommand,          3, 1, 1, 1,   CMD_WRITE},                       /* restore vector set from dumped vectors and graph */
     /* pub/sub operations */
-    {"publish",   PubSubPublishCommand},        /* publish a message to specific channel */
-    {"subscribe", PubSubSubscribeCommand},      /* subscribe to specific channels */
-    {"unsubscribe", PubSubUnsubscribeCommand},  /* unsubscribe from specific channels */
+    {"publish",       PubSubPublishCommand,     3, 0, 0, 0,   CMD_PUBSUB | CMD_FAST},           /* publish a message to specific channel */
+    {"subscribe",     PubSubSubscribeCommand,   -2, 0, 0, 0,  CMD_PUBSUB},                      /* subscribe to specific channels */
+    {"unsubscribe",   PubSubUnsubscribeCommand, -1, 0, 0, 0,  CMD_PUBSUB},                      /* unsubscribe from specific channels */
     /* save operations */
-    {"bgsave", BgsaveCommand}             /* dump binary data into file in background  */
+    {"bgsave",        BgsaveCommand,            1, 0, 0, 0,   0},                               /* dump binary data into file in background  */
 };
 
-static int sEvictPolicy = EVICTION_POLICY_RANDOM;
+static constexpr size_t kNumCommands = sizeof(kCommandTable) / sizeof(kCommandTable[0]);
+static_assert(kNumCommands < 255, "command index is kept in uint8_t");
+
+static inline unsigned char LowerChar(unsigned char c) {
+  return c >= 'A' && c <= 'Z' ? c | 0x20 : c;
+}
+
+/* FNV-1a over name in lower case */
+static inline uint64_t CommandNameHash(const char *name, size_t len) {
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; ++i) {
+    h = (h ^ LowerChar(name[i])) * 1099511628211ULL;
+  }
+  return h;
+}
+
+/* finalizer of splitmix64, spreads the hash displaced by seed */
+static inline uint64_t MixSeed(uint64_t h, uint64_t seed) {
+  h += seed * 0x9e3779b97f4a7c15ULL;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+/**
+ * Perfect hash over kCommandTable with hash and displace: a name falls into a bucket by its hash,
+ * every bucket has a seed which sends all of its names into distinct slots. A lookup hashes the
+ * name once, picks its slot and compares the only candidate, without lowering the name first.
+ */
+class CommandIndex {
+public:
+  CommandIndex() {
+    std::vector<std::vector<size_t>> buckets(kNumBuckets);
+    for (size_t i = 0; i < kNumCommands; ++i) {
+      lens_[i] = strlen(kCommandTable[i].name);
+      hashes_[i] = CommandNameHash(kCommandTable[i].name, lens_[i]);
+      buckets[hashes_[i] & (kNumBuckets - 1)].push_back(i);
+    }
+    /* larger buckets are placed first while most slots are free */
+    std::vector<size_t> order(kNumBuckets);
+    for (size_t b = 0; b < kNumBuckets; ++b) {
+      order[b] = b;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](size_t x, size_t y) {
+      return buckets[x].size() > buckets[y].size();
+    });
+    for (size_t b : order) {
+      uint16_t seed = 0;
+      while (!TryPlace(buckets[b], seed)) {
+        ++seed;
+        assert(seed != 0);
+      }
+      seeds_[b] = seed;
+    }
+  }
+
+  const CommandSpec *Find(const StringView &name) const {
+    uint64_t h = CommandNameHash(name.data(), name.size());
+    uint8_t idx = slots_[MixSeed(h, seeds_[h & (kNumBuckets - 1)]) & (kNumSlots - 1)];
+    if (idx == 0 || lens_[idx - 1] != name.size()) {
+      return nullptr;
+    }
+    const CommandSpec *spec = &kCommandTable[idx - 1];
+    for (size_t i = 0; i < name.size(); ++i) {
+      if (LowerChar(name[i]) != (unsigned char) spec->name[i]) {
+        return nullptr;
+      }
+    }
+    return spec;
+  }
+
+private:
+  bool TryPlace(const std::vector<size_t> &bucket, uint16_t seed) {
+    std::vector<size_t> placed;
+    for (size_t i : bucket) {
+      size_t slot = MixSeed(hashes_[i], seed) & (kNumSlots - 1);
+      if (slots_[slot] != 0) {
+        for (size_t taken : placed) {
+          slots_[taken] = 0;
+        }
+        return false;
+      }
+      slots_[slot] = (uint8_t) (i + 1);
+      placed.push_back(slot);
+    }
+    return true;
+  }
+
+private:
+  static constexpr size_t kNumBuckets = 64;
+  static constexpr size_t kNumSlots = 256;
+  uint16_t seeds_[kNumBuckets] = {0};
+  uint8_t slots_[kNumSlots] = {0};  /* index into kCommandTable plus 1, 0 if empty */
+  size_t lens_[kNumCommands] = {0};
+  uint64_t hashes_[kNumCommands] = {0};
+};
+
+static const CommandIndex &GetCommandIndex() {
+  static const CommandIndex index;
+  return index;
+}
+
+static thread_local int sEvictPolicy = EVICTION_POLICY_RANDOM;
+
+/* commands handled by this thread, counted by their flags */
+static thread_local size_t sNumWriteCommands = 0;
+static thread_local size_t sNumReadonlyCommands = 0;
+static thread_local size_t sNumPubSubCommands = 0;
 
 #define IfFailReturn(errcode, retval) \
   do {                                \
@@ -77,17 +274,17 @@ static int sEvictPolicy = EVICTION_POLICY_RANDOM;
     }                                 \
   } while (0)
 
-#define IfWrongTypeReturn(errcode)   \
-  do {                               \
-    if (errcode == kWrongTypeCode) { \
-      return kWrongTypeMsg;          \
-    }                                \
+#define IfWrongTypeReturn(errcode)     \
+  do {                                 \
+    if (errcode == kWrongTypeCode) {   \
+      return reply.Raw(kWrongTypeMsg); \
+    }                                  \
   } while (0)
 
 #define IfKeyNotFoundReturn(errcode)   \
   do {                                 \
     if (errcode == kKeyNotFoundCode) { \
-      return kNilMsg;                  \
+      return reply.Raw(kNilMsg);       \
     }                                  \
   } while (0)
 
@@ -98,118 +295,22 @@ static int sEvictPolicy = EVICTION_POLICY_RANDOM;
     }                                   \
   } while (0)
 
-// FIXME optimize syntax check
-static bool CheckSyntax(const CommandCache &cmd, int8_t n_key_required, int8_t n_operands_required, bool even = false) {
-  size_t len = cmd.argv.size();
-  if (even && (len & 1) != 0) { /* if even flag is true, the number of argv (len) must be even */
-    return false;
-  }
-  if (n_key_required == 0) { /* no key is required, len must be 1 */
-    return len == 1;
-  }
-  if (n_key_required == 1) {  /* single key is required */
-    if (n_operands_required == -1) {  /* but the number of operands is unlimited */
-      return len >= 3;
-    } else {
-      return len == (size_t) (n_operands_required + 2);
-    }
-  }
-  if (n_key_required == -1) { /* number of keys not limited, but len should be at least 2 */
-    return len >= 2;
-  }
-  if (n_key_required == -2) { /* the number of key is not limited, can be one or more */
-    return len >= 1;
-  }
-  return false;
-}
-
-#define CheckSyntaxHelper(cmd, n_key_required, n_operands_required, even, name)\
-  do {                                                                         \
-    if (!CheckSyntax(cmd, n_key_required, n_operands_required, even)) {        \
-      return PackErrMsg("ERROR", "incorrect number of arguments for " #name    \
-                                 " command");                                  \
-    }                                                                          \
+/* wake up sessions blocked on list key */
+#define SignalListKeyReady(key)                \
+  do {                                         \
+    if (params && params->server) {            \
+      params->server->SignalKeyAsReady(key);   \
+    }                                          \
   } while (0)
 
-static std::string PackIntReply(long value) {
-  return kIntPrefix + std::to_string(value) + kCRLF;
-}
-
-static std::string PackBoolReply(bool yes) {
-  if (yes) {
-    return kInt1Msg;
-  }
-  return kInt0Msg;
-}
-
-static std::string PackStringValueReply(const std::string &value) {
-  size_t len = value.size();
-  return kStrValPrefix + std::to_string(len) + kCRLF + value + kCRLF;
-}
-
-static std::string PackStringValueReply(const DynamicString &value) {
-  return kStrValPrefix + std::to_string(value.Length()) + kCRLF + value.ToStdString() + kCRLF;
-}
-
-static void PackStringValueIntoStream(std::stringstream& ss, const std::string& value) {
-  ss << kStrValPrefix << value.size() << kCRLF << value << kCRLF;
-}
-
-static void PackStringValueIntoStream(std::stringstream& ss, const DynamicString& value) {
-  if (!value.Null()) {
-    ss << kStrValPrefix << value.Length() << kCRLF << value << kCRLF;
-  } else {
-    ss << kNilMsg;
-  }
-}
-
-static std::string PackStringMsgReply(const std::string &msg) {
-  return kStrMsgPrefix + msg + kCRLF;
-}
-
-static std::string PackErrMsg(const char *et, const char *msg) {
-  std::stringstream ers;
-  ers << kErrPrefix << et << ' ' << msg << kCRLF;
-  return ers.str();
-}
-
-static std::string PackArrayMsg(const std::vector<DynamicString> &array) {
-  std::stringstream arr_ss;
-  size_t len = array.size();
-  arr_ss << kArrayPrefix << len << kCRLF;
-  for (const auto &value : array) {
-    // arr_ss << PackStringValueReply(value);
-    PackStringValueIntoStream(arr_ss, value);
-  }
-  return arr_ss.str();
-}
-
-static std::string PackArrayMsg(const std::vector<std::string> &array) {
-  std::stringstream arr_ss;
-  size_t len = array.size();
-  arr_ss << kArrayPrefix << len << kCRLF;
-  for (const auto &value : array) {
-    arr_ss << PackStringValueReply(value);
-  }
-  return arr_ss.str();
-}
-
-static std::string PackEmptyArrayMsg(size_t size) {
-  std::stringstream arr_ss;
-  arr_ss << kArrayPrefix << size << kCRLF;
-  for (size_t i = 0; i < size; ++i) {
-    arr_ss << kNilMsg;
-  }
-  return arr_ss.str();
-}
-
-static std::string PackIntArrayMsg(const std::vector<int>& array) {
-  std::stringstream ss;
-  ss << kArrayPrefix << array.size() << kCRLF;
-  for (const int& elem : array) {
-    ss << kIntPrefix << elem << kCRLF;
+/* sync an equivalent command instead of the original one into appendable file */
+static void AddIntoAppendable(AppendableFile *appendable, bool sync, std::vector<std::string> argv) {
+  if (sync && appendable) {
+    CommandCache cmd;
+    cmd.inited = true;
+    cmd.Assign(std::move(argv));
+    appendable->Append(cmd);
   }
-  return ss.str();
 }
 
 Engine::Engine(KVContainer *container, Config *config) :
@@ -225,10 +326,9 @@ Engine::~Engine() {
   worker_.join();
 }
 
-std::string Engine::HandleCommand(EventLoop *loop, CommandCache &cmds, bool sync, Session* sess, OptionalHandlerParams* params) {
+void Engine::HandleCommand(EventLoop *loop, CommandCache &cmds, ReplyWriter &reply, bool sync, Session* sess, OptionalHandlerParams* params) {
   size_t argc = cmds.argc;
-  std::vector<std::string> &argv = cmds.argv;
-  assert(argc == argv.size());
+  assert(argc == cmds.argv.size());
   /* Commands contents
   *  +------------+----------+-------------------------+
   *  |   argv[0]  |  argv[1] |   argv[2] ... argv[n]   |
@@ -236,27 +336,37 @@ std::string Engine::HandleCommand(EventLoop *loop, CommandCache &cmds, bool sync
   *  |   opcode   |   key    |         operands        |
   *  +------------+----------+-------------------------+
   */
-  std::transform(argv[0].begin(), argv[0].end(), argv[0].begin(), ::tolower);
-  std::string opcode = argv[0];
-  if (!OpCodeValid(opcode)) {
-    return kInvalidOpCodeMsg;
+  const CommandSpec *spec = ResolveCommand(cmds);
+  if (spec == nullptr) {
+    return reply.Raw(kInvalidOpCodeMsg);
+  }
+  if (!ArityMatches(spec, argc)) {
+    std::string msg = std::string("incorrect number of arguments for '") + spec->name + "' command";
+    return reply.Error("ERROR", msg.c_str());
+  }
+  if (spec->flags & CMD_WRITE) {
+    ++sNumWriteCommands;
+  } else if (spec->flags & CMD_READONLY) {
+    ++sNumReadonlyCommands;
+  } else if (spec->flags & CMD_PUBSUB) {
+    ++sNumPubSubCommands;
   }
   CommandCache cmd;
-  if (appending_) {
+  /* only write commands are synced into appending_ */
+  if (appending_ && (spec->flags & CMD_WRITE)) {
     if (sync) {
       appending_->SetAutoFlush(true);
     } else {
       appending_->SetAutoFlush(false);
     }
   }
-  /* lazy eviction, once at a time to avoid massive time consumption */
+  /* lazy eviction before commands which may take more memory, once at a time to avoid massive time consumption */
   /* FIXME: this is slow if too many keys to evict */
-  if (IfNeedKeyEviction()) {
+  if ((spec->flags & CMD_WRITE) && IfNeedKeyEviction()) {
     /* we can get the evicted keys from ans */
     auto ans = container_->KeyEviction(sEvictPolicy, 16);
     ans.insert(ans.begin(), "del");
-    cmd.argc = ans.size();
-    cmd.argv = ans;
+    cmd.Assign(ans);
     cmd.inited = true;
     if (appending_) {
       appending_->Append(cmd);
@@ -265,17 +375,51 @@ std::string Engine::HandleCommand(EventLoop *loop, CommandCache &cmds, bool sync
   }
   /* sync to control whether sync commands to appending_ for persistence */
   /* sync == true: sync; flag == false: no sync */
-  return sOpCommandMap[opcode](loop, container_, appending_, cmds, sync, config_, sess, params);
+  spec->handler(loop, container_, appending_, cmds, sync, config_, sess, params, reply);
+}
+
+std::string Engine::HandleCommand(EventLoop *loop, CommandCache &cmds, bool sync, Session* sess, OptionalHandlerParams* params) {
+  Buffer buffer;
+  ReplyWriter reply(buffer);
+  HandleCommand(loop, cmds, reply, sync, sess, params);
+  return buffer.ReadableAsString();
 }
 
 bool Engine::OpCodeValid(const std::string &opcode) {
-  return sOpCommandMap.find(opcode) != sOpCommandMap.end();
+  return LookupCommand(opcode) != nullptr;
+}
+
+const CommandSpec *Engine::LookupCommand(const StringView &name) {
+  return GetCommandIndex().Find(name);
+}
+
+const CommandSpec *Engine::ResolveCommand(CommandCache &cmds) {
+  if (cmds.argv.empty()) {
+    return nullptr;
+  }
+  const CommandSpec *spec = LookupCommand(cmds.argv[0]);
+  if (spec != nullptr) {
+    /* names in the table live as long as the program */
+    cmds.argv[0] = StringView(spec->name, cmds.argv[0].size());
+  }
+  return spec;
+}
+
+void Engine::KeyPositions(const CommandSpec *spec, size_t argc, std::vector<size_t> &keys) {
+  if (spec->first_key <= 0 || (spec->flags & CMD_MOVABLE_KEYS) || argc <= (size_t) spec->first_key) {
+    return;
+  }
+  size_t last = spec->last_key < 0 ? argc + spec->last_key : std::min((size_t) spec->last_key, argc - 1);
+  for (size_t i = spec->first_key; i <= last && i < argc; i += spec->key_step) {
+    keys.push_back(i);
+  }
 }
 
-bool Engine::RestoreFromAppendableFile(EventLoop *loop, AppendableFile *history) {
+bool Engine::RestoreFromAppendableFile(EventLoop *loop, AppendableFile *history,
+                                       const std::function<bool(CommandCache &)> &filter) {
   if (history) {
     appending_ = history;
-    history->ReadFromScratch(this, loop);
+    history->ReadFromScratch(this, loop, filter);
     std::cout << "Database restore from disk...\n";
     return true;
   }
@@ -299,85 +443,102 @@ void Engine::UpdateMemInfo() {
 }
 
 #define __PARAMETERS_LIST EventLoop *loop, KVContainer *holder, AppendableFile *appendable, \
-                          const CommandCache &cmds, bool sync, Config* config, Session* sess, OptionalHandlerParams* params
+                          const CommandCache &cmds, bool sync, Config* config, Session* sess, OptionalHandlerParams* params, \
+                          ReplyWriter &reply
 
-std::string OverviewCommand(__PARAMETERS_LIST) {
+void OverviewCommand(__PARAMETERS_LIST) {
   /* usage: overview */
-  CheckSyntaxHelper(cmds, 0, 0, false, 'overview');
-  return PackArrayMsg(holder->Overview());
+  std::vector<DynamicString> overview = holder->Overview();
+  overview.emplace_back("Number of write commands:");
+  overview.emplace_back(std::to_string(sNumWriteCommands));
+  overview.emplace_back("Number of readonly commands:");
+  overview.emplace_back(std::to_string(sNumReadonlyCommands));
+  overview.emplace_back("Number of pub/sub commands:");
+  overview.emplace_back(std::to_string(sNumPubSubCommands));
+  return reply.Array(overview);
 }
 
-std::string NumItemsCommand(__PARAMETERS_LIST) {
+void NumItemsCommand(__PARAMETERS_LIST) {
   /* usage: total */
-  CheckSyntaxHelper(cmds, 0, 0, false, 'total');
-  return PackIntReply(holder->NumItems());
+  return reply.Int(holder->NumItems());
 }
 
-std::string PingCommand(__PARAMETERS_LIST) {
+void PingCommand(__PARAMETERS_LIST) {
   /* usage: ping */
-  CheckSyntaxHelper(cmds, 0, 0, false, 'ping');
-  return kPONGMsg;
+  return reply.Raw(kPONGMsg);
 }
 
-std::string EvictCommand(__PARAMETERS_LIST) {
+void EvictCommand(__PARAMETERS_LIST) {
   /* usage: evict number */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'evict');
   size_t n;
-  const std::string &n_req_del = cmds.argv[1];
+  const StringView &n_req_del = cmds.argv[1];
   if (!CanConvertToUInt64(n_req_del, n)) {
-    return kInvalidIntegerMsg;
+    return reply.Raw(kInvalidIntegerMsg);
   }
   std::vector<std::string> ans = holder->KeyEviction(sEvictPolicy, n);
   if (sync && appendable) {
     CommandCache cmd;
     ans.insert(ans.begin(), "del");
-    cmd.argc = ans.size();
-    cmd.argv = ans;
+    cmd.Assign(ans);
     cmd.inited = true;
     appendable->Append(cmd);
   }
-  return PackIntReply((int)ans.size() - 1);
+  return reply.Int((int)ans.size() - 1);
 }
 
-std::string DelCommand(__PARAMETERS_LIST) {
+void DelCommand(__PARAMETERS_LIST) {
   /* usage: del key1 key2 key3 ... */
-  CheckSyntaxHelper(cmds, -1, 0, false, 'del'); /* multiple keys supported */
   size_t n = holder->Delete(std::vector<std::string>(cmds.argv.begin() + 1, cmds.argv.end()));
   AddIntoAppendableDirectly(cmds);
-  return PackIntReply(n);
+  return reply.Int(n);
 }
 
-std::string ExistsCommand(__PARAMETERS_LIST) {
+void ExistsCommand(__PARAMETERS_LIST) {
   /* usage: exists key1 key2 key3 ... */
-  CheckSyntaxHelper(cmds, -1, 0, false, 'exists');
   auto keys = std::vector<std::string>(cmds.argv.begin() + 1, cmds.argv.end());
   int n = holder->KeyExists(keys);
-  return PackIntReply(n);
+  return reply.Int(n);
 }
 
-std::string TypeCommand(__PARAMETERS_LIST) {
+void TypeCommand(__PARAMETERS_LIST) {
   /* usage: type key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'type');
   int obj_type = holder->QueryObjectType(cmds.argv[1]);
   if (obj_type == OBJECT_INT) {
-    return PackStringMsgReply("int");
+    return reply.Status("int");
   } else if (obj_type == OBJECT_STRING) {
-    return PackStringMsgReply("string");
+    return reply.Status("string");
   } else if (obj_type == OBJECT_LIST) {
-    return PackStringMsgReply("list");
+    return reply.Status("list");
   } else if (obj_type == OBJECT_HASH) {
-    return PackStringMsgReply("hash");
+    return reply.Status("hash");
+  } else if (obj_type == OBJECT_SET) {
+    return reply.Status("set");
+  } else if (obj_type == OBJECT_ZSET) {
+    return reply.Status("zset");
+  } else if (obj_type == OBJECT_HLL) {
+    return reply.Status("hyperloglog");
+  } else if (obj_type == OBJECT_CMS) {
+    return reply.Status("cms");
+  } else if (obj_type == OBJECT_TOPK) {
+    return reply.Status("topk");
+  } else if (obj_type == OBJECT_BLOOM) {
+    return reply.Status("bloom");
+  } else if (obj_type == OBJECT_STREAM) {
+    return reply.Status("stream");
+  } else if (obj_type == OBJECT_TS) {
+    return reply.Status("timeseries");
+  } else if (obj_type == OBJECT_VSET) {
+    return reply.Status("vectorset");
   }
-  return PackStringMsgReply("none");
+  return reply.Status("none");
 }
 
-std::string ExpireCommand(__PARAMETERS_LIST) {
+void ExpireCommand(__PARAMETERS_LIST) {
   /* usage: expire key time */
-  CheckSyntaxHelper(cmds, 1, 1, false, 'expire');
   /* find key */
   const std::string &key = cmds.argv[1];
   if (!holder->KeyExists(key)) {
-    return kInt0Msg; /* key not found, can not set expiration */
+    return reply.Raw(kInt0Msg); /* key not found, can not set expiration */
   }
   int64_t interval; /* beware that this interval is in the unit of second */
   if (CanConvertToInt64(cmds.argv[2], interval)) {
@@ -394,16 +555,16 @@ std::string ExpireCommand(__PARAMETERS_LIST) {
       }
     } else {  /* already has expiration on key */
       /* update already existing time event */
-      if (sExpiresMap[key] == nullptr) return kInt0Msg;
+      if (sExpiresMap[key] == nullptr) return reply.Raw(kInt0Msg);
       long ev_id = sExpiresMap[key]->id;
       if (interval >= 0) {
         if (!loop->UpdateTimeEvent(ev_id, interval * 1000ul, 1)) {
-          return kInt0Msg;
+          return reply.Raw(kInt0Msg);
         }
       } else {
         /* remove expiration for key */
         if (!loop->RemoveTimeEvent(ev_id)) {
-          return kInt0Msg;
+          return reply.Raw(kInt0Msg);
         }
         sExpiresMap.erase(key);
       }
@@ -414,8 +575,8 @@ std::string ExpireCommand(__PARAMETERS_LIST) {
         /* sync as expireat format, use absolute timestamp */
         auto now = GetCurrentSec();
         auto &cmd = const_cast<CommandCache &>(cmds);
-        cmd.argv[0] = "expireat";
-        cmd.argv[2] = std::to_string(now + interval);
+        cmd.SetArg(0, "expireat");
+        cmd.SetArg(2, std::to_string(now + interval));
         appendable->Append(cmd);
       } else {
         /* remove expiration for key, we can set key to its current value to do it */
@@ -424,54 +585,50 @@ std::string ExpireCommand(__PARAMETERS_LIST) {
         if (errcode == kOkCode && !recovered_cmd.empty()) {
           CommandCache cache;
           cache.inited = true;
-          cache.argc = recovered_cmd.size();
-          cache.argv = recovered_cmd;
+          cache.Assign(std::move(recovered_cmd));
           appendable->Append(cache);
         }
       }
     }
-    return kInt1Msg;
+    return reply.Raw(kInt1Msg);
   }
-  return kInvalidIntegerMsg;
+  return reply.Raw(kInvalidIntegerMsg);
 }
 
-std::string ExpireAtCommand(__PARAMETERS_LIST) {
+void ExpireAtCommand(__PARAMETERS_LIST) {
   /* usage: expireat key unix_sec */
-  CheckSyntaxHelper(cmds, 1, 1, false, 'expireat');
-  const std::string &key = cmds.argv[1];
+  const StringView &key = cmds.argv[1];
   int64_t unix_sec;
   if (CanConvertToInt64(cmds.argv[2], unix_sec)) {
     /* leave to expire command handle it */
     int64_t now = GetCurrentSec();
     int64_t interval = std::max(unix_sec - now, 0l);  /* seconds */
-    const_cast<CommandCache &>(cmds).argv[2] = std::to_string(interval); /* force modification to const */
-    return ExpireCommand(loop, holder, appendable, cmds, sync, config, sess, params);
+    const_cast<CommandCache &>(cmds).SetArg(2, std::to_string(interval)); /* force modification to const */
+    return ExpireCommand(loop, holder, appendable, cmds, sync, config, sess, params, reply);
   }
-  return kInvalidIntegerMsg;
+  return reply.Raw(kInvalidIntegerMsg);
 }
 
-std::string TTLCommand(__PARAMETERS_LIST) {
+void TTLCommand(__PARAMETERS_LIST) {
   /* usage: ttl key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'ttl');
-  const std::string &key = cmds.argv[1];
+  const StringView &key = cmds.argv[1];
   bool found_in_holder = holder->KeyExists(key);
   if (!found_in_holder) {
-    return kIntMinus2Msg;
+    return reply.Raw(kIntMinus2Msg);
   }
   bool found_in_expires = sExpiresMap.find(key) != sExpiresMap.end();
   if (!found_in_expires) {
-    return kIntMinus1Msg;
+    return reply.Raw(kIntMinus1Msg);
   }
   /* get ttl in seconds */
   uint64_t ttl = (sExpiresMap[key]->when - GetCurrentMs()) / 1000;
-  return PackIntReply(ttl);
+  return reply.Int(ttl);
 }
 
-std::string SetCommand(__PARAMETERS_LIST) {
+void SetCommand(__PARAMETERS_LIST) {
   /* usage: set key value */
-  CheckSyntaxHelper(cmds, 1, 1, false, 'set');
-  const std::string &key = cmds.argv[1];
-  const std::string &value = cmds.argv[2];
+  const StringView &key = cmds.argv[1];
+  const StringView &value = cmds.argv[2];
   int64_t val;
   bool res = false;
   if (CanConvertToInt64(value, val)) {
@@ -483,299 +640,651 @@ std::string SetCommand(__PARAMETERS_LIST) {
   }
   if (res) {
     AddIntoAppendableDirectly(cmds);
-    return kOkMsg;
+    return reply.Raw(kOkMsg);
   }
-  return kNotOkMsg;
+  return reply.Raw(kNotOkMsg);
 }
 
-std::string GetCommand(__PARAMETERS_LIST) {
+void GetCommand(__PARAMETERS_LIST) {
   /* usage: get key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'get');
-  const std::string &key = cmds.argv[1];
+  const StringView &key = cmds.argv[1];
   int errcode = 0;
   ValueObjectPtr val = holder->Get(key, errcode);
   if (errcode == kOkCode) {
     if (val->type == OBJECT_INT) {
       int64_t intval = reinterpret_cast<int64_t>(val->ptr);
-      return PackStringValueReply(std::to_string(intval));
+      return reply.BulkInt(intval);
     } else {
-      /* string type underneath */
-      return PackStringValueReply(val->ToStdString());
+      /* string type underneath, a large one is sent in place instead of copied */
+      const DynamicString *str = reinterpret_cast<const DynamicString *>(val->ptr);
+      if (reply.Pinnable(str->Length())) {
+        return reply.PinnedBulk(str->Data(), str->Length(), PinStrObj(val));
+      }
+      return reply.Bulk(str->Data(), str->Length());
     }
   }
   IfKeyNotFoundReturn(errcode);
   IfWrongTypeReturn(errcode);
 
-  return kNilMsg;
+  return reply.Raw(kNilMsg);
 }
 
 #define IfInt64OverflowThenReturn(errcode) \
   do {                                     \
     if (errcode == kOverflowCode) {        \
-      return kInt64OverflowMsg;            \
+      return reply.Raw(kInt64OverflowMsg); \
     }                                      \
   } while (0)
 
 #define IncrDecrCommonHelper(cmds, operation, appendable, sync) \
   do {                                                          \
-    const std::string &key = cmds.argv[1];                      \
+    const StringView &key = cmds.argv[1];                       \
     int errcode = 0;                                            \
     int64_t ans = holder->operation(key, errcode);              \
     if (errcode == kOkCode) {                                   \
       AddIntoAppendableDirectly(cmds);                          \
-      return PackIntReply(ans);                                 \
+      return reply.Int(ans);                                    \
     }                                                           \
     IfWrongTypeReturn(errcode);                                 \
     IfInt64OverflowThenReturn(errcode);                         \
-    return kNotOkMsg;                                           \
+    return reply.Raw(kNotOkMsg);                                \
   } while (0)
 
 #define IncrDecrCommonHelper2(cmds, operation, appendable, sync) \
-  const std::string &key = cmds.argv[1];                         \
-  const std::string &num_str = cmds.argv[2];                     \
+  const StringView &key = cmds.argv[1];                          \
+  const StringView &num_str = cmds.argv[2];                      \
   int64_t num;                                                   \
   if (!CanConvertToInt64(num_str, num)) {                        \
-    return kInvalidIntegerMsg;                                   \
+    return reply.Raw(kInvalidIntegerMsg);                        \
   }                                                              \
   if (num < 0) {                                                 \
     /* ensure num >= 0 && num <= INT64_MAX */                    \
-    return kInvalidIntegerMsg;                                   \
+    return reply.Raw(kInvalidIntegerMsg);                        \
   }                                                              \
   int errcode = 0;                                               \
   int64_t ans = holder->operation(key, num, errcode);            \
   if (errcode == kOkCode) {                                      \
     AddIntoAppendableDirectly(cmds);                             \
-    return PackIntReply(ans);                                    \
+    return reply.Int(ans);                                       \
   }                                                              \
   IfWrongTypeReturn(errcode);                                    \
   IfInt64OverflowThenReturn(errcode);                            \
-  return kNotOkMsg;
+  return reply.Raw(kNotOkMsg);
 
-std::string IncrCommand(__PARAMETERS_LIST) {
+void IncrCommand(__PARAMETERS_LIST) {
   /* usage: incr key */
   /* This operation is limited to 64 bit signed integers. */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'incr');
   IncrDecrCommonHelper(cmds, IncrInt, appendable, sync);
 }
 
-std::string DecrCommand(__PARAMETERS_LIST) {
+void DecrCommand(__PARAMETERS_LIST) {
   /* usage: decr key */
   /* This operation is limited to 64 bit signed integers. */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'decr');
   IncrDecrCommonHelper(cmds, DecrInt, appendable, sync);
 }
 
-std::string IncrByCommand(__PARAMETERS_LIST) {
+void IncrByCommand(__PARAMETERS_LIST) {
   /* incrby key value */
-  CheckSyntaxHelper(cmds, 1, 1, false, 'incrby');
   IncrDecrCommonHelper2(cmds, IncrIntBy, appendable, sync)
 }
 
-std::string DecrByCommand(__PARAMETERS_LIST) {
+void DecrByCommand(__PARAMETERS_LIST) {
   /* decrby key value */
-  CheckSyntaxHelper(cmds, 1, 1, false, 'decrby');
   IncrDecrCommonHelper2(cmds, DecrIntBy, appendable, sync)
 }
 
 #undef IncrDecrCommonHelper
 #undef IfInt64OverflowThenReturn
 
-std::string StrlenCommand(__PARAMETERS_LIST) {
+void StrlenCommand(__PARAMETERS_LIST) {
   /* usage: strlen key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'strlen');
-  const std::string &key = cmds.argv[1];
+  const StringView &key = cmds.argv[1];
   int errcode = 0;
   size_t len = holder->StrLen(key, errcode);
   if (errcode == kOkCode) {
-    return PackIntReply(len);
+    return reply.Int(len);
   }
   IfWrongTypeReturn(errcode);
-  return PackIntReply(0);
+  return reply.Int(0);
 }
 
-std::string AppendCommand(__PARAMETERS_LIST) {
+void AppendCommand(__PARAMETERS_LIST) {
   /* usage: append key value */
-  CheckSyntaxHelper(cmds, 1, 1, false, 'append');
-  const std::string &key = cmds.argv[1];
-  const std::string &value = cmds.argv[2];
+  const StringView &key = cmds.argv[1];
+  const StringView &value = cmds.argv[2];
   int errcode;
   size_t after_len = holder->Append(key, value, errcode);
   if (errcode == kOkCode) {
     AddIntoAppendableDirectly(cmds);
-    return PackIntReply(after_len);
+    return reply.Int(after_len);
   }
   IfKeyNotFoundReturn(errcode);
   IfWrongTypeReturn(errcode);
-  return kNotOkMsg;
+  return reply.Raw(kNotOkMsg);
 }
 
-std::string GetRangeCommand(__PARAMETERS_LIST) {
+void GetRangeCommand(__PARAMETERS_LIST) {
   /* usage: getrange key begin end */
-  return kNotSupportedYetMsg;
+  const StringView &key = cmds.argv[1];
+  int64_t start, end;
+  if (!CanConvertToInt64(cmds.argv[2], start) || !CanConvertToInt64(cmds.argv[3], end)) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  int errcode;
+  std::string value = holder->GetRange(key, start, end, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Bulk(value);
+}
+
+void SetRangeCommand(__PARAMETERS_LIST) {
+  /* usage: setrange key offset value */
+  const StringView &key = cmds.argv[1];
+  const StringView &value = cmds.argv[3];
+  int64_t offset;
+  if (!CanConvertToInt64(cmds.argv[2], offset) || offset < 0) {
+    return reply.Error("ERROR", "offset is out of range");
+  }
+  if (offset + value.size() > kMaxStringLength) {
+    return reply.Error("ERROR", "string exceeds maximum allowed size");
+  }
+  int errcode;
+  size_t len = holder->SetRange(key, offset, value, errcode);
+  IfWrongTypeReturn(errcode);
+  if (errcode == kKeyNotFoundCode) {
+    return reply.Raw(kInt0Msg);
+  }
+  IfFailReturn(errcode, reply.Raw(kNotOkMsg));
+  if (!value.empty()) {
+    AddIntoAppendableDirectly(cmds);
+  }
+  return reply.Int(len);
+}
+
+/* parse bit offset which must be inside a string of maximum length */
+static bool ParseBitOffset(const std::string &str, uint64_t &offset) {
+  int64_t val;
+  if (!CanConvertToInt64(str, val) || val < 0 || (uint64_t)val >= (uint64_t)kMaxStringLength * 8) {
+    return false;
+  }
+  offset = val;
+  return true;
+}
+
+/* parse the optional BYTE|BIT unit, true if it is BIT */
+static bool ParseBitUnit(const std::string &str, bool &bit_unit) {
+  if (strcasecmp(str.c_str(), "byte") == 0) {
+    bit_unit = false;
+    return true;
+  }
+  if (strcasecmp(str.c_str(), "bit") == 0) {
+    bit_unit = true;
+    return true;
+  }
+  return false;
+}
+
+void SetBitCommand(__PARAMETERS_LIST) {
+  /* usage: setbit key offset value */
+  const StringView &key = cmds.argv[1];
+  uint64_t offset;
+  if (!ParseBitOffset(cmds.argv[2], offset)) {
+    return reply.Error("ERROR", "bit offset is not an integer or out of range");
+  }
+  const StringView &bit = cmds.argv[3];
+  if (bit != "0" && bit != "1") {
+    return reply.Error("ERROR", "bit is not an integer or out of range");
+  }
+  int errcode;
+  int original = holder->SetBit(key, offset, bit == "1", errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Raw(kNotOkMsg));
+  AddIntoAppendableDirectly(cmds);
+  return reply.Int(original);
+}
+
+void GetBitCommand(__PARAMETERS_LIST) {
+  /* usage: getbit key offset */
+  const StringView &key = cmds.argv[1];
+  uint64_t offset;
+  if (!ParseBitOffset(cmds.argv[2], offset)) {
+    return reply.Error("ERROR", "bit offset is not an integer or out of range");
+  }
+  int errcode;
+  int bit = holder->GetBit(key, offset, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(bit);
+}
+
+void BitCountCommand(__PARAMETERS_LIST) {
+  /* usage: bitcount key [start end [BYTE|BIT]] */
+  size_t argc = cmds.argv.size();
+  if (argc != 2 && argc != 4 && argc != 5) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'bitcount' command");
+  }
+  const StringView &key = cmds.argv[1];
+  int64_t start = 0, end = -1;
+  bool bit_unit = false;
+  if (argc >= 4 &&
+      (!CanConvertToInt64(cmds.argv[2], start) || !CanConvertToInt64(cmds.argv[3], end))) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  if (argc == 5 && !ParseBitUnit(cmds.argv[4], bit_unit)) {
+    return reply.Error("ERROR", "syntax error");
+  }
+  int errcode;
+  size_t count = holder->BitCount(key, start, end, bit_unit, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(count);
+}
+
+void BitPosCommand(__PARAMETERS_LIST) {
+  /* usage: bitpos key bit [start [end [BYTE|BIT]]] */
+  size_t argc = cmds.argv.size();
+  if (argc < 3 || argc > 6) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'bitpos' command");
+  }
+  const StringView &key = cmds.argv[1];
+  const StringView &bit = cmds.argv[2];
+  if (bit != "0" && bit != "1") {
+    return reply.Error("ERROR", "the bit argument must be 1 or 0");
+  }
+  int64_t start = 0, end = -1;
+  bool bit_unit = false;
+  if ((argc >= 4 && !CanConvertToInt64(cmds.argv[3], start)) ||
+      (argc >= 5 && !CanConvertToInt64(cmds.argv[4], end))) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  if (argc == 6 && !ParseBitUnit(cmds.argv[5], bit_unit)) {
+    return reply.Error("ERROR", "syntax error");
+  }
+  int errcode;
+  int64_t pos = holder->BitPos(key, bit == "1", start, end, argc >= 5, bit_unit, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(pos);
 }
 
-std::string SetRangeCommand(__PARAMETERS_LIST) {
-  return kNotSupportedYetMsg;
+void BitOpCommand(__PARAMETERS_LIST) {
+  /* usage: bitop AND|OR|XOR|NOT destkey key [key ...] */
+  if (cmds.argv.size() < 4) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'bitop' command");
+  }
+  const char *opname = cmds.argv[1].c_str();
+  int op;
+  if (strcasecmp(opname, "and") == 0) {
+    op = BITOP_AND;
+  } else if (strcasecmp(opname, "or") == 0) {
+    op = BITOP_OR;
+  } else if (strcasecmp(opname, "xor") == 0) {
+    op = BITOP_XOR;
+  } else if (strcasecmp(opname, "not") == 0) {
+    op = BITOP_NOT;
+  } else {
+    return reply.Error("ERROR", "syntax error");
+  }
+  if (op == BITOP_NOT && cmds.argv.size() != 4) {
+    return reply.Error("ERROR", "BITOP NOT must be called with a single source key");
+  }
+  const StringView &dst = cmds.argv[2];
+  std::vector<std::string> keys(cmds.argv.begin() + 3, cmds.argv.end());
+  int errcode;
+  size_t len = holder->BitOp(op, dst, keys, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Raw(kNotOkMsg));
+  /* sync the result instead of the operation, so that the aof stays keyed by dst */
+  if (len > 0) {
+    AddIntoAppendable(appendable, sync, {"set", dst, holder->GetRange(dst, 0, -1, errcode)});
+  } else {
+    AddIntoAppendable(appendable, sync, {"del", dst});
+  }
+  return reply.Int(len);
 }
 
-std::string LLenCommand(__PARAMETERS_LIST) {
+void LLenCommand(__PARAMETERS_LIST) {
   /* usage: llen key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'llen');
-  const std::string &key = cmds.argv[1];
+  const StringView &key = cmds.argv[1];
   int errcode;
   size_t list_len = holder->ListLen(key, errcode);
   if (errcode == kOkCode) {
-    return PackIntReply(list_len);
+    return reply.Int(list_len);
   }
   IfWrongTypeReturn(errcode);
-  return PackIntReply(0);
+  return reply.Int(0);
 }
 
 #define ListPopCommandCommon(cmds, operation, appendable, sync) \
   do {                                                          \
-    const std::string &key = cmds.argv[1];                      \
+    const StringView &key = cmds.argv[1];                       \
     int errcode;                                                \
     auto popped = holder->operation(key, errcode);              \
     if (errcode == kOkCode) {                                   \
       if (!popped.Empty()) {                                    \
         AddIntoAppendableDirectly(cmds);                        \
-        return PackStringValueReply(popped.ToStdString());      \
+        return reply.Bulk(popped.Data(), popped.Length());      \
       }                                                         \
-      return kNilMsg;                                           \
+      return reply.Raw(kNilMsg);                                \
     } else if (errcode == kWrongTypeCode) {                     \
-      return kWrongTypeMsg;                                     \
+      return reply.Raw(kWrongTypeMsg);                          \
     }                                                           \
   } while (0)
 
-std::string LPopCommand(__PARAMETERS_LIST) {
+void LPopCommand(__PARAMETERS_LIST) {
   /* usage: lpop key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'lpop');
   ListPopCommandCommon(cmds, LeftPop, appendable, sync);
-  return kNilMsg;
+  return reply.Raw(kNilMsg);
 }
 
-std::string RPopCommand(__PARAMETERS_LIST) {
+void RPopCommand(__PARAMETERS_LIST) {
   /* usage: rpop key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'rpop');
   ListPopCommandCommon(cmds, RightPop, appendable, sync);
-  return kNilMsg;
+  return reply.Raw(kNilMsg);
 }
 
 #undef ListPopCommandCommon
 
 #define ListPushCommandCommon(cmds, operation, appendable, sync)               \
   do {                                                                         \
-    const std::string &key = cmds.argv[1];                                     \
-    const std::vector<std::string> &args = cmds.argv;                          \
+    const StringView &key = cmds.argv[1];                                      \
+    const std::vector<StringView> &args = cmds.argv;                           \
     int errcode;                                                               \
     size_t list_len = holder->operation(                                       \
         key, std::vector<std::string>(args.begin() + 2, args.end()), errcode); \
     if (errcode == kOkCode) {                                                  \
       AddIntoAppendableDirectly(cmds);                                         \
-      return PackIntReply(list_len);                                           \
+      SignalListKeyReady(key);                                                 \
+      return reply.Int(list_len);                                              \
     } else if (errcode == kWrongTypeCode) {                                    \
-      return kWrongTypeMsg;                                                    \
+      return reply.Raw(kWrongTypeMsg);                                         \
     }                                                                          \
   } while (0)
 
-std::string LPushCommand(__PARAMETERS_LIST) {
+void LPushCommand(__PARAMETERS_LIST) {
   /* usage: lpush key value1 value2 ... */
-  CheckSyntaxHelper(cmds, 1, -1, false, 'lpush');
   ListPushCommandCommon(cmds, LeftPush, appendable, sync);
-  return kNotOkMsg;
+  return reply.Raw(kNotOkMsg);
 }
 
-std::string RPushCommand(__PARAMETERS_LIST) {
+void RPushCommand(__PARAMETERS_LIST) {
   /* usage: rpush key value1 value2 ... */
-  CheckSyntaxHelper(cmds, 1, -1, false, 'rpush');
   ListPushCommandCommon(cmds, RightPush, appendable, sync);
-  return kNotOkMsg;
+  return reply.Raw(kNotOkMsg);
 }
 
 #undef ListPushCommandCommon
 
-std::string LRangeCommand(__PARAMETERS_LIST) {
+void LRangeCommand(__PARAMETERS_LIST) {
   /* usage: lrange key begin end */
-  CheckSyntaxHelper(cmds, 1, 2, false, 'lrange');
-  const std::string &key = cmds.argv[1];
-  const std::string &begin = cmds.argv[2];
-  const std::string &end = cmds.argv[3];
+  const StringView &key = cmds.argv[1];
+  const StringView &begin = cmds.argv[2];
+  const StringView &end = cmds.argv[3];
   int errcode;
   int begin_idx, end_idx;
   if (!CanConvertToInt32(begin, begin_idx) || !CanConvertToInt32(end, end_idx)) {
     /* range index no valid */
-    return kInvalidIntegerMsg;
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  /* items are written into the reply as they are visited */
+  size_t n = holder->ListRange(key, begin_idx, end_idx,
+                               [&reply](size_t len) { reply.ArrayHeader(len); },
+                               [&reply](const DynamicString &item) { reply.Bulk(item); }, errcode);
+  IfWrongTypeReturn(errcode);
+  if (n == 0) {
+    return reply.Raw(kArrayEmptyMsg);
+  }
+}
+
+void LInsertCommand(__PARAMETERS_LIST) {
+  /* usage: linsert key before|after pivot value */
+  const StringView &key = cmds.argv[1];
+  std::string where = cmds.argv[2];
+  std::transform(where.begin(), where.end(), where.begin(), ::tolower);
+  if (where != "before" && where != "after") {
+    return reply.Error("ERROR", "syntax error, before or after expected");
   }
-  std::vector<DynamicString> ranges = holder->ListRange(key, begin_idx, end_idx, errcode);
+  const StringView &pivot = cmds.argv[3];
+  const StringView &value = cmds.argv[4];
+  int errcode;
+  long list_len = holder->ListInsert(key, where == "before", pivot, value, errcode);
   if (errcode == kOkCode) {
-    if (!ranges.empty()) {
-      auto ret =  PackArrayMsg(ranges);
-      return ret;
+    if (list_len > 0) {
+      AddIntoAppendableDirectly(cmds);
     }
-  } else {
-    IfWrongTypeReturn(errcode);
+    return reply.Int(list_len);
   }
-  return kArrayEmptyMsg;
+  IfWrongTypeReturn(errcode);
+  return reply.Raw(kInt0Msg);
 }
 
-std::string LInsertCommand(__PARAMETERS_LIST) {
-  /* TODO */
-  return kNotSupportedYetMsg;
+void LRemCommand(__PARAMETERS_LIST) {
+  /* usage: lrem key count value */
+  const StringView &key = cmds.argv[1];
+  int64_t count;
+  if (!CanConvertToInt64(cmds.argv[2], count)) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  const StringView &value = cmds.argv[3];
+  int errcode;
+  size_t removed = holder->ListRemove(key, count, value, errcode);
+  if (errcode == kOkCode) {
+    if (removed > 0) {
+      AddIntoAppendableDirectly(cmds);
+    }
+    return reply.Int(removed);
+  }
+  IfWrongTypeReturn(errcode);
+  return reply.Raw(kInt0Msg);
 }
 
-std::string LRemCommand(__PARAMETERS_LIST) {
-  /* TODO */
-  return kNotSupportedYetMsg;
+void LTrimCommand(__PARAMETERS_LIST) {
+  /* usage: ltrim key begin end */
+  const StringView &key = cmds.argv[1];
+  int begin_idx, end_idx;
+  if (!CanConvertToInt32(cmds.argv[2], begin_idx) || !CanConvertToInt32(cmds.argv[3], end_idx)) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  int errcode;
+  holder->ListTrim(key, begin_idx, end_idx, errcode);
+  if (errcode == kOkCode) {
+    AddIntoAppendableDirectly(cmds);
+  }
+  IfWrongTypeReturn(errcode);
+  return reply.Raw(kOkMsg);
 }
 
-std::string LSetCommand(__PARAMETERS_LIST) {
+void LSetCommand(__PARAMETERS_LIST) {
   /* usage: lsetindex key index value */
-  CheckSyntaxHelper(cmds, 1, 2, false, 'lsetindex');
-  const std::string &key = cmds.argv[1];
-  const std::string &index = cmds.argv[2];
+  const StringView &key = cmds.argv[1];
+  const StringView &index = cmds.argv[2];
   int idx;
   if (!CanConvertToInt32(index, idx)) {
-    return kInvalidIntegerMsg;
+    return reply.Raw(kInvalidIntegerMsg);
   }
-  const std::string &value = cmds.argv[3];
+  const StringView &value = cmds.argv[3];
   int errcode;
   holder->ListSetItemAtIndex(key, idx, value, errcode);
   if (errcode == kOkCode) {
     AddIntoAppendableDirectly(cmds);
-    return kOkMsg;
+    return reply.Raw(kOkMsg);
   } else if (errcode == kWrongTypeCode) {
-    return kWrongTypeMsg;
+    return reply.Raw(kWrongTypeMsg);
   } else if (errcode == kOutOfRangeCode) { /* if lsetindex encounters out of range index, we can not set it */
-    return kOutOfRangeMsg;
+    return reply.Raw(kOutOfRangeMsg);
   } else if (errcode == kKeyNotFoundCode) {
-    return kNoSuchKeyMsg;
+    return reply.Raw(kNoSuchKeyMsg);
   }
-  return kNotOkMsg;
+  return reply.Raw(kNotOkMsg);
 }
 
-std::string LIndexCommand(__PARAMETERS_LIST) {
+void LIndexCommand(__PARAMETERS_LIST) {
   /* usage: lindex key index */
-  CheckSyntaxHelper(cmds, 1, 1, false, 'lindex');
-  const std::string &key = cmds.argv[1];
-  const std::string &index = cmds.argv[2];
+  const StringView &key = cmds.argv[1];
+  const StringView &index = cmds.argv[2];
   int idx;
   if (!CanConvertToInt32(index, idx)) {
-    return kInvalidIntegerMsg;
+    return reply.Raw(kInvalidIntegerMsg);
   }
   int errcode;
   auto item = holder->ListItemAtIndex(key, idx, errcode);
   if (errcode == kOkCode) {
-    return PackStringValueReply(item.ToStdString());
+    return reply.Bulk(item.Data(), item.Length());
   }
   IfWrongTypeReturn(errcode);
   /* if lindex encounters out of range, or key not found we can simply return nil */
-  return kNilMsg;
+  return reply.Raw(kNilMsg);
+}
+
+static bool ParseListDirection(const std::string &str, bool &left) {
+  if (strcasecmp(str.c_str(), "left") == 0) {
+    left = true;
+    return true;
+  }
+  if (strcasecmp(str.c_str(), "right") == 0) {
+    left = false;
+    return true;
+  }
+  return false;
+}
+
+bool ParseBlockingTimeout(const std::string &str, uint64_t &timeout_ms) {
+  /* timeout is given in seconds, 0 means blocking forever */
+  double seconds;
+  if (!CanConvertToDouble(str, seconds) || seconds < 0) {
+    return false;
+  }
+  timeout_ms = (uint64_t) (seconds * 1000);
+  if (seconds > 0 && timeout_ms == 0) {
+    timeout_ms = 1;
+  }
+  return true;
+}
+
+/* pop from the first non-empty list in keys, return false without replying if all lists are empty */
+static bool ListPopFromFirstNonEmpty(KVContainer *holder, AppendableFile *appendable, bool sync,
+                                     const std::vector<std::string> &keys, bool leftpop,
+                                     ReplyWriter &reply) {
+  int errcode;
+  for (auto &&key : keys) {
+    size_t list_len = holder->ListLen(key, errcode);
+    if (errcode == kWrongTypeCode) {
+      reply.Raw(kWrongTypeMsg);
+      return true;
+    }
+    if (errcode != kOkCode || list_len == 0) {
+      continue;
+    }
+    auto popped = leftpop ? holder->LeftPop(key, errcode) : holder->RightPop(key, errcode);
+    /* blocking pop is synced as non-blocking pop */
+    AddIntoAppendable(appendable, sync, {leftpop ? "lpop" : "rpop", key});
+    reply.ArrayHeader(2);
+    reply.Bulk(key);
+    reply.Bulk(popped.Data(), popped.Length());
+    return true;
+  }
+  return false;
+}
+
+/* move the item from src to dst, return false without replying if src is empty */
+static bool ListMoveItem(KVContainer *holder, AppendableFile *appendable, bool sync,
+                         OptionalHandlerParams *params, const std::string &src,
+                         const std::string &dst, bool leftpop, bool leftpush, ReplyWriter &reply) {
+  int errcode;
+  size_t list_len = holder->ListLen(src, errcode);
+  if (errcode == kWrongTypeCode) {
+    reply.Raw(kWrongTypeMsg);
+    return true;
+  }
+  if (errcode != kOkCode || list_len == 0) {
+    return false;
+  }
+  int dst_type = holder->QueryObjectType(dst);
+  if (dst_type != -1 && dst_type != OBJECT_LIST) {
+    reply.Raw(kWrongTypeMsg);
+    return true;
+  }
+  auto popped = leftpop ? holder->LeftPop(src, errcode) : holder->RightPop(src, errcode);
+  std::string value = popped.ToStdString();
+  if (leftpush) {
+    holder->LeftPush(dst, value, errcode);
+  } else {
+    holder->RightPush(dst, value, errcode);
+  }
+  /* sync as a pop followed by a push so that every command only touches one key */
+  AddIntoAppendable(appendable, sync, {leftpop ? "lpop" : "rpop", src});
+  AddIntoAppendable(appendable, sync, {leftpush ? "lpush" : "rpush", dst, value});
+  SignalListKeyReady(dst);
+  reply.Bulk(value);
+  return true;
+}
+
+#define BlockingPopCommandCommon(leftpop)                                                \
+  do {                                                                                   \
+    uint64_t timeout_ms;                                                                 \
+    if (!ParseBlockingTimeout(cmds.argv.back(), timeout_ms)) {                           \
+      return reply.Error("ERROR", "timeout is not a float or out of range");             \
+    }                                                                                    \
+    std::vector<std::string> keys(cmds.argv.begin() + 1, cmds.argv.end() - 1);           \
+    if (ListPopFromFirstNonEmpty(holder, appendable, sync, keys, leftpop, reply)) {      \
+      return;                                                                            \
+    }                                                                                    \
+    if (params && params->unblocking) {                                                  \
+      return; /* still no items, keep on waiting */                                      \
+    }                                                                                    \
+    if (sess == nullptr || params == nullptr || params->server == nullptr) {             \
+      return reply.Raw(kNilArrayMsg);                                                    \
+    }                                                                                    \
+    params->server->BlockSession(sess, keys, cmds, timeout_ms, kNilArrayMsg);            \
+  } while (0)
+
+void BLPopCommand(__PARAMETERS_LIST) {
+  /* usage: blpop key [key ...] timeout */
+  BlockingPopCommandCommon(true);
+}
+
+void BRPopCommand(__PARAMETERS_LIST) {
+  /* usage: brpop key [key ...] timeout */
+  BlockingPopCommandCommon(false);
+}
+
+#undef BlockingPopCommandCommon
+
+void LMoveCommand(__PARAMETERS_LIST) {
+  /* usage: lmove source destination left|right left|right */
+  bool leftpop, leftpush;
+  if (!ParseListDirection(cmds.argv[3], leftpop) || !ParseListDirection(cmds.argv[4], leftpush)) {
+    return reply.Error("ERROR", "syntax error, left or right expected");
+  }
+  if (!ListMoveItem(holder, appendable, sync, params, cmds.argv[1], cmds.argv[2], leftpop, leftpush, reply)) {
+    reply.Raw(kNilMsg);
+  }
+}
+
+void BLMoveCommand(__PARAMETERS_LIST) {
+  /* usage: blmove source destination left|right left|right timeout */
+  bool leftpop, leftpush;
+  if (!ParseListDirection(cmds.argv[3], leftpop) || !ParseListDirection(cmds.argv[4], leftpush)) {
+    return reply.Error("ERROR", "syntax error, left or right expected");
+  }
+  uint64_t timeout_ms;
+  if (!ParseBlockingTimeout(cmds.argv[5], timeout_ms)) {
+    return reply.Error("ERROR", "timeout is not a float or out of range");
+  }
+  if (ListMoveItem(holder, appendable, sync, params, cmds.argv[1], cmds.argv[2], leftpop, leftpush, reply)) {
+    return;
+  }
+  if (params && params->unblocking) {
+    return;
+  }
+  if (sess == nullptr || params == nullptr || params->server == nullptr) {
+    return reply.Raw(kNilMsg);
+  }
+  params->server->BlockSession(sess, {cmds.argv[1]}, cmds, timeout_ms, kNilMsg);
 }
 
-std::string HSetCommand(__PARAMETERS_LIST) {
+void HSetCommand(__PARAMETERS_LIST) {
   /* usage: hset key field1 value1 field2 value2 ... */
-  CheckSyntaxHelper(cmds, 1, -1, true, 'hset');
-  const std::string &key = cmds.argv[1];
+  if ((cmds.argv.size() & 1) != 0) {  /* field-value pairs */
+    return reply.Error("ERROR", "incorrect number of arguments for 'hset' command");
+  }
+  const StringView &key = cmds.argv[1];
   /* extract vector of fields and values */
   size_t n = (cmds.argv.size() - 2) >> 1;
   std::vector<std::string> fields, values;
@@ -789,22 +1298,21 @@ std::string HSetCommand(__PARAMETERS_LIST) {
   int count = holder->HashUpdateKV(Key(key), fields, values, errcode);
   if (errcode == kOkCode && count != 0) {
     AddIntoAppendableDirectly(cmds);
-    return kOkMsg;
+    return reply.Raw(kOkMsg);
   }
   IfWrongTypeReturn(errcode);
-  return kNotOkMsg;
+  return reply.Raw(kNotOkMsg);
 }
 
-std::string HGetCommand(__PARAMETERS_LIST) {
+void HGetCommand(__PARAMETERS_LIST) {
   /* usage: hget key field1 field2 ...*/
-  CheckSyntaxHelper(cmds, 1, -1, false, 'hget');
-  const std::string &key = cmds.argv[1];
+  const StringView &key = cmds.argv[1];
   int errcode;
   Key k = Key(key);
   if (cmds.argv.size() == 3) {  /* only get one field */
     HEntryVal val = holder->HashGetValue(k, HEntryKey(cmds.argv[2]), errcode);
     if (errcode == kOkCode) {
-      return PackStringValueReply(val);
+      return reply.Bulk(val);
     }
     IfKeyNotFoundReturn(errcode);
     IfWrongTypeReturn(errcode);
@@ -813,224 +1321,1761 @@ std::string HGetCommand(__PARAMETERS_LIST) {
     std::vector<HEntryVal> values = holder->HashGetValue(k, fields, errcode);
     /* pack into array and return */
     if (!values.empty()) {
-      return PackArrayMsg(values);
+      return reply.Array(values);
     }
     /* return query result of every key */
-    return PackEmptyArrayMsg(fields.size());
+    return reply.ArrayOfNils(fields.size());
   }
-  return kArrayEmptyMsg;
+  return reply.Raw(kArrayEmptyMsg);
 }
 
-std::string HDelCommand(__PARAMETERS_LIST) {
+void HDelCommand(__PARAMETERS_LIST) {
   /* usage: hdel key field1 field2 ...*/
-  CheckSyntaxHelper(cmds, 1, -1, false, 'hdel');
-  const std::string &key = cmds.argv[1];
+  const StringView &key = cmds.argv[1];
   int errcode;
   /* get all deleting fields */
   std::vector<std::string> fields(cmds.argv.begin() + 2, cmds.argv.end());
   size_t n_deleted = holder->HashDelField(Key(key), fields, errcode);
   IfWrongTypeReturn(errcode);
   AddIntoAppendableDirectly(cmds);
-  return PackIntReply(n_deleted);
+  return reply.Int(n_deleted);
 }
 
-std::string HExistsCommand(__PARAMETERS_LIST) {
+void HExistsCommand(__PARAMETERS_LIST) {
   /* usage: hexists key field */
-  CheckSyntaxHelper(cmds, 1, 1, false, 'hexists');
-  const std::string &key = cmds.argv[1];
-  const std::string &field = cmds.argv[2];
+  const StringView &key = cmds.argv[1];
+  const StringView &field = cmds.argv[2];
   int errcode;
   auto ans = holder->HashExistField(key, field, errcode);
   IfWrongTypeReturn(errcode);
-  return PackBoolReply(ans);
+  return reply.Bool(ans);
 }
 
 #define HKeysValsEntriesCommon(operation)      \
-  const std::string &key = cmds.argv[1];       \
+  const StringView &key = cmds.argv[1];        \
   int errcode;                                 \
   auto keys = holder->operation(key, errcode); \
   if (errcode == kWrongTypeCode) {             \
-    return kWrongTypeMsg;                      \
+    return reply.Raw(kWrongTypeMsg);           \
   }                                            \
   if (!keys.empty()) {                         \
-    return PackArrayMsg(keys);                 \
+    return reply.Array(keys);                  \
   }                                            \
-  return kArrayEmptyMsg;
+  return reply.Raw(kArrayEmptyMsg);
 
-std::string HGetAllCommand(__PARAMETERS_LIST) {
+void HGetAllCommand(__PARAMETERS_LIST) {
   /* usage: hgetall key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'hgetall');
-  HKeysValsEntriesCommon(HashGetAllEntries)
+  int errcode;
+  /* fields and values are written into the reply as they are visited */
+  size_t n = holder->HashGetAllEntries(
+      cmds.argv[1], [&reply](size_t len) { reply.ArrayHeader(len * 2); },
+      [&reply](const HEntryKey &field, const HEntryVal &value) {
+        reply.Bulk(field);
+        reply.Bulk(value);
+      },
+      errcode);
+  IfWrongTypeReturn(errcode);
+  if (n == 0) {
+    return reply.Raw(kArrayEmptyMsg);
+  }
 }
 
-std::string HKeysCommand(__PARAMETERS_LIST) {
+void HKeysCommand(__PARAMETERS_LIST) {
   /* usage: hkeys key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'hkeys');
   HKeysValsEntriesCommon(HashGetAllFields)
 }
 
-std::string HValsCommand(__PARAMETERS_LIST) {
+void HValsCommand(__PARAMETERS_LIST) {
   /* usage: hvals key*/
-  CheckSyntaxHelper(cmds, 1, 0, false, 'hvals');
   HKeysValsEntriesCommon(HashGetAllValues)
 }
 
 #undef HKeysValsEntriesCommon
 
-std::string HLenCommand(__PARAMETERS_LIST) {
+void HLenCommand(__PARAMETERS_LIST) {
   /* usage: hlen key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'hlen');
-  const std::string &key = cmds.argv[1];
+  const StringView &key = cmds.argv[1];
   int errcode;
   size_t len = holder->HashLen(key, errcode);
   IfWrongTypeReturn(errcode);
-  return PackIntReply(len);
+  return reply.Int(len);
 }
 
-std::string SAddCommand(__PARAMETERS_LIST) {
-  /* usage: sadd key member1 member2 ... */
-  CheckSyntaxHelper(cmds, 1, -1, false, 'sadd');
-  const std::string &key = cmds.argv[1];
+/* sync field of hash with its resulting value and expiration so that replaying is idempotent */
+static void SyncHashField(KVContainer *holder, AppendableFile *appendable, bool sync,
+                          const std::string &key, const std::string &field,
+                          const std::string &value) {
+  AddIntoAppendable(appendable, sync, {"hset", key, field, value});
   int errcode;
-  /* fixme: extra memory cost */
-  std::vector<std::string> members(cmds.argv.begin() + 2, cmds.argv.end()); 
-  int n_added = holder->SetAddItem(key, members, errcode);
-  IfWrongTypeReturn(errcode);
-  IfFailReturn(errcode, PackIntReply(0));
-  AddIntoAppendableDirectly(cmds);
-  return PackIntReply(n_added);
+  int64_t when = holder->HashFieldExpireTime(key, {field}, errcode)[0];
+  if (when > 0) {
+    AddIntoAppendable(appendable, sync, {"hpexpireat", key, std::to_string(when), "FIELDS", "1", field});
+  }
 }
 
-std::string SIsMemberCommand(__PARAMETERS_LIST) {
-  /* usage: sismember key member */
-  CheckSyntaxHelper(cmds, 1, 1, false, 'sismember');
-  const std::string &key = cmds.argv[1];
-  const std::string &member = cmds.argv[2];
+void HIncrByCommand(__PARAMETERS_LIST) {
+  /* usage: hincrby key field increment */
+  const StringView &key = cmds.argv[1];
+  const StringView &field = cmds.argv[2];
+  int64_t increment;
+  if (!CanConvertToInt64(cmds.argv[3], increment)) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
   int errcode;
-  auto ret = holder->SetIsMember(key, member, errcode);
+  int64_t value = holder->HashIncrBy(key, field, increment, errcode);
+  IfWrongTypeReturn(errcode);
+  if (errcode == kOverflowCode) {
+    return reply.Raw(kInt64OverflowMsg);
+  }
+  if (errcode == kFailCode) {
+    return reply.Error("ERROR", "hash value is not an integer");
+  }
+  SyncHashField(holder, appendable, sync, key, field, std::to_string(value));
+  return reply.Int(value);
+}
+
+void HIncrByFloatCommand(__PARAMETERS_LIST) {
+  /* usage: hincrbyfloat key field increment */
+  const StringView &key = cmds.argv[1];
+  const StringView &field = cmds.argv[2];
+  const StringView &str = cmds.argv[3];
+  char *end = nullptr;
+  long double increment = std::strtold(str.c_str(), &end);
+  if (str.empty() || end != str.c_str() + str.size() || !std::isfinite(increment)) {
+    return reply.Error("ERROR", "value is not a valid float");
+  }
+  int errcode;
+  std::string value = holder->HashIncrByFloat(key, field, increment, errcode);
   IfWrongTypeReturn(errcode);
-  return PackBoolReply(ret);
+  if (errcode == kFailCode) {
+    return reply.Error("ERROR", "hash value is not a float or increment would produce NaN or Infinity");
+  }
+  SyncHashField(holder, appendable, sync, key, field, value);
+  return reply.Bulk(value);
 }
 
-std::string SMIsMemberCommand(__PARAMETERS_LIST) {
-  /* usage: smismember key member1 member2 ... */
-  CheckSyntaxHelper(cmds, 1, -1, false, 'smismember');
-  const std::string &key = cmds.argv[1];
+void HSetNXCommand(__PARAMETERS_LIST) {
+  /* usage: hsetnx key field value */
+  const StringView &key = cmds.argv[1];
+  int errcode;
+  bool set = holder->HashSetNX(key, cmds.argv[2], cmds.argv[3], errcode);
+  IfWrongTypeReturn(errcode);
+  if (set) {
+    AddIntoAppendable(appendable, sync, {"hset", key, cmds.argv[2], cmds.argv[3]});
+  }
+  return reply.Bool(set);
+}
+
+void HMGetCommand(__PARAMETERS_LIST) {
+  /* usage: hmget key field1 field2 ... */
+  std::vector<std::string> fields(cmds.argv.begin() + 2, cmds.argv.end());
+  int errcode;
+  std::vector<HEntryVal> values = holder->HashGetValue(Key(cmds.argv[1]), fields, errcode);
+  IfWrongTypeReturn(errcode);
+  if (!values.empty()) {
+    return reply.Array(values);
+  }
+  return reply.ArrayOfNils(fields.size());
+}
+
+/* parse "FIELDS numfields field1 field2 ..." starting from argv[idx] */
+static bool ParseHashFields(const std::vector<StringView> &argv, size_t idx,
+                            std::vector<std::string> &fields) {
+  uint64_t n_fields;
+  if (argv.size() < idx + 3 || strcasecmp(argv[idx].c_str(), "fields") != 0 ||
+      !CanConvertToUInt64(argv[idx + 1], n_fields) || n_fields != argv.size() - idx - 2) {
+    return false;
+  }
+  fields.assign(argv.begin() + idx + 2, argv.end());
+  return true;
+}
+
+/* set expiration of fields at when (unix milliseconds) */
+static void HashFieldExpireAt(KVContainer *holder, AppendableFile *appendable, bool sync,
+                              const std::vector<StringView> &argv, uint64_t when,
+                              ReplyWriter &reply) {
+  std::vector<std::string> fields;
+  if (!ParseHashFields(argv, 3, fields)) {
+    return reply.Error("ERROR", "syntax error, FIELDS numfields field1 field2 ... expected");
+  }
+  const std::string &key = argv[1];
+  int errcode;
+  std::vector<int> results = holder->HashFieldExpireAt(key, fields, when, errcode);
+  IfWrongTypeReturn(errcode);
+  /* sync with absolute timestamp for the fields changed */
+  std::vector<std::string> synced = {"hpexpireat", key, std::to_string(when), "FIELDS", ""};
+  for (size_t i = 0; i < fields.size(); ++i) {
+    if (results[i] > 0) {
+      synced.emplace_back(fields[i]);
+    }
+  }
+  if (synced.size() > 5) {
+    synced[4] = std::to_string(synced.size() - 5);
+    AddIntoAppendable(appendable, sync, synced);
+  }
+  return reply.IntArray(results);
+}
+
+void HExpireCommand(__PARAMETERS_LIST) {
+  /* usage: hexpire key seconds FIELDS numfields field1 field2 ... */
+  uint64_t seconds;
+  if (!CanConvertToUInt64(cmds.argv[2], seconds) || seconds > UINT32_MAX) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  return HashFieldExpireAt(holder, appendable, sync, cmds.argv, GetCurrentMs() + seconds * 1000, reply);
+}
+
+void HPExpireCommand(__PARAMETERS_LIST) {
+  /* usage: hpexpire key milliseconds FIELDS numfields field1 field2 ... */
+  uint64_t ms;
+  if (!CanConvertToUInt64(cmds.argv[2], ms) || ms > UINT32_MAX * 1000ull) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  return HashFieldExpireAt(holder, appendable, sync, cmds.argv, GetCurrentMs() + ms, reply);
+}
+
+void HPExpireAtCommand(__PARAMETERS_LIST) {
+  /* usage: hpexpireat key unix_ms FIELDS numfields field1 field2 ... */
+  uint64_t when;
+  if (!CanConvertToUInt64(cmds.argv[2], when) || when > INT64_MAX) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  return HashFieldExpireAt(holder, appendable, sync, cmds.argv, when, reply);
+}
+
+/* remaining time to live of fields in unit of milliseconds, -1 if no expiration, -2 if no field */
+static void HashFieldTTL(KVContainer *holder, const std::vector<StringView> &argv,
+                         uint64_t unit, ReplyWriter &reply) {
+  std::vector<std::string> fields;
+  if (!ParseHashFields(argv, 2, fields)) {
+    return reply.Error("ERROR", "syntax error, FIELDS numfields field1 field2 ... expected");
+  }
+  int errcode;
+  std::vector<int64_t> ttls = holder->HashFieldExpireTime(argv[1], fields, errcode);
+  IfWrongTypeReturn(errcode);
+  uint64_t now = GetCurrentMs();
+  for (auto &ttl : ttls) {
+    if (ttl >= 0) {
+      ttl = (uint64_t)ttl > now ? (int64_t)(((uint64_t)ttl - now) / unit) : 0;
+    }
+  }
+  return reply.IntArray(ttls);
+}
+
+void HTTLCommand(__PARAMETERS_LIST) {
+  /* usage: httl key FIELDS numfields field1 field2 ... */
+  return HashFieldTTL(holder, cmds.argv, 1000, reply);
+}
+
+void HPTTLCommand(__PARAMETERS_LIST) {
+  /* usage: hpttl key FIELDS numfields field1 field2 ... */
+  return HashFieldTTL(holder, cmds.argv, 1, reply);
+}
+
+void HPersistCommand(__PARAMETERS_LIST) {
+  /* usage: hpersist key FIELDS numfields field1 field2 ... */
+  std::vector<std::string> fields;
+  if (!ParseHashFields(cmds.argv, 2, fields)) {
+    return reply.Error("ERROR", "syntax error, FIELDS numfields field1 field2 ... expected");
+  }
+  int errcode;
+  std::vector<int> results = holder->HashFieldPersist(cmds.argv[1], fields, errcode);
+  IfWrongTypeReturn(errcode);
+  if (std::find(results.begin(), results.end(), 1) != results.end()) {
+    AddIntoAppendableDirectly(cmds);
+  }
+  return reply.IntArray(results);
+}
+
+void SAddCommand(__PARAMETERS_LIST) {
+  /* usage: sadd key member1 member2 ... */
+  const StringView &key = cmds.argv[1];
+  int errcode;
+  /* fixme: extra memory cost */
+  std::vector<std::string> members(cmds.argv.begin() + 2, cmds.argv.end()); 
+  int n_added = holder->SetAddItem(key, members, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Int(0));
+  AddIntoAppendableDirectly(cmds);
+  return reply.Int(n_added);
+}
+
+void SIsMemberCommand(__PARAMETERS_LIST) {
+  /* usage: sismember key member */
+  const StringView &key = cmds.argv[1];
+  const StringView &member = cmds.argv[2];
+  int errcode;
+  auto ret = holder->SetIsMember(key, member, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Bool(ret);
+}
+
+void SMIsMemberCommand(__PARAMETERS_LIST) {
+  /* usage: smismember key member1 member2 ... */
+  const StringView &key = cmds.argv[1];
+  std::vector<std::string> members(cmds.argv.begin() + 2, cmds.argv.end());
+  int errcode;
+  auto ret = holder->SetMIsMember(key, members, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.IntArray(ret);
+}
+
+void SMembersCommand(__PARAMETERS_LIST) {
+  /* usage: smembers key */
+  const StringView &key = cmds.argv[1];
+  int errcode;
+  auto ret = holder->SetGetMembers(key, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Array(ret);
+}
+
+void SRemCommand(__PARAMETERS_LIST) {
+  /* usage: srem key member1 member2 ... */
+  const StringView &key = cmds.argv[1];
+  std::vector<std::string> members(cmds.argv.begin() + 2, cmds.argv.end());
+  int errcode;
+  auto ret = holder->SetRemoveMembers(key, members, errcode);
+  IfWrongTypeReturn(errcode);
+  AddIntoAppendableDirectly(cmds);
+  return reply.Int(ret);
+}
+
+void SCardCommand(__PARAMETERS_LIST) {
+  /* usage: scard key */
+  const StringView &key = cmds.argv[1];
+  int errcode;
+  auto ret = holder->SetGetMemberCount(key, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(ret);
+}
+
+void SPopCommand(__PARAMETERS_LIST) {
+  /* usage: spop key [count] */
+  if (cmds.argv.size() != 2 && cmds.argv.size() != 3) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'spop' command");
+  }
+  const StringView &key = cmds.argv[1];
+  bool with_count = cmds.argv.size() == 3;
+  int64_t count = 1;
+  if (with_count && (!CanConvertToInt64(cmds.argv[2], count) || count < 0)) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  int errcode;
+  auto members = holder->SetPopMembers(key, count, errcode);
+  IfWrongTypeReturn(errcode);
+  if (!members.empty()) {
+    /* popped members are synced as srem */
+    std::vector<std::string> argv = {"srem", key};
+    for (const auto &member : members) {
+      argv.emplace_back(member.ToStdString());
+    }
+    AddIntoAppendable(appendable, sync, std::move(argv));
+  }
+  if (!with_count) {
+    return members.empty() ? reply.Nil() : reply.Bulk(members[0]);
+  }
+  return reply.Array(members);
+}
+
+void SRandMemberCommand(__PARAMETERS_LIST) {
+  /* usage: srandmember key [count] */
+  if (cmds.argv.size() != 2 && cmds.argv.size() != 3) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'srandmember' command");
+  }
+  const StringView &key = cmds.argv[1];
+  bool with_count = cmds.argv.size() == 3;
+  int64_t count = 1;
+  /* negative count allows repeated members, reject the ones which can not be negated */
+  if (with_count && (!CanConvertToInt64(cmds.argv[2], count) || count == INT64_MIN)) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  int errcode;
+  auto members = holder->SetRandomMembers(key, count, errcode);
+  IfWrongTypeReturn(errcode);
+  if (!with_count) {
+    return members.empty() ? reply.Nil() : reply.Bulk(members[0]);
+  }
+  return reply.Array(members);
+}
+
+static void SetAlgebraCommon(KVContainer *holder, int op, const CommandCache &cmds, ReplyWriter &reply) {
+  std::vector<std::string> keys(cmds.argv.begin() + 1, cmds.argv.end());
+  /* the number of members is known at the end, so they are written aside before the header */
+  Buffer members;
+  ReplyWriter member_writer(members);
+  size_t count = 0;
+  int errcode;
+  holder->SetAlgebra(op, keys, [&member_writer, &count](const HEntryKey &member) {
+    member_writer.Bulk(member);
+    ++count;
+    return true;
+  }, errcode);
+  IfWrongTypeReturn(errcode);
+  reply.ArrayHeader(count);
+  reply.Raw(members.BeginRead(), members.ReadableBytes());
+}
+
+void SInterCommand(__PARAMETERS_LIST) {
+  /* usage: sinter key [key ...] */
+  return SetAlgebraCommon(holder, SET_OP_INTER, cmds, reply);
+}
+
+void SUnionCommand(__PARAMETERS_LIST) {
+  /* usage: sunion key [key ...] */
+  return SetAlgebraCommon(holder, SET_OP_UNION, cmds, reply);
+}
+
+void SDiffCommand(__PARAMETERS_LIST) {
+  /* usage: sdiff key [key ...] */
+  return SetAlgebraCommon(holder, SET_OP_DIFF, cmds, reply);
+}
+
+void SInterCardCommand(__PARAMETERS_LIST) {
+  /* usage: sintercard numkeys key [key ...] [LIMIT limit] */
+  int64_t numkeys;
+  if (!CanConvertToInt64(cmds.argv[1], numkeys) || numkeys <= 0) {
+    return reply.Error("ERROR", "numkeys should be greater than 0");
+  }
+  size_t n_rest = cmds.argv.size() - 2;
+  if ((size_t)numkeys > n_rest) {
+    return reply.Error("ERROR", "number of keys can't be greater than number of args");
+  }
+  uint64_t limit = 0; /* 0 means unlimited */
+  if (n_rest != (size_t)numkeys) {
+    if (n_rest != (size_t)numkeys + 2 || strcasecmp(cmds.argv[numkeys + 2].c_str(), "limit") != 0) {
+      return reply.Error("ERROR", "syntax error");
+    }
+    if (!CanConvertToUInt64(cmds.argv[numkeys + 3], limit)) {
+      return reply.Error("ERROR", "LIMIT can't be negative");
+    }
+  }
+  std::vector<std::string> keys(cmds.argv.begin() + 2, cmds.argv.begin() + 2 + numkeys);
+  uint64_t count = 0;
+  int errcode;
+  /* stop probing as soon as limit is reached */
+  holder->SetAlgebra(SET_OP_INTER, keys, [&count, limit](const HEntryKey &) {
+    return ++count != limit;
+  }, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(count);
+}
+
+static void SetAlgebraStoreCommon(KVContainer *holder, AppendableFile *appendable, bool sync,
+                                  int op, const CommandCache &cmds, ReplyWriter &reply) {
+  const StringView &dst = cmds.argv[1];
+  std::vector<std::string> keys(cmds.argv.begin() + 2, cmds.argv.end());
+  int errcode;
+  size_t count = holder->SetAlgebraStore(op, dst, keys, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Raw(kNotOkMsg));
+  /* sync the result instead of the operation, so that the aof stays keyed by dst */
+  AddIntoAppendable(appendable, sync, {"del", dst});
+  if (count > 0) {
+    AddIntoAppendable(appendable, sync, holder->RecoverCommandFromValue(dst, errcode));
+  }
+  return reply.Int(count);
+}
+
+void SInterStoreCommand(__PARAMETERS_LIST) {
+  /* usage: sinterstore destination key [key ...] */
+  return SetAlgebraStoreCommon(holder, appendable, sync, SET_OP_INTER, cmds, reply);
+}
+
+void SUnionStoreCommand(__PARAMETERS_LIST) {
+  /* usage: sunionstore destination key [key ...] */
+  return SetAlgebraStoreCommon(holder, appendable, sync, SET_OP_UNION, cmds, reply);
+}
+
+void SDiffStoreCommand(__PARAMETERS_LIST) {
+  /* usage: sdiffstore destination key [key ...] */
+  return SetAlgebraStoreCommon(holder, appendable, sync, SET_OP_DIFF, cmds, reply);
+}
+
+/* parse score bound, "(" prefix means exclusive, -inf and +inf are supported */
+static bool ParseScoreBound(const std::string &arg, int64_t &bound, bool &exclusive) {
+  exclusive = !arg.empty() && arg[0] == '(';
+  std::string value = exclusive ? arg.substr(1) : arg;
+  if (strcasecmp(value.c_str(), "-inf") == 0) {
+    bound = INT64_MIN;
+    return true;
+  }
+  if (strcasecmp(value.c_str(), "+inf") == 0 || strcasecmp(value.c_str(), "inf") == 0) {
+    bound = INT64_MAX;
+    return true;
+  }
+  return CanConvertToInt64(value, bound);
+}
+
+static void ReplyZSetItems(ReplyWriter &reply, const std::vector<ZSetItem> &items, bool withscores) {
+  reply.ArrayHeader(withscores ? items.size() * 2 : items.size());
+  for (const auto &item : items) {
+    reply.Bulk(item.first);
+    if (withscores) {
+      reply.BulkInt(item.second);
+    }
+  }
+}
+
+void ZAddCommand(__PARAMETERS_LIST) {
+  /* usage: zadd key [NX|XX] [CH] score member [score member ...] */
+  const StringView &key = cmds.argv[1];
+  bool nx = false, xx = false, ch = false;
+  size_t idx = 2;
+  for (; idx < cmds.argv.size(); ++idx) {
+    const char *opt = cmds.argv[idx].c_str();
+    if (strcasecmp(opt, "nx") == 0) {
+      nx = true;
+    } else if (strcasecmp(opt, "xx") == 0) {
+      xx = true;
+    } else if (strcasecmp(opt, "ch") == 0) {
+      ch = true;
+    } else {
+      break;
+    }
+  }
+  if (nx && xx) {
+    return reply.Error("ERROR", "XX and NX options at the same time are not compatible");
+  }
+  size_t n_rest = cmds.argv.size() - idx;
+  if (n_rest == 0 || n_rest % 2 != 0) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'zadd' command");
+  }
+  std::vector<std::pair<int64_t, std::string>> items;
+  items.reserve(n_rest / 2);
+  for (; idx < cmds.argv.size(); idx += 2) {
+    int64_t score;
+    if (!CanConvertToInt64(cmds.argv[idx], score)) {
+      return reply.Raw(kInvalidIntegerMsg);
+    }
+    items.emplace_back(score, cmds.argv[idx + 1]);
+  }
+  int errcode;
+  int ret = holder->ZSetAdd(key, items, nx, xx, ch, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Int(0));
+  AddIntoAppendableDirectly(cmds);
+  return reply.Int(ret);
+}
+
+void ZIncrByCommand(__PARAMETERS_LIST) {
+  /* usage: zincrby key increment member */
+  const StringView &key = cmds.argv[1];
+  const StringView &member = cmds.argv[3];
+  int64_t increment;
+  if (!CanConvertToInt64(cmds.argv[2], increment)) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  int errcode;
+  int64_t score = holder->ZSetIncrBy(key, member, increment, errcode);
+  IfWrongTypeReturn(errcode);
+  if (errcode == kOverflowCode) {
+    return reply.Raw(kInt64OverflowMsg);
+  }
+  IfFailReturn(errcode, reply.Raw(kNotOkMsg));
+  std::string score_str = std::to_string(score);
+  /* sync the resulting score so that replaying is idempotent */
+  AddIntoAppendable(appendable, sync, {"zadd", key, score_str, member});
+  return reply.Bulk(score_str);
+}
+
+void ZScoreCommand(__PARAMETERS_LIST) {
+  /* usage: zscore key member */
+  int errcode;
+  int64_t score;
+  bool found = holder->ZSetScore(cmds.argv[1], cmds.argv[2], score, errcode);
+  IfWrongTypeReturn(errcode);
+  if (!found) {
+    return reply.Raw(kNilMsg);
+  }
+  return reply.Bulk(std::to_string(score));
+}
+
+void ZRemCommand(__PARAMETERS_LIST) {
+  /* usage: zrem key member1 member2 ... */
+  const StringView &key = cmds.argv[1];
   std::vector<std::string> members(cmds.argv.begin() + 2, cmds.argv.end());
   int errcode;
-  auto ret = holder->SetMIsMember(key, members, errcode);
+  int ret = holder->ZSetRemove(key, members, errcode);
+  IfWrongTypeReturn(errcode);
+  if (ret > 0) {
+    AddIntoAppendableDirectly(cmds);
+  }
+  return reply.Int(ret);
+}
+
+void ZCardCommand(__PARAMETERS_LIST) {
+  /* usage: zcard key */
+  int errcode;
+  size_t ret = holder->ZSetCard(cmds.argv[1], errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(ret);
+}
+
+void ZRankCommand(__PARAMETERS_LIST) {
+  /* usage: zrank key member */
+  int errcode;
+  long rank = holder->ZSetRank(cmds.argv[1], cmds.argv[2], errcode);
+  IfWrongTypeReturn(errcode);
+  if (rank < 0) {
+    return reply.Raw(kNilMsg);
+  }
+  return reply.Int(rank);
+}
+
+void ZRangeCommand(__PARAMETERS_LIST) {
+  /* usage: zrange key start stop [WITHSCORES] */
+  bool withscores = cmds.argv.size() == 5 && strcasecmp(cmds.argv[4].c_str(), "withscores") == 0;
+  if (!withscores && cmds.argv.size() != 4) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'zrange' command");
+  }
+  int64_t start, stop;
+  if (!CanConvertToInt64(cmds.argv[2], start) || !CanConvertToInt64(cmds.argv[3], stop)) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  int errcode;
+  auto items = holder->ZSetRange(cmds.argv[1], start, stop, errcode);
+  IfWrongTypeReturn(errcode);
+  return ReplyZSetItems(reply, items, withscores);
+}
+
+void ZRangeByScoreCommand(__PARAMETERS_LIST) {
+  /* usage: zrangebyscore key min max [WITHSCORES] [LIMIT offset count] */
+  if (cmds.argv.size() < 4) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'zrangebyscore' command");
+  }
+  ZScoreRange range;
+  if (!ParseScoreBound(cmds.argv[2], range.min, range.minex) ||
+      !ParseScoreBound(cmds.argv[3], range.max, range.maxex)) {
+    return reply.Error("ERROR", "min or max is not an integer");
+  }
+  bool withscores = false;
+  int64_t offset = 0, count = -1;
+  for (size_t idx = 4; idx < cmds.argv.size(); ++idx) {
+    const char *opt = cmds.argv[idx].c_str();
+    if (strcasecmp(opt, "withscores") == 0) {
+      withscores = true;
+    } else if (strcasecmp(opt, "limit") == 0 && idx + 2 < cmds.argv.size()) {
+      if (!CanConvertToInt64(cmds.argv[idx + 1], offset) ||
+          !CanConvertToInt64(cmds.argv[idx + 2], count)) {
+        return reply.Raw(kInvalidIntegerMsg);
+      }
+      idx += 2;
+    } else {
+      return reply.Error("ERROR", "syntax error");
+    }
+  }
+  if (offset < 0) {
+    return reply.Raw(kArrayEmptyMsg);
+  }
+  int errcode;
+  auto items = holder->ZSetRangeByScore(cmds.argv[1], range, offset, count, errcode);
+  IfWrongTypeReturn(errcode);
+  return ReplyZSetItems(reply, items, withscores);
+}
+
+void ZPopMinCommand(__PARAMETERS_LIST) {
+  /* usage: zpopmin key [count] */
+  if (cmds.argv.size() != 2 && cmds.argv.size() != 3) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'zpopmin' command");
+  }
+  const StringView &key = cmds.argv[1];
+  int64_t count = 1;
+  if (cmds.argv.size() == 3 && (!CanConvertToInt64(cmds.argv[2], count) || count < 0)) {
+    return reply.Raw(kInvalidIntegerMsg);
+  }
+  int errcode;
+  auto items = holder->ZSetPopMin(key, count, errcode);
+  IfWrongTypeReturn(errcode);
+  if (!items.empty()) {
+    /* popped members are synced as zrem */
+    std::vector<std::string> argv = {"zrem", key};
+    for (const auto &item : items) {
+      argv.emplace_back(item.first.ToStdString());
+    }
+    AddIntoAppendable(appendable, sync, std::move(argv));
+  }
+  return ReplyZSetItems(reply, items, true);
+}
+
+void PfAddCommand(__PARAMETERS_LIST) {
+  /* usage: pfadd key [element ...] */
+  std::vector<std::string> elems(cmds.argv.begin() + 2, cmds.argv.end());
+  int errcode;
+  int updated = holder->HLLAdd(cmds.argv[1], elems, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Raw(kNotOkMsg));
+  if (updated) {
+    AddIntoAppendableDirectly(cmds);
+  }
+  return reply.Int(updated);
+}
+
+void PfCountCommand(__PARAMETERS_LIST) {
+  /* usage: pfcount key [key ...] */
+  std::vector<std::string> keys(cmds.argv.begin() + 1, cmds.argv.end());
+  int errcode;
+  uint64_t count = holder->HLLCount(keys, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(count);
+}
+
+void PfMergeCommand(__PARAMETERS_LIST) {
+  /* usage: pfmerge destkey [sourcekey ...] */
+  const StringView &dst = cmds.argv[1];
+  std::vector<std::string> keys(cmds.argv.begin() + 2, cmds.argv.end());
+  int errcode;
+  holder->HLLMerge(dst, keys, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Raw(kNotOkMsg));
+  /* sync the merged registers, so that the aof stays keyed by dst */
+  AddIntoAppendable(appendable, sync, holder->RecoverCommandFromValue(dst, errcode));
+  return reply.Raw(kOkMsg);
+}
+
+void PfRestoreCommand(__PARAMETERS_LIST) {
+  /* usage: pfrestore key payload */
+  int errcode;
+  if (!holder->HLLRestore(cmds.argv[1], cmds.argv[2], errcode)) {
+    return reply.Error("ERROR", "invalid hyperloglog payload");
+  }
+  AddIntoAppendableDirectly(cmds);
+  return reply.Raw(kOkMsg);
+}
+
+static bool CanConvertToUInt32(const std::string &str, uint32_t &val) {
+  uint64_t val64;
+  if (!CanConvertToUInt64(str, val64) || val64 > UINT32_MAX) {
+    return false;
+  }
+  val = (uint32_t)val64;
+  return true;
+}
+
+#define IfKeyNotFoundReturnErr(errcode)                          \
+  do {                                                           \
+    if (errcode == kKeyNotFoundCode) {                           \
+      return reply.Error("ERROR", "key does not exist");         \
+    }                                                            \
+  } while (0)
+
+void CMSInitByDimCommand(__PARAMETERS_LIST) {
+  /* usage: cms.initbydim key width depth */
+  uint32_t width, depth;
+  if (!CanConvertToUInt32(cmds.argv[2], width) || !CanConvertToUInt32(cmds.argv[3], depth) ||
+      width == 0 || depth == 0) {
+    return reply.Error("ERROR", "width and depth must be positive integers");
+  }
+  if ((uint64_t)width * depth > kCMSMaxCounters) {
+    return reply.Error("ERROR", "width * depth is too large");
+  }
+  int errcode;
+  if (!holder->CMSInit(cmds.argv[1], width, depth, errcode)) {
+    return reply.Error("ERROR", "key already exists");
+  }
+  AddIntoAppendableDirectly(cmds);
+  return reply.Raw(kOkMsg);
+}
+
+void CMSIncrByCommand(__PARAMETERS_LIST) {
+  /* usage: cms.incrby key item increment [item increment ...] */
+  if ((cmds.argv.size() & 1) != 0) {  /* item-increment pairs */
+    return reply.Error("ERROR", "incorrect number of arguments for 'cms.incrby' command");
+  }
+  std::vector<std::string> items;
+  std::vector<uint32_t> increments;
+  items.reserve(cmds.argv.size() / 2 - 1);
+  increments.reserve(cmds.argv.size() / 2 - 1);
+  for (size_t i = 2; i < cmds.argv.size(); i += 2) {
+    uint32_t increment;
+    if (!CanConvertToUInt32(cmds.argv[i + 1], increment)) {
+      return reply.Raw(kInvalidIntegerMsg);
+    }
+    items.emplace_back(cmds.argv[i]);
+    increments.emplace_back(increment);
+  }
+  int errcode;
+  auto counts = holder->CMSIncrBy(cmds.argv[1], items, increments, errcode);
+  IfWrongTypeReturn(errcode);
+  IfKeyNotFoundReturnErr(errcode);
+  AddIntoAppendableDirectly(cmds);
+  return reply.IntArray(counts);
+}
+
+void CMSQueryCommand(__PARAMETERS_LIST) {
+  /* usage: cms.query key item [item ...] */
+  std::vector<std::string> items(cmds.argv.begin() + 2, cmds.argv.end());
+  int errcode;
+  auto counts = holder->CMSQuery(cmds.argv[1], items, errcode);
+  IfWrongTypeReturn(errcode);
+  IfKeyNotFoundReturnErr(errcode);
+  return reply.IntArray(counts);
+}
+
+void CMSMergeCommand(__PARAMETERS_LIST) {
+  /* usage: cms.merge destination numkeys source [source ...] [WEIGHTS weight [weight ...]] */
+  if (cmds.argv.size() < 4) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'cms.merge' command");
+  }
+  const StringView &dst = cmds.argv[1];
+  int64_t numkeys;
+  if (!CanConvertToInt64(cmds.argv[2], numkeys) || numkeys <= 0 ||
+      (size_t)numkeys > cmds.argv.size() - 3) {
+    return reply.Error("ERROR", "numkeys should be greater than 0 and match the given keys");
+  }
+  size_t idx = 3 + numkeys;
+  std::vector<std::string> keys(cmds.argv.begin() + 3, cmds.argv.begin() + idx);
+  std::vector<uint32_t> weights(numkeys, 1);
+  if (idx < cmds.argv.size()) {
+    if (strcasecmp(cmds.argv[idx].c_str(), "weights") != 0 ||
+        cmds.argv.size() - idx - 1 != (size_t)numkeys) {
+      return reply.Error("ERROR", "syntax error");
+    }
+    for (int64_t i = 0; i < numkeys; ++i) {
+      if (!CanConvertToUInt32(cmds.argv[idx + 1 + i], weights[i])) {
+        return reply.Raw(kInvalidIntegerMsg);
+      }
+    }
+  }
+  int errcode;
+  holder->CMSMerge(dst, keys, weights, errcode);
+  IfWrongTypeReturn(errcode);
+  IfKeyNotFoundReturnErr(errcode);
+  if (errcode == kFailCode) {
+    return reply.Error("ERROR", "width and depth of sketches must be the same");
+  }
+  /* sync the merged counters, so that the aof stays keyed by dst */
+  AddIntoAppendable(appendable, sync, holder->RecoverCommandFromValue(dst, errcode));
+  return reply.Raw(kOkMsg);
+}
+
+void CMSRestoreCommand(__PARAMETERS_LIST) {
+  /* usage: cms.restore key payload */
+  int errcode;
+  if (!holder->CMSRestore(cmds.argv[1], cmds.argv[2], errcode)) {
+    return reply.Error("ERROR", "invalid count-min sketch payload");
+  }
+  AddIntoAppendableDirectly(cmds);
+  return reply.Raw(kOkMsg);
+}
+
+void TopKReserveCommand(__PARAMETERS_LIST) {
+  /* usage: topk.reserve key topk [width depth decay] */
+  if (cmds.argv.size() != 3 && cmds.argv.size() != 6) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'topk.reserve' command");
+  }
+  uint32_t k, width = kTopKDefaultWidth, depth = kTopKDefaultDepth;
+  double decay = kTopKDefaultDecay;
+  if (!CanConvertToUInt32(cmds.argv[2], k) || k == 0 || k > kTopKMaxK) {
+    return reply.Error("ERROR", "topk should be an integer in range [1, 100000]");
+  }
+  if (cmds.argv.size() == 6) {
+    if (!CanConvertToUInt32(cmds.argv[3], width) || !CanConvertToUInt32(cmds.argv[4], depth) ||
+        width == 0 || depth == 0 || (uint64_t)width * depth > kTopKMaxBuckets) {
+      return reply.Error("ERROR", "invalid width or depth");
+    }
+    if (!CanConvertToDouble(cmds.argv[5], decay) || !(decay > 0 && decay < 1)) {
+      return reply.Error("ERROR", "decay should be in range (0, 1)");
+    }
+  }
+  int errcode;
+  if (!holder->TopKReserve(cmds.argv[1], k, width, depth, decay, errcode)) {
+    return reply.Error("ERROR", "key already exists");
+  }
+  AddIntoAppendableDirectly(cmds);
+  return reply.Raw(kOkMsg);
+}
+
+static void TopKAddCommon(KVContainer *holder, AppendableFile *appendable, bool sync,
+                          const CommandCache &cmds, const std::vector<std::string> &items,
+                          const std::vector<uint32_t> &increments, ReplyWriter &reply) {
+  int errcode;
+  auto expelled = holder->TopKAdd(cmds.argv[1], items, increments, errcode);
+  IfWrongTypeReturn(errcode);
+  IfKeyNotFoundReturnErr(errcode);
+  AddIntoAppendableDirectly(cmds);
+  reply.ArrayHeader(expelled.size());
+  for (const auto &item : expelled) {
+    if (item.first) {
+      reply.Bulk(item.second);
+    } else {
+      reply.Nil();
+    }
+  }
+}
+
+void TopKAddCommand(__PARAMETERS_LIST) {
+  /* usage: topk.add key item [item ...] */
+  std::vector<std::string> items(cmds.argv.begin() + 2, cmds.argv.end());
+  std::vector<uint32_t> increments(items.size(), 1);
+  return TopKAddCommon(holder, appendable, sync, cmds, items, increments, reply);
+}
+
+void TopKIncrByCommand(__PARAMETERS_LIST) {
+  /* usage: topk.incrby key item increment [item increment ...] */
+  if ((cmds.argv.size() & 1) != 0) {  /* item-increment pairs */
+    return reply.Error("ERROR", "incorrect number of arguments for 'topk.incrby' command");
+  }
+  std::vector<std::string> items;
+  std::vector<uint32_t> increments;
+  for (size_t i = 2; i < cmds.argv.size(); i += 2) {
+    uint32_t increment;
+    if (!CanConvertToUInt32(cmds.argv[i + 1], increment) || increment > 100000) {
+      return reply.Error("ERROR", "increment should be an integer in range [0, 100000]");
+    }
+    items.emplace_back(cmds.argv[i]);
+    increments.emplace_back(increment);
+  }
+  return TopKAddCommon(holder, appendable, sync, cmds, items, increments, reply);
+}
+
+void TopKQueryCommand(__PARAMETERS_LIST) {
+  /* usage: topk.query key item [item ...] */
+  std::vector<std::string> items(cmds.argv.begin() + 2, cmds.argv.end());
+  int errcode;
+  auto found = holder->TopKQuery(cmds.argv[1], items, errcode);
   IfWrongTypeReturn(errcode);
-  return PackIntArrayMsg(ret);
+  IfKeyNotFoundReturnErr(errcode);
+  return reply.IntArray(std::vector<int>(found.begin(), found.end()));
 }
 
-std::string SMembersCommand(__PARAMETERS_LIST) {
-  /* usage: smembers key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'smembers');
-  const std::string &key = cmds.argv[1];
+void TopKListCommand(__PARAMETERS_LIST) {
+  /* usage: topk.list key [WITHCOUNT] */
+  if (cmds.argv.size() != 2 && cmds.argv.size() != 3) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'topk.list' command");
+  }
+  bool withcount = false;
+  if (cmds.argv.size() == 3) {
+    if (strcasecmp(cmds.argv[2].c_str(), "withcount") != 0) {
+      return reply.Error("ERROR", "syntax error");
+    }
+    withcount = true;
+  }
   int errcode;
-  auto ret = holder->SetGetMembers(key, errcode);
+  auto items = holder->TopKList(cmds.argv[1], errcode);
   IfWrongTypeReturn(errcode);
-  return PackArrayMsg(ret);
+  IfKeyNotFoundReturnErr(errcode);
+  reply.ArrayHeader(withcount ? items.size() * 2 : items.size());
+  for (const auto &item : items) {
+    reply.Bulk(item.first);
+    if (withcount) {
+      reply.Int(item.second);
+    }
+  }
 }
 
-std::string SRemCommand(__PARAMETERS_LIST) {
-  /* usage: srem key member1 member2 ... */
-  CheckSyntaxHelper(cmds, 1, -1, false, 'srem');
-  const std::string &key = cmds.argv[1];
-  std::vector<std::string> members(cmds.argv.begin() + 2, cmds.argv.end());
+void TopKRestoreCommand(__PARAMETERS_LIST) {
+  /* usage: topk.restore key payload */
   int errcode;
-  auto ret = holder->SetRemoveMembers(key, members, errcode);
+  if (!holder->TopKRestore(cmds.argv[1], cmds.argv[2], errcode)) {
+    return reply.Error("ERROR", "invalid top-k payload");
+  }
+  AddIntoAppendableDirectly(cmds);
+  return reply.Raw(kOkMsg);
+}
+
+#undef IfKeyNotFoundReturnErr
+
+void BFReserveCommand(__PARAMETERS_LIST) {
+  /* usage: bf.reserve key error_rate capacity [EXPANSION expansion] [NONSCALING] */
+  if (cmds.argv.size() < 4 || cmds.argv.size() > 7) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'bf.reserve' command");
+  }
+  double error_rate;
+  uint64_t capacity;
+  uint32_t expansion = kBloomDefaultExpansion;
+  bool nonscaling = false;
+  if (!CanConvertToDouble(cmds.argv[2], error_rate) || !(error_rate > 0 && error_rate < 1)) {
+    return reply.Error("ERROR", "error rate should be in range (0, 1)");
+  }
+  if (!CanConvertToUInt64(cmds.argv[3], capacity) || capacity == 0) {
+    return reply.Error("ERROR", "capacity should be a positive integer");
+  }
+  for (size_t i = 4; i < cmds.argv.size(); ++i) {
+    if (strcasecmp(cmds.argv[i].c_str(), "expansion") == 0 && i + 1 < cmds.argv.size()) {
+      if (!CanConvertToUInt32(cmds.argv[i + 1], expansion) || expansion == 0) {
+        return reply.Error("ERROR", "expansion should be a positive integer");
+      }
+      ++i;
+    } else if (strcasecmp(cmds.argv[i].c_str(), "nonscaling") == 0) {
+      nonscaling = true;
+    } else {
+      return reply.Error("ERROR", "syntax error");
+    }
+  }
+  if (BloomFilter::LayerBytes(error_rate, capacity) > kBloomMaxLayerBytes) {
+    return reply.Error("ERROR", "bloom filter is too large");
+  }
+  int errcode;
+  if (!holder->BFReserve(cmds.argv[1], error_rate, capacity, expansion, nonscaling, errcode)) {
+    return reply.Error("ERROR", "key already exists");
+  }
+  /* options are synced in a fixed form */
+  std::vector<std::string> argv = {"bf.reserve", cmds.argv[1], cmds.argv[2], cmds.argv[3],
+                                   "EXPANSION", std::to_string(expansion)};
+  if (nonscaling) {
+    argv.emplace_back("NONSCALING");
+  }
+  AddIntoAppendable(appendable, sync, std::move(argv));
+  return reply.Raw(kOkMsg);
+}
+
+static void ReplyBloomAddResult(ReplyWriter &reply, int result) {
+  if (result == kBloomFull) {
+    return reply.Error("ERROR", "bloom filter is full");
+  }
+  reply.Int(result);
+}
+
+/* add items into bloom filter, return the result of each item */
+static std::vector<int> BFAddCommon(KVContainer *holder, AppendableFile *appendable, bool sync,
+                                    const CommandCache &cmds,
+                                    const std::vector<std::string> &items, int &errcode) {
+  auto results = holder->BFAdd(cmds.argv[1], items, errcode);
+  if (std::find(results.begin(), results.end(), kBloomAdded) != results.end()) {
+    /* a filter just created always takes its first item */
+    AddIntoAppendableDirectly(cmds);
+  }
+  return results;
+}
+
+void BFAddCommand(__PARAMETERS_LIST) {
+  /* usage: bf.add key item */
+  int errcode;
+  auto results = BFAddCommon(holder, appendable, sync, cmds, {cmds.argv[2]}, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Error("ERROR", "bloom filter is too large"));
+  return ReplyBloomAddResult(reply, results[0]);
+}
+
+void BFMAddCommand(__PARAMETERS_LIST) {
+  /* usage: bf.madd key item [item ...] */
+  std::vector<std::string> items(cmds.argv.begin() + 2, cmds.argv.end());
+  int errcode;
+  auto results = BFAddCommon(holder, appendable, sync, cmds, items, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Error("ERROR", "bloom filter is too large"));
+  reply.ArrayHeader(results.size());
+  for (int result : results) {
+    ReplyBloomAddResult(reply, result);
+  }
+}
+
+void BFExistsCommand(__PARAMETERS_LIST) {
+  /* usage: bf.exists key item */
+  int errcode;
+  auto results = holder->BFExists(cmds.argv[1], {cmds.argv[2]}, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(results[0]);
+}
+
+void BFMExistsCommand(__PARAMETERS_LIST) {
+  /* usage: bf.mexists key item [item ...] */
+  std::vector<std::string> items(cmds.argv.begin() + 2, cmds.argv.end());
+  int errcode;
+  auto results = holder->BFExists(cmds.argv[1], items, errcode);
   IfWrongTypeReturn(errcode);
+  return reply.IntArray(results);
+}
+
+void BFRestoreCommand(__PARAMETERS_LIST) {
+  /* usage: bf.restore key payload */
+  int errcode;
+  if (!holder->BFRestore(cmds.argv[1], cmds.argv[2], errcode)) {
+    return reply.Error("ERROR", "invalid bloom filter payload");
+  }
   AddIntoAppendableDirectly(cmds);
-  return PackIntReply(ret);
+  return reply.Raw(kOkMsg);
 }
 
-std::string SCardCommand(__PARAMETERS_LIST) {
-  /* usage: scard key */
-  CheckSyntaxHelper(cmds, 1, 0, false, 'scard');
-  const std::string &key = cmds.argv[1];
+/* parse range boundary: "-", "+", "ms", "ms-seq", or exclusive one prefixed with '(' */
+static bool ParseStreamRangeID(const std::string &str, bool is_start, StreamID &id) {
+  if (str == "-") {
+    id = StreamID::Min();
+    return true;
+  }
+  if (str == "+") {
+    id = StreamID::Max();
+    return true;
+  }
+  bool exclusive = !str.empty() && str[0] == '(';
+  if (!StreamID::Parse(exclusive ? str.substr(1) : str, is_start ? 0 : UINT64_MAX, id)) {
+    return false;
+  }
+  if (exclusive) {
+    return is_start ? id.Incr() : id.Decr();
+  }
+  return true;
+}
+
+/* parse "MAXLEN|MINID [=|~] threshold" starting at argv[idx], idx is moved past it */
+static bool ParseStreamTrimOptions(const std::vector<StringView> &argv, size_t &idx, bool &by_minid,
+                                   bool &approx, uint64_t &maxlen, StreamID &minid) {
+  by_minid = strcasecmp(argv[idx].c_str(), "minid") == 0;
+  if (!by_minid && strcasecmp(argv[idx].c_str(), "maxlen") != 0) {
+    return false;
+  }
+  ++idx;
+  approx = false;
+  if (idx < argv.size() && (argv[idx] == "=" || argv[idx] == "~")) {
+    approx = argv[idx] == "~";
+    ++idx;
+  }
+  if (idx >= argv.size()) {
+    return false;
+  }
+  bool valid = by_minid ? StreamID::Parse(argv[idx], 0, minid) : CanConvertToUInt64(argv[idx], maxlen);
+  ++idx;
+  return valid;
+}
+
+static uint64_t StreamTrimCommon(KVContainer *holder, AppendableFile *appendable, bool sync,
+                                 const std::string &key, bool by_minid, bool approx,
+                                 uint64_t maxlen, const StreamID &minid, int &errcode) {
+  uint64_t removed = by_minid ? holder->StreamTrimByMinID(key, minid, approx, errcode)
+                              : holder->StreamTrimByLength(key, maxlen, approx, errcode);
+  if (removed > 0) {
+    /* options are synced in a fixed form */
+    AddIntoAppendable(appendable, sync, {"xtrim", key, by_minid ? "MINID" : "MAXLEN",
+                                         approx ? "~" : "=",
+                                         by_minid ? minid.ToString() : std::to_string(maxlen)});
+  }
+  return removed;
+}
+
+static void ReplyStreamEntries(ReplyWriter &reply, const std::vector<StreamEntry> &entries) {
+  reply.ArrayHeader(entries.size());
+  for (const auto &entry : entries) {
+    reply.ArrayHeader(2);
+    reply.Bulk(entry.id.ToString());
+    reply.ArrayHeader(entry.fields.size());
+    for (const auto &field : entry.fields) {
+      reply.Bulk(field);
+    }
+  }
+}
+
+void XAddCommand(__PARAMETERS_LIST) {
+  /* usage: xadd key [NOMKSTREAM] [MAXLEN|MINID [=|~] threshold] *|id field value [field value ...] */
+  const std::vector<StringView> &argv = cmds.argv;
+  bool nomkstream = false, trim = false, by_minid = false, approx = false;
+  uint64_t maxlen = 0;
+  StreamID minid;
+  size_t idx = 2;
+  while (idx < argv.size()) {
+    if (strcasecmp(argv[idx].c_str(), "nomkstream") == 0) {
+      nomkstream = true;
+      ++idx;
+    } else if (strcasecmp(argv[idx].c_str(), "maxlen") == 0 ||
+               strcasecmp(argv[idx].c_str(), "minid") == 0) {
+      if (!ParseStreamTrimOptions(argv, idx, by_minid, approx, maxlen, minid)) {
+        return reply.Error("ERROR", "syntax error");
+      }
+      trim = true;
+    } else {
+      break;
+    }
+  }
+  if (idx >= argv.size() || (argv.size() - idx) < 3 || (argv.size() - idx) % 2 == 0) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'xadd' command");
+  }
+  StreamIDSpec spec;
+  if (!StreamIDSpec::Parse(argv[idx], spec)) {
+    return reply.Error("ERROR", "invalid stream ID specified as stream command argument");
+  }
+  std::vector<std::string> fields(argv.begin() + idx + 1, argv.end());
+  const std::string &key = argv[1];
   int errcode;
-  auto ret = holder->SetGetMemberCount(key, errcode);
+  StreamID id;
+  holder->StreamAdd(key, spec, fields, nomkstream, id, errcode);
+  IfWrongTypeReturn(errcode);
+  IfKeyNotFoundReturn(errcode);
+  IfFailReturn(errcode, reply.Error("ERROR", "the ID specified in xadd is equal or smaller than "
+                                            "the target stream top item"));
+  /* the generated id is synced, so that replaying gives the same entry */
+  std::vector<std::string> synced = {"xadd", key, id.ToString()};
+  synced.insert(synced.end(), fields.begin(), fields.end());
+  AddIntoAppendable(appendable, sync, std::move(synced));
+  if (trim) {
+    StreamTrimCommon(holder, appendable, sync, key, by_minid, approx, maxlen, minid, errcode);
+  }
+  if (params && params->server) {
+    params->server->SignalKeyAsReady(key, true);
+  }
+  return reply.Bulk(id.ToString());
+}
+
+static void StreamRangeCommon(KVContainer *holder, const CommandCache &cmds,
+                              bool reversed, ReplyWriter &reply) {
+  if (cmds.argv.size() != 4 && cmds.argv.size() != 6) {
+    return reply.Error("ERROR", reversed ? "incorrect number of arguments for 'xrevrange' command"
+                                        : "incorrect number of arguments for 'xrange' command");
+  }
+  StreamID start, end;
+  if (!ParseStreamRangeID(cmds.argv[reversed ? 3 : 2], true, start) ||
+      !ParseStreamRangeID(cmds.argv[reversed ? 2 : 3], false, end)) {
+    return reply.Error("ERROR", "invalid stream ID specified as stream command argument");
+  }
+  uint64_t count = 0;
+  if (cmds.argv.size() == 6) {
+    if (strcasecmp(cmds.argv[4].c_str(), "count") != 0) {
+      return reply.Error("ERROR", "syntax error");
+    }
+    if (!CanConvertToUInt64(cmds.argv[5], count)) {
+      return reply.Raw(kInvalidIntegerMsg);
+    }
+    if (count == 0) {
+      return reply.Raw(kArrayEmptyMsg);
+    }
+  }
+  int errcode;
+  auto entries = holder->StreamRange(cmds.argv[1], start, end, count, reversed, errcode);
+  IfWrongTypeReturn(errcode);
+  ReplyStreamEntries(reply, entries);
+}
+
+void XRangeCommand(__PARAMETERS_LIST) {
+  /* usage: xrange key start end [COUNT count] */
+  return StreamRangeCommon(holder, cmds, false, reply);
+}
+
+void XRevRangeCommand(__PARAMETERS_LIST) {
+  /* usage: xrevrange key end start [COUNT count] */
+  return StreamRangeCommon(holder, cmds, true, reply);
+}
+
+void XLenCommand(__PARAMETERS_LIST) {
+  /* usage: xlen key */
+  int errcode;
+  uint64_t len = holder->StreamLength(cmds.argv[1], errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(len);
+}
+
+void XTrimCommand(__PARAMETERS_LIST) {
+  /* usage: xtrim key MAXLEN|MINID [=|~] threshold */
+  if (cmds.argv.size() != 4 && cmds.argv.size() != 5) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'xtrim' command");
+  }
+  bool by_minid, approx;
+  uint64_t maxlen = 0;
+  StreamID minid;
+  size_t idx = 2;
+  if (!ParseStreamTrimOptions(cmds.argv, idx, by_minid, approx, maxlen, minid) ||
+      idx != cmds.argv.size()) {
+    return reply.Error("ERROR", "syntax error");
+  }
+  int errcode;
+  uint64_t removed = StreamTrimCommon(holder, appendable, sync, cmds.argv[1], by_minid, approx,
+                                      maxlen, minid, errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(removed);
+}
+
+void XReadCommand(__PARAMETERS_LIST) {
+  /* usage: xread [COUNT count] [BLOCK milliseconds] STREAMS key [key ...] id [id ...] */
+  const std::vector<StringView> &argv = cmds.argv;
+  uint64_t count = 0, block_ms = 0;
+  bool block = false;
+  size_t idx = 1;
+  for (; idx + 1 < argv.size(); idx += 2) {
+    if (strcasecmp(argv[idx].c_str(), "count") == 0) {
+      if (!CanConvertToUInt64(argv[idx + 1], count)) {
+        return reply.Raw(kInvalidIntegerMsg);
+      }
+    } else if (strcasecmp(argv[idx].c_str(), "block") == 0) {
+      if (!CanConvertToUInt64(argv[idx + 1], block_ms)) {
+        return reply.Error("ERROR", "timeout is not an integer or out of range");
+      }
+      block = true;
+    } else {
+      break;
+    }
+  }
+  if (idx >= argv.size() || strcasecmp(argv[idx].c_str(), "streams") != 0) {
+    return reply.Error("ERROR", "syntax error");
+  }
+  ++idx;
+  size_t n_keys = (argv.size() - idx) / 2;
+  if (n_keys == 0 || (argv.size() - idx) % 2 != 0) {
+    return reply.Error("ERROR", "unbalanced 'xread' list of streams: for each stream key an ID "
+                               "must be specified");
+  }
+  std::vector<std::string> keys(argv.begin() + idx, argv.begin() + idx + n_keys);
+  std::vector<StreamID> after(n_keys);
+  int errcode;
+  for (size_t i = 0; i < n_keys; ++i) {
+    const std::string &id = argv[idx + n_keys + i];
+    if (id == "$") {
+      after[i] = holder->StreamLastID(keys[i], errcode);
+      IfWrongTypeReturn(errcode);
+    } else if (!StreamID::Parse(id, 0, after[i])) {
+      return reply.Error("ERROR", "invalid stream ID specified as stream command argument");
+    }
+  }
+  /* index of the key and its new entries */
+  std::vector<std::pair<size_t, std::vector<StreamEntry>>> replied;
+  for (size_t i = 0; i < n_keys; ++i) {
+    StreamID start = after[i];
+    if (!start.Incr()) {
+      continue;
+    }
+    auto entries = holder->StreamRange(keys[i], start, StreamID::Max(), count, false, errcode);
+    IfWrongTypeReturn(errcode);
+    if (!entries.empty()) {
+      replied.emplace_back(i, std::move(entries));
+    }
+  }
+  if (!replied.empty()) {
+    reply.ArrayHeader(replied.size());
+    for (const auto &item : replied) {
+      reply.ArrayHeader(2);
+      reply.Bulk(keys[item.first]);
+      ReplyStreamEntries(reply, item.second);
+    }
+    return;
+  }
+  if (params && params->unblocking) {
+    return;  /* still nothing new, keep on waiting */
+  }
+  if (!block || sess == nullptr || params == nullptr || params->server == nullptr) {
+    return reply.Raw(kNilArrayMsg);
+  }
+  /* '$' means the entries added from now on, so it is pinned to the current last id */
+  CommandCache blocked = cmds;
+  for (size_t i = 0; i < n_keys; ++i) {
+    blocked.SetArg(idx + n_keys + i, after[i].ToString());
+  }
+  params->server->BlockSession(sess, keys, blocked, block_ms, kNilArrayMsg);
+}
+
+void XRestoreCommand(__PARAMETERS_LIST) {
+  /* usage: xrestore key payload */
+  int errcode;
+  if (!holder->StreamRestore(cmds.argv[1], cmds.argv[2], errcode)) {
+    return reply.Error("ERROR", "invalid stream payload");
+  }
+  AddIntoAppendableDirectly(cmds);
+  if (params && params->server) {
+    params->server->SignalKeyAsReady(cmds.argv[1], true);
+  }
+  return reply.Raw(kOkMsg);
+}
+
+/* parse "RETENTION ms" starting at argv[idx] */
+static bool ParseTSRetention(const std::vector<StringView> &argv, size_t idx,
+                             uint64_t &retention) {
+  return idx + 2 == argv.size() && strcasecmp(argv[idx].c_str(), "retention") == 0 &&
+         CanConvertToUInt64(argv[idx + 1], retention);
+}
+
+/* parse "*" as now or an integer timestamp */
+static bool ParseTSTimestamp(const std::string &str, int64_t &timestamp) {
+  if (str == "*") {
+    timestamp = (int64_t)GetCurrentMs();
+    return true;
+  }
+  return CanConvertToInt64(str, timestamp);
+}
+
+static bool ParseTSValue(const std::string &str, double &value) {
+  return CanConvertToDouble(str, value) && !std::isnan(value);
+}
+
+/* 17 significant digits read back as the same double */
+static std::string FormatTSValue(double value) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.17g", value);
+  return buf;
+}
+
+static void ReplyTSSamples(ReplyWriter &reply, const std::vector<TSSample> &samples) {
+  reply.ArrayHeader(samples.size());
+  for (const auto &sample : samples) {
+    reply.ArrayHeader(2);
+    reply.Int(sample.first);
+    reply.Bulk(FormatTSValue(sample.second));
+  }
+}
+
+/* append a sample and sync it with the resolved timestamp */
+static void TSAddCommon(KVContainer *holder, AppendableFile *appendable, bool sync,
+                        const std::string &key, int64_t timestamp, double value,
+                        uint64_t retention, int &errcode) {
+  if (holder->TSAdd(key, timestamp, value, retention, errcode)) {
+    /* retention is synced as well, it takes effect if the time series is created by replaying */
+    AddIntoAppendable(appendable, sync, {"ts.add", key, std::to_string(timestamp),
+                                         FormatTSValue(value), "RETENTION",
+                                         std::to_string(retention)});
+  }
+}
+
+void TSCreateCommand(__PARAMETERS_LIST) {
+  /* usage: ts.create key [RETENTION ms] */
+  if (cmds.argv.size() != 2 && cmds.argv.size() != 4) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'ts.create' command");
+  }
+  uint64_t retention = 0;
+  if (cmds.argv.size() == 4 && !ParseTSRetention(cmds.argv, 2, retention)) {
+    return reply.Error("ERROR", "syntax error");
+  }
+  int errcode;
+  if (!holder->TSCreate(cmds.argv[1], retention, errcode)) {
+    return reply.Error("ERROR", "key already exists");
+  }
+  AddIntoAppendable(appendable, sync,
+                    {"ts.create", cmds.argv[1], "RETENTION", std::to_string(retention)});
+  return reply.Raw(kOkMsg);
+}
+
+void TSAddCommand(__PARAMETERS_LIST) {
+  /* usage: ts.add key timestamp|* value [RETENTION ms] */
+  if (cmds.argv.size() != 4 && cmds.argv.size() != 6) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'ts.add' command");
+  }
+  int64_t timestamp;
+  double value;
+  uint64_t retention = 0;
+  if (!ParseTSTimestamp(cmds.argv[2], timestamp)) {
+    return reply.Error("ERROR", "invalid timestamp");
+  }
+  if (!ParseTSValue(cmds.argv[3], value)) {
+    return reply.Error("ERROR", "invalid value");
+  }
+  if (cmds.argv.size() == 6 && !ParseTSRetention(cmds.argv, 4, retention)) {
+    return reply.Error("ERROR", "syntax error");
+  }
+  int errcode;
+  TSAddCommon(holder, appendable, sync, cmds.argv[1], timestamp, value, retention, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Error("ERROR", "timestamp must be greater than the last one"));
+  return reply.Int(timestamp);
+}
+
+void TSMAddCommand(__PARAMETERS_LIST) {
+  /* usage: ts.madd key timestamp value [key timestamp value ...] */
+  const std::vector<StringView> &argv = cmds.argv;
+  if (argv.size() < 4 || (argv.size() - 1) % 3 != 0) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'ts.madd' command");
+  }
+  size_t n_samples = (argv.size() - 1) / 3;
+  std::vector<int64_t> timestamps(n_samples);
+  std::vector<double> values(n_samples);
+  for (size_t i = 0; i < n_samples; ++i) {
+    if (!ParseTSTimestamp(argv[i * 3 + 2], timestamps[i])) {
+      return reply.Error("ERROR", "invalid timestamp");
+    }
+    if (!ParseTSValue(argv[i * 3 + 3], values[i])) {
+      return reply.Error("ERROR", "invalid value");
+    }
+  }
+  /* samples are added one by one, the failure of one does not affect the others */
+  reply.ArrayHeader(n_samples);
+  for (size_t i = 0; i < n_samples; ++i) {
+    int errcode;
+    TSAddCommon(holder, appendable, sync, argv[i * 3 + 1], timestamps[i], values[i], 0, errcode);
+    if (errcode == kWrongTypeCode) {
+      reply.Raw(kWrongTypeMsg);
+    } else if (errcode == kFailCode) {
+      reply.Error("ERROR", "timestamp must be greater than the last one");
+    } else {
+      reply.Int(timestamps[i]);
+    }
+  }
+}
+
+void TSGetCommand(__PARAMETERS_LIST) {
+  /* usage: ts.get key */
+  int errcode;
+  TSSample sample;
+  bool found = holder->TSGet(cmds.argv[1], sample, errcode);
+  IfWrongTypeReturn(errcode);
+  IfKeyNotFoundReturn(errcode);
+  if (!found) {
+    return reply.Raw(kArrayEmptyMsg);
+  }
+  reply.ArrayHeader(2);
+  reply.Int(sample.first);
+  reply.Bulk(FormatTSValue(sample.second));
+}
+
+void TSRangeCommand(__PARAMETERS_LIST) {
+  /* usage: ts.range key from|- to|+ [COUNT count] [AGGREGATION avg|min|max|sum|count bucket] */
+  const std::vector<StringView> &argv = cmds.argv;
+  if (argv.size() < 4) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'ts.range' command");
+  }
+  int64_t from = INT64_MIN, to = INT64_MAX;
+  if ((argv[2] != "-" && !CanConvertToInt64(argv[2], from)) ||
+      (argv[3] != "+" && !CanConvertToInt64(argv[3], to))) {
+    return reply.Error("ERROR", "invalid timestamp");
+  }
+  uint64_t count = 0, bucket = 0;
+  int aggregation = kTSAggNone;
+  for (size_t i = 4; i < argv.size(); i += 2) {
+    if (i + 1 >= argv.size()) {
+      return reply.Error("ERROR", "syntax error");
+    }
+    if (strcasecmp(argv[i].c_str(), "count") == 0) {
+      if (!CanConvertToUInt64(argv[i + 1], count)) {
+        return reply.Raw(kInvalidIntegerMsg);
+      }
+    } else if (strcasecmp(argv[i].c_str(), "aggregation") == 0 && i + 2 < argv.size()) {
+      static const char *kAggregations[] = {"avg", "min", "max", "sum", "count"};
+      for (int j = 0; j < 5; ++j) {
+        if (strcasecmp(argv[i + 1].c_str(), kAggregations[j]) == 0) {
+          aggregation = kTSAggAvg + j;
+        }
+      }
+      if (aggregation == kTSAggNone) {
+        return reply.Error("ERROR", "unknown aggregation type");
+      }
+      if (!CanConvertToUInt64(argv[i + 2], bucket) || bucket == 0 || bucket > INT64_MAX) {
+        return reply.Error("ERROR", "bucket duration should be a positive integer");
+      }
+      ++i;
+    } else {
+      return reply.Error("ERROR", "syntax error");
+    }
+  }
+  int errcode;
+  auto samples = aggregation == kTSAggNone
+                     ? holder->TSRange(argv[1], from, to, count, errcode)
+                     : holder->TSAggregate(argv[1], from, to, aggregation, bucket, count, errcode);
+  IfWrongTypeReturn(errcode);
+  ReplyTSSamples(reply, samples);
+}
+
+void TSRestoreCommand(__PARAMETERS_LIST) {
+  /* usage: ts.restore key payload */
+  int errcode;
+  if (!holder->TSRestore(cmds.argv[1], cmds.argv[2], errcode)) {
+    return reply.Error("ERROR", "invalid time series payload");
+  }
+  AddIntoAppendableDirectly(cmds);
+  return reply.Raw(kOkMsg);
+}
+
+/* parse "VALUES dim v1 v2 ..." starting at argv[idx], idx is moved past the values */
+static bool ParseVecValues(const std::vector<StringView> &argv, size_t &idx,
+                           std::vector<float> &vec) {
+  uint64_t dim;
+  if (idx + 2 > argv.size() || strcasecmp(argv[idx].c_str(), "values") != 0 ||
+      !CanConvertToUInt64(argv[idx + 1], dim) || dim == 0 || dim > kVecMaxDim ||
+      dim > argv.size() - idx - 2) {
+    return false;
+  }
+  idx += 2;
+  vec.resize(dim);
+  for (uint64_t i = 0; i < dim; ++i, ++idx) {
+    double value;
+    if (!CanConvertToDouble(argv[idx], value) || !std::isfinite((float)value)) {
+      return false;
+    }
+    vec[i] = (float)value;
+  }
+  return true;
+}
+
+/* 9 significant digits read back as the same float */
+static std::string FormatVecValue(float value) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.9g", value);
+  return buf;
+}
+
+void VAddCommand(__PARAMETERS_LIST) {
+  /* usage: vadd key [METRIC L2|IP|COSINE] [Q8] VALUES dim v1 v2 ... element */
+  const std::vector<StringView> &argv = cmds.argv;
+  int metric = kVecMetricL2;
+  bool quantized = false;
+  size_t idx = 2;
+  for (; idx < argv.size() && strcasecmp(argv[idx].c_str(), "values") != 0; ++idx) {
+    if (strcasecmp(argv[idx].c_str(), "metric") == 0 && idx + 1 < argv.size()) {
+      metric = VecMetricFromName(argv[++idx]);
+      if (metric < 0) {
+        return reply.Error("ERROR", "unknown metric");
+      }
+    } else if (strcasecmp(argv[idx].c_str(), "q8") == 0) {
+      quantized = true;
+    } else {
+      return reply.Error("ERROR", "syntax error");
+    }
+  }
+  std::vector<float> vec;
+  if (!ParseVecValues(argv, idx, vec)) {
+    return reply.Error("ERROR", "invalid vector");
+  }
+  if (idx + 1 != argv.size()) {
+    return reply.Error("ERROR", "incorrect number of arguments for 'vadd' command");
+  }
+  int errcode;
+  bool added = holder->VAdd(argv[1], argv[idx], vec, metric, quantized, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Error("ERROR", "vector dimension does not match"));
+  /* metric and quantization only take effect if the vector set is created by replaying */
+  std::vector<std::string> synced{"vadd", argv[1], "METRIC", VecMetricName(metric),
+                                  quantized ? "Q8" : "NOQUANT", "VALUES",
+                                  std::to_string(vec.size())};
+  for (float value : vec) {
+    synced.emplace_back(FormatVecValue(value));
+  }
+  synced.emplace_back(argv[idx]);
+  AddIntoAppendable(appendable, sync, std::move(synced));
+  return reply.Int(added ? 1 : 0);
+}
+
+void VRemCommand(__PARAMETERS_LIST) {
+  /* usage: vrem key element */
+  int errcode;
+  bool removed = holder->VRem(cmds.argv[1], cmds.argv[2], errcode);
   IfWrongTypeReturn(errcode);
-  return PackIntReply(ret);
+  if (removed) {
+    AddIntoAppendableDirectly(cmds);
+  }
+  return reply.Int(removed ? 1 : 0);
+}
+
+void VSimCommand(__PARAMETERS_LIST) {
+  /* usage: vsim key VALUES dim v1 v2 ... [COUNT k] [EF ef] [WITHSCORES] */
+  const std::vector<StringView> &argv = cmds.argv;
+  size_t idx = 2;
+  std::vector<float> query;
+  if (!ParseVecValues(argv, idx, query)) {
+    return reply.Error("ERROR", "invalid vector");
+  }
+  uint64_t count = 10, ef = kVecDefaultEf;
+  bool with_scores = false;
+  for (; idx < argv.size(); ++idx) {
+    if (strcasecmp(argv[idx].c_str(), "withscores") == 0) {
+      with_scores = true;
+    } else if (strcasecmp(argv[idx].c_str(), "count") == 0 && idx + 1 < argv.size()) {
+      if (!CanConvertToUInt64(argv[++idx], count)) {
+        return reply.Raw(kInvalidIntegerMsg);
+      }
+    } else if (strcasecmp(argv[idx].c_str(), "ef") == 0 && idx + 1 < argv.size()) {
+      if (!CanConvertToUInt64(argv[++idx], ef) || ef == 0) {
+        return reply.Error("ERROR", "ef should be a positive integer");
+      }
+    } else {
+      return reply.Error("ERROR", "syntax error");
+    }
+  }
+  int errcode;
+  auto matches = holder->VSim(argv[1], query, count, ef, errcode);
+  IfWrongTypeReturn(errcode);
+  IfFailReturn(errcode, reply.Error("ERROR", "vector dimension does not match"));
+  reply.ArrayHeader(with_scores ? matches.size() * 2 : matches.size());
+  for (const auto &match : matches) {
+    reply.Bulk(match.first);
+    if (with_scores) {
+      reply.Bulk(FormatVecValue(match.second));
+    }
+  }
+}
+
+void VCardCommand(__PARAMETERS_LIST) {
+  /* usage: vcard key */
+  int errcode;
+  uint64_t count = holder->VCard(cmds.argv[1], errcode);
+  IfWrongTypeReturn(errcode);
+  return reply.Int(count);
+}
+
+void VDimCommand(__PARAMETERS_LIST) {
+  /* usage: vdim key */
+  int errcode;
+  uint32_t dim = holder->VDim(cmds.argv[1], errcode);
+  IfWrongTypeReturn(errcode);
+  IfKeyNotFoundReturn(errcode);
+  return reply.Int(dim);
 }
 
-std::string SPopCommand(__PARAMETERS_LIST) {
-  return kNotSupportedYetMsg; 
+void VEmbCommand(__PARAMETERS_LIST) {
+  /* usage: vemb key element */
+  int errcode;
+  std::vector<float> vec;
+  bool found = holder->VEmb(cmds.argv[1], cmds.argv[2], vec, errcode);
+  IfWrongTypeReturn(errcode);
+  if (!found) {
+    return reply.Raw(kNilMsg);
+  }
+  reply.ArrayHeader(vec.size());
+  for (float value : vec) {
+    reply.Bulk(FormatVecValue(value));
+  }
 }
 
-std::string PackPublishMessage(const std::string& chan_name, const std::string& message) {
-  std::stringstream ss;
-  ss << "*3\r\n"
-    << "$7\r\n"
-    << "message\r\n"
-    << '$' << chan_name.size() << kCRLF
-    << chan_name << kCRLF
-    << '$' << message.size() << kCRLF
-    << message << kCRLF;
+void VRestoreCommand(__PARAMETERS_LIST) {
+  /* usage: vrestore key payload */
+  int errcode;
+  if (!holder->VRestore(cmds.argv[1], cmds.argv[2], errcode)) {
+    return reply.Error("ERROR", "invalid vector set payload");
+  }
+  AddIntoAppendableDirectly(cmds);
+  return reply.Raw(kOkMsg);
+}
 
-  return ss.str();
+static void ReplyPublishMessage(ReplyWriter &reply, const StringView &chan_name, const StringView &message) {
+  reply.ArrayHeader(3);
+  reply.Bulk("message", 7);
+  reply.Bulk(chan_name.data(), chan_name.size());
+  reply.Bulk(message.data(), message.size());
 }
 
-std::string PubSubPublishCommand(__PARAMETERS_LIST) {
+void PubSubPublishCommand(__PARAMETERS_LIST) {
   /* usage: publish channel message */
   assert(params->server != nullptr);
-  CheckSyntaxHelper(cmds, 1, 1, false, 'publish');
-  const std::string &channel = cmds.argv[1];
-  const std::string& message = cmds.argv[2];
+  const StringView &channel = cmds.argv[1];
+  const StringView &message = cmds.argv[2];
   if (params->server->HasSubscriptionChannel(channel)) { /* has corresponding channel */
-    /* relay message to all sessions that subscribed to this channel */
+    /* relay message to all sessions that subscribed to this channel, it is packed only once */
+    Buffer relay;
+    ReplyWriter relay_writer(relay);
+    ReplyPublishMessage(relay_writer, channel, message);
     size_t count = 0;
     for (auto&& sess_ptr: params->server->GetSubscriptionSessions(channel)) {
-      const std::string &relay_str = PackPublishMessage(channel, message);
       // FIXME BUG: session do not clean thoroughly, have remaining data in write buffer
-      size_t nbytes = WriteFromBuf(sess_ptr->fd, relay_str.c_str(), relay_str.size());  /* write message directly to session client */
-      if (nbytes == relay_str.size()) {
+      size_t nbytes = WriteFromBuf(sess_ptr->fd, relay.BeginRead(), relay.ReadableBytes());  /* write message directly to session client */
+      if (nbytes == relay.ReadableBytes()) {
         count ++;
       }
     }
-    return PackIntReply(count);
+    return reply.Int(count);
   }
-  return kInt0Msg;
+  return reply.Raw(kInt0Msg);
 }
 
-void PackSubscriptionResArrayIntoStream(std::stringstream& ss, const char* cmd_name, const std::string& chan_name, size_t num, bool fill_minus_1 = false) {
-  /* pack format => *3\r\n${len(cmd_name)}\r\n{cmd_name}\r\n${len(chan_name)}\r\n{chan_name}\r\n:{num}\r\n */
-  ss << "*3\r\n"
-    << '$' << strlen(cmd_name) << kCRLF
-    << cmd_name << kCRLF;
+static void ReplySubscription(ReplyWriter &reply, const char* cmd_name, const std::string& chan_name, size_t num, bool fill_minus_1 = false) {
+  /* reply format => *3\r\n${len(cmd_name)}\r\n{cmd_name}\r\n${len(chan_name)}\r\n{chan_name}\r\n:{num}\r\n */
+  reply.ArrayHeader(3);
+  reply.Bulk(cmd_name, strlen(cmd_name));
   if (!fill_minus_1) {
-    ss << '$' << chan_name.size() << kCRLF
-      << chan_name << kCRLF;
+    reply.Bulk(chan_name);
   } else {
-    ss << "$-1" << kCRLF;
+    reply.Nil();
   }
-  ss << ':' << num << kCRLF;
+  reply.Int(num);
 }
 
-std::string PubSubSubscribeCommand(__PARAMETERS_LIST) {
+void PubSubSubscribeCommand(__PARAMETERS_LIST) {
   /* usage: subscribe chan1 chan2 ... */
   assert(params->server != nullptr);
   assert(sess != nullptr);
-  CheckSyntaxHelper(cmds, -1, -1, false, 'subscribe');
   /* use server instance to add subscription */
-  const std::vector<std::string>& channels = cmds.argv;
-  std::stringstream ss;
+  const std::vector<StringView>& channels = cmds.argv;
   for (size_t i = 1; i < channels.size(); ++i) {
     sess->subscribed_channels.insert(channels[i]); /* if exists, then override the old one */
     sess->SetPubSubMode();
     params->server->AddSessionToSubscription(channels[i], sess);
-    PackSubscriptionResArrayIntoStream(ss, "subscribe", channels[i], sess->subscribed_channels.size());
+    ReplySubscription(reply, "subscribe", channels[i], sess->subscribed_channels.size());
   }
-  return ss.str();
 }
 
-std::string PubSubUnsubscribeCommand(__PARAMETERS_LIST) {
+void PubSubUnsubscribeCommand(__PARAMETERS_LIST) {
   /* usage: unsubscribe chan1 chan2 ... */
   assert(params->server != nullptr);
   assert(sess != nullptr);
-  CheckSyntaxHelper(cmds, -2, -1, false, 'unsubscribe');
-  //  const std::vector<std::string>& channels = cmds.argv;
+  //  const std::vector<StringView>& channels = cmds.argv;
   std::vector<std::string> channels;
   if (cmds.argv.size() >= 2) {  /* unsubscribe the specified channels */
     channels.reserve(cmds.argv.size());
@@ -1039,26 +3084,24 @@ std::string PubSubUnsubscribeCommand(__PARAMETERS_LIST) {
     channels.reserve(sess->subscribed_channels.size());
     channels.assign(sess->subscribed_channels.begin(), sess->subscribed_channels.end());
   }
-  std::stringstream ss;
   if (channels.empty()) {
     /* no channels need to unsubscribe */
-    PackSubscriptionResArrayIntoStream(ss, "unsubscribe", "", 0, true);
+    ReplySubscription(reply, "unsubscribe", "", 0, true);
   } else {
     for (auto&& ch : channels) {
       sess->subscribed_channels.erase(ch);
       sess->UnsetPubSubMode();
       params->server->RemoveSessionFromSubscription(ch, sess);
-      PackSubscriptionResArrayIntoStream(ss,"unsubscribe", ch, sess->subscribed_channels.size(), false);
+      ReplySubscription(reply, "unsubscribe", ch, sess->subscribed_channels.size(), false);
     }
   }
-  return ss.str();
 }
 
-std::string SaveCommand(__PARAMETERS_LIST) { return ""; }
+void SaveCommand(__PARAMETERS_LIST) {}
 
-std::string BgsaveCommand(__PARAMETERS_LIST) {
-  CheckSyntaxHelper(cmds, 0, 0, false, 'bgsave');
-  return LiteKVBackgroundSave(config->GetLkvdbDumpFilename(), params->server, holder)
-             ? PackStringMsgReply("Background saving started")
-             : PackStringMsgReply("Background saving failed starting");
+void BgsaveCommand(__PARAMETERS_LIST) {
+  if (LiteKVBackgroundSave(config->GetLkvdbDumpFilename(), params->server, holder)) {
+    return reply.Status("Background saving started");
+  }
+  return reply.Status("Background saving failed starting");
 }
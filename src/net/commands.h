@@ -11,6 +11,7 @@
 #include "buffer.h"
 #include "net.h"
 #include "server.h"
+#include "reply.h"
 
 static constexpr std::array<const char *, 3> kErrStrTable{"WRONGREQ",
                                                       "WRONGTYPE",
@@ -26,6 +27,7 @@ static const char *kCRLF = "\r\n";
 #define kIntMinus2Msg ":-2\r\n"
 #define kIntMinus1Msg ":-1\r\n"
 #define kNilMsg "$-1\r\n"
+#define kNilArrayMsg "*-1\r\n"
 #define kOkMsg "+OK\r\n"
 #define kPONGMsg "+PONG\r\n"
 #define kArrayEmptyMsg "*0\r\n"
@@ -44,10 +46,28 @@ class AppendableFile;         /* in persistence.h */
 class KVContainer;            /* in core.h */
 
 /* the parameters list for `CommandHandler` function */
-#define PARAMETERS_LIST EventLoop *, KVContainer *, AppendableFile *, const CommandCache &, bool, Config*, Session*, OptionalHandlerParams*
+#define PARAMETERS_LIST EventLoop *, KVContainer *, AppendableFile *, const CommandCache &, bool, Config*, Session*, OptionalHandlerParams*, ReplyWriter &
 
 /* Not all CommandHandler function instance use all parameters */
-typedef std::string (*CommandHandler)(PARAMETERS_LIST);
+typedef void (*CommandHandler)(PARAMETERS_LIST);
+
+/* flags of commands */
+static constexpr int CMD_WRITE = 1 << 0;         /* may change the dataset, which is synced into appendable file */
+static constexpr int CMD_READONLY = 1 << 1;      /* only reads the dataset */
+static constexpr int CMD_FAST = 1 << 2;          /* takes constant or logarithmic time */
+static constexpr int CMD_PUBSUB = 1 << 3;        /* publishes or subscribes channels */
+static constexpr int CMD_MOVABLE_KEYS = 1 << 4;  /* key positions depend on other arguments */
+
+/* static description of one command */
+struct CommandSpec {
+  const char *name;  /* in lower case */
+  CommandHandler handler;
+  int arity;      /* number of arguments including the name, -n for n at least */
+  int first_key;  /* position of the first key, 0 if there is no key */
+  int last_key;   /* position of the last key, negative counts back from the end */
+  int key_step;   /* distance between two keys */
+  int flags;
+};
 
 class Engine {
 public:
@@ -65,9 +85,12 @@ public:
    * Handle the command coming in.
    * @param loop The main event loop.
    * @param cmds The command to be handled.
+   * @param reply Writer of the reply, nothing is written if the command blocks.
    * @param sync Synchronize this command to file or not.
-   * @return Reply string.
    */
+  void HandleCommand(EventLoop *loop, CommandCache &cmds, ReplyWriter &reply, bool sync = true, Session* sess = nullptr, OptionalHandlerParams* options = nullptr);
+
+  /* handle the command and return its reply, for replies which are not written to a session right away */
   std::string HandleCommand(EventLoop *loop, CommandCache &cmds, bool sync = true, Session* sess = nullptr, OptionalHandlerParams* options = nullptr);
 
   /**
@@ -77,7 +100,25 @@ public:
    */
   static bool OpCodeValid(const std::string &opcode);
 
-  bool RestoreFromAppendableFile(EventLoop *loop, AppendableFile *history);
+  /* the command named name in any case, nullptr if there is no such command */
+  static const CommandSpec *LookupCommand(const StringView &name);
+
+  /* look up the command of cmds and replace its name with the one in lower case */
+  static const CommandSpec *ResolveCommand(CommandCache &cmds);
+
+  static inline bool ArityMatches(const CommandSpec *spec, size_t argc) {
+    return spec->arity >= 0 ? argc == (size_t) spec->arity : argc >= (size_t) -spec->arity;
+  }
+
+  /* positions of the keys in argc arguments, the ones of CMD_MOVABLE_KEYS commands are left out */
+  static void KeyPositions(const CommandSpec *spec, size_t argc, std::vector<size_t> &keys);
+
+  /**
+   * Restore database from the commands in history, which is also used for appending later.
+   * @param filter Only the commands passing filter are restored if it is set.
+   */
+  bool RestoreFromAppendableFile(EventLoop *loop, AppendableFile *history,
+                                 const std::function<bool(CommandCache &)> &filter = nullptr);
 
 private:
   bool IfNeedKeyEviction();
@@ -88,121 +129,288 @@ private:
   KVContainer *container_ = nullptr;  /* not owned */
   AppendableFile *appending_ = nullptr; /* not owned */
   Config *config_ = nullptr;  /* not owned */
-  static std::unordered_map<std::string, CommandHandler> sOpCommandMap;
-  size_t cur_vm_size_;
-  size_t cur_rss_size_;
+  size_t cur_vm_size_ = 0;
+  size_t cur_rss_size_ = 0;
   std::thread worker_;
-  std::atomic<bool> stopped_;
+  std::atomic<bool> stopped_{false};
 };
 
+/* parse the timeout of blocking list commands in seconds, 0 means blocking forever */
+bool ParseBlockingTimeout(const std::string &str, uint64_t &timeout_ms);
+
 /* generic command */
-std::string OverviewCommand(PARAMETERS_LIST);
+void OverviewCommand(PARAMETERS_LIST);
 
-std::string NumItemsCommand(PARAMETERS_LIST);
+void NumItemsCommand(PARAMETERS_LIST);
 
-std::string PingCommand(PARAMETERS_LIST);
+void PingCommand(PARAMETERS_LIST);
 
-std::string EvictCommand(PARAMETERS_LIST);
+void EvictCommand(PARAMETERS_LIST);
 
-std::string DelCommand(PARAMETERS_LIST);
+void DelCommand(PARAMETERS_LIST);
 
-std::string ExistsCommand(PARAMETERS_LIST);
+void ExistsCommand(PARAMETERS_LIST);
 
-std::string TypeCommand(PARAMETERS_LIST);
+void TypeCommand(PARAMETERS_LIST);
 
-std::string ExpireCommand(PARAMETERS_LIST);
+void ExpireCommand(PARAMETERS_LIST);
 
-std::string ExpireAtCommand(PARAMETERS_LIST);
+void ExpireAtCommand(PARAMETERS_LIST);
 
-std::string TTLCommand(PARAMETERS_LIST);
+void TTLCommand(PARAMETERS_LIST);
 
 /* int or string command */
-std::string SetCommand(PARAMETERS_LIST);
+void SetCommand(PARAMETERS_LIST);
 
-std::string GetCommand(PARAMETERS_LIST);
+void GetCommand(PARAMETERS_LIST);
 
 /* int command */
-std::string IncrCommand(PARAMETERS_LIST);
+void IncrCommand(PARAMETERS_LIST);
 
-std::string DecrCommand(PARAMETERS_LIST);
+void DecrCommand(PARAMETERS_LIST);
 
-std::string IncrByCommand(PARAMETERS_LIST);
+void IncrByCommand(PARAMETERS_LIST);
 
-std::string DecrByCommand(PARAMETERS_LIST);
+void DecrByCommand(PARAMETERS_LIST);
 
 /* string command */
-std::string StrlenCommand(PARAMETERS_LIST);
+void StrlenCommand(PARAMETERS_LIST);
+
+void AppendCommand(PARAMETERS_LIST);
+
+void GetRangeCommand(PARAMETERS_LIST);
 
-std::string AppendCommand(PARAMETERS_LIST);
+void SetRangeCommand(PARAMETERS_LIST);
 
-std::string GetRangeCommand(PARAMETERS_LIST);
+/* bitmap command */
+void SetBitCommand(PARAMETERS_LIST);
 
-std::string SetRangeCommand(PARAMETERS_LIST);
+void GetBitCommand(PARAMETERS_LIST);
+
+void BitCountCommand(PARAMETERS_LIST);
+
+void BitPosCommand(PARAMETERS_LIST);
+
+void BitOpCommand(PARAMETERS_LIST);
 
 /* list command */
-std::string LLenCommand(PARAMETERS_LIST);
+void LLenCommand(PARAMETERS_LIST);
+
+void LPopCommand(PARAMETERS_LIST);
+
+void LPushCommand(PARAMETERS_LIST);
+
+void RPopCommand(PARAMETERS_LIST);
 
-std::string LPopCommand(PARAMETERS_LIST);
+void RPushCommand(PARAMETERS_LIST);
 
-std::string LPushCommand(PARAMETERS_LIST);
+void LRangeCommand(PARAMETERS_LIST);
 
-std::string RPopCommand(PARAMETERS_LIST);
+void LInsertCommand(PARAMETERS_LIST);
 
-std::string RPushCommand(PARAMETERS_LIST);
+void LRemCommand(PARAMETERS_LIST);
 
-std::string LRangeCommand(PARAMETERS_LIST);
+void LTrimCommand(PARAMETERS_LIST);
 
-std::string LInsertCommand(PARAMETERS_LIST);
+void LSetCommand(PARAMETERS_LIST);
 
-std::string LRemCommand(PARAMETERS_LIST);
+void LIndexCommand(PARAMETERS_LIST);
 
-std::string LSetCommand(PARAMETERS_LIST);
+void LMoveCommand(PARAMETERS_LIST);
 
-std::string LIndexCommand(PARAMETERS_LIST);
+void BLPopCommand(PARAMETERS_LIST);
+
+void BRPopCommand(PARAMETERS_LIST);
+
+void BLMoveCommand(PARAMETERS_LIST);
 
 /* hash command */
-std::string HSetCommand(PARAMETERS_LIST);
+void HSetCommand(PARAMETERS_LIST);
+
+void HGetCommand(PARAMETERS_LIST);
+
+void HDelCommand(PARAMETERS_LIST);
+
+void HExistsCommand(PARAMETERS_LIST);
 
-std::string HGetCommand(PARAMETERS_LIST);
+void HGetAllCommand(PARAMETERS_LIST);
 
-std::string HDelCommand(PARAMETERS_LIST);
+void HKeysCommand(PARAMETERS_LIST);
 
-std::string HExistsCommand(PARAMETERS_LIST);
+void HValsCommand(PARAMETERS_LIST);
 
-std::string HGetAllCommand(PARAMETERS_LIST);
+void HLenCommand(PARAMETERS_LIST);
 
-std::string HKeysCommand(PARAMETERS_LIST);
+void HIncrByCommand(PARAMETERS_LIST);
 
-std::string HValsCommand(PARAMETERS_LIST);
+void HIncrByFloatCommand(PARAMETERS_LIST);
 
-std::string HLenCommand(PARAMETERS_LIST);
+void HSetNXCommand(PARAMETERS_LIST);
+
+void HMGetCommand(PARAMETERS_LIST);
+
+void HExpireCommand(PARAMETERS_LIST);
+
+void HPExpireCommand(PARAMETERS_LIST);
+
+void HPExpireAtCommand(PARAMETERS_LIST);
+
+void HTTLCommand(PARAMETERS_LIST);
+
+void HPTTLCommand(PARAMETERS_LIST);
+
+void HPersistCommand(PARAMETERS_LIST);
 
 /* set commands */
-std::string SAddCommand(PARAMETERS_LIST);
+void SAddCommand(PARAMETERS_LIST);
+
+void SIsMemberCommand(PARAMETERS_LIST);
+
+void SMIsMemberCommand(PARAMETERS_LIST);
+
+void SMembersCommand(PARAMETERS_LIST);
+
+void SRemCommand(PARAMETERS_LIST);
+
+void SCardCommand(PARAMETERS_LIST);
+
+void SPopCommand(PARAMETERS_LIST);
+
+void SRandMemberCommand(PARAMETERS_LIST);
+
+void SInterCommand(PARAMETERS_LIST);
+
+void SUnionCommand(PARAMETERS_LIST);
+
+void SDiffCommand(PARAMETERS_LIST);
+
+void SInterCardCommand(PARAMETERS_LIST);
+
+void SInterStoreCommand(PARAMETERS_LIST);
+
+void SUnionStoreCommand(PARAMETERS_LIST);
+
+void SDiffStoreCommand(PARAMETERS_LIST);
+
+/* sorted set commands */
+void ZAddCommand(PARAMETERS_LIST);
+
+void ZIncrByCommand(PARAMETERS_LIST);
+
+void ZScoreCommand(PARAMETERS_LIST);
+
+void ZRemCommand(PARAMETERS_LIST);
+
+void ZCardCommand(PARAMETERS_LIST);
+
+void ZRankCommand(PARAMETERS_LIST);
+
+void ZRangeCommand(PARAMETERS_LIST);
+
+void ZRangeByScoreCommand(PARAMETERS_LIST);
+
+void ZPopMinCommand(PARAMETERS_LIST);
+
+/* hyperloglog commands */
+void PfAddCommand(PARAMETERS_LIST);
+
+void PfCountCommand(PARAMETERS_LIST);
+
+void PfMergeCommand(PARAMETERS_LIST);
+
+void PfRestoreCommand(PARAMETERS_LIST);
+
+/* count-min sketch commands */
+void CMSInitByDimCommand(PARAMETERS_LIST);
+
+void CMSIncrByCommand(PARAMETERS_LIST);
+
+void CMSQueryCommand(PARAMETERS_LIST);
+
+void CMSMergeCommand(PARAMETERS_LIST);
+
+void CMSRestoreCommand(PARAMETERS_LIST);
+
+/* top-k commands */
+void TopKReserveCommand(PARAMETERS_LIST);
+
+void TopKAddCommand(PARAMETERS_LIST);
+
+void TopKIncrByCommand(PARAMETERS_LIST);
+
+void TopKQueryCommand(PARAMETERS_LIST);
+
+void TopKListCommand(PARAMETERS_LIST);
+
+void TopKRestoreCommand(PARAMETERS_LIST);
+
+/* bloom filter commands */
+void BFReserveCommand(PARAMETERS_LIST);
+
+void BFAddCommand(PARAMETERS_LIST);
+
+void BFMAddCommand(PARAMETERS_LIST);
+
+void BFExistsCommand(PARAMETERS_LIST);
+
+void BFMExistsCommand(PARAMETERS_LIST);
+
+void BFRestoreCommand(PARAMETERS_LIST);
+
+/* stream commands */
+void XAddCommand(PARAMETERS_LIST);
+
+void XRangeCommand(PARAMETERS_LIST);
+
+void XRevRangeCommand(PARAMETERS_LIST);
+
+void XLenCommand(PARAMETERS_LIST);
+
+void XTrimCommand(PARAMETERS_LIST);
+
+void XReadCommand(PARAMETERS_LIST);
+
+void XRestoreCommand(PARAMETERS_LIST);
+
+/* time series commands */
+void TSCreateCommand(PARAMETERS_LIST);
+
+void TSAddCommand(PARAMETERS_LIST);
+
+void TSMAddCommand(PARAMETERS_LIST);
+
+void TSGetCommand(PARAMETERS_LIST);
+
+void TSRangeCommand(PARAMETERS_LIST);
+
+void TSRestoreCommand(PARAMETERS_LIST);
+
+/* vector set commands */
+void VAddCommand(PARAMETERS_LIST);
 
-std::string SIsMemberCommand(PARAMETERS_LIST);
+void VRemCommand(PARAMETERS_LIST);
 
-std::string SMIsMemberCommand(PARAMETERS_LIST);
+void VSimCommand(PARAMETERS_LIST);
 
-std::string SMembersCommand(PARAMETERS_LIST);
+void VCardCommand(PARAMETERS_LIST);
 
-std::string SRemCommand(PARAMETERS_LIST);
+void VDimCommand(PARAMETERS_LIST);
 
-std::string SCardCommand(PARAMETERS_LIST);
+void VEmbCommand(PARAMETERS_LIST);
 
-std::string SPopCommand(PARAMETERS_LIST);
+void VRestoreCommand(PARAMETERS_LIST);
 
 /*　pub/sub commands */
-std::string PubSubPublishCommand(PARAMETERS_LIST);
+void PubSubPublishCommand(PARAMETERS_LIST);
 
-std::string PubSubSubscribeCommand(PARAMETERS_LIST);
+void PubSubSubscribeCommand(PARAMETERS_LIST);
 
-std::string PubSubUnsubscribeCommand(PARAMETERS_LIST);
+void PubSubUnsubscribeCommand(PARAMETERS_LIST);
 
 /* save database commands */
-std::string SaveCommand(PARAMETERS_LIST);
+void SaveCommand(PARAMETERS_LIST);
 
-std::string BgsaveCommand(PARAMETERS_LIST);
+void BgsaveCommand(PARAMETERS_LIST);
 
 #undef PARAMETERS_LIST
 
@@ -0,0 +1,66 @@
+#include "iothreads.h"
+
+IOThreadPool::IOThreadPool(int n_threads) : n_threads_(n_threads < 1 ? 1 : n_threads) {
+  for (int id = 1; id < n_threads_; ++id) {
+    threads_.emplace_back(&IOThreadPool::Work, this, id);
+  }
+}
+
+IOThreadPool::~IOThreadPool() {
+  {
+    std::lock_guard<std::mutex> lck(mtx_);
+    stopped_ = true;
+  }
+  cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void IOThreadPool::Run(const std::vector<Session *> &sessions, IOJobFunc job) {
+  /* waking up threads costs more than doing a few sessions directly */
+  if (n_threads_ == 1 || sessions.size() < (size_t)n_threads_ * 2) {
+    for (Session *session : sessions) {
+      job(session);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lck(mtx_);
+    sessions_ = &sessions;
+    job_ = job;
+    n_working_.store(n_threads_ - 1, std::memory_order_relaxed);
+    ++round_;
+  }
+  cv_.notify_all();
+  RunShare(0);
+  /* the other shares are about as large as ours, they are done soon */
+  while (n_working_.load(std::memory_order_acquire) != 0) {
+    std::this_thread::yield();
+  }
+  sessions_ = nullptr;
+  job_ = nullptr;
+}
+
+void IOThreadPool::Work(int id) {
+  uint64_t done_round = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lck(mtx_);
+      cv_.wait(lck, [&] { return stopped_ || round_ != done_round; });
+      if (stopped_) {
+        return;
+      }
+      done_round = round_;
+    }
+    RunShare(id);
+    n_working_.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+void IOThreadPool::RunShare(int id) {
+  const std::vector<Session *> &sessions = *sessions_;
+  for (size_t i = id; i < sessions.size(); i += n_threads_) {
+    job_(sessions[i]);
+  }
+}
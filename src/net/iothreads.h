@@ -0,0 +1,63 @@
+#ifndef __IOTHREADS_H__
+#define __IOTHREADS_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "net.h"
+
+/* the job done by io threads on every session */
+typedef void (*IOJobFunc)(Session *);
+
+/**
+ * Threads for socket reads, request parsing and reply writes. The main thread hands out a batch of
+ * sessions, takes its own share of the batch and waits until the other threads finish theirs.
+ * Commands are never executed by io threads, so the main thread is the only one touching the
+ * data structures. While a batch is running the main thread does nothing else, so every session
+ * is accessed by one thread at a time.
+ */
+class IOThreadPool {
+public:
+  /* n_threads includes the main thread, no thread is started if it is 1 */
+  explicit IOThreadPool(int n_threads);
+
+  ~IOThreadPool();
+
+  IOThreadPool(const IOThreadPool &) = delete;
+
+  IOThreadPool &operator=(const IOThreadPool &) = delete;
+
+  inline int NumThreads() const { return n_threads_; }
+
+  /**
+   * Run job on every session and return when all are done. Sessions are spread over threads by
+   * their index in sessions, a small batch is done by the main thread alone.
+   */
+  void Run(const std::vector<Session *> &sessions, IOJobFunc job);
+
+private:
+  void Work(int id);
+
+  /* run job on the share of sessions of thread id */
+  void RunShare(int id);
+
+private:
+  int n_threads_;
+  std::vector<std::thread> threads_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  /* batch of current round, set before round_ is increased */
+  const std::vector<Session *> *sessions_ = nullptr;
+  IOJobFunc job_ = nullptr;
+  uint64_t round_ = 0;
+  bool stopped_ = false;
+  /* number of io threads still working on current round */
+  std::atomic<int> n_working_{0};
+};
+
+#endif  // __IOTHREADS_H__
@@ -0,0 +1,78 @@
+#ifndef __MAILBOX_H__
+#define __MAILBOX_H__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/**
+ * Bounded lock-free queue with a single producer thread and a single consumer thread. Each side
+ * keeps a cached copy of the other side's index, so the shared indices are only read again when
+ * the queue looks full or empty.
+ */
+template <typename T>
+class SpscQueue {
+public:
+  /* capacity is rounded up to a power of 2 */
+  explicit SpscQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    slots_.reset(new T[size]);
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  inline size_t Capacity() const { return mask_ + 1; }
+
+  /* called by the producer, return false if the queue is full */
+  bool TryPush(T &&item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ > mask_) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /* called by the consumer, return false if the queue is empty */
+  bool TryPop(T &item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) {
+        return false;
+      }
+    }
+    item = std::move(slots_[head & mask_]);
+    slots_[head & mask_] = T();
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  static constexpr size_t kCacheLine = 64;
+
+  size_t mask_;
+  std::unique_ptr<T[]> slots_;
+  /* the two sides are padded apart, so that they do not share a cache line */
+  char pad0_[kCacheLine];
+  /* written by the consumer */
+  std::atomic<size_t> head_{0};
+  size_t tail_cache_ = 0;
+  char pad1_[kCacheLine];
+  /* written by the producer */
+  std::atomic<size_t> tail_{0};
+  size_t head_cache_ = 0;
+};
+
+#endif  // __MAILBOX_H__
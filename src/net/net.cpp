@@ -1,8 +1,19 @@
+#include <cerrno>
+#include <climits>
 #include <iostream>
 #include <memory>
+#include <netinet/in.h>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include "net.h"
+#include "uring.h"
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define NET_ZEROCOPY
+#endif
 
 EventLoop::EventLoop() :
     epoller(new (std::nothrow) Epoller(1024)),
@@ -34,9 +45,12 @@ void EventLoop::Loop() {
   if (epoller == nullptr) {
     return;
   }
-  static int debug_n = 1;
+  static thread_local int debug_n = 1;
   // std::cout << "Event loop working...\n";
   while (!stopped) {
+    if (before_poll) {
+      before_poll();
+    }
     // TODO change optimize timeout ms
     uint64_t ms = tev_holder->HowLongTillNextFired();
     int ready = epoller->Wait(ms);
@@ -51,6 +65,12 @@ void EventLoop::Loop() {
         continue;
       }
       bool closed = false;  /*　flag to indicate whether session is freed to avoid memory issue */
+      if ((fired_events & EPOLLERR) && session->error_proc) {
+        session->error_proc(session, closed);
+        if (closed) {
+          continue;
+        }
+      }
       if (session->mask & fired_events & EPOLLIN) {
         session->read_proc(session, closed);
       }
@@ -63,6 +83,9 @@ void EventLoop::Loop() {
         }
       }
     }
+    if (after_poll) {
+      after_poll();
+    }
     /* handle time events */
     tev_holder->HandleFiredTimeEvent();
   }
@@ -88,6 +111,219 @@ bool EventLoop::RemoveTimeEvent(long id) {
   return tev_holder->RemoveTimeEvent(id);
 }
 
+/* number of iovec in one writev */
+static constexpr int kMaxIovecs = 64;
+
+/* bytes sent in one WriteOutput at most, so that the result always fits into an int */
+static constexpr size_t kMaxOutputPerWrite = 1 << 30;
+
+size_t Session::OutputBytes() const {
+  size_t n = write_buf.ReadableBytes();
+  for (const auto &chunk : write_chunks) {
+    n += chunk.len;
+  }
+  return n;
+}
+
+int Session::WriteOutput() {
+  size_t total = 0;
+  bool zerocopy = zerocopy_threshold > 0;
+  while (total < kMaxOutputPerWrite) {
+    /* collect the segments after the first total bytes: buffer bytes before every chunk, the
+     * chunk, and the buffer bytes after the last chunk. A chunk sent with MSG_ZEROCOPY is sent
+     * alone, so that buffer bytes are never referred to by the kernel after the call */
+    struct iovec iov[kMaxIovecs];
+    int n_iov = 0;
+    size_t skip = total, batch = 0;
+    auto add = [&](const char *data, size_t len) {
+      if (skip >= len) {
+        skip -= len;
+        return true;
+      }
+      if (n_iov == kMaxIovecs) {
+        return false;
+      }
+      iov[n_iov].iov_base = const_cast<char *>(data + skip);
+      iov[n_iov].iov_len = len - skip;
+      batch += len - skip;
+      skip = 0;
+      ++n_iov;
+      return true;
+    };
+    OutputChunk *zerocopy_chunk = nullptr;
+    const char *buf = write_buf.BeginRead();
+    size_t buf_pos = 0;
+    bool full = false;
+    for (auto &chunk : write_chunks) {
+      if (!add(buf + buf_pos, chunk.pos - buf_pos)) {
+        full = true;
+        break;
+      }
+      buf_pos = chunk.pos;
+      if (zerocopy && chunk.len >= zerocopy_threshold && skip < chunk.len) {
+        if (n_iov == 0) {
+          add(chunk.data, chunk.len);
+          zerocopy_chunk = &chunk;
+        }
+        full = true;
+        break;
+      }
+      if (!add(chunk.data, chunk.len)) {
+        full = true;
+        break;
+      }
+    }
+    if (!full) {
+      add(buf + buf_pos, write_buf.ReadableBytes() - buf_pos);
+    }
+    if (batch == 0) {
+      break;
+    }
+    ssize_t sent;
+#ifdef NET_ZEROCOPY
+    if (zerocopy_chunk != nullptr) {
+      struct msghdr msg{};
+      msg.msg_iov = iov;
+      msg.msg_iovlen = n_iov;
+      sent = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+      if (sent > 0) {
+        zerocopy_chunk->zerocopy_seq = zerocopy_sends++;
+      } else if (sent == -1 && errno == ENOBUFS) {
+        zerocopy = false;  /* out of memory for pinning pages, copy the rest of this round */
+        continue;
+      }
+    } else {
+      sent = ::writev(fd, iov, n_iov);
+    }
+#else
+    sent = ::writev(fd, iov, n_iov);
+#endif
+    if (sent > 0) {
+      total += sent;
+    } else if (sent == -1 && errno == EINTR) {
+      continue;
+    } else {
+      if (total == 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        return -1;
+      }
+      break;
+    }
+  }
+  return (int)total;
+}
+
+int Session::GatherOutput(struct iovec *iov, int max_iov) const {
+  int n_iov = 0;
+  auto add = [&](const char *data, size_t len) {
+    if (len == 0) {
+      return true;
+    }
+    if (n_iov == max_iov) {
+      return false;
+    }
+    iov[n_iov].iov_base = const_cast<char *>(data);
+    iov[n_iov].iov_len = len;
+    ++n_iov;
+    return true;
+  };
+  const char *buf = write_buf.BeginRead();
+  size_t buf_pos = 0;
+  for (const auto &chunk : write_chunks) {
+    if (!add(buf + buf_pos, chunk.pos - buf_pos) || !add(chunk.data, chunk.len)) {
+      return n_iov;
+    }
+    buf_pos = chunk.pos;
+  }
+  add(buf + buf_pos, write_buf.ReadableBytes() - buf_pos);
+  return n_iov;
+}
+
+void Session::ConsumeOutput(size_t nbytes) {
+  while (nbytes > 0 && !write_chunks.empty()) {
+    OutputChunk &chunk = write_chunks.front();
+    size_t n = std::min(nbytes, chunk.pos);
+    if (n > 0) {
+      write_buf.ReaderIdxForward(n);
+      for (auto &c : write_chunks) {
+        c.pos -= n;
+      }
+      nbytes -= n;
+      if (chunk.pos > 0) {
+        return;
+      }
+    }
+    n = std::min(nbytes, chunk.len);
+    chunk.data += n;
+    chunk.len -= n;
+    nbytes -= n;
+    if (chunk.len > 0) {
+      return;
+    }
+    if (chunk.zerocopy_seq >= 0) {
+      /* the kernel still refers to the bytes until the send is completed */
+      zerocopy_pins.emplace_back((uint32_t)chunk.zerocopy_seq, std::move(chunk.pin));
+    }
+    write_chunks.pop_front();
+  }
+  write_buf.ReaderIdxForward(nbytes);
+}
+
+void Session::ClearOutput() {
+  write_buf.Reset();
+  write_chunks.clear();
+  zerocopy_pins.clear();
+}
+
+int Session::ReapZeroCopy() {
+  int n = 0;
+#ifdef NET_ZEROCOPY
+  char control[CMSG_SPACE(sizeof(struct sock_extended_err)) * 8];
+  while (true) {
+    struct msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+      break;  /* nothing left in error queue */
+    }
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+          !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      auto *err = reinterpret_cast<struct sock_extended_err *>(CMSG_DATA(cm));
+      if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      /* sends from ee_info to ee_data are completed, the range may wrap around */
+      uint32_t lo = err->ee_info, hi = err->ee_data;
+      zerocopy_pins.erase(std::remove_if(zerocopy_pins.begin(), zerocopy_pins.end(),
+                                         [lo, hi](const std::pair<uint32_t, std::shared_ptr<const void>> &item) {
+                                           return item.first - lo <= hi - lo;
+                                         }),
+                          zerocopy_pins.end());
+      ++n;
+    }
+  }
+#endif
+  return n;
+}
+
+/* provided buffers of every ring, which are shared by the multishot receives of all sessions */
+static constexpr unsigned kRecvBuffers = 512;
+static constexpr unsigned kRecvBufferSize = 16 * 1024;
+
+/* kind of io_uring request in the low bits of user data, the session id or the send index above */
+enum UringOp {
+  OP_INPUT = 0,  /* accept, receive or poll for input, multishot */
+  OP_OUTPUT = 1, /* one-shot poll for EPOLLOUT */
+  OP_CANCEL = 2,
+  OP_SEND = 3,   /* one send of SendOutputs */
+};
+
+static inline uint64_t UringData(uint64_t id, UringOp op) {
+  return id << 2u | op;
+}
+
 Epoller::Epoller(size_t max_events) :
     epfd_(epoll_create(max_events)), ep_events_(max_events) {
 }
@@ -121,6 +357,9 @@ int Epoller::Wait(int timeout_ms) {
   if (epfd_ == -1) {
     return -1;
   }
+  if (ring_ != nullptr) {
+    return WaitRing(timeout_ms);
+  }
   return epoll_wait(epfd_, &ep_events_[0], static_cast<int>(ep_events_.size()), timeout_ms);
 }
 
@@ -128,6 +367,25 @@ bool Epoller::AttachSession(Session *sev) {
   if (!sev) {
     return false;
   }
+  if (ring_ != nullptr) {
+    if (!sev->watched) {
+      sev->uring_id = next_uring_id_++;
+      if (!ArmInput(sev)) {
+        sev->uring_id = 0;
+        return false;
+      }
+      uring_sessions_[sev->uring_id] = sev;
+      sev->watched = true;
+    }
+    /* EPOLLOUT is polled once, and again if it is still wanted after it fires */
+    if ((sev->mask & EPOLLOUT) && !(sev->registered_mask & EPOLLOUT)) {
+      if (!ring_->AddPoll(sev->fd, EPOLLOUT, false, UringData(sev->uring_id, OP_OUTPUT))) {
+        return false;
+      }
+      sev->registered_mask |= EPOLLOUT;
+    }
+    return true;
+  }
   epoll_event epev{0};
   epev.data.ptr = static_cast<void *> (sev);
   epev.events = sev->mask;
@@ -137,9 +395,14 @@ bool Epoller::AttachSession(Session *sev) {
       // std::cout << "fd = " << sev->fd << " attached\n";
       sev->watched = true;
     }
+  } else if (sev->mask == sev->registered_mask) {
+    return true;  /* nothing changed */
   } else {
     ans = epoll_ctl(epfd_, EPOLL_CTL_MOD, sev->fd, &epev);
   }
+  if (ans == 0) {
+    sev->registered_mask = sev->mask;
+  }
   return ans == 0;
 }
 
@@ -151,13 +414,175 @@ bool Epoller::DetachSession(Session *sev) {
   if (!sev) {
     return false;
   }
+  if (ring_ != nullptr) {
+    if (sev->uring_id == 0) {
+      return false;
+    }
+    /* completions which come later find no session, their buffers are given back only */
+    uring_sessions_.erase(sev->uring_id);
+    eof_ids_.erase(sev->uring_id);
+    ring_->AddCancel(UringData(sev->uring_id, OP_INPUT), UringData(0, OP_CANCEL));
+    if (sev->registered_mask & EPOLLOUT) {
+      ring_->AddCancel(UringData(sev->uring_id, OP_OUTPUT), UringData(0, OP_CANCEL));
+    }
+    sev->uring_id = 0;
+    sev->watched = false;
+    sev->registered_mask = 0;
+    sev->events = 0;
+    return true;
+  }
   int ans = -1;
   if ((ans = epoll_ctl(epfd_, EPOLL_CTL_DEL, sev->fd, nullptr)) == 0) {
     sev->watched = false;
+    sev->registered_mask = 0;
   }
   return ans == 0;
 }
 
 void Epoller::Stop() {
   close(epfd_);
+  epfd_ = -1;  /* the number may be taken by a new fd of another thread */
+}
+
+bool Epoller::UseUring(unsigned entries, bool sqpoll) {
+  std::unique_ptr<IoUring> ring(new (std::nothrow) IoUring);
+  if (ring == nullptr || !ring->Init(entries, sqpoll) || !ring->SetupBuffers(kRecvBuffers, kRecvBufferSize)) {
+    return false;
+  }
+  ring_ = std::move(ring);
+  return true;
+}
+
+bool Epoller::ArmInput(Session *sev) {
+  uint64_t data = UringData(sev->uring_id, OP_INPUT);
+  switch (sev->input) {
+    case INPUT_ACCEPT:
+      return ring_->AddAccept(sev->fd, data);
+    case INPUT_RECV:
+      return ring_->AddRecv(sev->fd, data);
+    default:
+      return ring_->AddPoll(sev->fd, sev->mask & ~EPOLLOUT, true, data);
+  }
+}
+
+void Epoller::Fire(Session *sev, uint32_t events) {
+  if (events == 0) {
+    return;
+  }
+  if (sev->events == 0) {
+    fired_ids_.push_back(sev->uring_id);
+  }
+  sev->events |= events;
+}
+
+void Epoller::HandleCompletions() {
+  UringCompletion completion;
+  while (ring_->PopCompletion(completion)) {
+    uint64_t id = completion.user_data >> 2u;
+    int res = completion.res;
+    auto op = static_cast<UringOp>(completion.user_data & 3u);
+    if (op == OP_SEND) {
+      send_results_[id] = res;
+      --pending_sends_;
+      continue;
+    }
+    if (op == OP_CANCEL) {
+      continue;
+    }
+    auto it = uring_sessions_.find(id);
+    Session *sev = it != uring_sessions_.end() ? it->second : nullptr;
+    if (completion.buffer_id >= 0) {
+      if (sev != nullptr && res > 0) {
+        sev->received.Append(ring_->BufferOf(completion.buffer_id), res);
+      }
+      ring_->RecycleBuffer(completion.buffer_id);
+    }
+    if (sev == nullptr) {
+      continue;
+    }
+    if (op == OP_OUTPUT) {
+      /* the write handler also finds out errors of the connection */
+      sev->registered_mask &= ~EPOLLOUT;
+      Fire(sev, EPOLLOUT | (res > 0 ? (uint32_t)res & (EPOLLERR | EPOLLHUP) : 0));
+      continue;
+    }
+    if (sev->input == INPUT_RECV) {
+      if (res > 0) {
+        Fire(sev, EPOLLIN);
+      } else if (res != -ENOBUFS) {
+        /* the read handler finds nothing more after received, and keeps being called till it closes */
+        sev->received_eof = true;
+        eof_ids_.insert(id);
+        Fire(sev, EPOLLIN);
+        continue;
+      }
+    } else if (sev->input == INPUT_ACCEPT) {
+      if (res >= 0) {
+        sev->accepted_fds.push_back(res);
+        Fire(sev, EPOLLIN);
+      }
+    } else if (res > 0) {
+      Fire(sev, (uint32_t)res);
+    }
+    /* a multishot request ends on errors, such as out of buffers, it goes on unless fd is unusable */
+    if (!completion.more && res != -EBADF && res != -EINVAL) {
+      ArmInput(sev);
+    }
+  }
+}
+
+int Epoller::WaitRing(int timeout_ms) {
+  /* events recorded in the meantime, such as while sending, are reported without waiting */
+  bool ready = !fired_ids_.empty() || !eof_ids_.empty();
+  ring_->Submit(ready ? 0 : 1, timeout_ms);
+  HandleCompletions();
+  for (uint64_t id : eof_ids_) {
+    Fire(uring_sessions_[id], EPOLLIN);
+  }
+  int n = 0;
+  size_t i = 0;
+  for (; i < fired_ids_.size() && n < (int)ep_events_.size(); ++i) {
+    auto it = uring_sessions_.find(fired_ids_[i]);
+    if (it == uring_sessions_.end()) {
+      continue;  /* detached after its events are recorded */
+    }
+    Session *sev = it->second;
+    ep_events_[n].events = sev->events;
+    ep_events_[n].data.ptr = sev;
+    sev->events = 0;
+    ++n;
+  }
+  fired_ids_.erase(fired_ids_.begin(), fired_ids_.begin() + i);
+  return n;
+}
+
+void Epoller::SendOutputs(const std::vector<Session *> &sessions) {
+  size_t n = sessions.size();
+  send_msgs_.assign(n, msghdr{});
+  send_iovs_.resize(n * kMaxIovecs);
+  send_results_.assign(n, 0);
+  pending_sends_ = 0;
+  for (size_t i = 0; i < n; ++i) {
+    Session *sev = sessions[i];
+    struct msghdr &msg = send_msgs_[i];
+    msg.msg_iov = &send_iovs_[i * kMaxIovecs];
+    msg.msg_iovlen = sev->GatherOutput(msg.msg_iov, kMaxIovecs);
+    if (msg.msg_iovlen == 0) {
+      continue;
+    }
+    if (ring_->AddSendMsg(sev->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL, UringData(i, OP_SEND))) {
+      ++pending_sends_;
+    } else {
+      send_results_[i] = sev->WriteOutput();
+    }
+  }
+  /* the sends refer to send_msgs_ and the output of sessions till they are completed */
+  while (pending_sends_ > 0) {
+    ring_->Submit(pending_sends_);
+    HandleCompletions();
+  }
+  for (size_t i = 0; i < n; ++i) {
+    int res = send_results_[i];
+    sessions[i]->io_nbytes = res >= 0 ? res : (res == -EAGAIN ? 0 : -1);
+  }
 }
\ No newline at end of file
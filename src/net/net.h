@@ -1,8 +1,11 @@
 #ifndef __NET_H__
 #define __NET_H__
 
+#include <algorithm>
 #include <atomic>
+#include <cctype>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <unordered_map>
@@ -11,6 +14,8 @@
 #include <sstream>
 #include <vector>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "buffer.h"
@@ -18,6 +23,7 @@
 
 
 class Epoller;
+class IoUring;
 
 struct EventLoop;
 struct CommandCache;
@@ -29,12 +35,86 @@ typedef struct epoll_event epoll_event;
 struct CommandCache {
   bool inited = false;
   size_t argc = 0;
-  std::vector<std::string> argv;
+  /* views of arguments, which refer to the read buffer they are parsed from, or to own_args */
+  std::vector<StringView> argv;
+  /* arguments which are not in a buffer, a deque keeps its elements in place when growing */
+  std::deque<std::string> own_args;
+  /* some arguments refer to a buffer, they are invalid once the buffer is moved or reset */
+  bool borrowing = false;
+
+  CommandCache() = default;
+
+  /* a copy owns all its arguments, so that it outlives the buffer of the original */
+  CommandCache(const CommandCache &other) { *this = other; }
+
+  CommandCache &operator=(const CommandCache &other) {
+    if (this != &other) {
+      Clear();
+      inited = other.inited;
+      argc = other.argc;
+      for (const auto &arg : other.argv) {
+        PushOwned(arg);
+      }
+    }
+    return *this;
+  }
+
+  CommandCache(CommandCache &&other) = default;
+
+  CommandCache &operator=(CommandCache &&other) = default;
+
+  /* add an argument referring to len chars at arg, which are followed by a '\0' */
+  inline void Push(const char *arg, size_t len) {
+    argv.emplace_back(arg, len);
+    borrowing = true;
+  }
+
+  /* add an argument which owns its chars */
+  void PushOwned(std::string arg) {
+    own_args.emplace_back(std::move(arg));
+    argv.emplace_back(own_args.back());
+  }
+
+  /* replace argument at idx with a copy of arg */
+  void SetArg(size_t idx, std::string arg) {
+    own_args.emplace_back(std::move(arg));
+    argv[idx] = StringView(own_args.back());
+  }
+
+  /* replace all arguments with args */
+  void Assign(std::vector<std::string> args) {
+    argv.clear();
+    own_args.clear();
+    borrowing = false;
+    for (auto &arg : args) {
+      PushOwned(std::move(arg));
+    }
+    argc = argv.size();
+  }
+
+  /* turn the command name into lower case, it is left untouched if it is already */
+  void LowerName() {
+    if (!argv.empty() && std::any_of(argv[0].begin(), argv[0].end(), ::isupper)) {
+      std::string name = argv[0];
+      std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+      SetArg(0, std::move(name));
+    }
+  }
+
+  /* copy the arguments which refer to a buffer, before the buffer is changed */
+  void Own() {
+    if (borrowing) {
+      CommandCache owned(*this);
+      *this = std::move(owned);
+    }
+  }
 
   void Clear() {
     inited = false;
     argc = 0;
     argv.clear();
+    own_args.clear();
+    borrowing = false;
   }
 
   friend std::ostream &operator<<(std::ostream &os, const CommandCache &cache) {
@@ -75,34 +155,114 @@ struct CommandCache {
   }
 };
 
+#define PARSE_ARRAY_LEN 0 /* waiting for '*' and the number of arguments */
+#define PARSE_BULK_LEN 1  /* waiting for '$' and the length of next argument */
+#define PARSE_BULK 2      /* waiting for the bytes of an argument and its \r\n */
+
+/* progress of parsing one request, kept between reads so that no byte is parsed twice */
+struct ParseState {
+  int stage = PARSE_ARRAY_LEN;
+  size_t pos = 0;      /* offset of the next byte to parse, counted from the start of the request */
+  size_t scanned = 0;  /* offset up to which the current length line is checked */
+  long n_args = 0;     /* number of arguments of the request */
+  long bulk_len = 0;   /* length of the argument being parsed */
+  std::vector<std::pair<size_t, size_t>> args;  /* offset and length of every parsed argument */
+
+  /* bytes still missing for the argument being parsed, 0 if its length is not known yet */
+  inline size_t BulkRemaining(size_t readable) const {
+    size_t end = pos + bulk_len + 2;
+    return (stage == PARSE_BULK && end > readable) ? end - readable : 0;
+  }
+
+  void Reset() {
+    stage = PARSE_ARRAY_LEN;
+    pos = 0;
+    scanned = 0;
+    n_args = 0;
+    bulk_len = 0;
+    args.clear();
+  }
+};
+
+/* bytes of a large reply sent from where they are stored instead of copied into the write buffer */
+struct OutputChunk {
+  std::shared_ptr<const void> pin;  /* keeps the bytes alive and unchanged until released */
+  const char *data;                 /* bytes not sent yet */
+  size_t len;
+  size_t pos;  /* number of bytes of the write buffer sent before this chunk, from its reader index */
+  int64_t zerocopy_seq = -1;  /* the last MSG_ZEROCOPY send of the chunk, -1 if it is never sent so */
+};
+
+/* how the input of a session is taken with the io_uring backend */
+enum SessionInput {
+  INPUT_POLL = 0,   /* readiness is reported, the read handler reads by itself */
+  INPUT_ACCEPT = 1, /* connections are accepted into accepted_fds, for listen sessions */
+  INPUT_RECV = 2,   /* bytes are received into received */
+};
+
 #define SESSION_MODE_REGULAR (1u << 0u) /* session is in regular mode for read/write */
 #define SESSION_MODE_PUBSUB (1u << 1u)  /* session is in pub/sub mode, the session is ok to be published messages */
+#define SESSION_MODE_BLOCKED (1u << 2u) /* session is blocked by blocking list operations, waiting for keys */
 
 struct Session {
 
   int fd; /* corresponding fd */
   /* our interested events */
   uint32_t mask;
+  /* events registered in epoll, epoll_ctl is skipped if mask is not changed */
+  uint32_t registered_mask = 0;
   /* fired events */
-  uint32_t events;
+  uint32_t events = 0;
 
   ProcFuncType read_proc;  /* read handler */
   ProcFuncType write_proc; /* write handler */
+  ProcFuncType error_proc; /* handler of EPOLLERR, only set if errors are expected, such as zero copy notifications */
 
   EventLoop *loop;
 
   Buffer read_buf; /* read buffer */
   Buffer write_buf;/* write buffer */
+  std::deque<OutputChunk> write_chunks;  /* large replies sent in order with write buffer */
+
+  /* states below are only used with MSG_ZEROCOPY */
+  size_t zerocopy_threshold = 0;  /* chunks of at least this size are sent with MSG_ZEROCOPY, 0 if disabled */
+  uint32_t zerocopy_sends = 0;  /* number of MSG_ZEROCOPY sends, which is the sequence of the next one */
+  std::deque<std::pair<uint32_t, std::shared_ptr<const void>>> zerocopy_pins;  /* sent chunks till completed */
 
+  ParseState parse_state; /* progress of the request at the head of read buffer */
   CommandCache cache;
   std::string name; /* the name of this session */
 
   /* indicate session is being watched or not */
   bool watched = false;
+  /* output is sent right before the loop polls again, EPOLLOUT is only watched if it can not be sent entirely */
+  bool write_scheduled = false;
 
   uint32_t modes = SESSION_MODE_REGULAR;  /* session mode */
   std::unordered_set<std::string> subscribed_channels = {};  /* the channels which this session has already subscribed to */
 
+  /* states below are only valid in blocked mode */
+  CommandCache blocked_cmd;  /* the blocking command, re-executed when one of the keys is ready */
+  std::vector<std::string> blocked_keys = {};  /* the keys this session is waiting for */
+  std::string blocked_timeout_reply;  /* reply sent back to client when timeout */
+  long blocked_timer = NO_TIME_EVENT;  /* id of the timeout time event */
+
+  /* states below are only used with io threads */
+  std::deque<CommandCache> parsed_cmds;  /* commands parsed by io threads, waiting for execution */
+  bool parse_err = false;  /* io threads met an invalid request after parsed_cmds */
+  int io_nbytes = 0;  /* number of bytes read or written by io threads */
+
+  /* states below are only used with multiple reactors */
+  std::deque<std::pair<bool, std::string>> pending_replies;  /* replies in request order and whether they are ready */
+  uint64_t n_replies_done = 0;  /* number of replies moved from pending_replies into write buffer */
+
+  /* states below are only used with the io_uring backend */
+  SessionInput input = INPUT_POLL;
+  uint64_t uring_id = 0;  /* identifies the session in completions, 0 if it is not attached */
+  Buffer received;  /* bytes received by io_uring, taken by the read handler */
+  bool received_eof = false;  /* nothing is received after received, the peer closed or the connection broke */
+  std::deque<int> accepted_fds;  /* connections accepted by io_uring, taken by the accept handler */
+
   Session(int fd, uint32_t mask, ProcFuncType rpr, ProcFuncType wpr,
           EventLoop *loop, std::string name) : fd(fd), mask(mask),
                                                read_proc(std::move(rpr)), write_proc(std::move(wpr)),
@@ -113,6 +273,9 @@ struct Session {
     write_buf.Reset();
     watched = false;
     close(fd);
+    for (int accepted : accepted_fds) {
+      close(accepted);
+    }
   }
 
   void SetRead() {
@@ -139,6 +302,47 @@ struct Session {
     modes &= ~SESSION_MODE_PUBSUB;
   }
 
+  void SetBlockedMode() {
+    modes |= SESSION_MODE_BLOCKED;
+  }
+
+  void UnsetBlockedMode() {
+    modes &= ~SESSION_MODE_BLOCKED;
+  }
+
+  bool IsBlocked() const {
+    return modes & SESSION_MODE_BLOCKED;
+  }
+
+  /* number of bytes waiting to be sent, in write buffer and chunks */
+  size_t OutputBytes() const;
+
+  /**
+   * Send write buffer and chunks in order with as few syscalls as possible. The output is not
+   * consumed, so that io threads can call it, ConsumeOutput is called with the result afterwards.
+   * @return The number of bytes sent, 0 if the socket buffer is full, or -1 if the connection is
+   * broken and nothing is sent.
+   */
+  int WriteOutput();
+
+  /**
+   * Fill iov with the segments of write buffer and chunks in order, up to max_iov of them.
+   * @return The number of segments filled.
+   */
+  int GatherOutput(struct iovec *iov, int max_iov) const;
+
+  /* drop nbytes sent from the output, chunks which are sent entirely are released */
+  void ConsumeOutput(size_t nbytes);
+
+  /* drop all output, such as when the session is closed */
+  void ClearOutput();
+
+  /**
+   * Release the chunks whose MSG_ZEROCOPY sends are completed by the kernel.
+   * @return The number of completion notifications read.
+   */
+  int ReapZeroCopy();
+
 };
 
 typedef std::shared_ptr<Session> SessionPtr;
@@ -147,6 +351,10 @@ struct EventLoop {
   Epoller *epoller = nullptr;
   TimeEventHolder *tev_holder = nullptr;
   std::atomic_bool stopped{false};
+  /* called before waiting for events in every iteration */
+  std::function<void()> before_poll;
+  /* called after fired events are processed in every iteration */
+  std::function<void()> after_poll;
 
   EventLoop();
 
@@ -190,10 +398,47 @@ public:
 
   void Stop();
 
+  /**
+   * Wait for events with io_uring instead of epoll: listen sessions accept and client sessions
+   * receive through the ring, others are polled by it. Events are reported by Wait in the same
+   * way. It is called before any session is attached.
+   * @return false if io_uring is not available, epoll is kept then.
+   */
+  bool UseUring(unsigned entries, bool sqpoll);
+
+  bool UsingUring() const { return ring_ != nullptr; }
+
+  /**
+   * Send the output of sessions with one submission, every session gets the result in io_nbytes
+   * like WriteOutput. Only with io_uring.
+   */
+  void SendOutputs(const std::vector<Session *> &sessions);
+
+private:
+  bool ArmInput(Session *sev);
+
+  /* take all completions, record the events of sessions */
+  void HandleCompletions();
+
+  void Fire(Session *sev, uint32_t events);
+
+  int WaitRing(int timeout_ms);
+
 private:
   int epfd_ = -1;
   /* struct epoll_event */
   std::vector<epoll_event> ep_events_;
+
+  /* states below are only used with io_uring */
+  std::unique_ptr<IoUring> ring_;
+  uint64_t next_uring_id_ = 1;
+  std::unordered_map<uint64_t, Session *> uring_sessions_;
+  std::vector<uint64_t> fired_ids_;  /* sessions with events to report, merged in Session::events */
+  std::unordered_set<uint64_t> eof_ids_;  /* sessions whose input ended, reported till detached */
+  std::vector<struct msghdr> send_msgs_;
+  std::vector<struct iovec> send_iovs_;
+  std::vector<int> send_results_;
+  size_t pending_sends_ = 0;
 };
 
 #endif // __NET_H__
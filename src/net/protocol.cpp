@@ -1,4 +1,6 @@
+#include <algorithm>
 #include "protocol.h"
+#include "respscan.h"
 
 void AuxiliaryReadProcCleanup(Buffer &buffer, CommandCache &cache, size_t begin_idx, int nbytes) {
   /* clear cache and clean up invalid request in buffer */
@@ -28,110 +30,139 @@ bool AuxiliaryReadProc(Buffer &buffer, CommandCache &cache, int nbytes) {
       break;
     }
     std::string arg = buffer.ReadStdStringAndForward(arg_len);
-    if (buffer.ReadStdString(2) != CRLF) {
+    if (buffer.BeginRead()[0] != '\r' || buffer.BeginRead()[1] != '\n') {
       AuxiliaryReadProcCleanup(buffer, cache, begin_idx, nbytes);
       return false;
     }
     buffer.ReaderIdxForward(2);
-    cache.argv.emplace_back(arg);
+    cache.PushOwned(std::move(arg));
   }
   return true;
 }
 
-bool TryParseFromBuffer(Buffer &buffer, CommandCache &cache, bool &err) {
-  if (buffer.ReadableBytes() <= 0) {
+/**
+ * Parse a line of prefix followed by an integer and \r\n at state.pos, the bytes searched for
+ * \r\n before are not searched again.
+ * @return false if the line is not complete or invalid (err is set).
+ */
+static bool ParseLengthLine(const char *begin, size_t readable, char prefix, ParseState &state,
+                            long &value, bool &err) {
+  size_t pos = state.pos;
+  if (pos >= readable) {
     return false;
   }
-  /* a whole protocol must start from * */
-  if (buffer.ReadStdString(1) != "*") {
-    if (buffer.ReadableBytes() >= 1) {  /* have enough bytes, but can not find '*', invalid */
-      err = true;
-    }
-    buffer.Reset();
+  if (begin[pos] != prefix) {
+    err = true;
     return false;
   }
-  size_t step;
-  size_t cur_idx = 1;
-  long n_para = buffer.ReadLongFrom(cur_idx, step);
-  if (step == 0) {
-    if (buffer.ReadableBytes() > 0) {
+  const char *digits = begin + pos + 1;
+  const char *end = begin + readable;
+  /* most length lines are a few digits, which are parsed without looking for \r\n first */
+  if (end - digits >= 8) {
+    int n_digits = RespParseShortLength(digits, value);
+    if (n_digits < 0) {
       err = true;
+      return false;
+    }
+    if (n_digits > 0) {
+      state.pos = pos + 1 + n_digits + 2;
+      state.scanned = state.pos;
+      return true;
     }
-    cache.Clear();
-    return false; /* protocol string not complete, till next time */
   }
-  cache.argc = (size_t) n_para;
-  /* next two bytes is \r\n */
-  cur_idx += step;
-  if (buffer.ReadStdStringFrom(cur_idx, 2) != "\r\n") {
-    if (buffer.ReadableBytes() - cur_idx >= 2) {
+  const char *crlf = RespFindCRLF(begin + std::max(state.scanned, pos + 1), end);
+  if (crlf == end) {
+    /* \r\n not complete, till next time, the last byte may be its \r */
+    state.scanned = std::max(pos + 1, readable - 1);
+    size_t n_digits = end - digits - (end[-1] == '\r');
+    long partial;
+    if (n_digits > 0 && !(n_digits == 1 && digits[0] == '-') &&
+        !RespParseLength(digits, n_digits, partial)) {
       err = true;
     }
-    cache.Clear();
     return false;
   }
-  cur_idx += 2;
-  while (n_para > 0) {
-    if (cur_idx >= buffer.ReadableBytes()) {  /* not enough data */
-      return false;
-    }
-    /* next is $ */
-    if (buffer.ReadableCharacterAt(cur_idx) != '$') {
-      if (buffer.ReadableBytes() > cur_idx) {
-        err = true;
+  if (!RespParseLength(digits, crlf - digits, value)) {
+    err = true;
+    return false;
+  }
+  state.pos = crlf - begin + 2;
+  state.scanned = state.pos;
+  return true;
+}
+
+bool TryParseFromBuffer(Buffer &buffer, ParseState &state, CommandCache &cache, bool &err) {
+  cache.Clear();
+  err = false;
+  while (!err) {
+    const char *begin = buffer.BeginRead();
+    size_t readable = buffer.ReadableBytes();
+    if (state.stage == PARSE_ARRAY_LEN) {
+      /* a whole protocol must start from * */
+      if (!ParseLengthLine(begin, readable, '*', state, state.n_args, err)) {
+        break;
       }
-      cache.Clear();
-      return false;
-    }
-    ++cur_idx;
-    long next_arg_len = buffer.ReadLongFrom(cur_idx, step);
-    if (step == 0) {
-      if (buffer.ReadableBytes() - cur_idx > 0) {
+      if (state.n_args < 0) {
         err = true;
+        break;
       }
-      cache.Clear();
-      return false;
-    }
-    cur_idx += step;
-    /* next two bytes is \r\n */
-    if (buffer.ReadStdStringFrom(cur_idx, 2) != "\r\n") {
-      if (buffer.ReadableBytes() - cur_idx >= 2) {
-        err = true;
+      if (state.n_args == 0) {
+        /* empty request, nothing to execute */
+        buffer.ReaderIdxForward(state.pos);
+        state.Reset();
+        continue;
       }
-      cache.Clear();
-      return false;
+      state.stage = PARSE_BULK_LEN;
     }
-    cur_idx += 2;
-    /* read next_arg_len consecutive bytes */
-    std::string arg = buffer.ReadStdStringFrom(cur_idx, next_arg_len);
-    cache.argv.emplace_back(arg);
-//    std::cout << arg << std::endl;
-    /* arg might be empty and this is allowed */
-    if (arg.size() != (size_t) next_arg_len) {
-      if (buffer.ReadableBytes() - cur_idx >= (size_t) next_arg_len) {
-        err = true;
+    while (state.args.size() < (size_t)state.n_args) {
+      if (state.stage == PARSE_BULK_LEN) {
+        if (!ParseLengthLine(begin, readable, '$', state, state.bulk_len, err)) {
+          break;
+        }
+        if (state.bulk_len < 0 || state.bulk_len > (long)kMaxStringLength) {
+          err = true;
+          break;
+        }
+        state.stage = PARSE_BULK;
       }
-      cache.Clear();
-      return false;
-    }
-    cur_idx += next_arg_len;
-    /* next two bytes is \r\n */
-    if (buffer.ReadStdStringFrom(cur_idx, 2) != "\r\n") {
-      if (buffer.ReadableBytes() - cur_idx >= 2) {
+      /* the bytes of argument are not looked at until all of them arrive */
+      if (state.BulkRemaining(readable) > 0) {
+        break;
+      }
+      size_t end = state.pos + state.bulk_len;
+      if (begin[end] != '\r' || begin[end + 1] != '\n') {
         err = true;
+        break;
       }
-      cache.Clear();
-      return false;
+      state.args.emplace_back(state.pos, state.bulk_len);
+      state.pos = end + 2;
+      state.scanned = state.pos;
+      state.stage = PARSE_BULK_LEN;
     }
-    cur_idx += 2;
-    --n_para;
+    if (err || state.args.size() < (size_t)state.n_args) {
+      break;
+    }
+    /* finish parsing one, end every argument with a '\0' in place of its '\r' */
+    char *data = buffer.BeginRead();
+    for (const auto &arg : state.args) {
+      data[arg.first + arg.second] = '\0';
+      cache.Push(data + arg.first, arg.second);
+    }
+    cache.argc = cache.argv.size();
+    cache.inited = true;
+    buffer.ReaderIdxForward(state.pos);
+    state.Reset();
+    return true;
   }
-  /* finish parsing one */
-  cache.inited = true;
-  if (cache.argc != cache.argv.size()) {
-    cache.Clear();
-    return false;
+  if (err) {
+    /* drop the invalid request and whatever follows it, the commands parsed before are kept */
+    buffer.ReaderIdxForward(buffer.ReadableBytes());
+    state.Reset();
   }
-  buffer.ReaderIdxForward(cur_idx);
-  return true;
-}
\ No newline at end of file
+  return false;
+}
+
+bool TryParseFromBuffer(Buffer &buffer, CommandCache &cache, bool &err) {
+  ParseState state;
+  return TryParseFromBuffer(buffer, state, cache, err);
+}
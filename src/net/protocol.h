@@ -26,6 +26,15 @@ void AuxiliaryReadProcCleanup(Buffer &buffer, CommandCache &cache, size_t begin_
  */
 bool AuxiliaryReadProc(Buffer &buffer, CommandCache &cache, int nbytes);
 
+/**
+ * Parse one request at the head of buffer into cache, going on from where state was left by the
+ * last call on the same buffer. The arguments in cache refer to the bytes of buffer.
+ * @return true if a whole request is parsed. When the request is invalid, err is set and the
+ * readable bytes of buffer are dropped.
+ */
+bool TryParseFromBuffer(Buffer &buffer, ParseState &state, CommandCache &cache, bool &err);
+
+/* parse a request from the start of buffer, without state kept between calls */
 bool TryParseFromBuffer(Buffer& buffer, CommandCache& cache, bool &err);
 
 #endif // __PROTOCOL_H__
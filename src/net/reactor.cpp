@@ -0,0 +1,559 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+#include <pthread.h>
+#include <sched.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include "reactor.h"
+#include "time_event.h"
+
+using namespace std::placeholders;
+
+#define kCrossReactorMsg "-ERROR keys of the command are owned by different reactors\r\n"
+#define kNotSupportedWithReactorsMsg "-ERROR command not supported with multiple reactors\r\n"
+
+/* how a command is routed by the owners of its keys */
+static constexpr int ROUTE_LOCAL = 0;         /* no keys, executed by the reactor of the session */
+static constexpr int ROUTE_KEYS = 1;          /* all keys have to be owned by the same reactor */
+static constexpr int ROUTE_SPLIT_SUM = 2;     /* keys are independent, replies of the reactors are summed */
+static constexpr int ROUTE_SET_ALGEBRA = 3;   /* members of every set are gathered */
+static constexpr int ROUTE_BROADCAST_SUM = 4; /* executed by every reactor, replies are summed */
+static constexpr int ROUTE_OVERVIEW = 5;      /* executed by every reactor, counters are summed */
+static constexpr int ROUTE_UNSUPPORTED = 6;
+
+struct ForwardedCommand {
+  std::string session;  /* name of the session at origin */
+  uint64_t seq;         /* place of the reply in the session */
+  int origin;
+  int owner;
+  CommandCache cmds;
+  std::string reply;
+  /* a blocking command is executed without blocking and sent again until deadline */
+  bool blocking = false;
+  uint64_t deadline = 0;  /* in ms, 0 means waiting forever */
+  std::string timeout_reply;
+};
+
+struct GatheredCommand {
+  std::string session;
+  uint64_t seq;
+  std::string name;  /* the command which is split */
+  int route;
+  size_t n_waiting;
+  std::vector<std::string> replies;  /* in order of parts */
+};
+
+static CommandCache MakeCommand(std::vector<std::string> argv) {
+  CommandCache cmds;
+  cmds.Assign(std::move(argv));
+  cmds.inited = true;
+  return cmds;
+}
+
+static void AddKeyRange(std::vector<size_t> &keys, size_t begin, size_t end, size_t step = 1) {
+  for (size_t i = begin; i < end; i += step) {
+    keys.push_back(i);
+  }
+}
+
+/* collect the positions of keys in cmds of command spec, whose name is resolved, and return its route */
+static int CommandKeys(const CommandSpec *spec, const CommandCache &cmds, std::vector<size_t> &keys) {
+  const std::vector<StringView> &argv = cmds.argv;
+  const StringView &name = argv[0];
+  size_t argc = argv.size();
+  if (spec == nullptr || !Engine::ArityMatches(spec, argc)) {
+    return ROUTE_LOCAL;  /* replied as unsupported or with a syntax error */
+  }
+  if (name == "del" || name == "exists") {
+    Engine::KeyPositions(spec, argc, keys);
+    return ROUTE_SPLIT_SUM;
+  }
+  if (name == "sinter" || name == "sunion" || name == "sdiff") {
+    Engine::KeyPositions(spec, argc, keys);
+    return ROUTE_SET_ALGEBRA;
+  }
+  if (name == "total" || name == "publish") {
+    return ROUTE_BROADCAST_SUM;
+  }
+  if (name == "overview") {
+    return ROUTE_OVERVIEW;
+  }
+  if (name == "bgsave") {
+    return ROUTE_UNSUPPORTED;
+  }
+  if (!(spec->flags & CMD_MOVABLE_KEYS)) {
+    Engine::KeyPositions(spec, argc, keys);
+  } else if (name == "sintercard") {
+    /* sintercard numkeys key [key ...] [LIMIT limit] */
+    size_t numkeys = strtoul(argv[1].c_str(), nullptr, 10);
+    AddKeyRange(keys, 2, std::min(argc, 2 + numkeys));
+  } else if (name == "cms.merge") {
+    /* cms.merge destination numkeys source [source ...] [WEIGHTS weight [weight ...]] */
+    keys.push_back(1);
+    size_t numkeys = strtoul(argv[2].c_str(), nullptr, 10);
+    AddKeyRange(keys, 3, std::min(argc, 3 + numkeys));
+  } else if (name == "xread") {
+    /* xread [COUNT count] [BLOCK milliseconds] STREAMS key [key ...] id [id ...] */
+    size_t idx = 1;
+    while (idx < argc && strcasecmp(argv[idx].c_str(), "streams") != 0) {
+      ++idx;
+    }
+    size_t n_keys = (argc - std::min(argc, idx + 1)) / 2;
+    AddKeyRange(keys, idx + 1, idx + 1 + n_keys);
+  }
+  return keys.empty() ? ROUTE_LOCAL : ROUTE_KEYS;
+}
+
+/* timeout of a blocking command in ms and its reply when timeout, false if cmds does not block */
+static bool BlockingTimeout(const CommandCache &cmds, uint64_t &timeout_ms, std::string &timeout_reply) {
+  const std::vector<StringView> &argv = cmds.argv;
+  const StringView &name = argv[0];
+  if ((name == "blpop" || name == "brpop") && argv.size() >= 3) {
+    timeout_reply = kNilArrayMsg;
+    return ParseBlockingTimeout(argv.back(), timeout_ms);
+  }
+  if (name == "blmove" && argv.size() == 6) {
+    timeout_reply = kNilMsg;
+    return ParseBlockingTimeout(argv[5], timeout_ms);
+  }
+  if (name == "xread") {
+    for (size_t idx = 1; idx + 1 < argv.size(); idx += 2) {
+      if (strcasecmp(argv[idx].c_str(), "block") == 0) {
+        timeout_reply = kNilArrayMsg;
+        return CanConvertToUInt64(argv[idx + 1], timeout_ms);
+      }
+      if (strcasecmp(argv[idx].c_str(), "count") != 0) {
+        break;
+      }
+    }
+  }
+  return false;
+}
+
+/* items of an array reply of bulk strings */
+static bool ParseArrayReply(const std::string &reply, std::vector<std::string> &items) {
+  if (reply.empty() || reply[0] != '*') {
+    return false;
+  }
+  const char *begin = reply.c_str();
+  char *end;
+  long n = strtol(begin + 1, &end, 10);
+  size_t pos = end - begin + 2;
+  for (long i = 0; i < n; ++i) {
+    if (pos >= reply.size() || reply[pos] != '$') {
+      return false;
+    }
+    long len = strtol(begin + pos + 1, &end, 10);
+    pos = end - begin + 2;
+    if (len < 0 || pos + len > reply.size()) {
+      return false;
+    }
+    items.emplace_back(reply, pos, len);
+    pos += len + 2;
+  }
+  return true;
+}
+
+static std::string PackArrayReply(const std::vector<std::string> &items) {
+  std::string reply = "*" + std::to_string(items.size()) + kCRLF;
+  for (const auto &item : items) {
+    reply += "$" + std::to_string(item.size()) + kCRLF + item + kCRLF;
+  }
+  return reply;
+}
+
+/* combine the replies of all parts into the reply of the split command */
+static std::string CombineReplies(const GatheredCommand &gather) {
+  /* the first error is the reply */
+  for (const auto &reply : gather.replies) {
+    if (!reply.empty() && reply[0] == '-') {
+      return reply;
+    }
+  }
+  if (gather.route == ROUTE_SPLIT_SUM || gather.route == ROUTE_BROADCAST_SUM) {
+    long long sum = 0;
+    for (const auto &reply : gather.replies) {
+      sum += strtoll(reply.c_str() + 1, nullptr, 10);
+    }
+    return ":" + std::to_string(sum) + kCRLF;
+  }
+  std::vector<std::vector<std::string>> arrays(gather.replies.size());
+  for (size_t i = 0; i < arrays.size(); ++i) {
+    if (!ParseArrayReply(gather.replies[i], arrays[i])) {
+      return kNotOkMsg;
+    }
+  }
+  if (gather.route == ROUTE_OVERVIEW) {
+    /* names and counters in turn, counters of every reactor are added up */
+    std::vector<std::string> overview = arrays[0];
+    for (size_t i = 1; i < overview.size(); i += 2) {
+      unsigned long long count = 0;
+      for (const auto &array : arrays) {
+        count += i < array.size() ? strtoull(array[i].c_str(), nullptr, 10) : 0;
+      }
+      overview[i] = std::to_string(count);
+    }
+    return PackArrayReply(overview);
+  }
+  /* members of every set in the order of keys */
+  std::unordered_set<std::string> result(arrays[0].begin(), arrays[0].end());
+  for (size_t i = 1; i < arrays.size(); ++i) {
+    if (gather.name == "sunion") {
+      result.insert(arrays[i].begin(), arrays[i].end());
+    } else if (gather.name == "sdiff") {
+      for (const auto &member : arrays[i]) {
+        result.erase(member);
+      }
+    } else {
+      std::unordered_set<std::string> members(arrays[i].begin(), arrays[i].end());
+      for (auto it = result.begin(); it != result.end();) {
+        it = members.count(*it) ? std::next(it) : result.erase(it);
+      }
+    }
+  }
+  return PackArrayReply(std::vector<std::string>(result.begin(), result.end()));
+}
+
+Reactor::Reactor(ReactorGroup *group, int id, int n_reactors) : group_(group), id_(id) {
+  notify_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (notify_fd_ == -1) {
+    std::cerr << "Can not create eventfd for reactor " << id << ": " << strerror(errno) << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  notify_session_.reset(new Session(notify_fd_, EPOLLIN, std::bind(&Reactor::DrainInbox, this, _1, _2),
+                                    nullptr, &loop_, "reactor_notify"));
+  inbox_.resize(n_reactors);
+  for (int src = 0; src < n_reactors; ++src) {
+    if (src != id_) {
+      inbox_[src].reset(new SpscQueue<ReactorTask>(REACTOR_MAILBOX_SIZE));
+    }
+  }
+  outbox_.resize(n_reactors);
+  to_notify_.assign(n_reactors, false);
+}
+
+Reactor::~Reactor() {
+  /* the server goes first, it refers to the engine, the loop and the container */
+  server_.reset();
+  engine_.reset();
+}
+
+void Reactor::Run() {
+  Config *config = group_->GetConfig();
+  unsigned n_cpus = std::thread::hardware_concurrency();
+  if (n_cpus > 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(id_ % n_cpus, &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+      std::cerr << "Can not pin reactor " << id_ << " to cpu " << id_ % n_cpus << std::endl;
+    }
+  }
+  engine_.reset(new Engine(&container_, config));
+  if (group_->GetHistory() != nullptr) {
+    engine_->RestoreFromAppendableFile(&loop_, group_->GetHistory(),
+                                       std::bind(&Reactor::KeepOwnKeys, this, _1));
+  }
+  /* reclaim expired hash fields which are never accessed again, a few hashes every 100ms */
+  KVContainer *container = &container_;
+  loop_.AddTimeEvent(100, [container]() { container->HashActiveExpire(20); }, FIRE_FOREVER);
+  server_.reset(new Server(&loop_, engine_.get(), config, config->GetIp(), config->GetPort()));
+  server_->SetReactor(this);
+  if (loop_.epoller->AttachSession(notify_session_.get())) {
+    notify_session_->watched = true;
+  }
+  /* replaces the hook of server, which is called here after the outbox is flushed */
+  Server *server = server_.get();
+  loop_.before_poll = [this, server]() {
+    FlushOutbox();
+    server->FlushPendingWrites();
+  };
+  group_->OnReactorReady();
+  if (!stopping_.load()) {
+    loop_.Loop();
+  }
+}
+
+bool Reactor::KeepOwnKeys(CommandCache &cmds) const {
+  if (cmds.argv.empty()) {
+    return false;
+  }
+  const CommandSpec *spec = Engine::ResolveCommand(cmds);
+  std::vector<size_t> keys;
+  int route = CommandKeys(spec, cmds, keys);
+  if (keys.empty()) {
+    return id_ == 0;  /* commands without keys are restored once */
+  }
+  if (route == ROUTE_SPLIT_SUM) {
+    std::vector<std::string> argv{cmds.argv[0]};
+    for (size_t idx : keys) {
+      if (group_->OwnerOf(cmds.argv[idx]) == id_) {
+        argv.push_back(cmds.argv[idx]);
+      }
+    }
+    if (argv.size() == 1) {
+      return false;
+    }
+    cmds = MakeCommand(std::move(argv));
+    return true;
+  }
+  /* commands are synced keyed by the key they change */
+  return group_->OwnerOf(cmds.argv[keys[0]]) == id_;
+}
+
+DispatchResult Reactor::Dispatch(Session *session, CommandCache &cmds) {
+  if (cmds.argv.empty()) {
+    return DISPATCH_LOCAL;
+  }
+  const CommandSpec *spec = Engine::ResolveCommand(cmds);
+  std::string name = cmds.argv[0];
+  uint64_t timeout_ms;
+  std::string timeout_reply;
+  if (!session->pending_replies.empty() && BlockingTimeout(cmds, timeout_ms, timeout_reply)) {
+    return DISPATCH_STALLED;  /* a blocked session has no replies on the way */
+  }
+  std::vector<size_t> keys;
+  int route = CommandKeys(spec, cmds, keys);
+  std::vector<std::pair<int, CommandCache>> parts;
+  switch (route) {
+    case ROUTE_LOCAL:
+      return DISPATCH_LOCAL;
+    case ROUTE_UNSUPPORTED:
+      server_->Reply(session, kNotSupportedWithReactorsMsg);
+      return DISPATCH_DONE;
+    case ROUTE_BROADCAST_SUM:
+    case ROUTE_OVERVIEW:
+      for (int owner = 0; owner < group_->NumReactors(); ++owner) {
+        parts.emplace_back(owner, cmds);
+      }
+      Scatter(session, name, route, parts);
+      return DISPATCH_DONE;
+    default:
+      break;
+  }
+  if (keys.empty()) {
+    return DISPATCH_LOCAL;  /* syntax error replied by the handler */
+  }
+  std::vector<int> owners;
+  owners.reserve(keys.size());
+  bool same_owner = true;
+  for (size_t idx : keys) {
+    owners.push_back(group_->OwnerOf(cmds.argv[idx]));
+    same_owner = same_owner && owners.back() == owners.front();
+  }
+  if (same_owner) {
+    if (owners.front() == id_) {
+      return DISPATCH_LOCAL;
+    }
+    Forward(owners.front(), session, cmds);
+    return DISPATCH_DONE;
+  }
+  if (route == ROUTE_KEYS) {
+    server_->Reply(session, kCrossReactorMsg);
+    return DISPATCH_DONE;
+  }
+  if (route == ROUTE_SPLIT_SUM) {
+    /* one command for the keys of every owner */
+    std::vector<std::vector<std::string>> argvs(group_->NumReactors());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      std::vector<std::string> &argv = argvs[owners[i]];
+      if (argv.empty()) {
+        argv.push_back(name);
+      }
+      argv.push_back(cmds.argv[keys[i]]);
+    }
+    for (int owner = 0; owner < group_->NumReactors(); ++owner) {
+      if (!argvs[owner].empty()) {
+        parts.emplace_back(owner, MakeCommand(std::move(argvs[owner])));
+      }
+    }
+  } else {
+    /* the set algebra is done here on the members of every set */
+    for (size_t i = 0; i < keys.size(); ++i) {
+      parts.emplace_back(owners[i], MakeCommand({"smembers", cmds.argv[keys[i]]}));
+    }
+  }
+  Scatter(session, name, route, parts);
+  return DISPATCH_DONE;
+}
+
+void Reactor::Submit(int target, ReactorTask task) {
+  assert(target != id_);
+  std::deque<ReactorTask> &held = outbox_[target];
+  /* the inbox only takes the task if it is not full */
+  if (!held.empty() || !group_->Get(target)->inbox_[id_]->TryPush(std::move(task))) {
+    held.push_back(std::move(task));
+  }
+  to_notify_[target] = true;
+}
+
+void Reactor::DrainInbox(Session *session, bool &closed) {
+  uint64_t n_wakeups;
+  ssize_t ret = read(notify_fd_, &n_wakeups, sizeof(n_wakeups));
+  (void)ret;
+  if (stopping_.load()) {
+    loop_.Stop();
+    return;
+  }
+  ReactorTask task;
+  for (auto &inbox : inbox_) {
+    if (!inbox) {
+      continue;
+    }
+    /* one round of every inbox at most, so that a busy sender does not hold up the others */
+    size_t n_tasks = 0;
+    while (n_tasks < inbox->Capacity() && inbox->TryPop(task)) {
+      task(this);
+      ++n_tasks;
+    }
+    if (n_tasks == inbox->Capacity()) {
+      to_notify_[id_] = true;
+    }
+  }
+}
+
+void Reactor::FlushOutbox() {
+  for (size_t target = 0; target < outbox_.size(); ++target) {
+    std::deque<ReactorTask> &held = outbox_[target];
+    SpscQueue<ReactorTask> *inbox = group_->Get((int)target)->inbox_[id_].get();
+    while (!held.empty() && inbox->TryPush(std::move(held.front()))) {
+      held.pop_front();
+    }
+    if (!held.empty()) {
+      to_notify_[id_] = true;  /* try again right after the next poll */
+    }
+  }
+  uint64_t one = 1;
+  for (size_t target = 0; target < to_notify_.size(); ++target) {
+    if (to_notify_[target]) {
+      to_notify_[target] = false;
+      ssize_t ret = write(group_->Get((int)target)->notify_fd_, &one, sizeof(one));
+      (void)ret;
+    }
+  }
+}
+
+void Reactor::Forward(int owner, Session *session, const CommandCache &cmds) {
+  std::shared_ptr<ForwardedCommand> fwd = std::make_shared<ForwardedCommand>();
+  fwd->session = session->name;
+  fwd->seq = server_->DeferReply(session);
+  fwd->origin = id_;
+  fwd->owner = owner;
+  fwd->cmds = cmds;
+  uint64_t timeout_ms;
+  if (BlockingTimeout(cmds, timeout_ms, fwd->timeout_reply)) {
+    fwd->blocking = true;
+    fwd->deadline = timeout_ms == 0 ? 0 : GetCurrentMs() + timeout_ms;
+  }
+  SendForwarded(fwd);
+}
+
+void Reactor::SendForwarded(const std::shared_ptr<ForwardedCommand> &fwd) {
+  Submit(fwd->owner, [fwd](Reactor *owner) {
+    fwd->reply = owner->server_->ExecuteCommand(fwd->cmds);
+    owner->Submit(fwd->origin, [fwd](Reactor *origin) { origin->OnForwardedReply(fwd); });
+  });
+}
+
+void Reactor::OnForwardedReply(const std::shared_ptr<ForwardedCommand> &fwd) {
+  if (fwd->blocking && fwd->reply == fwd->timeout_reply && server_->HasSession(fwd->session)) {
+    uint64_t now = GetCurrentMs();
+    if (fwd->deadline == 0 || now < fwd->deadline) {
+      uint64_t interval = REACTOR_BLOCKING_RETRY_MS;
+      if (fwd->deadline != 0) {
+        interval = std::min(interval, fwd->deadline - now);
+      }
+      loop_.AddTimeEvent(interval, [this, fwd]() {
+        if (server_->HasSession(fwd->session)) {
+          SendForwarded(fwd);
+        }
+      }, 1);
+      return;
+    }
+  }
+  server_->DeliverReply(fwd->session, fwd->seq, fwd->reply);
+}
+
+void Reactor::Scatter(Session *session, const std::string &name, int route,
+                      std::vector<std::pair<int, CommandCache>> &parts) {
+  std::shared_ptr<GatheredCommand> gather = std::make_shared<GatheredCommand>();
+  gather->session = session->name;
+  gather->seq = server_->DeferReply(session);
+  gather->name = name;
+  gather->route = route;
+  gather->n_waiting = parts.size();
+  gather->replies.resize(parts.size());
+  int origin = id_;
+  for (size_t idx = 0; idx < parts.size(); ++idx) {
+    if (parts[idx].first == id_) {
+      continue;
+    }
+    std::shared_ptr<CommandCache> part = std::make_shared<CommandCache>(std::move(parts[idx].second));
+    /* gather is only touched by this reactor, the others just carry it back */
+    Submit(parts[idx].first, [gather, part, idx, origin](Reactor *owner) {
+      std::string reply = owner->server_->ExecuteCommand(*part);
+      owner->Submit(origin, [gather, idx, reply](Reactor *r) { r->OnGatheredPart(gather, idx, reply); });
+    });
+  }
+  for (size_t idx = 0; idx < parts.size(); ++idx) {
+    if (parts[idx].first == id_) {
+      OnGatheredPart(gather, idx, server_->ExecuteCommand(parts[idx].second));
+    }
+  }
+}
+
+void Reactor::OnGatheredPart(const std::shared_ptr<GatheredCommand> &gather, size_t idx,
+                             const std::string &reply) {
+  gather->replies[idx] = reply;
+  if (--gather->n_waiting == 0) {
+    server_->DeliverReply(gather->session, gather->seq, CombineReplies(*gather));
+  }
+}
+
+ReactorGroup::ReactorGroup(Config *config, AppendableFile *history) : config_(config), history_(history) {
+  int n_reactors = std::max(config_->NumReactors(), 1);
+  for (int id = 0; id < n_reactors; ++id) {
+    reactors_.emplace_back(new Reactor(this, id, n_reactors));
+  }
+  if (history_ != nullptr && n_reactors > 1) {
+    history_->SetShared(true);
+  }
+}
+
+ReactorGroup::~ReactorGroup() {
+  Stop();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void ReactorGroup::Run() {
+  for (int id = 1; id < NumReactors(); ++id) {
+    threads_.emplace_back(&Reactor::Run, reactors_[id].get());
+  }
+  reactors_[0]->Run();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+void ReactorGroup::Stop() {
+  uint64_t one = 1;
+  for (auto &reactor : reactors_) {
+    reactor->stopping_.store(true);
+    ssize_t ret = write(reactor->notify_fd_, &one, sizeof(one));
+    (void)ret;
+  }
+}
+
+void ReactorGroup::OnReactorReady() {
+  if (n_ready_.fetch_add(1) + 1 == NumReactors()) {
+    std::cout << "The server is now ready to accept connections on " << config_->GetIp() << ':'
+              << config_->GetPort() << " with " << NumReactors() << " reactors" << std::endl;
+  }
+}
@@ -0,0 +1,172 @@
+#ifndef __REACTOR_H__
+#define __REACTOR_H__
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mailbox.h"
+#include "net.h"
+#include "server.h"
+#include "../config.h"
+#include "../core.h"
+#include "../persistence.h"
+
+class Reactor;
+class ReactorGroup;
+
+/* work sent to another reactor, run by the thread of that reactor */
+typedef std::function<void(Reactor *)> ReactorTask;
+
+/* number of tasks in flight from one reactor to another, more are held back by the sender */
+constexpr size_t REACTOR_MAILBOX_SIZE = 4096;
+/* interval of retrying a blocking command on keys of another reactor */
+constexpr uint64_t REACTOR_BLOCKING_RETRY_MS = 10;
+
+enum DispatchResult {
+  DISPATCH_LOCAL = 0,   /* the keys are owned by this reactor, the command is executed right away */
+  DISPATCH_DONE = 1,    /* the reply is queued, or it comes back from other reactors later */
+  DISPATCH_STALLED = 2, /* the command waits until the replies of the earlier ones are back */
+};
+
+struct ForwardedCommand;
+struct GatheredCommand;
+
+/**
+ * One event loop with its own keyspace, run by a thread pinned to a cpu. Every reactor accepts
+ * connections on the shared port and owns a disjoint slice of the keyspace buckets, so that no
+ * data structure is touched by two threads. A command on keys owned by another reactor is sent
+ * there through a mailbox, and the reply is sent back the same way. Commands on keys of several
+ * reactors are split into one command per reactor and the replies are gathered.
+ *
+ * Replies of a session are kept in request order, so a session pipelines commands to other
+ * reactors without waiting. Blocking commands wait until the earlier replies are back, and the
+ * ones on keys of another reactor are retried there until they are served or time out.
+ */
+class Reactor {
+public:
+  Reactor(ReactorGroup *group, int id, int n_reactors);
+
+  ~Reactor();
+
+  Reactor(const Reactor &) = delete;
+
+  Reactor &operator=(const Reactor &) = delete;
+
+  inline int Id() const { return id_; }
+
+  inline EventLoop *GetLoop() { return &loop_; }
+
+  inline KVContainer *GetContainer() { return &container_; }
+
+  /**
+   * Route the command of session by the owners of its keys.
+   * @return DISPATCH_LOCAL if the caller should execute the command itself.
+   */
+  DispatchResult Dispatch(Session *session, CommandCache &cmds);
+
+  /* queue task for reactor target, only called by the thread of this reactor */
+  void Submit(int target, ReactorTask task);
+
+private:
+  friend class ReactorGroup;
+
+  /* body of the reactor thread: restore its keys, serve until stopped */
+  void Run();
+
+  /* keep the part of a restored command on keys of this reactor, false if nothing is left */
+  bool KeepOwnKeys(CommandCache &cmds) const;
+
+  /* read proc of the notify session, run the tasks sent by other reactors */
+  void DrainInbox(Session *session, bool &closed);
+
+  /* run before every poll: hand over held back tasks and wake up their reactors */
+  void FlushOutbox();
+
+  void Forward(int owner, Session *session, const CommandCache &cmds);
+
+  void SendForwarded(const std::shared_ptr<ForwardedCommand> &fwd);
+
+  void OnForwardedReply(const std::shared_ptr<ForwardedCommand> &fwd);
+
+  /* send every part to its owner, the reply is combined when all parts are back */
+  void Scatter(Session *session, const std::string &name, int route,
+               std::vector<std::pair<int, CommandCache>> &parts);
+
+  void OnGatheredPart(const std::shared_ptr<GatheredCommand> &gather, size_t idx,
+                      const std::string &reply);
+
+private:
+  ReactorGroup *group_;
+  int id_;
+  EventLoop loop_;
+  KVContainer container_;
+  std::unique_ptr<Engine> engine_;
+  std::unique_ptr<Server> server_;
+  int notify_fd_ = -1;
+  std::unique_ptr<Session> notify_session_;
+  /* inbox_[src] is written by reactor src only */
+  std::vector<std::unique_ptr<SpscQueue<ReactorTask>>> inbox_;
+  /* tasks to every reactor which did not fit into its inbox, kept in order */
+  std::vector<std::deque<ReactorTask>> outbox_;
+  /* reactors which got tasks since the last poll */
+  std::vector<bool> to_notify_;
+  std::atomic<bool> stopping_{false};
+};
+
+/**
+ * The reactors of a thread-per-core server. Reactor 0 runs in the thread calling Run, the others
+ * in their own threads.
+ */
+class ReactorGroup {
+public:
+  /* history is shared by all reactors, nullptr if appendonly is off */
+  ReactorGroup(Config *config, AppendableFile *history);
+
+  ~ReactorGroup();
+
+  ReactorGroup(const ReactorGroup &) = delete;
+
+  ReactorGroup &operator=(const ReactorGroup &) = delete;
+
+  inline int NumReactors() const { return (int)reactors_.size(); }
+
+  inline Reactor *Get(int id) { return reactors_[id].get(); }
+
+  inline Config *GetConfig() { return config_; }
+
+  inline AppendableFile *GetHistory() { return history_; }
+
+  /* the keyspace buckets are dealt out to the reactors in turn */
+  inline int OwnerOf(const StringView &key) const {
+    return (int)(KVContainer::BucketIndex(key.data(), key.size()) % reactors_.size());
+  }
+
+  /* whether every reactor has restored its keys and accepts connections */
+  inline bool Ready() const { return n_ready_.load() == NumReactors(); }
+
+  /* serve until Stop is called */
+  void Run();
+
+  /* stop all reactors, can be called from any thread */
+  void Stop();
+
+private:
+  friend class Reactor;
+
+  void OnReactorReady();
+
+private:
+  Config *config_;
+  AppendableFile *history_;
+  std::vector<std::unique_ptr<Reactor>> reactors_;
+  std::vector<std::thread> threads_;
+  std::atomic<int> n_ready_{0};
+};
+
+#endif  // __REACTOR_H__
@@ -0,0 +1,168 @@
+#include <cstring>
+#include "reply.h"
+
+/* prefix, sign, 19 digits and \r\n */
+static constexpr size_t kMaxHeaderLength = 23;
+
+enum HeaderKind {
+  HEADER_INT = 0,   /* :n\r\n */
+  HEADER_BULK = 1,  /* $n\r\n */
+  HEADER_ARRAY = 2, /* *n\r\n */
+};
+
+static const char kHeaderPrefixes[] = {':', '$', '*'};
+
+/* headers of 0 to kReplySharedHeaders - 1, copied as a whole word */
+struct SharedHeaders {
+  char data[3][kReplySharedHeaders][8];
+  uint8_t len[kReplySharedHeaders];
+};
+
+static size_t FormatNumber(char *p, char prefix, int64_t value) {
+  char digits[20];
+  uint64_t abs = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+  size_t n = 0;
+  do {
+    digits[n++] = (char)('0' + abs % 10);
+    abs /= 10;
+  } while (abs != 0);
+  size_t len = 0;
+  p[len++] = prefix;
+  if (value < 0) {
+    p[len++] = '-';
+  }
+  while (n > 0) {
+    p[len++] = digits[--n];
+  }
+  p[len++] = '\r';
+  p[len++] = '\n';
+  return len;
+}
+
+static const SharedHeaders *BuildSharedHeaders() {
+  static SharedHeaders headers;
+  for (int kind = HEADER_INT; kind <= HEADER_ARRAY; ++kind) {
+    for (int64_t n = 0; n < kReplySharedHeaders; ++n) {
+      headers.len[n] = (uint8_t)FormatNumber(headers.data[kind][n], kHeaderPrefixes[kind], n);
+    }
+  }
+  return &headers;
+}
+
+static const SharedHeaders *sSharedHeaders = BuildSharedHeaders();
+
+/* write the header into p which has kMaxHeaderLength bytes, return its length */
+static inline size_t FormatHeader(char *p, HeaderKind kind, int64_t value) {
+  if (value >= 0 && value < kReplySharedHeaders) {
+    memcpy(p, sSharedHeaders->data[kind][value], 8);
+    return sSharedHeaders->len[value];
+  }
+  return FormatNumber(p, kHeaderPrefixes[kind], value);
+}
+
+void ReplyWriter::Raw(const char *data, size_t len) {
+  char *p = Reserve(len);
+  if (len > 0) {
+    memcpy(p, data, len);
+  }
+  Commit(len);
+}
+
+void ReplyWriter::Status(const StringView &msg) {
+  char *p = Reserve(msg.size() + 3);
+  p[0] = '+';
+  memcpy(p + 1, msg.data(), msg.size());
+  memcpy(p + 1 + msg.size(), "\r\n", 2);
+  Commit(msg.size() + 3);
+}
+
+void ReplyWriter::Error(const char *type, const char *msg) {
+  size_t type_len = strlen(type), msg_len = strlen(msg);
+  size_t len = type_len + msg_len + 4;
+  char *p = Reserve(len);
+  p[0] = '-';
+  memcpy(p + 1, type, type_len);
+  p[1 + type_len] = ' ';
+  memcpy(p + 2 + type_len, msg, msg_len);
+  memcpy(p + 2 + type_len + msg_len, "\r\n", 2);
+  Commit(len);
+}
+
+void ReplyWriter::Int(int64_t value) {
+  char *p = Reserve(kMaxHeaderLength);
+  Commit(FormatHeader(p, HEADER_INT, value));
+}
+
+void ReplyWriter::Bulk(const char *data, size_t len) {
+  char *p = Reserve(kMaxHeaderLength + len + 2);
+  size_t n = FormatHeader(p, HEADER_BULK, (int64_t)len);
+  if (len > 0) {
+    memcpy(p + n, data, len);
+  }
+  memcpy(p + n + len, "\r\n", 2);
+  Commit(n + len + 2);
+}
+
+void ReplyWriter::Bulk(const DynamicString &value) {
+  if (value.Null()) {
+    Nil();
+  } else {
+    Bulk(value.Data(), value.Length());
+  }
+}
+
+void ReplyWriter::PinnedBulk(const char *data, size_t len, std::shared_ptr<const void> pin) {
+  if (!Pinnable(len)) {
+    return Bulk(data, len);
+  }
+  char *p = Reserve(kMaxHeaderLength);
+  Commit(FormatHeader(p, HEADER_BULK, (int64_t)len));
+  OutputChunk chunk;
+  chunk.pin = std::move(pin);
+  chunk.data = data;
+  chunk.len = len;
+  chunk.pos = buffer_.ReadableBytes();
+  chunks_->push_back(std::move(chunk));
+  written_ += len;
+  Raw("\r\n", 2);
+}
+
+void ReplyWriter::BulkInt(int64_t value) {
+  char digits[kMaxHeaderLength];
+  size_t n = FormatNumber(digits, ':', value);
+  Bulk(digits + 1, n - 3);
+}
+
+void ReplyWriter::Nil() {
+  Raw("$-1\r\n");
+}
+
+void ReplyWriter::ArrayHeader(size_t n) {
+  char *p = Reserve(kMaxHeaderLength);
+  Commit(FormatHeader(p, HEADER_ARRAY, (int64_t)n));
+}
+
+void ReplyWriter::NilArray() {
+  Raw("*-1\r\n");
+}
+
+void ReplyWriter::Array(const std::vector<std::string> &values) {
+  ArrayHeader(values.size());
+  for (const auto &value : values) {
+    Bulk(value);
+  }
+}
+
+void ReplyWriter::Array(const std::vector<DynamicString> &values) {
+  ArrayHeader(values.size());
+  for (const auto &value : values) {
+    Bulk(value);
+  }
+}
+
+void ReplyWriter::ArrayOfNils(size_t n) {
+  ArrayHeader(n);
+  for (size_t i = 0; i < n; ++i) {
+    Nil();
+  }
+}
@@ -0,0 +1,121 @@
+#ifndef __REPLY_H__
+#define __REPLY_H__
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "net.h"
+#include "../str.h"
+
+/* integers, bulk lengths and array lengths below it have their headers prepared once */
+constexpr int64_t kReplySharedHeaders = 1024;
+
+/* bulk strings of at least this size are sent from where they are stored if they can be pinned */
+constexpr size_t kReplyPinThreshold = 16 * 1024;
+
+/**
+ * Writer of RESP replies straight into a buffer, the write buffer of the session in most cases.
+ * Every reply reserves its bytes once and is copied in place, no string is built for it.
+ */
+class ReplyWriter {
+public:
+  explicit ReplyWriter(Buffer &buffer) : buffer_(buffer) {}
+
+  /* large bulk strings are added into chunks instead of copied into buffer */
+  ReplyWriter(Buffer &buffer, std::deque<OutputChunk> &chunks) : buffer_(buffer), chunks_(&chunks) {}
+
+  ReplyWriter(const ReplyWriter &) = delete;
+
+  ReplyWriter &operator=(const ReplyWriter &) = delete;
+
+  /* bytes written through this writer, 0 if nothing is replied */
+  inline size_t Written() const { return written_; }
+
+  /* prepared replies, such as kOkMsg */
+  template <size_t N>
+  void Raw(const char (&msg)[N]) {
+    Raw(msg, N - 1);
+  }
+
+  void Raw(const char *data, size_t len);
+
+  void Raw(const std::string &data) { Raw(data.data(), data.size()); }
+
+  /* +msg\r\n */
+  void Status(const StringView &msg);
+
+  /* -type msg\r\n */
+  void Error(const char *type, const char *msg);
+
+  /* :value\r\n */
+  void Int(int64_t value);
+
+  void Bool(bool yes) { Int(yes ? 1 : 0); }
+
+  /* $len\r\ndata\r\n */
+  void Bulk(const char *data, size_t len);
+
+  void Bulk(const std::string &value) { Bulk(value.data(), value.size()); }
+
+  /* nil if value is null */
+  void Bulk(const DynamicString &value);
+
+  /* whether a bulk string of len bytes is worth being pinned instead of copied */
+  inline bool Pinnable(size_t len) const { return chunks_ != nullptr && len >= kReplyPinThreshold; }
+
+  /**
+   * Bulk string whose data is sent in place, pin keeps it alive and unchanged until it is sent.
+   * It is copied like Bulk if it is not Pinnable.
+   */
+  void PinnedBulk(const char *data, size_t len, std::shared_ptr<const void> pin);
+
+  /* integer value as a bulk string */
+  void BulkInt(int64_t value);
+
+  /* $-1\r\n */
+  void Nil();
+
+  /* *n\r\n, the n elements are written next */
+  void ArrayHeader(size_t n);
+
+  /* *-1\r\n */
+  void NilArray();
+
+  void Array(const std::vector<std::string> &values);
+
+  void Array(const std::vector<DynamicString> &values);
+
+  /* array of n nils */
+  void ArrayOfNils(size_t n);
+
+  template <typename T>
+  void IntArray(const std::vector<T> &values) {
+    ArrayHeader(values.size());
+    for (const T &value : values) {
+      Int((int64_t)value);
+    }
+  }
+
+private:
+  /* room for n bytes at the end of buffer, taken by Commit after written */
+  inline char *Reserve(size_t n) {
+    buffer_.EnsureBytesForWrite(n);
+    return buffer_.BeginWrite();
+  }
+
+  inline void Commit(size_t n) {
+    buffer_.WriterIdxForward(n);
+    written_ += n;
+  }
+
+private:
+  Buffer &buffer_;
+  std::deque<OutputChunk> *chunks_ = nullptr;
+  size_t written_ = 0;
+};
+
+#endif  // __REPLY_H__
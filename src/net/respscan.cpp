@@ -0,0 +1,243 @@
+#include <cstdint>
+#include <cstring>
+#include "respscan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RESPSCAN_X86
+#endif
+
+struct Kernels {
+  const char *name;
+  const char *(*find_crlf)(const char *, const char *);
+  const char *(*find_prefix)(const char *, const char *);
+};
+
+static const char *FindCRLFScalar(const char *begin, const char *end) {
+  for (const char *p = begin; p + 1 < end; ++p) {
+    if (p[0] == '\r' && p[1] == '\n') {
+      return p;
+    }
+  }
+  return end;
+}
+
+static const char *FindPrefixScalar(const char *begin, const char *end) {
+  for (const char *p = begin; p < end; ++p) {
+    if (*p == '$' || *p == '*') {
+      return p;
+    }
+  }
+  return end;
+}
+
+static const Kernels kScalarKernels = {"scalar", FindCRLFScalar, FindPrefixScalar};
+
+#if defined(RESPSCAN_X86) && defined(__SSE2__)
+
+/* a block and the block one byte after it are compared, so every bit of the mask is a \r\n */
+static const char *FindCRLFSSE2(const char *begin, const char *end) {
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const char *p = begin;
+  for (; p + 17 <= end; p += 16) {
+    __m128i at_cr = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), cr);
+    __m128i at_lf = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 1)), lf);
+    int mask = _mm_movemask_epi8(_mm_and_si128(at_cr, at_lf));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return FindCRLFScalar(p, end);
+}
+
+static const char *FindPrefixSSE2(const char *begin, const char *end) {
+  const __m128i dollar = _mm_set1_epi8('$');
+  const __m128i star = _mm_set1_epi8('*');
+  const char *p = begin;
+  for (; p + 16 <= end; p += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(block, dollar), _mm_cmpeq_epi8(block, star)));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return FindPrefixScalar(p, end);
+}
+
+static const Kernels kSSE2Kernels = {"sse2", FindCRLFSSE2, FindPrefixSSE2};
+
+#define RESPSCAN_AVX2 __attribute__((target("avx2")))
+
+static RESPSCAN_AVX2 const char *FindCRLFAVX2(const char *begin, const char *end) {
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const char *p = begin;
+  for (; p + 33 <= end; p += 32) {
+    __m256i at_cr = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), cr);
+    __m256i at_lf = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 1)), lf);
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(at_cr, at_lf));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return FindCRLFSSE2(p, end);
+}
+
+static RESPSCAN_AVX2 const char *FindPrefixAVX2(const char *begin, const char *end) {
+  const __m256i dollar = _mm256_set1_epi8('$');
+  const __m256i star = _mm256_set1_epi8('*');
+  const char *p = begin;
+  for (; p + 32 <= end; p += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)p);
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, dollar), _mm256_cmpeq_epi8(block, star)));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return FindPrefixSSE2(p, end);
+}
+
+static const Kernels kAVX2Kernels = {"avx2", FindCRLFAVX2, FindPrefixAVX2};
+
+static bool SupportsAVX2() {
+  /* it may run before the constructors which set up cpu features */
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+static const Kernels *Detect() {
+#if defined(RESPSCAN_X86) && defined(__SSE2__)
+  return SupportsAVX2() ? &kAVX2Kernels : &kSSE2Kernels;
+#else
+  return &kScalarKernels;
+#endif
+}
+
+/* picked once, before any request can be parsed */
+static const Kernels *sKernels = Detect();
+
+const char *RespFindCRLF(const char *begin, const char *end) {
+  return sKernels->find_crlf(begin, end);
+}
+
+const char *RespFindPrefix(const char *begin, const char *end) {
+  return sKernels->find_prefix(begin, end);
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+/**
+ * Convert 8 digits at once, the first digit is in the lowest byte. Adjacent digits are combined
+ * into pairs, then quads, then the whole number. ok is cleared if any byte is not a digit.
+ */
+static inline uint64_t ConvertDigitsSWAR(uint64_t word, bool &ok) {
+  uint64_t high = word & 0xF0F0F0F0F0F0F0F0ULL;
+  uint64_t high_plus_6 = (word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL;
+  ok &= (high | (high_plus_6 >> 4)) == 0x3333333333333333ULL;
+  word -= 0x3030303030303030ULL;
+  word = (word * 10 + (word >> 8)) & 0x00FF00FF00FF00FFULL;
+  word = (word * 100 + (word >> 16)) & 0x0000FFFF0000FFFFULL;
+  word = (word * 10000 + (word >> 32)) & 0x00000000FFFFFFFFULL;
+  return word;
+}
+
+/* up to 8 digits are loaded into the last bytes of a word filled with '0' */
+static inline uint64_t ParseDigitsSWAR(const char *p, size_t n, bool &ok) {
+  uint64_t word = 0x3030303030303030ULL;
+  memcpy((char *)&word + 8 - n, p, n);
+  return ConvertDigitsSWAR(word, ok);
+}
+
+int RespParseShortLength(const char *p, long &value) {
+  uint64_t word;
+  memcpy(&word, p, 8);
+  /* the lowest byte which is \r has its high bit set, the bytes above it may be wrong */
+  uint64_t x = word ^ 0x0D0D0D0D0D0D0D0DULL;
+  uint64_t at_cr = (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+  if (at_cr == 0 || p[0] == '-') {
+    return 0;
+  }
+  int n = __builtin_ctzll(at_cr) / 8;
+  if (n == 7) {
+    return 0; /* its \n is not loaded */
+  }
+  if (n == 0 || p[n + 1] != '\n') {
+    return -1;
+  }
+  /* move the digits to the last bytes and fill the others with '0' */
+  word = (word << (64 - 8 * n)) | (0x3030303030303030ULL >> (8 * n));
+  bool ok = true;
+  value = (long)ConvertDigitsSWAR(word, ok);
+  return ok ? n : -1;
+}
+
+bool RespParseLength(const char *p, size_t len, long &value) {
+  bool negative = len > 0 && p[0] == '-';
+  p += negative;
+  len -= negative;
+  if (len == 0 || len > kRespMaxLengthDigits) {
+    return false;
+  }
+  bool ok = true;
+  /* the first chunk takes the digits which do not fill a whole word */
+  size_t chunk = (len - 1) % 8 + 1;
+  uint64_t result = ParseDigitsSWAR(p, chunk, ok);
+  for (size_t idx = chunk; idx < len; idx += 8) {
+    result = result * 100000000 + ParseDigitsSWAR(p + idx, 8, ok);
+  }
+  value = negative ? -(long)result : (long)result;
+  return ok;
+}
+
+#else
+
+int RespParseShortLength(const char *p, long &value) {
+  return 0;
+}
+
+bool RespParseLength(const char *p, size_t len, long &value) {
+  bool negative = len > 0 && p[0] == '-';
+  p += negative;
+  len -= negative;
+  if (len == 0 || len > kRespMaxLengthDigits) {
+    return false;
+  }
+  bool ok = true;
+  uint64_t result = 0;
+  for (size_t idx = 0; idx < len; ++idx) {
+    unsigned digit = (unsigned char)p[idx] - '0';
+    ok &= digit <= 9;
+    result = result * 10 + digit;
+  }
+  value = negative ? -(long)result : (long)result;
+  return ok;
+}
+
+#endif
+
+const char *RespKernelName() {
+  return sKernels->name;
+}
+
+bool RespUseKernel(const std::string &name) {
+  if (name == "scalar") {
+    sKernels = &kScalarKernels;
+    return true;
+  }
+#if defined(RESPSCAN_X86) && defined(__SSE2__)
+  if (name == "sse2") {
+    sKernels = &kSSE2Kernels;
+    return true;
+  }
+  if (name == "avx2" && SupportsAVX2()) {
+    sKernels = &kAVX2Kernels;
+    return true;
+  }
+#endif
+  return false;
+}
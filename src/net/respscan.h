@@ -0,0 +1,42 @@
+#ifndef __RESPSCAN_H__
+#define __RESPSCAN_H__
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Scanning kernels of the RESP parser. The widest kernels the cpu supports are picked at startup:
+ * avx2, sse2, or scalar.
+ */
+
+/* the first \r\n in [begin, end), end if there is none */
+const char *RespFindCRLF(const char *begin, const char *end);
+
+/* the first '$' or '*' in [begin, end), end if there is none */
+const char *RespFindPrefix(const char *begin, const char *end);
+
+/* maximum number of digits RespParseLength accepts, so that the value never overflows */
+constexpr size_t kRespMaxLengthDigits = 18;
+
+/**
+ * Parse len bytes at p as a decimal integer with an optional leading '-'.
+ * @return false if there are no digits, other bytes than digits, or more than
+ * kRespMaxLengthDigits digits.
+ */
+bool RespParseLength(const char *p, size_t len, long &value);
+
+/**
+ * Parse the digits of a length line at p, which has 8 readable bytes at least, in a few word
+ * operations when the line ends with \r\n within them.
+ * @return the number of digits before \r\n, 0 if the line does not fit into 8 bytes or is negative
+ * and RespParseLength has to be used, or -1 if it is invalid.
+ */
+int RespParseShortLength(const char *p, long &value);
+
+/* kernels in use: "avx2", "sse2" or "scalar" */
+const char *RespKernelName();
+
+/* switch to kernels by name, return false if the cpu does not support them */
+bool RespUseKernel(const std::string &name);
+
+#endif  // __RESPSCAN_H__
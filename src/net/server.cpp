@@ -5,23 +5,33 @@
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <cassert>
+#include <algorithm>
 #include "server.h"
 #include "utils.h"
 #include "protocol.h"
+#include "reactor.h"
 
 using namespace std::placeholders;
 
-int Server::next_session_id_ = 1;
+std::atomic<int> Server::next_session_id_{1};
 
 Server::Server(EventLoop *loop, Engine *engine, Config *config,
                const std::string &ip, uint16_t port)
-    : loop_(loop), engine_(engine), config_(config), addr_(ip, port) {
+    : loop_(loop), engine_(engine), config_(config), addr_(ip, port),
+      io_threads_(config != nullptr ? config->NumIOThreads() : 1) {
   if (loop == nullptr) {
     std::cerr << "No loop is specified for the server\n";
     exit(EXIT_FAILURE);
   }
   assert(config_ != nullptr);
+  if (config_->UringEnabled() && !loop_->epoller->UseUring(NET_URING_ENTRIES, config_->UringSqPoll())) {
+    std::cerr << "io_uring is not available, use epoll instead\n";
+  }
   InitListenSession();
+  loop_->before_poll = std::bind(&Server::FlushPendingWrites, this);
+  if (io_threads_.NumThreads() > 1) {
+    loop_->after_poll = std::bind(&Server::HandlePendingIO, this);
+  }
 }
 
 Server::~Server() {
@@ -46,6 +56,177 @@ bool Server::HasSubscriptionChannel(const std::string &chan_name) {
   return subscription_sessions_.find(chan_name) != subscription_sessions_.end();
 }
 
+void Server::BlockSession(Session *sess, const std::vector<std::string> &keys, const CommandCache &cmds,
+                          uint64_t timeout_ms, const std::string &timeout_reply) {
+  if (sess == nullptr || sessions_.find(sess->name) == sessions_.end()) {
+    return;
+  }
+  sess->SetBlockedMode();
+  sess->blocked_cmd = cmds;
+  sess->blocked_timeout_reply = timeout_reply;
+  sess->blocked_keys.clear();
+  for (auto &&key : keys) {
+    if (std::find(sess->blocked_keys.begin(), sess->blocked_keys.end(), key) != sess->blocked_keys.end()) {
+      continue;
+    }
+    sess->blocked_keys.push_back(key);
+    blocking_sessions_[key].push_back(sessions_[sess->name]);
+  }
+  if (timeout_ms > 0) {
+    std::string name = sess->name;
+    TimeEvent *tev = loop_->AddTimeEvent(timeout_ms, [this, name]() {
+      auto it = sessions_.find(name);
+      if (it == sessions_.end() || !it->second->IsBlocked()) {
+        return;
+      }
+      Session *session = it->second.get();
+      /* this time event is released by the holder after firing */
+      session->blocked_timer = NO_TIME_EVENT;
+      session->write_buf.Append(session->blocked_timeout_reply);
+      UnblockSession(session);
+      ProcessCommands(session);
+    }, 1);
+    if (tev != nullptr) {
+      sess->blocked_timer = tev->id;
+    }
+  }
+}
+
+void Server::SignalKeyAsReady(const std::string &key, bool all_waiters) {
+  auto it = blocking_sessions_.find(key);
+  if (it == blocking_sessions_.end() || it->second.empty()) {
+    return;
+  }
+  auto ready = std::find_if(ready_keys_.begin(), ready_keys_.end(),
+                            [&key](const std::pair<std::string, bool> &item) { return item.first == key; });
+  if (ready == ready_keys_.end()) {
+    ready_keys_.emplace_back(key, all_waiters);
+  } else {
+    ready->second = ready->second || all_waiters;
+  }
+}
+
+std::string Server::ExecuteCommand(CommandCache &cmds) {
+  OptionalHandlerParams params;
+  params.server = this;
+  std::string reply = engine_->HandleCommand(loop_, cmds, true, nullptr, &params);
+  HandleReadyKeys();
+  return reply;
+}
+
+void Server::Reply(Session *session, const std::string &reply) {
+  if (session->pending_replies.empty()) {
+    session->write_buf.Append(reply);
+  } else {
+    session->pending_replies.emplace_back(true, reply);
+  }
+}
+
+uint64_t Server::DeferReply(Session *session) {
+  session->pending_replies.emplace_back(false, "");
+  return session->n_replies_done + session->pending_replies.size() - 1;
+}
+
+void Server::DeliverReply(const std::string &sess_name, uint64_t seq, const std::string &reply) {
+  auto it = sessions_.find(sess_name);
+  if (it == sessions_.end()) {
+    return;
+  }
+  Session *session = it->second.get();
+  auto &pending = session->pending_replies;
+  assert(seq >= session->n_replies_done && seq - session->n_replies_done < pending.size());
+  auto &slot = pending[seq - session->n_replies_done];
+  slot.first = true;
+  slot.second = reply;
+  while (!pending.empty() && pending.front().first) {
+    session->write_buf.Append(pending.front().second);
+    pending.pop_front();
+    ++session->n_replies_done;
+  }
+  /* continue with the commands stalled behind the replies, it also triggers write */
+  ProcessCommands(session);
+}
+
+void Server::UnblockSession(Session *session) {
+  for (auto &&key : session->blocked_keys) {
+    auto it = blocking_sessions_.find(key);
+    if (it == blocking_sessions_.end()) {
+      continue;
+    }
+    it->second.remove_if([=](const SessionPtr &sess_ptr) { return sess_ptr.get() == session; });
+    if (it->second.empty()) {
+      blocking_sessions_.erase(it);
+    }
+  }
+  if (session->blocked_timer != NO_TIME_EVENT) {
+    loop_->RemoveTimeEvent(session->blocked_timer);
+    session->blocked_timer = NO_TIME_EVENT;
+  }
+  session->blocked_keys.clear();
+  session->blocked_cmd.Clear();
+  session->blocked_timeout_reply.clear();
+  session->UnsetBlockedMode();
+}
+
+void Server::HandleReadyKeys() {
+  /* waiters may push into other lists when they are served, those keys are handled in the same round */
+  if (handling_ready_keys_) {
+    return;
+  }
+  handling_ready_keys_ = true;
+  OptionalHandlerParams params;
+  params.server = this;
+  params.unblocking = true;
+  while (!ready_keys_.empty()) {
+    std::vector<std::pair<std::string, bool>> keys;
+    keys.swap(ready_keys_);
+    for (auto &&item : keys) {
+      const std::string &key = item.first;
+      if (item.second) {
+        /* every waiter gets its chance, one which still has nothing to read keeps on waiting */
+        auto it = blocking_sessions_.find(key);
+        if (it == blocking_sessions_.end()) {
+          continue;
+        }
+        std::vector<SessionPtr> waiters(it->second.begin(), it->second.end());
+        for (auto &&waiter : waiters) {
+          if (!waiter->IsBlocked() || std::find(waiter->blocked_keys.begin(), waiter->blocked_keys.end(),
+                                                key) == waiter->blocked_keys.end()) {
+            continue;
+          }
+          CommandCache cmd = waiter->blocked_cmd;
+          ReplyWriter reply(waiter->write_buf, waiter->write_chunks);
+          engine_->HandleCommand(loop_, cmd, reply, true, waiter.get(), &params);
+          if (reply.Written() == 0) {
+            continue;
+          }
+          UnblockSession(waiter.get());
+          ProcessCommands(waiter.get());
+        }
+        continue;
+      }
+      /* serve the waiters of key in FIFO order until the list is drained */
+      while (true) {
+        auto it = blocking_sessions_.find(key);
+        if (it == blocking_sessions_.end() || it->second.empty()) {
+          break;
+        }
+        SessionPtr waiter = it->second.front();
+        CommandCache cmd = waiter->blocked_cmd;
+        ReplyWriter reply(waiter->write_buf, waiter->write_chunks);
+        engine_->HandleCommand(loop_, cmd, reply, true, waiter.get(), &params);
+        if (reply.Written() == 0) {
+          break;  /* nothing left for the remaining waiters */
+        }
+        UnblockSession(waiter.get());
+        /* continue with the commands sent while it was blocked */
+        ProcessCommands(waiter.get());
+      }
+    }
+  }
+  handling_ready_keys_ = false;
+}
+
 void Server::StopServeSockets() {
   loop_->Stop();  /* we also need to stop the event loop, this go first */
   FreeListenSession();
@@ -72,9 +253,10 @@ void Server::InitListenSession() {
       nullptr,
       loop_, "listen_session");
   assert(listen_session_ != nullptr);
+  listen_session_->input = INPUT_ACCEPT;
+  listen(listen_fd_, SOMAXCONN);
   /* attach listen fd into epoll */
   loop_->epoller->AttachSession(listen_session_);
-  listen(listen_fd_, SOMAXCONN);
   listen_session_->watched = true;
 }
 
@@ -87,8 +269,13 @@ void Server::FreeListenSession() {
 }
 
 void Server::FreeClientSessions() {
-  /* free subscription_sessions_ and sessions_ */
+  pending_reads_.clear();
+  pending_writes_.clear();
+  scheduled_writes_.clear();
+  /* free subscription_sessions_, blocking_sessions_ and sessions_ */
   subscription_sessions_.clear();
+  blocking_sessions_.clear();
+  ready_keys_.clear();
   /* close all connected sessions */
   if (!sessions_.empty()) {
     for (auto&& session_pair : sessions_) {
@@ -101,37 +288,60 @@ void Server::FreeClientSessions() {
 }
 
 void Server::AcceptProc(Session *session, bool &closed) {
+  if (loop_->epoller->UsingUring()) {
+    /* connections are accepted by io_uring already */
+    while (!session->accepted_fds.empty()) {
+      int remote_fd = session->accepted_fds.front();
+      session->accepted_fds.pop_front();
+      Ipv4Addr addr;
+      socklen_t socklen = addr.GetSockAddrLen();
+      getpeername(remote_fd, addr.GetAddr(), &socklen);
+      AddClientSession(remote_fd, addr);
+    }
+    return;
+  }
   /* accept incoming connection(session) and process */
   Ipv4Addr addr;
   socklen_t socklen = addr.GetSockAddrLen();
   int remote_fd = accept(listen_fd_, addr.GetAddr(), &socklen);
   if (remote_fd != -1) {
-    addr.SyncPort();
-    // std::cout << "accepted connection from: " << addr.ToString() << std::endl;
-    char buf[64];
-    memset(buf, 0, sizeof(buf));
-    snprintf(buf, sizeof buf, "*%s#%d", addr.ToString().c_str(), next_session_id_++);
-    std::string sess_name = buf;
-    /* create a new session for every accepted connection */
-    Session *sess = new(std::nothrow) Session(
-        remote_fd, EPOLLIN,
-        std::bind(&Server::ReadProc, this, _1, _2),
-        std::bind(&Server::WriteProc, this, _1, _2),
-        loop_, sess_name);
-    // std::cout << "accepted  session = " << sess << std::endl;
-    if (sess != nullptr) {
-      /* attach new session into epoll */
-      SetFdNonBlock(remote_fd);
-      int interval = config_->KeepAliveInterval();
-      int idle = interval * 3;
-      int cnt = config_->KeepAliveCnt();
-      /* we use tcp keepalive to close broken socket connection */
-      SetKeepAlive(remote_fd, idle, interval, cnt);
-      if (loop_->epoller->AttachSession(sess)) {
-        // std::cout << "fd=" << sess->fd << " added into eventloop watch\n";
-        sess->watched = true;
-        sessions_[sess_name] = std::shared_ptr<Session>(sess);
-      }
+    AddClientSession(remote_fd, addr);
+  }
+}
+
+void Server::AddClientSession(int remote_fd, Ipv4Addr &addr) {
+  addr.SyncPort();
+  // std::cout << "accepted connection from: " << addr.ToString() << std::endl;
+  char buf[64];
+  memset(buf, 0, sizeof(buf));
+  snprintf(buf, sizeof buf, "*%s#%d", addr.ToString().c_str(), next_session_id_++);
+  std::string sess_name = buf;
+  /* create a new session for every accepted connection */
+  Session *sess = new(std::nothrow) Session(
+      remote_fd, EPOLLIN,
+      std::bind(&Server::ReadProc, this, _1, _2),
+      std::bind(&Server::WriteProc, this, _1, _2),
+      loop_, sess_name);
+  // std::cout << "accepted  session = " << sess << std::endl;
+  if (sess != nullptr) {
+    /* attach new session into epoll */
+    SetFdNonBlock(remote_fd);
+    int interval = config_->KeepAliveInterval();
+    int idle = interval * 3;
+    int cnt = config_->KeepAliveCnt();
+    /* we use tcp keepalive to close broken socket connection */
+    SetKeepAlive(remote_fd, idle, interval, cnt);
+    if (loop_->epoller->UsingUring()) {
+      /* requests are received by io_uring, replies are sent by it without MSG_ZEROCOPY */
+      sess->input = INPUT_RECV;
+    } else if (config_->ZeroCopyThreshold() > 0 && EnableZeroCopy(remote_fd) == OK) {
+      sess->zerocopy_threshold = config_->ZeroCopyThreshold();
+      sess->error_proc = std::bind(&Server::ErrorProc, this, _1, _2);
+    }
+    if (loop_->epoller->AttachSession(sess)) {
+      // std::cout << "fd=" << sess->fd << " added into eventloop watch\n";
+      sess->watched = true;
+      sessions_[sess_name] = std::shared_ptr<Session>(sess);
     }
   }
 }
@@ -139,53 +349,196 @@ void Server::AcceptProc(Session *session, bool &closed) {
 void Server::AuxiliaryReadProcParseErrorHandling(Session *session) {
   if (!session) return;
   /* Fill write buffer with error msg and send them back to client */
-  FillErrorMsg(session->write_buf, ErrType::WRONGREQ, "unidentified request\r\n");
+  if (session->pending_replies.empty()) {
+    FillErrorMsg(session->write_buf, ErrType::WRONGREQ, "unidentified request\r\n");
+  } else {
+    Buffer err_buf;
+    FillErrorMsg(err_buf, ErrType::WRONGREQ, "unidentified request\r\n");
+    Reply(session, err_buf.ReadableAsString());
+  }
   /* trigger write */
-  session->SetWrite();
-  loop_->epoller->ModifySession(session);
+  ScheduleWrite(session);
+}
+
+void Server::CloseSession(Session *session) {
+  if (loop_->epoller->UsingUring()) {
+    /* the requests of io_uring on the fd are cancelled */
+    loop_->epoller->DetachSession(session);
+  }
+  session->watched = false;
+  session->read_buf.Reset();
+  session->ClearOutput();
+  if (session->write_scheduled) {
+    scheduled_writes_.erase(std::remove(scheduled_writes_.begin(), scheduled_writes_.end(), session),
+                            scheduled_writes_.end());
+  }
+  close(session->fd);
+  /* remove sessions from subscription */
+  if (!session->subscribed_channels.empty()) {
+    for (auto it = session->subscribed_channels.begin(); it != session->subscribed_channels.end(); it++) {
+      subscription_sessions_[*it].remove_if([=] (const SessionPtr& sess_ptr) { return sess_ptr->name == session->name; });
+    }
+  }
+  if (session->IsBlocked()) {
+    UnblockSession(session);
+  }
+  sessions_.erase(session->name);
+}
+
+/**
+ * Read from socket into read buffer, the commands still waiting stop referring to the buffer. The
+ * rest of a large argument is read straight into its place in the buffer, which is allocated once.
+ * @return the number of bytes read, 0 if the connection is closed.
+ */
+static int ReadIntoReadBuf(Session *session) {
+  for (CommandCache &cmds : session->parsed_cmds) {
+    cmds.Own();
+  }
+  Buffer &buffer = session->read_buf;
+  if (session->input == INPUT_RECV) {
+    /* the bytes are received by io_uring, they are taken without copying if nothing is left */
+    int nbytes = (int)session->received.ReadableBytes();
+    if (buffer.ReadableBytes() == 0) {
+      buffer.Swap(session->received);
+    } else {
+      buffer.Append(session->received.BeginRead(), nbytes);
+    }
+    session->received.ReaderIdxForward(nbytes);
+    return nbytes;
+  }
+  size_t remaining = session->parse_state.BulkRemaining(buffer.ReadableBytes());
+  if (remaining > (size_t)NET_READ_BUF_SIZE) {
+    buffer.EnsureBytesForWrite(remaining);
+    int nbytes = ReadToBuf(session->fd, buffer.BeginWrite(), (int)remaining);
+    buffer.WriterIdxForward(nbytes);
+    return nbytes;
+  }
+  char buf[NET_READ_BUF_SIZE];
+  int nbytes = ReadToBuf(session->fd, buf, sizeof(buf));
+  buffer.Append(buf, nbytes);
+  return nbytes;
 }
 
-/* FIXME: Can not handle huge flow of request coming in */
 void Server::ReadProc(Session *session, bool &closed) {
   // static int64_t n_total_bytes_recv = 0;
   // static int64_t n_response = 0;
 
-  int fd = session->fd;
-  Buffer &buffer = session->read_buf;
-  CommandCache &cache = session->cache;
-  char buf[NET_READ_BUF_SIZE];
-  int nbytes = ReadToBuf(fd, buf, sizeof(buf));
+  if (io_threads_.NumThreads() > 1) {
+    /* read by io threads after all fired events are collected */
+    pending_reads_.push_back(session);
+    return;
+  }
+  int nbytes = ReadIntoReadBuf(session);
   if (nbytes == 0) {
     /* close connection */
-    session->watched = false;
-    buffer.Reset();
-    close(fd);
-    /* remove sessions from subscription */
-    if (!session->subscribed_channels.empty()) {
-      for (auto it = session->subscribed_channels.begin(); it != session->subscribed_channels.end(); it++) {
-        subscription_sessions_[*it].remove_if([=] (const SessionPtr& sess_ptr) { return sess_ptr->name == session->name; });
-      }
-    }
-    sessions_.erase(session->name);
+    CloseSession(session);
     // std::cout << "Client-" << session->fd << " exit, now close connection...\n";
     closed = true;
     return;
   }
   // std::cout << "Received bytes = " << nbytes << std::endl;
   // n_total_bytes_recv += nbytes;
-  buffer.Append(buf, nbytes);
+  ProcessCommands(session);
+}
+
+/* run by io threads: read from socket and parse all complete requests */
+static void ReadAndParseJob(Session *session) {
+  session->io_nbytes = ReadIntoReadBuf(session);
+  if (session->io_nbytes == 0) {
+    return;
+  }
+  Buffer &buffer = session->read_buf;
+  if (session->parse_err) {
+    return;  /* the error is not replied yet */
+  }
+  CommandCache cache;
+  bool err = false;
+  while (TryParseFromBuffer(buffer, session->parse_state, cache, err) && !err) {
+    session->parsed_cmds.emplace_back(std::move(cache));
+    cache.Clear();
+  }
+  session->parse_err = err;
+}
+
+/* run by io threads: send write buffer and chunks */
+static void WriteJob(Session *session) {
+  session->io_nbytes = session->WriteOutput();
+}
+
+void Server::HandlePendingIO() {
+  if (!pending_reads_.empty()) {
+    io_threads_.Run(pending_reads_, ReadAndParseJob);
+    for (Session *session : pending_reads_) {
+      if (session->io_nbytes == 0) {
+        /* writes of this session in the same round are dropped before it is released */
+        pending_writes_.erase(std::remove(pending_writes_.begin(), pending_writes_.end(), session),
+                              pending_writes_.end());
+        CloseSession(session);
+        continue;
+      }
+      ProcessCommands(session);
+    }
+    pending_reads_.clear();
+  }
+  if (!pending_writes_.empty()) {
+    io_threads_.Run(pending_writes_, WriteJob);
+    for (Session *session : pending_writes_) {
+      bool closed = false;
+      AfterWrite(session, session->io_nbytes, closed);
+    }
+    pending_writes_.clear();
+  }
+}
+
+/* next command of session, parsed by io threads or from read buffer */
+static bool NextCommand(Session *session, bool &err) {
+  if (!session->parsed_cmds.empty()) {
+    session->cache = std::move(session->parsed_cmds.front());
+    session->parsed_cmds.pop_front();
+    return true;
+  }
+  if (session->parse_err) {
+    session->parse_err = false;
+    err = true;
+    return false;
+  }
+  return TryParseFromBuffer(session->read_buf, session->parse_state, session->cache, err);
+}
 
+void Server::ProcessCommands(Session *session) {
+  CommandCache &cache = session->cache;
   bool err = false;
-  while (TryParseFromBuffer(buffer, cache, err) && !err) {
+  /* a blocked session keeps the following commands in buffer until it is unblocked */
+  while (!session->IsBlocked() && NextCommand(session, err) && !err) {
+    if (reactor_ != nullptr) {
+      DispatchResult dispatched = reactor_->Dispatch(session, cache);
+      if (dispatched == DISPATCH_STALLED) {
+        /* taken again once the earlier replies are back */
+        session->parsed_cmds.push_front(std::move(cache));
+        cache.Clear();
+        break;
+      }
+      if (dispatched == DISPATCH_DONE) {
+        cache.Clear();
+        continue;
+      }
+    }
     sOptionalHandlerParamsObj.server = this;
-    std::string handle_result = engine_->HandleCommand(loop_, cache, true, session, &sOptionalHandlerParamsObj);
-    session->write_buf.Append(handle_result);
+    if (session->pending_replies.empty()) {
+      /* nothing to wait for, the reply goes straight into the write buffer */
+      ReplyWriter reply(session->write_buf, session->write_chunks);
+      engine_->HandleCommand(loop_, cache, reply, true, session, &sOptionalHandlerParamsObj);
+    } else {
+      Reply(session, engine_->HandleCommand(loop_, cache, true, session, &sOptionalHandlerParamsObj));
+    }
     // n_response++;
     /* clear cache when one command is fully parsed */
     cache.Clear();
+    HandleReadyKeys();
+  }
+  if (session->write_buf.ReadableBytes() > 0) {
+    ScheduleWrite(session);
   }
-  session->SetWrite();
-  loop_->epoller->ModifySession(session);
   /* if err occurs, then we assume the command syntax is invalid */
   if (err) {
     AuxiliaryReadProcParseErrorHandling(session);
@@ -198,8 +551,35 @@ void Server::FillErrorMsg(Buffer &buffer, ErrType errtype, const char *msg) cons
   buffer.Append(err_str);
 }
 
+void Server::ScheduleWrite(Session *session) {
+  if (session->write_scheduled || (session->mask & EPOLLOUT)) {
+    return;  /* sent in this round already, or once the socket is writable */
+  }
+  session->write_scheduled = true;
+  scheduled_writes_.push_back(session);
+}
+
+void Server::FlushPendingWrites() {
+  if (scheduled_writes_.empty()) {
+    return;
+  }
+  std::vector<Session *> sessions;
+  sessions.swap(scheduled_writes_);
+  for (Session *session : sessions) {
+    session->write_scheduled = false;
+  }
+  if (loop_->epoller->UsingUring()) {
+    loop_->epoller->SendOutputs(sessions);
+  } else {
+    io_threads_.Run(sessions, WriteJob);
+  }
+  for (Session *session : sessions) {
+    bool closed = false;
+    AfterWrite(session, session->io_nbytes, closed);
+  }
+}
+
 void Server::WriteProc(Session *session, bool &closed) {
-  int fd = session->fd;
   Buffer &buffer = session->write_buf;
   if (buffer.ReadableBytes() <= 0) {
     /* nothing to write */
@@ -207,28 +587,48 @@ void Server::WriteProc(Session *session, bool &closed) {
     loop_->epoller->ModifySession(session);
     return;
   }
+  if (io_threads_.NumThreads() > 1) {
+    /* written by io threads after all fired events are collected */
+    pending_writes_.push_back(session);
+    return;
+  }
   // std::cout << "Doing write process, write buffer is => " << buffer.ReadableAsString() << std::endl;
   /* ensure all data has been sent, then unregister EPOLLOUT to this fd */
-  size_t readable_bytes = buffer.ReadableBytes(); /* the number of bytes ready to send */
-  int nbytes = WriteFromBuf(fd, static_cast<const char *>(buffer.BeginRead()), readable_bytes);
-  if ((size_t) nbytes > 0) {
-    if ((size_t) nbytes == readable_bytes) {
-      /* all bytes have been sent. no need to send in the recent future.*/
-      session->SetRead();
-      loop_->epoller->ModifySession(session);
-      /* clear buffer */
-      buffer.Reset();
-    } else {
-      /* consume nbytes in buffer */
-      buffer.ReaderIdxForward(nbytes);
-    }
+  int nbytes = session->WriteOutput();
+  AfterWrite(session, nbytes, closed);
+}
+
+void Server::ErrorProc(Session *session, bool &closed) {
+  if (session->ReapZeroCopy() > 0) {
+    return;
   }
-  if (nbytes == 0 && buffer.ReadableBytes() != 0) {
-    session->watched = false;
-    buffer.Reset();
-    close(fd);
+  /* not a notification of zero copy sends, but an error of the connection */
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if (getsockopt(session->fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1 || err != 0) {
+    CloseSession(session);
+    closed = true;
+  }
+}
+
+void Server::AfterWrite(Session *session, int nbytes, bool &closed) {
+  if (nbytes < 0) {
     // std::cout << "[Server::WriteProc] Client exit, now close connection from " << session->name << '\n';
-    sessions_.erase(session->name);
+    CloseSession(session);
     closed = true;
+    return;
+  }
+  /* consume nbytes in buffer and release the chunks sent */
+  session->ConsumeOutput(nbytes);
+  if (session->OutputBytes() == 0) {
+    /* all bytes have been sent. no need to send in the recent future.*/
+    session->SetRead();
+    /* clear buffer */
+    session->write_buf.Reset();
+  } else {
+    /* socket buffer is full, the rest is sent once it is writable */
+    session->SetWrite();
   }
+  /* epoll_ctl is only called if EPOLLOUT is watched or unwatched */
+  loop_->epoller->ModifySession(session);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef __SERVER_H__
 #define __SERVER_H__
 
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <list>
@@ -9,11 +10,14 @@
 #include "addr.h"
 #include "net.h"
 #include "commands.h"
+#include "iothreads.h"
 #include "../config.h"
 
 constexpr int NET_READ_BUF_SIZE = 1024 * 64;
+constexpr unsigned NET_URING_ENTRIES = 4096;  /* submission entries of the ring of every loop */
 
 class Engine; /* in commands.h */
+class Reactor; /* in reactor.h */
 
 enum ErrType {
   WRONGREQ = 0, /* can not parse request */
@@ -70,6 +74,60 @@ public:
 
   void StopServeSockets();
 
+  /**
+   * Park the session on list keys until one of them gets new items or timeout.
+   * @param sess The session to be blocked.
+   * @param keys The keys to wait for.
+   * @param cmds The blocking command, it is re-executed when one of the keys is ready.
+   * @param timeout_ms Timeout in milliseconds, 0 means waiting forever.
+   * @param timeout_reply The reply sent back to client when timeout.
+   */
+  void BlockSession(Session* sess, const std::vector<std::string>& keys, const CommandCache& cmds,
+                    uint64_t timeout_ms, const std::string& timeout_reply);
+
+  /**
+   * Mark key as ready if there are sessions blocked on it.
+   * Those sessions are served in FIFO order right after the current command.
+   * @param key The key which just got new items.
+   * @param all_waiters Try every waiter even if one of them can not be served, for waiters
+   *                    which only read the new items instead of consuming them.
+   */
+  void SignalKeyAsReady(const std::string& key, bool all_waiters = false);
+
+  /* route commands through reactor, which owns a slice of the keyspace */
+  void SetReactor(Reactor *reactor) { reactor_ = reactor; }
+
+  /**
+   * Execute a command sent by another reactor, which is not bound to any session here.
+   * @return Reply string.
+   */
+  std::string ExecuteCommand(CommandCache &cmds);
+
+  /* queue reply of session behind the replies which are still waited for */
+  void Reply(Session *session, const std::string &reply);
+
+  /**
+   * Reserve a place for a reply which comes later, in request order.
+   * @return The sequence number of the reply, which is passed to DeliverReply.
+   */
+  uint64_t DeferReply(Session *session);
+
+  /**
+   * Fill in a reserved reply and send the replies which are ready in request order.
+   * It does nothing if the session is closed in the meantime.
+   */
+  void DeliverReply(const std::string &sess_name, uint64_t seq, const std::string &reply);
+
+  bool HasSession(const std::string &sess_name) const {
+    return sessions_.find(sess_name) != sessions_.end();
+  }
+
+  /**
+   * Send the output of the sessions which got replies in this iteration, called before the loop
+   * polls again. EPOLLOUT is only watched for the sessions whose output is not sent entirely.
+   */
+  void FlushPendingWrites();
+
 private:
   void InitListenSession();
 
@@ -79,10 +137,34 @@ private:
 
   void AcceptProc(Session* session, bool&);
 
+  /* create and attach the session of an accepted connection */
+  void AddClientSession(int remote_fd, Ipv4Addr &addr);
+
   void ReadProc(Session* session, bool&);
 
   void WriteProc(Session* session, bool&);
 
+  /* read notifications of zero copy sends, or close session on a connection error */
+  void ErrorProc(Session* session, bool&);
+
+  /* update session after nbytes of write buffer and chunks are sent */
+  void AfterWrite(Session* session, int nbytes, bool& closed);
+
+  /* detach and release session whose connection is closed */
+  void CloseSession(Session* session);
+
+  /* send output of session in FlushPendingWrites, unless it is waiting for EPOLLOUT */
+  void ScheduleWrite(Session* session);
+
+  /* reads and writes deferred for io threads */
+  void HandlePendingIO();
+
+  void ProcessCommands(Session *session);
+
+  void UnblockSession(Session *session);
+
+  void HandleReadyKeys();
+
   void AuxiliaryReadProcParseErrorHandling(Session *session);
 
   void FillErrorMsg(Buffer& buffer, ErrType errtype, const char* msg) const;
@@ -97,8 +179,20 @@ private:
   std::unordered_map<std::string, SessionPtr> sessions_;
   /* all the connected sessions that have subscribed channels */
   std::unordered_map<std::string, std::list<SessionPtr>> subscription_sessions_;
-  static int next_session_id_;
+  /* the sessions blocked on every key in FIFO order */
+  std::unordered_map<std::string, std::list<SessionPtr>> blocking_sessions_;
+  /* keys with blocked sessions which got new items, and whether all waiters should be tried */
+  std::vector<std::pair<std::string, bool>> ready_keys_;
+  bool handling_ready_keys_ = false;
+  static std::atomic<int> next_session_id_;
   Session *listen_session_ = nullptr;
+  IOThreadPool io_threads_;
+  /* sessions with fired events, handled by io threads after all events of one iteration */
+  std::vector<Session*> pending_reads_;
+  std::vector<Session*> pending_writes_;
+  /* sessions with replies to send before the next poll */
+  std::vector<Session*> scheduled_writes_;
+  Reactor *reactor_ = nullptr;  /* not owned */
 };
 
 /**
@@ -107,9 +201,11 @@ private:
  */
 struct OptionalHandlerParams {
   Server* server;
+  /* the command is re-executed for a blocked session, it should not block again */
+  bool unblocking = false;
 };
 
-static OptionalHandlerParams sOptionalHandlerParamsObj; /* global */
+static thread_local OptionalHandlerParams sOptionalHandlerParamsObj; /* global, one for every reactor thread */
 
 
 #endif // __SERVER_H__
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "uring.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_RECV_MULTISHOT) && defined(__NR_io_uring_setup)
+#define NET_URING
+#endif
+#endif
+#endif
+
+#ifdef NET_URING
+
+/* one mapping for both rings, no completion dropped, and waiting with a timeout, all since 5.11 */
+static constexpr unsigned kRequiredFeatures =
+    IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+
+/* the only group of provided buffers of a ring */
+static constexpr uint16_t kBufferGroup = 0;
+
+/* bytes of one write in WriteAndSync at most, the length of a request is 32 bits */
+static constexpr size_t kMaxWriteAndSync = 1 << 30;
+
+IoUring::~IoUring() {
+  /* the kernel drops its references to the rings and buffers first */
+  if (ring_fd_ != -1) {
+    close(ring_fd_);
+  }
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (ring_ptr_ != nullptr) {
+    munmap(ring_ptr_, ring_size_);
+  }
+  free(buf_ring_);
+  free(buffers_);
+}
+
+bool IoUring::Init(unsigned entries, bool sqpoll) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  if (sqpoll) {
+    params.flags |= IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = 1000;  /* ms before the kernel thread sleeps */
+  }
+  int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (fd < 0) {
+    return false;
+  }
+  ring_fd_ = fd;
+  sqpoll_ = sqpoll;
+  if ((params.features & kRequiredFeatures) != kRequiredFeatures) {
+    return false;
+  }
+  size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring_size_ = sq_size > cq_size ? sq_size : cq_size;
+  void *ptr = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                   IORING_OFF_SQ_RING);
+  if (ptr == MAP_FAILED) {
+    return false;
+  }
+  ring_ptr_ = ptr;
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  ptr = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+             IORING_OFF_SQES);
+  if (ptr == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = static_cast<struct io_uring_sqe *>(ptr);
+
+  char *base = static_cast<char *>(ring_ptr_);
+  sq_head_ = reinterpret_cast<unsigned *>(base + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(base + params.sq_off.tail);
+  sq_flags_ = reinterpret_cast<unsigned *>(base + params.sq_off.flags);
+  sq_array_ = reinterpret_cast<unsigned *>(base + params.sq_off.array);
+  sq_mask_ = *reinterpret_cast<unsigned *>(base + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sq_local_tail_ = *sq_tail_;
+  cq_head_ = reinterpret_cast<unsigned *>(base + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(base + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned *>(base + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe *>(base + params.cq_off.cqes);
+  return true;
+}
+
+struct io_uring_sqe *IoUring::GetSqe() {
+  while (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+    /* the kernel thread of sqpoll may still be taking them */
+    int ret = Submit();
+    if (ret < 0 && ret != -EINTR && ret != -EAGAIN) {
+      return nullptr;
+    }
+  }
+  unsigned idx = sq_local_tail_ & sq_mask_;
+  struct io_uring_sqe *sqe = &sqes_[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  sq_array_[idx] = idx;
+  ++sq_local_tail_;
+  return sqe;
+}
+
+int IoUring::Submit(unsigned wait_nr, int timeout_ms) {
+  unsigned to_submit = sq_local_tail_ - *sq_tail_;
+  __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+  unsigned flags = 0;
+  if (sqpoll_) {
+    /* the kernel thread takes the entries by itself, unless it is sleeping */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(sq_flags_, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+      flags |= IORING_ENTER_SQ_WAKEUP;
+    }
+  }
+  if (wait_nr > 0 || (__atomic_load_n(sq_flags_, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW)) {
+    flags |= IORING_ENTER_GETEVENTS;
+  }
+  if (flags == 0 && (sqpoll_ || to_submit == 0)) {
+    return (int)to_submit;  /* no system call needed */
+  }
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  const void *argp = nullptr;
+  size_t argsz = 0;
+  if (wait_nr > 0 && timeout_ms >= 0) {
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = (uint64_t)(uintptr_t)&ts;
+    flags |= IORING_ENTER_EXT_ARG;
+    argp = &arg;
+    argsz = sizeof(arg);
+  }
+  int ret = (int)syscall(__NR_io_uring_enter, ring_fd_, sqpoll_ ? 0 : to_submit, wait_nr, flags,
+                         argp, argsz);
+  return ret < 0 ? -errno : ret;
+}
+
+bool IoUring::PopCompletion(UringCompletion &completion) {
+  unsigned head = *cq_head_;
+  if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  const struct io_uring_cqe *cqe = &cqes_[head & cq_mask_];
+  completion.user_data = cqe->user_data;
+  completion.res = cqe->res;
+  completion.more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+  completion.buffer_id = (cqe->flags & IORING_CQE_F_BUFFER) ? (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+  __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool IoUring::SetupBuffers(unsigned count, unsigned size) {
+  if (count == 0 || (count & (count - 1)) != 0 || count > 32768 || buf_ring_ != nullptr) {
+    return false;
+  }
+  void *ring = nullptr;
+  size_t ring_bytes = count * sizeof(struct io_uring_buf);
+  if (posix_memalign(&ring, (size_t)sysconf(_SC_PAGESIZE), ring_bytes) != 0) {
+    return false;
+  }
+  memset(ring, 0, ring_bytes);
+  buffers_ = static_cast<char *>(malloc((size_t)count * size));
+  if (buffers_ == nullptr) {
+    free(ring);
+    return false;
+  }
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)ring;
+  reg.ring_entries = count;
+  reg.bgid = kBufferGroup;
+  if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    free(ring);
+    return false;
+  }
+  buf_ring_ = static_cast<struct io_uring_buf_ring *>(ring);
+  buffer_count_ = count;
+  buffer_size_ = size;
+  for (unsigned bid = 0; bid < count; ++bid) {
+    RecycleBuffer((int)bid);
+  }
+  return true;
+}
+
+void IoUring::RecycleBuffer(int bid) {
+  /* not buf_ring_->bufs, whose empty struct ahead shifts it by 8 bytes in C++ */
+  struct io_uring_buf *buf = reinterpret_cast<struct io_uring_buf *>(buf_ring_) + (buf_tail_ & (buffer_count_ - 1));
+  buf->addr = (uint64_t)(uintptr_t)BufferOf(bid);
+  buf->len = buffer_size_;
+  buf->bid = (uint16_t)bid;
+  ++buf_tail_;
+  __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+}
+
+bool IoUring::AddAccept(int fd, uint64_t user_data) {
+  struct io_uring_sqe *sqe = GetSqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool IoUring::AddRecv(int fd, uint64_t user_data) {
+  struct io_uring_sqe *sqe = buf_ring_ != nullptr ? GetSqe() : nullptr;
+  if (sqe == nullptr) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufferGroup;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool IoUring::AddPoll(int fd, uint32_t events, bool multishot, uint64_t user_data) {
+  struct io_uring_sqe *sqe = GetSqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  events = (events << 16) | (events >> 16);  /* the kernel reads them as two 16-bit halves */
+#endif
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = events;
+  sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool IoUring::AddSendMsg(int fd, const struct msghdr *msg, int flags, uint64_t user_data) {
+  struct io_uring_sqe *sqe = GetSqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)msg;
+  sqe->len = 1;
+  sqe->msg_flags = (uint32_t)flags;
+  sqe->user_data = user_data;
+  return true;
+}
+
+bool IoUring::AddCancel(uint64_t target, uint64_t user_data) {
+  struct io_uring_sqe *sqe = GetSqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = target;
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+  sqe->user_data = user_data;
+  return true;
+}
+
+int IoUring::WriteAndSync(int fd, const char *data, size_t len) {
+  size_t off = 0;
+  do {
+    /* the sync is linked after the write, it is cancelled if the write is short */
+    unsigned n = (unsigned)std::min(len - off, kMaxWriteAndSync);
+    struct io_uring_sqe *sqe;
+    if (n > 0) {
+      if ((sqe = GetSqe()) == nullptr) {
+        return -EBUSY;
+      }
+      sqe->opcode = IORING_OP_WRITE;
+      sqe->fd = fd;
+      sqe->addr = (uint64_t)(uintptr_t)(data + off);
+      sqe->len = n;
+      sqe->off = (uint64_t)-1;  /* at the current position of fd */
+      sqe->flags = IOSQE_IO_LINK;
+      sqe->user_data = 0;
+    }
+    if ((sqe = GetSqe()) == nullptr) {
+      return -EBUSY;  /* never for a ring used only here, the write is not submitted yet */
+    }
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = fd;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    sqe->user_data = 1;
+    unsigned expected = n > 0 ? 2 : 1, got = 0;
+    int written = 0, synced = 0;
+    while (got < expected) {
+      UringCompletion completion;
+      if (PopCompletion(completion)) {
+        (completion.user_data == 0 ? written : synced) = completion.res;
+        ++got;
+      } else {
+        Submit(expected - got);  /* the bytes are referred to until completed, so wait anyway */
+      }
+    }
+    if (written < 0) {
+      return written;
+    }
+    if (n > 0 && written == 0) {
+      return -EIO;
+    }
+    off += written;
+    if ((unsigned)written == n && synced < 0) {
+      return synced;
+    }
+  } while (off < len);
+  return 0;
+}
+
+#else
+
+/* every request fails, Init tells the caller to use plain system calls instead */
+
+IoUring::~IoUring() {}
+
+bool IoUring::Init(unsigned entries, bool sqpoll) {
+  return false;
+}
+
+bool IoUring::SetupBuffers(unsigned count, unsigned size) {
+  return false;
+}
+
+void IoUring::RecycleBuffer(int bid) {}
+
+bool IoUring::AddAccept(int fd, uint64_t user_data) {
+  return false;
+}
+
+bool IoUring::AddRecv(int fd, uint64_t user_data) {
+  return false;
+}
+
+bool IoUring::AddPoll(int fd, uint32_t events, bool multishot, uint64_t user_data) {
+  return false;
+}
+
+bool IoUring::AddSendMsg(int fd, const struct msghdr *msg, int flags, uint64_t user_data) {
+  return false;
+}
+
+bool IoUring::AddCancel(uint64_t target, uint64_t user_data) {
+  return false;
+}
+
+int IoUring::Submit(unsigned wait_nr, int timeout_ms) {
+  return -ENOSYS;
+}
+
+bool IoUring::PopCompletion(UringCompletion &completion) {
+  return false;
+}
+
+int IoUring::WriteAndSync(int fd, const char *data, size_t len) {
+  return -ENOSYS;
+}
+
+struct io_uring_sqe *IoUring::GetSqe() {
+  return nullptr;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef __URING_H__
+#define __URING_H__
+
+#include <cstddef>
+#include <cstdint>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+struct msghdr;
+
+/* one completion taken from the ring */
+struct UringCompletion {
+  uint64_t user_data;
+  int res;         /* result of the request, -errno on failure */
+  bool more;       /* a multishot request goes on producing completions */
+  int buffer_id;   /* provided buffer holding the received bytes, -1 if none */
+};
+
+/**
+ * A minimal io_uring over the raw system calls, so that liburing is not needed. Every instance is
+ * used by one thread only. Init fails without io_uring or on kernels older than 5.11, SetupBuffers
+ * fails before 5.19, the caller falls back to plain system calls then.
+ * Requests are queued by the Add functions and submitted together by the next Submit.
+ */
+class IoUring {
+public:
+  IoUring() = default;
+
+  ~IoUring();
+
+  IoUring(const IoUring &) = delete;
+
+  IoUring &operator=(const IoUring &) = delete;
+
+  /**
+   * Set up the rings with entries submission entries, with a kernel thread polling the
+   * submission queue if sqpoll.
+   * @return false if io_uring is not supported or lacks the features used here.
+   */
+  bool Init(unsigned entries, bool sqpoll);
+
+  /**
+   * Provide count buffers of size bytes for AddRecv, a receive picks one of them and reports its
+   * id in the completion. count must be a power of 2.
+   */
+  bool SetupBuffers(unsigned count, unsigned size);
+
+  inline char *BufferOf(int bid) const { return buffers_ + (size_t)bid * buffer_size_; }
+
+  /* give the buffer back to the kernel after its bytes are taken */
+  void RecycleBuffer(int bid);
+
+  /* multishot accept on listening fd, every connection completes with its non-blocking fd */
+  bool AddAccept(int fd, uint64_t user_data);
+
+  /* multishot receive into the provided buffers, 0 or an error completes the request */
+  bool AddRecv(int fd, uint64_t user_data);
+
+  /* poll fd for events, which are reported in the result, until cancelled if multishot */
+  bool AddPoll(int fd, uint32_t events, bool multishot, uint64_t user_data);
+
+  /* sendmsg, msg and what it refers to must stay valid until completed */
+  bool AddSendMsg(int fd, const struct msghdr *msg, int flags, uint64_t user_data);
+
+  /* cancel every request queued with target as user data */
+  bool AddCancel(uint64_t target, uint64_t user_data);
+
+  /**
+   * Submit the requests added since the last call and wait for wait_nr completions, or timeout_ms
+   * at most if it is not -1.
+   * @return The number of requests submitted, or -errno. -ETIME and -EINTR only end the wait.
+   */
+  int Submit(unsigned wait_nr = 0, int timeout_ms = -1);
+
+  /* take the oldest completion, false if there is none */
+  bool PopCompletion(UringCompletion &completion);
+
+  /**
+   * Append len bytes to fd and flush them to disk like fdatasync, the two are submitted together
+   * and waited for. Only for a ring which is not used for anything else.
+   * @return 0 on success, or -errno.
+   */
+  int WriteAndSync(int fd, const char *data, size_t len);
+
+private:
+  /* a cleared submission entry to fill, pending entries are submitted first if the queue is full */
+  struct io_uring_sqe *GetSqe();
+
+private:
+  int ring_fd_ = -1;
+  bool sqpoll_ = false;
+
+  void *ring_ptr_ = nullptr;
+  size_t ring_size_ = 0;
+  struct io_uring_sqe *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned *sq_head_ = nullptr;
+  unsigned *sq_tail_ = nullptr;
+  unsigned *sq_flags_ = nullptr;
+  unsigned *sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned sq_local_tail_ = 0;  /* entries up to it are filled, published to the kernel by Submit */
+
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  struct io_uring_cqe *cqes_ = nullptr;
+
+  struct io_uring_buf_ring *buf_ring_ = nullptr;
+  char *buffers_ = nullptr;
+  unsigned buffer_count_ = 0;
+  unsigned buffer_size_ = 0;
+  uint16_t buf_tail_ = 0;
+};
+
+#endif // __URING_H__
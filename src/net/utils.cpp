@@ -3,9 +3,8 @@
 int ReadToBuf(int fd, char *buf, int len) {
   int total_read = 0;
   int bytes_read = 0;
-  memset(buf, 0, len);
   while (total_read < len) {
-    bytes_read = ::read(fd, buf + bytes_read, len - total_read);
+    bytes_read = ::read(fd, buf + total_read, len - total_read);
     if (bytes_read > 0) { /* read normally */
       total_read += bytes_read;
     } else if (bytes_read == 0) { /* remote peer closed */
@@ -26,7 +25,7 @@ int WriteFromBuf(int fd, const char *buf, int len) {
   int total_written = 0;
   int bytes_written = 0;
   while (total_written < len) {
-    bytes_written = ::send(fd, buf + bytes_written, len - total_written, 0);
+    bytes_written = ::send(fd, buf + total_written, len - total_written, 0);
     if (bytes_written > 0) {
       total_written += bytes_written;
     } else if (bytes_written == -1) { /* error */
@@ -110,3 +109,16 @@ int SetKeepAlive(int fd, int idle, int interal, int cnt) {
   }
   return OK;
 }
+
+int EnableZeroCopy(int fd) {
+#ifdef SO_ZEROCOPY
+  int val = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) == -1) {
+    std::cerr << "setsockopt SO_ZEROCOPY: " << strerror(errno) << std::endl;
+    return ERR;
+  }
+  return OK;
+#else
+  return ERR;
+#endif
+}
@@ -38,6 +38,9 @@ int SetReusePort(int fd);
 
 int SetKeepAlive(int fd, int idle, int interval, int cnt);
 
+/* allow MSG_ZEROCOPY sends on fd, ERR if the kernel does not support it */
+int EnableZeroCopy(int fd);
+
 static uint16_t HostToNet16(uint16_t host16) {
   return htobe16(host16);
 }
@@ -1,20 +1,40 @@
+#include <fcntl.h>
 #include <unistd.h>
+#include <strings.h>
 #include <cassert>
 #include <chrono>
 #include <utility>
+#include <algorithm>
 #include <unordered_set>
 #include <unordered_map>
 #include <cmath>
+#include <cstring>
 #include "persistence.h"
 #include "net/protocol.h"
+#include "net/respscan.h"
 #include "str.h"
+#include "hyperloglog.h"
+#include "cms.h"
+#include "topk.h"
+#include "bloom.h"
+#include "stream.h"
+#include "timeseries.h"
+#include "vectorset.h"
 
 #define OP_TYPE_LIST 0
 #define OP_TYPE_HASH 1
 #define OP_TYPE_STRING 2
 #define OP_TYPE_INTEGER 3
 #define OP_TYPE_SET 4
-#define OP_TYPE_OTHER 5
+#define OP_TYPE_ZSET 5
+#define OP_TYPE_HLL 6
+#define OP_TYPE_CMS 7
+#define OP_TYPE_TOPK 8
+#define OP_TYPE_BLOOM 9
+#define OP_TYPE_STREAM 10
+#define OP_TYPE_TS 11
+#define OP_TYPE_VSET 12
+#define OP_TYPE_OTHER 13
 
 AppendableFile::AppendableFile(std::string location, size_t cache_size, bool auto_flush,
                                size_t flush_interval)
@@ -54,6 +74,9 @@ AppendableFile::~AppendableFile() {
   cache1_.clear();
   cache2_.clear();
   fs_.close();
+  if (uring_fd_ != -1) {
+    close(uring_fd_);
+  }
   std::cout << "Database file saved on disk. \n";
 }
 
@@ -70,6 +93,10 @@ void AppendableFile::BackgroundHandler() {
 }
 
 void AppendableFile::Append(const CommandCache &cache) {
+  std::unique_lock<std::mutex> lck(append_mtx_, std::defer_lock);
+  if (shared_) {
+    lck.lock();
+  }
   /* always put cache into cur_caches_ */
   if (cur_caches_->size() >= cache_max_size_) {
     Switch();
@@ -86,6 +113,23 @@ void AppendableFile::FlushRightNow() {
   }
 }
 
+/**
+ * Drop the bytes before the next line starting with '*' in buffer, where a record may begin.
+ * @return false if there is none yet, the last \n is kept to be matched with more bytes.
+ */
+static bool SkipToNextRecord(Buffer &buffer) {
+  const char *begin = buffer.BeginRead();
+  const char *end = begin + buffer.ReadableBytes();
+  for (const char *p = RespFindPrefix(begin, end); p != end; p = RespFindPrefix(p + 1, end)) {
+    if (*p == '*' && p > begin && p[-1] == '\n') {
+      buffer.ReaderIdxForward(p - begin);
+      return true;
+    }
+  }
+  buffer.ReaderIdxForward(end - begin - (end > begin && end[-1] == '\n'));
+  return false;
+}
+
 static void CommonOperation(std::ifstream &ifs, const std::function<void(CommandCache &)>& whattodo) {
   ifs.seekg(0, std::ios::end);
   int64_t length = ifs.tellg();  /* report length of the whole file */
@@ -95,8 +139,10 @@ static void CommonOperation(std::ifstream &ifs, const std::function<void(Command
   }
   Buffer buffer;
   CommandCache cache;
+  ParseState state;
   int64_t n_cur_read = 0;
   int64_t n_records = 0;
+  bool resync = false;
   while (!ifs.eof()) {
     char buf[RESTORE_AOF_READ_BUF_SIZE];
     memset(buf, 0, sizeof(buf));
@@ -108,18 +154,26 @@ static void CommonOperation(std::ifstream &ifs, const std::function<void(Command
     }
     buffer.Append(buf, n_read);
     bool err = false;
-    while (TryParseFromBuffer(buffer, cache, err)) {
+    if (resync) {
+      resync = !SkipToNextRecord(buffer);
+    }
+    while (!resync && TryParseFromBuffer(buffer, state, cache, err)) {
       ++n_records;
       /* perform unique operation */
       whattodo(cache);
       cache.Clear();
     }
+    if (err) {
+      /* the bytes after the invalid record are dropped, go on from the next record in the file */
+      std::cout << "Invalid record in dumpfile before offset " << n_cur_read << ", skipped\n";
+      resync = true;
+    }
   }
   ifs.close();
   /* try to parse the rest bytes in buffer */
-  if (buffer.ReadableBytes() > 0) {
+  if (!resync && buffer.ReadableBytes() > 0) {
     bool err;
-    while (TryParseFromBuffer(buffer, cache, err)) {
+    while (TryParseFromBuffer(buffer, state, cache, err)) {
       whattodo(cache);
       ++n_records;
       cache.Clear();
@@ -130,11 +184,17 @@ static void CommonOperation(std::ifstream &ifs, const std::function<void(Command
             << n_cur_read << " bytes." << std::endl;
 }
 
-void AppendableFile::ReadFromScratch(Engine *engine, EventLoop *loop) {
+void AppendableFile::ReadFromScratch(Engine *engine, EventLoop *loop, const RestoreFilter &filter) {
   std::ifstream ifs(location_, std::ios::in);
   if (ifs.is_open()) {
-    CommonOperation(ifs, [this, engine, loop](CommandCache &cache) {
-      engine->HandleCommand(loop, cache, false);
+    /* replies are not needed, they are written into one buffer which is emptied every time */
+    Buffer replies;
+    ReplyWriter reply(replies);
+    CommonOperation(ifs, [this, engine, loop, &filter, &replies, &reply](CommandCache &cache) {
+      if (!filter || filter(cache)) {
+        engine->HandleCommand(loop, cache, reply, false);
+        replies.ReaderIdxForward(replies.ReadableBytes());
+      }
     });
   }
 }
@@ -160,7 +220,18 @@ void AppendableFile::Flush() {
     std::swap(cur_caches_, backup_caches_);
   }
   /* always flush backup_caches_ into disk */
-  if (OpenLocationFile()) {
+  if (uring_ != nullptr) {
+    std::string data;
+    for (const auto &item : *backup_caches_) {
+      data += item.ToProtocolString();
+    }
+    int err = uring_->WriteAndSync(uring_fd_, data.data(), data.size());
+    if (err < 0) {
+      std::cerr << "Can not write appendable file '" << location_ << "' through io_uring: "
+                << strerror(-err) << '\n';
+    }
+    backup_caches_->clear();
+  } else if (OpenLocationFile()) {
     for (const auto &item : *backup_caches_) {
       fs_ << item.ToProtocolString();
     }
@@ -169,6 +240,23 @@ void AppendableFile::Flush() {
   }
 }
 
+bool AppendableFile::UseUring() {
+  std::lock_guard<std::mutex> lck(mtx_);
+  std::unique_ptr<IoUring> ring(new (std::nothrow) IoUring);
+  if (ring == nullptr || !ring->Init(AOF_URING_ENTRIES, false)) {
+    return false;
+  }
+  int fd = open(location_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    return false;
+  }
+  /* bytes buffered by fs_ go first */
+  fs_.flush();
+  uring_ = std::move(ring);
+  uring_fd_ = fd;
+  return true;
+}
+
 bool AppendableFile::OpenLocationFile() {
   if (!fs_.is_open()) {
     fs_.open(location_, std::fstream::app);
@@ -186,8 +274,15 @@ void AppendableFile::Switch() {
  *  generic: set, del, expireat,
  *  integer or string: incr, decr, incrby, decrby, append,
  *  list: lpush, rpush, lpop, rpop, lsetindex,
- *  hash: hset, hdel,
+ *  hash: hset, hdel, hpexpireat, hpersist,
  *  set: sadd, srem
+ *  hyperloglog: pfadd, pfrestore
+ *  count-min sketch: cms.initbydim, cms.incrby, cms.restore
+ *  top-k: topk.reserve, topk.add, topk.incrby, topk.restore
+ *  bloom filter: bf.reserve, bf.add, bf.madd, bf.restore
+ *  stream: xadd, xtrim, xrestore
+ *  time series: ts.create, ts.add, ts.restore
+ *  vector set: vadd, vrem, vrestore
 */
 void AppendableFile::RemoveRedundancy(const std::string &source_file) {
   /* refactor dumpfile, remove those redundant commands,
@@ -220,9 +315,12 @@ void AppendableFile::RemoveRedundancy(const std::string &source_file) {
       for (auto &&cmd : commands) {
         const std::string &operation = cmd.argv[0];
         /* del command has the highest priority,
-         * and set command will overwrite existing keys no matter what the type of key is,
+         * and set (or *restore) command will overwrite existing keys no matter what the type of key is,
          * expireat command will delete the key as well if current time is greater*/
-        if (operation == "del" || operation == "set" || operation == "expireat") {
+        if (operation == "del" || operation == "set" || operation == "pfrestore" ||
+            operation == "cms.restore" || operation == "topk.restore" || operation == "bf.restore" ||
+            operation == "xrestore" || operation == "ts.restore" || operation == "vrestore" ||
+            operation == "expireat") {
           bool clear_all = false;
           if (operation == "expireat") {
             /* check if key expire */
@@ -256,16 +354,27 @@ void AppendableFile::RemoveRedundancy(const std::string &source_file) {
        * The following mainly handle list, hash and set structure operations */
       std::deque<std::string> aux_list; /* list insertion simulation */
       std::unordered_map<std::string, std::string> aux_hash; /* hash insertion simulation */
+      std::unordered_map<std::string, uint64_t> aux_hash_ttl; /* expirations of hash fields */
       std::unordered_set<std::string> aux_uset; /* set operation simulation */
+      std::unordered_map<std::string, int64_t> aux_zset; /* sorted set operation simulation */
+      HyperLogLog aux_hll; /* hyperloglog operation simulation */
+      CountMinSketch aux_cms; /* count-min sketch operation simulation */
+      TopK aux_topk; /* top-k operation simulation */
+      BloomFilter aux_bf; /* bloom filter operation simulation */
+      Stream aux_stream; /* stream operation simulation */
+      TimeSeries aux_ts; /* time series operation simulation */
+      bool aux_ts_created = false;
+      VectorSet aux_vset; /* vector set operation simulation */
       std::string aux_string; /* string operation simulation */
       std::int64_t aux_int64 = 0;
       CommandCache cache;
       uint8_t op_type;
       if (!sequential.empty()) {
         while (!sequential.empty()) {
-          const std::vector<std::string>& operands = sequential.front().argv;
+          const std::vector<StringView>& operands = sequential.front().argv;
           const std::string &op = operands[0];
-          if (op == "lpush" || op == "rpush" || op == "lpop" || op == "rpop" || op == "lsetindex") {
+          if (op == "lpush" || op == "rpush" || op == "lpop" || op == "rpop" || op == "lsetindex" ||
+              op == "linsert" || op == "lrem" || op == "ltrim") {
             op_type = OP_TYPE_LIST;
             /* if starts with list operation, the rest is list operation */
             if (op == "lpush") {
@@ -281,19 +390,83 @@ void AppendableFile::RemoveRedundancy(const std::string &source_file) {
             } else if (op == "rpop") {
               aux_list.pop_back();
             } else if (op == "lsetindex") {
-              const std::string& idx = operands[2];
-              aux_list[std::stoul(idx)] = operands[3];
+              long idx = std::stol(operands[2]);
+              if (idx < 0) {
+                idx += (long)aux_list.size();
+              }
+              aux_list[idx] = operands[3];
+            } else if (op == "linsert") {
+              auto pivot = std::find(aux_list.begin(), aux_list.end(), operands[3]);
+              if (pivot != aux_list.end()) {
+                bool before = strcasecmp(operands[2].c_str(), "before") == 0;
+                aux_list.insert(before ? pivot : pivot + 1, operands[4]);
+              }
+            } else if (op == "lrem") {
+              long count = std::stol(operands[2]);
+              const std::string &value = operands[3];
+              if (count >= 0) {
+                size_t limit = count == 0 ? aux_list.size() : count;
+                for (auto it = aux_list.begin(); it != aux_list.end() && limit > 0;) {
+                  if (*it == value) {
+                    it = aux_list.erase(it);
+                    --limit;
+                  } else {
+                    ++it;
+                  }
+                }
+              } else {
+                size_t limit = -count;
+                for (long i = (long)aux_list.size() - 1; i >= 0 && limit > 0; --i) {
+                  if (aux_list[i] == value) {
+                    aux_list.erase(aux_list.begin() + i);
+                    --limit;
+                  }
+                }
+              }
+            } else if (op == "ltrim") {
+              long len = (long)aux_list.size();
+              long begin = std::stol(operands[2]);
+              long end = std::stol(operands[3]);
+              if (begin < 0) {
+                begin = std::max(begin + len, 0L);
+              }
+              if (end < 0) {
+                end += len;
+              }
+              if (end < 0 || begin > end || begin >= len) {
+                aux_list.clear();
+              } else {
+                end = std::min(end, len - 1);
+                aux_list.erase(aux_list.begin() + end + 1, aux_list.end());
+                aux_list.erase(aux_list.begin(), aux_list.begin() + begin);
+              }
             }
-          } else if (op == "hset" || op == "hdel") {
+          } else if (op == "hset" || op == "hdel" || op == "hpexpireat" || op == "hpersist") {
             op_type = OP_TYPE_HASH;
             /* if starts with hash operation, the rest is hash operation */
             if (op == "hset") {
               for (size_t i = 2; i < operands.size(); i += 2) {
                 aux_hash[operands[i]] = operands[i + 1];
+                aux_hash_ttl.erase(operands[i]);
               }
             } else if (op == "hdel") {
               for (size_t i = 2; i < operands.size(); ++i) {
                 aux_hash.erase(operands[i]);
+                aux_hash_ttl.erase(operands[i]);
+              }
+            } else if (op == "hpexpireat" && operands.size() > 5) {
+              /* hpexpireat key ms FIELDS numfields field1 field2 ... */
+              uint64_t when = 0;
+              CanConvertToUInt64(operands[2], when);
+              for (size_t i = 5; i < operands.size(); ++i) {
+                if (aux_hash.count(operands[i])) {
+                  aux_hash_ttl[operands[i]] = when;
+                }
+              }
+            } else if (op == "hpersist") {
+              /* hpersist key FIELDS numfields field1 field2 ... */
+              for (size_t i = 4; i < operands.size(); ++i) {
+                aux_hash_ttl.erase(operands[i]);
               }
             }
           } else if (op == "sadd" || op == "srem") {
@@ -307,9 +480,178 @@ void AppendableFile::RemoveRedundancy(const std::string &source_file) {
                   aux_uset.erase(operands[i]);
                 }
               }
+          } else if (op == "zadd" || op == "zrem") {
+            /* zincrby and zpopmin are synced as zadd and zrem */
+            op_type = OP_TYPE_ZSET;
+            if (op == "zadd") {
+              bool nx = false, xx = false;
+              size_t i = 2;
+              for (; i < operands.size(); ++i) {
+                if (strcasecmp(operands[i].c_str(), "nx") == 0) {
+                  nx = true;
+                } else if (strcasecmp(operands[i].c_str(), "xx") == 0) {
+                  xx = true;
+                } else if (strcasecmp(operands[i].c_str(), "ch") != 0) {
+                  break;
+                }
+              }
+              for (; i + 1 < operands.size(); i += 2) {
+                bool exists = aux_zset.count(operands[i + 1]) != 0;
+                if ((nx && exists) || (xx && !exists)) {
+                  continue;
+                }
+                aux_zset[operands[i + 1]] = std::stoll(operands[i]);
+              }
+            } else {
+              for (size_t i = 2; i < operands.size(); ++i) {
+                aux_zset.erase(operands[i]);
+              }
+            }
+          } else if (op == "pfadd" || op == "pfrestore") {
+            /* pfmerge is synced as pfrestore */
+            op_type = OP_TYPE_HLL;
+            if (op == "pfrestore") {
+              aux_hll.Load(operands[2].data(), operands[2].size());
+            } else {
+              for (size_t i = 2; i < operands.size(); ++i) {
+                aux_hll.Add(operands[i]);
+              }
+            }
+          } else if (op == "cms.initbydim" || op == "cms.incrby" || op == "cms.restore") {
+            /* cms.merge is synced as cms.restore */
+            op_type = OP_TYPE_CMS;
+            if (op == "cms.initbydim") {
+              aux_cms = CountMinSketch(std::stoul(operands[2]), std::stoul(operands[3]));
+            } else if (op == "cms.incrby") {
+              std::vector<std::string> items;
+              std::vector<uint32_t> increments;
+              for (size_t i = 2; i + 1 < operands.size(); i += 2) {
+                items.emplace_back(operands[i]);
+                increments.emplace_back(std::stoul(operands[i + 1]));
+              }
+              aux_cms.IncrBy(items, increments);
+            } else {
+              aux_cms.Load(operands[2].data(), operands[2].size());
+            }
+          } else if (op == "topk.reserve" || op == "topk.add" || op == "topk.incrby" ||
+                     op == "topk.restore") {
+            /* decays are drawn from the persisted generator, so the additions replay exactly */
+            op_type = OP_TYPE_TOPK;
+            std::string expelled;
+            if (op == "topk.reserve") {
+              bool dims_given = operands.size() == 6;
+              aux_topk = TopK(std::stoul(operands[2]),
+                              dims_given ? std::stoul(operands[3]) : kTopKDefaultWidth,
+                              dims_given ? std::stoul(operands[4]) : kTopKDefaultDepth,
+                              dims_given ? std::stod(operands[5]) : kTopKDefaultDecay);
+            } else if (op == "topk.add") {
+              for (size_t i = 2; i < operands.size(); ++i) {
+                aux_topk.Add(operands[i], 1, expelled);
+              }
+            } else if (op == "topk.incrby") {
+              for (size_t i = 2; i + 1 < operands.size(); i += 2) {
+                aux_topk.Add(operands[i], std::stoul(operands[i + 1]), expelled);
+              }
+            } else {
+              aux_topk.Load(operands[2].data(), operands[2].size());
+            }
+          } else if (op == "bf.reserve" || op == "bf.add" || op == "bf.madd" ||
+                     op == "bf.restore") {
+            if (aux_bf.NumLayers() == 0 && op != "bf.reserve" && op != "bf.restore") {
+              /* bf.add creates the filter with default parameters */
+              aux_bf = BloomFilter(kBloomDefaultErrorRate, kBloomDefaultCapacity,
+                                   kBloomDefaultExpansion, false);
+            }
+            op_type = OP_TYPE_BLOOM;
+            if (op == "bf.reserve") {
+              /* bf.reserve is synced as: bf.reserve key error_rate capacity EXPANSION e [NONSCALING] */
+              aux_bf = BloomFilter(std::stod(operands[2]), std::stoull(operands[3]),
+                                   std::stoul(operands[5]), operands.size() == 7);
+            } else if (op == "bf.restore") {
+              aux_bf.Load(operands[2].data(), operands[2].size());
+            } else {
+              for (size_t i = 2; i < operands.size(); ++i) {
+                aux_bf.Add(operands[i]);
+              }
+            }
+          } else if (op == "xadd" || op == "xtrim" || op == "xrestore") {
+            /* xadd is synced with the generated id, and trimming is synced as xtrim */
+            op_type = OP_TYPE_STREAM;
+            if (op == "xadd") {
+              StreamIDSpec spec;
+              StreamID id;
+              StreamIDSpec::Parse(operands[2], spec);
+              aux_stream.Add(spec, 0, std::vector<std::string>(operands.begin() + 3, operands.end()),
+                             id);
+            } else if (op == "xtrim") {
+              /* xtrim key MAXLEN|MINID =|~ threshold */
+              bool approx = operands[3] == "~";
+              if (operands[2] == "MAXLEN") {
+                aux_stream.TrimByLength(std::stoull(operands[4]), approx);
+              } else {
+                StreamID minid;
+                StreamID::Parse(operands[4], 0, minid);
+                aux_stream.TrimByMinID(minid, approx);
+              }
+            } else {
+              aux_stream.Load(operands[2].data(), operands[2].size());
+            }
+          } else if (op == "ts.create" || op == "ts.add" || op == "ts.restore") {
+            /* ts.add is synced with the resolved timestamp and the retention given on creation */
+            op_type = OP_TYPE_TS;
+            if (op == "ts.create") {
+              /* ts.create key RETENTION ms */
+              aux_ts = TimeSeries(std::stoull(operands[3]));
+            } else if (op == "ts.add") {
+              /* ts.add key timestamp value RETENTION ms */
+              if (!aux_ts_created) {
+                aux_ts = TimeSeries(std::stoull(operands[5]));
+              }
+              aux_ts.Add(std::stoll(operands[2]), std::stod(operands[3]));
+            } else {
+              aux_ts.Load(operands[2].data(), operands[2].size());
+            }
+            aux_ts_created = true;
+          } else if (op == "vadd" || op == "vrem" || op == "vrestore") {
+            op_type = OP_TYPE_VSET;
+            if (op == "vadd") {
+              /* vadd key METRIC metric Q8|NOQUANT VALUES dim v1 v2 ... element */
+              size_t dim = std::stoul(operands[6]);
+              if (aux_vset.Dim() == 0) {
+                aux_vset = VectorSet(dim, VecMetricFromName(operands[3]), operands[4] == "Q8");
+              }
+              std::vector<float> vec;
+              for (size_t i = 0; i < dim; ++i) {
+                vec.push_back(std::strtof(operands[7 + i].c_str(), nullptr));
+              }
+              aux_vset.Add(operands[7 + dim], vec.data());
+            } else if (op == "vrem") {
+              aux_vset.Remove(operands[2]);
+            } else {
+              aux_vset.Load(operands[2].data(), operands[2].size());
+            }
           } else if (op == "append") {
             op_type = OP_TYPE_STRING;
             aux_string.append(operands[2]);
+          } else if (op == "setrange") {
+            op_type = OP_TYPE_STRING;
+            size_t offset = std::stoull(operands[2]);
+            if (aux_string.size() < offset + operands[3].size()) {
+              aux_string.resize(offset + operands[3].size(), '\0');
+            }
+            aux_string.replace(offset, operands[3].size(), operands[3]);
+          } else if (op == "setbit") {
+            op_type = OP_TYPE_STRING;
+            size_t offset = std::stoull(operands[2]);
+            if (aux_string.size() <= (offset >> 3)) {
+              aux_string.resize((offset >> 3) + 1, '\0');
+            }
+            char mask = (char)(1 << (7 - (offset & 7)));
+            if (operands[3] == "1") {
+              aux_string[offset >> 3] |= mask;
+            } else {
+              aux_string[offset >> 3] &= ~mask;
+            }
           } else if (op == "incr" || op == "decr" || op == "incrby" || op == "decrby") {
             op_type = OP_TYPE_INTEGER;
             if (CanConvertToInt64(aux_string, aux_int64) || aux_string.empty()) {
@@ -335,39 +677,92 @@ void AppendableFile::RemoveRedundancy(const std::string &source_file) {
           sequential.pop();
         } // finish processing one key
         /* After done processing a series of operations on this key, we can now restore the command that can generate the final result and add it to file */
-        if (op_type == OP_TYPE_LIST) {
+        if (op_type == OP_TYPE_LIST && !aux_list.empty()) {
           /* sync list generation command into buffer */
-          cache.argv.assign(aux_list.begin(), aux_list.end());
-          cache.argv.insert(cache.argv.begin(), key);
-          cache.argv.insert(cache.argv.begin(), "rpush");
-          cache.argc = cache.argv.size();
+          std::vector<std::string> argv{"rpush", key};
+          argv.insert(argv.end(), aux_list.begin(), aux_list.end());
+          cache.Assign(std::move(argv));
           Append(cache);
           cache.Clear();
           aux_list.clear();
         } else if (op_type == OP_TYPE_HASH) {
-          /* sync hash generation command into buffer */
-          for (auto&& kv : aux_hash) {
-            cache.argv.emplace_back(kv.first);
-            cache.argv.emplace_back(kv.second);
+          /* fields already expired are dropped */
+          uint64_t now = GetCurrentMs();
+          for (auto&& kv : aux_hash_ttl) {
+            if (kv.second <= now) {
+              aux_hash.erase(kv.first);
+            }
+          }
+          if (!aux_hash.empty()) {
+            /* sync hash generation command into buffer */
+            std::vector<std::string> argv{"hset", key};
+            for (auto&& kv : aux_hash) {
+              argv.emplace_back(kv.first);
+              argv.emplace_back(kv.second);
+            }
+            cache.Assign(std::move(argv));
+            Append(cache);
+            cache.Clear();
+            /* then expirations of the remaining fields */
+            for (auto&& kv : aux_hash_ttl) {
+              if (kv.second > now) {
+                cache.Assign({"hpexpireat", key, std::to_string(kv.second), "FIELDS", "1", kv.first});
+                Append(cache);
+                cache.Clear();
+              }
+            }
           }
-          cache.argv.insert(cache.argv.begin(), key);
-          cache.argv.insert(cache.argv.begin(), "hset");
-          cache.argc = cache.argv.size();
-          Append(cache);
-          cache.Clear();
           aux_hash.clear();
+          aux_hash_ttl.clear();
         } else if (op_type == OP_TYPE_SET) {
           /* sync set generation command into buffer */
-          cache.argv.assign(aux_uset.begin(), aux_uset.end());
-          cache.argv.insert(cache.argv.begin(), key);
-          cache.argv.insert(cache.argv.begin(), "sadd");
-          cache.argc = cache.argv.size();
+          std::vector<std::string> argv{"sadd", key};
+          argv.insert(argv.end(), aux_uset.begin(), aux_uset.end());
+          cache.Assign(std::move(argv));
           Append(cache);
           cache.Clear();
           aux_uset.clear();
+        } else if (op_type == OP_TYPE_ZSET && !aux_zset.empty()) {
+          /* sync sorted set generation command into buffer */
+          std::vector<std::string> argv{"zadd", key};
+          for (auto&& item : aux_zset) {
+            argv.emplace_back(std::to_string(item.second));
+            argv.emplace_back(item.first);
+          }
+          cache.Assign(std::move(argv));
+          Append(cache);
+          cache.Clear();
+          aux_zset.clear();
+        } else if (op_type == OP_TYPE_HLL) {
+          cache.Assign({"pfrestore", key, aux_hll.Dump()});
+          Append(cache);
+          cache.Clear();
+        } else if (op_type == OP_TYPE_CMS) {
+          cache.Assign({"cms.restore", key, aux_cms.Dump()});
+          Append(cache);
+          cache.Clear();
+        } else if (op_type == OP_TYPE_TOPK) {
+          cache.Assign({"topk.restore", key, aux_topk.Dump()});
+          Append(cache);
+          cache.Clear();
+        } else if (op_type == OP_TYPE_BLOOM) {
+          cache.Assign({"bf.restore", key, aux_bf.Dump()});
+          Append(cache);
+          cache.Clear();
+        } else if (op_type == OP_TYPE_STREAM) {
+          cache.Assign({"xrestore", key, aux_stream.Dump()});
+          Append(cache);
+          cache.Clear();
+        } else if (op_type == OP_TYPE_TS) {
+          cache.Assign({"ts.restore", key, aux_ts.Dump()});
+          Append(cache);
+          cache.Clear();
+        } else if (op_type == OP_TYPE_VSET) {
+          cache.Assign({"vrestore", key, aux_vset.Dump()});
+          Append(cache);
+          cache.Clear();
         } else if (op_type == OP_TYPE_INTEGER || op_type == OP_TYPE_STRING) {
-          cache.argv = {"set", key, aux_string};
-          cache.argc = cache.argv.size();
+          cache.Assign({"set", key, aux_string});
           Append(cache);
           cache.Clear();
           aux_string.clear();
@@ -8,14 +8,21 @@
 #include <condition_variable>
 #include <thread>
 #include <atomic>
+#include <functional>
+#include <memory>
 #include "net/net.h"
+#include "net/uring.h"
 #include "net/commands.h"
 #include "config.h"
 
 constexpr int RESTORE_AOF_READ_BUF_SIZE = 1024 * 64;
+constexpr unsigned AOF_URING_ENTRIES = 8;
 
 class Engine;
 
+/* decide whether a restored command is executed, part of the command may be dropped */
+typedef std::function<bool(CommandCache &)> RestoreFilter;
+
 class AppendableFile {
   using CmdCacheVector = std::vector<CommandCache>;
 
@@ -31,7 +38,7 @@ public:
 
   void FlushRightNow();
 
-  void ReadFromScratch(Engine* engine, EventLoop* loop);
+  void ReadFromScratch(Engine* engine, EventLoop* loop, const RestoreFilter &filter = nullptr);
 
   std::vector<CommandCache> ReadFromScratch();
 
@@ -39,6 +46,16 @@ public:
 
   void SetAutoFlush(bool on);
 
+  /* commands are appended by several threads, every append takes a lock */
+  void SetShared(bool on) { shared_ = on; }
+
+  /**
+   * Write the commands through io_uring from now on, each flush is written and synced to disk with
+   * one submission.
+   * @return false if io_uring is not available, the file is written as before then.
+   */
+  bool UseUring();
+
 private:
 
   void Flush();
@@ -67,6 +84,11 @@ private:
   std::atomic<bool> auto_flush_;
   uint64_t last_flush_timestamp_; /* last flush unix timestamp */
   size_t flush_interval_;  /* flush interval, unit: second */
+  bool shared_ = false;
+  std::mutex append_mtx_;
+  /* only set after UseUring */
+  std::unique_ptr<IoUring> uring_;
+  int uring_fd_ = -1;
 };
 
 #endif //__PERSISTENCE_H__
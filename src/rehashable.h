@@ -1,10 +1,17 @@
 #ifndef __REHASHABLE_H__
 #define __REHASHABLE_H__
 
+#include <algorithm>
+#include <random>
 #include <type_traits>
+#include <unordered_set>
 #include "hash.h"
 
 constexpr static int kGrowFactor = 2;
+/* number of entries sampled to pick a fair random entry */
+constexpr static size_t kFairSampleSize = 16;
+/* copy all entries when the requested count is larger than 1/kRandomCopyFactor of the total */
+constexpr static size_t kRandomCopyFactor = 3;
 
 /* class describing the rehashing behaviour in hashtable or hashset */
 template <typename ImplType>
@@ -49,9 +56,47 @@ public:
 
   std::vector<EntryType *> AllEntries() const;
 
+  /* visit entries in both tables without copying them out,
+   * fn returns false to stop early, return false if stopped early */
+  template <typename Func>
+  bool ForEachEntry(Func &&fn) const {
+    if (cur_ht_ != nullptr && !cur_ht_->ForEachEntry(fn)) {
+      return false;
+    }
+    return backup_ht_ == nullptr || backup_ht_->ForEachEntry(fn);
+  }
+
+  /* pick up to count entries from consecutive slots beginning at a random slot,
+   * return the number of entries put into out */
+  size_t SampleEntries(EntryType **out, size_t count, std::mt19937_64 &rng) const;
+
+  /* return a random entry with roughly uniform probability, nullptr if empty */
+  EntryType *RandomEntry(std::mt19937_64 &rng) const;
+
+  /* return count random entries, entries are distinct if unique is true */
+  std::vector<EntryType *> RandomEntries(size_t count, bool unique, std::mt19937_64 &rng) const;
+
 protected:
   bool PerformRehash();
 
+  /* slots of cur_ht_ that may still hold entries followed by slots of backup_ht_
+   * are viewed as a single range [0, TotalSlots()) */
+  inline size_t TotalSlots() const {
+    return (cur_ht_->slot_size_ - CurSlotStart()) + (backup_ht_ ? backup_ht_->slot_size_ : 0);
+  }
+
+  inline size_t CurSlotStart() const {
+    /* slots before rehashing_idx_ are already moved into backup_ht_ */
+    return cur_ht_->rehashing_idx_ == -1 ? 0 : cur_ht_->rehashing_idx_;
+  }
+
+  inline EntryType *SlotAt(size_t idx) const {
+    size_t n_cur = cur_ht_->slot_size_ - CurSlotStart();
+    return idx < n_cur ? cur_ht_->table_[CurSlotStart() + idx] : backup_ht_->table_[idx - n_cur];
+  }
+
+  EntryType *RandomSlotEntry(std::mt19937_64 &rng) const;
+
   inline bool CheckNeedRehash() const {
     bool need_rehash =
         (cur_ht_->rehashing_idx_ == -1 && cur_ht_->LoadFactor() > max_load_factor_) ||
@@ -123,6 +168,112 @@ std::vector<typename Rehashable<ImplType>::EntryType *> Rehashable<ImplType>::Al
   return entries;
 }
 
+template <typename ImplType>
+size_t Rehashable<ImplType>::SampleEntries(EntryType **out, size_t count,
+                                           std::mt19937_64 &rng) const {
+  count = std::min(count, Count());
+  if (count == 0) {
+    return 0;
+  }
+  size_t total = TotalSlots();
+  size_t idx = rng() % total;
+  size_t n = 0, empty_run = 0;
+  /* bound the number of visited slots, sparse table may hardly give us count entries */
+  for (size_t steps = count * 10; n < count && steps > 0; --steps) {
+    EntryType *entry = SlotAt(idx);
+    if (entry == nullptr) {
+      /* long run of empty slots, jump somewhere else */
+      if (++empty_run >= 5 && empty_run > count) {
+        idx = rng() % total;
+        empty_run = 0;
+        continue;
+      }
+    } else {
+      empty_run = 0;
+      for (; entry != nullptr && n < count; entry = entry->next) {
+        out[n++] = entry;
+      }
+    }
+    idx = (idx + 1) % total;
+  }
+  return n;
+}
+
+template <typename ImplType>
+typename Rehashable<ImplType>::EntryType *Rehashable<ImplType>::RandomSlotEntry(
+    std::mt19937_64 &rng) const {
+  size_t total = TotalSlots();
+  EntryType *head = nullptr;
+  while (head == nullptr) {
+    head = SlotAt(rng() % total);
+  }
+  size_t len = 0;
+  for (EntryType *entry = head; entry != nullptr; entry = entry->next) {
+    ++len;
+  }
+  for (size_t i = rng() % len; i > 0; --i) {
+    head = head->next;
+  }
+  return head;
+}
+
+template <typename ImplType>
+typename Rehashable<ImplType>::EntryType *Rehashable<ImplType>::RandomEntry(
+    std::mt19937_64 &rng) const {
+  if (Count() == 0) {
+    return nullptr;
+  }
+  /* picking a random slot then a random entry inside its chain favours entries in short
+   * chains, choosing among entries sampled from several slots evens the chain lengths out */
+  EntryType *sample[kFairSampleSize];
+  size_t n = SampleEntries(sample, kFairSampleSize, rng);
+  if (n == 0) {
+    return RandomSlotEntry(rng);
+  }
+  return sample[rng() % n];
+}
+
+template <typename ImplType>
+std::vector<typename Rehashable<ImplType>::EntryType *> Rehashable<ImplType>::RandomEntries(
+    size_t count, bool unique, std::mt19937_64 &rng) const {
+  std::vector<EntryType *> entries;
+  size_t n = Count();
+  if (n == 0 || count == 0) {
+    return entries;
+  }
+  if (!unique) {
+    entries.reserve(count);
+    while (entries.size() < count) {
+      entries.emplace_back(RandomEntry(rng));
+    }
+    return entries;
+  }
+  if (count >= n || count * kRandomCopyFactor > n) {
+    /* most entries are wanted, picking them one by one mostly hits already picked ones,
+     * so shuffle all of them and keep the first count */
+    entries.reserve(n);
+    ForEachEntry([&entries](EntryType *entry) {
+      entries.emplace_back(entry);
+      return true;
+    });
+    count = std::min(count, n);
+    for (size_t i = 0; i < count; ++i) {
+      std::swap(entries[i], entries[i + rng() % (n - i)]);
+    }
+    entries.resize(count);
+    return entries;
+  }
+  std::unordered_set<EntryType *> picked;
+  entries.reserve(count);
+  while (entries.size() < count) {
+    EntryType *entry = RandomEntry(rng);
+    if (picked.insert(entry).second) {
+      entries.emplace_back(entry);
+    }
+  }
+  return entries;
+}
+
 template <typename ImplType>
 bool Rehashable<ImplType>::PerformRehash() {
   /* rehashing implementation */
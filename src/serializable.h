@@ -10,6 +10,16 @@
 #define LKVBD_TYPE_LIST 3
 #define LKVBD_TYPE_HASH 4
 #define LKVBD_TYPE_SET 5
+#define LKVBD_TYPE_ZSET 6
+#define LKVBD_TYPE_HLL 7
+#define LKVBD_TYPE_CMS 8
+#define LKVBD_TYPE_TOPK 9
+#define LKVBD_TYPE_BLOOM 10
+#define LKVBD_TYPE_STREAM 11
+#define LKVBD_TYPE_TS 12
+#define LKVBD_TYPE_VSET 13
+/* hash with expirations of fields */
+#define LKVBD_TYPE_HASH_TTL 14
 
 class Serializable {
 public:
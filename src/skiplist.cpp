@@ -20,129 +20,147 @@ static size_t GenRandomLevel() {
 }
 
 SKNode::SKNode(int64_t score, const DynamicString& data, uint8_t lv)
-    : score(score), data(data), nexts(new SKNode*[lv]), level(lv) {
+    : score(score), data(data), level(lv) {
+  SKLevel* levels = Levels();
   for (int l = 0; l < level; ++l) {
-    nexts[l] = nullptr;
+    levels[l].next = nullptr;
+    levels[l].span = 0;
   }
 }
 
-SKNode::SKNode(int64_t score, DynamicString&& data, uint8_t lv)
-    : score(score), data(std::move(data)), nexts(new SKNode*[lv]), level(lv) {
-  for (int l = 0; l < level; ++l) {
-    nexts[l] = nullptr;
-  }
+SKNode* SKNode::Create(int64_t score, const DynamicString& data, uint8_t lv) {
+  /* node and its forward links share one allocation */
+  void* mem = ::operator new(sizeof(SKNode) + lv * sizeof(SKLevel), std::nothrow);
+  if (mem == nullptr) return nullptr;
+  return new (mem) SKNode(score, data, lv);
 }
 
-SKNode::~SKNode() {
-  if (nexts) {
-    delete[] nexts;
-    nexts = nullptr;
+void SKNode::Destroy(SKNode* node) {
+  if (node != nullptr) {
+    node->~SKNode();
+    ::operator delete(node);
   }
 }
 
-Skiplist::Skiplist() : head_(new SKNode(INT64_MIN, DynamicString(""), kMaxLevel)) {}
+Skiplist::Skiplist() : head_(SKNode::Create(INT64_MIN, DynamicString(""), kMaxLevel)) {}
 
 Skiplist::~Skiplist() {
   /* we need to free all nodes in the skiplist */
   std::vector<SKNode*> nodes;
   GatherAllNodes(nodes, true);
   for (auto& node : nodes) {
-    delete node;
+    SKNode::Destroy(node);
     node = nullptr;
   }
   head_ = nullptr;
+  tail_ = nullptr;
   cur_max_level_ = 0;
   count_ = 0;
 }
 
 Skiplist::Skiplist(std::initializer_list<SKNode> list)
-    : head_(new SKNode(0, DynamicString(""), kMaxLevel)) {}
+    : head_(SKNode::Create(0, DynamicString(""), kMaxLevel)) {}
 
 Skiplist::Skiplist(std::initializer_list<std::pair<double, std::string>> list)
-    : head_(new SKNode(0, DynamicString(""), kMaxLevel)) {}
+    : head_(SKNode::Create(0, DynamicString(""), kMaxLevel)) {}
 
 // FIXME: optimize args copy overhead, target may be copied many times
 bool Skiplist::Insert(int64_t score, const DynamicString& target) {
   if (head_ == nullptr) return false;
-  if (head_->nexts[0] == nullptr) {
-    /* we do not have nodes yet,
-     * we should insert the first node here whose level is specified to be 1 */
-    SKNode* new_node = new (std::nothrow) SKNode(score, target, 1);
-    if (new_node == nullptr) return false;
-    head_->nexts[0] = new_node;
-    new_node->prev = head_;
-    ++count_;
-    cur_max_level_ = 1;
-    return true;
-  }
   /* determine a level for new inserted node */
-  size_t level = GenRandomLevel();
-  SKNode* path[kMaxLevel] = {nullptr}; /* store the path when finding the position for insertion */
-  SKNode* cur = Find(score, target, level - 1, path);
-  if (cur == nullptr || (cur->nexts[0] && comparator_(score, target, *cur->nexts[0]) == 0)) {
+  uint8_t level = (uint8_t)GenRandomLevel();
+  uint8_t top = std::max(cur_max_level_, level);
+  /* store the path when finding the position for insertion,
+   * rank[l] is the rank of path[l] (head is 0) */
+  SKNode* path[kMaxLevel] = {nullptr};
+  size_t rank[kMaxLevel] = {0};
+  SKNode* cur = head_;
+  for (int l = top - 1; l >= 0; --l) {
+    rank[l] = (l == top - 1) ? 0 : rank[l + 1];
+    while (cur->Next(l) && comparator_(score, target, *cur->Next(l)) > 0) {
+      rank[l] += cur->Levels()[l].span;
+      cur = cur->Next(l);
+    }
+    path[l] = cur;
+  }
+  if (cur->Next(0) && comparator_(score, target, *cur->Next(0)) == 0) {
     /* the same node exists */
     return false;
   }
-  SKNode* new_node = new (std::nothrow) SKNode(score, target, level);
+  SKNode* new_node = SKNode::Create(score, target, level);
   if (new_node == nullptr) return false;
-  SKNode* after = cur->nexts[0];
-  /* adjust nexts pointers */
-  for (size_t l = 0; l < level; ++l) {
-    new_node->nexts[l] = path[l]->nexts[l];
-    path[l]->nexts[l] = new_node;
+  /* levels above the current max level start from head and span the whole list */
+  for (int l = cur_max_level_; l < level; ++l) {
+    head_->Levels()[l].span = count_;
+  }
+  SKNode* after = cur->Next(0);
+  /* adjust forward links and spans */
+  for (int l = 0; l < level; ++l) {
+    new_node->Levels()[l].next = path[l]->Next(l);
+    path[l]->Levels()[l].next = new_node;
+    new_node->Levels()[l].span = path[l]->Levels()[l].span - (rank[0] - rank[l]);
+    path[l]->Levels()[l].span = (rank[0] - rank[l]) + 1;
+  }
+  /* untouched upper levels now step over one more node */
+  for (int l = level; l < top; ++l) {
+    path[l]->Levels()[l].span++;
   }
   /* adjust pre pointer */
   if (after) {
     after->prev = new_node;
+  } else {
+    tail_ = new_node;
   }
   new_node->prev = cur;
-  cur_max_level_ = std::max(cur_max_level_, (uint8_t)level);
+  cur_max_level_ = top;
   ++count_;
   return true;
 }
 
 bool Skiplist::Contains(int64_t score, const DynamicString& target) const {
-  if (head_ == nullptr || head_->nexts[0] == nullptr) {
+  if (head_ == nullptr || head_->Next(0) == nullptr) {
     return false;
   }
   SKNode* node = Find(score, target, cur_max_level_ - 1);
-  if (node->nexts[0] == nullptr || comparator_(score, target, *node->nexts[0]) != 0) {
+  if (node->Next(0) == nullptr || comparator_(score, target, *node->Next(0)) != 0) {
     return false;
   }
   return true;
 }
 
 bool Skiplist::Remove(int64_t score, const DynamicString& target) {
-  if (head_ == nullptr || head_->nexts[0] == nullptr) {
+  if (head_ == nullptr || head_->Next(0) == nullptr) {
     return false;
   }
   SKNode* path[kMaxLevel] = {nullptr};
   SKNode* cur = Find(score, target, cur_max_level_ - 1, path);
   /* cur is the previous node of the deleting node, 
-  which means that cur->nexts[0] will be removed */
-  if (cur == nullptr || cur->nexts[0] == nullptr) return false;
-  if (comparator_(score, target, *cur->nexts[0]) != 0) return false;
+  which means that cur->Next(0) will be removed */
+  if (cur == nullptr || cur->Next(0) == nullptr) return false;
+  if (comparator_(score, target, *cur->Next(0)) != 0) return false;
 
   /* this is the node to be deleted */
-  SKNode* del_node = cur->nexts[0];
-  /* we should adjust the next pointers for cur node */
+  SKNode* del_node = cur->Next(0);
+  /* we should adjust the next pointers and spans for nodes on the path */
   for (int l = cur_max_level_ - 1; l >= 0; --l) {
-    if (path[l] && path[l]->nexts[l] && comparator_(score, target, *path[l]->nexts[l]) == 0) {
-      path[l]->nexts[l] = del_node->nexts[l];
+    if (path[l]->Next(l) == del_node) {
+      path[l]->Levels()[l].span += del_node->Levels()[l].span - 1;
+      path[l]->Levels()[l].next = del_node->Next(l);
+    } else {
+      path[l]->Levels()[l].span--;
     }
   }
   /* adjust next and previous pointer */
-  if (del_node->nexts && del_node->nexts[0] != nullptr) {
-    del_node->nexts[0]->prev = cur;
+  if (del_node->Next(0) != nullptr) {
+    del_node->Next(0)->prev = cur;
+  } else {
+    tail_ = cur == head_ ? nullptr : cur;
   }
   /* we may need to adjust the current level of the whole skiplist */
-  if (del_node->level == cur_max_level_) {
-    /* further check */
-    while (head_->nexts[cur_max_level_ - 1] == nullptr && cur_max_level_ > 0) {
-      --cur_max_level_;
-    }
+  while (cur_max_level_ > 0 && head_->Next(cur_max_level_ - 1) == nullptr) {
+    --cur_max_level_;
   }
-  delete del_node;
+  SKNode::Destroy(del_node);
   --count_;
   return true;
 }
@@ -154,23 +172,74 @@ void Skiplist::Clear() {
   std::vector<SKNode*> nodes;
   GatherAllNodes(nodes, false);
   for (auto& node : nodes) {
-    delete node;
+    SKNode::Destroy(node);
     node = nullptr;
   }
   for (int l = 0; l < kMaxLevel; ++l) {
-    head_->nexts[l] = nullptr;
+    head_->Levels()[l].next = nullptr;
+    head_->Levels()[l].span = 0;
   }
+  tail_ = nullptr;
   cur_max_level_ = 0;
   count_ = 0;
 }
 
 SKNode& Skiplist::operator[](size_t idx) {
-  if (idx >= count_ || idx < 0) {
+  if (idx >= count_) {
     throw std::out_of_range("skiplist index out of range");
   }
-  /* TODO we should find the corresponding element at idx */
+  return *GetByRank(idx);
+}
+
+long Skiplist::Rank(int64_t score, const DynamicString& target) const {
+  if (head_ == nullptr || count_ == 0) {
+    return -1;
+  }
+  size_t rank = 0;
+  SKNode* cur = head_;
+  for (int l = cur_max_level_ - 1; l >= 0; --l) {
+    while (cur->Next(l) && comparator_(score, target, *cur->Next(l)) >= 0) {
+      rank += cur->Levels()[l].span;
+      cur = cur->Next(l);
+    }
+    if (cur != head_ && comparator_(score, target, *cur) == 0) {
+      return (long)rank - 1;
+    }
+  }
+  return -1;
+}
 
-  return *head_->nexts[0];
+SKNode* Skiplist::GetByRank(size_t rank) const {
+  if (head_ == nullptr || rank >= count_) {
+    return nullptr;
+  }
+  /* spans count from head, so the node of rank r is r + 1 steps away */
+  size_t target = rank + 1, traversed = 0;
+  SKNode* cur = head_;
+  for (int l = cur_max_level_ - 1; l >= 0; --l) {
+    while (cur->Next(l) && traversed + cur->Levels()[l].span <= target) {
+      traversed += cur->Levels()[l].span;
+      cur = cur->Next(l);
+    }
+    if (traversed == target) {
+      return cur;
+    }
+  }
+  return nullptr;
+}
+
+SKNode* Skiplist::FirstInScoreRange(int64_t min, bool exclusive) const {
+  if (head_ == nullptr || count_ == 0) {
+    return nullptr;
+  }
+  SKNode* cur = head_;
+  for (int l = cur_max_level_ - 1; l >= 0; --l) {
+    while (cur->Next(l) &&
+           (exclusive ? cur->Next(l)->score <= min : cur->Next(l)->score < min)) {
+      cur = cur->Next(l);
+    }
+  }
+  return cur->Next(0);
 }
 
 SKNode* Skiplist::Find(int64_t score, const DynamicString& target, int start,
@@ -179,8 +248,8 @@ SKNode* Skiplist::Find(int64_t score, const DynamicString& target, int start,
   /* search from top to down */
   for (int l = start; l >= 0; --l) {
     /* search from left to right */
-    while (cur->nexts[l] && comparator_(score, target, *cur->nexts[l]) > 0) {
-      cur = cur->nexts[l];
+    while (cur->Next(l) && comparator_(score, target, *cur->Next(l)) > 0) {
+      cur = cur->Next(l);
     }
     path[l] = cur;
   }
@@ -196,8 +265,8 @@ SKNode* Skiplist::Find(int64_t score, const DynamicString& target, int start) co
   /* search from top to down */
   for (int l = start; l >= 0; --l) {
     /* search from left to right */
-    while (cur->nexts[l] && comparator_(score, target, *cur->nexts[l]) > 0) {
-      cur = cur->nexts[l];
+    while (cur->Next(l) && comparator_(score, target, *cur->Next(l)) > 0) {
+      cur = cur->Next(l);
     }
   }
   /**
@@ -213,12 +282,12 @@ void Skiplist::GatherAllNodes(std::vector<SKNode*>& nodes, bool include_head) co
     cur = head_;
     nodes.reserve(count_ + 1);
   } else {
-    cur = head_->nexts[0];
+    cur = head_->Next(0);
     nodes.reserve(count_);
   }
-  while (cur && cur->nexts) {
+  while (cur) {
     nodes.push_back(cur);
-    cur = cur->nexts[0];
+    cur = cur->Next(0);
   }
 }
 
@@ -227,7 +296,7 @@ std::ostream& operator<<(std::ostream& os, const Skiplist& sklist) {
   size_t cnt = sklist.count_;
   size_t idx = 1;
   while (p) {
-    p = p->nexts[0];
+    p = p->Next(0);
     if (p) {
       /* print node score, data and level */
       os << '[' << p->score << ", " << p->data << ", " << std::to_string(p->level) << ']';
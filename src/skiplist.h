@@ -5,35 +5,62 @@
 #include <cctype>
 #include <cstdint>
 #include <cstring>
+#include <ctime>
 #include <random>
+#include <stdexcept>
+#include <vector>
 
 #include "str.h"
-#include "valueobject.h"
 
 static constexpr uint8_t kMaxLevel = 32;
 
+struct SKNode;
+
+/* forward link of one level */
+struct SKLevel {
+  SKNode* next;
+  /* number of nodes stepped over by following next */
+  size_t span;
+};
+
+/**
+ * Skiplist node, its forward links are allocated inline right after the node,
+ * so nodes must be created by Create() and freed by Destroy()
+ */
 struct SKNode {
   int64_t score = 0l;
   DynamicString data;
 
   SKNode* prev = nullptr;
-  SKNode** nexts = nullptr;
   const uint8_t level = 1;
 
   SKNode() = delete;
 
-  SKNode(int64_t score, const DynamicString& data, uint8_t lv = 1);
+  SKNode(const SKNode&) = delete;
+
+  SKNode& operator=(const SKNode&) = delete;
+
+  static SKNode* Create(int64_t score, const DynamicString& data, uint8_t lv = 1);
+
+  static void Destroy(SKNode* node);
 
-  SKNode(int64_t score, DynamicString&& data, uint8_t lv = 1);
+  inline SKLevel* Levels() { return reinterpret_cast<SKLevel*>(this + 1); }
 
-  ~SKNode();
+  inline const SKLevel* Levels() const { return reinterpret_cast<const SKLevel*>(this + 1); }
+
+  inline SKNode* Next(int l = 0) const { return Levels()[l].next; }
 
   bool operator==(const SKNode& b) const {
     return this->data.Length() == b.data.Length() &&
            strncmp(this->data.Data(), b.data.Data(), this->data.Length()) == 0;
   }
+
+private:
+  SKNode(int64_t score, const DynamicString& data, uint8_t lv);
 };
 
+static_assert(alignof(SKLevel) <= alignof(SKNode), "SKLevel must be placed right after SKNode");
+
 /**
  * Comparator for SKNode
  */
@@ -148,23 +175,14 @@ public:
    *
    * @return SKNode*
    */
-  SKNode* Begin() const { return head_->nexts[0]; }
+  SKNode* Begin() const { return head_->Next(0); }
 
   /**
    * @brief Get the last node of skiplist
    *
    * @return SKNode*
    */
-  SKNode* End() const {
-    if (head_->nexts[0] == nullptr) return nullptr;
-    SKNode* cur = head_;
-    for (int l = kMaxLevel - 1; l >= 0; --l) {
-      while (cur->nexts[l]) {
-        cur = cur->nexts[l];
-      }
-    }
-    return cur;
-  }
+  SKNode* End() const { return tail_; }
 
   /**
    * @brief Get element at index using operator[]
@@ -174,6 +192,33 @@ public:
    */
   SKNode& operator[](size_t index);
 
+  /**
+   * @brief Get the rank of an element, the first element ranks 0
+   *
+   * @param score
+   * @param target
+   * @return long the 0-based rank, -1 if element does not exist
+   */
+  long Rank(int64_t score, const DynamicString& target) const;
+
+  /**
+   * @brief Get the node at the given rank
+   *
+   * @param rank 0-based rank
+   * @return SKNode* nullptr if rank is out of range
+   */
+  SKNode* GetByRank(size_t rank) const;
+
+  /**
+   * @brief Get the first node whose score is in range (min, +inf) if exclusive,
+   * otherwise [min, +inf)
+   *
+   * @param min
+   * @param exclusive
+   * @return SKNode* nullptr if no such node
+   */
+  SKNode* FirstInScoreRange(int64_t min, bool exclusive = false) const;
+
   std::vector<SKNode*> GetAllSKNodes() const {
     std::vector<SKNode*> nodes;
     GatherAllNodes(nodes, false);
@@ -192,6 +237,7 @@ private:
 
 private:
   SKNode* head_ = nullptr;
+  SKNode* tail_ = nullptr;
   size_t count_ = 0;
   uint8_t cur_max_level_ = 0;
   SKNodeComparator comparator_;
@@ -95,6 +95,34 @@ void DynamicString::Shrink() {
   }
 }
 
+void DynamicString::Resize(uint32_t len) {
+  if (len + 1 > alloc_) {
+    /* grow the same way as Append, so that consecutive small growths do not realloc every time */
+    uint32_t alloc = uint32_t(len * kBufGrowFactor + 1);
+    char* tmp = (char*)realloc(buf_, alloc);
+    if (tmp == nullptr) {
+      return;
+    }
+    buf_ = tmp;
+    alloc_ = alloc;
+  }
+  if (len > len_) {
+    memset(buf_ + len_, 0, len - len_);
+  }
+  len_ = len;
+  buf_[len_] = '\0';
+}
+
+void DynamicString::SetRange(uint32_t offset, const char* str, uint32_t len) {
+  if (offset + len > len_) {
+    Resize(offset + len);
+    if (offset + len != len_) { /* realloc fail */
+      return;
+    }
+  }
+  memcpy(buf_ + offset, str, len);
+}
+
 size_t DynamicString::Serialize(std::vector<char>& buf) const {
   return SerializeCharBuf(buf_, len_, buf);
 }
@@ -121,12 +149,12 @@ int64_t DynamicString::TryConvertToInt64() const {
   return ans;
 }
 
-bool CanConvertToInt64(const std::string& str, int64_t& ans) {
+bool CanConvertToInt64(const StringView& str, int64_t& ans) {
   if (str.empty() || str.size() > 20) {
     return false;
   }
   try {
-    int64_t tmp = std::stoll(str);
+    int64_t tmp = std::stoll(str.ToStdString());
     if (std::to_string(tmp) == str) {
       ans = tmp;
       return true;
@@ -10,6 +10,73 @@
 #include "encoding.h"
 #include "serializable.h"
 
+/**
+ * @brief Non-owning view of a string, the chars are referred to instead of copied, so they must
+ * outlive the view. The chars are always followed by a '\0'.
+ *
+ */
+class StringView {
+public:
+  StringView() : data_(""), len_(0) {}
+
+  StringView(const char *str, size_t len) : data_(str), len_(len) {}
+
+  StringView(const char *str) : data_(str), len_(strlen(str)) {}
+
+  StringView(const std::string &str) : data_(str.c_str()), len_(str.size()) {}
+
+  inline size_t size() const { return len_; }
+
+  inline size_t length() const { return len_; }
+
+  inline bool empty() const { return len_ == 0; }
+
+  inline const char *data() const { return data_; }
+
+  inline const char *c_str() const { return data_; }
+
+  inline const char *begin() const { return data_; }
+
+  inline const char *end() const { return data_ + len_; }
+
+  inline char operator[](size_t idx) const { return data_[idx]; }
+
+  inline char front() const { return data_[0]; }
+
+  inline char back() const { return data_[len_ - 1]; }
+
+  std::string ToStdString() const { return std::string(data_, len_); }
+
+  operator std::string() const { return ToStdString(); }
+
+  bool operator==(const StringView &other) const {
+    return len_ == other.len_ && memcmp(data_, other.data_, len_) == 0;
+  }
+
+  bool operator!=(const StringView &other) const { return !(*this == other); }
+
+  bool operator==(const char *other) const { return *this == StringView(other); }
+
+  bool operator!=(const char *other) const { return !(*this == StringView(other)); }
+
+  bool operator==(const std::string &other) const { return *this == StringView(other); }
+
+  bool operator!=(const std::string &other) const { return !(*this == StringView(other)); }
+
+  friend bool operator==(const std::string &a, const StringView &b) { return b == a; }
+
+  friend bool operator!=(const std::string &a, const StringView &b) { return b != a; }
+
+  friend std::ostream &operator<<(std::ostream &ss, const StringView &s) {
+    ss.write(s.data_, s.len_);
+    return ss;
+  }
+
+private:
+  const char *data_;
+  size_t len_;
+};
+
 /**
  * @brief Static sized string
  *
@@ -40,13 +107,24 @@ public:
     if (other.buf_ != nullptr) {
       buf_ = other.buf_;
       len_ = other.len_;
+      borrowed_ = other.borrowed_;
       other.buf_ = nullptr;
       other.len_ = 0;
+      other.borrowed_ = false;
     }
   }
 
   explicit StaticString(const std::string &str) : StaticString(str.c_str()) {}
 
+  /* refer to the chars of str without copying, only for looking up keys */
+  static StaticString Borrow(const StringView &str) {
+    StaticString ans;
+    ans.buf_ = const_cast<char *>(str.data());
+    ans.len_ = str.size();
+    ans.borrowed_ = true;
+    return ans;
+  }
+
   StaticString(const StaticString &other) {
     if (other.buf_ != nullptr) {
       buf_ = (char *)malloc(other.len_ + 1);
@@ -65,14 +143,17 @@ public:
       memcpy(buf, other.buf_, other.len_);
       len_ = other.len_;
       buf[len_] = '\0';
-      free(buf_);
+      if (!borrowed_) {
+        free(buf_);
+      }
       buf_ = buf;
+      borrowed_ = false;
     }
     return *this;
   }
 
   ~StaticString() {
-    if (buf_ != nullptr) {
+    if (buf_ != nullptr && !borrowed_) {
       free(buf_);
       len_ = 0;
       buf_ = nullptr;
@@ -114,7 +195,9 @@ public:
   size_t Serialize(std::vector<char> &buf) const override;
 
 private:
-  size_t len_ = 0;
+  uint32_t len_ = 0;
+  /* buf_ is not owned and not freed, the copies of a borrowed string own their chars */
+  bool borrowed_ = false;
   char *buf_ = nullptr;
 };
 
@@ -130,6 +213,9 @@ typedef std::shared_ptr<StaticString> StaticStringPtr;
 
 const static float kBufGrowFactor = 1.5;
 
+/* maximum length of a dynamic string, 512MB */
+const static uint32_t kMaxStringLength = 512 * 1024 * 1024;
+
 /**
  * @brief Dynamic sized string
  *
@@ -204,10 +290,26 @@ public:
     return *this;
   };
 
+  DynamicString &operator=(DynamicString &&x) noexcept {
+    /* take over the buffer of x and leave x null */
+    if (this != &x) {
+      free(buf_);
+      buf_ = x.buf_;
+      len_ = x.len_;
+      alloc_ = x.alloc_;
+      x.buf_ = nullptr;
+      x.len_ = 0;
+      x.alloc_ = 0;
+    }
+    return *this;
+  }
+
   size_t Hash() const { return Time33Hash(buf_, len_); }
 
   inline const char *Data() const { return buf_; }
 
+  inline char *MutableData() { return buf_; }
+
   inline uint32_t Length() const { return len_; }
 
   inline uint32_t Allocated() const { return alloc_; }
@@ -236,6 +338,12 @@ public:
 
   void Shrink();
 
+  /* change length to len, newly added bytes are zero */
+  void Resize(uint32_t len);
+
+  /* overwrite content starting at offset, the string is zero padded if offset is beyond the end */
+  void SetRange(uint32_t offset, const char *str, uint32_t len);
+
   size_t Serialize(std::vector<char> &buf) const override;
 
   inline std::string ToStdString() const {
@@ -335,7 +443,7 @@ private:
   char *buf_ = nullptr;
 };
 
-bool CanConvertToInt64(const std::string &str, int64_t &val);
+bool CanConvertToInt64(const StringView &str, int64_t &val);
 
 bool CanConvertToInt32(const std::string &str, int &val);
 
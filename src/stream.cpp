@@ -0,0 +1,443 @@
+#include <algorithm>
+#include <cstring>
+#include "stream.h"
+
+/* last id, length and number of segments */
+static constexpr size_t kStreamHeaderBytes = 16 + 8 + 4;
+/* first id, last id, number of entries and data length */
+static constexpr size_t kStreamSegmentHeaderBytes = 16 + 16 + 4 + 4;
+
+static bool ParseUInt64(const char *str, size_t len, uint64_t &value) {
+  if (len == 0 || len > 20) {
+    return false;
+  }
+  value = 0;
+  for (size_t i = 0; i < len; ++i) {
+    if (str[i] < '0' || str[i] > '9') {
+      return false;
+    }
+    uint64_t digit = str[i] - '0';
+    if (value > (UINT64_MAX - digit) / 10) {
+      return false;
+    }
+    value = value * 10 + digit;
+  }
+  return true;
+}
+
+static void AppendVarint(std::string &data, uint64_t value) {
+  unsigned char buf[10];
+  uint8_t size = EncodeVarUnsignedInt64(value, buf);
+  data.append((const char *)buf, size);
+}
+
+static bool ReadVarint(const std::string &data, size_t &offset, uint64_t &value) {
+  value = 0;
+  for (uint32_t shift = 0; shift <= 63 && offset < data.size(); shift += 7) {
+    uint64_t byte = (unsigned char)data[offset++];
+    value |= (byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ReadString(const std::string &data, size_t &offset, std::string *str) {
+  uint64_t len;
+  if (!ReadVarint(data, offset, len) || data.size() - offset < len) {
+    return false;
+  }
+  if (str != nullptr) {
+    str->assign(data, offset, len);
+  }
+  offset += len;
+  return true;
+}
+
+bool StreamID::Parse(const std::string &str, uint64_t missing_seq, StreamID &id) {
+  size_t dash = str.find('-');
+  if (dash == std::string::npos) {
+    id.seq = missing_seq;
+    return ParseUInt64(str.data(), str.size(), id.ms);
+  }
+  return ParseUInt64(str.data(), dash, id.ms) &&
+         ParseUInt64(str.data() + dash + 1, str.size() - dash - 1, id.seq);
+}
+
+std::string StreamID::ToString() const {
+  return std::to_string(ms) + '-' + std::to_string(seq);
+}
+
+bool StreamID::Incr() {
+  if (seq != UINT64_MAX) {
+    ++seq;
+  } else if (ms != UINT64_MAX) {
+    ++ms;
+    seq = 0;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool StreamID::Decr() {
+  if (seq != 0) {
+    --seq;
+  } else if (ms != 0) {
+    --ms;
+    seq = UINT64_MAX;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool StreamIDSpec::Parse(const std::string &str, StreamIDSpec &spec) {
+  if (str == "*") {
+    spec.auto_ms = true;
+    spec.auto_seq = true;
+    return true;
+  }
+  spec.auto_ms = false;
+  size_t dash = str.find('-');
+  if (dash != std::string::npos && str.compare(dash + 1, std::string::npos, "*") == 0) {
+    spec.auto_seq = true;
+    return ParseUInt64(str.data(), dash, spec.id.ms);
+  }
+  spec.auto_seq = false;
+  return StreamID::Parse(str, 0, spec.id);
+}
+
+bool Stream::Add(const StreamIDSpec &spec, uint64_t now_ms, const std::vector<std::string> &fields,
+                 StreamID &id) {
+  if (spec.auto_ms) {
+    if (now_ms > last_id_.ms) {
+      id = StreamID(now_ms, 0);
+    } else {
+      /* clock goes backwards, keep on increasing from the last id */
+      id = last_id_;
+      if (!id.Incr()) {
+        return false;
+      }
+    }
+  } else if (spec.auto_seq) {
+    if (spec.id.ms > last_id_.ms) {
+      id = StreamID(spec.id.ms, 0);
+    } else if (spec.id.ms == last_id_.ms && last_id_.seq != UINT64_MAX) {
+      id = StreamID(spec.id.ms, last_id_.seq + 1);
+    } else {
+      return false;
+    }
+  } else {
+    id = spec.id;
+  }
+  if (id <= last_id_) {
+    return false;
+  }
+  if (segments_.empty() || segments_.back().count >= kStreamSegmentMaxEntries ||
+      segments_.back().data.size() >= kStreamSegmentMaxBytes) {
+    segments_.emplace_back();
+  }
+  AppendEntry(segments_.back(), id, fields);
+  last_id_ = id;
+  ++length_;
+  return true;
+}
+
+void Stream::AppendEntry(Segment &segment, const StreamID &id,
+                         const std::vector<std::string> &fields) {
+  size_t n_pairs = fields.size() / 2;
+  StreamID prev = segment.last;
+  bool same_fields = false;
+  if (segment.count == 0) {
+    segment.first = id;
+    prev = id;
+    segment.master_fields.clear();
+    for (size_t i = 0; i < n_pairs; ++i) {
+      segment.master_fields.emplace_back(fields[i * 2]);
+    }
+  } else if (n_pairs == segment.master_fields.size()) {
+    same_fields = true;
+    for (size_t i = 0; i < n_pairs && same_fields; ++i) {
+      same_fields = fields[i * 2] == segment.master_fields[i];
+    }
+  }
+  AppendVarint(segment.data, id.ms - prev.ms);
+  AppendVarint(segment.data, id.ms == prev.ms ? id.seq - prev.seq : id.seq);
+  AppendVarint(segment.data, (n_pairs << 1) | (same_fields ? 1 : 0));
+  for (size_t i = 0; i < n_pairs; ++i) {
+    if (!same_fields) {
+      AppendVarint(segment.data, fields[i * 2].size());
+      segment.data.append(fields[i * 2]);
+    }
+    AppendVarint(segment.data, fields[i * 2 + 1].size());
+    segment.data.append(fields[i * 2 + 1]);
+  }
+  segment.last = id;
+  ++segment.count;
+}
+
+bool Stream::DecodeEntry(const Segment &segment, size_t &offset, StreamID &id,
+                         StreamEntry *entry) {
+  uint64_t ms_delta, seq, flag;
+  if (!ReadVarint(segment.data, offset, ms_delta) || !ReadVarint(segment.data, offset, seq) ||
+      !ReadVarint(segment.data, offset, flag) || ms_delta > UINT64_MAX - id.ms) {
+    return false;
+  }
+  if (ms_delta == 0) {
+    if (seq > UINT64_MAX - id.seq) {
+      return false;
+    }
+    seq += id.seq;
+  }
+  id = StreamID(id.ms + ms_delta, seq);
+  uint64_t n_pairs = flag >> 1;
+  bool same_fields = flag & 1;
+  if (same_fields && n_pairs != segment.master_fields.size()) {
+    return false;
+  }
+  if (entry != nullptr) {
+    entry->id = id;
+    entry->fields.clear();
+    entry->fields.reserve(std::min<uint64_t>(n_pairs, segment.data.size()) * 2);
+  }
+  for (uint64_t i = 0; i < n_pairs; ++i) {
+    std::string *field = nullptr, *value = nullptr;
+    if (entry != nullptr) {
+      entry->fields.emplace_back();
+      entry->fields.emplace_back();
+      field = &entry->fields[entry->fields.size() - 2];
+      value = &entry->fields.back();
+    }
+    if (same_fields) {
+      if (field != nullptr) {
+        *field = segment.master_fields[i];
+      }
+    } else if (!ReadString(segment.data, offset, field)) {
+      return false;
+    }
+    if (!ReadString(segment.data, offset, value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Stream::DecodeAll(const Segment &segment, std::vector<StreamEntry> &entries) {
+  entries.resize(segment.count);
+  size_t offset = 0;
+  StreamID id = segment.first;
+  for (auto &entry : entries) {
+    if (!DecodeEntry(segment, offset, id, &entry)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<StreamEntry> Stream::Range(const StreamID &start, const StreamID &end, size_t count,
+                                       bool reversed) const {
+  std::vector<StreamEntry> entries;
+  if (start > end) {
+    return entries;
+  }
+  if (count == 0) {
+    count = SIZE_MAX;
+  }
+  if (!reversed) {
+    /* the first segment which may contain start */
+    auto it = std::lower_bound(
+        segments_.begin(), segments_.end(), start,
+        [](const Segment &segment, const StreamID &id) { return segment.last < id; });
+    for (; it != segments_.end() && it->first <= end; ++it) {
+      size_t offset = 0;
+      StreamID id = it->first;
+      for (uint32_t i = 0; i < it->count; ++i) {
+        size_t entry_offset = offset;
+        StreamID prev = id;
+        /* peek the id before decoding fields */
+        DecodeEntry(*it, offset, id, nullptr);
+        if (id > end) {
+          return entries;
+        }
+        if (id >= start) {
+          entries.emplace_back();
+          DecodeEntry(*it, entry_offset, prev, &entries.back());
+          if (entries.size() == count) {
+            return entries;
+          }
+        }
+      }
+    }
+    return entries;
+  }
+  /* the segment after the last one which may contain end */
+  auto it = std::upper_bound(
+      segments_.begin(), segments_.end(), end,
+      [](const StreamID &id, const Segment &segment) { return id < segment.first; });
+  std::vector<StreamEntry> decoded;
+  while (it != segments_.begin()) {
+    --it;
+    if (it->last < start) {
+      break;
+    }
+    DecodeAll(*it, decoded);
+    for (auto entry = decoded.rbegin(); entry != decoded.rend(); ++entry) {
+      if (entry->id > end) {
+        continue;
+      }
+      if (entry->id < start) {
+        return entries;
+      }
+      entries.emplace_back(std::move(*entry));
+      if (entries.size() == count) {
+        return entries;
+      }
+    }
+  }
+  return entries;
+}
+
+void Stream::DropFront(size_t n) {
+  Segment &front = segments_.front();
+  if (n >= front.count) {
+    length_ -= front.count;
+    segments_.pop_front();
+    return;
+  }
+  std::vector<StreamEntry> entries;
+  DecodeAll(front, entries);
+  Segment segment;
+  for (size_t i = n; i < entries.size(); ++i) {
+    AppendEntry(segment, entries[i].id, entries[i].fields);
+  }
+  front = std::move(segment);
+  length_ -= n;
+}
+
+uint64_t Stream::TrimByLength(uint64_t maxlen, bool approx) {
+  uint64_t origin = length_;
+  while (!segments_.empty() && length_ - segments_.front().count >= maxlen) {
+    length_ -= segments_.front().count;
+    segments_.pop_front();
+  }
+  if (!approx && length_ > maxlen) {
+    DropFront(length_ - maxlen);
+  }
+  return origin - length_;
+}
+
+uint64_t Stream::TrimByMinID(const StreamID &minid, bool approx) {
+  uint64_t origin = length_;
+  while (!segments_.empty() && segments_.front().last < minid) {
+    length_ -= segments_.front().count;
+    segments_.pop_front();
+  }
+  if (!approx && !segments_.empty() && segments_.front().first < minid) {
+    const Segment &front = segments_.front();
+    size_t offset = 0, n = 0;
+    StreamID id = front.first;
+    while (DecodeEntry(front, offset, id, nullptr) && id < minid) {
+      ++n;
+    }
+    DropFront(n);
+  }
+  return origin - length_;
+}
+
+static void AppendID(std::string &data, const StreamID &id) {
+  data.append((const char *)&id.ms, 8);
+  data.append((const char *)&id.seq, 8);
+}
+
+std::string Stream::Dump() const {
+  std::string data;
+  size_t size = kStreamHeaderBytes;
+  for (const auto &segment : segments_) {
+    size += kStreamSegmentHeaderBytes + segment.data.size();
+  }
+  data.reserve(size);
+  uint32_t n_segments = segments_.size();
+  AppendID(data, last_id_);
+  data.append((const char *)&length_, 8);
+  data.append((const char *)&n_segments, 4);
+  for (const auto &segment : segments_) {
+    uint32_t data_len = segment.data.size();
+    AppendID(data, segment.first);
+    AppendID(data, segment.last);
+    data.append((const char *)&segment.count, 4);
+    data.append((const char *)&data_len, 4);
+    data.append(segment.data);
+  }
+  return data;
+}
+
+bool Stream::Load(const char *data, size_t len) {
+  const char *end = data + len;
+  auto read = [&data, end](void *out, size_t n) {
+    if ((size_t)(end - data) < n) {
+      return false;
+    }
+    memcpy(out, data, n);
+    data += n;
+    return true;
+  };
+  StreamID last_id;
+  uint64_t length, total = 0;
+  uint32_t n_segments;
+  if (!read(&last_id.ms, 8) || !read(&last_id.seq, 8) || !read(&length, 8) ||
+      !read(&n_segments, 4)) {
+    return false;
+  }
+  std::deque<Segment> segments;
+  for (uint32_t i = 0; i < n_segments; ++i) {
+    Segment segment;
+    uint32_t data_len;
+    if (!read(&segment.first.ms, 8) || !read(&segment.first.seq, 8) ||
+        !read(&segment.last.ms, 8) || !read(&segment.last.seq, 8) || !read(&segment.count, 4) ||
+        !read(&data_len, 4) || (size_t)(end - data) < data_len || segment.count == 0 ||
+        (!segments.empty() && segment.first <= segments.back().last)) {
+      return false;
+    }
+    segment.data.assign(data, data_len);
+    data += data_len;
+    /* every entry is checked here, so that decoding never fails afterwards */
+    size_t offset = 0;
+    StreamID id = segment.first;
+    StreamEntry first;
+    if (!DecodeEntry(segment, offset, id, &first) || id != segment.first) {
+      return false;
+    }
+    for (size_t j = 0; j < first.fields.size(); j += 2) {
+      segment.master_fields.emplace_back(first.fields[j]);
+    }
+    for (uint32_t j = 1; j < segment.count; ++j) {
+      StreamID prev = id;
+      if (!DecodeEntry(segment, offset, id, nullptr) || id <= prev) {
+        return false;
+      }
+    }
+    if (offset != segment.data.size() || id != segment.last) {
+      return false;
+    }
+    total += segment.count;
+    segments.emplace_back(std::move(segment));
+  }
+  if (data != end || total != length || (!segments.empty() && segments.back().last > last_id)) {
+    return false;
+  }
+  last_id_ = last_id;
+  length_ = length;
+  segments_.swap(segments);
+  return true;
+}
+
+size_t Stream::Serialize(std::vector<char> &buf) const {
+  std::string data = Dump();
+  unsigned char enc_buf[10] = {0};
+  uint8_t enc_size = EncodeVarUnsignedInt64(data.size(), enc_buf);
+  buf.insert(buf.end(), enc_buf, enc_buf + enc_size);
+  buf.insert(buf.end(), data.begin(), data.end());
+  return buf.size();
+}
@@ -0,0 +1,156 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "serializable.h"
+#include "encoding.h"
+
+/* a segment stops taking new entries once it reaches either of the limits */
+static constexpr uint32_t kStreamSegmentMaxEntries = 128;
+static constexpr size_t kStreamSegmentMaxBytes = 4096;
+
+/* stream entry id, made up of milliseconds and sequence number */
+struct StreamID {
+  uint64_t ms = 0;
+  uint64_t seq = 0;
+
+  StreamID() = default;
+
+  StreamID(uint64_t ms, uint64_t seq) : ms(ms), seq(seq) {}
+
+  static StreamID Min() { return StreamID(0, 0); }
+
+  static StreamID Max() { return StreamID(UINT64_MAX, UINT64_MAX); }
+
+  /* parse "ms-seq" or "ms" with missing_seq as seq, return false if malformed */
+  static bool Parse(const std::string &str, uint64_t missing_seq, StreamID &id);
+
+  std::string ToString() const;
+
+  /* move to the next id, return false if it is already the max one */
+  bool Incr();
+
+  /* move to the previous id, return false if it is already the min one */
+  bool Decr();
+
+  bool operator==(const StreamID &other) const { return ms == other.ms && seq == other.seq; }
+
+  bool operator!=(const StreamID &other) const { return !(*this == other); }
+
+  bool operator<(const StreamID &other) const {
+    return ms < other.ms || (ms == other.ms && seq < other.seq);
+  }
+
+  bool operator>(const StreamID &other) const { return other < *this; }
+
+  bool operator<=(const StreamID &other) const { return !(other < *this); }
+
+  bool operator>=(const StreamID &other) const { return !(*this < other); }
+};
+
+/* id given when adding an entry: "*", "ms-*" or "ms-seq" */
+struct StreamIDSpec {
+  bool auto_ms = true;
+  bool auto_seq = true;
+  StreamID id;
+
+  /* return false if malformed */
+  static bool Parse(const std::string &str, StreamIDSpec &spec);
+};
+
+struct StreamEntry {
+  StreamID id;
+  /* field1, value1, field2, value2 ... */
+  std::vector<std::string> fields;
+};
+
+/**
+ * @brief Append-only log of entries with increasing ids. Entries are packed into segments,
+ * each one holds a run of entries encoded one after another, where the id of an entry is
+ * stored as the delta to the previous one and field names equal to those of the first entry
+ * in the segment are omitted. Segments are kept in id order and located by binary search.
+ */
+class Stream : public Serializable {
+public:
+  Stream() = default;
+
+  inline uint64_t Length() const { return length_; }
+
+  /* id of the last entry ever added, it never goes back even if entries are trimmed */
+  inline StreamID LastID() const { return last_id_; }
+
+  inline size_t NumSegments() const { return segments_.size(); }
+
+  /**
+   * @brief Append an entry
+   *
+   * @param spec id of the entry, the automatic part is generated from now_ms and the last id
+   * @param fields field1, value1, field2, value2 ...
+   * @param id the id of the added entry
+   * @return false if the id is not greater than the last id
+   */
+  bool Add(const StreamIDSpec &spec, uint64_t now_ms, const std::vector<std::string> &fields,
+           StreamID &id);
+
+  /* entries with id in [start, end], from high to low if reversed, count 0 means no limit */
+  std::vector<StreamEntry> Range(const StreamID &start, const StreamID &end, size_t count,
+                                 bool reversed) const;
+
+  /**
+   * @brief Remove the oldest entries so that at most maxlen entries are left
+   *
+   * @param approx only remove whole segments, which may leave a few more entries
+   * @return the number of entries removed
+   */
+  uint64_t TrimByLength(uint64_t maxlen, bool approx);
+
+  /* remove entries with id less than minid, approx works as in TrimByLength */
+  uint64_t TrimByMinID(const StreamID &minid, bool approx);
+
+  /* last id, length and the packed segments */
+  std::string Dump() const;
+
+  /* restore from the output of Dump, return false if data is malformed */
+  bool Load(const char *data, size_t len);
+
+  size_t Serialize(std::vector<char> &buf) const override;
+
+private:
+  struct Segment {
+    StreamID first;
+    StreamID last;
+    uint32_t count = 0;
+    /* encoded entries */
+    std::string data;
+    /* field names of the first entry */
+    std::vector<std::string> master_fields;
+  };
+
+  static void AppendEntry(Segment &segment, const StreamID &id,
+                          const std::vector<std::string> &fields);
+
+  /**
+   * @brief Decode the entry at offset of segment and move offset to the next one
+   *
+   * @param id id of the previous entry, which is updated to id of the decoded entry
+   * @param entry the decoded entry, only the id is decoded if it is nullptr
+   * @return false if data is malformed
+   */
+  static bool DecodeEntry(const Segment &segment, size_t &offset, StreamID &id,
+                          StreamEntry *entry);
+
+  static bool DecodeAll(const Segment &segment, std::vector<StreamEntry> &entries);
+
+  /* remove the first n entries of the first segment */
+  void DropFront(size_t n);
+
+private:
+  StreamID last_id_;
+  uint64_t length_ = 0;
+  std::deque<Segment> segments_;
+};
+
+#endif  // __STREAM_H__
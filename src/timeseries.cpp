@@ -0,0 +1,414 @@
+#include <algorithm>
+#include <cstring>
+#include "timeseries.h"
+
+/* retention, length and number of chunks */
+static constexpr size_t kTSHeaderBytes = 8 + 8 + 4;
+/* first timestamp, last timestamp, number of samples and number of bits */
+static constexpr size_t kTSChunkHeaderBytes = 8 + 8 + 4 + 8;
+
+static inline uint64_t LowBits(uint64_t value, uint32_t n) {
+  return n == 64 ? value : value & ((1ULL << n) - 1);
+}
+
+static inline int64_t SignExtend(uint64_t value, uint32_t n) {
+  return n == 64 ? (int64_t)value : (int64_t)(value << (64 - n)) >> (64 - n);
+}
+
+static inline uint64_t DoubleBits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, 8);
+  return bits;
+}
+
+static inline double BitsDouble(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, 8);
+  return value;
+}
+
+/* decodes samples of a chunk one by one, in the same way as they are appended */
+class TimeSeries::ChunkReader {
+public:
+  explicit ChunkReader(const Chunk &chunk) : chunk_(chunk) {}
+
+  /* false if all samples have been read or data is malformed */
+  bool Next(int64_t &timestamp, double &value) {
+    if (read_ == chunk_.count || failed_) {
+      return false;
+    }
+    if (!(read_ == 0 ? ReadFirst() : ReadNext())) {
+      failed_ = true;
+      return false;
+    }
+    ++read_;
+    timestamp = (int64_t)ts_;
+    value = BitsDouble(value_);
+    return true;
+  }
+
+  /* all bits are consumed */
+  inline bool Exhausted() const { return pos_ == chunk_.n_bits; }
+
+  /* restore the appending state of chunk after all samples are read */
+  void RestoreState(Chunk &chunk) const {
+    chunk.last_delta = delta_;
+    chunk.last_value = value_;
+    chunk.leading = leading_;
+    chunk.trailing = trailing_;
+  }
+
+private:
+  bool ReadBits(uint32_t n, uint64_t &bits) {
+    if (chunk_.n_bits - pos_ < n) {
+      return false;
+    }
+    bits = 0;
+    while (n > 0) {
+      uint32_t offset = pos_ & 7;
+      uint32_t take = std::min(8 - offset, n);
+      uint8_t byte = chunk_.data[pos_ >> 3];
+      bits = (bits << take) | ((byte >> (8 - offset - take)) & ((1u << take) - 1));
+      pos_ += take;
+      n -= take;
+    }
+    return true;
+  }
+
+  bool ReadFirst() { return ReadBits(64, ts_) && ReadBits(64, value_); }
+
+  bool ReadNext() {
+    /* delta of delta, the number of leading 1s picks the width */
+    static constexpr uint32_t kWidths[] = {0, 7, 9, 12, 64};
+    uint64_t bit = 1, dod = 0;
+    uint32_t ones = 0;
+    while (ones < 4 && ReadBits(1, bit) && bit == 1) {
+      ++ones;
+    }
+    if (ones < 4 && bit == 1) {
+      return false;
+    }
+    if (ones > 0) {
+      if (!ReadBits(kWidths[ones], dod)) {
+        return false;
+      }
+      dod = (uint64_t)SignExtend(dod, kWidths[ones]);
+    }
+    delta_ += dod;
+    ts_ += delta_;
+    /* xor of value */
+    uint64_t flag, bits;
+    if (!ReadBits(1, flag)) {
+      return false;
+    }
+    if (flag == 0) {
+      return true;
+    }
+    if (!ReadBits(1, flag)) {
+      return false;
+    }
+    if (flag == 1) {
+      uint64_t leading, length;
+      if (!ReadBits(6, leading) || !ReadBits(6, length) || leading + length + 1 > 64) {
+        return false;
+      }
+      leading_ = leading;
+      trailing_ = 64 - leading - length - 1;
+    } else if (leading_ == kTSNoWindow) {
+      return false;
+    }
+    uint32_t meaningful = 64 - leading_ - trailing_;
+    if (!ReadBits(meaningful, bits) || bits == 0) {
+      return false;
+    }
+    value_ ^= bits << trailing_;
+    return true;
+  }
+
+private:
+  const Chunk &chunk_;
+  uint64_t pos_ = 0;
+  uint32_t read_ = 0;
+  bool failed_ = false;
+  uint64_t ts_ = 0;
+  uint64_t delta_ = 0;
+  uint64_t value_ = 0;
+  uint8_t leading_ = kTSNoWindow;
+  uint8_t trailing_ = 0;
+};
+
+void TimeSeries::WriteBits(Chunk &chunk, uint64_t value, uint32_t n) {
+  value = LowBits(value, n);
+  while (n > 0) {
+    uint32_t offset = chunk.n_bits & 7;
+    if (offset == 0) {
+      chunk.data.push_back('\0');
+    }
+    uint32_t take = std::min(8 - offset, n);
+    uint8_t bits = (value >> (n - take)) & ((1u << take) - 1);
+    chunk.data.back() |= (char)(bits << (8 - offset - take));
+    chunk.n_bits += take;
+    n -= take;
+  }
+}
+
+void TimeSeries::Append(Chunk &chunk, int64_t timestamp, double value) {
+  uint64_t bits = DoubleBits(value);
+  if (chunk.count == 0) {
+    WriteBits(chunk, (uint64_t)timestamp, 64);
+    WriteBits(chunk, bits, 64);
+    chunk.first_ts = timestamp;
+  } else {
+    /* timestamps of regular interval have delta of delta 0, which takes only one bit */
+    uint64_t delta = (uint64_t)timestamp - (uint64_t)chunk.last_ts;
+    int64_t dod = (int64_t)(delta - chunk.last_delta);
+    if (dod == 0) {
+      WriteBits(chunk, 0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+      WriteBits(chunk, 0x2, 2);
+      WriteBits(chunk, (uint64_t)dod, 7);
+    } else if (dod >= -256 && dod <= 255) {
+      WriteBits(chunk, 0x6, 3);
+      WriteBits(chunk, (uint64_t)dod, 9);
+    } else if (dod >= -2048 && dod <= 2047) {
+      WriteBits(chunk, 0xe, 4);
+      WriteBits(chunk, (uint64_t)dod, 12);
+    } else {
+      WriteBits(chunk, 0xf, 4);
+      WriteBits(chunk, (uint64_t)dod, 64);
+    }
+    chunk.last_delta = delta;
+    /* close values share sign, exponent and high bits of mantissa, so their xor is short */
+    uint64_t xor_bits = bits ^ chunk.last_value;
+    if (xor_bits == 0) {
+      WriteBits(chunk, 0, 1);
+    } else {
+      uint32_t leading = __builtin_clzll(xor_bits);
+      uint32_t trailing = __builtin_ctzll(xor_bits);
+      if (chunk.leading != kTSNoWindow && leading >= chunk.leading &&
+          trailing >= chunk.trailing) {
+        /* fits in the window of the previous xor */
+        WriteBits(chunk, 0x2, 2);
+        WriteBits(chunk, xor_bits >> chunk.trailing, 64 - chunk.leading - chunk.trailing);
+      } else {
+        uint32_t meaningful = 64 - leading - trailing;
+        WriteBits(chunk, 0x3, 2);
+        WriteBits(chunk, leading, 6);
+        WriteBits(chunk, meaningful - 1, 6);
+        WriteBits(chunk, xor_bits >> trailing, meaningful);
+        chunk.leading = leading;
+        chunk.trailing = trailing;
+      }
+    }
+  }
+  chunk.last_value = bits;
+  chunk.last_ts = timestamp;
+  ++chunk.count;
+}
+
+bool TimeSeries::LastSample(TSSample &sample) const {
+  if (chunks_.empty()) {
+    return false;
+  }
+  const Chunk &back = chunks_.back();
+  sample.first = back.last_ts;
+  sample.second = BitsDouble(back.last_value);
+  return true;
+}
+
+int64_t TimeSeries::RetentionCutoff() const {
+  if (retention_ == 0 || chunks_.empty()) {
+    return INT64_MIN;
+  }
+  uint64_t last = chunks_.back().last_ts;
+  if (last - (uint64_t)INT64_MIN <= retention_) {
+    return INT64_MIN;
+  }
+  return (int64_t)(last - retention_);
+}
+
+bool TimeSeries::Add(int64_t timestamp, double value) {
+  if (!chunks_.empty() && timestamp <= chunks_.back().last_ts) {
+    return false;
+  }
+  if (chunks_.empty() || chunks_.back().data.size() >= kTSChunkMaxBytes) {
+    chunks_.emplace_back();
+  }
+  Append(chunks_.back(), timestamp, value);
+  ++length_;
+  /* only whole chunks are dropped, the last one always stays */
+  int64_t cutoff = RetentionCutoff();
+  while (chunks_.size() > 1 && chunks_.front().last_ts < cutoff) {
+    length_ -= chunks_.front().count;
+    chunks_.pop_front();
+  }
+  return true;
+}
+
+template <typename Visitor>
+void TimeSeries::ForEach(int64_t from, int64_t to, Visitor visit) const {
+  from = std::max(from, RetentionCutoff());
+  if (from > to) {
+    return;
+  }
+  auto it = std::lower_bound(chunks_.begin(), chunks_.end(), from,
+                             [](const Chunk &chunk, int64_t ts) { return chunk.last_ts < ts; });
+  for (; it != chunks_.end() && it->first_ts <= to; ++it) {
+    ChunkReader reader(*it);
+    int64_t timestamp;
+    double value;
+    while (reader.Next(timestamp, value)) {
+      if (timestamp < from) {
+        continue;
+      }
+      if (timestamp > to || !visit(timestamp, value)) {
+        return;
+      }
+    }
+  }
+}
+
+std::vector<TSSample> TimeSeries::Range(int64_t from, int64_t to, size_t count) const {
+  std::vector<TSSample> samples;
+  ForEach(from, to, [&samples, count](int64_t timestamp, double value) {
+    samples.emplace_back(timestamp, value);
+    return count == 0 || samples.size() < count;
+  });
+  return samples;
+}
+
+/* start of the bucket which timestamp falls into, rounded towards negative infinity */
+static inline int64_t BucketStart(int64_t timestamp, uint64_t bucket_ms) {
+  __int128 start = (__int128)timestamp - (((__int128)timestamp % bucket_ms + bucket_ms) % bucket_ms);
+  return start < INT64_MIN ? INT64_MIN : (int64_t)start;
+}
+
+std::vector<TSSample> TimeSeries::Aggregate(int64_t from, int64_t to, int aggregation,
+                                            uint64_t bucket_ms, size_t count) const {
+  std::vector<TSSample> buckets;
+  if (bucket_ms == 0) {
+    return buckets;
+  }
+  /* samples are folded into the current bucket as they are decoded */
+  int64_t start = 0;
+  uint64_t n = 0;
+  double sum = 0, min = 0, max = 0;
+  auto emit = [&]() {
+    double result = 0;
+    switch (aggregation) {
+      case kTSAggAvg: result = sum / n; break;
+      case kTSAggMin: result = min; break;
+      case kTSAggMax: result = max; break;
+      case kTSAggSum: result = sum; break;
+      case kTSAggCount: result = (double)n; break;
+    }
+    buckets.emplace_back(start, result);
+  };
+  ForEach(from, to, [&](int64_t timestamp, double value) {
+    int64_t bucket = BucketStart(timestamp, bucket_ms);
+    if (n > 0 && bucket != start) {
+      emit();
+      n = 0;
+      if (count != 0 && buckets.size() == count) {
+        return false;
+      }
+    }
+    if (n == 0) {
+      start = bucket;
+      sum = 0;
+      min = max = value;
+    }
+    ++n;
+    sum += value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+    return true;
+  });
+  if (n > 0) {
+    emit();
+  }
+  return buckets;
+}
+
+std::string TimeSeries::Dump() const {
+  std::string data;
+  size_t size = kTSHeaderBytes;
+  for (const auto &chunk : chunks_) {
+    size += kTSChunkHeaderBytes + chunk.data.size();
+  }
+  data.reserve(size);
+  uint32_t n_chunks = chunks_.size();
+  data.append((const char *)&retention_, 8);
+  data.append((const char *)&length_, 8);
+  data.append((const char *)&n_chunks, 4);
+  for (const auto &chunk : chunks_) {
+    data.append((const char *)&chunk.first_ts, 8);
+    data.append((const char *)&chunk.last_ts, 8);
+    data.append((const char *)&chunk.count, 4);
+    data.append((const char *)&chunk.n_bits, 8);
+    data.append(chunk.data);
+  }
+  return data;
+}
+
+bool TimeSeries::Load(const char *data, size_t len) {
+  const char *end = data + len;
+  auto read = [&data, end](void *out, size_t n) {
+    if ((size_t)(end - data) < n) {
+      return false;
+    }
+    memcpy(out, data, n);
+    data += n;
+    return true;
+  };
+  uint64_t retention, length, total = 0;
+  uint32_t n_chunks;
+  if (!read(&retention, 8) || !read(&length, 8) || !read(&n_chunks, 4)) {
+    return false;
+  }
+  std::deque<Chunk> chunks;
+  for (uint32_t i = 0; i < n_chunks; ++i) {
+    Chunk chunk;
+    if (!read(&chunk.first_ts, 8) || !read(&chunk.last_ts, 8) || !read(&chunk.count, 4) ||
+        !read(&chunk.n_bits, 8) || chunk.count == 0 ||
+        chunk.n_bits > (uint64_t)(end - data) * 8 ||
+        (!chunks.empty() && chunk.first_ts <= chunks.back().last_ts)) {
+      return false;
+    }
+    chunk.data.assign(data, (chunk.n_bits + 7) / 8);
+    data += chunk.data.size();
+    /* every sample is checked here, so that decoding never fails afterwards */
+    ChunkReader reader(chunk);
+    int64_t timestamp, prev = 0;
+    double value;
+    for (uint32_t j = 0; j < chunk.count; ++j) {
+      if (!reader.Next(timestamp, value) || (j == 0 && timestamp != chunk.first_ts) ||
+          (j > 0 && timestamp <= prev)) {
+        return false;
+      }
+      prev = timestamp;
+    }
+    if (!reader.Exhausted() || prev != chunk.last_ts) {
+      return false;
+    }
+    reader.RestoreState(chunk);
+    total += chunk.count;
+    chunks.emplace_back(std::move(chunk));
+  }
+  if (data != end || total != length) {
+    return false;
+  }
+  retention_ = retention;
+  length_ = length;
+  chunks_.swap(chunks);
+  return true;
+}
+
+size_t TimeSeries::Serialize(std::vector<char> &buf) const {
+  std::string data = Dump();
+  unsigned char enc_buf[10] = {0};
+  uint8_t enc_size = EncodeVarUnsignedInt64(data.size(), enc_buf);
+  buf.insert(buf.end(), enc_buf, enc_buf + enc_size);
+  buf.insert(buf.end(), data.begin(), data.end());
+  return buf.size();
+}
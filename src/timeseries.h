@@ -0,0 +1,107 @@
+#ifndef __TIMESERIES_H__
+#define __TIMESERIES_H__
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+#include "serializable.h"
+#include "encoding.h"
+
+/* a chunk stops taking new samples once it reaches this size */
+static constexpr size_t kTSChunkMaxBytes = 4096;
+
+/* aggregation types of range query */
+static constexpr int kTSAggNone = 0;
+static constexpr int kTSAggAvg = 1;
+static constexpr int kTSAggMin = 2;
+static constexpr int kTSAggMax = 3;
+static constexpr int kTSAggSum = 4;
+static constexpr int kTSAggCount = 5;
+
+/* timestamp and value */
+typedef std::pair<int64_t, double> TSSample;
+
+/**
+ * @brief Time series of samples with increasing timestamps. Samples are compressed into chunks
+ * following Gorilla: a timestamp is stored as the delta of its delta to the previous one, which
+ * is mostly a single bit for regular intervals, and a value is stored as the meaningful bits of
+ * its XOR with the previous one. Chunks older than the retention period are dropped.
+ */
+class TimeSeries : public Serializable {
+public:
+  /* retention 0 means samples are kept forever */
+  explicit TimeSeries(uint64_t retention_ms = 0) : retention_(retention_ms) {}
+
+  inline uint64_t Retention() const { return retention_; }
+
+  inline uint64_t Length() const { return length_; }
+
+  inline size_t NumChunks() const { return chunks_.size(); }
+
+  /* false if there is no sample */
+  bool LastSample(TSSample &sample) const;
+
+  /* append a sample, return false if timestamp is not greater than the last one */
+  bool Add(int64_t timestamp, double value);
+
+  /* samples with timestamp in [from, to], count 0 means no limit */
+  std::vector<TSSample> Range(int64_t from, int64_t to, size_t count) const;
+
+  /**
+   * @brief Aggregate samples with timestamp in [from, to] into buckets
+   *
+   * @param aggregation one of kTSAggAvg, kTSAggMin, kTSAggMax, kTSAggSum, kTSAggCount
+   * @param bucket_ms width of bucket, buckets are aligned to multiples of it
+   * @param count at most count buckets, 0 means no limit
+   * @return start of each non-empty bucket and the aggregated value
+   */
+  std::vector<TSSample> Aggregate(int64_t from, int64_t to, int aggregation, uint64_t bucket_ms,
+                                  size_t count) const;
+
+  /* retention and compressed chunks */
+  std::string Dump() const;
+
+  /* restore from the output of Dump, return false if data is malformed */
+  bool Load(const char *data, size_t len);
+
+  size_t Serialize(std::vector<char> &buf) const override;
+
+private:
+  static constexpr uint8_t kTSNoWindow = 0xff;
+
+  struct Chunk {
+    int64_t first_ts = 0;
+    int64_t last_ts = 0;
+    uint32_t count = 0;
+    uint64_t n_bits = 0;
+    std::string data;
+    /* state of the last sample, needed to append the next one */
+    uint64_t last_delta = 0;
+    uint64_t last_value = 0;
+    /* window of meaningful bits of the last xor, leading is kTSNoWindow before the first one */
+    uint8_t leading = kTSNoWindow;
+    uint8_t trailing = 0;
+  };
+
+  class ChunkReader;
+
+  static void WriteBits(Chunk &chunk, uint64_t value, uint32_t n);
+
+  static void Append(Chunk &chunk, int64_t timestamp, double value);
+
+  /* samples older than this are out of retention */
+  int64_t RetentionCutoff() const;
+
+  /* call visit(timestamp, value) for samples in [from, to] in order until it returns false */
+  template <typename Visitor>
+  void ForEach(int64_t from, int64_t to, Visitor visit) const;
+
+private:
+  uint64_t retention_ = 0;
+  uint64_t length_ = 0;
+  std::deque<Chunk> chunks_;
+};
+
+#endif  // __TIMESERIES_H__
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include "topk.h"
+
+static constexpr uint64_t kTopKHashSeed = 0x5bd1e995ULL;
+static constexpr uint64_t kTopKRandSeed = 0x853c49e6748fea9bULL;
+static constexpr size_t kTopKDecayTableSize = 256;
+/* buckets with smaller decay probability are taken as never decayed */
+static constexpr double kTopKMinDecay = 1e-12;
+/* k, width, depth, decay and generator state */
+static constexpr size_t kTopKHeaderBytes = 4 + 4 + 4 + 8 + 8;
+
+TopK::TopK(uint32_t k, uint32_t width, uint32_t depth, double decay)
+    : k_(k),
+      width_(width),
+      depth_(depth),
+      decay_(decay),
+      rand_state_(kTopKRandSeed),
+      buckets_((size_t)width * depth, Bucket{0, 0}) {
+  heap_.reserve(k);
+  BuildDecayTable();
+}
+
+void TopK::BuildDecayTable() {
+  decay_table_.resize(kTopKDecayTableSize);
+  decay_table_[0] = 1.0;
+  for (size_t i = 1; i < kTopKDecayTableSize; ++i) {
+    decay_table_[i] = decay_table_[i - 1] * decay_;
+  }
+}
+
+double TopK::DecayProbability(uint32_t count) const {
+  if (count < kTopKDecayTableSize) {
+    return decay_table_[count];
+  }
+  return std::pow(decay_, count);
+}
+
+double TopK::NextRandom() {
+  /* xorshift64* */
+  rand_state_ ^= rand_state_ >> 12;
+  rand_state_ ^= rand_state_ << 25;
+  rand_state_ ^= rand_state_ >> 27;
+  return ((rand_state_ * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / (1ULL << 53));
+}
+
+long TopK::FindInHeap(const std::string &item, uint32_t fingerprint) const {
+  for (size_t i = 0; i < heap_.size(); ++i) {
+    if (heap_[i].fingerprint == fingerprint && heap_[i].item == item) {
+      return (long)i;
+    }
+  }
+  return -1;
+}
+
+void TopK::SiftUp(size_t idx) {
+  while (idx > 0) {
+    size_t parent = (idx - 1) / 2;
+    if (heap_[parent].count <= heap_[idx].count) {
+      break;
+    }
+    std::swap(heap_[parent], heap_[idx]);
+    idx = parent;
+  }
+}
+
+void TopK::SiftDown(size_t idx) {
+  size_t n = heap_.size();
+  while (true) {
+    size_t smallest = idx, left = idx * 2 + 1, right = idx * 2 + 2;
+    if (left < n && heap_[left].count < heap_[smallest].count) {
+      smallest = left;
+    }
+    if (right < n && heap_[right].count < heap_[smallest].count) {
+      smallest = right;
+    }
+    if (smallest == idx) {
+      break;
+    }
+    std::swap(heap_[smallest], heap_[idx]);
+    idx = smallest;
+  }
+}
+
+bool TopK::Add(const std::string &item, uint32_t increment, std::string &expelled) {
+  if (increment == 0) {
+    return false;
+  }
+  uint64_t hash = MurmurHash64A(item.data(), item.size(), kTopKHashSeed);
+  uint32_t fingerprint = (uint32_t)hash;
+  uint64_t base = hash >> 32, step = fingerprint | 1;
+  uint32_t max_count = 0;
+  for (uint32_t row = 0; row < depth_; ++row) {
+    Bucket &bucket = buckets_[(size_t)row * width_ + (base + row * step) % width_];
+    if (bucket.count == 0) {
+      bucket.fingerprint = fingerprint;
+      bucket.count = increment;
+    } else if (bucket.fingerprint == fingerprint) {
+      bucket.count = (uint32_t)std::min<uint64_t>((uint64_t)bucket.count + increment, UINT32_MAX);
+    } else {
+      /* every unit of increment decays the bucket once, the item takes over an emptied bucket */
+      for (uint32_t left = increment; left > 0; --left) {
+        double probability = DecayProbability(bucket.count);
+        if (probability < kTopKMinDecay) {
+          break;
+        }
+        if (NextRandom() < probability && --bucket.count == 0) {
+          bucket.fingerprint = fingerprint;
+          bucket.count = left;
+          break;
+        }
+      }
+      if (bucket.fingerprint != fingerprint) {
+        continue;
+      }
+    }
+    max_count = std::max(max_count, bucket.count);
+  }
+  if (max_count == 0) {
+    return false;
+  }
+  long pos = FindInHeap(item, fingerprint);
+  if (pos >= 0) {
+    if (max_count > heap_[pos].count) {
+      heap_[pos].count = max_count;
+      SiftDown(pos);
+    }
+    return false;
+  }
+  if (heap_.size() < k_) {
+    heap_.push_back(HeapEntry{item, max_count, fingerprint});
+    SiftUp(heap_.size() - 1);
+    return false;
+  }
+  if (k_ == 0 || max_count <= heap_[0].count) {
+    return false;
+  }
+  expelled.swap(heap_[0].item);
+  heap_[0] = HeapEntry{item, max_count, fingerprint};
+  SiftDown(0);
+  return true;
+}
+
+bool TopK::Query(const std::string &item) const {
+  uint32_t fingerprint = (uint32_t)MurmurHash64A(item.data(), item.size(), kTopKHashSeed);
+  return FindInHeap(item, fingerprint) >= 0;
+}
+
+std::vector<TopKItem> TopK::List() const {
+  std::vector<TopKItem> items;
+  items.reserve(heap_.size());
+  for (const auto &entry : heap_) {
+    items.emplace_back(entry.item, entry.count);
+  }
+  std::stable_sort(items.begin(), items.end(),
+                   [](const TopKItem &a, const TopKItem &b) { return a.second > b.second; });
+  return items;
+}
+
+static void AppendFixed32(std::string &data, uint32_t value) {
+  data.append((const char *)&value, sizeof(value));
+}
+
+static void AppendFixed64(std::string &data, uint64_t value) {
+  data.append((const char *)&value, sizeof(value));
+}
+
+std::string TopK::Dump() const {
+  std::string data;
+  data.reserve(kTopKHeaderBytes + buckets_.size() * sizeof(Bucket) + 4 + heap_.size() * 32);
+  AppendFixed32(data, k_);
+  AppendFixed32(data, width_);
+  AppendFixed32(data, depth_);
+  data.append((const char *)&decay_, sizeof(decay_));
+  AppendFixed64(data, rand_state_);
+  for (const auto &bucket : buckets_) {
+    AppendFixed32(data, bucket.fingerprint);
+    AppendFixed32(data, bucket.count);
+  }
+  AppendFixed32(data, heap_.size());
+  for (const auto &entry : heap_) {
+    AppendFixed64(data, entry.count);
+    AppendFixed32(data, entry.item.size());
+    data.append(entry.item);
+  }
+  return data;
+}
+
+bool TopK::Load(const char *data, size_t len) {
+  const char *end = data + len;
+  auto read = [&data, end](void *out, size_t n) {
+    if ((size_t)(end - data) < n) {
+      return false;
+    }
+    memcpy(out, data, n);
+    data += n;
+    return true;
+  };
+  uint32_t k, width, depth, heap_size;
+  double decay;
+  uint64_t rand_state;
+  if (!read(&k, 4) || !read(&width, 4) || !read(&depth, 4) || !read(&decay, 8) ||
+      !read(&rand_state, 8)) {
+    return false;
+  }
+  uint64_t n = (uint64_t)width * depth;
+  if (k == 0 || k > kTopKMaxK || width == 0 || depth == 0 || n > kTopKMaxBuckets ||
+      !(decay > 0 && decay < 1) || rand_state == 0 || (uint64_t)(end - data) < n * 8) {
+    return false;
+  }
+  std::vector<Bucket> buckets(n);
+  for (auto &bucket : buckets) {
+    read(&bucket.fingerprint, 4);
+    read(&bucket.count, 4);
+  }
+  if (!read(&heap_size, 4) || heap_size > k) {
+    return false;
+  }
+  std::vector<HeapEntry> heap(heap_size);
+  for (auto &entry : heap) {
+    uint32_t item_len;
+    if (!read(&entry.count, 8) || !read(&item_len, 4) || (size_t)(end - data) < item_len) {
+      return false;
+    }
+    entry.item.assign(data, item_len);
+    entry.fingerprint = (uint32_t)MurmurHash64A(data, item_len, kTopKHashSeed);
+    data += item_len;
+  }
+  if (data != end) {
+    return false;
+  }
+  k_ = k;
+  width_ = width;
+  depth_ = depth;
+  decay_ = decay;
+  rand_state_ = rand_state;
+  buckets_.swap(buckets);
+  heap_.swap(heap);
+  /* the heap order is not trusted */
+  for (size_t i = heap_.size() / 2; i > 0; --i) {
+    SiftDown(i - 1);
+  }
+  BuildDecayTable();
+  return true;
+}
+
+size_t TopK::Serialize(std::vector<char> &buf) const {
+  std::string data = Dump();
+  unsigned char enc_buf[10] = {0};
+  uint8_t enc_size = EncodeVarUnsignedInt64(data.size(), enc_buf);
+  buf.insert(buf.end(), enc_buf, enc_buf + enc_size);
+  buf.insert(buf.end(), data.begin(), data.end());
+  return buf.size();
+}
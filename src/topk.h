@@ -0,0 +1,101 @@
+#ifndef __TOPK_H__
+#define __TOPK_H__
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "serializable.h"
+#include "encoding.h"
+
+/* upper limit of k and of width * depth */
+static constexpr uint64_t kTopKMaxK = 100000;
+static constexpr uint64_t kTopKMaxBuckets = 1ULL << 24;
+
+static constexpr uint32_t kTopKDefaultWidth = 8;
+static constexpr uint32_t kTopKDefaultDepth = 7;
+static constexpr double kTopKDefaultDecay = 0.9;
+
+typedef std::pair<std::string, uint64_t> TopKItem;
+
+/**
+ * @brief Top-K heavy hitters based on HeavyKeeper. Every item is hashed into one bucket of
+ * each row, a bucket holds the fingerprint of its owner and a count which other items decay
+ * with probability decay^count. The k largest items are kept in a min heap.
+ *
+ * Decays are drawn from a seeded generator whose state is persisted,
+ * so replaying the same additions always gives the same result.
+ */
+class TopK : public Serializable {
+public:
+  TopK() = default;
+
+  TopK(uint32_t k, uint32_t width, uint32_t depth, double decay);
+
+  inline uint32_t K() const { return k_; }
+
+  /**
+   * @brief Add item with increment
+   *
+   * @param expelled the item kicked out of top k if any
+   * @return true if an item is expelled
+   */
+  bool Add(const std::string &item, uint32_t increment, std::string &expelled);
+
+  /* whether item is in top k now */
+  bool Query(const std::string &item) const;
+
+  /* top k items sorted by count from high to low */
+  std::vector<TopKItem> List() const;
+
+  /* parameters, generator state, buckets and heap */
+  std::string Dump() const;
+
+  /* restore from the output of Dump, return false if data is malformed */
+  bool Load(const char *data, size_t len);
+
+  size_t Serialize(std::vector<char> &buf) const override;
+
+private:
+  struct Bucket {
+    uint32_t fingerprint;
+    uint32_t count;
+  };
+
+  struct HeapEntry {
+    std::string item;
+    uint64_t count;
+    /* compared before item to avoid most string comparisons */
+    uint32_t fingerprint;
+  };
+
+  /* probability that a bucket with count is decayed */
+  double DecayProbability(uint32_t count) const;
+
+  /* uniformly distributed in [0, 1) */
+  double NextRandom();
+
+  /* index of item in heap, -1 if not found */
+  long FindInHeap(const std::string &item, uint32_t fingerprint) const;
+
+  void SiftUp(size_t idx);
+
+  void SiftDown(size_t idx);
+
+  void BuildDecayTable();
+
+private:
+  uint32_t k_ = 0;
+  uint32_t width_ = 0;
+  uint32_t depth_ = 0;
+  double decay_ = kTopKDefaultDecay;
+  uint64_t rand_state_ = 0;
+  /* depth_ * width_ buckets */
+  std::vector<Bucket> buckets_;
+  /* min heap of count with at most k_ entries */
+  std::vector<HeapEntry> heap_;
+  /* decay^count for small counts */
+  std::vector<double> decay_table_;
+};
+
+#endif  // __TOPK_H__
@@ -16,6 +16,22 @@ size_t ValueObject::Serialize(std::vector<char> &buf) {
       reinterpret_cast<HashDict *>(ptr)->Serialize(buf);
     } else if (type == OBJECT_SET) {
       reinterpret_cast<HashSet *>(ptr)->Serialize(buf);
+    } else if (type == OBJECT_ZSET) {
+      reinterpret_cast<ZSet *>(ptr)->Serialize(buf);
+    } else if (type == OBJECT_HLL) {
+      reinterpret_cast<HyperLogLog *>(ptr)->Serialize(buf);
+    } else if (type == OBJECT_CMS) {
+      reinterpret_cast<CountMinSketch *>(ptr)->Serialize(buf);
+    } else if (type == OBJECT_TOPK) {
+      reinterpret_cast<TopK *>(ptr)->Serialize(buf);
+    } else if (type == OBJECT_BLOOM) {
+      reinterpret_cast<BloomFilter *>(ptr)->Serialize(buf);
+    } else if (type == OBJECT_STREAM) {
+      reinterpret_cast<Stream *>(ptr)->Serialize(buf);
+    } else if (type == OBJECT_TS) {
+      reinterpret_cast<TimeSeries *>(ptr)->Serialize(buf);
+    } else if (type == OBJECT_VSET) {
+      reinterpret_cast<VectorSet *>(ptr)->Serialize(buf);
     } else {
       Serializable *parent = reinterpret_cast<Serializable *>(ptr);
       parent->Serialize(buf);
@@ -57,9 +73,9 @@ ValueObject *ConstructStrObj(const std::string &strval) {
   return obj;
 }
 
-ValueObjectPtr ConstructStrObjPtr(const std::string &strval) {
+ValueObjectPtr ConstructStrObjPtr(const StringView &strval) {
   try {
-    DynamicString *ds_ptr = new DynamicString(strval);
+    DynamicString *ds_ptr = new DynamicString(strval.data(), strval.size());
     return std::make_shared<ValueObject>(OBJECT_STRING, (void *)ds_ptr);
   } catch (const std::bad_alloc &ex) {
     return ValueObjectPtr();
@@ -131,4 +147,53 @@ ValueObjectPtr ConstructSetObjPtr() {
   } catch (const std::bad_alloc &ex) {
     return ValueObjectPtr();
   }
-}
\ No newline at end of file
+}
+
+ValueObject *ConstructZSetObj() {
+  ValueObject *obj = new (std::nothrow) ValueObject;
+  if (obj == nullptr) {
+    return nullptr;
+  }
+  obj->type = OBJECT_ZSET;
+  obj->lv_time = GetCurrentMs();
+  ZSet *p_zset = new (std::nothrow) ZSet;
+  if (p_zset == nullptr) return nullptr;
+  obj->ptr = p_zset;
+  return obj;
+}
+
+ValueObjectPtr ConstructZSetObjPtr() {
+  try {
+    ZSet *zset_ptr = new ZSet;
+    return std::make_shared<ValueObject>(OBJECT_ZSET, (void *)zset_ptr);
+  } catch (const std::bad_alloc &ex) {
+    return ValueObjectPtr();
+  }
+}
+
+ValueObject *ConstructHLLObj() {
+  ValueObject *obj = new (std::nothrow) ValueObject;
+  if (obj == nullptr) {
+    return nullptr;
+  }
+  obj->type = OBJECT_HLL;
+  obj->lv_time = GetCurrentMs();
+  HyperLogLog *p_hll = new (std::nothrow) HyperLogLog;
+  if (p_hll == nullptr) return nullptr;
+  obj->ptr = p_hll;
+  return obj;
+}
+
+ValueObjectPtr ConstructHLLObjPtr() {
+  try {
+    HyperLogLog *hll_ptr = new HyperLogLog;
+    return std::make_shared<ValueObject>(OBJECT_HLL, (void *)hll_ptr);
+  } catch (const std::bad_alloc &ex) {
+    return ValueObjectPtr();
+  }
+}
+
+std::shared_ptr<const void> PinStrObj(const ValueObjectPtr &value) {
+  ++value->pins;
+  return std::shared_ptr<const void>(value->ptr, [value](const void *) { --value->pins; });
+}
@@ -8,6 +8,14 @@
 #include "dlist.h"
 #include "hashdict.h"
 #include "hashset.h"
+#include "zset.h"
+#include "hyperloglog.h"
+#include "cms.h"
+#include "topk.h"
+#include "bloom.h"
+#include "stream.h"
+#include "timeseries.h"
+#include "vectorset.h"
 #include "net/time_event.h"
 #include "str.h"
 
@@ -22,6 +30,14 @@ typedef std::shared_ptr<ValueObject> ValueObjectPtr;
 #define OBJECT_LIST LKVBD_TYPE_LIST     /* list object */
 #define OBJECT_HASH LKVBD_TYPE_HASH     /* hash object */
 #define OBJECT_SET LKVBD_TYPE_SET       /* set object */
+#define OBJECT_ZSET LKVBD_TYPE_ZSET     /* sorted set object */
+#define OBJECT_HLL LKVBD_TYPE_HLL       /* hyperloglog object */
+#define OBJECT_CMS LKVBD_TYPE_CMS       /* count-min sketch object */
+#define OBJECT_TOPK LKVBD_TYPE_TOPK     /* top-k object */
+#define OBJECT_BLOOM LKVBD_TYPE_BLOOM   /* bloom filter object */
+#define OBJECT_STREAM LKVBD_TYPE_STREAM /* stream object */
+#define OBJECT_TS LKVBD_TYPE_TS         /* time series object */
+#define OBJECT_VSET LKVBD_TYPE_VSET     /* vector set object */
 
 /**
  * @brief wrapper for value stored
@@ -37,6 +53,9 @@ struct ValueObject {
   /* pointer to real content */
   void *ptr;
 
+  /* number of replies still sending the string in place, it must not be changed or freed till 0 */
+  uint32_t pins = 0;
+
   ValueObject() = default;
 
   ValueObject(unsigned char type, void *ptr) : type(type), lv_time(GetCurrentMs()), ptr(ptr) {}
@@ -51,6 +70,22 @@ struct ValueObject {
         delete reinterpret_cast<HashDict *>(ptr);
       } else if (type == OBJECT_SET) {
         delete reinterpret_cast<HashSet *>(ptr);
+      } else if (type == OBJECT_ZSET) {
+        delete reinterpret_cast<ZSet *>(ptr);
+      } else if (type == OBJECT_HLL) {
+        delete reinterpret_cast<HyperLogLog *>(ptr);
+      } else if (type == OBJECT_CMS) {
+        delete reinterpret_cast<CountMinSketch *>(ptr);
+      } else if (type == OBJECT_TOPK) {
+        delete reinterpret_cast<TopK *>(ptr);
+      } else if (type == OBJECT_BLOOM) {
+        delete reinterpret_cast<BloomFilter *>(ptr);
+      } else if (type == OBJECT_STREAM) {
+        delete reinterpret_cast<Stream *>(ptr);
+      } else if (type == OBJECT_TS) {
+        delete reinterpret_cast<TimeSeries *>(ptr);
+      } else if (type == OBJECT_VSET) {
+        delete reinterpret_cast<VectorSet *>(ptr);
       }
       ptr = nullptr;
     }
@@ -90,7 +125,7 @@ ValueObjectPtr ConstructIntObjPtr(int64_t intval);
 
 ValueObject *ConstructStrObj(const std::string &strval);
 
-ValueObjectPtr ConstructStrObjPtr(const std::string &strval);
+ValueObjectPtr ConstructStrObjPtr(const StringView &strval);
 
 ValueObject *ConstructDListObj();
 
@@ -104,4 +139,18 @@ ValueObject *ConstructSetObj();
 
 ValueObjectPtr ConstructSetObjPtr();
 
+ValueObject *ConstructZSetObj();
+
+ValueObjectPtr ConstructZSetObjPtr();
+
+ValueObject *ConstructHLLObj();
+
+ValueObjectPtr ConstructHLLObjPtr();
+
+/**
+ * Pin the string of value for a reply which sends it in place. The value is kept alive and counted
+ * in pins until the returned pointer and all its copies are released.
+ */
+std::shared_ptr<const void> PinStrObj(const ValueObjectPtr &value);
+
 #endif  // __VALUE_OBJECT_H__
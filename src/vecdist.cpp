@@ -0,0 +1,241 @@
+#include <cstring>
+#include "vecdist.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VECDIST_X86
+#endif
+
+struct Kernels {
+  const char *name;
+  float (*dot)(const float *, const float *, size_t);
+  float (*l2sq)(const float *, const float *, size_t);
+  float (*dot_i8)(const float *, const int8_t *, size_t);
+  float (*l2sq_i8)(const float *, const int8_t *, float, size_t);
+};
+
+static float DotScalar(const float *a, const float *b, size_t n) {
+  float sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+static float L2SqScalar(const float *a, const float *b, size_t n) {
+  float sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    float diff = a[i] - b[i];
+    sum += diff * diff;
+  }
+  return sum;
+}
+
+static float DotI8Scalar(const float *a, const int8_t *b, size_t n) {
+  float sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+static float L2SqI8Scalar(const float *a, const int8_t *b, float scale, size_t n) {
+  float sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    float diff = a[i] - b[i] * scale;
+    sum += diff * diff;
+  }
+  return sum;
+}
+
+static const Kernels kScalarKernels = {"scalar", DotScalar, L2SqScalar, DotI8Scalar,
+                                      L2SqI8Scalar};
+
+#if defined(VECDIST_X86) && defined(__SSE2__)
+
+static inline float HorizontalSum128(__m128 v) {
+  __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+  __m128 sums = _mm_add_ps(v, shuf);
+  shuf = _mm_movehl_ps(shuf, sums);
+  return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+/* sign extend the 4 int8 at p to floats */
+static inline __m128 LoadI8x4(const int8_t *p) {
+  int32_t packed;
+  memcpy(&packed, p, 4);
+  __m128i v = _mm_cvtsi32_si128(packed);
+  v = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+  v = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+  return _mm_cvtepi32_ps(v);
+}
+
+static float DotSSE(const float *a, const float *b, size_t n) {
+  __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  float sum = HorizontalSum128(_mm_add_ps(acc0, acc1));
+  return sum + DotScalar(a + i, b + i, n - i);
+}
+
+static float L2SqSSE(const float *a, const float *b, size_t n) {
+  __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+    __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+  }
+  float sum = HorizontalSum128(_mm_add_ps(acc0, acc1));
+  return sum + L2SqScalar(a + i, b + i, n - i);
+}
+
+static float DotI8SSE(const float *a, const int8_t *b, size_t n) {
+  __m128 acc = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), LoadI8x4(b + i)));
+  }
+  return HorizontalSum128(acc) + DotI8Scalar(a + i, b + i, n - i);
+}
+
+static float L2SqI8SSE(const float *a, const int8_t *b, float scale, size_t n) {
+  __m128 acc = _mm_setzero_ps(), vscale = _mm_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 d = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_mul_ps(LoadI8x4(b + i), vscale));
+    acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+  }
+  return HorizontalSum128(acc) + L2SqI8Scalar(a + i, b + i, scale, n - i);
+}
+
+static const Kernels kSSEKernels = {"sse", DotSSE, L2SqSSE, DotI8SSE, L2SqI8SSE};
+
+#define VECDIST_AVX2 __attribute__((target("avx2,fma")))
+
+static VECDIST_AVX2 inline float HorizontalSum256(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  __m128 shuf = _mm_movehdup_ps(sum);
+  sum = _mm_add_ps(sum, shuf);
+  return _mm_cvtss_f32(_mm_add_ss(sum, _mm_movehl_ps(shuf, sum)));
+}
+
+static VECDIST_AVX2 inline __m256 LoadI8x8(const int8_t *p) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)p)));
+}
+
+/* two accumulators hide the latency of fma */
+static VECDIST_AVX2 float DotAVX2(const float *a, const float *b, size_t n) {
+  __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+  }
+  if (i + 8 <= n) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    i += 8;
+  }
+  float sum = HorizontalSum256(_mm256_add_ps(acc0, acc1));
+  return sum + DotScalar(a + i, b + i, n - i);
+}
+
+static VECDIST_AVX2 float L2SqAVX2(const float *a, const float *b, size_t n) {
+  __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+    __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+    acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+    acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+  }
+  if (i + 8 <= n) {
+    __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+    acc0 = _mm256_fmadd_ps(d, d, acc0);
+    i += 8;
+  }
+  float sum = HorizontalSum256(_mm256_add_ps(acc0, acc1));
+  return sum + L2SqScalar(a + i, b + i, n - i);
+}
+
+static VECDIST_AVX2 float DotI8AVX2(const float *a, const int8_t *b, size_t n) {
+  __m256 acc = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), LoadI8x8(b + i), acc);
+  }
+  return HorizontalSum256(acc) + DotI8Scalar(a + i, b + i, n - i);
+}
+
+static VECDIST_AVX2 float L2SqI8AVX2(const float *a, const int8_t *b, float scale, size_t n) {
+  __m256 acc = _mm256_setzero_ps(), vscale = _mm256_set1_ps(scale);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 d = _mm256_fnmadd_ps(LoadI8x8(b + i), vscale, _mm256_loadu_ps(a + i));
+    acc = _mm256_fmadd_ps(d, d, acc);
+  }
+  return HorizontalSum256(acc) + L2SqI8Scalar(a + i, b + i, scale, n - i);
+}
+
+static const Kernels kAVX2Kernels = {"avx2", DotAVX2, L2SqAVX2, DotI8AVX2, L2SqI8AVX2};
+
+static bool SupportsAVX2() {
+  /* it may run before the constructors which set up cpu features */
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+#endif
+
+static const Kernels *Detect() {
+#if defined(VECDIST_X86) && defined(__SSE2__)
+  return SupportsAVX2() ? &kAVX2Kernels : &kSSEKernels;
+#else
+  return &kScalarKernels;
+#endif
+}
+
+/* picked once, before any vector command can run */
+static const Kernels *sKernels = Detect();
+
+float VecDot(const float *a, const float *b, size_t n) {
+  return sKernels->dot(a, b, n);
+}
+
+float VecL2Sq(const float *a, const float *b, size_t n) {
+  return sKernels->l2sq(a, b, n);
+}
+
+float VecDotI8(const float *a, const int8_t *b, size_t n) {
+  return sKernels->dot_i8(a, b, n);
+}
+
+float VecL2SqI8(const float *a, const int8_t *b, float scale, size_t n) {
+  return sKernels->l2sq_i8(a, b, scale, n);
+}
+
+const char *VecKernelName() {
+  return sKernels->name;
+}
+
+bool VecUseKernel(const std::string &name) {
+  if (name == "scalar") {
+    sKernels = &kScalarKernels;
+    return true;
+  }
+#if defined(VECDIST_X86) && defined(__SSE2__)
+  if (name == "sse") {
+    sKernels = &kSSEKernels;
+    return true;
+  }
+  if (name == "avx2" && SupportsAVX2()) {
+    sKernels = &kAVX2Kernels;
+    return true;
+  }
+#endif
+  return false;
+}
@@ -0,0 +1,30 @@
+#ifndef __VECDIST_H__
+#define __VECDIST_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Distance kernels of float32 vectors, and of float32 against int8 quantized vectors.
+ * The widest kernels the cpu supports are picked at startup: avx2 with fma, sse, or scalar.
+ */
+
+float VecDot(const float *a, const float *b, size_t n);
+
+/* squared euclidean distance */
+float VecL2Sq(const float *a, const float *b, size_t n);
+
+/* dot product of a and b without the scale of b */
+float VecDotI8(const float *a, const int8_t *b, size_t n);
+
+/* squared euclidean distance between a and b * scale */
+float VecL2SqI8(const float *a, const int8_t *b, float scale, size_t n);
+
+/* kernels in use: "avx2", "sse" or "scalar" */
+const char *VecKernelName();
+
+/* switch to kernels by name, return false if the cpu does not support them */
+bool VecUseKernel(const std::string &name);
+
+#endif  // __VECDIST_H__
@@ -0,0 +1,564 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <strings.h>
+#include "vectorset.h"
+#include "vecdist.h"
+
+/* dim, metric, quantized, indexed, max level, number of slots, entry and random state */
+static constexpr size_t kVecHeaderBytes = 4 + 1 + 1 + 1 + 1 + 4 + 4 + 8;
+
+int VecMetricFromName(const std::string &name) {
+  if (strcasecmp(name.c_str(), "L2") == 0) {
+    return kVecMetricL2;
+  } else if (strcasecmp(name.c_str(), "IP") == 0) {
+    return kVecMetricIP;
+  } else if (strcasecmp(name.c_str(), "COSINE") == 0) {
+    return kVecMetricCosine;
+  }
+  return -1;
+}
+
+const char *VecMetricName(int metric) {
+  if (metric == kVecMetricIP) {
+    return "IP";
+  }
+  return metric == kVecMetricCosine ? "COSINE" : "L2";
+}
+
+VectorSet::VectorSet(uint32_t dim, int metric, bool quantized)
+    : dim_(dim), metric_(metric), quantized_(quantized) {}
+
+uint32_t VectorSet::AppendSlot(const std::string &element, const float *vec) {
+  uint32_t slot = names_.size();
+  std::vector<float> normalized;
+  if (metric_ == kVecMetricCosine) {
+    float norm = std::sqrt(VecDot(vec, vec, dim_));
+    normalized.assign(vec, vec + dim_);
+    if (norm > 0) {
+      for (float &v : normalized) {
+        v /= norm;
+      }
+    }
+    vec = normalized.data();
+  }
+  if (quantized_) {
+    /* symmetric quantization, the largest magnitude maps to 127 */
+    float max_abs = 0;
+    for (uint32_t i = 0; i < dim_; ++i) {
+      max_abs = std::max(max_abs, std::fabs(vec[i]));
+    }
+    float scale = max_abs / 127;
+    for (uint32_t i = 0; i < dim_; ++i) {
+      qdata_.push_back(scale > 0 ? (int8_t)std::lround(vec[i] / scale) : 0);
+    }
+    scales_.push_back(scale);
+  } else {
+    data_.insert(data_.end(), vec, vec + dim_);
+  }
+  names_.emplace_back(element);
+  deleted_.push_back(0);
+  return slot;
+}
+
+const float *VectorSet::VectorOf(uint32_t node, std::vector<float> &buf) const {
+  if (!quantized_) {
+    return &data_[(size_t)node * dim_];
+  }
+  buf.resize(dim_);
+  const int8_t *q = &qdata_[(size_t)node * dim_];
+  for (uint32_t i = 0; i < dim_; ++i) {
+    buf[i] = q[i] * scales_[node];
+  }
+  return buf.data();
+}
+
+float VectorSet::Distance(const float *query, uint32_t node) const {
+  size_t offset = (size_t)node * dim_;
+  if (metric_ == kVecMetricL2) {
+    return quantized_ ? VecL2SqI8(query, &qdata_[offset], scales_[node], dim_)
+                      : VecL2Sq(query, &data_[offset], dim_);
+  }
+  float dot = quantized_ ? VecDotI8(query, &qdata_[offset], dim_) * scales_[node]
+                         : VecDot(query, &data_[offset], dim_);
+  return metric_ == kVecMetricIP ? -dot : 1 - dot;
+}
+
+float VectorSet::Score(float distance) const {
+  if (metric_ == kVecMetricL2) {
+    return std::sqrt(std::max(distance, 0.0f));
+  }
+  return metric_ == kVecMetricIP ? -distance : 1 - distance;
+}
+
+const float *VectorSet::PrepareQuery(const float *query, std::vector<float> &buf) const {
+  if (metric_ != kVecMetricCosine) {
+    return query;
+  }
+  float norm = std::sqrt(VecDot(query, query, dim_));
+  buf.assign(query, query + dim_);
+  if (norm > 0) {
+    for (float &v : buf) {
+      v /= norm;
+    }
+  }
+  return buf.data();
+}
+
+uint8_t VectorSet::RandomLevel() {
+  /* xorshift64*, the state is persisted so that replaying builds the same graph */
+  rng_ ^= rng_ >> 12;
+  rng_ ^= rng_ << 25;
+  rng_ ^= rng_ >> 27;
+  double uniform = (double)(((rng_ * 0x2545f4914f6cdd1dULL) >> 11) + 1) / (double)(1ULL << 53);
+  double level = -std::log(uniform) / std::log((double)kVecLinks);
+  return (uint8_t)std::min<double>(level, kVecMaxLevel);
+}
+
+void VectorSet::Greedy(const float *query, uint8_t top, uint8_t bottom, uint32_t &entry,
+                       float &entry_dist) const {
+  for (int level = top; level > bottom; --level) {
+    bool moved = true;
+    while (moved) {
+      moved = false;
+      const uint32_t *links = Links(entry, level);
+      for (uint32_t i = 1; i <= links[0]; ++i) {
+        float dist = Distance(query, links[i]);
+        if (dist < entry_dist) {
+          entry = links[i];
+          entry_dist = dist;
+          moved = true;
+        }
+      }
+    }
+  }
+}
+
+void VectorSet::SearchLevel(const float *query, uint32_t entry, float entry_dist, uint8_t level,
+                            size_t ef, std::vector<Candidate> &found) const {
+  visited_.resize(names_.size(), 0);
+  if (++visit_stamp_ == 0) {
+    std::fill(visited_.begin(), visited_.end(), 0);
+    visit_stamp_ = 1;
+  }
+  /* candidates to expand from the nearest, and the ef nearest found so far */
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+  std::priority_queue<Candidate> nearest;
+  candidates.emplace(entry_dist, entry);
+  nearest.emplace(entry_dist, entry);
+  visited_[entry] = visit_stamp_;
+  while (!candidates.empty()) {
+    Candidate current = candidates.top();
+    if (current.first > nearest.top().first && nearest.size() >= ef) {
+      break;
+    }
+    candidates.pop();
+    const uint32_t *links = Links(current.second, level);
+    for (uint32_t i = 1; i <= links[0]; ++i) {
+      uint32_t neighbor = links[i];
+      if (visited_[neighbor] == visit_stamp_) {
+        continue;
+      }
+      visited_[neighbor] = visit_stamp_;
+      float dist = Distance(query, neighbor);
+      if (nearest.size() < ef || dist < nearest.top().first) {
+        candidates.emplace(dist, neighbor);
+        nearest.emplace(dist, neighbor);
+        if (nearest.size() > ef) {
+          nearest.pop();
+        }
+      }
+    }
+  }
+  found.clear();
+  while (!nearest.empty()) {
+    found.emplace_back(nearest.top());
+    nearest.pop();
+  }
+}
+
+void VectorSet::SelectNeighbors(std::vector<Candidate> &candidates, uint32_t max_links) const {
+  /* a candidate is skipped if it is nearer to a selected neighbor than to the base node,
+   * which keeps links spread in different directions */
+  std::sort(candidates.begin(), candidates.end());
+  std::vector<Candidate> selected;
+  for (const auto &candidate : candidates) {
+    if (selected.size() >= max_links) {
+      break;
+    }
+    const float *vec = VectorOf(candidate.second, buf_);
+    bool diverse = true;
+    for (const auto &other : selected) {
+      if (Distance(vec, other.second) < candidate.first) {
+        diverse = false;
+        break;
+      }
+    }
+    if (diverse) {
+      selected.emplace_back(candidate);
+    }
+  }
+  candidates.swap(selected);
+}
+
+void VectorSet::AddLink(uint32_t neighbor, uint32_t node, uint8_t level) {
+  uint32_t *links = Links(neighbor, level);
+  uint32_t max_links = MaxLinks(level);
+  if (links[0] < max_links) {
+    links[++links[0]] = node;
+    return;
+  }
+  const float *vec = VectorOf(neighbor, link_buf_);
+  std::vector<Candidate> candidates;
+  candidates.reserve(max_links + 1);
+  candidates.emplace_back(Distance(vec, node), node);
+  for (uint32_t i = 1; i <= links[0]; ++i) {
+    candidates.emplace_back(Distance(vec, links[i]), links[i]);
+  }
+  SelectNeighbors(candidates, max_links);
+  links[0] = candidates.size();
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    links[i + 1] = candidates[i].second;
+  }
+}
+
+void VectorSet::Link(uint32_t node) {
+  uint8_t level = RandomLevel();
+  levels_.push_back(level);
+  level0_.resize((size_t)(node + 1) * (kVecLinks * 2 + 1), 0);
+  upper_.emplace_back((size_t)level * (kVecLinks + 1), 0);
+  if (entry_ == kNoNode) {
+    entry_ = node;
+    max_level_ = level;
+    return;
+  }
+  const float *vec = VectorOf(node, node_buf_);
+  uint32_t entry = entry_;
+  float entry_dist = Distance(vec, entry);
+  Greedy(vec, max_level_, level, entry, entry_dist);
+  std::vector<Candidate> found;
+  for (int l = std::min(level, max_level_); l >= 0; --l) {
+    SearchLevel(vec, entry, entry_dist, l, kVecEfConstruction, found);
+    auto nearest = std::min_element(found.begin(), found.end());
+    entry = nearest->second;
+    entry_dist = nearest->first;
+    SelectNeighbors(found, MaxLinks(l));
+    uint32_t *links = Links(node, l);
+    links[0] = found.size();
+    for (size_t i = 0; i < found.size(); ++i) {
+      links[i + 1] = found[i].second;
+    }
+    for (const auto &neighbor : found) {
+      AddLink(neighbor.second, node, l);
+    }
+  }
+  if (level > max_level_) {
+    entry_ = node;
+    max_level_ = level;
+  }
+}
+
+void VectorSet::BuildIndex() {
+  indexed_ = true;
+  levels_.clear();
+  level0_.clear();
+  upper_.clear();
+  entry_ = kNoNode;
+  max_level_ = 0;
+  for (uint32_t node = 0; node < names_.size(); ++node) {
+    Link(node);
+  }
+}
+
+void VectorSet::Compact() {
+  VectorSet compacted(dim_, metric_, quantized_);
+  compacted.rng_ = rng_;
+  std::vector<float> buf;
+  for (uint32_t slot = 0; slot < names_.size(); ++slot) {
+    if (deleted_[slot]) {
+      continue;
+    }
+    /* stored vectors are copied as they are */
+    size_t offset = (size_t)slot * dim_;
+    if (quantized_) {
+      compacted.qdata_.insert(compacted.qdata_.end(), &qdata_[offset], &qdata_[offset] + dim_);
+      compacted.scales_.push_back(scales_[slot]);
+    } else {
+      compacted.data_.insert(compacted.data_.end(), &data_[offset], &data_[offset] + dim_);
+    }
+    compacted.ids_[names_[slot]] = compacted.names_.size();
+    compacted.names_.emplace_back(std::move(names_[slot]));
+    compacted.deleted_.push_back(0);
+  }
+  if (compacted.Count() >= kVecIndexThreshold) {
+    compacted.BuildIndex();
+  }
+  *this = std::move(compacted);
+}
+
+bool VectorSet::Add(const std::string &element, const float *vec) {
+  bool existed = Remove(element);
+  uint32_t slot = AppendSlot(element, vec);
+  ids_[element] = slot;
+  if (indexed_) {
+    Link(slot);
+  } else if (Count() >= kVecIndexThreshold) {
+    BuildIndex();
+  }
+  return !existed;
+}
+
+bool VectorSet::Remove(const std::string &element) {
+  auto it = ids_.find(element);
+  if (it == ids_.end()) {
+    return false;
+  }
+  uint32_t slot = it->second;
+  ids_.erase(it);
+  if (indexed_) {
+    /* the node is still used for routing until the graph is rebuilt */
+    deleted_[slot] = 1;
+    names_[slot].clear();
+    names_[slot].shrink_to_fit();
+    if (++n_deleted_ > Count()) {
+      Compact();
+    }
+    return true;
+  }
+  /* without graph, the last slot is moved into the removed one */
+  uint32_t last = names_.size() - 1;
+  if (slot != last) {
+    names_[slot] = std::move(names_[last]);
+    ids_[names_[slot]] = slot;
+    if (quantized_) {
+      memcpy(&qdata_[(size_t)slot * dim_], &qdata_[(size_t)last * dim_], dim_);
+      scales_[slot] = scales_[last];
+    } else {
+      memcpy(&data_[(size_t)slot * dim_], &data_[(size_t)last * dim_], dim_ * sizeof(float));
+    }
+  }
+  names_.pop_back();
+  deleted_.pop_back();
+  if (quantized_) {
+    qdata_.resize((size_t)last * dim_);
+    scales_.pop_back();
+  } else {
+    data_.resize((size_t)last * dim_);
+  }
+  return true;
+}
+
+bool VectorSet::Get(const std::string &element, std::vector<float> &vec) const {
+  auto it = ids_.find(element);
+  if (it == ids_.end()) {
+    return false;
+  }
+  const float *stored = VectorOf(it->second, vec);
+  vec.assign(stored, stored + dim_);
+  return true;
+}
+
+std::vector<VecMatch> VectorSet::SearchExact(const float *query, size_t k) const {
+  std::vector<float> buf;
+  query = PrepareQuery(query, buf);
+  std::priority_queue<Candidate> nearest;
+  for (uint32_t slot = 0; slot < names_.size() && k > 0; ++slot) {
+    if (deleted_[slot]) {
+      continue;
+    }
+    float dist = Distance(query, slot);
+    if (nearest.size() < k) {
+      nearest.emplace(dist, slot);
+    } else if (dist < nearest.top().first) {
+      nearest.pop();
+      nearest.emplace(dist, slot);
+    }
+  }
+  std::vector<VecMatch> matches(nearest.size());
+  for (size_t i = matches.size(); i > 0; --i) {
+    matches[i - 1] = VecMatch(names_[nearest.top().second], Score(nearest.top().first));
+    nearest.pop();
+  }
+  return matches;
+}
+
+std::vector<VecMatch> VectorSet::Search(const float *query, size_t k, size_t ef) const {
+  if (!indexed_ || k == 0) {
+    return SearchExact(query, k);
+  }
+  std::vector<float> buf;
+  query = PrepareQuery(query, buf);
+  uint32_t entry = entry_;
+  float entry_dist = Distance(query, entry);
+  Greedy(query, max_level_, 0, entry, entry_dist);
+  std::vector<Candidate> found;
+  SearchLevel(query, entry, entry_dist, 0, std::max(ef, k), found);
+  std::sort(found.begin(), found.end());
+  std::vector<VecMatch> matches;
+  for (const auto &candidate : found) {
+    if (matches.size() == k) {
+      break;
+    }
+    if (!deleted_[candidate.second]) {
+      matches.emplace_back(names_[candidate.second], Score(candidate.first));
+    }
+  }
+  return matches;
+}
+
+std::string VectorSet::Dump() const {
+  std::string data;
+  uint32_t n_slots = names_.size();
+  size_t vec_bytes = quantized_ ? dim_ + 4 : (size_t)dim_ * 4;
+  data.reserve(kVecHeaderBytes + n_slots * (vec_bytes + 8) +
+               (indexed_ ? level0_.size() * 4 : 0));
+  data.append((const char *)&dim_, 4);
+  data.push_back((char)metric_);
+  data.push_back(quantized_ ? 1 : 0);
+  data.push_back(indexed_ ? 1 : 0);
+  data.push_back((char)max_level_);
+  data.append((const char *)&n_slots, 4);
+  data.append((const char *)&entry_, 4);
+  data.append((const char *)&rng_, 8);
+  for (uint32_t slot = 0; slot < n_slots; ++slot) {
+    /* tombstones keep their vectors for routing, but not their names */
+    data.push_back((char)deleted_[slot]);
+    if (!deleted_[slot]) {
+      uint32_t name_len = names_[slot].size();
+      data.append((const char *)&name_len, 4);
+      data.append(names_[slot]);
+    }
+    size_t offset = (size_t)slot * dim_;
+    if (quantized_) {
+      data.append((const char *)&scales_[slot], 4);
+      data.append((const char *)&qdata_[offset], dim_);
+    } else {
+      data.append((const char *)&data_[offset], (size_t)dim_ * 4);
+    }
+  }
+  if (indexed_) {
+    for (uint32_t node = 0; node < n_slots; ++node) {
+      data.push_back((char)levels_[node]);
+      for (uint8_t level = 0; level <= levels_[node]; ++level) {
+        const uint32_t *links = Links(node, level);
+        data.append((const char *)links, (links[0] + 1) * 4);
+      }
+    }
+  }
+  return data;
+}
+
+bool VectorSet::Load(const char *data, size_t len) {
+  const char *end = data + len;
+  auto read = [&data, end](void *out, size_t n) {
+    if ((size_t)(end - data) < n) {
+      return false;
+    }
+    memcpy(out, data, n);
+    data += n;
+    return true;
+  };
+  VectorSet loaded;
+  uint8_t metric, quantized, indexed;
+  uint32_t n_slots;
+  if (!read(&loaded.dim_, 4) || !read(&metric, 1) || !read(&quantized, 1) || !read(&indexed, 1) ||
+      !read(&loaded.max_level_, 1) || !read(&n_slots, 4) || !read(&loaded.entry_, 4) ||
+      !read(&loaded.rng_, 8) || loaded.dim_ == 0 || loaded.dim_ > kVecMaxDim ||
+      metric > kVecMetricCosine || loaded.max_level_ > kVecMaxLevel) {
+    return false;
+  }
+  loaded.metric_ = metric;
+  loaded.quantized_ = quantized != 0;
+  loaded.indexed_ = indexed != 0;
+  size_t vec_bytes = loaded.quantized_ ? loaded.dim_ + 4 : (size_t)loaded.dim_ * 4;
+  /* each slot takes at least a flag and a vector */
+  if ((size_t)(end - data) / (vec_bytes + 1) < n_slots) {
+    return false;
+  }
+  for (uint32_t slot = 0; slot < n_slots; ++slot) {
+    uint8_t deleted;
+    uint32_t name_len = 0;
+    if (!read(&deleted, 1) || (deleted && !loaded.indexed_)) {
+      return false;
+    }
+    std::string name;
+    if (!deleted) {
+      if (!read(&name_len, 4) || (size_t)(end - data) < name_len) {
+        return false;
+      }
+      name.assign(data, name_len);
+      data += name_len;
+      if (!loaded.ids_.emplace(name, slot).second) {
+        return false;
+      }
+    }
+    if ((size_t)(end - data) < vec_bytes) {
+      return false;
+    }
+    if (loaded.quantized_) {
+      float scale;
+      read(&scale, 4);
+      loaded.scales_.push_back(scale);
+      loaded.qdata_.insert(loaded.qdata_.end(), data, data + loaded.dim_);
+      data += loaded.dim_;
+    } else {
+      size_t offset = loaded.data_.size();
+      loaded.data_.resize(offset + loaded.dim_);
+      read(&loaded.data_[offset], vec_bytes);
+    }
+    loaded.names_.emplace_back(std::move(name));
+    loaded.deleted_.push_back(deleted);
+    loaded.n_deleted_ += deleted;
+  }
+  if (loaded.indexed_) {
+    if (loaded.entry_ >= n_slots) {
+      return false;
+    }
+    loaded.level0_.resize((size_t)n_slots * (kVecLinks * 2 + 1));
+    for (uint32_t node = 0; node < n_slots; ++node) {
+      uint8_t level;
+      if (!read(&level, 1) || level > loaded.max_level_) {
+        return false;
+      }
+      loaded.levels_.push_back(level);
+      loaded.upper_.emplace_back((size_t)level * (kVecLinks + 1), 0);
+      for (uint8_t l = 0; l <= level; ++l) {
+        uint32_t *links = loaded.Links(node, l);
+        if (!read(links, 4) || links[0] > loaded.MaxLinks(l) || !read(links + 1, links[0] * 4)) {
+          return false;
+        }
+      }
+    }
+    if (loaded.levels_[loaded.entry_] != loaded.max_level_) {
+      return false;
+    }
+    /* every link must point to a node which has that level */
+    for (uint32_t node = 0; node < n_slots; ++node) {
+      for (uint8_t l = 0; l <= loaded.levels_[node]; ++l) {
+        const uint32_t *links = loaded.Links(node, l);
+        for (uint32_t i = 1; i <= links[0]; ++i) {
+          if (links[i] >= n_slots || loaded.levels_[links[i]] < l) {
+            return false;
+          }
+        }
+      }
+    }
+  } else if (loaded.entry_ != kNoNode || n_slots >= kVecIndexThreshold) {
+    return false;
+  }
+  if (data != end) {
+    return false;
+  }
+  *this = std::move(loaded);
+  return true;
+}
+
+size_t VectorSet::Serialize(std::vector<char> &buf) const {
+  std::string data = Dump();
+  unsigned char enc_buf[10] = {0};
+  uint8_t enc_size = EncodeVarUnsignedInt64(data.size(), enc_buf);
+  buf.insert(buf.end(), enc_buf, enc_buf + enc_size);
+  buf.insert(buf.end(), data.begin(), data.end());
+  return buf.size();
+}
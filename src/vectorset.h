@@ -0,0 +1,172 @@
+#ifndef __VECTORSET_H__
+#define __VECTORSET_H__
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "serializable.h"
+#include "encoding.h"
+
+/* distance metrics */
+static constexpr int kVecMetricL2 = 0;
+static constexpr int kVecMetricIP = 1;
+static constexpr int kVecMetricCosine = 2;
+
+static constexpr uint32_t kVecMaxDim = 32768;
+/* sets smaller than this are searched by brute force, the graph index is built when reaching it */
+static constexpr uint32_t kVecIndexThreshold = 1024;
+/* max number of links of a node on upper levels, twice as many on level 0 */
+static constexpr uint32_t kVecLinks = 16;
+static constexpr uint32_t kVecEfConstruction = 200;
+static constexpr uint32_t kVecDefaultEf = 100;
+static constexpr uint8_t kVecMaxLevel = 16;
+
+/* "L2", "IP" or "COSINE" in any case, -1 if name is unknown */
+int VecMetricFromName(const std::string &name);
+
+const char *VecMetricName(int metric);
+
+/* element and its score: euclidean distance, inner product or cosine similarity by metric */
+typedef std::pair<std::string, float> VecMatch;
+
+/**
+ * @brief Set of named vectors of the same dimension for k nearest neighbor search. Vectors are
+ * stored contiguously as float32, or as int8 with a scale per vector if quantized. Vectors of
+ * cosine metric are normalized when added, so that similarity is their dot product.
+ *
+ * Small sets are searched by brute force. Once the set is large enough, an HNSW graph is built:
+ * every node is linked to its near neighbors on level 0 and, with exponentially decreasing
+ * probability, on upper levels; a search walks greedily from the top level down to level 0.
+ * Removed nodes stay in the graph as tombstones to keep it connected, and the graph is rebuilt
+ * once tombstones outnumber live nodes.
+ */
+class VectorSet : public Serializable {
+public:
+  VectorSet() = default;
+
+  VectorSet(uint32_t dim, int metric, bool quantized);
+
+  inline uint32_t Dim() const { return dim_; }
+
+  inline int Metric() const { return metric_; }
+
+  inline bool Quantized() const { return quantized_; }
+
+  /* number of elements */
+  inline uint64_t Count() const { return ids_.size(); }
+
+  /* whether the graph index is in use */
+  inline bool Indexed() const { return indexed_; }
+
+  /* add element with vector of Dim() floats, return false if it exists and its vector is updated */
+  bool Add(const std::string &element, const float *vec);
+
+  /* return false if element does not exist */
+  bool Remove(const std::string &element);
+
+  /* stored vector of element, which is normalized or dequantized, false if not exists */
+  bool Get(const std::string &element, std::vector<float> &vec) const;
+
+  /**
+   * @brief Search the k nearest elements of query
+   *
+   * @param ef size of the candidate list when walking the graph, higher for better recall
+   * @return matches from the nearest
+   */
+  std::vector<VecMatch> Search(const float *query, size_t k, size_t ef) const;
+
+  /* compare query with every element */
+  std::vector<VecMatch> SearchExact(const float *query, size_t k) const;
+
+  /* parameters, vectors and graph */
+  std::string Dump() const;
+
+  /* restore from the output of Dump, return false if data is malformed */
+  bool Load(const char *data, size_t len);
+
+  size_t Serialize(std::vector<char> &buf) const override;
+
+private:
+  /* distance and node, smaller distance is nearer */
+  typedef std::pair<float, uint32_t> Candidate;
+
+  static constexpr uint32_t kNoNode = UINT32_MAX;
+
+  inline uint32_t MaxLinks(uint8_t level) const { return level == 0 ? kVecLinks * 2 : kVecLinks; }
+
+  /* links of node on level, the first one is the number of links */
+  inline uint32_t *Links(uint32_t node, uint8_t level) {
+    return level == 0 ? &level0_[(size_t)node * (kVecLinks * 2 + 1)]
+                      : &upper_[node][(size_t)(level - 1) * (kVecLinks + 1)];
+  }
+
+  inline const uint32_t *Links(uint32_t node, uint8_t level) const {
+    return const_cast<VectorSet *>(this)->Links(node, level);
+  }
+
+  /* normalize or quantize vec into a new slot */
+  uint32_t AppendSlot(const std::string &element, const float *vec);
+
+  /* vector of node as floats, dequantized into buf if needed */
+  const float *VectorOf(uint32_t node, std::vector<float> &buf) const;
+
+  float Distance(const float *query, uint32_t node) const;
+
+  float Score(float distance) const;
+
+  /* query prepared for distance, normalized for cosine metric */
+  const float *PrepareQuery(const float *query, std::vector<float> &buf) const;
+
+  uint8_t RandomLevel();
+
+  void Link(uint32_t node);
+
+  void Greedy(const float *query, uint8_t top, uint8_t bottom, uint32_t &entry,
+              float &entry_dist) const;
+
+  /* the ef nearest nodes found on level from entry, unordered */
+  void SearchLevel(const float *query, uint32_t entry, float entry_dist, uint8_t level, size_t ef,
+                   std::vector<Candidate> &found) const;
+
+  /* pick at most max_links diverse neighbors from candidates */
+  void SelectNeighbors(std::vector<Candidate> &candidates, uint32_t max_links) const;
+
+  /* link node to neighbor on level, shrinking the links of neighbor if full */
+  void AddLink(uint32_t neighbor, uint32_t node, uint8_t level);
+
+  /* drop tombstones and rebuild the graph if the set is still large enough */
+  void Compact();
+
+  void BuildIndex();
+
+private:
+  uint32_t dim_ = 0;
+  int metric_ = kVecMetricL2;
+  bool quantized_ = false;
+  /* slots, including tombstones */
+  std::vector<std::string> names_;
+  std::vector<float> data_;
+  std::vector<int8_t> qdata_;
+  std::vector<float> scales_;
+  std::vector<uint8_t> deleted_;
+  uint32_t n_deleted_ = 0;
+  std::unordered_map<std::string, uint32_t> ids_;
+  /* graph */
+  bool indexed_ = false;
+  std::vector<uint8_t> levels_;
+  std::vector<uint32_t> level0_;
+  std::vector<std::vector<uint32_t>> upper_;
+  uint32_t entry_ = kNoNode;
+  uint8_t max_level_ = 0;
+  uint64_t rng_ = 0x9e3779b97f4a7c15ULL;
+  /* scratch space of searching, generation stamps of visited nodes */
+  mutable std::vector<uint32_t> visited_;
+  mutable uint32_t visit_stamp_ = 0;
+  mutable std::vector<float> buf_;
+  std::vector<float> node_buf_;
+  std::vector<float> link_buf_;
+};
+
+#endif  // __VECTORSET_H__
@@ -0,0 +1,176 @@
+#include "zset.h"
+
+int ZSetDictImpl::AddEntry(ZSEntry *new_entry) {
+  if (new_entry != nullptr) {
+    uint64_t slot_idx = CalculateSlotIndex(*new_entry->key);
+    if (FindEntry(*new_entry->key) != nullptr) {
+      return EXISTED;
+    }
+    /* place entry at the head of list */
+    new_entry->next = table_[slot_idx];
+    table_[slot_idx] = new_entry;
+    ++count_;
+    return NEW_ADDED;
+  }
+  return UNDEFINED;
+}
+
+int ZSetDictImpl::Update(const HEntryKey &member, int64_t score) {
+  ZSEntry *entry = FindEntry(member);
+  if (entry != nullptr) {
+    entry->score = score;
+    return UPDATED;
+  }
+  uint64_t slot_idx = CalculateSlotIndex(member);
+  ZSEntry *new_entry = new ZSEntry(new HEntryKey(member), score);
+  new_entry->next = table_[slot_idx];
+  table_[slot_idx] = new_entry;
+  ++count_;
+  return NEW_ADDED;
+}
+
+/***********　ZSetDict impl　************/
+
+int ZSetDict::Update(const HEntryKey &member, int64_t score) {
+  if (CheckNeedRehash()) {
+    PerformRehash();
+  }
+  if (cur_ht_->RehashDone()) {
+    return cur_ht_->Update(member, score);
+  } else {
+    if (cur_ht_ != nullptr) {
+      ZSEntry *entry = cur_ht_->FindEntry(member);
+      if (entry != nullptr) {
+        entry->score = score;
+        return UPDATED;
+      }
+    }
+    /* newly added member goes into backup during rehashing */
+    if (backup_ht_ != nullptr) {
+      return backup_ht_->Update(member, score);
+    }
+  }
+  return UNDEFINED;
+}
+
+ZSEntry *ZSetDict::Find(const HEntryKey &member) const {
+  ZSEntry *entry = nullptr;
+  if (cur_ht_ != nullptr) {
+    entry = cur_ht_->FindEntry(member);
+  }
+  if (entry == nullptr && backup_ht_ != nullptr) {
+    entry = backup_ht_->FindEntry(member);
+  }
+  return entry;
+}
+
+/***********　ZSet impl　************/
+
+int ZSet::Add(const HEntryKey &member, int64_t score) {
+  ZSEntry *entry = dict_.Find(member);
+  if (entry == nullptr) {
+    dict_.Update(member, score);
+    list_.Insert(score, member);
+    return NEW_ADDED;
+  }
+  if (entry->score == score) {
+    return EXISTED;
+  }
+  /* reposition member in skiplist */
+  list_.Remove(entry->score, member);
+  list_.Insert(score, member);
+  entry->score = score;
+  return UPDATED;
+}
+
+bool ZSet::Score(const HEntryKey &member, int64_t &score) const {
+  ZSEntry *entry = dict_.Find(member);
+  if (entry == nullptr) {
+    return false;
+  }
+  score = entry->score;
+  return true;
+}
+
+bool ZSet::Remove(const HEntryKey &member) {
+  ZSEntry *entry = dict_.Find(member);
+  if (entry == nullptr) {
+    return false;
+  }
+  list_.Remove(entry->score, member);
+  dict_.Erase(member);
+  return true;
+}
+
+long ZSet::Rank(const HEntryKey &member) const {
+  ZSEntry *entry = dict_.Find(member);
+  if (entry == nullptr) {
+    return -1;
+  }
+  return list_.Rank(entry->score, member);
+}
+
+std::vector<ZSetItem> ZSet::RangeByRank(size_t start, size_t end) const {
+  std::vector<ZSetItem> items;
+  if (start > end || start >= list_.Count()) {
+    return items;
+  }
+  end = std::min(end, list_.Count() - 1);
+  items.reserve(end - start + 1);
+  SKNode *node = list_.GetByRank(start);
+  for (size_t i = start; i <= end && node != nullptr; ++i, node = node->Next()) {
+    items.emplace_back(node->data, node->score);
+  }
+  return items;
+}
+
+std::vector<ZSetItem> ZSet::RangeByScore(const ZScoreRange &range, size_t offset,
+                                         long count) const {
+  std::vector<ZSetItem> items;
+  SKNode *node = list_.FirstInScoreRange(range.min, range.minex);
+  while (node != nullptr && offset > 0) {
+    node = node->Next();
+    --offset;
+  }
+  for (; node != nullptr && count != 0; node = node->Next()) {
+    if (range.maxex ? node->score >= range.max : node->score > range.max) {
+      break;
+    }
+    items.emplace_back(node->data, node->score);
+    if (count > 0) {
+      --count;
+    }
+  }
+  return items;
+}
+
+std::vector<ZSetItem> ZSet::PopMin(size_t count) {
+  std::vector<ZSetItem> items;
+  while (count > 0 && list_.Count() > 0) {
+    SKNode *node = list_.Begin();
+    items.emplace_back(node->data, node->score);
+    dict_.Erase(items.back().first);
+    list_.Remove(items.back().second, items.back().first);
+    --count;
+  }
+  return items;
+}
+
+size_t ZSet::Serialize(std::vector<char> &buf) const {
+  size_t count = Count();
+  if (count == 0) {
+    return 0;
+  }
+  unsigned char enc_buf[10] = {0};
+  uint8_t enc_size = EncodeVarUnsignedInt64(count, enc_buf);
+  /* put number of members first */
+  buf.insert(buf.end(), enc_buf, enc_buf + enc_size);
+
+  /* then every member followed by its score, ordered by score */
+  for (SKNode *node = list_.Begin(); node != nullptr; node = node->Next()) {
+    node->data.Serialize(buf);
+    enc_size = EncodeVarSignedInt64(node->score, enc_buf);
+    buf.insert(buf.end(), enc_buf, enc_buf + enc_size);
+  }
+  return buf.size();
+}
@@ -0,0 +1,134 @@
+#ifndef __ZSET_H__
+#define __ZSET_H__
+
+#include <utility>
+#include <vector>
+#include "hash.h"
+#include "rehashable.h"
+#include "serializable.h"
+#include "skiplist.h"
+#include "encoding.h"
+
+class ZSetDictImpl;
+class ZSetDict;
+class ZSet;
+
+/* each entry for zset dict, each entry maps a member to its score,
+ * and has a pointer pointing to the next entry instance */
+struct ZSEntry {
+  HEntryKey *key = nullptr;
+  int64_t score = 0;
+  ZSEntry *next = nullptr;
+
+  ZSEntry(HEntryKey *key, int64_t score) : key(key), score(score) {}
+
+  ~ZSEntry() {
+    if (key != nullptr) {
+      delete key;
+      key = nullptr;
+    }
+    next = nullptr;
+  }
+};
+
+/* member -> score hashtable implementation */
+class ZSetDictImpl : public HashStructBase<ZSEntry> {
+  friend class ZSetDict;
+
+public:
+  typedef ZSEntry entry_type;
+
+  explicit ZSetDictImpl(unsigned long init_size = 16) : HashStructBase<ZSEntry>(init_size) {}
+
+  /* needed for rehashing */
+  int AddEntry(ZSEntry *new_entry);
+
+  /* add member with score or update the score of existing member */
+  int Update(const HEntryKey &member, int64_t score);
+};
+
+/* member -> score dict with gradual rehashing */
+class ZSetDict : public Rehashable<ZSetDictImpl> {
+public:
+  explicit ZSetDict(double max_load_factor = 1.0) : Rehashable<ZSetDictImpl>(max_load_factor) {}
+
+  int Update(const HEntryKey &member, int64_t score);
+
+  /* return the entry of member, nullptr if not found */
+  ZSEntry *Find(const HEntryKey &member) const;
+};
+
+/* member and score pair returned by range operations */
+typedef std::pair<DynamicString, int64_t> ZSetItem;
+
+/* score interval used by range operations */
+struct ZScoreRange {
+  int64_t min = INT64_MIN;
+  int64_t max = INT64_MAX;
+  bool minex = false; /* exclude min */
+  bool maxex = false; /* exclude max */
+};
+
+/**
+ * @brief Sorted set, the dict gives O(1) score lookup of a member,
+ * the skiplist keeps members ordered by (score, member)
+ */
+class ZSet : public Serializable {
+public:
+  ZSet() = default;
+
+  ZSet(const ZSet &) = delete;
+
+  ZSet &operator=(const ZSet &) = delete;
+
+  /**
+   * @brief Add member with score, or update the score of existing member
+   *
+   * @return int NEW_ADDED, UPDATED, or EXISTED if the score is not changed
+   */
+  int Add(const HEntryKey &member, int64_t score);
+
+  int Add(const std::string &member, int64_t score) { return Add(HEntryKey(member), score); }
+
+  /**
+   * @brief Get the score of member
+   *
+   * @return true if member exists
+   */
+  bool Score(const HEntryKey &member, int64_t &score) const;
+
+  /**
+   * @brief Remove member from zset
+   *
+   * @return true if member existed and was removed
+   */
+  bool Remove(const HEntryKey &member);
+
+  /**
+   * @brief Get the 0-based rank of member ordered by score from low to high
+   *
+   * @return long -1 if member does not exist
+   */
+  long Rank(const HEntryKey &member) const;
+
+  /* items with rank in [start, end], both are non-negative and start <= end */
+  std::vector<ZSetItem> RangeByRank(size_t start, size_t end) const;
+
+  /* items with score in range, skip the first offset items,
+   * at most count items are returned if count >= 0 */
+  std::vector<ZSetItem> RangeByScore(const ZScoreRange &range, size_t offset = 0,
+                                     long count = -1) const;
+
+  /* remove and return at most count items with the lowest scores */
+  std::vector<ZSetItem> PopMin(size_t count);
+
+  inline size_t Count() const { return list_.Count(); }
+
+  size_t Serialize(std::vector<char> &buf) const override;
+
+private:
+  ZSetDict dict_;
+  Skiplist list_;
+};
+
+#endif  // __ZSET_H__
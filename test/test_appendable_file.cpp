@@ -5,10 +5,7 @@
 void TestAppend(AppendableFile& file) {
   for (int i = 0; i < 1024; ++i) {
     CommandCache cmd;
-    cmd.argc = 3;
-    cmd.argv.emplace_back("SET");
-    cmd.argv.push_back(std::to_string(i));
-    cmd.argv.push_back(std::to_string(i * 2));
+    cmd.Assign({"SET", std::to_string(i), std::to_string(i * 2)});
     file.Append(cmd);
   }
   std::cout << "Appended\n";
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "../src/bitops.h"
+
+using namespace std;
+
+static size_t NaiveBitCount(const vector<unsigned char> &buf, uint64_t start, uint64_t end) {
+  size_t count = 0;
+  for (uint64_t i = start; i <= end; ++i) {
+    count += (buf[i >> 3] >> (7 - (i & 7))) & 1;
+  }
+  return count;
+}
+
+static int64_t NaiveBitPos(const vector<unsigned char> &buf, uint64_t start, uint64_t end, int bit) {
+  for (uint64_t i = start; i <= end; ++i) {
+    if (((buf[i >> 3] >> (7 - (i & 7))) & 1) == bit) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+TEST(BitOpsTest, BitCountTest) {
+  mt19937 rng(42);
+  for (size_t len : {0, 1, 7, 8, 31, 32, 33, 100, 1000}) {
+    vector<unsigned char> buf(len);
+    for (auto &c : buf) {
+      c = rng();
+    }
+    EXPECT_EQ(BitCount(buf.data(), len), len ? NaiveBitCount(buf, 0, len * 8 - 1) : 0);
+    for (int i = 0; i < 50 && len > 0; ++i) {
+      uint64_t a = rng() % (len * 8), b = rng() % (len * 8);
+      EXPECT_EQ(BitCountRange(buf.data(), min(a, b), max(a, b)),
+                NaiveBitCount(buf, min(a, b), max(a, b)));
+    }
+  }
+}
+
+TEST(BitOpsTest, BitPosTest) {
+  vector<unsigned char> zeros(100, 0x00), ones(100, 0xFF);
+  EXPECT_EQ(BitPos(zeros.data(), zeros.size(), 1), -1);
+  EXPECT_EQ(BitPos(zeros.data(), zeros.size(), 0), 0);
+  EXPECT_EQ(BitPos(ones.data(), ones.size(), 0), -1);
+  zeros[70] = 0x10;
+  EXPECT_EQ(BitPos(zeros.data(), zeros.size(), 1), 70 * 8 + 3);
+  ones[99] = 0xFE;
+  EXPECT_EQ(BitPos(ones.data(), ones.size(), 0), 99 * 8 + 7);
+
+  mt19937 rng(7);
+  vector<unsigned char> sparse(200, 0);
+  sparse[rng() % 200] = 1 << (rng() % 8);
+  sparse[rng() % 200] = 1 << (rng() % 8);
+  for (int i = 0; i < 200; ++i) {
+    uint64_t a = rng() % 1600, b = rng() % 1600;
+    for (int bit : {0, 1}) {
+      EXPECT_EQ(BitPosRange(sparse.data(), min(a, b), max(a, b), bit),
+                NaiveBitPos(sparse, min(a, b), max(a, b), bit));
+    }
+  }
+}
+
+TEST(BitOpsTest, BitOpTest) {
+  vector<unsigned char> a(40, 0xF0), b(33, 0x3C), dst(40);
+  vector<BitmapView> srcs{{a.data(), a.size()}, {b.data(), b.size()}};
+  BitOp(BITOP_AND, dst.data(), dst.size(), srcs);
+  EXPECT_EQ(dst[0], 0x30);
+  EXPECT_EQ(dst[32], 0x30);
+  EXPECT_EQ(dst[33], 0x00);
+  BitOp(BITOP_OR, dst.data(), dst.size(), srcs);
+  EXPECT_EQ(dst[32], 0xFC);
+  EXPECT_EQ(dst[39], 0xF0);
+  BitOp(BITOP_XOR, dst.data(), dst.size(), srcs);
+  EXPECT_EQ(dst[0], 0xCC);
+  EXPECT_EQ(dst[39], 0xF0);
+  srcs = {{b.data(), b.size()}};
+  BitOp(BITOP_NOT, dst.data(), dst.size(), srcs);
+  EXPECT_EQ(dst[0], 0xC3);
+  EXPECT_EQ(dst[39], 0xFF);
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include "../src/bloom.h"
+
+using namespace std;
+
+TEST(BloomFilterTest, AddAndExistsTest) {
+  BloomFilter bf(0.01, 10000, 2, false);
+  EXPECT_FALSE(bf.Exists("a"));
+  EXPECT_EQ(bf.Add("a"), kBloomAdded);
+  EXPECT_EQ(bf.Add("a"), kBloomExists);
+  EXPECT_TRUE(bf.Exists("a"));
+  for (int i = 0; i < 10000; ++i) {
+    bf.Add("item-" + to_string(i));
+  }
+  EXPECT_EQ(bf.NumLayers(), 1);
+  /* no false negative */
+  for (int i = 0; i < 10000; ++i) {
+    ASSERT_TRUE(bf.Exists("item-" + to_string(i)));
+  }
+  /* false positive rate stays close to the target */
+  int n_fp = 0;
+  for (int i = 0; i < 100000; ++i) {
+    n_fp += bf.Exists("other-" + to_string(i));
+  }
+  EXPECT_LT(n_fp, 100000 * 0.015);
+}
+
+TEST(BloomFilterTest, ScalingTest) {
+  BloomFilter bf(0.01, 100, 2, false);
+  for (int i = 0; i < 5000; ++i) {
+    bf.Add("item-" + to_string(i));
+  }
+  EXPECT_GT(bf.NumLayers(), 1);
+  EXPECT_LE(bf.Count(), 5000);
+  EXPECT_GT(bf.Count(), 4900);
+  for (int i = 0; i < 5000; ++i) {
+    ASSERT_TRUE(bf.Exists("item-" + to_string(i)));
+  }
+  /* tightened error rates of new layers keep the overall rate bounded */
+  int n_fp = 0;
+  for (int i = 0; i < 100000; ++i) {
+    n_fp += bf.Exists("other-" + to_string(i));
+  }
+  EXPECT_LT(n_fp, 100000 * 0.02);
+
+  BloomFilter fixed(0.01, 10, 2, true);
+  int n_full = 0;
+  for (int i = 0; i < 100; ++i) {
+    n_full += fixed.Add("item-" + to_string(i)) == kBloomFull;
+  }
+  EXPECT_EQ(fixed.NumLayers(), 1);
+  EXPECT_EQ(fixed.Count(), 10);
+  EXPECT_GT(n_full, 80);
+}
+
+TEST(BloomFilterTest, DumpAndLoadTest) {
+  BloomFilter bf(0.001, 50, 4, false);
+  for (int i = 0; i < 1000; ++i) {
+    bf.Add(to_string(i));
+  }
+  std::string data = bf.Dump();
+  BloomFilter restored;
+  ASSERT_TRUE(restored.Load(data.data(), data.size()));
+  EXPECT_EQ(restored.Count(), bf.Count());
+  EXPECT_EQ(restored.NumLayers(), bf.NumLayers());
+  EXPECT_EQ(restored.Dump(), data);
+  for (int i = 0; i < 2000; ++i) {
+    EXPECT_EQ(restored.Exists(to_string(i)), bf.Exists(to_string(i)));
+  }
+  EXPECT_EQ(restored.Add("new"), bf.Add("new"));
+  EXPECT_EQ(restored.Dump(), bf.Dump());
+
+  vector<char> buf;
+  bf.Serialize(buf);
+  EXPECT_EQ(std::string(buf.end() - bf.Dump().size(), buf.end()), bf.Dump());
+
+  EXPECT_FALSE(restored.Load(data.data(), data.size() - 1));
+  EXPECT_FALSE(restored.Load(data.data(), 10));
+  EXPECT_EQ(BloomFilter::LayerBytes(0.5, 1ULL << 40), UINT64_MAX);
+}
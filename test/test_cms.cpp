@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <unordered_map>
+#include "../src/cms.h"
+
+using namespace std;
+
+TEST(CountMinSketchTest, IncrByAndQueryTest) {
+  CountMinSketch cms(2000, 5);
+  EXPECT_EQ(cms.Query({"a"})[0], 0);
+  auto counts = cms.IncrBy({"a", "b", "a"}, {1, 5, 2});
+  ASSERT_EQ(counts.size(), 3);
+  EXPECT_EQ(counts[0], 1);
+  EXPECT_EQ(counts[1], 5);
+  /* the second "a" sees the first one */
+  EXPECT_EQ(counts[2], 3);
+  EXPECT_EQ(cms.Total(), 8);
+
+  mt19937 rng(7);
+  unordered_map<string, uint32_t> real;
+  vector<string> items;
+  vector<uint32_t> increments;
+  for (int i = 0; i < 20000; ++i) {
+    string item = "item-" + to_string(rng() % 5000);
+    uint32_t increment = rng() % 10;
+    real[item] += increment;
+    items.emplace_back(item);
+    increments.emplace_back(increment);
+  }
+  cms.IncrBy(items, increments);
+  size_t total = 8;
+  for (auto increment : increments) {
+    total += increment;
+  }
+  /* never underestimated, overestimated by at most e / width * total with high probability */
+  size_t n_over = 0;
+  for (auto &item : real) {
+    uint32_t estimated = cms.Query({item.first})[0];
+    EXPECT_GE(estimated, item.second);
+    if (estimated > item.second + total * 2.72 / 2000) {
+      ++n_over;
+    }
+  }
+  EXPECT_LT(n_over, real.size() / 100);
+}
+
+TEST(CountMinSketchTest, SaturateAndMergeTest) {
+  CountMinSketch a(100, 3), b(100, 3);
+  a.IncrBy({"x"}, {UINT32_MAX - 1});
+  EXPECT_EQ(a.IncrBy({"x"}, {10})[0], UINT32_MAX);
+  b.IncrBy({"y", "z"}, {3, 4});
+  CountMinSketch merged(100, 3);
+  merged.MergeFrom(a, 1);
+  merged.MergeFrom(b, 2);
+  auto counts = merged.Query({"x", "y", "z"});
+  EXPECT_EQ(counts[0], UINT32_MAX);
+  EXPECT_GE(counts[1], 6);
+  EXPECT_GE(counts[2], 8);
+}
+
+TEST(CountMinSketchTest, DumpAndLoadTest) {
+  CountMinSketch cms(300, 4);
+  cms.IncrBy({"a", "b", "c"}, {1, 2, 3});
+  string data = cms.Dump();
+  CountMinSketch restored;
+  ASSERT_TRUE(restored.Load(data.data(), data.size()));
+  EXPECT_EQ(restored.Width(), 300);
+  EXPECT_EQ(restored.Depth(), 4);
+  EXPECT_EQ(restored.Total(), 6);
+  EXPECT_EQ(restored.Query({"a", "b", "c"}), cms.Query({"a", "b", "c"}));
+  EXPECT_EQ(restored.Dump(), data);
+  data.pop_back();
+  EXPECT_FALSE(restored.Load(data.data(), data.size()));
+  EXPECT_FALSE(restored.Load("", 0));
+}
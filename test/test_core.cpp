@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
+#include <unistd.h>
+#include <cmath>
 #include <iostream>
+#include <set>
 #include "../src/core.h"
 #include "../src/mem.h"
 
@@ -244,6 +247,44 @@ TEST(KVContainerTest, TestList) {
   EXPECT_TRUE(engine.Delete(Key("list2")));
 }
 
+TEST(KVContainerTest, TestListInsertRemoveTrim) {
+  for (int i = 0; i < 10; ++i) {
+    engine.RightPush("list3", to_string(i % 5), errcode);
+  }
+  /* 0 1 2 3 4 0 1 2 3 4 */
+  EXPECT_EQ(engine.ListInsert("list3", true, "3", "a", errcode), 11);
+  EXPECT_EQ(engine.ListInsert("list3", false, "4", "b", errcode), 12);
+  EXPECT_EQ(engine.ListInsert("list3", false, "x", "c", errcode), -1);
+  EXPECT_EQ(engine.ListItemAtIndex("list3", 3, errcode), "a");
+  EXPECT_EQ(engine.ListItemAtIndex("list3", 6, errcode), "b");
+  /* 0 1 2 a 3 4 b 0 1 2 3 4 */
+  EXPECT_EQ(engine.ListRemove("list3", -1, "2", errcode), 1);
+  EXPECT_EQ(engine.ListItemAtIndex("list3", -3, errcode), "1");
+  EXPECT_EQ(engine.ListRemove("list3", 0, "0", errcode), 2);
+  show_range(engine.ListRange("list3", 0, -1, errcode));
+  /* 1 2 a 3 4 b 1 3 4 */
+  EXPECT_TRUE(engine.ListTrim("list3", 2, -3, errcode));
+  std::vector<std::string> expected{"a", "3", "4", "b", "1"};
+  EXPECT_TRUE(engine.ListRangeAsStdString("list3", 0, -1, errcode) == expected);
+  /* visited in place, the size comes first */
+  std::vector<std::string> visited;
+  size_t visited_size = 0;
+  EXPECT_EQ(engine.ListRange("list3", 1, -2, [&](size_t n) { visited_size = n; },
+                             [&](const DynamicString &item) { visited.emplace_back(item.Data(), item.Length()); },
+                             errcode), 3);
+  EXPECT_EQ(visited_size, 3);
+  EXPECT_TRUE(visited == std::vector<std::string>(expected.begin() + 1, expected.end() - 1));
+  EXPECT_EQ(engine.ListRange("list3", 3, 1, [](size_t) { FAIL(); }, [](const DynamicString &) { FAIL(); },
+                             errcode), 0);
+  EXPECT_TRUE(engine.ListTrim("list3", 4, 2, errcode));
+  EXPECT_EQ(engine.ListLen("list3", errcode), 0);
+  engine.SetInt("notlist", 1);
+  engine.ListTrim("notlist", 0, 1, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  EXPECT_TRUE(engine.Delete(Key("list3")));
+  EXPECT_TRUE(engine.Delete(Key("notlist")));
+}
+
 TEST(KVContainerTest, TestHashDict) {
   engine.HashUpdateKV("ht1", "k1", "v1", errcode);
   auto v1 = engine.HashGetValue("ht1", "k1", errcode);
@@ -313,6 +354,11 @@ TEST(KVContainerTest, TestHashDict) {
   EXPECT_EQ(engine.HashDelField("kv1", "f2", errcode), 1);
 
   showHashStr(engine.HashGetAllEntries("kv1", errcode));
+  size_t n_entries = 0, n_visited = 0;
+  EXPECT_EQ(engine.HashGetAllEntries("kv1", [&](size_t n) { n_entries = n; },
+                                     [&](const HEntryKey &, const HEntryVal &) { ++n_visited; }, errcode),
+            engine.HashLen("kv1", errcode));
+  EXPECT_EQ(n_entries, n_visited);
 
   cout << "\n--------------- Test multiple keys values operation ---------------\n";
 
@@ -365,6 +411,53 @@ TEST(KVContainerTest, TestHashDict) {
   cout << "==================== Test container for hashtable End ====================\n";
 }
 
+TEST(KVContainerTest, TestHashIncrAndFieldExpire) {
+  EXPECT_EQ(engine.HashIncrBy("counter", "hits", 5, errcode), 5);
+  EXPECT_EQ(engine.HashIncrBy("counter", "hits", -7, errcode), -2);
+  EXPECT_EQ(engine.HashGetValue("counter", "hits", errcode), "-2");
+  engine.HashIncrBy("counter", "hits", INT64_MIN, errcode);
+  EXPECT_EQ(errcode, kOverflowCode);
+  EXPECT_EQ(engine.HashGetValue("counter", "hits", errcode), "-2");
+  EXPECT_EQ(engine.HashIncrByFloat("counter", "ratio", 10.5, errcode), "10.5");
+  EXPECT_EQ(engine.HashIncrByFloat("counter", "ratio", 0.1, errcode), "10.6");
+  EXPECT_EQ(engine.HashIncrByFloat("counter", "hits", 1.5, errcode), "-0.5");
+  engine.HashIncrBy("counter", "ratio", 1, errcode);
+  EXPECT_EQ(errcode, kFailCode);
+  EXPECT_FALSE(engine.HashSetNX("counter", "ratio", "0", errcode));
+  EXPECT_TRUE(engine.HashSetNX("counter", "name", "litekv", errcode));
+  EXPECT_EQ(engine.HashGetValue("counter", "name", errcode), "litekv");
+
+  /* increments keep the expiration, hset clears it */
+  uint64_t when = GetCurrentMs() + 60000;
+  EXPECT_EQ(engine.HashFieldExpireAt("counter", {"hits", "ratio", "none"}, when, errcode),
+            std::vector<int>({1, 1, -2}));
+  engine.HashIncrBy("counter", "ratio", 0, errcode);
+  engine.HashIncrByFloat("counter", "hits", 1, errcode);
+  engine.HashUpdateKV("counter", "ratio", "1", errcode);
+  EXPECT_EQ(engine.HashFieldExpireTime("counter", {"hits", "ratio", "none"}, errcode),
+            std::vector<int64_t>({(int64_t)when, -1, -2}));
+  EXPECT_EQ(engine.HashFieldPersist("counter", {"hits", "ratio"}, errcode),
+            std::vector<int>({1, -1}));
+
+  /* expired fields are deleted on access or by active expiration */
+  EXPECT_EQ(engine.HashFieldExpireAt("counter", {"hits"}, GetCurrentMs() - 1, errcode),
+            std::vector<int>({2}));
+  engine.HashFieldExpireAt("counter", {"ratio"}, GetCurrentMs() + 1, errcode);
+  usleep(5000);
+  EXPECT_EQ(engine.HashLen("counter", errcode), 1);
+  engine.HashFieldExpireAt("counter", {"name"}, GetCurrentMs() + 1, errcode);
+  usleep(5000);
+  EXPECT_EQ(engine.HashActiveExpire(10), 1);
+  EXPECT_EQ(engine.HashActiveExpire(10), 0);
+
+  engine.SetString("counter-str", "value");
+  engine.HashIncrBy("counter-str", "hits", 1, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  for (const char *key : {"counter", "counter-str"}) {
+    EXPECT_TRUE(engine.Delete(Key(key)));
+  }
+}
+
 TEST(KVContainerTest, TestHashSet) {
   EXPECT_TRUE(engine.SetAddItem("name", "john", errcode));
   EXPECT_TRUE(engine.SetAddItem("name", "mage", errcode));
@@ -405,6 +498,438 @@ TEST(KVContainerTest, TestHashSet) {
   cout << '\n';
 }
 
+TEST(KVContainerTest, TestStringRangeAndBits) {
+  engine.SetString("rangestr", "Hello World");
+  EXPECT_EQ(engine.GetRange("rangestr", 0, 4, errcode), "Hello");
+  EXPECT_EQ(engine.GetRange("rangestr", -5, -1, errcode), "World");
+  EXPECT_EQ(engine.GetRange("rangestr", 5, 1, errcode), "");
+  EXPECT_EQ(engine.SetRange("rangestr", 6, "Redis", errcode), 11);
+  EXPECT_EQ(engine.GetRange("rangestr", 0, -1, errcode), "Hello Redis");
+  EXPECT_EQ(engine.SetRange("rangestr-new", 2, "ab", errcode), 4);
+  EXPECT_EQ(engine.GetRange("rangestr-new", 0, -1, errcode), std::string("\0\0ab", 4));
+  EXPECT_EQ(engine.SetRange("rangestr-none", 2, "", errcode), 0);
+  EXPECT_FALSE(engine.KeyExists("rangestr-none"));
+
+  EXPECT_EQ(engine.SetBit("bits", 7, 1, errcode), 0);
+  EXPECT_EQ(engine.SetBit("bits", 7, 1, errcode), 1);
+  EXPECT_EQ(engine.SetBit("bits", 100, 1, errcode), 0);
+  EXPECT_EQ(engine.StrLen("bits", errcode), 13);
+  EXPECT_EQ(engine.GetBit("bits", 100, errcode), 1);
+  EXPECT_EQ(engine.GetBit("bits", 1000, errcode), 0);
+  EXPECT_EQ(engine.BitCount("bits", 0, -1, false, errcode), 2);
+  EXPECT_EQ(engine.BitCount("bits", 1, -1, false, errcode), 1);
+  EXPECT_EQ(engine.BitCount("bits", 8, 100, true, errcode), 1);
+  EXPECT_EQ(engine.BitPos("bits", 1, 0, -1, false, false, errcode), 7);
+  EXPECT_EQ(engine.BitPos("bits", 1, 8, -1, false, true, errcode), 100);
+  EXPECT_EQ(engine.BitPos("bits", 0, 0, -1, false, false, errcode), 0);
+  EXPECT_EQ(engine.BitPos("bits-missing", 0, 0, -1, false, false, errcode), 0);
+  EXPECT_EQ(engine.BitPos("bits-missing", 1, 0, -1, false, false, errcode), -1);
+
+  engine.SetString("bitsall", std::string(3, '\xff'));
+  EXPECT_EQ(engine.BitPos("bitsall", 0, 0, -1, false, false, errcode), 24);
+  EXPECT_EQ(engine.BitPos("bitsall", 0, 0, -1, true, false, errcode), -1);
+
+  /* int value is treated as its string form */
+  engine.SetInt("bitsint", 1);  /* "1" is 0x31 */
+  EXPECT_EQ(engine.BitCount("bitsint", 0, -1, false, errcode), 3);
+  EXPECT_EQ(engine.SetBit("bitsint", 7, 0, errcode), 1);
+  EXPECT_EQ(engine.GetRange("bitsint", 0, -1, errcode), "0");
+
+  EXPECT_EQ(engine.BitOp(BITOP_OR, "bitsdst", {"bits", "bitsall", "bits-missing"}, errcode), 13);
+  EXPECT_EQ(engine.BitCount("bitsdst", 0, -1, false, errcode), 25);
+  EXPECT_EQ(engine.BitOp(BITOP_AND, "bitsdst", {"bitsdst", "bitsall"}, errcode), 13);
+  EXPECT_EQ(engine.BitCount("bitsdst", 0, -1, false, errcode), 24);
+  EXPECT_EQ(engine.BitOp(BITOP_NOT, "bitsdst", {"bits-missing"}, errcode), 0);
+  EXPECT_FALSE(engine.KeyExists("bitsdst"));
+
+  engine.SetAddItem("bitsset", "a", errcode);
+  engine.SetBit("bitsset", 1, 1, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  engine.BitOp(BITOP_AND, "bitsdst", {"bits", "bitsset"}, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+}
+
+TEST(KVContainerTest, TestPinnedString) {
+  engine.SetString("pinned", "original");
+  auto value = engine.Get("pinned", errcode);
+  auto pin = PinStrObj(value);
+  const char *data = static_cast<const DynamicString *>(pin.get())->Data();
+  EXPECT_EQ(value->pins, 1);
+
+  /* writers copy the value instead of changing the bytes being sent */
+  engine.Append("pinned", "-more", errcode);
+  EXPECT_EQ(engine.GetRange("pinned", 0, -1, errcode), "original-more");
+  engine.SetRange("pinned", 0, "O", errcode);
+  EXPECT_EQ(engine.GetRange("pinned", 0, -1, errcode), "Original-more");
+  EXPECT_EQ(std::string(data, 8), "original");
+  EXPECT_NE(engine.Get("pinned", errcode), value);
+
+  auto value2 = engine.Get("pinned", errcode);
+  auto pin2 = PinStrObj(value2);
+  engine.SetString("pinned", "new");
+  engine.SetInt("pinned", 10);
+  EXPECT_EQ(engine.GetRange("pinned", 0, -1, errcode), "10");
+  EXPECT_EQ(std::string(static_cast<const DynamicString *>(pin2.get())->Data(), 13), "Original-more");
+
+  pin.reset();
+  pin2.reset();
+  EXPECT_EQ(value->pins, 0);
+  EXPECT_EQ(value2->pins, 0);
+}
+
+TEST(KVContainerTest, TestSetAlgebra) {
+  engine.SetAddItem("algset1", {"a", "b", "c", "d"}, errcode);
+  engine.SetAddItem("algset2", {"c", "d", "e"}, errcode);
+  engine.SetAddItem("algset3", std::vector<std::string>{"d", "f"}, errcode);
+  auto collect = [](int op, const std::vector<std::string> &keys) {
+    std::set<std::string> out;
+    int err;
+    engine.SetAlgebra(op, keys, [&out](const HEntryKey &member) {
+      out.insert(member.ToStdString());
+      return true;
+    }, err);
+    return out;
+  };
+  EXPECT_EQ(collect(SET_OP_INTER, {"algset1", "algset2", "algset3"}), std::set<std::string>({"d"}));
+  EXPECT_EQ(collect(SET_OP_UNION, {"algset1", "algset2", "algset3"}),
+            std::set<std::string>({"a", "b", "c", "d", "e", "f"}));
+  EXPECT_EQ(collect(SET_OP_DIFF, {"algset1", "algset2"}), std::set<std::string>({"a", "b"}));
+  /* missing key behaves as an empty set */
+  EXPECT_TRUE(collect(SET_OP_INTER, {"algset1", "algset-missing"}).empty());
+  EXPECT_EQ(collect(SET_OP_UNION, {"algset-missing", "algset3"}).size(), 2);
+
+  /* early stop */
+  size_t n = 0;
+  engine.SetAlgebra(SET_OP_UNION, {"algset1", "algset2"}, [&n](const HEntryKey &) {
+    return ++n != 3;
+  }, errcode);
+  EXPECT_EQ(n, 3);
+
+  EXPECT_EQ(engine.SetAlgebraStore(SET_OP_INTER, "algdst", {"algset1", "algset2"}, errcode), 2);
+  EXPECT_EQ(engine.QueryObjectType("algdst"), OBJECT_SET);
+  EXPECT_TRUE(engine.SetIsMember("algdst", "c", errcode));
+  /* destination may be one of the sources */
+  EXPECT_EQ(engine.SetAlgebraStore(SET_OP_UNION, "algdst", {"algdst", "algset3"}, errcode), 3);
+  /* empty result removes destination */
+  EXPECT_EQ(engine.SetAlgebraStore(SET_OP_DIFF, "algdst", {"algset3", "algset1"}, errcode), 1);
+  EXPECT_EQ(engine.SetAlgebraStore(SET_OP_DIFF, "algdst", {"algset3", "algset3"}, errcode), 0);
+  EXPECT_FALSE(engine.KeyExists("algdst"));
+
+  engine.SetInt("algnotset", 1);
+  engine.SetAlgebra(SET_OP_UNION, {"algset1", "algnotset"}, [](const HEntryKey &) { return true; },
+                    errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  engine.SetAlgebraStore(SET_OP_INTER, "algdst", {"algnotset"}, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+}
+
+TEST(KVContainerTest, TestSetRandom) {
+  engine.SetAddItem("randset", std::vector<std::string>{"a", "b", "c", "d", "e"}, errcode);
+  EXPECT_EQ(engine.SetRandomMembers("randset", 3, errcode).size(), 3);
+  EXPECT_EQ(engine.SetRandomMembers("randset", 10, errcode).size(), 5);
+  EXPECT_EQ(engine.SetRandomMembers("randset", -10, errcode).size(), 10);
+  EXPECT_TRUE(engine.SetRandomMembers("randset-missing", 3, errcode).empty());
+  auto popped = engine.SetPopMembers("randset", 2, errcode);
+  ASSERT_EQ(popped.size(), 2);
+  EXPECT_FALSE(engine.SetIsMember("randset", popped[0].ToStdString(), errcode));
+  EXPECT_EQ(engine.SetGetMemberCount("randset", errcode), 3);
+  EXPECT_EQ(engine.SetPopMembers("randset", 10, errcode).size(), 3);
+  EXPECT_EQ(engine.SetGetMemberCount("randset", errcode), 0);
+  engine.SetInt("randnotset", 1);
+  engine.SetPopMembers("randnotset", 1, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+}
+
+TEST(KVContainerTest, TestZSet) {
+  std::vector<std::pair<int64_t, std::string>> items{{3, "c"}, {1, "a"}, {2, "b"}};
+  EXPECT_EQ(engine.ZSetAdd("zset1", items, false, false, false, errcode), 3);
+  EXPECT_EQ(engine.QueryObjectType("zset1"), OBJECT_ZSET);
+  EXPECT_EQ(engine.ZSetAdd("zset1", {{5, "a"}, {4, "d"}}, true, false, false, errcode), 1);
+  EXPECT_EQ(engine.ZSetAdd("zset1", {{5, "a"}, {6, "e"}}, false, true, true, errcode), 1);
+  EXPECT_EQ(engine.ZSetCard("zset1", errcode), 4);
+  EXPECT_EQ(engine.ZSetIncrBy("zset1", "b", 10, errcode), 12);
+  int64_t score;
+  EXPECT_TRUE(engine.ZSetScore("zset1", "a", score, errcode));
+  EXPECT_EQ(score, 5);
+  /* c:3 d:4 a:5 b:12 */
+  EXPECT_EQ(engine.ZSetRank("zset1", "a", errcode), 2);
+  auto range = engine.ZSetRange("zset1", 1, -1, errcode);
+  ASSERT_EQ(range.size(), 3);
+  EXPECT_EQ(range[0].first, DynamicString("d"));
+  EXPECT_EQ(range[2].first, DynamicString("b"));
+  EXPECT_TRUE(engine.ZSetRange("zset1", 3, 1, errcode).empty());
+  ZScoreRange sr;
+  sr.min = 4;
+  sr.max = 12;
+  sr.maxex = true;
+  EXPECT_EQ(engine.ZSetRangeByScore("zset1", sr, 0, -1, errcode).size(), 2);
+  auto popped = engine.ZSetPopMin("zset1", 1, errcode);
+  ASSERT_EQ(popped.size(), 1);
+  EXPECT_EQ(popped[0].first, DynamicString("c"));
+  EXPECT_EQ(engine.ZSetRemove("zset1", {"a", "x"}, errcode), 1);
+  EXPECT_EQ(engine.ZSetCard("zset1", errcode), 2);
+  engine.SetInt("notzset", 1);
+  engine.ZSetCard("notzset", errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  EXPECT_TRUE(engine.Delete(Key("zset1")));
+  EXPECT_TRUE(engine.Delete(Key("notzset")));
+}
+
+TEST(KVContainerTest, TestHyperLogLog) {
+  EXPECT_EQ(engine.HLLAdd("hll1", {}, errcode), 1);
+  EXPECT_EQ(engine.QueryObjectType("hll1"), OBJECT_HLL);
+  EXPECT_EQ(engine.HLLAdd("hll1", {}, errcode), 0);
+  EXPECT_EQ(engine.HLLAdd("hll1", {"a", "b", "c"}, errcode), 1);
+  EXPECT_EQ(engine.HLLAdd("hll1", {"a", "b"}, errcode), 0);
+  EXPECT_EQ(engine.HLLAdd("hll2", {"c", "d"}, errcode), 1);
+  EXPECT_EQ(engine.HLLCount({"hll1"}, errcode), 3);
+  EXPECT_EQ(engine.HLLCount({"hll1", "hll2", "hll-missing"}, errcode), 4);
+  EXPECT_EQ(engine.HLLCount({"hll-missing"}, errcode), 0);
+  EXPECT_TRUE(engine.HLLMerge("hll2", {"hll1"}, errcode));
+  EXPECT_EQ(engine.HLLCount({"hll2"}, errcode), 4);
+  EXPECT_TRUE(engine.HLLMerge("hll3", {"hll1", "hll-missing"}, errcode));
+  EXPECT_EQ(engine.HLLCount({"hll3"}, errcode), 3);
+
+  auto restore = engine.RecoverCommandFromValue("hll2", errcode);
+  ASSERT_EQ(restore.size(), 3);
+  EXPECT_EQ(restore[0], "pfrestore");
+  EXPECT_TRUE(engine.HLLRestore("hll4", restore[2], errcode));
+  EXPECT_EQ(engine.HLLCount({"hll4"}, errcode), 4);
+  EXPECT_FALSE(engine.HLLRestore("hll4", "bad", errcode));
+
+  engine.SetInt("nothll", 1);
+  engine.HLLAdd("nothll", {"a"}, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  engine.HLLCount({"hll1", "nothll"}, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  engine.HLLMerge("hll1", {"nothll"}, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  for (const char *key : {"hll1", "hll2", "hll3", "hll4", "nothll"}) {
+    EXPECT_TRUE(engine.Delete(Key(key)));
+  }
+}
+
+TEST(KVContainerTest, TestCMSAndTopK) {
+  EXPECT_TRUE(engine.CMSInit("cms1", 1000, 5, errcode));
+  EXPECT_FALSE(engine.CMSInit("cms1", 1000, 5, errcode));
+  EXPECT_EQ(errcode, kFailCode);
+  EXPECT_EQ(engine.QueryObjectType("cms1"), OBJECT_CMS);
+  EXPECT_EQ(engine.CMSIncrBy("cms1", {"a", "b"}, {2, 3}, errcode), std::vector<uint32_t>({2, 3}));
+  EXPECT_EQ(engine.CMSQuery("cms1", {"a", "c"}, errcode), std::vector<uint32_t>({2, 0}));
+  engine.CMSQuery("cms-missing", {"a"}, errcode);
+  EXPECT_EQ(errcode, kKeyNotFoundCode);
+  EXPECT_TRUE(engine.CMSInit("cms2", 1000, 5, errcode));
+  engine.CMSIncrBy("cms2", {"a"}, {1}, errcode);
+  EXPECT_TRUE(engine.CMSMerge("cms2", {"cms1", "cms2"}, {2, 1}, errcode));
+  EXPECT_EQ(engine.CMSQuery("cms2", {"a", "b"}, errcode), std::vector<uint32_t>({5, 6}));
+  EXPECT_TRUE(engine.CMSInit("cms3", 10, 5, errcode));
+  EXPECT_FALSE(engine.CMSMerge("cms3", {"cms1"}, {1}, errcode));
+  EXPECT_EQ(errcode, kFailCode);
+  auto restore = engine.RecoverCommandFromValue("cms2", errcode);
+  ASSERT_EQ(restore.size(), 3);
+  EXPECT_EQ(restore[0], "cms.restore");
+  EXPECT_TRUE(engine.CMSRestore("cms3", restore[2], errcode));
+  EXPECT_EQ(engine.CMSQuery("cms3", {"a", "b"}, errcode), std::vector<uint32_t>({5, 6}));
+
+  EXPECT_TRUE(engine.TopKReserve("topk1", 2, 50, 4, 0.9, errcode));
+  EXPECT_FALSE(engine.TopKReserve("topk1", 2, 50, 4, 0.9, errcode));
+  auto expelled = engine.TopKAdd("topk1", {"a", "b", "a", "c"}, {1, 1, 1, 1}, errcode);
+  ASSERT_EQ(expelled.size(), 4);
+  EXPECT_FALSE(expelled[2].first);
+  EXPECT_FALSE(expelled[3].first);
+  expelled = engine.TopKAdd("topk1", {"c"}, {5}, errcode);
+  ASSERT_TRUE(expelled[0].first);
+  EXPECT_EQ(expelled[0].second, "b");
+  EXPECT_EQ(engine.TopKQuery("topk1", {"a", "b", "c"}, errcode),
+            std::vector<bool>({true, false, true}));
+  auto items = engine.TopKList("topk1", errcode);
+  ASSERT_EQ(items.size(), 2);
+  EXPECT_EQ(items[0], TopKItem("c", 6));
+  restore = engine.RecoverCommandFromValue("topk1", errcode);
+  EXPECT_TRUE(engine.TopKRestore("topk2", restore[2], errcode));
+  EXPECT_EQ(engine.TopKList("topk2", errcode), items);
+
+  engine.TopKAdd("cms1", {"a"}, {1}, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  engine.CMSQuery("topk1", {"a"}, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  for (const char *key : {"cms1", "cms2", "cms3", "topk1", "topk2"}) {
+    EXPECT_TRUE(engine.Delete(Key(key)));
+  }
+}
+
+TEST(KVContainerTest, TestBloomFilter) {
+  EXPECT_TRUE(engine.BFReserve("bf1", 0.01, 100, 2, false, errcode));
+  EXPECT_FALSE(engine.BFReserve("bf1", 0.01, 100, 2, false, errcode));
+  EXPECT_EQ(errcode, kFailCode);
+  EXPECT_EQ(engine.QueryObjectType("bf1"), OBJECT_BLOOM);
+  EXPECT_EQ(engine.BFAdd("bf1", {"a", "b", "a"}, errcode),
+            std::vector<int>({kBloomAdded, kBloomAdded, kBloomExists}));
+  EXPECT_EQ(engine.BFExists("bf1", {"a", "b", "c"}, errcode), std::vector<int>({1, 1, 0}));
+  /* missing key is created by add and reported as absent by exists */
+  EXPECT_EQ(engine.BFExists("bf2", {"a"}, errcode), std::vector<int>({0}));
+  EXPECT_EQ(errcode, kOkCode);
+  EXPECT_EQ(engine.BFAdd("bf2", {"x"}, errcode), std::vector<int>({kBloomAdded}));
+  EXPECT_EQ(engine.QueryObjectType("bf2"), OBJECT_BLOOM);
+  EXPECT_TRUE(engine.BFReserve("bf3", 0.01, 2, 2, true, errcode));
+  EXPECT_EQ(engine.BFAdd("bf3", {"a", "b", "c"}, errcode),
+            std::vector<int>({kBloomAdded, kBloomAdded, kBloomFull}));
+  auto restore = engine.RecoverCommandFromValue("bf1", errcode);
+  ASSERT_EQ(restore.size(), 3);
+  EXPECT_EQ(restore[0], "bf.restore");
+  EXPECT_TRUE(engine.BFRestore("bf3", restore[2], errcode));
+  EXPECT_EQ(engine.BFExists("bf3", {"a", "b", "c"}, errcode), std::vector<int>({1, 1, 0}));
+  EXPECT_FALSE(engine.BFRestore("bf3", "bad", errcode));
+
+  engine.SetString("bf-str", "value");
+  engine.BFAdd("bf-str", {"a"}, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  for (const char *key : {"bf1", "bf2", "bf3", "bf-str"}) {
+    EXPECT_TRUE(engine.Delete(Key(key)));
+  }
+}
+
+TEST(KVContainerTest, TestStream) {
+  StreamIDSpec spec;
+  StreamID id;
+  StreamIDSpec::Parse("1-*", spec);
+  EXPECT_FALSE(engine.StreamAdd("stream1", spec, {"f", "v"}, true, id, errcode));
+  EXPECT_EQ(errcode, kKeyNotFoundCode);
+  EXPECT_FALSE(engine.KeyExists("stream1"));
+  EXPECT_TRUE(engine.StreamAdd("stream1", spec, {"f", "v1"}, false, id, errcode));
+  EXPECT_EQ(id, StreamID(1, 0));
+  EXPECT_TRUE(engine.StreamAdd("stream1", spec, {"f", "v2"}, true, id, errcode));
+  EXPECT_EQ(id, StreamID(1, 1));
+  StreamIDSpec::Parse("1-1", spec);
+  EXPECT_FALSE(engine.StreamAdd("stream1", spec, {"f", "v"}, false, id, errcode));
+  EXPECT_EQ(errcode, kFailCode);
+  /* no key is left behind by a failed add */
+  StreamIDSpec::Parse("0-0", spec);
+  EXPECT_FALSE(engine.StreamAdd("stream2", spec, {"f", "v"}, false, id, errcode));
+  EXPECT_FALSE(engine.KeyExists("stream2"));
+  EXPECT_EQ(engine.QueryObjectType("stream1"), OBJECT_STREAM);
+  StreamIDSpec::Parse("*", spec);
+  for (int i = 0; i < 10; ++i) {
+    engine.StreamAdd("stream1", spec, {"n", std::to_string(i)}, false, id, errcode);
+  }
+  EXPECT_EQ(engine.StreamLength("stream1", errcode), 12);
+  EXPECT_EQ(engine.StreamLastID("stream1", errcode), id);
+  auto entries = engine.StreamRange("stream1", StreamID(1, 1), StreamID::Max(), 2, false, errcode);
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[0].fields, std::vector<std::string>({"f", "v2"}));
+  EXPECT_EQ(entries[1].fields, std::vector<std::string>({"n", "0"}));
+  entries = engine.StreamRange("stream1", StreamID::Min(), StreamID::Max(), 1, true, errcode);
+  EXPECT_EQ(entries[0].id, id);
+  EXPECT_EQ(engine.StreamTrimByLength("stream1", 5, false, errcode), 7);
+  EXPECT_EQ(engine.StreamTrimByMinID("stream1", id, false, errcode), 4);
+  EXPECT_EQ(engine.StreamLength("stream1", errcode), 1);
+  engine.StreamLength("stream-missing", errcode);
+  EXPECT_EQ(errcode, kKeyNotFoundCode);
+
+  auto restore = engine.RecoverCommandFromValue("stream1", errcode);
+  ASSERT_EQ(restore.size(), 3);
+  EXPECT_EQ(restore[0], "xrestore");
+  EXPECT_TRUE(engine.StreamRestore("stream2", restore[2], errcode));
+  EXPECT_EQ(engine.StreamLastID("stream2", errcode), id);
+  EXPECT_EQ(engine.StreamLength("stream2", errcode), 1);
+
+  engine.SetString("stream-str", "value");
+  engine.StreamAdd("stream-str", spec, {"f", "v"}, false, id, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  for (const char *key : {"stream1", "stream2", "stream-str"}) {
+    EXPECT_TRUE(engine.Delete(Key(key)));
+  }
+}
+
+TEST(KVContainerTest, TestTimeSeries) {
+  EXPECT_TRUE(engine.TSCreate("ts1", 1000, errcode));
+  EXPECT_FALSE(engine.TSCreate("ts1", 1000, errcode));
+  EXPECT_EQ(errcode, kFailCode);
+  TSSample sample;
+  EXPECT_FALSE(engine.TSGet("ts1", sample, errcode));
+  EXPECT_EQ(errcode, kOkCode);
+  for (int i = 0; i < 3000; ++i) {
+    EXPECT_TRUE(engine.TSAdd("ts1", i, i % 10, 0, errcode));
+  }
+  EXPECT_FALSE(engine.TSAdd("ts1", 2999, 0, 0, errcode));
+  EXPECT_EQ(errcode, kFailCode);
+  EXPECT_TRUE(engine.TSGet("ts1", sample, errcode));
+  EXPECT_EQ(sample, TSSample(2999, 9));
+  EXPECT_EQ(engine.QueryObjectType("ts1"), OBJECT_TS);
+  /* samples older than retention are invisible */
+  auto samples = engine.TSRange("ts1", INT64_MIN, INT64_MAX, 0, errcode);
+  ASSERT_EQ(samples.size(), 1001);
+  EXPECT_EQ(samples.front(), TSSample(1999, 9));
+  samples = engine.TSRange("ts1", 2500, 2600, 10, errcode);
+  ASSERT_EQ(samples.size(), 10);
+  EXPECT_EQ(samples.back(), TSSample(2509, 9));
+  samples = engine.TSAggregate("ts1", 2000, 2999, kTSAggSum, 10, 0, errcode);
+  ASSERT_EQ(samples.size(), 100);
+  EXPECT_EQ(samples[0], TSSample(2000, 45));
+  engine.TSRange("ts-missing", 0, 1, 0, errcode);
+  EXPECT_EQ(errcode, kKeyNotFoundCode);
+
+  /* created by the first add */
+  EXPECT_TRUE(engine.TSAdd("ts2", -10, 1.5, 5, errcode));
+  EXPECT_TRUE(engine.TSAdd("ts2", 0, 2.5, 0, errcode));
+  samples = engine.TSRange("ts2", INT64_MIN, INT64_MAX, 0, errcode);
+  ASSERT_EQ(samples.size(), 1);
+
+  auto restore = engine.RecoverCommandFromValue("ts1", errcode);
+  ASSERT_EQ(restore.size(), 3);
+  EXPECT_EQ(restore[0], "ts.restore");
+  EXPECT_TRUE(engine.TSRestore("ts2", restore[2], errcode));
+  EXPECT_EQ(engine.TSRange("ts2", INT64_MIN, INT64_MAX, 0, errcode).size(), 1001);
+  EXPECT_FALSE(engine.TSRestore("ts2", "bad", errcode));
+
+  engine.SetString("ts-str", "value");
+  engine.TSAdd("ts-str", 0, 0, 0, errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  for (const char *key : {"ts1", "ts2", "ts-str"}) {
+    EXPECT_TRUE(engine.Delete(Key(key)));
+  }
+}
+
+TEST(KVContainerTest, TestVectorSet) {
+  EXPECT_TRUE(engine.VAdd("vset1", "a", {1, 0}, kVecMetricCosine, false, errcode));
+  EXPECT_TRUE(engine.VAdd("vset1", "b", {0, 3}, kVecMetricL2, true, errcode));
+  EXPECT_FALSE(engine.VAdd("vset1", "a", {1, 1}, kVecMetricCosine, false, errcode));
+  EXPECT_EQ(errcode, kOkCode);
+  EXPECT_FALSE(engine.VAdd("vset1", "c", {1, 2, 3}, kVecMetricCosine, false, errcode));
+  EXPECT_EQ(errcode, kFailCode);
+  EXPECT_EQ(engine.QueryObjectType("vset1"), OBJECT_VSET);
+  EXPECT_EQ(engine.VCard("vset1", errcode), 2);
+  EXPECT_EQ(engine.VDim("vset1", errcode), 2);
+  /* metric and quantization are decided on creation */
+  auto matches = engine.VSim("vset1", {0, 1}, 1, kVecDefaultEf, errcode);
+  ASSERT_EQ(matches.size(), 1);
+  EXPECT_EQ(matches[0].first, "b");
+  EXPECT_FLOAT_EQ(matches[0].second, 1);
+  std::vector<float> vec;
+  EXPECT_TRUE(engine.VEmb("vset1", "a", vec, errcode));
+  EXPECT_FLOAT_EQ(vec[0], std::sqrt(0.5));
+  engine.VSim("vset1", {1}, 1, kVecDefaultEf, errcode);
+  EXPECT_EQ(errcode, kFailCode);
+  engine.VSim("vset-missing", {1}, 1, kVecDefaultEf, errcode);
+  EXPECT_EQ(errcode, kKeyNotFoundCode);
+
+  auto restore = engine.RecoverCommandFromValue("vset1", errcode);
+  ASSERT_EQ(restore.size(), 3);
+  EXPECT_EQ(restore[0], "vrestore");
+  EXPECT_TRUE(engine.VRem("vset1", "a", errcode));
+  EXPECT_FALSE(engine.VRem("vset1", "a", errcode));
+  EXPECT_EQ(engine.VCard("vset1", errcode), 1);
+  EXPECT_TRUE(engine.VRestore("vset2", restore[2], errcode));
+  EXPECT_EQ(engine.VCard("vset2", errcode), 2);
+  EXPECT_FALSE(engine.VRestore("vset2", "bad", errcode));
+  engine.SetString("vset-str", "value");
+  engine.VCard("vset-str", errcode);
+  EXPECT_EQ(errcode, kWrongTypeCode);
+  for (const char *key : {"vset1", "vset2", "vset-str"}) {
+    EXPECT_TRUE(engine.Delete(Key(key)));
+  }
+}
+
 TEST(KVContainerTest, TestEmptyKeyName) {
   engine.SetInt("", 100);
   EXPECT_EQ(engine.Get("", errcode)->ToInt64(), 100);
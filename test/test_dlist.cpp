@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include <unistd.h>
 #include <iostream>
+#include <deque>
+#include <random>
+#include <algorithm>
 #include "../src/dlist.h"
 
 using namespace std;
@@ -299,6 +302,116 @@ TEST(DListTest, BasicTest2) {
   showrange(range2);
 }
 
+TEST(DListTest, IndexAccessTest) {
+  DList list;
+  std::deque<std::string> expected;
+  std::mt19937 rng(2022);
+  for (int round = 0; round < 20000; ++round) {
+    int op = rng() % 10;
+    std::string val = std::to_string(round);
+    if (op < 3) {
+      list.PushLeft(val);
+      expected.push_front(val);
+    } else if (op < 7) {
+      list.PushRight(val);
+      expected.push_back(val);
+    } else if (op < 8 && !expected.empty()) {
+      EXPECT_EQ(list.PopLeft().ToStdString(), expected.front());
+      expected.pop_front();
+    } else if (!expected.empty()) {
+      EXPECT_EQ(list.PopRight().ToStdString(), expected.back());
+      expected.pop_back();
+    }
+    if (round % 97 == 0 && !expected.empty()) {
+      long n = (long)expected.size();
+      for (long i = 0; i < n; i += 7) {
+        ASSERT_EQ(list[i].ToStdString(), expected[i]);
+        ASSERT_EQ(list.At(i - n).ToStdString(), expected[i]);
+      }
+      ASSERT_EQ(list.At(-1).ToStdString(), expected.back());
+      int start = rng() % n;
+      auto range = list.RangeAsStdStringVector(start, start + 300);
+      std::vector<std::string> a(expected.begin() + start, expected.begin() + std::min(n, (long)start + 301));
+      ASSERT_TRUE(range == a);
+    }
+  }
+  EXPECT_THROW(list.At((long)list.Length()), std::out_of_range);
+  EXPECT_THROW(list.At(-(long)list.Length() - 1), std::out_of_range);
+  EXPECT_TRUE(list.RangeAsStdStringVector((int)list.Length(), (int)list.Length() + 10).empty());
+}
+TEST(DListTest, InsertRemoveTrimTest) {
+  DList list;
+  std::deque<std::string> expected;
+  std::mt19937 rng(2023);
+  auto check = [&]() {
+    ASSERT_EQ(list.Length(), expected.size());
+    auto range = list.RangeAsStdStringVector();
+    std::vector<std::string> a(expected.begin(), expected.end());
+    ASSERT_TRUE(range == a);
+    for (size_t i = 0; i < expected.size(); i += 13) {
+      ASSERT_EQ(list[i].ToStdString(), expected[i]);
+    }
+  };
+  for (int round = 0; round < 5000; ++round) {
+    int op = rng() % 20;
+    std::string val = std::to_string(rng() % 300);
+    if (op < 4) {
+      list.PushLeft(val);
+      expected.push_front(val);
+    } else if (op < 8) {
+      list.PushRight(val);
+      expected.push_back(val);
+    } else if (op < 14) {
+      size_t idx = expected.empty() ? 0 : rng() % (expected.size() + 1);
+      list.Insert(idx, val);
+      expected.insert(expected.begin() + idx, val);
+    } else if (op < 15 && !expected.empty()) {
+      EXPECT_EQ(list.PopLeft().ToStdString(), expected.front());
+      expected.pop_front();
+    } else if (op < 16 && !expected.empty()) {
+      EXPECT_EQ(list.PopRight().ToStdString(), expected.back());
+      expected.pop_back();
+    } else if (op < 18) {
+      long count = (long)(rng() % 5) - 2;
+      size_t limit = count == 0 ? expected.size() : std::labs(count);
+      size_t removed = 0;
+      if (count >= 0) {
+        for (auto it = expected.begin(); it != expected.end() && removed < limit;) {
+          if (*it == val) {
+            it = expected.erase(it);
+            ++removed;
+          } else {
+            ++it;
+          }
+        }
+      } else {
+        for (long i = (long)expected.size() - 1; i >= 0 && removed < limit; --i) {
+          if (expected[i] == val) {
+            expected.erase(expected.begin() + i);
+            ++removed;
+          }
+        }
+      }
+      ASSERT_EQ(list.Remove(val, count), removed);
+    } else if (op < 19 && expected.size() > 10) {
+      size_t start = rng() % 8;
+      size_t finish = expected.size() - 1 - rng() % 8;
+      list.Trim(start, finish);
+      expected.erase(expected.begin() + finish + 1, expected.end());
+      expected.erase(expected.begin(), expected.begin() + start);
+    }
+    check();
+    long found = list.Find(val);
+    auto it = std::find(expected.begin(), expected.end(), val);
+    ASSERT_EQ(found, it == expected.end() ? -1 : (long)(it - expected.begin()));
+  }
+  list.Trim(3, 1);
+  EXPECT_TRUE(list.Empty());
+  EXPECT_EQ(list.NodeNum(), 2);
+  list.PushRight("a");
+  list.Insert(0, "b");
+  EXPECT_EQ(list[0].ToStdString(), "b");
+}
 
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
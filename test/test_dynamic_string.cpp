@@ -126,6 +126,25 @@ TEST(DynamicStringTest, ComparatorTest) {
   EXPECT_TRUE(s1 < s3);
 }
 
+TEST(DynamicStringTest, ResizeAndSetRangeTest) {
+  DynamicString s1;
+  s1.SetRange(3, "abc", 3);
+  EXPECT_EQ(s1.Length(), 6);
+  EXPECT_EQ(s1.ToStdString(), std::string("\0\0\0abc", 6));
+  s1.SetRange(1, "xy", 2);
+  EXPECT_EQ(s1.ToStdString(), std::string("\0xyabc", 6));
+  s1.SetRange(5, "def", 3);
+  EXPECT_EQ(s1.ToStdString(), std::string("\0xyabdef", 8));
+
+  DynamicString s2("hello");
+  s2.Resize(8);
+  EXPECT_EQ(s2.Length(), 8);
+  EXPECT_EQ(s2.ToStdString(), std::string("hello\0\0\0", 8));
+  s2.Resize(2);
+  EXPECT_EQ(s2.ToStdString(), "he");
+  EXPECT_EQ(s2.Data()[2], '\0');
+}
+
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
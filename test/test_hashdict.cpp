@@ -126,6 +126,47 @@ TEST(HashDictTest, TestHashDict) {
   cout << "============== Test HashDict End ==============\n";
 }
 
+TEST(HashDictTest, TestFieldExpire) {
+  HashDict dict;
+  for (int i = 0; i < 10; ++i) {
+    dict.Update(std::to_string(i), std::to_string(i));
+  }
+  EXPECT_FALSE(dict.SetExpire(HEntryKey("missing"), 100));
+  EXPECT_TRUE(dict.SetExpire(HEntryKey("1"), 100));
+  EXPECT_TRUE(dict.SetExpire(HEntryKey("2"), 200));
+  EXPECT_TRUE(dict.SetExpire(HEntryKey("3"), 300));
+  EXPECT_TRUE(dict.SetExpire(HEntryKey("3"), 50));
+  EXPECT_EQ(dict.ExpireTime(HEntryKey("3")), 50);
+  EXPECT_EQ(dict.ExpireTime(HEntryKey("4")), -1);
+  EXPECT_EQ(dict.NumExpires(), 3);
+
+  /* overwritten or erased keys lose the expiration */
+  dict.Update("2", "two");
+  EXPECT_EQ(dict.ExpireTime(HEntryKey("2")), -1);
+  EXPECT_TRUE(dict.Persist(HEntryKey("1")));
+  EXPECT_FALSE(dict.Persist(HEntryKey("1")));
+  dict.SetExpire(HEntryKey("5"), 150);
+  dict.Erase("5");
+  EXPECT_EQ(dict.NumExpires(), 1);
+
+  EXPECT_EQ(dict.ExpireKeys(40), 0);
+  EXPECT_EQ(dict.ExpireKeys(1000), 1);
+  EXPECT_EQ(dict.Count(), 8);
+  EXPECT_EQ(dict.Find(HEntryKey("3")), nullptr);
+  ASSERT_NE(dict.Find(HEntryKey("2")), nullptr);
+  dict.Find(HEntryKey("2"))->Reset("2");
+  EXPECT_EQ(dict.At("2"), "2");
+
+  /* skipped items are dropped when the heap is rebuilt */
+  for (int i = 0; i < 100; ++i) {
+    dict.SetExpire(HEntryKey("6"), 2000 + i);
+  }
+  EXPECT_EQ(dict.NumExpires(), 1);
+  EXPECT_EQ(dict.ExpireKeys(2098), 0);
+  EXPECT_EQ(dict.ExpireKeys(2099), 1);
+  EXPECT_EQ(dict.NumExpires(), 0);
+}
+
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
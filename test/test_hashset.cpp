@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include <iostream>
+#include <set>
+#include <unordered_map>
 #include "../src/hashset.h"
 
 using namespace std;
@@ -50,6 +52,49 @@ TEST(HashSetTest, TestHashSet) {
   EXPECT_EQ(25, set1.Count());
 }
 
+TEST(HashSetTest, TestRandomEntry) {
+  std::mt19937_64 rng(2023);
+  HashSet set1;
+  EXPECT_EQ(set1.RandomEntry(rng), nullptr);
+  EXPECT_TRUE(set1.RandomEntries(5, true, rng).empty());
+
+  const int n = 100;
+  for (int i = 0; i < n; ++i) {
+    set1.Insert(to_string(i));
+  }
+  /* every member should be picked with roughly the same probability */
+  std::unordered_map<std::string, int> hits;
+  const int rounds = 100000;
+  for (int i = 0; i < rounds; ++i) {
+    HSEntry *entry = set1.RandomEntry(rng);
+    ASSERT_NE(entry, nullptr);
+    ++hits[entry->key->ToStdString()];
+  }
+  EXPECT_EQ(hits.size(), n);
+  for (const auto &hit : hits) {
+    EXPECT_GT(hit.second, rounds / n / 3);
+    EXPECT_LT(hit.second, rounds / n * 3);
+  }
+
+  /* distinct entries, small and large count */
+  for (size_t count : {5, 60, 100, 200}) {
+    auto entries = set1.RandomEntries(count, true, rng);
+    EXPECT_EQ(entries.size(), std::min<size_t>(count, n));
+    EXPECT_EQ(std::set<HSEntry *>(entries.begin(), entries.end()).size(), entries.size());
+  }
+  EXPECT_EQ(set1.RandomEntries(300, false, rng).size(), 300);
+
+  /* sparse table after removing most of the members */
+  for (int i = 0; i < n - 2; ++i) {
+    set1.Erase(to_string(i));
+  }
+  std::set<std::string> left;
+  for (int i = 0; i < 100; ++i) {
+    left.insert(set1.RandomEntry(rng)->key->ToStdString());
+  }
+  EXPECT_EQ(left, std::set<std::string>({to_string(n - 2), to_string(n - 1)}));
+}
+
 int main(int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
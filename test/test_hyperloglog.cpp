@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "../src/hyperloglog.h"
+
+using namespace std;
+
+static double RelativeError(uint64_t estimated, uint64_t real) {
+  return fabs((double)estimated - (double)real) / (double)real;
+}
+
+TEST(HyperLogLogTest, CountTest) {
+  HyperLogLog hll;
+  EXPECT_EQ(hll.Count(), 0);
+  EXPECT_TRUE(hll.Add("hello"));
+  EXPECT_FALSE(hll.Add("hello"));
+  EXPECT_EQ(hll.Count(), 1);
+  for (int i = 0; i < 100; ++i) {
+    hll.Add("elem-" + to_string(i));
+  }
+  EXPECT_TRUE(hll.IsSparse());
+  EXPECT_LT(RelativeError(hll.Count(), 101), 0.02);
+  for (int i = 100; i < 100000; ++i) {
+    hll.Add("elem-" + to_string(i));
+  }
+  EXPECT_FALSE(hll.IsSparse());
+  EXPECT_LT(RelativeError(hll.Count(), 100001), 0.02);
+  /* adding existing elements changes nothing */
+  uint64_t count = hll.Count();
+  for (int i = 0; i < 1000; ++i) {
+    hll.Add("elem-" + to_string(i));
+  }
+  EXPECT_EQ(hll.Count(), count);
+}
+
+TEST(HyperLogLogTest, MergeTest) {
+  HyperLogLog a, b, c;
+  for (int i = 0; i < 50000; ++i) {
+    a.Add("elem-" + to_string(i));
+  }
+  for (int i = 25000; i < 75000; ++i) {
+    b.Add("elem-" + to_string(i));
+  }
+  for (int i = 0; i < 100; ++i) {
+    c.Add("elem-" + to_string(i + 100000));
+  }
+  vector<uint8_t> regs(kHLLRegisters, 0);
+  a.MergeInto(regs.data());
+  b.MergeInto(regs.data());
+  c.MergeInto(regs.data());
+  EXPECT_LT(RelativeError(HyperLogLog::Estimate(regs.data()), 75100), 0.02);
+
+  a.Merge(b);
+  a.Merge(c);
+  EXPECT_EQ(a.Count(), HyperLogLog::Estimate(regs.data()));
+
+  HyperLogLog d;
+  d.LoadRegisters(regs.data());
+  EXPECT_EQ(d.Count(), a.Count());
+  EXPECT_EQ(d.Dump(), a.Dump());
+}
+
+TEST(HyperLogLogTest, DumpAndLoadTest) {
+  HyperLogLog sparse, dense;
+  for (int i = 0; i < 500; ++i) {
+    sparse.Add("elem-" + to_string(i));
+  }
+  for (int i = 0; i < 20000; ++i) {
+    dense.Add("elem-" + to_string(i));
+  }
+  for (HyperLogLog *hll : {&sparse, &dense}) {
+    string data = hll->Dump();
+    HyperLogLog restored;
+    ASSERT_TRUE(restored.Load(data.data(), data.size()));
+    EXPECT_EQ(restored.IsSparse(), hll->IsSparse());
+    EXPECT_EQ(restored.Count(), hll->Count());
+    EXPECT_EQ(restored.Dump(), data);
+  }
+
+  HyperLogLog bad;
+  EXPECT_FALSE(bad.Load("", 0));
+  EXPECT_FALSE(bad.Load("\x02", 1));
+  string truncated = dense.Dump();
+  truncated.pop_back();
+  EXPECT_FALSE(bad.Load(truncated.data(), truncated.size()));
+  /* sparse entries must be in increasing order of index */
+  string unordered("\x00\x41\x00\x00\x01\x00\x00", 7);
+  EXPECT_FALSE(bad.Load(unordered.data(), unordered.size()));
+  string ordered("\x00\x01\x00\x00\x41\x00\x00", 7);
+  EXPECT_TRUE(bad.Load(ordered.data(), ordered.size()));
+  EXPECT_EQ(bad.Count(), 2);
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+#include "../src/net/iothreads.h"
+
+static void IncreaseJob(Session *session) {
+  ++session->io_nbytes;
+}
+
+/* sessions without sockets, which only carry a counter */
+static std::vector<std::unique_ptr<Session>> MakeSessions(size_t n) {
+  std::vector<std::unique_ptr<Session>> sessions;
+  for (size_t i = 0; i < n; ++i) {
+    sessions.emplace_back(new Session(-1, 0, nullptr, nullptr, nullptr, std::to_string(i)));
+  }
+  return sessions;
+}
+
+TEST(IOThreadPoolTest, TestEverySessionOnce) {
+  for (int n_threads : {1, 2, 4, 16}) {
+    IOThreadPool pool(n_threads);
+    EXPECT_EQ(pool.NumThreads(), n_threads);
+    auto owned = MakeSessions(1000);
+    std::vector<Session *> sessions;
+    for (auto &session : owned) {
+      sessions.push_back(session.get());
+    }
+    int n_rounds = 200;
+    for (int round = 0; round < n_rounds; ++round) {
+      /* small batches are done by the main thread */
+      size_t size = round % 2 == 0 ? sessions.size() : 3;
+      std::vector<Session *> batch(sessions.begin(), sessions.begin() + size);
+      pool.Run(batch, IncreaseJob);
+    }
+    EXPECT_EQ(owned[0]->io_nbytes, n_rounds);
+    EXPECT_EQ(owned[999]->io_nbytes, n_rounds / 2);
+    for (size_t i = 3; i < owned.size(); ++i) {
+      ASSERT_EQ(owned[i]->io_nbytes, n_rounds / 2);
+    }
+  }
+  EXPECT_EQ(IOThreadPool(0).NumThreads(), 1);
+}
+
+static void SlowJob(Session *session) {
+  std::this_thread::sleep_for(std::chrono::microseconds(100));
+  session->io_nbytes = 1;
+}
+
+TEST(IOThreadPoolTest, TestWaitForAll) {
+  IOThreadPool pool(4);
+  auto owned = MakeSessions(64);
+  std::vector<Session *> sessions;
+  for (auto &session : owned) {
+    sessions.push_back(session.get());
+  }
+  pool.Run(sessions, SlowJob);
+  for (auto &session : owned) {
+    EXPECT_EQ(session->io_nbytes, 1);
+  }
+}
@@ -102,6 +102,67 @@ TEST(LKVDBTEST, TestLKVDB) {
     }
   }
 
+  // 6. hyperloglog, both sparse and dense ones
+  std::unordered_map<std::string, uint64_t> hlls;
+  for (int i = 0; i < 10; ++i) {
+    std::string key = "hll-" + std::to_string(i);
+    int n_elem = rand_int(1, 5000);
+    std::vector<std::string> elems;
+    for (int j = 0; j < n_elem; ++j) {
+      elems.emplace_back(std::to_string(j));
+    }
+    original.HLLAdd(key, elems, errcode);
+    hlls[key] = original.HLLCount({key}, errcode);
+  }
+
+  // 7. count-min sketch and top-k
+  std::vector<std::string> sketch_items;
+  std::vector<uint32_t> sketch_increments;
+  for (int i = 0; i < 1000; ++i) {
+    sketch_items.emplace_back(std::to_string(rand_int(1, 200)));
+    sketch_increments.emplace_back(rand_int(1, 10));
+  }
+  original.CMSInit("cms", 100, 4, errcode);
+  original.CMSIncrBy("cms", sketch_items, sketch_increments, errcode);
+  original.TopKReserve("topk", 10, 20, 4, 0.9, errcode);
+  original.TopKAdd("topk", sketch_items, sketch_increments, errcode);
+
+  // 8. bloom filter with several layers
+  original.BFReserve("bloom", 0.01, 50, 2, false, errcode);
+  original.BFAdd("bloom", sketch_items, errcode);
+
+  // 9. stream spanning several segments
+  StreamIDSpec stream_spec;
+  StreamIDSpec::Parse("*", stream_spec);
+  for (int i = 0; i < 500; ++i) {
+    StreamID id;
+    original.StreamAdd("stream", stream_spec, {"n", std::to_string(rand_int(1, 1000))}, false, id,
+                       errcode);
+  }
+  original.StreamTrimByLength("stream", 400, false, errcode);
+  // 10. time series with retention
+  original.TSCreate("timeseries", 100000, errcode);
+  for (int i = 0; i < 3000; ++i) {
+    original.TSAdd("timeseries", i * 100, rand_int(1, 1000) / 8.0, 0, errcode);
+  }
+
+  // 11. vector set with graph index
+  for (int i = 0; i < 1200; ++i) {
+    std::vector<float> vec(8);
+    for (auto &v : vec) {
+      v = rand_int(-1000, 1000) / 100.0;
+    }
+    original.VAdd("vectorset", "element" + std::to_string(i), vec, kVecMetricL2, true, errcode);
+  }
+  original.VRem("vectorset", "element0", errcode);
+
+  // 12. hash with expirations of fields
+  for (int i = 0; i < 100; ++i) {
+    original.HashUpdateKV("hashttl", "field" + std::to_string(i), std::to_string(i), errcode);
+  }
+  uint64_t field_when = GetCurrentMs() + 3600 * 1000;
+  original.HashFieldExpireAt("hashttl", {"field1", "field2"}, field_when, errcode);
+
   // and then store then in memory
   std::vector<char> bin;
   bin.reserve(2048);
@@ -188,6 +249,51 @@ TEST(LKVDBTEST, TestLKVDB) {
     EXPECT_EQ(cnt, elements.size());
     EXPECT_EQ(cnt, rev.size());
   }
+
+  // check count-min sketch and top-k
+  EXPECT_EQ(restored.CMSQuery("cms", sketch_items, errcode),
+            original.CMSQuery("cms", sketch_items, errcode));
+  EXPECT_EQ(restored.TopKList("topk", errcode), original.TopKList("topk", errcode));
+
+  // check stream
+  auto stream_entries = restored.StreamRange("stream", StreamID::Min(), StreamID::Max(), 0, false, errcode);
+  auto original_entries = original.StreamRange("stream", StreamID::Min(), StreamID::Max(), 0, false, errcode);
+  ASSERT_EQ(stream_entries.size(), 400);
+  for (size_t i = 0; i < stream_entries.size(); ++i) {
+    EXPECT_EQ(stream_entries[i].id, original_entries[i].id);
+    EXPECT_EQ(stream_entries[i].fields, original_entries[i].fields);
+  }
+  EXPECT_EQ(restored.StreamLastID("stream", errcode), original.StreamLastID("stream", errcode));
+
+  // check time series
+  auto ts_samples = restored.TSRange("timeseries", INT64_MIN, INT64_MAX, 0, errcode);
+  ASSERT_EQ(ts_samples.size(), 1001);
+  EXPECT_EQ(ts_samples, original.TSRange("timeseries", INT64_MIN, INT64_MAX, 0, errcode));
+  EXPECT_EQ(restored.RecoverCommandFromValue("timeseries", errcode),
+            original.RecoverCommandFromValue("timeseries", errcode));
+
+  // check vector set
+  EXPECT_EQ(restored.VCard("vectorset", errcode), 1199);
+  EXPECT_EQ(restored.VSim("vectorset", std::vector<float>(8, 1), 10, 50, errcode),
+            original.VSim("vectorset", std::vector<float>(8, 1), 10, 50, errcode));
+  EXPECT_EQ(restored.RecoverCommandFromValue("vectorset", errcode),
+            original.RecoverCommandFromValue("vectorset", errcode));
+
+  // check hash with expirations of fields
+  EXPECT_EQ(restored.HashLen("hashttl", errcode), 100);
+  EXPECT_EQ(restored.HashFieldExpireTime("hashttl", {"field1", "field2", "field3"}, errcode),
+            std::vector<int64_t>({(int64_t)field_when, (int64_t)field_when, -1}));
+
+  // check bloom filter
+  EXPECT_EQ(restored.BFExists("bloom", sketch_items, errcode), std::vector<int>(1000, 1));
+  EXPECT_EQ(restored.RecoverCommandFromValue("bloom", errcode),
+            original.RecoverCommandFromValue("bloom", errcode));
+
+  // check hyperloglog
+  for (auto& item : hlls) {
+    EXPECT_EQ(restored.HLLCount({item.first}, errcode), item.second);
+    EXPECT_EQ(errcode, kOkCode);
+  }
   unlink(dumpfile.c_str());
 }
 
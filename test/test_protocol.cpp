@@ -1,5 +1,13 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <strings.h>
+#include <sys/socket.h>
+#include "../src/net/commands.h"
 #include "../src/net/protocol.h"
+#include "../src/net/respscan.h"
+#include "../src/net/reply.h"
+#include "../src/net/utils.h"
 
 TEST(ProtocolTest, SimpleTest) {
   {
@@ -48,6 +56,367 @@ TEST(ProtocolTest, SimpleTest) {
   }
 }
 
+TEST(ProtocolTest, TestArgumentViews) {
+  std::string value(1 << 20, 'v');
+  Buffer buf;
+  buf.Append("*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$" + std::to_string(value.size()) + "\r\n" + value + "\r\n");
+  const char *begin = buf.BeginRead();
+  CommandCache cache;
+  bool err = false;
+  ASSERT_TRUE(TryParseFromBuffer(buf, cache, err));
+  EXPECT_FALSE(err);
+  ASSERT_EQ(cache.argv.size(), 3);
+  /* arguments refer to the buffer and end with '\0' */
+  EXPECT_TRUE(cache.borrowing);
+  EXPECT_EQ(cache.argv[0].data(), begin + 8);
+  EXPECT_STREQ(cache.argv[1].c_str(), "key");
+  EXPECT_EQ(cache.argv[2].size(), value.size());
+  EXPECT_EQ(cache.argv[2].c_str()[value.size()], '\0');
+  EXPECT_TRUE(cache.own_args.empty());
+
+  /* a command name in upper case is replaced, the others are left in the buffer */
+  cache.LowerName();
+  EXPECT_EQ(cache.argv[0], "set");
+  EXPECT_EQ(cache.argv[1].data(), begin + 17);
+
+  /* copies and owned commands outlive the buffer */
+  CommandCache copied = cache;
+  cache.Own();
+  EXPECT_FALSE(cache.borrowing);
+  buf.Reset();
+  buf.Append(std::string(4 << 20, 'x'));
+  for (const CommandCache *cmds : {&cache, &copied}) {
+    EXPECT_EQ(cmds->argv[0], "set");
+    EXPECT_EQ(cmds->argv[1], "key");
+    EXPECT_EQ(cmds->argv[2], value);
+  }
+
+  /* an incomplete request leaves nothing in cache */
+  buf.Reset();
+  buf.Append("*2\r\n$3\r\nget\r\n$3\r\nke");
+  EXPECT_FALSE(TryParseFromBuffer(buf, cache, err));
+  EXPECT_FALSE(err);
+  EXPECT_TRUE(cache.argv.empty());
+}
+
+TEST(ProtocolTest, TestResumableParse) {
+  std::string value(300000, 'v');
+  std::string request = "*3\r\n$3\r\nset\r\n$15\r\nkey\r\nwith\r\ncrlf\r\n$" +
+                        std::to_string(value.size()) + "\r\n" + value + "\r\n";
+  /* every split of the request is parsed once it is complete */
+  for (size_t step : {1, 2, 5, 4096}) {
+    Buffer buf;
+    ParseState state;
+    CommandCache cache;
+    bool err = false;
+    for (size_t off = 0; off < request.size(); off += step) {
+      EXPECT_FALSE(TryParseFromBuffer(buf, state, cache, err));
+      EXPECT_FALSE(err);
+      EXPECT_TRUE(cache.argv.empty());
+      buf.Append(request.substr(off, step));
+    }
+    EXPECT_EQ(state.stage, PARSE_BULK);
+    ASSERT_TRUE(TryParseFromBuffer(buf, state, cache, err));
+    ASSERT_EQ(cache.argc, 3);
+    EXPECT_EQ(cache.argv[0], "set");
+    EXPECT_EQ(cache.argv[1], "key\r\nwith\r\ncrlf");
+    EXPECT_EQ(cache.argv[2], value);
+    EXPECT_EQ(buf.ReadableBytes(), 0);
+    EXPECT_EQ(state.stage, PARSE_ARRAY_LEN);
+  }
+
+  /* the missing bytes of a bulk are known once its length is parsed */
+  Buffer buf;
+  ParseState state;
+  CommandCache cache;
+  bool err = false;
+  buf.Append(request.substr(0, 50));
+  EXPECT_FALSE(TryParseFromBuffer(buf, state, cache, err));
+  EXPECT_EQ(state.BulkRemaining(buf.ReadableBytes()), request.size() - 50);
+
+  /* pipelined requests, empty ones are skipped */
+  buf.Append(request.substr(50) + "*0\r\n*1\r\n$4\r\nping\r\n*1\r\n$5\r\nto");
+  ASSERT_TRUE(TryParseFromBuffer(buf, state, cache, err));
+  EXPECT_EQ(cache.argv[2], value);
+  ASSERT_TRUE(TryParseFromBuffer(buf, state, cache, err));
+  EXPECT_EQ(cache.argv[0], "ping");
+  EXPECT_FALSE(TryParseFromBuffer(buf, state, cache, err));
+  EXPECT_FALSE(err);
+
+  /* invalid requests are dropped with the bytes after them */
+  for (std::string invalid : {"tal\r\n", "*1\r\n$x", "*-1\r\n", "*1\r\n$3\r\ngetx\r\n", "*1\r\n$-3\r\n"}) {
+    buf.Reset();
+    state.Reset();
+    buf.Append(invalid);
+    EXPECT_FALSE(TryParseFromBuffer(buf, state, cache, err));
+    EXPECT_TRUE(err) << invalid;
+    EXPECT_EQ(buf.ReadableBytes(), 0);
+  }
+}
+
+TEST(ProtocolTest, TestScanKernels) {
+  std::mt19937 rng(1);
+  std::string original = RespKernelName();
+  const std::string crlf = "\r\n", prefixes = "$*";
+  for (const char *kernel : {"scalar", "sse2", "avx2"}) {
+    if (!RespUseKernel(kernel)) {
+      continue;
+    }
+    EXPECT_STREQ(RespKernelName(), kernel);
+    /* delimiters at every offset around the widths of the kernels and their tails */
+    for (size_t n : {0, 1, 2, 15, 16, 17, 31, 32, 33, 100}) {
+      for (size_t at = 0; at <= n; ++at) {
+        std::string data(n, 'a');
+        for (auto &c : data) {
+          c = "a\r\n0"[rng() % 4];
+        }
+        std::fill(data.begin(), data.begin() + std::min(at, n), 'a');
+        if (at + 1 < n) {
+          data[at] = '\r';
+          data[at + 1] = '\n';
+        }
+        const char *begin = data.data(), *end = begin + n;
+        EXPECT_EQ(RespFindCRLF(begin, end) - begin, std::search(begin, end, crlf.begin(), crlf.end()) - begin);
+        if (at < n) {
+          data[at] = "$*"[at % 2];
+        }
+        EXPECT_EQ(RespFindPrefix(begin, end) - begin,
+                  std::find_first_of(begin, end, prefixes.begin(), prefixes.end()) - begin);
+      }
+    }
+  }
+  EXPECT_FALSE(RespUseKernel("none"));
+  EXPECT_TRUE(RespUseKernel(original));
+
+  long value = 0;
+  for (std::string num : {"0", "7", "-1", "12345678", "123456789", "-9876543210", "100000000",
+                          "123456789012345678", "-0000000000000042"}) {
+    ASSERT_TRUE(RespParseLength(num.data(), num.size(), value)) << num;
+    EXPECT_EQ(value, std::stol(num));
+  }
+  for (std::string num : {"", "-", "1a", "a1", "12345678:", "/2345678", "1-", "--1", " 1",
+                          "1234567890123456789"}) {
+    EXPECT_FALSE(RespParseLength(num.data(), num.size(), value)) << num;
+  }
+
+  /* short length lines are parsed in a word of 8 bytes */
+  for (std::string line : {"3\r\nset\r\n", "42\r\n$2\r\n", "123456\r\n"}) {
+    ASSERT_EQ(RespParseShortLength(line.data(), value), (int)line.find('\r')) << line;
+    EXPECT_EQ(value, std::stol(line));
+  }
+  for (std::string line : {"1234567\r\n", "12345678", "-1\r\n$3\r\n"}) {
+    EXPECT_EQ(RespParseShortLength(line.data(), value), 0) << line;
+  }
+  for (std::string line : {"\r\n$3\r\nab", "3\rx$3\r\nab", "3a\r\n$3\r\n", ":2\r\n1234"}) {
+    EXPECT_EQ(RespParseShortLength(line.data(), value), -1) << line;
+  }
+}
+
+TEST(ProtocolTest, TestReplyWriter) {
+  Buffer buf;
+  ReplyWriter reply(buf);
+  EXPECT_EQ(reply.Written(), 0);
+  reply.Raw("+OK\r\n");
+  reply.Status("PONG");
+  reply.Error("ERROR", "syntax error");
+  EXPECT_EQ(buf.ReadableAsString(), "+OK\r\n+PONG\r\n-ERROR syntax error\r\n");
+  EXPECT_EQ(reply.Written(), buf.ReadableBytes());
+  buf.ReaderIdxForward(buf.ReadableBytes());
+
+  /* headers from the shared table and the ones formatted every time */
+  for (int64_t n : {0L, 1L, 9L, 10L, 999L, kReplySharedHeaders - 1, kReplySharedHeaders, -1L, -1024L,
+                    INT64_MAX, INT64_MIN}) {
+    reply.Int(n);
+    EXPECT_EQ(buf.ReadableAsString(), ":" + std::to_string(n) + "\r\n");
+    buf.ReaderIdxForward(buf.ReadableBytes());
+    reply.BulkInt(n);
+    std::string digits = std::to_string(n);
+    EXPECT_EQ(buf.ReadableAsString(), "$" + std::to_string(digits.size()) + "\r\n" + digits + "\r\n");
+    buf.ReaderIdxForward(buf.ReadableBytes());
+    if (n >= 0) {
+      reply.ArrayHeader(n);
+      EXPECT_EQ(buf.ReadableAsString(), "*" + std::to_string(n) + "\r\n");
+      buf.ReaderIdxForward(buf.ReadableBytes());
+    }
+  }
+
+  for (size_t len : {0, 1, 1023, 1024, 100000}) {
+    std::string value(len, 'v');
+    reply.Bulk(value);
+    EXPECT_EQ(buf.ReadableAsString(), "$" + std::to_string(len) + "\r\n" + value + "\r\n");
+    buf.ReaderIdxForward(buf.ReadableBytes());
+  }
+
+  reply.Bulk(DynamicString());
+  reply.Array(std::vector<std::string>{"a", "bc"});
+  reply.ArrayOfNils(2);
+  reply.IntArray(std::vector<uint32_t>{3, 4});
+  reply.NilArray();
+  EXPECT_EQ(buf.ReadableAsString(),
+            "$-1\r\n*2\r\n$1\r\na\r\n$2\r\nbc\r\n*2\r\n$-1\r\n$-1\r\n*2\r\n:3\r\n:4\r\n*-1\r\n");
+}
+
+TEST(ProtocolTest, TestPinnedReplies) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  Session session(fds[0], 0, nullptr, nullptr, nullptr, "pinned");
+  ReplyWriter reply(session.write_buf, session.write_chunks);
+  EXPECT_FALSE(reply.Pinnable(kReplyPinThreshold - 1));
+  EXPECT_TRUE(reply.Pinnable(kReplyPinThreshold));
+
+  std::string small(100, 's');
+  auto large = std::make_shared<std::string>(kReplyPinThreshold, 'l');
+  reply.PinnedBulk(small.data(), small.size(), nullptr);
+  EXPECT_TRUE(session.write_chunks.empty());
+  reply.PinnedBulk(large->data(), large->size(), large);
+  reply.Int(7);
+  reply.PinnedBulk(large->data(), large->size(), large);
+  ASSERT_EQ(session.write_chunks.size(), 2);
+  EXPECT_EQ(large.use_count(), 3);
+
+  std::string expected = "$100\r\n" + small + "\r\n";
+  expected += "$" + std::to_string(large->size()) + "\r\n" + *large + "\r\n:7\r\n";
+  expected += "$" + std::to_string(large->size()) + "\r\n" + *large + "\r\n";
+  EXPECT_EQ(reply.Written(), expected.size());
+  EXPECT_EQ(session.OutputBytes(), expected.size());
+
+  /* a chunk is released once it is consumed entirely */
+  size_t header = 3 + std::to_string(large->size()).size();
+  size_t consumed = small.size() + 8 + header + 10;
+  session.ConsumeOutput(consumed);
+  EXPECT_EQ(session.OutputBytes(), expected.size() - consumed);
+  EXPECT_EQ(large.use_count(), 3);
+  session.ConsumeOutput(large->size() - 10 + 2);
+  consumed += large->size() - 10 + 2;
+  EXPECT_EQ(large.use_count(), 2);
+  EXPECT_EQ(session.write_chunks.size(), 1);
+
+  std::string received;
+  char tmp[4096];
+  while (session.OutputBytes() > 0) {
+    int nbytes = session.WriteOutput();
+    ASSERT_GT(nbytes, 0);
+    session.ConsumeOutput(nbytes);
+    ssize_t n;
+    while ((n = recv(fds[1], tmp, sizeof(tmp), MSG_DONTWAIT)) > 0) {
+      received.append(tmp, n);
+    }
+  }
+  EXPECT_EQ(received, expected.substr(consumed));
+  EXPECT_EQ(large.use_count(), 1);
+  EXPECT_TRUE(session.write_chunks.empty());
+  close(fds[1]);
+}
+
+TEST(ProtocolTest, TestZeroCopyReplies) {
+  int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  ASSERT_EQ(bind(listen_fd, (struct sockaddr *)&addr, addr_len), 0);
+  ASSERT_EQ(listen(listen_fd, 1), 0);
+  ASSERT_EQ(getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len), 0);
+  int client_fd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_EQ(connect(client_fd, (struct sockaddr *)&addr, addr_len), 0);
+  int fd = accept(listen_fd, nullptr, nullptr);
+  close(listen_fd);
+  ASSERT_GE(fd, 0);
+  Session session(fd, 0, nullptr, nullptr, nullptr, "zerocopy");
+  if (EnableZeroCopy(fd) != OK) {
+    close(client_fd);
+    GTEST_SKIP() << "MSG_ZEROCOPY is not supported";
+  }
+  session.zerocopy_threshold = kReplyPinThreshold;
+
+  ReplyWriter reply(session.write_buf, session.write_chunks);
+  auto large = std::make_shared<std::string>(kReplyPinThreshold, 'z');
+  reply.PinnedBulk(large->data(), large->size(), large);
+  std::string expected = "$" + std::to_string(large->size()) + "\r\n" + *large + "\r\n";
+  std::string received;
+  char tmp[4096];
+  while (session.OutputBytes() > 0) {
+    int nbytes = session.WriteOutput();
+    ASSERT_GT(nbytes, 0);
+    session.ConsumeOutput(nbytes);
+  }
+  while (received.size() < expected.size()) {
+    ssize_t n = recv(client_fd, tmp, sizeof(tmp), 0);
+    ASSERT_GT(n, 0);
+    received.append(tmp, n);
+  }
+  EXPECT_EQ(received, expected);
+
+  EXPECT_GT(session.zerocopy_sends, 0);
+  /* the chunk is kept after sent until the kernel reports the send is completed */
+  EXPECT_TRUE(session.write_chunks.empty());
+  for (int i = 0; i < 100 && !session.zerocopy_pins.empty(); ++i) {
+    session.ReapZeroCopy();
+    usleep(1000);
+  }
+  EXPECT_TRUE(session.zerocopy_pins.empty());
+  EXPECT_EQ(large.use_count(), 1);
+  close(client_fd);
+}
+
+TEST(ProtocolTest, TestCommandTable) {
+  /* names are looked up in any case */
+  const CommandSpec *spec = Engine::LookupCommand("get");
+  ASSERT_NE(spec, nullptr);
+  EXPECT_STREQ(spec->name, "get");
+  EXPECT_EQ(Engine::LookupCommand("GET"), spec);
+  EXPECT_EQ(Engine::LookupCommand("gEt"), spec);
+  EXPECT_TRUE(spec->flags & CMD_READONLY);
+  EXPECT_FALSE(spec->flags & CMD_WRITE);
+  for (const char *name : {"set", "HINCRBYFLOAT", "Cms.InitByDim", "ts.madd", "ZRANGEBYSCORE", "bgsave"}) {
+    spec = Engine::LookupCommand(name);
+    ASSERT_NE(spec, nullptr) << name;
+    EXPECT_EQ(strcasecmp(spec->name, name), 0);
+  }
+  for (const char *name : {"", "ge", "gett", "getx", "cms", "cms.", "set1", "flushall"}) {
+    EXPECT_EQ(Engine::LookupCommand(name), nullptr) << name;
+  }
+  EXPECT_EQ(Engine::LookupCommand(StringView("get\0", 4)), nullptr);
+  EXPECT_TRUE(Engine::LookupCommand("publish")->flags & CMD_PUBSUB);
+  EXPECT_TRUE(Engine::LookupCommand("lpush")->flags & CMD_WRITE);
+
+  /* arity counts the name, a negative one is the least number of arguments */
+  spec = Engine::LookupCommand("set");
+  EXPECT_TRUE(Engine::ArityMatches(spec, 3));
+  EXPECT_FALSE(Engine::ArityMatches(spec, 2));
+  EXPECT_FALSE(Engine::ArityMatches(spec, 4));
+  spec = Engine::LookupCommand("del");
+  EXPECT_FALSE(Engine::ArityMatches(spec, 1));
+  EXPECT_TRUE(Engine::ArityMatches(spec, 2));
+  EXPECT_TRUE(Engine::ArityMatches(spec, 10));
+
+  std::vector<size_t> keys;
+  Engine::KeyPositions(Engine::LookupCommand("del"), 4, keys);
+  EXPECT_EQ(keys, std::vector<size_t>({1, 2, 3}));
+  keys.clear();
+  Engine::KeyPositions(Engine::LookupCommand("blpop"), 4, keys);
+  EXPECT_EQ(keys, std::vector<size_t>({1, 2}));
+  keys.clear();
+  Engine::KeyPositions(Engine::LookupCommand("bitop"), 5, keys);
+  EXPECT_EQ(keys, std::vector<size_t>({2, 3, 4}));
+  keys.clear();
+  Engine::KeyPositions(Engine::LookupCommand("ts.madd"), 7, keys);
+  EXPECT_EQ(keys, std::vector<size_t>({1, 4}));
+  keys.clear();
+  Engine::KeyPositions(Engine::LookupCommand("publish"), 3, keys);
+  EXPECT_TRUE(keys.empty());
+
+  /* the name is replaced with the one in the table */
+  CommandCache cache;
+  cache.Assign({"LPush", "list", "a"});
+  spec = Engine::ResolveCommand(cache);
+  ASSERT_NE(spec, nullptr);
+  EXPECT_EQ(cache.argv[0], "lpush");
+  EXPECT_EQ(cache.argv[0].data(), spec->name);
+  cache.Assign({"LPUSHX", "list", "a"});
+  EXPECT_EQ(Engine::ResolveCommand(cache), nullptr);
+}
+
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
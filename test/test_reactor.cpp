@@ -0,0 +1,257 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fstream>
+#include <thread>
+#include "../src/net/reactor.h"
+
+TEST(SpscQueueTest, TestPushPop) {
+  SpscQueue<int> queue(5);
+  EXPECT_EQ(queue.Capacity(), 8);
+  int item;
+  EXPECT_FALSE(queue.TryPop(item));
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 8; ++i) {
+      EXPECT_TRUE(queue.TryPush(round * 8 + i));
+    }
+    EXPECT_FALSE(queue.TryPush(100));
+    for (int i = 0; i < 8; ++i) {
+      ASSERT_TRUE(queue.TryPop(item));
+      EXPECT_EQ(item, round * 8 + i);
+    }
+    EXPECT_FALSE(queue.TryPop(item));
+  }
+}
+
+TEST(SpscQueueTest, TestTwoThreads) {
+  SpscQueue<std::string> queue(64);
+  const int n = 200000;
+  std::thread producer([&queue]() {
+    for (int i = 0; i < n; ++i) {
+      std::string item = std::to_string(i);
+      while (!queue.TryPush(std::move(item))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  std::string item;
+  for (int i = 0; i < n; ++i) {
+    while (!queue.TryPop(item)) {
+      std::this_thread::yield();
+    }
+    ASSERT_EQ(item, std::to_string(i));
+  }
+  producer.join();
+  EXPECT_FALSE(queue.TryPop(item));
+}
+
+static std::string Cmd(const std::vector<std::string> &argv) {
+  CommandCache cmds;
+  cmds.Assign(argv);
+  return cmds.ToProtocolString();
+}
+
+static int Connect(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  timeval timeout{5, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return fd;
+}
+
+/* send request and read as many bytes as expected */
+static std::string Request(int fd, const std::string &request, size_t n_expected) {
+  EXPECT_EQ(write(fd, request.data(), request.size()), (ssize_t)request.size());
+  std::string reply;
+  char buf[4096];
+  while (reply.size() < n_expected) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0) {
+      break;
+    }
+    reply.append(buf, n);
+  }
+  return reply;
+}
+
+static void ExpectReply(int fd, const std::string &request, const std::string &expected) {
+  EXPECT_EQ(Request(fd, request, expected.size()), expected);
+}
+
+TEST(ReactorGroupTest, TestForwardAndGather) {
+  const int port = 19751;
+  {
+    std::ofstream conf("reactor_unittest.conf");
+    conf << "ip 127.0.0.1\nport " << port << "\nreactors 3\n";
+  }
+  Config config("reactor_unittest.conf");
+  ASSERT_EQ(config.NumReactors(), 3);
+  ReactorGroup group(&config, nullptr);
+  std::thread server([&group]() { group.Run(); });
+  while (!group.Ready()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  int fd = Connect(port);
+  int other_fd = Connect(port);
+  ASSERT_NE(fd, -1);
+  ASSERT_NE(other_fd, -1);
+
+  /* pipelined commands on keys of all reactors are replied in order */
+  std::string sets, gets, set_replies, get_replies;
+  std::vector<std::string> keys = {"exists"};
+  std::vector<bool> owned(3, false);
+  for (int i = 0; i < 50; ++i) {
+    std::string key = "key" + std::to_string(i), value = "value" + std::to_string(i);
+    sets += Cmd({"SET", key, value});
+    set_replies += kOkMsg;
+    gets += Cmd({"get", key});
+    get_replies += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    keys.push_back(key);
+    owned[group.OwnerOf(key)] = true;
+  }
+  EXPECT_TRUE(owned[0] && owned[1] && owned[2]);
+  ExpectReply(fd, sets, set_replies);
+  ExpectReply(other_fd, gets, get_replies);
+  ExpectReply(fd, Cmd({"total"}), ":50\r\n");
+  keys.push_back("missing");
+  ExpectReply(fd, Cmd(keys), ":50\r\n");
+
+  /* set algebra over sets of different reactors */
+  std::vector<std::string> sinter = {"sinter"}, sdiff = {"sdiff"};
+  for (int i = 0; i < 10; ++i) {
+    std::string key = "set" + std::to_string(i);
+    ExpectReply(fd, Cmd({"sadd", key, "common", "own" + std::to_string(i)}), ":2\r\n");
+    sinter.push_back(key);
+    sdiff.push_back(key);
+  }
+  ExpectReply(fd, Cmd(sinter), "*1\r\n$6\r\ncommon\r\n");
+  ExpectReply(fd, Cmd(sdiff), "*1\r\n$4\r\nown0\r\n");
+  sinter.push_back("key0");
+  ExpectReply(fd, Cmd(sinter), kWrongTypeMsg);
+
+  /* keys of a command which can not be split have to be owned by one reactor */
+  std::string src = "key0", dst = "key1";
+  for (int i = 1; group.OwnerOf(dst) == group.OwnerOf(src); ++i) {
+    dst = "key" + std::to_string(i);
+  }
+  ExpectReply(fd, Cmd({"lmove", src, dst, "left", "left"}), "-ERROR keys of the command are owned by different reactors\r\n");
+  ExpectReply(fd, Cmd({"bgsave"}), "-ERROR command not supported with multiple reactors\r\n");
+  ExpectReply(fd, Cmd({"GeT"}), "-ERROR incorrect number of arguments for 'get' command\r\n");
+  ExpectReply(fd, Cmd({"LMOVE", src, dst, "left"}), "-ERROR incorrect number of arguments for 'lmove' command\r\n");
+
+  keys[0] = "del";
+  ExpectReply(other_fd, Cmd(keys), ":50\r\n");
+  ExpectReply(other_fd, Cmd({"total"}), ":10\r\n");
+
+  /* blocking pop is served wherever the list is */
+  std::string blpop = Cmd({"blpop", "queue", "5"});
+  EXPECT_EQ(write(fd, blpop.data(), blpop.size()), (ssize_t)blpop.size());
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ExpectReply(other_fd, Cmd({"rpush", "queue", "job"}), ":1\r\n");
+  ExpectReply(fd, "", "*2\r\n$5\r\nqueue\r\n$3\r\njob\r\n");
+  ExpectReply(fd, Cmd({"blpop", "queue", "0.05"}), kNilArrayMsg);
+
+  close(fd);
+  close(other_fd);
+  group.Stop();
+  server.join();
+  unlink("reactor_unittest.conf");
+}
+
+TEST(ReactorGroupTest, TestSlowReader) {
+  const int port = 19752;
+  {
+    std::ofstream conf("reactor_slow_unittest.conf");
+    conf << "ip 127.0.0.1\nport " << port << "\nreactors 2\n";
+  }
+  Config config("reactor_slow_unittest.conf");
+  ReactorGroup group(&config, nullptr);
+  std::thread server([&group]() { group.Run(); });
+  while (!group.Ready()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  int fd = Connect(port);
+  ASSERT_NE(fd, -1);
+  std::string value(1 << 20, 'v');
+  ExpectReply(fd, Cmd({"set", "large", value}), kOkMsg);
+
+  /* replies fill the socket buffer while the client does not read, the rest is sent on EPOLLOUT */
+  const int n_gets = 40;
+  std::string gets, expected;
+  for (int i = 0; i < n_gets; ++i) {
+    gets += Cmd({"get", "large"});
+    expected += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+  }
+  gets += Cmd({"ping"});
+  expected += "+PONG\r\n";
+  EXPECT_EQ(write(fd, gets.data(), gets.size()), (ssize_t)gets.size());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(Request(fd, "", expected.size()) == expected);
+  ExpectReply(fd, Cmd({"ping"}), "+PONG\r\n");
+
+  close(fd);
+  group.Stop();
+  server.join();
+  unlink("reactor_slow_unittest.conf");
+}
+
+TEST(ReactorGroupTest, TestUringBackend) {
+  const int port = 19753;
+  {
+    std::ofstream conf("reactor_uring_unittest.conf");
+    conf << "ip 127.0.0.1\nport " << port << "\nreactors 2\nevent-backend io_uring\n";
+  }
+  Config config("reactor_uring_unittest.conf");
+  EXPECT_TRUE(config.UringEnabled());
+  ReactorGroup group(&config, nullptr);
+  std::thread server([&group]() { group.Run(); });
+  while (!group.Ready()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  /* the same replies as with epoll, or epoll is used if io_uring is not available */
+  for (int round = 0; round < 3; ++round) {
+    int fd = Connect(port);
+    ASSERT_NE(fd, -1);
+    std::string sets, gets, set_replies, get_replies;
+    for (int i = 0; i < 100; ++i) {
+      std::string key = "key" + std::to_string(i), value = std::to_string(round) + "value" + std::to_string(i);
+      sets += Cmd({"set", key, value});
+      set_replies += kOkMsg;
+      gets += Cmd({"get", key});
+      get_replies += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    }
+    ExpectReply(fd, sets, set_replies);
+    ExpectReply(fd, gets, get_replies);
+
+    /* requests larger than one receive buffer, and replies sent once the client reads */
+    std::string value(1 << 20, 'a' + round);
+    ExpectReply(fd, Cmd({"set", "large", value}), kOkMsg);
+    std::string large_gets, expected;
+    for (int i = 0; i < 10; ++i) {
+      large_gets += Cmd({"get", "large"});
+      expected += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+    }
+    EXPECT_EQ(write(fd, large_gets.data(), large_gets.size()), (ssize_t)large_gets.size());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(Request(fd, "", expected.size()) == expected);
+    close(fd);
+  }
+
+  close(Connect(port));
+  int fd = Connect(port);
+  ASSERT_NE(fd, -1);
+  ExpectReply(fd, Cmd({"ping"}), "+PONG\r\n");
+  close(fd);
+  group.Stop();
+  server.join();
+  unlink("reactor_uring_unittest.conf");
+}
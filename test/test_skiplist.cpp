@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <algorithm>
 #include <iostream>
+#include <set>
 #include "../src/skiplist.h"
 
 std::mt19937_64 sRandEngine(std::time(nullptr));
@@ -183,7 +184,94 @@ TEST(SkiplistTest, SkipOperatorBracketTest) {
   sk1.Insert(500, DynamicString("rice"));
   std::cout << sk1 << std::endl;
   sk1.Insert(300, DynamicString("wonder"));
-  // TODO not finish yet
+  EXPECT_EQ(sk1[0].score, 100);
+  EXPECT_EQ(sk1[1].score, 200);
+  EXPECT_EQ(sk1[2].score, 300);
+  EXPECT_EQ(sk1[3].score, 500);
+  EXPECT_THROW(sk1[4], std::out_of_range);
+  sk1.Remove(200, DynamicString("fuel"));
+  EXPECT_EQ(sk1[1].data, DynamicString("wonder"));
+}
+
+TEST(SkiplistTest, RankTest) {
+  Skiplist sk;
+  EXPECT_EQ(sk.Rank(1, DynamicString("a")), -1);
+  EXPECT_EQ(sk.GetByRank(0), nullptr);
+  std::vector<int> scores;
+  for (int i = 0; i < 2000; ++i) {
+    scores.push_back(i * 2);
+  }
+  std::shuffle(scores.begin(), scores.end(), sRandEngine);
+  for (int s : scores) {
+    EXPECT_TRUE(sk.Insert(s, DynamicString(std::to_string(s))));
+  }
+  for (int i = 0; i < 2000; ++i) {
+    EXPECT_EQ(sk.Rank(i * 2, DynamicString(std::to_string(i * 2))), i);
+    EXPECT_EQ(sk.GetByRank(i)->score, i * 2);
+  }
+  EXPECT_EQ(sk.Rank(3, DynamicString("3")), -1);
+  EXPECT_EQ(sk.FirstInScoreRange(3)->score, 4);
+  EXPECT_EQ(sk.FirstInScoreRange(4)->score, 4);
+  EXPECT_EQ(sk.FirstInScoreRange(4, true)->score, 6);
+  EXPECT_EQ(sk.FirstInScoreRange(4000), nullptr);
+
+  /* remove every odd-ranked element and check ranks again */
+  for (int i = 1; i < 2000; i += 2) {
+    EXPECT_TRUE(sk.Remove(i * 2, DynamicString(std::to_string(i * 2))));
+  }
+  EXPECT_EQ(sk.Count(), 1000);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(sk.Rank(i * 4, DynamicString(std::to_string(i * 4))), i);
+    EXPECT_EQ(sk[i].score, i * 4);
+  }
+}
+
+TEST(SkiplistTest, TailTest) {
+  Skiplist sk;
+  EXPECT_EQ(sk.End(), nullptr);
+  sk.Insert(5, DynamicString("e"));
+  EXPECT_EQ(sk.End(), sk.Begin());
+  sk.Insert(1, DynamicString("a"));
+  EXPECT_EQ(sk.End()->score, 5);
+  sk.Insert(9, DynamicString("i"));
+  EXPECT_EQ(sk.End()->score, 9);
+  EXPECT_TRUE(sk.Remove(9, DynamicString("i")));
+  EXPECT_EQ(sk.End()->score, 5);
+  EXPECT_EQ(sk.End()->prev, sk.Begin());
+  EXPECT_TRUE(sk.Remove(1, DynamicString("a")));
+  EXPECT_EQ(sk.End()->score, 5);
+  EXPECT_TRUE(sk.Remove(5, DynamicString("e")));
+  EXPECT_EQ(sk.End(), nullptr);
+  sk.Insert(7, DynamicString("g"));
+  sk.Clear();
+  EXPECT_EQ(sk.End(), nullptr);
+  EXPECT_EQ(sk.Begin(), nullptr);
+}
+
+TEST(SkiplistTest, RandomOperationTest) {
+  /* compare ranks and tail with a std::set after random inserts and removes */
+  Skiplist sk;
+  std::set<int> expected;
+  for (int i = 0; i < 20000; ++i) {
+    int v = rand_int(0, 3000);
+    DynamicString ds(std::to_string(v));
+    if (rand_int(0, 2) > 0) {
+      EXPECT_EQ(sk.Insert(v, ds), expected.insert(v).second);
+    } else {
+      EXPECT_EQ(sk.Remove(v, ds), expected.erase(v) == 1);
+    }
+  }
+  ASSERT_EQ(sk.Count(), expected.size());
+  long rank = 0;
+  for (int v : expected) {
+    EXPECT_EQ(sk.Rank(v, DynamicString(std::to_string(v))), rank);
+    EXPECT_EQ(sk[rank].score, v);
+    ++rank;
+  }
+  if (!expected.empty()) {
+    EXPECT_EQ(sk.End()->score, *expected.rbegin());
+    EXPECT_EQ(sk.Begin()->score, *expected.begin());
+  }
 }
 
 int main(int argc, char** argv) {
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "../src/stream.h"
+
+using namespace std;
+
+static StreamIDSpec Spec(const string &str) {
+  StreamIDSpec spec;
+  EXPECT_TRUE(StreamIDSpec::Parse(str, spec));
+  return spec;
+}
+
+TEST(StreamTest, StreamIDTest) {
+  StreamID id;
+  EXPECT_TRUE(StreamID::Parse("123-45", 0, id));
+  EXPECT_EQ(id, StreamID(123, 45));
+  EXPECT_TRUE(StreamID::Parse("123", UINT64_MAX, id));
+  EXPECT_EQ(id, StreamID(123, UINT64_MAX));
+  EXPECT_FALSE(StreamID::Parse("12a-1", 0, id));
+  EXPECT_FALSE(StreamID::Parse("1-", 0, id));
+  EXPECT_FALSE(StreamID::Parse("99999999999999999999999", 0, id));
+  EXPECT_EQ(StreamID(1, 2).ToString(), "1-2");
+  id = StreamID(1, UINT64_MAX);
+  EXPECT_TRUE(id.Incr());
+  EXPECT_EQ(id, StreamID(2, 0));
+  EXPECT_TRUE(id.Decr());
+  EXPECT_EQ(id, StreamID(1, UINT64_MAX));
+  id = StreamID::Min();
+  EXPECT_FALSE(id.Decr());
+
+  StreamIDSpec spec;
+  EXPECT_TRUE(StreamIDSpec::Parse("*", spec));
+  EXPECT_TRUE(spec.auto_ms);
+  EXPECT_TRUE(StreamIDSpec::Parse("5-*", spec));
+  EXPECT_FALSE(spec.auto_ms);
+  EXPECT_TRUE(spec.auto_seq);
+  EXPECT_EQ(spec.id.ms, 5);
+  EXPECT_FALSE(StreamIDSpec::Parse("*-5", spec));
+}
+
+TEST(StreamTest, AddAndRangeTest) {
+  Stream stream;
+  StreamID id;
+  EXPECT_FALSE(stream.Add(Spec("0-0"), 100, {"f", "v"}, id));
+  EXPECT_TRUE(stream.Add(Spec("*"), 100, {"f", "v"}, id));
+  EXPECT_EQ(id, StreamID(100, 0));
+  EXPECT_TRUE(stream.Add(Spec("*"), 100, {"f", "v"}, id));
+  EXPECT_EQ(id, StreamID(100, 1));
+  /* clock goes backwards */
+  EXPECT_TRUE(stream.Add(Spec("*"), 50, {"f", "v"}, id));
+  EXPECT_EQ(id, StreamID(100, 2));
+  EXPECT_TRUE(stream.Add(Spec("100-*"), 0, {"f", "v"}, id));
+  EXPECT_EQ(id, StreamID(100, 3));
+  EXPECT_FALSE(stream.Add(Spec("99-*"), 0, {"f", "v"}, id));
+  EXPECT_FALSE(stream.Add(Spec("100-3"), 0, {"f", "v"}, id));
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    /* field names change every 100 entries */
+    string field = "f" + to_string(i / 100);
+    ASSERT_TRUE(stream.Add(Spec(to_string(100 + i * 3) + "-7"), 0, {field, to_string(i), "g", "x"},
+                           id));
+  }
+  EXPECT_EQ(stream.Length(), 1004);
+  EXPECT_EQ(stream.LastID(), StreamID(3100, 7));
+  EXPECT_GT(stream.NumSegments(), 1000 / kStreamSegmentMaxEntries);
+
+  auto all = stream.Range(StreamID::Min(), StreamID::Max(), 0, false);
+  ASSERT_EQ(all.size(), 1004);
+  for (size_t i = 1; i < all.size(); ++i) {
+    ASSERT_LT(all[i - 1].id, all[i].id);
+  }
+  EXPECT_EQ(all[500].fields, vector<string>({"f4", "497", "g", "x"}));
+  auto reversed = stream.Range(StreamID::Min(), StreamID::Max(), 0, true);
+  ASSERT_EQ(reversed.size(), 1004);
+  EXPECT_EQ(reversed[0].id, StreamID(3100, 7));
+  EXPECT_EQ(reversed[1003].id, StreamID(100, 0));
+
+  auto part = stream.Range(StreamID(400, 0), StreamID(1000, 7), 0, false);
+  ASSERT_EQ(part.size(), 201);
+  EXPECT_EQ(part.front().id, StreamID(400, 7));
+  EXPECT_EQ(part.back().id, StreamID(1000, 7));
+  part = stream.Range(StreamID(400, 0), StreamID(1000, 7), 10, true);
+  ASSERT_EQ(part.size(), 10);
+  EXPECT_EQ(part.front().id, StreamID(1000, 7));
+  EXPECT_EQ(part.back().id, StreamID(973, 7));
+  EXPECT_TRUE(stream.Range(StreamID(401, 0), StreamID(402, 0), 0, false).empty());
+  EXPECT_TRUE(stream.Range(StreamID(5000, 0), StreamID::Max(), 0, true).empty());
+}
+
+TEST(StreamTest, TrimTest) {
+  Stream stream;
+  StreamID id;
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    stream.Add(Spec(to_string(i)), 0, {"f", to_string(i)}, id);
+  }
+  /* approximate trimming removes whole segments only */
+  EXPECT_EQ(stream.TrimByLength(900, true), 0);
+  EXPECT_EQ(stream.TrimByLength(800, true), 128);
+  EXPECT_EQ(stream.TrimByLength(800, false), 72);
+  EXPECT_EQ(stream.Length(), 800);
+  auto entries = stream.Range(StreamID::Min(), StreamID::Max(), 2, false);
+  EXPECT_EQ(entries[0].id, StreamID(201, 0));
+  EXPECT_EQ(entries[1].fields, vector<string>({"f", "202"}));
+
+  EXPECT_EQ(stream.TrimByMinID(StreamID(500, 0), false), 299);
+  EXPECT_EQ(stream.Range(StreamID::Min(), StreamID::Max(), 1, false)[0].id, StreamID(500, 0));
+  EXPECT_EQ(stream.TrimByLength(0, false), 501);
+  EXPECT_EQ(stream.Length(), 0);
+  EXPECT_EQ(stream.NumSegments(), 0);
+  /* the last id stays */
+  EXPECT_FALSE(stream.Add(Spec("1000"), 0, {"f", "v"}, id));
+  EXPECT_TRUE(stream.Add(Spec("*"), 0, {"f", "v"}, id));
+  EXPECT_EQ(id, StreamID(1000, 1));
+}
+
+TEST(StreamTest, DumpAndLoadTest) {
+  Stream stream;
+  StreamID id;
+  for (uint64_t i = 1; i <= 300; ++i) {
+    stream.Add(Spec(to_string(i * 10) + "-*"), 0, {"k" + to_string(i % 2), string(i, 'v')}, id);
+  }
+  stream.TrimByLength(250, false);
+  string data = stream.Dump();
+  Stream restored;
+  ASSERT_TRUE(restored.Load(data.data(), data.size()));
+  EXPECT_EQ(restored.Length(), 250);
+  EXPECT_EQ(restored.LastID(), stream.LastID());
+  EXPECT_EQ(restored.Dump(), data);
+  auto expected = stream.Range(StreamID::Min(), StreamID::Max(), 0, false);
+  auto actual = restored.Range(StreamID::Min(), StreamID::Max(), 0, false);
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(actual[i].id, expected[i].id);
+    EXPECT_EQ(actual[i].fields, expected[i].fields);
+  }
+  EXPECT_FALSE(restored.Load(data.data(), data.size() - 1));
+  /* length in header does not match the segments */
+  data[16] ^= 1;
+  EXPECT_FALSE(restored.Load(data.data(), data.size()));
+  Stream empty;
+  EXPECT_TRUE(empty.Load(Stream().Dump().data(), Stream().Dump().size()));
+  EXPECT_FALSE(empty.Load("", 0));
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include "../src/timeseries.h"
+
+using namespace std;
+
+TEST(TimeSeriesTest, AddAndRangeTest) {
+  TimeSeries ts;
+  TSSample last;
+  EXPECT_FALSE(ts.LastSample(last));
+  EXPECT_TRUE(ts.Add(-5, 1.5));
+  EXPECT_FALSE(ts.Add(-5, 2.5));
+  EXPECT_FALSE(ts.Add(-6, 2.5));
+  /* regular intervals, irregular jitter, big jumps and all kinds of values */
+  vector<TSSample> samples{{-5, 1.5}};
+  int64_t timestamp = 0;
+  srand(1);
+  for (int i = 0; i < 20000; ++i) {
+    if (i % 1000 == 999) {
+      timestamp += 1LL << 40;
+    } else {
+      timestamp += 1000 + (i % 7 == 0 ? rand() % 5000 : 0);
+    }
+    double value = i % 3 == 0 ? 20.0 + (i % 10) * 0.1 : (i % 3 == 1 ? rand() : -1.0 / (i + 1));
+    ASSERT_TRUE(ts.Add(timestamp, value));
+    samples.emplace_back(timestamp, value);
+  }
+  EXPECT_TRUE(ts.Add(INT64_MAX, NAN));
+  EXPECT_FALSE(ts.Add(INT64_MAX, 0));
+  samples.emplace_back(INT64_MAX, NAN);
+  EXPECT_EQ(ts.Length(), samples.size());
+  EXPECT_GT(ts.NumChunks(), 1);
+  EXPECT_TRUE(ts.LastSample(last));
+  EXPECT_EQ(last.first, INT64_MAX);
+
+  auto all = ts.Range(INT64_MIN, INT64_MAX, 0);
+  ASSERT_EQ(all.size(), samples.size());
+  for (size_t i = 0; i + 1 < all.size(); ++i) {
+    ASSERT_EQ(all[i], samples[i]);
+  }
+  EXPECT_TRUE(std::isnan(all.back().second));
+
+  auto part = ts.Range(samples[100].first, samples[300].first, 0);
+  ASSERT_EQ(part.size(), 201);
+  EXPECT_EQ(part.front(), samples[100]);
+  EXPECT_EQ(part.back(), samples[300]);
+  part = ts.Range(samples[100].first + 1, INT64_MAX, 5);
+  ASSERT_EQ(part.size(), 5);
+  EXPECT_EQ(part.front(), samples[101]);
+  EXPECT_TRUE(ts.Range(1, 999, 0).empty());
+}
+
+TEST(TimeSeriesTest, CompressionTest) {
+  TimeSeries ts;
+  /* one sample per second with a slowly changing value */
+  for (int i = 0; i < 10000; ++i) {
+    ASSERT_TRUE(ts.Add(1600000000000LL + i * 1000, 100 + (i / 100)));
+  }
+  EXPECT_LT(ts.Dump().size(), 10000 * 2);
+}
+
+TEST(TimeSeriesTest, AggregateTest) {
+  TimeSeries ts;
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(ts.Add(i * 10 - 500, i));
+  }
+  /* buckets of 100ms hold 10 samples each */
+  auto buckets = ts.Aggregate(INT64_MIN, INT64_MAX, kTSAggAvg, 100, 0);
+  ASSERT_EQ(buckets.size(), 10);
+  EXPECT_EQ(buckets[0], TSSample(-500, 4.5));
+  EXPECT_EQ(buckets[9], TSSample(400, 94.5));
+  buckets = ts.Aggregate(-55, 55, kTSAggSum, 100, 0);
+  ASSERT_EQ(buckets.size(), 2);
+  EXPECT_EQ(buckets[0], TSSample(-100, 45 + 46 + 47 + 48 + 49));
+  EXPECT_EQ(buckets[1], TSSample(0, 50 + 51 + 52 + 53 + 54 + 55));
+  buckets = ts.Aggregate(INT64_MIN, INT64_MAX, kTSAggMin, 250, 2);
+  ASSERT_EQ(buckets.size(), 2);
+  EXPECT_EQ(buckets[0], TSSample(-500, 0));
+  EXPECT_EQ(buckets[1], TSSample(-250, 25));
+  buckets = ts.Aggregate(INT64_MIN, INT64_MAX, kTSAggMax, 1000, 0);
+  ASSERT_EQ(buckets.size(), 2);
+  EXPECT_EQ(buckets[0], TSSample(-1000, 49));
+  EXPECT_EQ(buckets[1], TSSample(0, 99));
+  buckets = ts.Aggregate(0, 0, kTSAggCount, 1, 0);
+  ASSERT_EQ(buckets.size(), 1);
+  EXPECT_EQ(buckets[0], TSSample(0, 1));
+}
+
+TEST(TimeSeriesTest, RetentionTest) {
+  TimeSeries ts(5000);
+  EXPECT_EQ(ts.Retention(), 5000);
+  for (int i = 0; i < 100000; ++i) {
+    ASSERT_TRUE(ts.Add(i, i * 0.5));
+  }
+  /* whole chunks out of retention are dropped */
+  EXPECT_LT(ts.Length(), 20000);
+  EXPECT_GE(ts.Length(), 5001);
+  auto all = ts.Range(INT64_MIN, INT64_MAX, 0);
+  ASSERT_EQ(all.size(), 5001);
+  EXPECT_EQ(all.front(), TSSample(94999, 94999 * 0.5));
+  auto buckets = ts.Aggregate(INT64_MIN, INT64_MAX, kTSAggCount, 100000, 0);
+  ASSERT_EQ(buckets.size(), 1);
+  EXPECT_EQ(buckets[0], TSSample(0, 5001));
+}
+
+TEST(TimeSeriesTest, DumpAndLoadTest) {
+  TimeSeries ts(1000000);
+  for (int i = 0; i < 5000; ++i) {
+    ASSERT_TRUE(ts.Add(i * 15 + (i % 3), std::sin(i)));
+  }
+  string data = ts.Dump();
+  TimeSeries loaded;
+  ASSERT_TRUE(loaded.Load(data.data(), data.size()));
+  EXPECT_EQ(loaded.Retention(), 1000000);
+  EXPECT_EQ(loaded.Length(), 5000);
+  EXPECT_EQ(loaded.NumChunks(), ts.NumChunks());
+  EXPECT_EQ(loaded.Range(INT64_MIN, INT64_MAX, 0), ts.Range(INT64_MIN, INT64_MAX, 0));
+  /* appending continues from the restored state */
+  EXPECT_FALSE(loaded.Add(74986, 0));
+  ASSERT_TRUE(ts.Add(80000, 0.25));
+  ASSERT_TRUE(loaded.Add(80000, 0.25));
+  EXPECT_EQ(loaded.Dump(), ts.Dump());
+
+  TimeSeries empty;
+  data = empty.Dump();
+  ASSERT_TRUE(loaded.Load(data.data(), data.size()));
+  EXPECT_EQ(loaded.Length(), 0);
+
+  data = ts.Dump();
+  EXPECT_FALSE(loaded.Load(data.data(), data.size() - 1));
+  string broken = data;
+  broken[8] ^= 1;
+  EXPECT_FALSE(loaded.Load(broken.data(), broken.size()));
+  /* corrupted bits are caught by decoding every sample */
+  for (size_t i = 60; i < 80; ++i) {
+    broken = data;
+    broken[i] ^= 0x10;
+    TimeSeries other;
+    other.Load(broken.data(), broken.size());
+  }
+  EXPECT_EQ(loaded.Length(), 0);
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "../src/topk.h"
+
+using namespace std;
+
+TEST(TopKTest, HeavyHittersTest) {
+  TopK topk(5, 64, 5, 0.9);
+  mt19937 rng(11);
+  string expelled;
+  /* heavy-0 ... heavy-4 come far more often than the noise */
+  for (int i = 0; i < 50000; ++i) {
+    if (rng() % 4 == 0) {
+      topk.Add("heavy-" + to_string(rng() % 5), 1, expelled);
+    } else {
+      topk.Add("noise-" + to_string(rng() % 10000), 1, expelled);
+    }
+  }
+  auto items = topk.List();
+  ASSERT_EQ(items.size(), 5);
+  for (size_t i = 0; i < items.size(); ++i) {
+    EXPECT_EQ(items[i].first.substr(0, 6), "heavy-");
+    if (i > 0) {
+      EXPECT_GE(items[i - 1].second, items[i].second);
+    }
+  }
+  EXPECT_TRUE(topk.Query("heavy-0"));
+  EXPECT_FALSE(topk.Query("noise-0"));
+}
+
+TEST(TopKTest, ExpelTest) {
+  TopK topk(2, 100, 4, 0.9);
+  string expelled;
+  EXPECT_FALSE(topk.Add("a", 3, expelled));
+  EXPECT_FALSE(topk.Add("b", 2, expelled));
+  EXPECT_FALSE(topk.Add("c", 1, expelled));
+  EXPECT_FALSE(topk.Query("c"));
+  EXPECT_TRUE(topk.Add("c", 5, expelled));
+  EXPECT_EQ(expelled, "b");
+  auto items = topk.List();
+  ASSERT_EQ(items.size(), 2);
+  EXPECT_EQ(items[0], TopKItem("c", 6));
+  EXPECT_EQ(items[1], TopKItem("a", 3));
+}
+
+TEST(TopKTest, DumpAndLoadTest) {
+  TopK topk(10, 16, 3, 0.9);
+  TopK replay(10, 16, 3, 0.9);
+  string expelled;
+  for (int i = 0; i < 1000; ++i) {
+    topk.Add(to_string(i % 37), 1, expelled);
+  }
+  string data = topk.Dump();
+  TopK restored;
+  ASSERT_TRUE(restored.Load(data.data(), data.size()));
+  EXPECT_EQ(restored.List(), topk.List());
+  /* the generator state is restored as well, so both go on identically */
+  for (int i = 0; i < 1000; ++i) {
+    topk.Add(to_string(i % 53), 1, expelled);
+    restored.Add(to_string(i % 53), 1, expelled);
+  }
+  EXPECT_EQ(restored.Dump(), topk.Dump());
+  data.pop_back();
+  EXPECT_FALSE(restored.Load(data.data(), data.size()));
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../src/net/uring.h"
+
+/* take the next completion, waiting for it if there is none yet */
+static UringCompletion Next(IoUring &ring) {
+  UringCompletion completion{};
+  while (!ring.PopCompletion(completion)) {
+    ring.Submit(1, 1000);
+  }
+  return completion;
+}
+
+TEST(IoUringTest, TestMultishotRecv) {
+  IoUring ring;
+  if (!ring.Init(64, false) || !ring.SetupBuffers(4, 16)) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_TRUE(ring.AddRecv(fds[0], 7));
+  EXPECT_EQ(ring.Submit(), 1);
+
+  /* every receive picks a buffer, which is used again once it is given back */
+  for (int i = 0; i < 10; ++i) {
+    std::string data = "message" + std::to_string(i);
+    ASSERT_EQ(write(fds[1], data.data(), data.size()), (ssize_t)data.size());
+    UringCompletion completion = Next(ring);
+    EXPECT_EQ(completion.user_data, 7u);
+    ASSERT_EQ(completion.res, (int)data.size());
+    EXPECT_TRUE(completion.more);
+    ASSERT_GE(completion.buffer_id, 0);
+    EXPECT_EQ(std::string(ring.BufferOf(completion.buffer_id), completion.res), data);
+    ring.RecycleBuffer(completion.buffer_id);
+  }
+
+  /* bytes beyond one buffer are split */
+  std::string data(40, 'x');
+  ASSERT_EQ(write(fds[1], data.data(), data.size()), (ssize_t)data.size());
+  size_t received = 0;
+  while (received < data.size()) {
+    UringCompletion completion = Next(ring);
+    ASSERT_GT(completion.res, 0);
+    EXPECT_LE(completion.res, 16);
+    received += completion.res;
+    ring.RecycleBuffer(completion.buffer_id);
+  }
+  EXPECT_EQ(received, data.size());
+
+  close(fds[1]);
+  UringCompletion completion = Next(ring);
+  EXPECT_EQ(completion.res, 0);
+  EXPECT_FALSE(completion.more);
+  EXPECT_EQ(completion.buffer_id, -1);
+  close(fds[0]);
+}
+
+TEST(IoUringTest, TestPollSendAndCancel) {
+  IoUring ring;
+  if (!ring.Init(64, false)) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_TRUE(ring.AddPoll(fds[0], POLLOUT, false, 1));
+  UringCompletion completion = Next(ring);
+  EXPECT_EQ(completion.user_data, 1u);
+  EXPECT_TRUE(completion.res & POLLOUT);
+  EXPECT_FALSE(completion.more);
+
+  /* the two segments are sent with one request */
+  char first[] = "hello ", second[] = "world";
+  struct iovec iov[2] = {{first, 6}, {second, 5}};
+  struct msghdr msg{};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+  ASSERT_TRUE(ring.AddSendMsg(fds[0], &msg, MSG_DONTWAIT | MSG_NOSIGNAL, 2));
+  completion = Next(ring);
+  EXPECT_EQ(completion.user_data, 2u);
+  EXPECT_EQ(completion.res, 11);
+  char buf[32];
+  ASSERT_EQ(read(fds[1], buf, sizeof(buf)), 11);
+  EXPECT_EQ(std::string(buf, 11), "hello world");
+
+  /* a multishot poll goes on until it is cancelled */
+  ASSERT_TRUE(ring.AddPoll(fds[1], POLLIN, true, 3));
+  ring.Submit();
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(write(fds[0], "x", 1), 1);
+    completion = Next(ring);
+    EXPECT_EQ(completion.user_data, 3u);
+    EXPECT_TRUE(completion.res & POLLIN);
+    EXPECT_TRUE(completion.more);
+    ASSERT_EQ(read(fds[1], buf, sizeof(buf)), 1);
+  }
+  ASSERT_TRUE(ring.AddCancel(3, 4));
+  bool cancelled = false, poll_ended = false;
+  while (!cancelled || !poll_ended) {
+    completion = Next(ring);
+    if (completion.user_data == 4) {
+      EXPECT_EQ(completion.res, 1);
+      cancelled = true;
+    } else {
+      EXPECT_EQ(completion.user_data, 3u);
+      if (!completion.more) {
+        EXPECT_EQ(completion.res, -ECANCELED);
+        poll_ended = true;
+      }
+    }
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(IoUringTest, TestWriteAndSync) {
+  IoUring ring;
+  if (!ring.Init(8, false)) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+  const char *filename = "uring_unittest.aof";
+  unlink(filename);
+  int fd = open(filename, O_WRONLY | O_APPEND | O_CREAT, 0644);
+  ASSERT_NE(fd, -1);
+  std::string expected;
+  for (int i = 0; i < 5; ++i) {
+    std::string data = "*1\r\n$4\r\nping\r\n" + std::string(i * 1000, 'a');
+    EXPECT_EQ(ring.WriteAndSync(fd, data.data(), data.size()), 0);
+    expected += data;
+  }
+  EXPECT_EQ(ring.WriteAndSync(fd, nullptr, 0), 0);
+  close(fd);
+  std::ifstream ifs(filename);
+  std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(content, expected);
+  unlink(filename);
+}
@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <set>
+#include "../src/vecdist.h"
+#include "../src/vectorset.h"
+
+using namespace std;
+
+static vector<float> RandomVector(mt19937 &rng, uint32_t dim) {
+  normal_distribution<float> dist;
+  vector<float> vec(dim);
+  for (auto &v : vec) {
+    v = dist(rng);
+  }
+  return vec;
+}
+
+static string Name(int i) {
+  return "e" + to_string(i);
+}
+
+TEST(VectorSetTest, KernelsTest) {
+  mt19937 rng(1);
+  string original = VecKernelName();
+  for (const char *kernel : {"scalar", "sse", "avx2"}) {
+    if (!VecUseKernel(kernel)) {
+      continue;
+    }
+    EXPECT_STREQ(VecKernelName(), kernel);
+    /* lengths around the widths of the kernels and their tails */
+    for (size_t n : {1, 3, 4, 7, 8, 15, 16, 17, 31, 100}) {
+      auto a = RandomVector(rng, n), b = RandomVector(rng, n);
+      vector<int8_t> q(n);
+      double dot = 0, l2 = 0, dot_i8 = 0, l2_i8 = 0;
+      for (size_t i = 0; i < n; ++i) {
+        q[i] = (int8_t)(rng() % 255 - 127);
+        dot += a[i] * b[i];
+        l2 += (a[i] - b[i]) * (a[i] - b[i]);
+        dot_i8 += a[i] * q[i];
+        l2_i8 += (a[i] - q[i] * 0.01) * (a[i] - q[i] * 0.01);
+      }
+      EXPECT_NEAR(VecDot(a.data(), b.data(), n), dot, 1e-3);
+      EXPECT_NEAR(VecL2Sq(a.data(), b.data(), n), l2, 1e-3);
+      EXPECT_NEAR(VecDotI8(a.data(), q.data(), n), dot_i8, 1e-2);
+      EXPECT_NEAR(VecL2SqI8(a.data(), q.data(), 0.01, n), l2_i8, 1e-3);
+    }
+  }
+  EXPECT_FALSE(VecUseKernel("none"));
+  EXPECT_TRUE(VecUseKernel(original));
+}
+
+TEST(VectorSetTest, AddAndSearchTest) {
+  VectorSet vset(3, kVecMetricL2, false);
+  float a[] = {0, 0, 0}, b[] = {1, 0, 0}, c[] = {0, 2, 0};
+  EXPECT_TRUE(vset.Add("a", a));
+  EXPECT_TRUE(vset.Add("b", b));
+  EXPECT_TRUE(vset.Add("c", c));
+  EXPECT_FALSE(vset.Add("a", a));
+  EXPECT_EQ(vset.Count(), 3);
+  EXPECT_FALSE(vset.Indexed());
+  float query[] = {0.9, 0, 0};
+  auto matches = vset.Search(query, 2, kVecDefaultEf);
+  ASSERT_EQ(matches.size(), 2);
+  EXPECT_EQ(matches[0].first, "b");
+  EXPECT_NEAR(matches[0].second, 0.1, 1e-6);
+  EXPECT_EQ(matches[1].first, "a");
+  EXPECT_EQ(vset.Search(query, 10, kVecDefaultEf).size(), 3);
+
+  EXPECT_TRUE(vset.Remove("b"));
+  EXPECT_FALSE(vset.Remove("b"));
+  EXPECT_EQ(vset.Search(query, 1, kVecDefaultEf)[0].first, "a");
+  vector<float> vec;
+  EXPECT_FALSE(vset.Get("b", vec));
+  ASSERT_TRUE(vset.Get("c", vec));
+  EXPECT_EQ(vec, vector<float>(c, c + 3));
+
+  /* cosine compares directions and inner product prefers longer vectors */
+  VectorSet cosine(2, kVecMetricCosine, false), ip(2, kVecMetricIP, false);
+  float x[] = {10, 0}, y[] = {1, 1}, q[] = {1, 0.1};
+  cosine.Add("x", x);
+  cosine.Add("y", y);
+  ip.Add("x", x);
+  ip.Add("y", y);
+  matches = cosine.Search(q, 2, kVecDefaultEf);
+  EXPECT_EQ(matches[0].first, "x");
+  EXPECT_NEAR(matches[0].second, 1 / sqrt(1.01), 1e-6);
+  EXPECT_NEAR(matches[1].second, 1.1 / sqrt(2.02), 1e-6);
+  matches = ip.Search(q, 2, kVecDefaultEf);
+  EXPECT_EQ(matches[0].first, "x");
+  EXPECT_NEAR(matches[0].second, 10, 1e-5);
+}
+
+TEST(VectorSetTest, IndexRecallTest) {
+  const uint32_t dim = 32;
+  const int n = 3000;
+  mt19937 rng(2);
+  VectorSet vset(dim, kVecMetricL2, false);
+  for (int i = 0; i < n; ++i) {
+    auto vec = RandomVector(rng, dim);
+    ASSERT_TRUE(vset.Add(Name(i), vec.data()));
+    ASSERT_EQ(vset.Indexed(), vset.Count() >= kVecIndexThreshold);
+  }
+  size_t hits = 0;
+  for (int i = 0; i < 100; ++i) {
+    auto query = RandomVector(rng, dim);
+    auto exact = vset.SearchExact(query.data(), 10);
+    auto approx = vset.Search(query.data(), 10, kVecDefaultEf);
+    ASSERT_EQ(approx.size(), 10);
+    set<string> expected;
+    for (auto &match : exact) {
+      expected.insert(match.first);
+    }
+    for (auto &match : approx) {
+      hits += expected.count(match.first);
+    }
+  }
+  EXPECT_GT(hits, 100 * 10 * 0.9);
+
+  /* removed elements are never returned, and the graph is dropped once the set gets small */
+  for (int i = 0; i < n; i += 2) {
+    ASSERT_TRUE(vset.Remove(Name(i)));
+  }
+  EXPECT_TRUE(vset.Indexed());
+  auto query = RandomVector(rng, dim);
+  for (auto &match : vset.Search(query.data(), 50, kVecDefaultEf)) {
+    EXPECT_EQ(stoi(match.first.substr(1)) % 2, 1);
+  }
+  for (int i = 1; i < n; i += 2) {
+    if (i < n - 100) {
+      ASSERT_TRUE(vset.Remove(Name(i)));
+    }
+  }
+  EXPECT_EQ(vset.Count(), 50);
+  EXPECT_FALSE(vset.Indexed());
+  EXPECT_EQ(vset.Search(query.data(), 100, kVecDefaultEf).size(), 50);
+}
+
+TEST(VectorSetTest, QuantizedTest) {
+  const uint32_t dim = 64;
+  mt19937 rng(3);
+  VectorSet vset(dim, kVecMetricCosine, true);
+  vector<vector<float>> vecs;
+  for (int i = 0; i < 200; ++i) {
+    vecs.emplace_back(RandomVector(rng, dim));
+    vset.Add(Name(i), vecs.back().data());
+  }
+  /* every vector finds itself through its quantized copy */
+  for (int i = 0; i < 200; ++i) {
+    auto matches = vset.Search(vecs[i].data(), 1, kVecDefaultEf);
+    ASSERT_EQ(matches[0].first, Name(i));
+    EXPECT_NEAR(matches[0].second, 1, 0.01);
+  }
+  vector<float> vec;
+  ASSERT_TRUE(vset.Get(Name(0), vec));
+  float norm = sqrt(VecDot(vec.data(), vec.data(), dim));
+  EXPECT_NEAR(norm, 1, 0.01);
+}
+
+TEST(VectorSetTest, DumpAndLoadTest) {
+  const uint32_t dim = 16;
+  mt19937 rng(4);
+  for (bool quantized : {false, true}) {
+    VectorSet vset(dim, kVecMetricIP, quantized);
+    for (int i = 0; i < 1500; ++i) {
+      auto vec = RandomVector(rng, dim);
+      vset.Add(Name(i), vec.data());
+    }
+    for (int i = 0; i < 100; ++i) {
+      vset.Remove(Name(i * 3));
+    }
+    string data = vset.Dump();
+    VectorSet loaded;
+    ASSERT_TRUE(loaded.Load(data.data(), data.size()));
+    EXPECT_EQ(loaded.Dim(), dim);
+    EXPECT_EQ(loaded.Metric(), kVecMetricIP);
+    EXPECT_EQ(loaded.Quantized(), quantized);
+    EXPECT_EQ(loaded.Count(), 1400);
+    EXPECT_TRUE(loaded.Indexed());
+    auto query = RandomVector(rng, dim);
+    EXPECT_EQ(loaded.Search(query.data(), 10, 50), vset.Search(query.data(), 10, 50));
+    /* the graph keeps growing the same way */
+    auto vec = RandomVector(rng, dim);
+    vset.Add("new", vec.data());
+    loaded.Add("new", vec.data());
+    EXPECT_EQ(loaded.Dump(), vset.Dump());
+
+    EXPECT_FALSE(loaded.Load(data.data(), data.size() - 1));
+    for (size_t i = 0; i < 200; ++i) {
+      string broken = data;
+      broken[rng() % broken.size()] ^= (char)(1 << (rng() % 8));
+      VectorSet other;
+      other.Load(broken.data(), broken.size());
+    }
+  }
+  VectorSet empty(4, kVecMetricL2, false), loaded;
+  string data = empty.Dump();
+  ASSERT_TRUE(loaded.Load(data.data(), data.size()));
+  EXPECT_EQ(loaded.Count(), 0);
+  EXPECT_EQ(loaded.Dim(), 4);
+  float query[] = {1, 2, 3, 4};
+  EXPECT_TRUE(loaded.Search(query, 1, 1).empty());
+}
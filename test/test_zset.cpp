@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <iostream>
+#include "../src/zset.h"
+
+using namespace std;
+
+TEST(ZSetTest, AddScoreRemoveTest) {
+  ZSet zs;
+  EXPECT_EQ(zs.Count(), 0);
+  EXPECT_EQ(zs.Add("a", 10), NEW_ADDED);
+  EXPECT_EQ(zs.Add("b", 5), NEW_ADDED);
+  EXPECT_EQ(zs.Add("c", 20), NEW_ADDED);
+  EXPECT_EQ(zs.Add("a", 10), EXISTED);
+  EXPECT_EQ(zs.Add("a", 1), UPDATED);
+  EXPECT_EQ(zs.Count(), 3);
+
+  int64_t score;
+  EXPECT_TRUE(zs.Score(HEntryKey("a"), score));
+  EXPECT_EQ(score, 1);
+  EXPECT_FALSE(zs.Score(HEntryKey("x"), score));
+  EXPECT_EQ(zs.Rank(HEntryKey("a")), 0);
+  EXPECT_EQ(zs.Rank(HEntryKey("b")), 1);
+  EXPECT_EQ(zs.Rank(HEntryKey("c")), 2);
+  EXPECT_EQ(zs.Rank(HEntryKey("x")), -1);
+
+  EXPECT_TRUE(zs.Remove(HEntryKey("b")));
+  EXPECT_FALSE(zs.Remove(HEntryKey("b")));
+  EXPECT_EQ(zs.Count(), 2);
+  EXPECT_EQ(zs.Rank(HEntryKey("c")), 1);
+}
+
+TEST(ZSetTest, RangeTest) {
+  ZSet zs;
+  /* enough members to trigger rehashing of the dict */
+  for (int i = 0; i < 1000; ++i) {
+    zs.Add(to_string(i), i * 10);
+  }
+  EXPECT_EQ(zs.Count(), 1000);
+  auto items = zs.RangeByRank(10, 14);
+  ASSERT_EQ(items.size(), 5);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(items[i].first, DynamicString(to_string(10 + i)));
+    EXPECT_EQ(items[i].second, (10 + i) * 10);
+  }
+  EXPECT_EQ(zs.RangeByRank(995, 2000).size(), 5);
+  EXPECT_TRUE(zs.RangeByRank(1000, 2000).empty());
+
+  ZScoreRange range;
+  range.min = 100;
+  range.max = 150;
+  EXPECT_EQ(zs.RangeByScore(range).size(), 6);
+  range.minex = true;
+  range.maxex = true;
+  items = zs.RangeByScore(range);
+  ASSERT_EQ(items.size(), 4);
+  EXPECT_EQ(items.front().second, 110);
+  EXPECT_EQ(items.back().second, 140);
+  items = zs.RangeByScore(range, 1, 2);
+  ASSERT_EQ(items.size(), 2);
+  EXPECT_EQ(items.front().second, 120);
+  EXPECT_EQ(zs.RangeByScore(ZScoreRange()).size(), 1000);
+
+  for (int i = 0; i < 1000; i += 2) {
+    EXPECT_TRUE(zs.Remove(HEntryKey(to_string(i))));
+  }
+  for (int i = 1; i < 1000; i += 2) {
+    EXPECT_EQ(zs.Rank(HEntryKey(to_string(i))), i / 2);
+  }
+}
+
+TEST(ZSetTest, PopMinTest) {
+  ZSet zs;
+  zs.Add("x", 3);
+  zs.Add("y", 1);
+  zs.Add("z", 2);
+  auto items = zs.PopMin(2);
+  ASSERT_EQ(items.size(), 2);
+  EXPECT_EQ(items[0].first, DynamicString("y"));
+  EXPECT_EQ(items[1].first, DynamicString("z"));
+  EXPECT_EQ(zs.Count(), 1);
+  int64_t score;
+  EXPECT_FALSE(zs.Score(HEntryKey("y"), score));
+  EXPECT_EQ(zs.PopMin(10).size(), 1);
+  EXPECT_TRUE(zs.PopMin(1).empty());
+}
+
+TEST(ZSetTest, SerializeTest) {
+  ZSet zs;
+  std::vector<char> buf;
+  EXPECT_EQ(zs.Serialize(buf), 0);
+  zs.Add("m", -1);
+  zs.Add("n", 2);
+  zs.Serialize(buf);
+  /* count, then (member, score) ordered by score */
+  std::vector<char> expected = {2, 1, 'm'};
+  unsigned char enc[10];
+  uint8_t n = EncodeVarSignedInt64(-1, enc);
+  expected.insert(expected.end(), enc, enc + n);
+  expected.insert(expected.end(), {1, 'n', 2});
+  EXPECT_EQ(buf, expected);
+}